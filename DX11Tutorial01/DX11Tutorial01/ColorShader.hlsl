@@ -4,22 +4,42 @@ cbuffer ModelBuffer : register(b0)
 	float4x4 normalMatrix;
 }
 
+// Permutation features, see ShaderPermutations.h
+#ifndef NORMAL_MAP
+#define NORMAL_MAP 1
+#endif
+#ifndef LIGHTS_CLUSTERED
+#define LIGHTS_CLUSTERED 1
+#endif
+#ifndef MAX_DIRECT_LIGHTS
+#define MAX_DIRECT_LIGHTS 8
+#endif
+
+// Must match LightClusters::CountX/Y/Z
+#define CLUSTERS_X 16
+#define CLUSTERS_Y 9
+#define CLUSTERS_Z 24
+
 struct Light
 {
-	float4 pos;
+	float4 pos; // w - cutoff radius
 	float4 color;
 };
 
 cbuffer SceneBuffer : register(b1)
 {
     float4x4 VP;
-	int4 lightParams;
-	Light lights[4];
+	int4 lightParams; // x - lights count
+	float4 clusterParams; // x, y - tile size in pixels, z, w - depth slice scale and bias
 }
 
 Texture2D ColorTexture : register(t0);
 Texture2D NormalTexture : register(t1);
 
+StructuredBuffer<Light> Lights : register(t2);
+Buffer<uint2> ClusterRanges : register(t3); // Offset and count in LightIndices
+Buffer<uint> LightIndices : register(t4);
+
 SamplerState Sampler : register(s0);
 
 struct VSInput
@@ -30,6 +50,22 @@ struct VSInput
 	float3 tangent : TANGENT;
 };
 
+struct VSInstancedInput
+{
+	float4 pos : POSITION;
+	float2 uv : TEXCOORD;
+	float3 normal : NORMAL;
+	float3 tangent : TANGENT;
+	float4 model0 : MODEL0;
+	float4 model1 : MODEL1;
+	float4 model2 : MODEL2;
+	float4 model3 : MODEL3;
+	float4 normal0 : NORMALMATRIX0;
+	float4 normal1 : NORMALMATRIX1;
+	float4 normal2 : NORMALMATRIX2;
+	float4 normal3 : NORMALMATRIX3;
+};
+
 struct VSOutput
 {
 	float4 pos : SV_Position;
@@ -52,40 +88,69 @@ VSOutput VS(in VSInput vertex)
 	return output;
 }
 
+VSOutput VSInstanced(in VSInstancedInput vertex)
+{
+	float4x4 instModelMatrix = transpose(float4x4(vertex.model0, vertex.model1, vertex.model2, vertex.model3));
+	float4x4 instNormalMatrix = transpose(float4x4(vertex.normal0, vertex.normal1, vertex.normal2, vertex.normal3));
+
+	VSOutput output;
+	float4 worldPos = mul(vertex.pos, instModelMatrix);
+	output.pos = mul(worldPos, VP);
+	output.worldPos = worldPos;
+	output.uv = vertex.uv;
+	output.normal = mul(vertex.normal, (float3x3)instNormalMatrix);
+	output.tangent = mul(vertex.tangent, (float3x3)instNormalMatrix);
+
+	return output;
+}
+
+float3 ShadeLight(Light light, float3 worldPos, float3 normal, float3 matColor)
+{
+	float3 l = light.pos.xyz - worldPos;
+	float dist = length(l);
+	l = l / dist;
+
+	float ndotl = max(dot(l, normal),0);
+	float atten = 1.0 / (0.2 + dist * dist);
+
+	return matColor * light.color.xyz * ndotl * atten;
+}
+
 float4 PS(in VSOutput input) : SV_Target0
 {
 	float4 color = float4(0,0,0,1);
 
-	int lightCount = lightParams.x;
-	int mode = lightParams.y;
-
 	float3 matColor = ColorTexture.Sample(Sampler, input.uv);
+
+#if NORMAL_MAP
 	float3 nm = (NormalTexture.Sample(Sampler, input.uv) - float3(0.5,0.5,0.5)) * 2.0;
-	
 	float3 binormal = cross(input.normal, input.tangent);
-	
-	float3 normal = float3(0,0,0);
-	if (mode == 0)
+	float3 normal = nm.x * input.tangent + nm.y * binormal + input.normal;
+#else
+	float3 normal = input.normal;
+#endif
+
+#if LIGHTS_CLUSTERED
+	// SV_Position.w is view space depth
+	uint3 cluster;
+	cluster.xy = min(uint2(input.pos.xy / clusterParams.xy), uint2(CLUSTERS_X - 1, CLUSTERS_Y - 1));
+	cluster.z = (uint)clamp(floor(log(input.pos.w) * clusterParams.z + clusterParams.w), 0, CLUSTERS_Z - 1);
+
+	uint2 range = ClusterRanges[(cluster.z * CLUSTERS_Y + cluster.y) * CLUSTERS_X + cluster.x];
+
+	for (uint i = 0; i < range.y; i++)
 	{
-		normal = nm.x * input.tangent + nm.y * binormal + input.normal;
+		color.xyz += ShadeLight(Lights[LightIndices[range.x + i]], input.worldPos.xyz, normal, matColor);
 	}
-	else
+#else
+	// Few lights, all of them are applied without cluster lookup
+	uint lightCount = min((uint)lightParams.x, MAX_DIRECT_LIGHTS);
+	for (uint i = 0; i < lightCount; i++)
 	{
-		normal = input.normal;
+		color.xyz += ShadeLight(Lights[i], input.worldPos.xyz, normal, matColor);
 	}
-	
-	for (int i = 0; i < lightCount; i++)
-	{
-		float3 l = lights[i].pos.xyz - input.worldPos.xyz;
-		float dist = length(l);		
-		l = l / dist;
-		
-		float ndotl = max(dot(l, normal),0);
-		float atten = 1.0 / (0.2 + dist * dist);
-	
-		color.xyz += matColor * lights[i].color.xyz * ndotl * atten;
-	}
-	
+#endif
+
 	//color.xyz = 0.5 * (normal + float3(1,1,1));
 
 	return color;
@@ -0,0 +1,167 @@
+#include "ConstantBufferRing.h"
+
+#include <assert.h>
+#include <string.h>
+
+// Constant buffer offsets are measured in 16-byte constants and must be multiples of 16 constants
+static const UINT ConstantSize = 16;
+static const UINT ConstantBufferAlignment = 256;
+
+#define SAFE_RELEASE(p) \
+if (p != NULL) { \
+	p->Release(); \
+	p = NULL;\
+}
+
+ConstantBufferRing::ConstantBufferRing()
+	: m_pBuffer(NULL)
+	, m_frameIndex(0)
+	, m_pMappedData(NULL)
+	, m_wasMapped(false)
+{
+	for (UINT i = 0; i < MaxFramesInFlight; i++)
+	{
+		m_pFrameQueries[i] = NULL;
+	}
+}
+
+HRESULT ConstantBufferRing::Init(IRenderDevice* pDevice, UINT size)
+{
+	size = (size + ConstantBufferAlignment - 1) & ~(ConstantBufferAlignment - 1);
+
+	// Device checks for D3D 11.1 offsets and no overwrite mapping of constant buffers
+	RenderBufferDesc cbDesc = { size, USAGE_DYNAMIC, BIND_CONSTANT_BUFFER, 0, FORMAT_UNKNOWN };
+
+	HRESULT result = pDevice->CreateBuffer(cbDesc, NULL, &m_pBuffer);
+	assert(SUCCEEDED(result));
+
+	for (UINT i = 0; i < MaxFramesInFlight && SUCCEEDED(result); i++)
+	{
+		result = pDevice->CreateQuery(QUERY_EVENT, &m_pFrameQueries[i]);
+		assert(SUCCEEDED(result));
+	}
+
+	if (SUCCEEDED(result))
+	{
+		m_allocator.Init(size, ConstantBufferAlignment);
+		m_frameIndex = 0;
+		m_wasMapped = false;
+	}
+
+	return result;
+}
+
+void ConstantBufferRing::Term()
+{
+	for (UINT i = 0; i < MaxFramesInFlight; i++)
+	{
+		SAFE_RELEASE(m_pFrameQueries[i]);
+	}
+	SAFE_RELEASE(m_pBuffer);
+
+	m_allocator.Reset();
+}
+
+HRESULT ConstantBufferRing::Map(IRenderContext* pContext)
+{
+	assert(m_pMappedData == NULL);
+
+	RetireFrames(pContext, false);
+
+	// Queries are reused every MaxFramesInFlight frames
+	while (m_allocator.HasPendingFrames() && m_frameIndex - m_allocator.GetOldestPendingFrame() >= MaxFramesInFlight)
+	{
+		if (!RetireFrames(pContext, true))
+		{
+			break;
+		}
+	}
+
+	// Discard the first time to tell driver that previous contents are not needed
+	void* pData = NULL;
+	HRESULT result = pContext->Map(m_pBuffer, m_wasMapped ? MAP_WRITE_NO_OVERWRITE : MAP_WRITE_DISCARD, &pData);
+	assert(SUCCEEDED(result));
+	if (SUCCEEDED(result))
+	{
+		m_pMappedData = (BYTE*)pData;
+		m_wasMapped = true;
+	}
+
+	return result;
+}
+
+bool ConstantBufferRing::Upload(IRenderContext* pContext, const void* pData, UINT size, ConstantBufferRange* pRange)
+{
+	assert(m_pMappedData != NULL);
+
+	size_t offset = m_allocator.Allocate(size);
+	while (offset == RingAllocator::InvalidOffset && m_allocator.HasPendingFrames())
+	{
+		// Ring is full, wait for GPU to finish with the oldest frame
+		if (!RetireFrames(pContext, true))
+		{
+			break;
+		}
+		offset = m_allocator.Allocate(size);
+	}
+	assert(offset != RingAllocator::InvalidOffset);
+	if (offset == RingAllocator::InvalidOffset)
+	{
+		return false;
+	}
+
+	memcpy(m_pMappedData + offset, pData, size);
+
+	UINT alignedSize = (size + ConstantBufferAlignment - 1) & ~(ConstantBufferAlignment - 1);
+	pRange->firstConstant = (UINT)(offset / ConstantSize);
+	pRange->numConstants = alignedSize / ConstantSize;
+
+	return true;
+}
+
+void ConstantBufferRing::Unmap(IRenderContext* pContext)
+{
+	assert(m_pMappedData != NULL);
+
+	pContext->Unmap(m_pBuffer);
+	m_pMappedData = NULL;
+}
+
+void ConstantBufferRing::EndFrame(IRenderContext* pContext)
+{
+	pContext->End(m_pFrameQueries[m_frameIndex % MaxFramesInFlight]);
+
+	m_allocator.FinishFrame(m_frameIndex);
+	m_frameIndex++;
+}
+
+bool ConstantBufferRing::RetireFrames(IRenderContext* pContext, bool waitOldest)
+{
+	bool retired = false;
+
+	while (m_allocator.HasPendingFrames())
+	{
+		UINT64 frame = m_allocator.GetOldestPendingFrame();
+		RenderQuery* pQuery = m_pFrameQueries[frame % MaxFramesInFlight];
+
+		bool done = false;
+		HRESULT result = S_FALSE;
+		do
+		{
+			result = pContext->GetData(pQuery, waitOldest, &done);
+		} while (waitOldest && result == S_FALSE);
+
+		if (result != S_OK || !done)
+		{
+			break;
+		}
+
+		m_allocator.ReleaseFrames(frame);
+		retired = true;
+
+		// Only the oldest frame is waited for, the rest are just polled
+		waitOldest = false;
+	}
+
+	return retired;
+}
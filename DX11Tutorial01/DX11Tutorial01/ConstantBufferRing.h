@@ -0,0 +1,49 @@
+#pragma once
+
+#include "RenderDevice.h"
+#include "RingAllocator.h"
+
+// Part of the ring buffer to bind with *SetConstantBuffers
+struct ConstantBufferRange
+{
+	UINT firstConstant;
+	UINT numConstants;
+};
+
+// One large dynamic constant buffer, sub-allocated per frame
+// Written with MAP_WRITE_NO_OVERWRITE, memory is reused only after event query of its frame is signaled
+class ConstantBufferRing
+{
+public:
+	ConstantBufferRing();
+
+	HRESULT Init(IRenderDevice* pDevice, UINT size);
+	void Term();
+
+	// Map buffer for uploads of the current frame
+	HRESULT Map(IRenderContext* pContext);
+	// Copy data into the ring, buffer must be mapped
+	bool Upload(IRenderContext* pContext, const void* pData, UINT size, ConstantBufferRange* pRange);
+	// Unmap buffer, must be called before draws which use uploaded data
+	void Unmap(IRenderContext* pContext);
+
+	// Mark end of the frame, call after all draws which use uploaded data
+	void EndFrame(IRenderContext* pContext);
+
+	RenderResource* GetBuffer() const { return m_pBuffer; }
+
+private:
+	static const UINT MaxFramesInFlight = 8;
+
+	bool RetireFrames(IRenderContext* pContext, bool waitOldest);
+
+private:
+	RenderResource* m_pBuffer;
+	RenderQuery* m_pFrameQueries[MaxFramesInFlight];
+
+	RingAllocator m_allocator;
+
+	UINT64 m_frameIndex;
+	BYTE* m_pMappedData;
+	bool m_wasMapped;
+};
@@ -0,0 +1,921 @@
+#include "D3D11RenderDevice.h"
+
+#include <assert.h>
+
+#include <vector>
+
+#include "DDSTextureLoader11.h"
+
+#define SAFE_RELEASE(p) \
+if (p != NULL) { \
+	p->Release(); \
+	p = NULL;\
+}
+
+// Object which owns one D3D11 interface
+template <class Base, class Native>
+class D3D11Object : public Base
+{
+public:
+	typedef Base BaseType;
+	typedef Native NativeType;
+
+	explicit D3D11Object(Native* pNative) : m_pNative(pNative) {}
+
+	virtual void Release()
+	{
+		m_pNative->Release();
+		delete this;
+	}
+
+	Native* GetNative() const { return m_pNative; }
+
+private:
+	Native* m_pNative;
+};
+
+typedef D3D11Object<RenderVertexShader, ID3D11VertexShader> D3D11VertexShader;
+typedef D3D11Object<RenderPixelShader, ID3D11PixelShader> D3D11PixelShader;
+typedef D3D11Object<RenderInputLayout, ID3D11InputLayout> D3D11InputLayout;
+typedef D3D11Object<RenderRasterizerState, ID3D11RasterizerState> D3D11RasterizerState;
+typedef D3D11Object<RenderBlendState, ID3D11BlendState> D3D11BlendState;
+typedef D3D11Object<RenderDepthStencilState, ID3D11DepthStencilState> D3D11DepthStencilState;
+typedef D3D11Object<RenderSamplerState, ID3D11SamplerState> D3D11SamplerState;
+typedef D3D11Object<RenderQuery, ID3D11Query> D3D11Query;
+typedef D3D11Object<RenderCommandList, ID3D11CommandList> D3D11CommandList;
+
+// Buffer or texture, views are NULL unless their bind flag was given
+class D3D11Resource : public RenderResource
+{
+public:
+	explicit D3D11Resource(ID3D11Resource* pResource)
+		: pResource(pResource)
+		, pSRV(NULL)
+		, pRTV(NULL)
+		, pDSV(NULL)
+	{
+	}
+
+	virtual void Release()
+	{
+		SAFE_RELEASE(pDSV);
+		SAFE_RELEASE(pRTV);
+		SAFE_RELEASE(pSRV);
+		SAFE_RELEASE(pResource);
+		delete this;
+	}
+
+	ID3D11Resource* pResource;
+	ID3D11ShaderResourceView* pSRV;
+	ID3D11RenderTargetView* pRTV;
+	ID3D11DepthStencilView* pDSV;
+};
+
+template <class Object>
+static typename Object::NativeType* GetNative(typename Object::BaseType* pObject)
+{
+	return pObject != NULL ? static_cast<Object*>(pObject)->GetNative() : NULL;
+}
+
+static ID3D11Resource* GetResource(RenderResource* pResource)
+{
+	return pResource != NULL ? static_cast<D3D11Resource*>(pResource)->pResource : NULL;
+}
+
+static ID3D11Buffer* GetBuffer(RenderResource* pResource)
+{
+	return (ID3D11Buffer*)GetResource(pResource);
+}
+
+static ID3D11ShaderResourceView* GetSRV(RenderResource* pResource)
+{
+	return pResource != NULL ? static_cast<D3D11Resource*>(pResource)->pSRV : NULL;
+}
+
+static ID3D11RenderTargetView* GetRTV(RenderResource* pResource)
+{
+	return pResource != NULL ? static_cast<D3D11Resource*>(pResource)->pRTV : NULL;
+}
+
+static ID3D11DepthStencilView* GetDSV(RenderResource* pResource)
+{
+	return pResource != NULL ? static_cast<D3D11Resource*>(pResource)->pDSV : NULL;
+}
+
+// Commands are passed through, object arrays are translated on the stack
+class D3D11RenderContext : public IRenderContext
+{
+public:
+	// Takes over the reference
+	explicit D3D11RenderContext(ID3D11DeviceContext1* pContext) : m_pContext(pContext) {}
+
+	virtual void Release()
+	{
+		m_pContext->Release();
+		delete this;
+	}
+
+	virtual void ClearState()
+	{
+		m_pContext->ClearState();
+	}
+
+	virtual void ClearRenderTargetView(RenderResource* pTarget, const float color[4])
+	{
+		m_pContext->ClearRenderTargetView(GetRTV(pTarget), color);
+	}
+
+	virtual void ClearDepthStencilView(RenderResource* pDepth, float depth)
+	{
+		m_pContext->ClearDepthStencilView(GetDSV(pDepth), D3D11_CLEAR_DEPTH, depth, 0);
+	}
+
+	virtual void IASetVertexBuffers(unsigned int startSlot, unsigned int count, RenderResource* const* ppBuffers, const unsigned int* pStrides, const unsigned int* pOffsets)
+	{
+		assert(count <= RenderMaxVertexBuffers);
+
+		ID3D11Buffer* buffers[RenderMaxVertexBuffers];
+		for (unsigned int i = 0; i < count; i++)
+		{
+			buffers[i] = GetBuffer(ppBuffers[i]);
+		}
+		m_pContext->IASetVertexBuffers(startSlot, count, buffers, pStrides, pOffsets);
+	}
+
+	virtual void IASetIndexBuffer(RenderResource* pBuffer, RenderFormat format, unsigned int offset)
+	{
+		m_pContext->IASetIndexBuffer(GetBuffer(pBuffer), (DXGI_FORMAT)format, offset);
+	}
+
+	virtual void IASetInputLayout(RenderInputLayout* pLayout)
+	{
+		m_pContext->IASetInputLayout(GetNative<D3D11InputLayout>(pLayout));
+	}
+
+	virtual void IASetPrimitiveTopology(RenderTopology topology)
+	{
+		m_pContext->IASetPrimitiveTopology((D3D11_PRIMITIVE_TOPOLOGY)topology);
+	}
+
+	virtual void VSSetShader(RenderVertexShader* pShader)
+	{
+		m_pContext->VSSetShader(GetNative<D3D11VertexShader>(pShader), NULL, 0);
+	}
+
+	virtual void VSSetConstantBuffers(unsigned int startSlot, unsigned int count, RenderResource* const* ppBuffers, const unsigned int* pFirstConstant, const unsigned int* pNumConstants)
+	{
+		assert(count <= RenderMaxConstantBuffers);
+
+		ID3D11Buffer* buffers[RenderMaxConstantBuffers];
+		for (unsigned int i = 0; i < count; i++)
+		{
+			buffers[i] = GetBuffer(ppBuffers[i]);
+		}
+		m_pContext->VSSetConstantBuffers1(startSlot, count, buffers, pFirstConstant, pNumConstants);
+	}
+
+	virtual void RSSetState(RenderRasterizerState* pState)
+	{
+		m_pContext->RSSetState(GetNative<D3D11RasterizerState>(pState));
+	}
+
+	virtual void RSSetViewport(const RenderViewport& viewport)
+	{
+		D3D11_VIEWPORT d3dViewport{ viewport.x, viewport.y, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth };
+		m_pContext->RSSetViewports(1, &d3dViewport);
+	}
+
+	virtual void RSSetScissorRect(const RenderRect& rect)
+	{
+		D3D11_RECT d3dRect{ rect.left, rect.top, rect.right, rect.bottom };
+		m_pContext->RSSetScissorRects(1, &d3dRect);
+	}
+
+	virtual void PSSetShader(RenderPixelShader* pShader)
+	{
+		m_pContext->PSSetShader(GetNative<D3D11PixelShader>(pShader), NULL, 0);
+	}
+
+	virtual void PSSetConstantBuffers(unsigned int startSlot, unsigned int count, RenderResource* const* ppBuffers, const unsigned int* pFirstConstant, const unsigned int* pNumConstants)
+	{
+		assert(count <= RenderMaxConstantBuffers);
+
+		ID3D11Buffer* buffers[RenderMaxConstantBuffers];
+		for (unsigned int i = 0; i < count; i++)
+		{
+			buffers[i] = GetBuffer(ppBuffers[i]);
+		}
+		m_pContext->PSSetConstantBuffers1(startSlot, count, buffers, pFirstConstant, pNumConstants);
+	}
+
+	virtual void PSSetShaderResources(unsigned int startSlot, unsigned int count, RenderResource* const* ppResources)
+	{
+		assert(count <= RenderMaxShaderResources);
+
+		ID3D11ShaderResourceView* views[RenderMaxShaderResources];
+		for (unsigned int i = 0; i < count; i++)
+		{
+			views[i] = GetSRV(ppResources[i]);
+		}
+		m_pContext->PSSetShaderResources(startSlot, count, views);
+	}
+
+	virtual void PSSetSamplers(unsigned int startSlot, unsigned int count, RenderSamplerState* const* ppSamplers)
+	{
+		assert(count <= RenderMaxSamplers);
+
+		ID3D11SamplerState* samplers[RenderMaxSamplers];
+		for (unsigned int i = 0; i < count; i++)
+		{
+			samplers[i] = GetNative<D3D11SamplerState>(ppSamplers[i]);
+		}
+		m_pContext->PSSetSamplers(startSlot, count, samplers);
+	}
+
+	virtual void OMSetRenderTargets(unsigned int count, RenderResource* const* ppTargets, RenderResource* pDepth)
+	{
+		assert(count <= RenderMaxRenderTargets);
+
+		ID3D11RenderTargetView* views[RenderMaxRenderTargets];
+		for (unsigned int i = 0; i < count; i++)
+		{
+			views[i] = GetRTV(ppTargets[i]);
+		}
+		m_pContext->OMSetRenderTargets(count, views, GetDSV(pDepth));
+	}
+
+	virtual void OMSetBlendState(RenderBlendState* pState)
+	{
+		m_pContext->OMSetBlendState(GetNative<D3D11BlendState>(pState), NULL, 0xFFFFFFFF);
+	}
+
+	virtual void OMSetDepthStencilState(RenderDepthStencilState* pState)
+	{
+		m_pContext->OMSetDepthStencilState(GetNative<D3D11DepthStencilState>(pState), 0);
+	}
+
+	virtual void Draw(unsigned int vertexCount, unsigned int startVertex)
+	{
+		m_pContext->Draw(vertexCount, startVertex);
+	}
+
+	virtual void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+	{
+		m_pContext->DrawIndexed(indexCount, startIndex, baseVertex);
+	}
+
+	virtual void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+	{
+		m_pContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	}
+
+	virtual HRESULT Map(RenderResource* pBuffer, RenderMap mapType, void** ppData)
+	{
+		D3D11_MAPPED_SUBRESOURCE subresource;
+		HRESULT result = m_pContext->Map(GetResource(pBuffer), 0, (D3D11_MAP)mapType, 0, &subresource);
+		if (SUCCEEDED(result))
+		{
+			*ppData = subresource.pData;
+		}
+
+		return result;
+	}
+
+	virtual void Unmap(RenderResource* pBuffer)
+	{
+		m_pContext->Unmap(GetResource(pBuffer), 0);
+	}
+
+	virtual void Begin(RenderQuery* pQuery)
+	{
+		m_pContext->Begin(GetNative<D3D11Query>(pQuery));
+	}
+
+	virtual void End(RenderQuery* pQuery)
+	{
+		m_pContext->End(GetNative<D3D11Query>(pQuery));
+	}
+
+	virtual HRESULT GetData(RenderQuery* pQuery, bool flush, bool* pDone)
+	{
+		BOOL done = FALSE;
+		HRESULT result = m_pContext->GetData(GetNative<D3D11Query>(pQuery), &done, sizeof(done), flush ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH);
+		*pDone = result == S_OK && done;
+
+		return result;
+	}
+
+	virtual HRESULT GetTimestamp(RenderQuery* pQuery, uint64_t* pTicks)
+	{
+		UINT64 ticks = 0;
+		HRESULT result = m_pContext->GetData(GetNative<D3D11Query>(pQuery), &ticks, sizeof(ticks), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+		*pTicks = ticks;
+
+		return result;
+	}
+
+	virtual HRESULT GetTimestampDisjoint(RenderQuery* pQuery, RenderTimestampDisjoint* pData)
+	{
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT data = {};
+		HRESULT result = m_pContext->GetData(GetNative<D3D11Query>(pQuery), &data, sizeof(data), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+		pData->frequency = data.Frequency;
+		pData->disjoint = data.Disjoint != FALSE;
+
+		return result;
+	}
+
+	virtual HRESULT FinishCommandList(RenderCommandList** ppList)
+	{
+		ID3D11CommandList* pCommandList = NULL;
+		HRESULT result = m_pContext->FinishCommandList(FALSE, &pCommandList);
+		if (SUCCEEDED(result))
+		{
+			*ppList = new D3D11CommandList(pCommandList);
+		}
+
+		return result;
+	}
+
+	virtual void ExecuteCommandList(RenderCommandList* pList)
+	{
+		m_pContext->ExecuteCommandList(GetNative<D3D11CommandList>(pList), FALSE);
+	}
+
+private:
+	ID3D11DeviceContext1* m_pContext;
+};
+
+D3D11RenderDevice::D3D11RenderDevice()
+	: m_pDevice(NULL)
+	, m_pDevice1(NULL)
+	, m_pContext(NULL)
+	, m_pSwapChain(NULL)
+	, m_pSwapChain2(NULL)
+	, m_frameLatencyWaitable(NULL)
+	, m_swapChainFlags(0)
+	, m_presentSync(PRESENT_SYNC_VSYNC)
+	, m_tearingSupported(false)
+	, m_maxFramesInFlight(DefaultMaxFramesInFlight)
+	, m_pBackBuffer(NULL)
+	, m_width(0)
+	, m_height(0)
+{
+}
+
+bool D3D11RenderDevice::Init(HWND hWnd)
+{
+	HRESULT result;
+
+	// Create a DirectX graphics interface factory.
+	IDXGIFactory* pFactory = NULL;
+	result = CreateDXGIFactory(__uuidof(IDXGIFactory), (void**)&pFactory);
+	assert(SUCCEEDED(result));
+
+	// Select hardware adapter, machines without one have to use a null device
+	IDXGIAdapter* pSelectedAdapter = NULL;
+	if (SUCCEEDED(result))
+	{
+		IDXGIAdapter* pAdapter = NULL;
+		UINT adapterIdx = 0;
+		while (SUCCEEDED(pFactory->EnumAdapters(adapterIdx, &pAdapter)))
+		{
+			DXGI_ADAPTER_DESC desc;
+			pAdapter->GetDesc(&desc);
+
+			if (wcscmp(desc.Description, L"Microsoft Basic Render Driver") != 0)
+			{
+				pSelectedAdapter = pAdapter;
+				break;
+			}
+
+			pAdapter->Release();
+
+			adapterIdx++;
+		}
+
+		if (pSelectedAdapter == NULL)
+		{
+			OutputDebugStringA("No hardware adapter found\n");
+			result = E_FAIL;
+		}
+	}
+
+	// Create DirectX 11 device
+	ID3D11DeviceContext* pContext = NULL;
+	if (SUCCEEDED(result))
+	{
+		D3D_FEATURE_LEVEL level;
+		D3D_FEATURE_LEVEL levels[] = { D3D_FEATURE_LEVEL_11_0 };
+		result = D3D11CreateDevice(pSelectedAdapter, D3D_DRIVER_TYPE_UNKNOWN, NULL,
+			D3D11_CREATE_DEVICE_DEBUG, levels, 1, D3D11_SDK_VERSION, &m_pDevice, &level, &pContext);
+		assert(SUCCEEDED(result));
+		assert(FAILED(result) || level == D3D_FEATURE_LEVEL_11_0);
+	}
+
+	// Constant buffer offsets need D3D 11.1 context interface
+	if (SUCCEEDED(result))
+	{
+		ID3D11DeviceContext1* pContext1 = NULL;
+		result = pContext->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&pContext1);
+		assert(SUCCEEDED(result));
+		if (SUCCEEDED(result))
+		{
+			m_pContext = new D3D11RenderContext(pContext1);
+		}
+	}
+	SAFE_RELEASE(pContext);
+	if (SUCCEEDED(result))
+	{
+		result = m_pDevice->QueryInterface(__uuidof(ID3D11Device1), (void**)&m_pDevice1);
+		assert(SUCCEEDED(result));
+	}
+
+	// Offsets and no overwrite mapping of constant buffers need D3D 11.1 runtime
+	if (SUCCEEDED(result))
+	{
+		D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+		result = m_pDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+		if (SUCCEEDED(result) && (!options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer))
+		{
+			result = E_NOTIMPL;
+		}
+		assert(SUCCEEDED(result));
+	}
+
+	// Tearing presents need DXGI 1.5 and a display which allows them
+	if (SUCCEEDED(result))
+	{
+		IDXGIFactory5* pFactory5 = NULL;
+		if (SUCCEEDED(pFactory->QueryInterface(__uuidof(IDXGIFactory5), (void**)&pFactory5)))
+		{
+			BOOL allowTearing = FALSE;
+			m_tearingSupported = SUCCEEDED(pFactory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allowTearing, sizeof(allowTearing)))
+				&& allowTearing;
+			pFactory5->Release();
+		}
+	}
+
+	// Create swapchain, the bitblt model is left where there is no flip discard
+	if (SUCCEEDED(result))
+	{
+		RECT rc;
+		GetClientRect(hWnd, &rc);
+		m_width = rc.right - rc.left;
+		m_height = rc.bottom - rc.top;
+
+		result = CreateSwapChain(pFactory, hWnd, true);
+		if (FAILED(result))
+		{
+			OutputDebugStringA("Flip model swap chain is not available, frames in flight are not waited for\n");
+			result = CreateSwapChain(pFactory, hWnd, false);
+		}
+		assert(SUCCEEDED(result));
+	}
+
+	if (SUCCEEDED(result))
+	{
+		result = SetMaxFramesInFlight(m_maxFramesInFlight);
+	}
+
+	if (SUCCEEDED(result))
+	{
+		result = CreateBackBuffer();
+	}
+
+	SAFE_RELEASE(pSelectedAdapter);
+	SAFE_RELEASE(pFactory);
+
+	if (FAILED(result))
+	{
+		Term();
+	}
+
+	return SUCCEEDED(result);
+}
+
+void D3D11RenderDevice::Term()
+{
+	SAFE_RELEASE(m_pBackBuffer);
+	if (m_frameLatencyWaitable != NULL)
+	{
+		CloseHandle(m_frameLatencyWaitable);
+		m_frameLatencyWaitable = NULL;
+	}
+	SAFE_RELEASE(m_pSwapChain2);
+	SAFE_RELEASE(m_pSwapChain);
+	SAFE_RELEASE(m_pContext);
+	SAFE_RELEASE(m_pDevice1);
+	SAFE_RELEASE(m_pDevice);
+}
+
+HRESULT D3D11RenderDevice::CreateSwapChain(IDXGIFactory* pFactory, HWND hWnd, bool flipModel)
+{
+	m_swapChainFlags = 0;
+	if (flipModel)
+	{
+		m_swapChainFlags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT | (m_tearingSupported ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0);
+	}
+
+	DXGI_SWAP_CHAIN_DESC swapChainDesc = { 0 };
+	swapChainDesc.BufferCount = 2;
+	swapChainDesc.BufferDesc.Width = m_width;
+	swapChainDesc.BufferDesc.Height = m_height;
+	swapChainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	swapChainDesc.BufferDesc.RefreshRate.Numerator = 0;
+	swapChainDesc.BufferDesc.RefreshRate.Denominator = 1;
+	swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+	swapChainDesc.OutputWindow = hWnd;
+	swapChainDesc.SampleDesc.Count = 1;
+	swapChainDesc.SampleDesc.Quality = 0;
+	swapChainDesc.Windowed = true;
+	swapChainDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
+	swapChainDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
+	swapChainDesc.SwapEffect = flipModel ? DXGI_SWAP_EFFECT_FLIP_DISCARD : DXGI_SWAP_EFFECT_DISCARD;
+	swapChainDesc.Flags = m_swapChainFlags;
+
+	HRESULT result = pFactory->CreateSwapChain(m_pDevice, &swapChainDesc, &m_pSwapChain);
+	if (SUCCEEDED(result) && flipModel)
+	{
+		result = m_pSwapChain->QueryInterface(__uuidof(IDXGISwapChain2), (void**)&m_pSwapChain2);
+		if (FAILED(result))
+		{
+			SAFE_RELEASE(m_pSwapChain);
+		}
+	}
+
+	return result;
+}
+
+HRESULT D3D11RenderDevice::SetMaxFramesInFlight(unsigned int count)
+{
+	if (count < 1 || count > 16)
+	{
+		return E_INVALIDARG;
+	}
+
+	HRESULT result = S_OK;
+	if (m_pSwapChain2 != NULL)
+	{
+		// Waitable object is signaled as frames leave the queue, it follows the new count
+		result = m_pSwapChain2->SetMaximumFrameLatency(count);
+		if (SUCCEEDED(result) && m_frameLatencyWaitable == NULL)
+		{
+			m_frameLatencyWaitable = m_pSwapChain2->GetFrameLatencyWaitableObject();
+		}
+	}
+	else
+	{
+		IDXGIDevice1* pDXGIDevice = NULL;
+		result = m_pDevice->QueryInterface(__uuidof(IDXGIDevice1), (void**)&pDXGIDevice);
+		if (SUCCEEDED(result))
+		{
+			result = pDXGIDevice->SetMaximumFrameLatency(count);
+			pDXGIDevice->Release();
+		}
+	}
+
+	if (SUCCEEDED(result))
+	{
+		m_maxFramesInFlight = count;
+	}
+
+	return result;
+}
+
+bool D3D11RenderDevice::WaitForFrame(unsigned int timeoutMs)
+{
+	return m_frameLatencyWaitable == NULL || WaitForSingleObjectEx(m_frameLatencyWaitable, timeoutMs, TRUE) == WAIT_OBJECT_0;
+}
+
+HRESULT D3D11RenderDevice::CreateBackBuffer()
+{
+	ID3D11Texture2D* pBackBuffer = NULL;
+	HRESULT result = m_pSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (LPVOID*)&pBackBuffer);
+	assert(SUCCEEDED(result));
+	if (SUCCEEDED(result))
+	{
+		D3D11Resource* pResource = new D3D11Resource(pBackBuffer);
+
+		result = m_pDevice->CreateRenderTargetView(pBackBuffer, NULL, &pResource->pRTV);
+		assert(SUCCEEDED(result));
+
+		if (SUCCEEDED(result))
+		{
+			m_pBackBuffer = pResource;
+		}
+		else
+		{
+			pResource->Release();
+		}
+	}
+
+	return result;
+}
+
+HRESULT D3D11RenderDevice::ResizeBackBuffer(unsigned int width, unsigned int height)
+{
+	// Swap chain buffers can not be referenced by anything, bound views included
+	m_pContext->ClearState();
+	SAFE_RELEASE(m_pBackBuffer);
+
+	HRESULT result = m_pSwapChain->ResizeBuffers(2, width, height, DXGI_FORMAT_R8G8B8A8_UNORM, m_swapChainFlags);
+	if (SUCCEEDED(result))
+	{
+		m_width = width;
+		m_height = height;
+
+		result = CreateBackBuffer();
+	}
+
+	return result;
+}
+
+HRESULT D3D11RenderDevice::Present()
+{
+	bool tearing = m_presentSync == PRESENT_SYNC_TEARING && (m_swapChainFlags & DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING) != 0;
+	return m_pSwapChain->Present(m_presentSync == PRESENT_SYNC_VSYNC ? 1 : 0, tearing ? DXGI_PRESENT_ALLOW_TEARING : 0);
+}
+
+HRESULT D3D11RenderDevice::CreateBuffer(const RenderBufferDesc& desc, const void* pData, RenderResource** ppBuffer)
+{
+	bool view = (desc.bindFlags & BIND_SHADER_RESOURCE) != 0;
+	bool structured = view && desc.viewFormat == FORMAT_UNKNOWN;
+
+	D3D11_BUFFER_DESC bufferDesc = { 0 };
+	bufferDesc.ByteWidth = desc.size;
+	bufferDesc.Usage = (D3D11_USAGE)desc.usage;
+	bufferDesc.BindFlags = desc.bindFlags;
+	bufferDesc.CPUAccessFlags = desc.usage == USAGE_DYNAMIC ? D3D11_CPU_ACCESS_WRITE : 0;
+	bufferDesc.MiscFlags = structured ? D3D11_RESOURCE_MISC_BUFFER_STRUCTURED : 0;
+	bufferDesc.StructureByteStride = structured ? desc.stride : 0;
+
+	D3D11_SUBRESOURCE_DATA data = { 0 };
+	data.pSysMem = pData;
+	data.SysMemPitch = 0;
+	data.SysMemSlicePitch = 0;
+
+	ID3D11Buffer* pBuffer = NULL;
+	HRESULT result = m_pDevice->CreateBuffer(&bufferDesc, pData != NULL ? &data : NULL, &pBuffer);
+	if (FAILED(result))
+	{
+		return result;
+	}
+
+	D3D11Resource* pResource = new D3D11Resource(pBuffer);
+	if (view)
+	{
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = (DXGI_FORMAT)desc.viewFormat;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = desc.size / desc.stride;
+
+		result = m_pDevice->CreateShaderResourceView(pBuffer, &srvDesc, &pResource->pSRV);
+	}
+
+	if (SUCCEEDED(result))
+	{
+		*ppBuffer = pResource;
+	}
+	else
+	{
+		pResource->Release();
+	}
+
+	return result;
+}
+
+HRESULT D3D11RenderDevice::CreateTexture(const RenderTextureDesc& desc, const void* pData, unsigned int rowPitch, RenderResource** ppTexture)
+{
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = desc.width;
+	textureDesc.Height = desc.height;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = (DXGI_FORMAT)desc.format;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = (D3D11_USAGE)desc.usage;
+	textureDesc.BindFlags = desc.bindFlags;
+	textureDesc.CPUAccessFlags = desc.usage == USAGE_DYNAMIC ? D3D11_CPU_ACCESS_WRITE : 0;
+	textureDesc.MiscFlags = 0;
+
+	D3D11_SUBRESOURCE_DATA data = { pData, rowPitch, rowPitch * desc.height };
+
+	ID3D11Texture2D* pTexture = NULL;
+	HRESULT result = m_pDevice->CreateTexture2D(&textureDesc, pData != NULL ? &data : NULL, &pTexture);
+	if (FAILED(result))
+	{
+		return result;
+	}
+
+	D3D11Resource* pResource = new D3D11Resource(pTexture);
+	if (SUCCEEDED(result) && (desc.bindFlags & BIND_SHADER_RESOURCE) != 0)
+	{
+		result = m_pDevice->CreateShaderResourceView(pTexture, NULL, &pResource->pSRV);
+	}
+	if (SUCCEEDED(result) && (desc.bindFlags & BIND_RENDER_TARGET) != 0)
+	{
+		result = m_pDevice->CreateRenderTargetView(pTexture, NULL, &pResource->pRTV);
+	}
+	if (SUCCEEDED(result) && (desc.bindFlags & BIND_DEPTH_STENCIL) != 0)
+	{
+		result = m_pDevice->CreateDepthStencilView(pTexture, NULL, &pResource->pDSV);
+	}
+
+	if (SUCCEEDED(result))
+	{
+		*ppTexture = pResource;
+	}
+	else
+	{
+		pResource->Release();
+	}
+
+	return result;
+}
+
+HRESULT D3D11RenderDevice::CreateTexture(const TextureData& data, RenderResource** ppTexture)
+{
+	ID3D11Resource* pTexture = NULL;
+	ID3D11ShaderResourceView* pTextureSRV = NULL;
+	HRESULT result = DirectX::CreateDDSTextureFromTextureData(m_pDevice, data,
+		D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE, 0, 0, false, &pTexture, &pTextureSRV);
+	if (SUCCEEDED(result))
+	{
+		D3D11Resource* pResource = new D3D11Resource(pTexture);
+		pResource->pSRV = pTextureSRV;
+
+		*ppTexture = pResource;
+	}
+
+	return result;
+}
+
+HRESULT D3D11RenderDevice::CreateVertexShader(const void* pBytecode, size_t size, RenderVertexShader** ppShader)
+{
+	ID3D11VertexShader* pShader = NULL;
+	HRESULT result = m_pDevice->CreateVertexShader(pBytecode, size, NULL, &pShader);
+	if (SUCCEEDED(result))
+	{
+		*ppShader = new D3D11VertexShader(pShader);
+	}
+
+	return result;
+}
+
+HRESULT D3D11RenderDevice::CreatePixelShader(const void* pBytecode, size_t size, RenderPixelShader** ppShader)
+{
+	ID3D11PixelShader* pShader = NULL;
+	HRESULT result = m_pDevice->CreatePixelShader(pBytecode, size, NULL, &pShader);
+	if (SUCCEEDED(result))
+	{
+		*ppShader = new D3D11PixelShader(pShader);
+	}
+
+	return result;
+}
+
+HRESULT D3D11RenderDevice::CreateInputLayout(const RenderInputElement* pElements, unsigned int count, const void* pBytecode, size_t size, RenderInputLayout** ppLayout)
+{
+	std::vector<D3D11_INPUT_ELEMENT_DESC> elements(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const RenderInputElement& element = pElements[i];
+		elements[i] = D3D11_INPUT_ELEMENT_DESC{ element.semanticName, element.semanticIndex, (DXGI_FORMAT)element.format, element.slot, element.offset,
+			element.perInstance ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA, element.perInstance ? 1u : 0u };
+	}
+
+	ID3D11InputLayout* pLayout = NULL;
+	HRESULT result = m_pDevice->CreateInputLayout(elements.data(), count, pBytecode, size, &pLayout);
+	if (SUCCEEDED(result))
+	{
+		*ppLayout = new D3D11InputLayout(pLayout);
+	}
+
+	return result;
+}
+
+HRESULT D3D11RenderDevice::CreateRasterizerState(const RenderRasterizerDesc& desc, RenderRasterizerState** ppState)
+{
+	D3D11_RASTERIZER_DESC rasterizerDesc;
+	rasterizerDesc.FillMode = D3D11_FILL_SOLID;
+	rasterizerDesc.CullMode = (D3D11_CULL_MODE)desc.cullMode;
+	rasterizerDesc.FrontCounterClockwise = FALSE;
+	rasterizerDesc.DepthBias = 0;
+	rasterizerDesc.SlopeScaledDepthBias = 0.0f;
+	rasterizerDesc.DepthBiasClamp = 0.0f;
+	rasterizerDesc.DepthClipEnable = TRUE;
+	rasterizerDesc.ScissorEnable = FALSE;
+	rasterizerDesc.MultisampleEnable = FALSE;
+	rasterizerDesc.AntialiasedLineEnable = FALSE;
+
+	ID3D11RasterizerState* pState = NULL;
+	HRESULT result = m_pDevice->CreateRasterizerState(&rasterizerDesc, &pState);
+	if (SUCCEEDED(result))
+	{
+		*ppState = new D3D11RasterizerState(pState);
+	}
+
+	return result;
+}
+
+HRESULT D3D11RenderDevice::CreateBlendState(const RenderBlendDesc& desc, RenderBlendState** ppState)
+{
+	D3D11_BLEND_DESC blendDesc = { 0 };
+	blendDesc.IndependentBlendEnable = desc.independentBlendEnable;
+	for (unsigned int i = 0; i < RenderMaxRenderTargets; i++)
+	{
+		const RenderTargetBlendDesc& target = desc.renderTarget[i];
+		D3D11_RENDER_TARGET_BLEND_DESC& d3dTarget = blendDesc.RenderTarget[i];
+
+		// Disabled targets get the default factors, so the desc is valid
+		d3dTarget.BlendEnable = target.blendEnable;
+		d3dTarget.SrcBlend = target.blendEnable ? (D3D11_BLEND)target.srcBlend : D3D11_BLEND_ONE;
+		d3dTarget.DestBlend = target.blendEnable ? (D3D11_BLEND)target.destBlend : D3D11_BLEND_ZERO;
+		d3dTarget.BlendOp = D3D11_BLEND_OP_ADD;
+		d3dTarget.SrcBlendAlpha = target.blendEnable ? (D3D11_BLEND)target.srcBlendAlpha : D3D11_BLEND_ONE;
+		d3dTarget.DestBlendAlpha = target.blendEnable ? (D3D11_BLEND)target.destBlendAlpha : D3D11_BLEND_ZERO;
+		d3dTarget.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+		d3dTarget.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	}
+
+	ID3D11BlendState* pState = NULL;
+	HRESULT result = m_pDevice->CreateBlendState(&blendDesc, &pState);
+	if (SUCCEEDED(result))
+	{
+		*ppState = new D3D11BlendState(pState);
+	}
+
+	return result;
+}
+
+HRESULT D3D11RenderDevice::CreateDepthStencilState(const RenderDepthStencilDesc& desc, RenderDepthStencilState** ppState)
+{
+	D3D11_DEPTH_STENCIL_DESC dsDesc = { 0 };
+	dsDesc.DepthEnable = desc.depthEnable;
+	dsDesc.DepthWriteMask = desc.depthWrite ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
+	dsDesc.DepthFunc = (D3D11_COMPARISON_FUNC)desc.depthFunc;
+	dsDesc.StencilEnable = FALSE;
+
+	ID3D11DepthStencilState* pState = NULL;
+	HRESULT result = m_pDevice->CreateDepthStencilState(&dsDesc, &pState);
+	if (SUCCEEDED(result))
+	{
+		*ppState = new D3D11DepthStencilState(pState);
+	}
+
+	return result;
+}
+
+HRESULT D3D11RenderDevice::CreateSamplerState(const RenderSamplerDesc& desc, RenderSamplerState** ppState)
+{
+	D3D11_SAMPLER_DESC samplerDesc = {};
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.MinLOD = 0;
+	samplerDesc.MaxLOD = 1000;
+	samplerDesc.Filter = (D3D11_FILTER)desc.filter;
+	samplerDesc.MaxAnisotropy = desc.maxAnisotropy;
+
+	ID3D11SamplerState* pState = NULL;
+	HRESULT result = m_pDevice->CreateSamplerState(&samplerDesc, &pState);
+	if (SUCCEEDED(result))
+	{
+		*ppState = new D3D11SamplerState(pState);
+	}
+
+	return result;
+}
+
+HRESULT D3D11RenderDevice::CreateQuery(RenderQueryType type, RenderQuery** ppQuery)
+{
+	D3D11_QUERY_DESC queryDesc = { (D3D11_QUERY)type, 0 };
+
+	ID3D11Query* pQuery = NULL;
+	HRESULT result = m_pDevice->CreateQuery(&queryDesc, &pQuery);
+	if (SUCCEEDED(result))
+	{
+		*ppQuery = new D3D11Query(pQuery);
+	}
+
+	return result;
+}
+
+HRESULT D3D11RenderDevice::CreateDeferredContext(IRenderContext** ppContext)
+{
+	ID3D11DeviceContext1* pContext = NULL;
+	HRESULT result = m_pDevice1->CreateDeferredContext1(0, &pContext);
+	if (SUCCEEDED(result))
+	{
+		*ppContext = new D3D11RenderContext(pContext);
+	}
+
+	return result;
+}
+
+IRenderContext* D3D11RenderDevice::GetImmediateContext()
+{
+	return m_pContext;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <d3d11_1.h>
+#include <dxgi1_5.h>
+
+#include "D3DShaderCompiler.h"
+#include "DDSTextureParser.h"
+#include "RenderDevice.h"
+
+class D3D11RenderContext;
+
+enum PresentSync
+{
+	PRESENT_SYNC_VSYNC = 0, // Waits for vertical blank
+	PRESENT_SYNC_OFF,       // Presents at once, flip model shows the latest frame without tearing
+	PRESENT_SYNC_TEARING,   // Presents at once and may tear, as PRESENT_SYNC_OFF where tearing is not supported
+	PRESENT_SYNC_COUNT
+};
+
+// D3D 11.1 device on the first hardware adapter with a swap chain for the window
+// Swap chain uses the flip model with a frame latency waitable object where DXGI has them
+class D3D11RenderDevice : public IRenderDevice
+{
+public:
+	static const unsigned int DefaultMaxFramesInFlight = 2;
+
+	D3D11RenderDevice();
+
+	// Fails if there is no hardware adapter or it lacks the D3D 11.1 features the renderer needs
+	bool Init(HWND hWnd);
+	void Term();
+
+	virtual const char* GetName() const { return "D3D11"; }
+
+	virtual HRESULT CreateBuffer(const RenderBufferDesc& desc, const void* pData, RenderResource** ppBuffer);
+	virtual HRESULT CreateTexture(const RenderTextureDesc& desc, const void* pData, unsigned int rowPitch, RenderResource** ppTexture);
+	virtual HRESULT CreateTexture(const TextureData& data, RenderResource** ppTexture);
+
+	virtual HRESULT CreateVertexShader(const void* pBytecode, size_t size, RenderVertexShader** ppShader);
+	virtual HRESULT CreatePixelShader(const void* pBytecode, size_t size, RenderPixelShader** ppShader);
+	virtual HRESULT CreateInputLayout(const RenderInputElement* pElements, unsigned int count, const void* pBytecode, size_t size, RenderInputLayout** ppLayout);
+
+	virtual HRESULT CreateRasterizerState(const RenderRasterizerDesc& desc, RenderRasterizerState** ppState);
+	virtual HRESULT CreateBlendState(const RenderBlendDesc& desc, RenderBlendState** ppState);
+	virtual HRESULT CreateDepthStencilState(const RenderDepthStencilDesc& desc, RenderDepthStencilState** ppState);
+	virtual HRESULT CreateSamplerState(const RenderSamplerDesc& desc, RenderSamplerState** ppState);
+	virtual HRESULT CreateQuery(RenderQueryType type, RenderQuery** ppQuery);
+
+	virtual HRESULT CreateDeferredContext(IRenderContext** ppContext);
+	virtual IRenderContext* GetImmediateContext();
+
+	virtual RenderResource* GetBackBuffer() { return m_pBackBuffer; }
+	virtual unsigned int GetBackBufferWidth() const { return m_width; }
+	virtual unsigned int GetBackBufferHeight() const { return m_height; }
+	virtual HRESULT ResizeBackBuffer(unsigned int width, unsigned int height);
+	virtual HRESULT Present();
+
+	virtual IShaderCompiler* GetShaderCompiler() { return &m_shaderCompiler; }
+	virtual ITextureParser* GetTextureParser() { return &m_textureParser; }
+	virtual const char* GetShaderCacheDirectory() const { return "ShaderCache"; }
+
+	void SetPresentSync(PresentSync sync) { m_presentSync = sync; }
+	PresentSync GetPresentSync() const { return m_presentSync; }
+	bool IsTearingSupported() const { return m_tearingSupported; }
+
+	// Frames the CPU may queue ahead of the display, 1 has the lowest latency
+	HRESULT SetMaxFramesInFlight(unsigned int count);
+	unsigned int GetMaxFramesInFlight() const { return m_maxFramesInFlight; }
+	// Blocks until a frame started now stays within the frames in flight, call before reading input of the frame
+	// Returns false on timeout, it returns at once without a waitable swap chain
+	bool WaitForFrame(unsigned int timeoutMs);
+
+private:
+	HRESULT CreateSwapChain(IDXGIFactory* pFactory, HWND hWnd, bool flipModel);
+	HRESULT CreateBackBuffer();
+
+private:
+	ID3D11Device* m_pDevice;
+	ID3D11Device1* m_pDevice1;
+	D3D11RenderContext* m_pContext;
+	IDXGISwapChain* m_pSwapChain;
+	IDXGISwapChain2* m_pSwapChain2;   // Flip model swap chain only
+	HANDLE m_frameLatencyWaitable;    // Of the flip model swap chain, NULL otherwise
+	UINT m_swapChainFlags;
+	PresentSync m_presentSync;
+	bool m_tearingSupported;
+	unsigned int m_maxFramesInFlight;
+
+	RenderResource* m_pBackBuffer;
+	unsigned int m_width;
+	unsigned int m_height;
+
+	D3DShaderCompiler m_shaderCompiler;
+	DDSTextureParser m_textureParser;
+};
@@ -0,0 +1,41 @@
+#include "D3DShaderCompiler.h"
+
+#include <d3dcompiler.h>
+
+#define SAFE_RELEASE(p) \
+if (p != NULL) { \
+	p->Release(); \
+	p = NULL;\
+}
+
+bool D3DShaderCompiler::Compile(const ShaderRequest& request, std::vector<uint8_t>& bytecode, std::string& errors)
+{
+	// Macro list is terminated by a NULL entry
+	std::vector<D3D_SHADER_MACRO> macros;
+	for (const ShaderDefine& define : request.defines)
+	{
+		D3D_SHADER_MACRO macro = { define.name.c_str(), define.value.c_str() };
+		macros.push_back(macro);
+	}
+	D3D_SHADER_MACRO last = { NULL, NULL };
+	macros.push_back(last);
+
+	ID3DBlob* pBlob = NULL;
+	ID3DBlob* pError = NULL;
+	HRESULT result = D3DCompile(request.source.data(), request.source.size(), "", macros.data(), NULL,
+		request.entryPoint.c_str(), request.profile.c_str(), request.flags, 0, &pBlob, &pError);
+	if (SUCCEEDED(result))
+	{
+		const uint8_t* pData = (const uint8_t*)pBlob->GetBufferPointer();
+		bytecode.assign(pData, pData + pBlob->GetBufferSize());
+	}
+	else if (pError != NULL)
+	{
+		errors.assign((const char*)pError->GetBufferPointer(), pError->GetBufferSize());
+	}
+
+	SAFE_RELEASE(pError);
+	SAFE_RELEASE(pBlob);
+
+	return SUCCEEDED(result);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "ShaderCache.h"
+
+// Compiles shaders with D3DCompile, includes are not supported
+class D3DShaderCompiler : public IShaderCompiler
+{
+public:
+	virtual bool Compile(const ShaderRequest& request, std::vector<uint8_t>& bytecode, std::string& errors);
+};
@@ -16,10 +16,16 @@
 
 #include "DDSTextureLoader11.h"
 
+#include "LegacyFormats.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <memory>
 #include <new>
+#include <vector>
 
 #ifdef __clang__
 #pragma clang diagnostic ignored "-Wcovered-switch-default"
@@ -118,12 +124,6 @@ struct DDS_HEADER_DXT10
 //--------------------------------------------------------------------------------------
 namespace
 {
-    struct handle_closer { void operator()(HANDLE h) noexcept { if (h) CloseHandle(h); } };
-
-    using ScopedHandle = std::unique_ptr<void, handle_closer>;
-
-    inline HANDLE safe_handle(HANDLE h) noexcept { return (h == INVALID_HANDLE_VALUE) ? nullptr : h; }
-
     template<UINT TNameLength>
     inline void SetDebugObjectName(_In_ ID3D11DeviceChild* resource, _In_ const char(&name)[TNameLength]) noexcept
     {
@@ -203,9 +203,21 @@ namespace
 
 
     //--------------------------------------------------------------------------------------
+    // Define DDS_LOADER_READ_FILE to read whole files into a buffer instead of mapping them,
+    // to compare the two
+#ifdef DDS_LOADER_READ_FILE
+    const FileAccess DDSFileAccess = FILE_ACCESS_READ;
+#else
+    const FileAccess DDSFileAccess = FILE_ACCESS_MAP;
+#endif
+
+
+    //--------------------------------------------------------------------------------------
+    // The file is mapped rather than read, so header and bit data point straight into the
+    // mapping and stay valid while ddsFile is open
     HRESULT LoadTextureDataFromFile(
         _In_z_ const wchar_t* fileName,
-        std::unique_ptr<uint8_t[]>& ddsData,
+        MappedFile& ddsFile,
         const DDS_HEADER** header,
         const uint8_t** bitData,
         size_t* bitSize) noexcept
@@ -217,114 +229,23 @@ namespace
 
         *bitSize = 0;
 
-        // open the file
-#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
-        ScopedHandle hFile(safe_handle(CreateFile2(fileName,
-            GENERIC_READ,
-            FILE_SHARE_READ,
-            OPEN_EXISTING,
-            nullptr)));
-#else
-        ScopedHandle hFile(safe_handle(CreateFileW(fileName,
-            GENERIC_READ,
-            FILE_SHARE_READ,
-            nullptr,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
-            nullptr)));
-#endif
-
-        if (!hFile)
-        {
-            return HRESULT_FROM_WIN32(GetLastError());
-        }
-
-        // Get the file size
-        FILE_STANDARD_INFO fileInfo;
-        if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
-        {
-            return HRESULT_FROM_WIN32(GetLastError());
-        }
-
-        // File is too big for 32-bit allocation, so reject read
-        if (fileInfo.EndOfFile.HighPart > 0)
-        {
-            return E_FAIL;
-        }
-
-        // Need at least enough data to fill the header and magic number to be a valid DDS
-        if (fileInfo.EndOfFile.LowPart < (sizeof(uint32_t) + sizeof(DDS_HEADER)))
-        {
-            return E_FAIL;
-        }
-
-        // create enough space for the file data
-        ddsData.reset(new (std::nothrow) uint8_t[fileInfo.EndOfFile.LowPart]);
-        if (!ddsData)
-        {
-            return E_OUTOFMEMORY;
-        }
-
-        // read the data in
-        DWORD bytesRead = 0;
-        if (!ReadFile(hFile.get(),
-            ddsData.get(),
-            fileInfo.EndOfFile.LowPart,
-            &bytesRead,
-            nullptr
-        ))
-        {
-            ddsData.reset();
-            return HRESULT_FROM_WIN32(GetLastError());
-        }
-
-        if (bytesRead < fileInfo.EndOfFile.LowPart)
-        {
-            ddsData.reset();
-            return E_FAIL;
-        }
-
-        // DDS files always start with the same magic number ("DDS ")
-        auto dwMagicNumber = *reinterpret_cast<const uint32_t*>(ddsData.get());
-        if (dwMagicNumber != DDS_MAGIC)
-        {
-            ddsData.reset();
-            return E_FAIL;
-        }
-
-        auto hdr = reinterpret_cast<const DDS_HEADER*>(ddsData.get() + sizeof(uint32_t));
-
-        // Verify header to validate DDS file
-        if (hdr->size != sizeof(DDS_HEADER) ||
-            hdr->ddspf.size != sizeof(DDS_PIXELFORMAT))
+        if (!ddsFile.Open(fileName, DDSFileAccess))
         {
-            ddsData.reset();
-            return E_FAIL;
+            return HRESULT_FROM_WIN32(ddsFile.GetError());
         }
 
-        // Check for DX10 extension
-        bool bDXT10Header = false;
-        if ((hdr->ddspf.flags & DDS_FOURCC) &&
-            (MAKEFOURCC('D', 'X', '1', '0') == hdr->ddspf.fourCC))
+        HRESULT hr = LoadTextureDataFromMemory(ddsFile.GetData(),
+            ddsFile.GetSize(),
+            header,
+            bitData,
+            bitSize
+        );
+        if (FAILED(hr))
         {
-            // Must be long enough for both headers and magic value
-            if (fileInfo.EndOfFile.LowPart < (sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10)))
-            {
-                ddsData.reset();
-                return E_FAIL;
-            }
-
-            bDXT10Header = true;
+            ddsFile.Close();
         }
 
-        // setup the pointers in the process request
-        *header = hdr;
-        auto offset = sizeof(uint32_t) + sizeof(DDS_HEADER)
-            + (bDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
-        *bitData = ddsData.get() + offset;
-        *bitSize = fileInfo.EndOfFile.LowPart - offset;
-
-        return S_OK;
+        return hr;
     }
 
 
@@ -871,6 +792,55 @@ namespace
         return DXGI_FORMAT_UNKNOWN;
     }
 
+    //--------------------------------------------------------------------------------------
+    // Formats GetDXGIFormat rejects which are converted to a DXGI format on load
+    LegacyFormat GetLegacyFormat(const DDS_PIXELFORMAT& ddpf, DXGI_FORMAT& format) noexcept
+    {
+        format = DXGI_FORMAT_UNKNOWN;
+
+        if (ddpf.flags & DDS_RGB)
+        {
+            switch (ddpf.RGBBitCount)
+            {
+            case 32:
+                if (ISBITMASK(0x000000ff, 0x0000ff00, 0x00ff0000, 0))
+                {
+                    format = DXGI_FORMAT_R8G8B8A8_UNORM;
+                    return LEGACY_FORMAT_X8B8G8R8;
+                }
+                break;
+
+            case 24:
+                if (ISBITMASK(0x00ff0000, 0x0000ff00, 0x000000ff, 0))
+                {
+                    format = DXGI_FORMAT_R8G8B8A8_UNORM;
+                    return LEGACY_FORMAT_R8G8B8;
+                }
+                if (ISBITMASK(0x000000ff, 0x0000ff00, 0x00ff0000, 0))
+                {
+                    format = DXGI_FORMAT_R8G8B8A8_UNORM;
+                    return LEGACY_FORMAT_B8G8R8;
+                }
+                break;
+
+            case 16:
+                if (ISBITMASK(0x7c00, 0x03e0, 0x001f, 0))
+                {
+                    format = DXGI_FORMAT_B5G5R5A1_UNORM;
+                    return LEGACY_FORMAT_X1R5G5B5;
+                }
+                if (ISBITMASK(0x0f00, 0x00f0, 0x000f, 0))
+                {
+                    format = DXGI_FORMAT_B4G4R4A4_UNORM;
+                    return LEGACY_FORMAT_X4R4G4B4;
+                }
+                break;
+            }
+        }
+
+        return LEGACY_FORMAT_NONE;
+    }
+
 #undef ISBITMASK
 
 
@@ -1239,33 +1209,29 @@ namespace
     }
 
     //--------------------------------------------------------------------------------------
-    HRESULT CreateTextureFromDDS(
-        _In_ ID3D11Device* d3dDevice,
-        _In_opt_ ID3D11DeviceContext* d3dContext,
+    HRESULT GetResourceInfo(
         _In_ const DDS_HEADER* header,
-        _In_reads_bytes_(bitSize) const uint8_t* bitData,
-        _In_ size_t bitSize,
-        _In_ size_t maxsize,
-        _In_ D3D11_USAGE usage,
-        _In_ unsigned int bindFlags,
-        _In_ unsigned int cpuAccessFlags,
-        _In_ unsigned int miscFlags,
-        _In_ bool forceSRGB,
-        _Outptr_opt_ ID3D11Resource** texture,
-        _Outptr_opt_ ID3D11ShaderResourceView** textureView) noexcept
+        _Out_ uint32_t& resDim,
+        _Out_ UINT& width,
+        _Out_ UINT& height,
+        _Out_ UINT& depth,
+        _Out_ size_t& mipCount,
+        _Out_ UINT& arraySize,
+        _Out_ DXGI_FORMAT& format,
+        _Out_ LegacyFormat& legacyFormat,
+        _Out_ bool& isCubeMap) noexcept
     {
-        HRESULT hr = S_OK;
+        width = header->width;
+        height = header->height;
+        depth = header->depth;
 
-        UINT width = header->width;
-        UINT height = header->height;
-        UINT depth = header->depth;
-
-        uint32_t resDim = D3D11_RESOURCE_DIMENSION_UNKNOWN;
-        UINT arraySize = 1;
-        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
-        bool isCubeMap = false;
+        resDim = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+        arraySize = 1;
+        format = DXGI_FORMAT_UNKNOWN;
+        legacyFormat = LEGACY_FORMAT_NONE;
+        isCubeMap = false;
 
-        size_t mipCount = header->mipMapCount;
+        mipCount = header->mipMapCount;
         if (0 == mipCount)
         {
             mipCount = 1;
@@ -1341,6 +1307,11 @@ namespace
         {
             format = GetDXGIFormat(header->ddspf);
 
+            if (format == DXGI_FORMAT_UNKNOWN)
+            {
+                legacyFormat = GetLegacyFormat(header->ddspf, format);
+            }
+
             if (format == DXGI_FORMAT_UNKNOWN)
             {
                 return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
@@ -1422,6 +1393,171 @@ namespace
             return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
         }
 
+        return S_OK;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Legacy files have no row padding, so the whole mip chain is converted as one run of pixels
+    HRESULT ConvertLegacyData(
+        _In_ LegacyFormat legacyFormat,
+        _In_reads_bytes_(bitSize) const uint8_t* bitData,
+        _In_ size_t bitSize,
+        _Out_ std::vector<uint8_t>& converted) noexcept
+    {
+        const size_t pixelCount = bitSize / GetLegacySourceSize(legacyFormat);
+
+        try
+        {
+            converted.resize(pixelCount * GetLegacyTargetSize(legacyFormat));
+        }
+        catch (const std::bad_alloc&)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        ConvertLegacyPixels(legacyFormat, bitData, converted.data(), pixelCount);
+
+        return S_OK;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    bool CanGenerateMipChain(
+        _In_ uint32_t resDim,
+        _In_ DXGI_FORMAT format,
+        _In_ UINT width,
+        _In_ UINT height,
+        _In_ size_t mipCount) noexcept
+    {
+        if (mipCount != 1 || resDim != D3D11_RESOURCE_DIMENSION_TEXTURE2D || (width <= 1 && height <= 1))
+        {
+            return false;
+        }
+
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    // Full chain for a single mip texture made on the CPU, so it needs neither render target
+    // binding nor GenerateMips at load. Every array item is followed by its own mips, as in DDS files
+    HRESULT GenerateMipChainData(
+        _In_ DXGI_FORMAT format,
+        _In_ bool forceSRGB,
+        _In_ UINT width,
+        _In_ UINT height,
+        _In_ UINT arraySize,
+        _In_reads_bytes_(bitSize) const uint8_t* bitData,
+        _In_ size_t bitSize,
+        _Out_ std::vector<uint8_t>& chain,
+        _Out_ size_t& mipCount,
+        _In_opt_ JobSystem* jobs) noexcept
+    {
+        const size_t topSize = size_t(width) * height * 4;
+        if (bitSize / arraySize < topSize)
+        {
+            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+        }
+
+        // sRGB data is filtered in linear space
+        const bool srgb = forceSRGB
+            || format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+            || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
+            || format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+
+        const size_t chainSize = GetMipChainSize(width, height);
+        try
+        {
+            chain.resize(chainSize * arraySize);
+            for (UINT item = 0; item < arraySize; ++item)
+            {
+                uint8_t* pItem = chain.data() + chainSize * item;
+                memcpy(pItem, bitData + topSize * item, topSize);
+                GenerateMipChain(pItem, width, height, MIP_FILTER_BOX, srgb ? MIP_FLAG_SRGB : 0, jobs);
+            }
+        }
+        catch (const std::bad_alloc&)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        mipCount = GetFullMipCount(width, height);
+        return S_OK;
+    }
+
+
+    //--------------------------------------------------------------------------------------
+    HRESULT CreateTextureFromDDS(
+        _In_ ID3D11Device* d3dDevice,
+        _In_opt_ ID3D11DeviceContext* d3dContext,
+        _In_ const DDS_HEADER* header,
+        _In_reads_bytes_(bitSize) const uint8_t* bitData,
+        _In_ size_t bitSize,
+        _In_ size_t maxsize,
+        _In_ D3D11_USAGE usage,
+        _In_ unsigned int bindFlags,
+        _In_ unsigned int cpuAccessFlags,
+        _In_ unsigned int miscFlags,
+        _In_ bool forceSRGB,
+        _Outptr_opt_ ID3D11Resource** texture,
+        _Outptr_opt_ ID3D11ShaderResourceView** textureView) noexcept
+    {
+        uint32_t resDim = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+        UINT width = 0;
+        UINT height = 0;
+        UINT depth = 0;
+        size_t mipCount = 0;
+        UINT arraySize = 1;
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+        LegacyFormat legacyFormat = LEGACY_FORMAT_NONE;
+        bool isCubeMap = false;
+
+        HRESULT hr = GetResourceInfo(header, resDim, width, height, depth, mipCount, arraySize, format, legacyFormat, isCubeMap);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        std::vector<uint8_t> converted;
+        if (legacyFormat != LEGACY_FORMAT_NONE)
+        {
+            hr = ConvertLegacyData(legacyFormat, bitData, bitSize, converted);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            bitData = converted.data();
+            bitSize = converted.size();
+        }
+
+        // Formats the CPU generator handles never reach the autogen path below
+        std::vector<uint8_t> mipChain;
+        if (textureView && CanGenerateMipChain(resDim, format, width, height, mipCount))
+        {
+            hr = GenerateMipChainData(format, forceSRGB, width, height, arraySize, bitData, bitSize, mipChain, mipCount, nullptr);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+
+            bitData = mipChain.data();
+            bitSize = mipChain.size();
+        }
+
         bool autogen = false;
         if (mipCount == 1 && d3dContext && textureView) // Must have context and shader-view to auto generate mipmaps
         {
@@ -1938,9 +2074,9 @@ HRESULT DirectX::CreateDDSTextureFromFileEx(
     const uint8_t* bitData = nullptr;
     size_t bitSize = 0;
 
-    std::unique_ptr<uint8_t[]> ddsData;
+    MappedFile ddsFile;
     HRESULT hr = LoadTextureDataFromFile(fileName,
-        ddsData,
+        ddsFile,
         &header,
         &bitData,
         &bitSize
@@ -1967,3 +2103,190 @@ HRESULT DirectX::CreateDDSTextureFromFileEx(
 
     return hr;
 }
+
+_Use_decl_annotations_
+HRESULT DirectX::LoadDDSTextureDataFromMemory(
+    const uint8_t* ddsData,
+    size_t ddsDataSize,
+    size_t maxsize,
+    TextureData* data,
+    DDS_ALPHA_MODE* alphaMode,
+    JobSystem* jobs) noexcept
+{
+    if (alphaMode)
+    {
+        *alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+    }
+
+    if (!ddsData || !data)
+    {
+        return E_INVALIDARG;
+    }
+
+    const DDS_HEADER* header = nullptr;
+    const uint8_t* bitData = nullptr;
+    size_t bitSize = 0;
+
+    HRESULT hr = LoadTextureDataFromMemory(ddsData,
+        ddsDataSize,
+        &header,
+        &bitData,
+        &bitSize
+    );
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    uint32_t resDim = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+    UINT width = 0;
+    UINT height = 0;
+    UINT depth = 0;
+    size_t mipCount = 0;
+    UINT arraySize = 1;
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+    LegacyFormat legacyFormat = LEGACY_FORMAT_NONE;
+    bool isCubeMap = false;
+
+    hr = GetResourceInfo(header, resDim, width, height, depth, mipCount, arraySize, format, legacyFormat, isCubeMap);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // Subresources point into the converted copy instead of the file
+    data->pixels.clear();
+    if (legacyFormat != LEGACY_FORMAT_NONE)
+    {
+        hr = ConvertLegacyData(legacyFormat, bitData, bitSize, data->pixels);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        bitData = data->pixels.data();
+        bitSize = data->pixels.size();
+    }
+
+    // There is no context to generate mips on the GPU later, so single mip textures get a full chain here
+    if (CanGenerateMipChain(resDim, format, width, height, mipCount))
+    {
+        std::vector<uint8_t> chain;
+        hr = GenerateMipChainData(format, false, width, height, arraySize, bitData, bitSize, chain, mipCount, jobs);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        data->pixels.swap(chain);
+        bitData = data->pixels.data();
+        bitSize = data->pixels.size();
+    }
+
+    static_assert(sizeof(TextureSubresource) == sizeof(D3D11_SUBRESOURCE_DATA), "TextureSubresource must match D3D11_SUBRESOURCE_DATA");
+    static_assert(offsetof(TextureSubresource, rowPitch) == offsetof(D3D11_SUBRESOURCE_DATA, SysMemPitch), "TextureSubresource must match D3D11_SUBRESOURCE_DATA");
+    static_assert(offsetof(TextureSubresource, slicePitch) == offsetof(D3D11_SUBRESOURCE_DATA, SysMemSlicePitch), "TextureSubresource must match D3D11_SUBRESOURCE_DATA");
+
+    try
+    {
+        data->subresources.resize(mipCount * arraySize);
+        data->mipSizes.resize(mipCount);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    size_t skipMip = 0;
+    size_t twidth = 0;
+    size_t theight = 0;
+    size_t tdepth = 0;
+    hr = FillInitData(width, height, depth, mipCount, arraySize,
+        format, maxsize, bitSize, bitData,
+        twidth, theight, tdepth, skipMip,
+        reinterpret_cast<D3D11_SUBRESOURCE_DATA*>(data->subresources.data()));
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // Sizes of all mips for residency decisions, including the skipped ones
+    size_t w = width;
+    size_t h = height;
+    size_t d = depth;
+    for (size_t i = 0; i < mipCount; i++)
+    {
+        size_t numBytes = 0;
+        hr = GetSurfaceInfo(w, h, format, &numBytes, nullptr, nullptr);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        data->mipSizes[i] = numBytes * d * arraySize;
+
+        w = std::max<size_t>(w >> 1, 1);
+        h = std::max<size_t>(h >> 1, 1);
+        d = std::max<size_t>(d >> 1, 1);
+    }
+
+    data->dimension = resDim;
+    data->format = format;
+    data->width = static_cast<uint32_t>(twidth);
+    data->height = static_cast<uint32_t>(theight);
+    data->depth = static_cast<uint32_t>(tdepth);
+    data->mipCount = static_cast<uint32_t>(mipCount - skipMip);
+    data->arraySize = arraySize;
+    data->cubeMap = isCubeMap;
+    data->subresources.resize((mipCount - skipMip) * arraySize);
+    data->fileWidth = width;
+    data->fileHeight = height;
+
+    if (alphaMode)
+    {
+        *alphaMode = GetAlphaMode(header);
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::CreateDDSTextureFromTextureData(
+    ID3D11Device* d3dDevice,
+    const TextureData& data,
+    D3D11_USAGE usage,
+    unsigned int bindFlags,
+    unsigned int cpuAccessFlags,
+    unsigned int miscFlags,
+    bool forceSRGB,
+    ID3D11Resource** texture,
+    ID3D11ShaderResourceView** textureView) noexcept
+{
+    if (texture)
+    {
+        *texture = nullptr;
+    }
+    if (textureView)
+    {
+        *textureView = nullptr;
+    }
+
+    if (!d3dDevice || (!texture && !textureView) || data.subresources.empty())
+    {
+        return E_INVALIDARG;
+    }
+
+    if (textureView && !(bindFlags & D3D11_BIND_SHADER_RESOURCE))
+    {
+        return E_INVALIDARG;
+    }
+
+    return CreateD3DResources(d3dDevice,
+        data.dimension, data.width, data.height, data.depth, data.mipCount, data.arraySize,
+        static_cast<DXGI_FORMAT>(data.format),
+        usage, bindFlags, cpuAccessFlags, miscFlags,
+        forceSRGB,
+        data.cubeMap,
+        const_cast<D3D11_SUBRESOURCE_DATA*>(reinterpret_cast<const D3D11_SUBRESOURCE_DATA*>(data.subresources.data())),
+        texture, textureView);
+}
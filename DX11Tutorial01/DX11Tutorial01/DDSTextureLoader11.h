@@ -21,6 +21,9 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "TextureData.h"
+
+class JobSystem;
 
 namespace DirectX
 {
@@ -131,4 +134,27 @@ namespace DirectX
         _Outptr_opt_ ID3D11Resource** texture,
         _Outptr_opt_ ID3D11ShaderResourceView** textureView,
         _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr) noexcept;
+
+    // Device independent part of loading, can run on any thread
+    // Subresources of data point into ddsData, so it has to stay valid until the texture is created
+    // Generated mips are split between jobs when jobs is given, the calling thread has to be a worker then
+    HRESULT LoadDDSTextureDataFromMemory(
+        _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+        _In_ size_t ddsDataSize,
+        _In_ size_t maxsize,
+        _Out_ TextureData* data,
+        _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr,
+        _In_opt_ JobSystem* jobs = nullptr) noexcept;
+
+    // Mips are never generated here, data has to come with all of them
+    HRESULT CreateDDSTextureFromTextureData(
+        _In_ ID3D11Device* d3dDevice,
+        _In_ const TextureData& data,
+        _In_ D3D11_USAGE usage,
+        _In_ unsigned int bindFlags,
+        _In_ unsigned int cpuAccessFlags,
+        _In_ unsigned int miscFlags,
+        _In_ bool forceSRGB,
+        _Outptr_opt_ ID3D11Resource** texture,
+        _Outptr_opt_ ID3D11ShaderResourceView** textureView) noexcept;
 }
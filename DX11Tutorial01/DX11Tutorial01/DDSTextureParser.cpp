@@ -0,0 +1,9 @@
+#include "DDSTextureParser.h"
+
+#include "DDSTextureLoader11.h"
+
+bool DDSTextureParser::Parse(const uint8_t* pData, size_t size, size_t maxSize, JobSystem* pJobs, TextureData& data)
+{
+	HRESULT result = DirectX::LoadDDSTextureDataFromMemory(pData, size, maxSize, &data, nullptr, pJobs);
+	return SUCCEEDED(result);
+}
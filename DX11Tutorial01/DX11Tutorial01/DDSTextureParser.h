@@ -0,0 +1,10 @@
+#pragma once
+
+#include "TextureLoader.h"
+
+// Parses DDS files with DDSTextureLoader, textures are created with DirectX::CreateDDSTextureFromTextureData
+class DDSTextureParser : public ITextureParser
+{
+public:
+	virtual bool Parse(const uint8_t* pData, size_t size, size_t maxSize, JobSystem* pJobs, TextureData& data);
+};
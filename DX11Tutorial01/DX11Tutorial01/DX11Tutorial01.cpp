@@ -4,12 +4,30 @@
 #include "framework.h"
 #include "DX11Tutorial01.h"
 
+#include "D3D11RenderDevice.h"
+#include "FramePacer.h"
+#include "Headless.h"
+#include "NullRenderDevice.h"
+#include "Profiler.h"
+#include "RegressionTest.h"
 #include "Renderer.h"
+#include "SoftwareRasterizer.h"
 
 #include <windowsx.h>
+#include <timeapi.h>
+
+#include <stdio.h>
+
+#include <vector>
 
 #define MAX_LOADSTRING 100
 
+static const UINT ProfileFrameCount = 120;
+static const char* ProfileTraceFile = "Profile.json";
+static const double SoftwareFrameRate = 60.0; // Target of the software fallback, which has no vsync to wait for
+static const UINT FrameWaitTimeoutMs = 1000;
+static const wchar_t* PresentSyncNames[PRESENT_SYNC_COUNT] = { L"vsync", L"off", L"tearing" };
+
 // Global Variables:
 HINSTANCE hInst;                                // current instance
 WCHAR szTitle[MAX_LOADSTRING];                  // The title bar text
@@ -20,10 +38,31 @@ ATOM                MyRegisterClass(HINSTANCE hInstance);
 BOOL                InitInstance(HINSTANCE, int);
 LRESULT CALLBACK    WndProc(HWND, UINT, WPARAM, LPARAM);
 INT_PTR CALLBACK    About(HWND, UINT, WPARAM, LPARAM);
+bool                InitSoftwareFallback();
+void                TermSoftwareFallback();
+void                PresentSoftwareFrame();
+void                ParseFrameOptions(LPCWSTR cmdLine);
+int64_t             GetInputTime(const MSG& msg);
 
 HWND g_hWnd = NULL;
+D3D11RenderDevice* g_pDevice = NULL;
 Renderer* g_pRenderer = NULL;
 
+// Used instead of the GPU when there is no adapter for D3D11RenderDevice
+NullRenderDevice* g_pNullDevice = NULL;
+SoftwareRasterizer* g_pSoftware = NULL;
+SoftwareTexture g_softwareColor;
+SoftwareTexture g_softwareNormal;
+std::vector<UINT> g_softwareFrame; // BGRA copy for GDI
+
+UINT g_profileFrames = 0; // Frames left in the profiler capture and until GPU times of its last frames are read
+
+SystemFrameClock g_frameClock;
+FramePacer g_framePacer(&g_frameClock);
+double g_targetFrameRate = -1.0; // Negative until set on the command line
+PresentSync g_presentSync = PRESENT_SYNC_VSYNC;
+UINT g_maxFramesInFlight = D3D11RenderDevice::DefaultMaxFramesInFlight;
+
 bool g_mousePress = false;
 int g_mousePrevX = 0;
 int g_mousePrevY = 0;
@@ -34,9 +73,38 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
                      _In_ int       nCmdShow)
 {
     UNREFERENCED_PARAMETER(hPrevInstance);
-    UNREFERENCED_PARAMETER(lpCmdLine);
 
-    // TODO: Place code here.
+    // "-null [frames]" renders without a window or GPU and reports CPU frame cost
+    if (wcsncmp(lpCmdLine, L"-null", 5) == 0)
+    {
+        int frameCount = _wtoi(lpCmdLine + 5);
+        return RunHeadless(frameCount > 0 ? (UINT)frameCount : 1000);
+    }
+    // "-software [frames]" renders on the CPU at 1080p and reports frames per second
+    if (wcsncmp(lpCmdLine, L"-software", 9) == 0)
+    {
+        int frameCount = _wtoi(lpCmdLine + 9);
+        return RunSoftwareBenchmark(frameCount > 0 ? (UINT)frameCount : 100);
+    }
+    // "-profile [frames]" writes a trace of CPU markers of headless frames
+    if (wcsncmp(lpCmdLine, L"-profile", 8) == 0)
+    {
+        int frameCount = _wtoi(lpCmdLine + 8);
+        return RunProfile(frameCount > 0 ? (UINT)frameCount : 100);
+    }
+    // "-pacing" runs the frame pacer on a simulated clock
+    if (wcsncmp(lpCmdLine, L"-pacing", 7) == 0)
+    {
+        return RunPacingSimulation();
+    }
+    // "-regression [record]" compares scripted camera paths with golden images, exit code is 0 when they match
+    if (wcsncmp(lpCmdLine, L"-regression", 11) == 0)
+    {
+        return RunRegression(wcsstr(lpCmdLine + 11, L"record") != NULL);
+    }
+
+    Profiler::SetThreadName("Main");
+    ParseFrameOptions(lpCmdLine);
 
     // Initialize global strings
     LoadStringW(hInstance, IDS_APP_TITLE, szTitle, MAX_LOADSTRING);
@@ -49,46 +117,266 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
         return FALSE;
     }
 
+    g_pDevice = new D3D11RenderDevice();
+    if (!g_pDevice->Init(g_hWnd))
+    {
+       g_pDevice->Term();
+       delete g_pDevice;
+       g_pDevice = NULL;
+
+       // Without a GPU frames are drawn by the software rasterizer
+       if (!InitSoftwareFallback())
+       {
+          return FALSE;
+       }
+    }
+
     g_pRenderer = new Renderer();
-    if (!g_pRenderer->Init(g_hWnd))
+    if (!g_pRenderer->Init(g_pDevice != NULL ? (IRenderDevice*)g_pDevice : g_pNullDevice))
     {
        return FALSE;
     }
 
+    // Sleeps of the frame pacer are as precise as the timer period
+    timeBeginPeriod(1);
+    if (g_pDevice != NULL)
+    {
+       g_pDevice->SetPresentSync(g_presentSync);
+       g_pDevice->SetMaxFramesInFlight(g_maxFramesInFlight);
+    }
+    g_framePacer.SetTargetFrameRate(g_targetFrameRate >= 0.0 ? g_targetFrameRate : (g_pDevice != NULL ? 0.0 : SoftwareFrameRate));
+
     HACCEL hAccelTable = LoadAccelerators(hInstance, MAKEINTRESOURCE(IDC_DX11TUTORIAL01));
 
     MSG msg;
 
     // Main message loop:
+    // Frame waits for the swap chain and the pacer first, so the input it reads is as recent as can be
     bool exit = false;
     while (!exit)
     {
-       if (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+       if (g_pDevice != NULL)
        {
+          g_pDevice->WaitForFrame(FrameWaitTimeoutMs);
+       }
+       g_framePacer.BeginFrame();
+
+       // All messages queued so far, input left in the queue would wait for later frames
+       while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+       {
+          if (msg.message == WM_QUIT)
+          {
+             exit = true;
+             break;
+          }
+          if ((msg.message >= WM_KEYFIRST && msg.message <= WM_KEYLAST) || (msg.message >= WM_MOUSEFIRST && msg.message <= WM_MOUSELAST))
+          {
+             g_framePacer.AddInput(GetInputTime(msg));
+          }
           if (!TranslateAccelerator(msg.hwnd, hAccelTable, &msg))
           {
              TranslateMessage(&msg);
              DispatchMessage(&msg);
           }
        }
-       if (msg.message == WM_QUIT)
+       if (exit)
        {
-          exit = true;
+          break;
        }
 
-       g_pRenderer->Update();
-       g_pRenderer->Render();
+       {
+          PROFILE_SCOPE("Frame");
+
+          g_pRenderer->Update();
+          g_pRenderer->Render();
+          if (g_pSoftware != NULL && g_pRenderer->RenderSoftware(*g_pSoftware))
+          {
+             PresentSoftwareFrame();
+          }
+       }
+       g_framePacer.Present();
+
+       if (g_profileFrames != 0)
+       {
+          g_profileFrames--;
+          if (g_profileFrames == GpuProfiler::FrameLatency)
+          {
+             Profiler::Stop();
+          }
+          if (g_profileFrames == 0)
+          {
+             Profiler::WriteChromeTrace(ProfileTraceFile);
+          }
+       }
     }
 
     g_pRenderer->Term();
     delete g_pRenderer;
     g_pRenderer = NULL;
 
+    if (g_pDevice != NULL)
+    {
+       g_pDevice->Term();
+       delete g_pDevice;
+       g_pDevice = NULL;
+    }
+    TermSoftwareFallback();
+    timeEndPeriod(1);
+
     g_hWnd = NULL;
 
     return (int) msg.wParam;
 }
 
+//
+//  FUNCTION: ParseFrameOptions(LPCWSTR)
+//
+//  PURPOSE: Reads frame pacing options of the window from the command line.
+//
+//  COMMENTS:
+//
+//        "-fps N" is the target frame rate, 0 does not limit it.
+//        "-sync vsync|off|tearing" is the present sync of the swap chain.
+//        "-latency N" is the count of frames in flight, 1 to 16.
+//
+void ParseFrameOptions(LPCWSTR cmdLine)
+{
+    LPCWSTR pOption = wcsstr(cmdLine, L"-fps");
+    if (pOption != NULL)
+    {
+        g_targetFrameRate = _wtof(pOption + 4);
+    }
+
+    pOption = wcsstr(cmdLine, L"-sync");
+    if (pOption != NULL)
+    {
+        pOption += 5;
+        while (*pOption == L' ')
+        {
+            pOption++;
+        }
+        for (UINT i = 0; i < PRESENT_SYNC_COUNT; i++)
+        {
+            if (wcsncmp(pOption, PresentSyncNames[i], wcslen(PresentSyncNames[i])) == 0)
+            {
+                g_presentSync = (PresentSync)i;
+            }
+        }
+    }
+
+    pOption = wcsstr(cmdLine, L"-latency");
+    if (pOption != NULL)
+    {
+        int count = _wtoi(pOption + 8);
+        g_maxFramesInFlight = count < 1 ? 1 : (count > 16 ? 16 : (UINT)count);
+    }
+}
+
+//
+//  FUNCTION: GetInputTime(const MSG&)
+//
+//  PURPOSE: Time of an input message on the clock of the frame pacer.
+//
+//  COMMENTS:
+//
+//        Message time is in milliseconds of GetTickCount, so the wait of the
+//        message in the queue is measured at that precision.
+//
+int64_t GetInputTime(const MSG& msg)
+{
+    DWORD queuedMs = GetTickCount() - msg.time;
+    return g_framePacer.GetTime() - (int64_t)queuedMs * 1000000;
+}
+
+//
+//  FUNCTION: InitSoftwareFallback()
+//
+//  PURPOSE: Sets up the null device and software rasterizer for the window.
+//
+//  COMMENTS:
+//
+//        Renderer runs its CPU stages on the null device as usual, then the
+//        opaque pass is drawn on the CPU and copied to the window with GDI.
+//        Textures fall back to the placeholder colors of the renderer.
+//
+bool InitSoftwareFallback()
+{
+    RECT rc;
+    GetClientRect(g_hWnd, &rc);
+    UINT width = rc.right > rc.left ? rc.right - rc.left : 1;
+    UINT height = rc.bottom > rc.top ? rc.bottom - rc.top : 1;
+
+    OutputDebugStringA("No GPU for the renderer, drawing with the software rasterizer\n");
+
+    g_pNullDevice = new NullRenderDevice();
+    g_pSoftware = new SoftwareRasterizer();
+    if (!g_pNullDevice->Init(width, height) || !g_pSoftware->Init(width, height))
+    {
+        return false;
+    }
+
+    std::string errors;
+    if (!g_softwareColor.Load("Brick.dds", errors))
+    {
+        g_softwareColor.CreateSolid(0xff808080);
+    }
+    if (!g_softwareNormal.Load("BrickNM.dds", errors))
+    {
+        g_softwareNormal.CreateSolid(0xffff8080);
+    }
+    g_pSoftware->SetTextures(&g_softwareColor, &g_softwareNormal);
+
+    return true;
+}
+
+void TermSoftwareFallback()
+{
+    if (g_pSoftware != NULL)
+    {
+        g_pSoftware->Term();
+        delete g_pSoftware;
+        g_pSoftware = NULL;
+    }
+    if (g_pNullDevice != NULL)
+    {
+        g_pNullDevice->Term();
+        delete g_pNullDevice;
+        g_pNullDevice = NULL;
+    }
+}
+
+//
+//  FUNCTION: PresentSoftwareFrame()
+//
+//  PURPOSE: Copies the software rasterizer image to the window.
+//
+void PresentSoftwareFrame()
+{
+    UINT width = g_pSoftware->GetWidth();
+    UINT height = g_pSoftware->GetHeight();
+    const uint32_t* pPixels = g_pSoftware->GetPixels();
+
+    // GDI takes BGRA
+    g_softwareFrame.resize(width * height);
+    for (UINT i = 0; i < width * height; i++)
+    {
+        uint32_t pixel = pPixels[i];
+        g_softwareFrame[i] = (pixel & 0xff00ff00) | ((pixel & 0xff) << 16) | ((pixel >> 16) & 0xff);
+    }
+
+    BITMAPINFO info = {};
+    info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    info.bmiHeader.biWidth = (LONG)width;
+    info.bmiHeader.biHeight = -(LONG)height; // Top down
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    HDC hdc = GetDC(g_hWnd);
+    SetDIBitsToDevice(hdc, 0, 0, width, height, 0, 0, 0, height, g_softwareFrame.data(), &info, DIB_RGB_COLORS);
+    ReleaseDC(g_hWnd, hdc);
+}
+
 
 
 //
@@ -167,6 +455,10 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
           RECT rc;
           GetClientRect(hWnd, &rc);
           g_pRenderer->Resize(rc.right - rc.left, rc.bottom - rc.top);
+          if (g_pSoftware != NULL)
+          {
+             g_pSoftware->Resize(rc.right - rc.left, rc.bottom - rc.top);
+          }
        }
        break;
     case WM_COMMAND:
@@ -219,6 +511,49 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
        {
           g_pRenderer->SwitchNormalMode();
        }
+       if (wParam == '2')
+       {
+          g_pRenderer->SwitchInstancingMode();
+       }
+       if (wParam == '3')
+       {
+          g_pRenderer->SwitchLightField();
+       }
+       if (wParam == '4')
+       {
+          g_pRenderer->SwitchTransparencyMode();
+       }
+       if (wParam == '5')
+       {
+          g_pRenderer->SwitchParallelMode();
+       }
+       if (wParam == '6' && g_profileFrames == 0)
+       {
+          Profiler::Start();
+          g_profileFrames = ProfileFrameCount + GpuProfiler::FrameLatency;
+       }
+       if (wParam == '7')
+       {
+          OutputDebugStringA(g_pRenderer->GetGpuProfiler().FormatStats().c_str());
+       }
+       if (wParam == '8' && g_pDevice != NULL)
+       {
+          // Tearing is skipped where it would present as sync off
+          PresentSync sync = (PresentSync)((g_pDevice->GetPresentSync() + 1) % PRESENT_SYNC_COUNT);
+          if (sync == PRESENT_SYNC_TEARING && !g_pDevice->IsTearingSupported())
+          {
+             sync = PRESENT_SYNC_VSYNC;
+          }
+          g_pDevice->SetPresentSync(sync);
+
+          wchar_t message[64];
+          swprintf_s(message, L"Present sync %s\n", PresentSyncNames[sync]);
+          OutputDebugStringW(message);
+       }
+       if (wParam == '9')
+       {
+          OutputDebugStringA(g_framePacer.FormatStats().c_str());
+       }
        break;
 
     case WM_PAINT:
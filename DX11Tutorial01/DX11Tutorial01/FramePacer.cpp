@@ -0,0 +1,126 @@
+#include "FramePacer.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <thread>
+
+#include "Platform.h"
+
+static const int64_t NanosecondsPerSecond = 1000000000;
+// Sleeps of the OS may overshoot by a timer period, the rest is spun
+static const int64_t SpinNanoseconds = 2000000;
+
+static double ToMs(int64_t nanoseconds)
+{
+	return nanoseconds / 1.0e6;
+}
+
+int64_t SystemFrameClock::GetTime()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SystemFrameClock::SleepUntil(int64_t time)
+{
+	int64_t remaining = time - GetTime();
+	if (remaining > SpinNanoseconds)
+	{
+		std::this_thread::sleep_for(std::chrono::nanoseconds(remaining - SpinNanoseconds));
+	}
+	while (GetTime() < time)
+	{
+		std::this_thread::yield();
+	}
+}
+
+FramePacer::FramePacer(IFrameClock* pClock)
+	: m_pClock(pClock)
+	, m_targetFrameRate(0.0)
+	, m_period(0)
+	, m_frameDue(0)
+	, m_frameStart(0)
+	, m_inputTime(-1)
+	, m_frameCount(0)
+	, m_missedFrames(0)
+{
+}
+
+void FramePacer::SetTargetFrameRate(double framesPerSecond)
+{
+	m_targetFrameRate = framesPerSecond > 0.0 ? framesPerSecond : 0.0;
+	m_period = m_targetFrameRate > 0.0 ? (int64_t)(NanosecondsPerSecond / m_targetFrameRate) : 0;
+	m_frameDue = 0;
+}
+
+void FramePacer::BeginFrame()
+{
+	int64_t sleepStart = m_pClock->GetTime();
+	int64_t now = sleepStart;
+
+	if (m_period != 0)
+	{
+		if (m_frameDue > now)
+		{
+			m_pClock->SleepUntil(m_frameDue);
+			now = m_pClock->GetTime();
+		}
+
+		bool onTime = m_frameDue != 0 && now - m_frameDue < m_period;
+		m_missedFrames += m_frameDue != 0 && !onTime ? 1 : 0;
+		m_frameDue = onTime ? m_frameDue + m_period : now + m_period;
+	}
+
+	if (m_frameCount != 0)
+	{
+		m_frameIntervals.Add(ToMs(now - m_frameStart));
+	}
+	m_sleepTimes.Add(ToMs(now - sleepStart));
+	m_frameStart = now;
+	m_frameCount++;
+}
+
+void FramePacer::AddInput(int64_t time)
+{
+	if (m_inputTime < 0 || time < m_inputTime)
+	{
+		m_inputTime = time;
+	}
+}
+
+void FramePacer::Present()
+{
+	int64_t now = m_pClock->GetTime();
+
+	m_frameTimes.Add(ToMs(now - m_frameStart));
+	if (m_inputTime >= 0)
+	{
+		m_inputLatencies.Add(ToMs(now - m_inputTime));
+		m_inputTime = -1;
+	}
+}
+
+static void FormatHistory(std::string& text, const char* name, const TimingHistory& history)
+{
+	char line[256];
+	sprintf_s(line, "%-14s %8.3f ms min, %8.3f ms avg, %8.3f ms p99 over %u samples\n",
+		name, history.GetMin(), history.GetAverage(), history.GetPercentile(99.0), history.GetCount());
+	text += line;
+}
+
+std::string FramePacer::FormatStats() const
+{
+	double intervalMs = m_frameIntervals.GetAverage();
+
+	char line[256];
+	sprintf_s(line, "Frames: %u, target %.1f fps, %.1f fps over the history, %u missed\n",
+		m_frameCount, m_targetFrameRate, intervalMs > 0.0 ? 1000.0 / intervalMs : 0.0, m_missedFrames);
+	std::string text = line;
+
+	FormatHistory(text, "Frame interval", m_frameIntervals);
+	FormatHistory(text, "Frame time", m_frameTimes);
+	FormatHistory(text, "Sleep", m_sleepTimes);
+	FormatHistory(text, "Input latency", m_inputLatencies);
+
+	return text;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+#include "TimingHistory.h"
+
+// Time source of the frame pacer, in nanoseconds of a monotonic clock
+class IFrameClock
+{
+public:
+	virtual ~IFrameClock() {}
+
+	virtual int64_t GetTime() = 0;
+	// Returns at once for a time which has passed
+	virtual void SleepUntil(int64_t time) = 0;
+};
+
+// Clock of the machine, sleeps in the OS and spins the last part the OS would overshoot
+// Windows sleeps in timer periods, so the app asks for 1 ms periods with timeBeginPeriod
+class SystemFrameClock : public IFrameClock
+{
+public:
+	virtual int64_t GetTime();
+	virtual void SleepUntil(int64_t time);
+};
+
+// Clock which advances only when it sleeps, so pacing runs without waiting and work is simulated with sleeps
+class SimulatedFrameClock : public IFrameClock
+{
+public:
+	SimulatedFrameClock()
+		: m_time(0)
+	{
+	}
+
+	virtual int64_t GetTime() { return m_time; }
+	virtual void SleepUntil(int64_t time) { m_time = time > m_time ? time : m_time; }
+
+private:
+	int64_t m_time;
+};
+
+// Starts frames at a target rate and measures the frames and the latency from input to present
+// Frames are due at a steady rate, a frame which starts later than a whole period starts the rate again
+// instead of following with a burst of short frames
+// Each frame goes BeginFrame, input and its update and render, then Present
+class FramePacer
+{
+public:
+	explicit FramePacer(IFrameClock* pClock);
+
+	// Frames per second, 0 starts frames as soon as the previous one is presented
+	void SetTargetFrameRate(double framesPerSecond);
+	double GetTargetFrameRate() const { return m_targetFrameRate; }
+
+	// Sleeps until the next frame is due
+	void BeginFrame();
+	// Input which gets to the next present, its latency is measured from the oldest input of the frame
+	void AddInput(int64_t time);
+	void Present();
+
+	int64_t GetTime() { return m_pClock->GetTime(); }
+
+	// From frame start to frame start
+	const TimingHistory& GetFrameIntervals() const { return m_frameIntervals; }
+	// From frame start to present, the time not slept
+	const TimingHistory& GetFrameTimes() const { return m_frameTimes; }
+	const TimingHistory& GetSleepTimes() const { return m_sleepTimes; }
+	const TimingHistory& GetInputLatencies() const { return m_inputLatencies; }
+	unsigned int GetFrameCount() const { return m_frameCount; }
+	// Frames which started later than a whole period after they were due
+	unsigned int GetMissedFrameCount() const { return m_missedFrames; }
+
+	// Rate, intervals, frame times, sleep and input latency with min, average and 99th percentile
+	std::string FormatStats() const;
+
+private:
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+private:
+	IFrameClock* m_pClock;
+	double m_targetFrameRate;
+	int64_t m_period;     // 0 when the rate is not limited
+
+	int64_t m_frameDue;   // Start of the next frame, 0 before the first one
+	int64_t m_frameStart;
+	int64_t m_inputTime;  // Oldest input not presented yet, negative if none
+
+	TimingHistory m_frameIntervals;
+	TimingHistory m_frameTimes;
+	TimingHistory m_sleepTimes;
+	TimingHistory m_inputLatencies;
+	unsigned int m_frameCount;
+	unsigned int m_missedFrames;
+};
@@ -0,0 +1,379 @@
+#include "FrustumCulling.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define FRUSTUM_CULLING_SSE 1
+#include <xmmintrin.h>
+#endif
+
+using namespace DirectX;
+
+static const unsigned int MaxStackDepth = 256;
+
+void ExtractFrustumPlanes(const XMFLOAT4X4& viewProj, Frustum& frustum)
+{
+	// clip = p * viewProj, so clip components are dot products with matrix columns
+	XMFLOAT4 columns[4];
+	for (int c = 0; c < 4; c++)
+	{
+		columns[c] = XMFLOAT4(viewProj.m[0][c], viewProj.m[1][c], viewProj.m[2][c], viewProj.m[3][c]);
+	}
+
+	// -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	for (int i = 0; i < 3; i++)
+	{
+		const XMFLOAT4& col = columns[i];
+		const XMFLOAT4& w = columns[3];
+		if (i < 2)
+		{
+			frustum.planes[i * 2] = XMFLOAT4(w.x + col.x, w.y + col.y, w.z + col.z, w.w + col.w);
+		}
+		else
+		{
+			frustum.planes[i * 2] = col;
+		}
+		frustum.planes[i * 2 + 1] = XMFLOAT4(w.x - col.x, w.y - col.y, w.z - col.z, w.w - col.w);
+	}
+
+	for (int i = 0; i < 6; i++)
+	{
+		XMFLOAT4& plane = frustum.planes[i];
+		float invLength = 1.0f / sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		plane.x *= invLength;
+		plane.y *= invLength;
+		plane.z *= invLength;
+		plane.w *= invLength;
+	}
+}
+
+AABB TransformAABB(const AABB& box, const XMFLOAT4X4& world)
+{
+	float center[3] = { (box.min.x + box.max.x) * 0.5f, (box.min.y + box.max.y) * 0.5f, (box.min.z + box.max.z) * 0.5f };
+	float extent[3] = { (box.max.x - box.min.x) * 0.5f, (box.max.y - box.min.y) * 0.5f, (box.max.z - box.min.z) * 0.5f };
+
+	float newCenter[3];
+	float newExtent[3];
+	for (int c = 0; c < 3; c++)
+	{
+		newCenter[c] = world.m[3][c];
+		newExtent[c] = 0.0f;
+		for (int r = 0; r < 3; r++)
+		{
+			newCenter[c] += center[r] * world.m[r][c];
+			newExtent[c] += extent[r] * fabsf(world.m[r][c]);
+		}
+	}
+
+	AABB result;
+	result.min = XMFLOAT3(newCenter[0] - newExtent[0], newCenter[1] - newExtent[1], newCenter[2] - newExtent[2]);
+	result.max = XMFLOAT3(newCenter[0] + newExtent[0], newCenter[1] + newExtent[1], newCenter[2] + newExtent[2]);
+	return result;
+}
+
+namespace
+{
+	// Split indices in two halves by median of box centers along the longest axis
+	unsigned int SplitMedian(unsigned int* pIndices, unsigned int count, const XMFLOAT3* pCenters)
+	{
+		XMFLOAT3 minC = pCenters[pIndices[0]];
+		XMFLOAT3 maxC = minC;
+		for (unsigned int i = 1; i < count; i++)
+		{
+			const XMFLOAT3& c = pCenters[pIndices[i]];
+			minC = XMFLOAT3(std::min(minC.x, c.x), std::min(minC.y, c.y), std::min(minC.z, c.z));
+			maxC = XMFLOAT3(std::max(maxC.x, c.x), std::max(maxC.y, c.y), std::max(maxC.z, c.z));
+		}
+
+		float sizeX = maxC.x - minC.x;
+		float sizeY = maxC.y - minC.y;
+		float sizeZ = maxC.z - minC.z;
+		int axis = (sizeX >= sizeY && sizeX >= sizeZ) ? 0 : (sizeY >= sizeZ ? 1 : 2);
+
+		unsigned int mid = count / 2;
+		std::nth_element(pIndices, pIndices + mid, pIndices + count, [pCenters, axis](unsigned int a, unsigned int b)
+		{
+			return (&pCenters[a].x)[axis] < (&pCenters[b].x)[axis];
+		});
+
+		return mid;
+	}
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy()
+	: m_boxCount(0)
+{
+}
+
+void BoundingVolumeHierarchy::Build(const AABB* pBoxes, unsigned int count)
+{
+	Clear();
+
+	m_boxCount = count;
+	if (count == 0)
+	{
+		return;
+	}
+
+	std::vector<XMFLOAT3> centers(count);
+	m_indices.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		centers[i] = XMFLOAT3((pBoxes[i].min.x + pBoxes[i].max.x) * 0.5f, (pBoxes[i].min.y + pBoxes[i].max.y) * 0.5f, (pBoxes[i].min.z + pBoxes[i].max.z) * 0.5f);
+		m_indices[i] = i;
+	}
+
+	m_nodes.reserve(count / 3 + 1);
+	BuildNode(m_indices.data(), count, pBoxes, centers.data());
+}
+
+void BoundingVolumeHierarchy::Refit(const AABB* pBoxes)
+{
+	// Children are always created after their parent, so reverse order visits children first
+	for (size_t n = m_nodes.size(); n > 0; n--)
+	{
+		Node& node = m_nodes[n - 1];
+		for (unsigned int i = 0; i < node.childCount; i++)
+		{
+			if (node.leafMask & (1u << i))
+			{
+				SetChildBounds(node, i, pBoxes[node.children[i]]);
+			}
+			else
+			{
+				SetChildBounds(node, i, GetNodeBounds(m_nodes[node.children[i]]));
+			}
+		}
+	}
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+	m_nodes.clear();
+	m_boxCount = 0;
+}
+
+unsigned int BoundingVolumeHierarchy::BuildNode(unsigned int* pIndices, unsigned int count, const AABB* pBoxes, const XMFLOAT3* pCenters)
+{
+	unsigned int nodeIndex = (unsigned int)m_nodes.size();
+
+	Node node;
+	memset(&node, 0, sizeof(node));
+	m_nodes.push_back(node);
+
+	// Split into up to four groups
+	unsigned int groupStarts[5] = { 0 };
+	unsigned int groupCount = 0;
+	if (count <= 4)
+	{
+		groupCount = count;
+		for (unsigned int i = 0; i <= count; i++)
+		{
+			groupStarts[i] = i;
+		}
+	}
+	else
+	{
+		unsigned int mid = SplitMedian(pIndices, count, pCenters);
+		unsigned int midLeft = SplitMedian(pIndices, mid, pCenters);
+		unsigned int midRight = mid + SplitMedian(pIndices + mid, count - mid, pCenters);
+
+		groupCount = 4;
+		groupStarts[0] = 0;
+		groupStarts[1] = midLeft;
+		groupStarts[2] = mid;
+		groupStarts[3] = midRight;
+		groupStarts[4] = count;
+	}
+
+	for (unsigned int g = 0; g < groupCount; g++)
+	{
+		unsigned int* pGroup = pIndices + groupStarts[g];
+		unsigned int groupSize = groupStarts[g + 1] - groupStarts[g];
+
+		AABB bounds = pBoxes[pGroup[0]];
+		for (unsigned int i = 1; i < groupSize; i++)
+		{
+			const AABB& box = pBoxes[pGroup[i]];
+			bounds.min = XMFLOAT3(std::min(bounds.min.x, box.min.x), std::min(bounds.min.y, box.min.y), std::min(bounds.min.z, box.min.z));
+			bounds.max = XMFLOAT3(std::max(bounds.max.x, box.max.x), std::max(bounds.max.y, box.max.y), std::max(bounds.max.z, box.max.z));
+		}
+
+		unsigned int child = 0;
+		bool leaf = groupSize == 1;
+		if (leaf)
+		{
+			child = pGroup[0];
+		}
+		else
+		{
+			child = BuildNode(pGroup, groupSize, pBoxes, pCenters);
+		}
+
+		// Vector may be reallocated by recursive builds, so take reference only now
+		Node& current = m_nodes[nodeIndex];
+		SetChildBounds(current, g, bounds);
+		current.children[g] = child;
+		current.leafMask |= leaf ? (1u << g) : 0u;
+	}
+	m_nodes[nodeIndex].childCount = groupCount;
+
+	return nodeIndex;
+}
+
+void BoundingVolumeHierarchy::SetChildBounds(Node& node, unsigned int child, const AABB& bounds)
+{
+	node.minX[child] = bounds.min.x;
+	node.minY[child] = bounds.min.y;
+	node.minZ[child] = bounds.min.z;
+	node.maxX[child] = bounds.max.x;
+	node.maxY[child] = bounds.max.y;
+	node.maxZ[child] = bounds.max.z;
+}
+
+AABB BoundingVolumeHierarchy::GetNodeBounds(const Node& node) const
+{
+	AABB bounds;
+	bounds.min = XMFLOAT3(node.minX[0], node.minY[0], node.minZ[0]);
+	bounds.max = XMFLOAT3(node.maxX[0], node.maxY[0], node.maxZ[0]);
+	for (unsigned int i = 1; i < node.childCount; i++)
+	{
+		bounds.min = XMFLOAT3(std::min(bounds.min.x, node.minX[i]), std::min(bounds.min.y, node.minY[i]), std::min(bounds.min.z, node.minZ[i]));
+		bounds.max = XMFLOAT3(std::max(bounds.max.x, node.maxX[i]), std::max(bounds.max.y, node.maxY[i]), std::max(bounds.max.z, node.maxZ[i]));
+	}
+	return bounds;
+}
+
+namespace
+{
+	// Returns mask of children which intersect frustum, insideMask gets children fully inside
+	template <typename Node>
+	unsigned int TestNode(const Node& node, const Frustum& frustum, unsigned int& insideMask)
+	{
+		unsigned int validMask = (1u << node.childCount) - 1;
+
+#ifdef FRUSTUM_CULLING_SSE
+		__m128 minX = _mm_loadu_ps(node.minX);
+		__m128 minY = _mm_loadu_ps(node.minY);
+		__m128 minZ = _mm_loadu_ps(node.minZ);
+		__m128 maxX = _mm_loadu_ps(node.maxX);
+		__m128 maxY = _mm_loadu_ps(node.maxY);
+		__m128 maxZ = _mm_loadu_ps(node.maxZ);
+
+		const __m128 zero = _mm_setzero_ps();
+		__m128 outside = zero;
+		__m128 crossing = zero;
+		for (int p = 0; p < 6; p++)
+		{
+			const XMFLOAT4& plane = frustum.planes[p];
+			__m128 a = _mm_set1_ps(plane.x);
+			__m128 b = _mm_set1_ps(plane.y);
+			__m128 c = _mm_set1_ps(plane.z);
+			__m128 d = _mm_set1_ps(plane.w);
+
+			// Box corners farthest along and against plane normal
+			__m128 distFar = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, plane.x >= 0 ? maxX : minX), _mm_mul_ps(b, plane.y >= 0 ? maxY : minY)),
+				_mm_add_ps(_mm_mul_ps(c, plane.z >= 0 ? maxZ : minZ), d));
+			__m128 distNear = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, plane.x >= 0 ? minX : maxX), _mm_mul_ps(b, plane.y >= 0 ? minY : maxY)),
+				_mm_add_ps(_mm_mul_ps(c, plane.z >= 0 ? minZ : maxZ), d));
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distFar, zero));
+			crossing = _mm_or_ps(crossing, _mm_cmplt_ps(distNear, zero));
+		}
+
+		unsigned int visibleMask = ~(unsigned int)_mm_movemask_ps(outside) & validMask;
+		insideMask = ~(unsigned int)_mm_movemask_ps(crossing) & visibleMask;
+#else
+		unsigned int visibleMask = 0;
+		insideMask = 0;
+		for (unsigned int i = 0; i < node.childCount; i++)
+		{
+			bool isOutside = false;
+			bool isCrossing = false;
+			for (int p = 0; p < 6; p++)
+			{
+				const XMFLOAT4& plane = frustum.planes[p];
+				float distFar = plane.x * (plane.x >= 0 ? node.maxX[i] : node.minX[i])
+					+ plane.y * (plane.y >= 0 ? node.maxY[i] : node.minY[i])
+					+ plane.z * (plane.z >= 0 ? node.maxZ[i] : node.minZ[i]) + plane.w;
+				float distNear = plane.x * (plane.x >= 0 ? node.minX[i] : node.maxX[i])
+					+ plane.y * (plane.y >= 0 ? node.minY[i] : node.maxY[i])
+					+ plane.z * (plane.z >= 0 ? node.minZ[i] : node.maxZ[i]) + plane.w;
+				isOutside = isOutside || distFar < 0;
+				isCrossing = isCrossing || distNear < 0;
+			}
+			if (!isOutside)
+			{
+				visibleMask |= 1u << i;
+				insideMask |= isCrossing ? 0u : (1u << i);
+			}
+		}
+		visibleMask &= validMask;
+#endif
+
+		return visibleMask;
+	}
+}
+
+void BoundingVolumeHierarchy::Cull(const Frustum& frustum, std::vector<unsigned int>& visible) const
+{
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	unsigned int stack[MaxStackDepth];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+
+		unsigned int insideMask = 0;
+		unsigned int visibleMask = TestNode(node, frustum, insideMask);
+
+		for (unsigned int i = 0; i < node.childCount; i++)
+		{
+			unsigned int bit = 1u << i;
+			if (!(visibleMask & bit))
+			{
+				continue;
+			}
+
+			if (node.leafMask & bit)
+			{
+				visible.push_back(node.children[i]);
+			}
+			else if (insideMask & bit)
+			{
+				// No more plane tests needed for the whole subtree
+				AppendSubtree(node.children[i], visible);
+			}
+			else
+			{
+				assert(stackSize < MaxStackDepth);
+				stack[stackSize++] = node.children[i];
+			}
+		}
+	}
+}
+
+void BoundingVolumeHierarchy::AppendSubtree(unsigned int nodeIndex, std::vector<unsigned int>& visible) const
+{
+	const Node& node = m_nodes[nodeIndex];
+	for (unsigned int i = 0; i < node.childCount; i++)
+	{
+		if (node.leafMask & (1u << i))
+		{
+			visible.push_back(node.children[i]);
+		}
+		else
+		{
+			AppendSubtree(node.children[i], visible);
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+struct AABB
+{
+	DirectX::XMFLOAT3 min;
+	DirectX::XMFLOAT3 max;
+};
+
+// Six planes (left, right, bottom, top, near, far), points inside have dot(plane.xyz, p) + plane.w >= 0
+struct Frustum
+{
+	DirectX::XMFLOAT4 planes[6];
+};
+
+// Extract planes from view projection matrix in DirectXMath convention (not transposed)
+void ExtractFrustumPlanes(const DirectX::XMFLOAT4X4& viewProj, Frustum& frustum);
+
+// Bounding box of local box transformed by world matrix
+AABB TransformAABB(const AABB& box, const DirectX::XMFLOAT4X4& world);
+
+// Four-wide bounding volume hierarchy over boxes
+// Each node keeps bounds of its children as structure of arrays, so four boxes are tested against a plane at once
+class BoundingVolumeHierarchy
+{
+public:
+	BoundingVolumeHierarchy();
+
+	void Build(const AABB* pBoxes, unsigned int count);
+	// Update node bounds for moved boxes keeping the tree topology, box count must match the last Build
+	void Refit(const AABB* pBoxes);
+	void Clear();
+
+	// Append indices of boxes intersecting the frustum to visible
+	void Cull(const Frustum& frustum, std::vector<unsigned int>& visible) const;
+
+	unsigned int GetBoxCount() const { return m_boxCount; }
+
+private:
+	struct Node
+	{
+		float minX[4];
+		float minY[4];
+		float minZ[4];
+		float maxX[4];
+		float maxY[4];
+		float maxZ[4];
+
+		unsigned int children[4]; // Box index for leaves, node index otherwise
+		unsigned int childCount;
+		unsigned int leafMask;    // Bit i is set if child i is a box
+	};
+
+	void SetChildBounds(Node& node, unsigned int child, const AABB& bounds);
+	AABB GetNodeBounds(const Node& node) const;
+
+	unsigned int BuildNode(unsigned int* pIndices, unsigned int count, const AABB* pBoxes, const DirectX::XMFLOAT3* pCenters);
+	void AppendSubtree(unsigned int nodeIndex, std::vector<unsigned int>& visible) const;
+
+private:
+	std::vector<Node> m_nodes;
+	std::vector<unsigned int> m_indices; // Scratch storage for build
+	unsigned int m_boxCount;
+};
@@ -0,0 +1,267 @@
+#include "GpuProfiler.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "Profiler.h"
+
+#define SAFE_RELEASE(p) \
+if (p != NULL) { \
+	p->Release(); \
+	p = NULL;\
+}
+
+static const char* FramePassName = "Frame";
+
+GpuProfiler::GpuProfiler()
+	: m_frameIndex(0)
+	, m_pFrame(NULL)
+	, m_openPassCount(0)
+	, m_measuredFrames(0)
+	, m_skippedFrames(0)
+	, m_disjointFrames(0)
+{
+	memset(m_slots, 0, sizeof(m_slots));
+}
+
+HRESULT GpuProfiler::Init(IRenderDevice* pDevice)
+{
+	HRESULT result = S_OK;
+
+	for (UINT i = 0; i < FrameLatency && SUCCEEDED(result); i++)
+	{
+		FrameSlot& slot = m_slots[i];
+
+		result = pDevice->CreateQuery(QUERY_TIMESTAMP_DISJOINT, &slot.pDisjoint);
+		if (SUCCEEDED(result))
+		{
+			result = pDevice->CreateQuery(QUERY_TIMESTAMP, &slot.pBegin);
+		}
+		if (SUCCEEDED(result))
+		{
+			result = pDevice->CreateQuery(QUERY_TIMESTAMP, &slot.pEnd);
+		}
+		for (UINT j = 0; j < MaxPasses && SUCCEEDED(result); j++)
+		{
+			result = pDevice->CreateQuery(QUERY_TIMESTAMP, &slot.passes[j].pBegin);
+			if (SUCCEEDED(result))
+			{
+				result = pDevice->CreateQuery(QUERY_TIMESTAMP, &slot.passes[j].pEnd);
+			}
+		}
+	}
+	assert(SUCCEEDED(result));
+
+	m_frameIndex = 0;
+	m_pFrame = NULL;
+	m_openPassCount = 0;
+	m_passes.clear();
+	m_measuredFrames = 0;
+	m_skippedFrames = 0;
+	m_disjointFrames = 0;
+
+	return result;
+}
+
+void GpuProfiler::Term()
+{
+	for (UINT i = 0; i < FrameLatency; i++)
+	{
+		FrameSlot& slot = m_slots[i];
+		for (UINT j = 0; j < MaxPasses; j++)
+		{
+			SAFE_RELEASE(slot.passes[j].pEnd);
+			SAFE_RELEASE(slot.passes[j].pBegin);
+		}
+		SAFE_RELEASE(slot.pEnd);
+		SAFE_RELEASE(slot.pBegin);
+		SAFE_RELEASE(slot.pDisjoint);
+		slot.pending = false;
+	}
+	m_pFrame = NULL;
+}
+
+void GpuProfiler::BeginFrame(IRenderContext* pContext)
+{
+	assert(m_pFrame == NULL);
+
+	// Oldest frames first, so the histories keep the frame order
+	for (UINT i = 1; i <= FrameLatency; i++)
+	{
+		FrameSlot& slot = m_slots[(m_frameIndex + i) % FrameLatency];
+		if (slot.pending && ReadSlot(pContext, slot))
+		{
+			slot.pending = false;
+		}
+	}
+
+	FrameSlot& slot = m_slots[m_frameIndex % FrameLatency];
+	m_frameIndex++;
+
+	if (slot.pDisjoint == NULL || slot.pending)
+	{
+		m_skippedFrames += slot.pending ? 1 : 0;
+		return;
+	}
+
+	m_pFrame = &slot;
+	m_openPassCount = 0;
+	slot.passCount = 0;
+	slot.profiling = Profiler::IsEnabled();
+	slot.cpuTicks = Profiler::GetTimestamp();
+
+	pContext->Begin(slot.pDisjoint);
+	pContext->End(slot.pBegin);
+}
+
+void GpuProfiler::BeginPass(IRenderContext* pContext, const char* name)
+{
+	if (m_pFrame == NULL)
+	{
+		return;
+	}
+
+	// Pass which does not fit is still opened, so its EndPass closes it and not the enclosing one
+	unsigned int index = m_pFrame->passCount;
+	if (index < MaxPasses)
+	{
+		PassQueries& pass = m_pFrame->passes[index];
+		pass.name = name;
+		pContext->End(pass.pBegin);
+		m_pFrame->passCount++;
+	}
+
+	assert(m_openPassCount < MaxPasses);
+	m_openPasses[m_openPassCount++] = index;
+}
+
+void GpuProfiler::EndPass(IRenderContext* pContext)
+{
+	if (m_pFrame == NULL)
+	{
+		return;
+	}
+
+	assert(m_openPassCount != 0);
+	unsigned int index = m_openPasses[--m_openPassCount];
+	if (index < MaxPasses)
+	{
+		pContext->End(m_pFrame->passes[index].pEnd);
+	}
+}
+
+void GpuProfiler::EndFrame(IRenderContext* pContext)
+{
+	if (m_pFrame == NULL)
+	{
+		return;
+	}
+
+	assert(m_openPassCount == 0);
+
+	pContext->End(m_pFrame->pEnd);
+	pContext->End(m_pFrame->pDisjoint);
+	m_pFrame->pending = true;
+	m_pFrame = NULL;
+}
+
+bool GpuProfiler::ReadSlot(IRenderContext* pContext, FrameSlot& slot)
+{
+	// Timestamps are done before the disjoint query ended after them
+	RenderTimestampDisjoint disjoint = {};
+	if (pContext->GetTimestampDisjoint(slot.pDisjoint, &disjoint) != S_OK)
+	{
+		return false;
+	}
+
+	uint64_t begin = 0;
+	uint64_t end = 0;
+	uint64_t passBegin[MaxPasses];
+	uint64_t passEnd[MaxPasses];
+	bool ready = pContext->GetTimestamp(slot.pBegin, &begin) == S_OK && pContext->GetTimestamp(slot.pEnd, &end) == S_OK;
+	for (UINT i = 0; i < slot.passCount && ready; i++)
+	{
+		ready = pContext->GetTimestamp(slot.passes[i].pBegin, &passBegin[i]) == S_OK
+			&& pContext->GetTimestamp(slot.passes[i].pEnd, &passEnd[i]) == S_OK;
+	}
+	if (!ready)
+	{
+		return false;
+	}
+
+	if (disjoint.disjoint || disjoint.frequency == 0)
+	{
+		m_disjointFrames++;
+		return true;
+	}
+
+	double msPerTick = 1000.0 / disjoint.frequency;
+	GetHistory(FramePassName).Add((end - begin) * msPerTick);
+	for (UINT i = 0; i < slot.passCount; i++)
+	{
+		GetHistory(slot.passes[i].name).Add((passEnd[i] - passBegin[i]) * msPerTick);
+	}
+	m_measuredFrames++;
+
+	// GPU clock is placed on the CPU one at the start of the frame, the time the GPU was behind is not known
+	// Frames of a capture are read after it stopped too, an export a few frames later has them all
+	if (slot.profiling)
+	{
+		double cpuPerGpuTick = Profiler::GetTicksPerSecond() / disjoint.frequency;
+
+		Profiler::AddGpuEvent(FramePassName, slot.cpuTicks, slot.cpuTicks + (uint64_t)((end - begin) * cpuPerGpuTick));
+		for (UINT i = 0; i < slot.passCount; i++)
+		{
+			Profiler::AddGpuEvent(slot.passes[i].name,
+				slot.cpuTicks + (uint64_t)((passBegin[i] - begin) * cpuPerGpuTick),
+				slot.cpuTicks + (uint64_t)((passEnd[i] - begin) * cpuPerGpuTick));
+		}
+	}
+
+	return true;
+}
+
+TimingHistory& GpuProfiler::GetHistory(const char* name)
+{
+	for (PassHistory& pass : m_passes)
+	{
+		if (pass.name == name || strcmp(pass.name, name) == 0)
+		{
+			return pass.history;
+		}
+	}
+
+	m_passes.push_back(PassHistory{ name, TimingHistory() });
+	return m_passes.back().history;
+}
+
+void GpuProfiler::GetPassStats(unsigned int index, GpuPassStats& stats) const
+{
+	const PassHistory& pass = m_passes[index];
+
+	stats.name = pass.name;
+	stats.count = pass.history.GetCount();
+	stats.lastMs = pass.history.GetLast();
+	stats.minMs = pass.history.GetMin();
+	stats.avgMs = pass.history.GetAverage();
+	stats.p99Ms = pass.history.GetPercentile(99.0);
+}
+
+std::string GpuProfiler::FormatStats() const
+{
+	char line[256];
+	sprintf_s(line, "GPU frames: %u measured, %u skipped, %u disjoint\n", m_measuredFrames, m_skippedFrames, m_disjointFrames);
+	std::string text = line;
+
+	for (UINT i = 0; i < GetPassCount(); i++)
+	{
+		GpuPassStats stats;
+		GetPassStats(i, stats);
+
+		sprintf_s(line, "GPU %-12s %8.3f ms min, %8.3f ms avg, %8.3f ms p99 over %u frames\n",
+			stats.name, stats.minMs, stats.avgMs, stats.p99Ms, stats.count);
+		text += line;
+	}
+
+	return text;
+}
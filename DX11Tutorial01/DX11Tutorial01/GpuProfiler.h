@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "RenderDevice.h"
+#include "TimingHistory.h"
+
+struct GpuPassStats
+{
+	const char* name;
+	unsigned int count; // Samples in the history
+	double lastMs;
+	double minMs;
+	double avgMs;
+	double p99Ms;
+};
+
+// GPU time of the frame and of named passes in it, measured with timestamp queries on the immediate context
+// Queries of a frame are read FrameLatency frames later without flushing, so reading them never stalls
+// Frame whose slot is still pending when it comes around again is not measured and counted as skipped
+// While the CPU profiler records, measured passes go to its GPU track, placed from the CPU time their frame began
+class GpuProfiler
+{
+public:
+	static const unsigned int FrameLatency = 4;
+	static const unsigned int MaxPasses = 16; // Later passes of a frame are not measured
+
+	GpuProfiler();
+
+	HRESULT Init(IRenderDevice* pDevice);
+	void Term();
+
+	// Frame goes from BeginFrame to EndFrame before Present, passes are in it and may nest
+	// Names are kept as pointers, so they must be string literals
+	void BeginFrame(IRenderContext* pContext);
+	void BeginPass(IRenderContext* pContext, const char* name);
+	void EndPass(IRenderContext* pContext);
+	void EndFrame(IRenderContext* pContext);
+
+	// Frame first, then passes in the order they were first measured
+	unsigned int GetPassCount() const { return (unsigned int)m_passes.size(); }
+	void GetPassStats(unsigned int index, GpuPassStats& stats) const;
+
+	unsigned int GetMeasuredFrameCount() const { return m_measuredFrames; }
+	unsigned int GetSkippedFrameCount() const { return m_skippedFrames; }
+	// Frames whose timestamps were not comparable, as when the GPU clock changed
+	unsigned int GetDisjointFrameCount() const { return m_disjointFrames; }
+
+	// One line per pass with min, average and 99th percentile over the history
+	std::string FormatStats() const;
+
+private:
+	struct PassQueries
+	{
+		const char* name;
+		RenderQuery* pBegin;
+		RenderQuery* pEnd;
+	};
+
+	// Queries of one frame in flight
+	struct FrameSlot
+	{
+		RenderQuery* pDisjoint;
+		RenderQuery* pBegin;
+		RenderQuery* pEnd;
+		PassQueries passes[MaxPasses];
+		unsigned int passCount;
+		uint64_t cpuTicks; // Profiler timestamp at BeginFrame
+		bool profiling;    // Profiler was recording at BeginFrame
+		bool pending;      // Ended and not read yet
+	};
+
+	struct PassHistory
+	{
+		const char* name;
+		TimingHistory history;
+	};
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	// Returns false while the timestamps are not there
+	bool ReadSlot(IRenderContext* pContext, FrameSlot& slot);
+	TimingHistory& GetHistory(const char* name);
+
+private:
+	FrameSlot m_slots[FrameLatency];
+	unsigned int m_frameIndex;
+	FrameSlot* m_pFrame;             // Slot of the frame between BeginFrame and EndFrame, NULL if not measured
+	unsigned int m_openPasses[MaxPasses];
+	unsigned int m_openPassCount;
+
+	std::vector<PassHistory> m_passes;
+	unsigned int m_measuredFrames;
+	unsigned int m_skippedFrames;
+	unsigned int m_disjointFrames;
+};
+
+// Pass from construction to the end of the scope
+class GpuPassScope
+{
+public:
+	GpuPassScope(GpuProfiler& profiler, IRenderContext* pContext, const char* name)
+		: m_profiler(profiler)
+		, m_pContext(pContext)
+	{
+		m_profiler.BeginPass(m_pContext, name);
+	}
+
+	~GpuPassScope()
+	{
+		m_profiler.EndPass(m_pContext);
+	}
+
+private:
+	GpuPassScope(const GpuPassScope&) = delete;
+	GpuPassScope& operator=(const GpuPassScope&) = delete;
+
+	GpuProfiler& m_profiler;
+	IRenderContext* m_pContext;
+};
@@ -0,0 +1,314 @@
+#include "Headless.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+
+#include "FramePacer.h"
+#include "NullRenderDevice.h"
+#include "Profiler.h"
+#include "RegressionTest.h"
+#include "Renderer.h"
+#include "SoftwareRasterizer.h"
+
+static const UINT HeadlessWidth = 1280;
+static const UINT HeadlessHeight = 720;
+static const UINT BenchmarkWidth = 1920;
+static const UINT BenchmarkHeight = 1080;
+static const char* ProfileTraceFile = "Profile.json";
+static const UINT HeadlessQueryLatency = 2; // Frames before timestamps are there, as a GPU would be behind
+static const UINT PacingFrameCount = 600;
+static const UINT SystemPacingFrameCount = 60;
+static const double PacingRateTolerance = 0.01;
+
+// Frame work of a pacing simulation, every spikeEvery-th frame takes spikeMs instead
+// Expected rate is checked when it is not 0
+struct PacingScenario
+{
+	const char* name;
+	double frameRate;
+	double workMs;
+	UINT spikeEvery;
+	double spikeMs;
+	double expectedRate;
+};
+
+static const PacingScenario PacingScenarios[] = {
+	{ "60 fps, 5 ms frames", 60.0, 5.0, 0, 0.0, 60.0 },
+	{ "60 fps, 40 ms every 50th frame", 60.0, 5.0, 50, 40.0, 0.0 },
+	{ "144 fps, 8 ms frames", 144.0, 8.0, 0, 0.0, 125.0 },
+	{ "Unlimited, 5 ms frames", 0.0, 5.0, 0, 0.0, 200.0 }
+};
+
+// Debugger output on Windows, where there may be no console, elsewhere it would repeat stdout
+static void Report(const char* report)
+{
+#ifdef _WIN32
+	OutputDebugStringA(report);
+#endif
+	printf("%s", report);
+	fflush(stdout);
+}
+
+// Commands are logged instead of executed, so the time is the one of Update and Render on the CPU
+// Counts are of the last frame, GPU times come from the fake clock of the null device
+int RunHeadless(UINT frameCount)
+{
+	NullRenderDevice device;
+	if (!device.Init(HeadlessWidth, HeadlessHeight))
+	{
+		return 1;
+	}
+	device.SetQueryLatency(HeadlessQueryLatency);
+
+	Renderer renderer;
+	bool succeeded = renderer.Init(&device);
+
+	double totalMs = 0.0;
+	double maxMs = 0.0;
+	UINT frame = 0;
+	for (; frame < frameCount && succeeded; frame++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		succeeded = renderer.Update() && renderer.Render();
+
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		totalMs += ms;
+		maxMs = ms > maxMs ? ms : maxMs;
+	}
+
+	const NullFrameStats& stats = device.GetFrameStats();
+
+	char report[512];
+	sprintf_s(report, "%s device, %u frames: CPU %.3f ms avg, %.3f ms max\n"
+		"Per frame: %u commands, %u draws, %llu triangles, %u binds, %u state changes, %u maps, %u command lists\n",
+		device.GetName(), frame, frame != 0 ? totalMs / frame : 0.0, maxMs,
+		stats.commandCount, stats.drawCount, (unsigned long long)stats.triangleCount, stats.bindCount, stats.stateChanges, stats.mapCount, stats.commandListCount);
+	Report(report);
+	Report(renderer.GetGpuProfiler().FormatStats().c_str());
+
+	renderer.Term();
+	device.Term();
+
+	return succeeded ? 0 : 1;
+}
+
+// Times RenderSoftware only, Update runs the same CPU stages as for the GPU and is timed apart
+static bool RunSoftwareFrames(Renderer& renderer, SoftwareRasterizer& rasterizer, const char* name, UINT frameCount)
+{
+	double updateMs = 0.0;
+	double totalMs = 0.0;
+	double maxMs = 0.0;
+	bool succeeded = true;
+	UINT frame = 0;
+	for (; frame < frameCount && succeeded; frame++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		succeeded = renderer.Update();
+
+		std::chrono::steady_clock::time_point updated = std::chrono::steady_clock::now();
+
+		succeeded = succeeded && renderer.RenderSoftware(rasterizer);
+
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - updated).count();
+		updateMs += std::chrono::duration<double, std::milli>(updated - start).count();
+		totalMs += ms;
+		maxMs = ms > maxMs ? ms : maxMs;
+	}
+
+	const SoftwareRasterizerStats& stats = rasterizer.GetStats();
+	double avgMs = frame != 0 ? totalMs / frame : 0.0;
+
+	char report[512];
+	sprintf_s(report, "Software %ux%u, %s, %u frames: %.1f fps, %.3f ms avg, %.3f ms max, update %.3f ms avg\n"
+		"Per frame: %u draws, %u triangles, %u culled, %u clipped, %u binned, %llu quads, %llu shaded quads, %llu pixels\n",
+		rasterizer.GetWidth(), rasterizer.GetHeight(), name, frame, avgMs > 0.0 ? 1000.0 / avgMs : 0.0, avgMs, maxMs,
+		frame != 0 ? updateMs / frame : 0.0,
+		stats.drawCount, stats.triangleCount, stats.culledCount, stats.clippedCount, stats.binnedCount,
+		(unsigned long long)stats.quadCount, (unsigned long long)stats.shadedQuadCount, (unsigned long long)stats.pixelCount);
+	Report(report);
+
+	return succeeded;
+}
+
+// Renderer runs on the null device for its CPU stages, the frame is drawn by the software rasterizer
+// Both light buckets are measured, the main lights alone and the light field through clusters
+int RunSoftwareBenchmark(UINT frameCount)
+{
+	SoftwareTexture colorTexture;
+	SoftwareTexture normalTexture;
+	std::string errors;
+	if (!colorTexture.Load("Brick.dds", errors) || !normalTexture.Load("BrickNM.dds", errors))
+	{
+		Report(("Software benchmark textures are not available: " + errors + "\n").c_str());
+		return 1;
+	}
+
+	NullRenderDevice device;
+	if (!device.Init(BenchmarkWidth, BenchmarkHeight))
+	{
+		return 1;
+	}
+
+	SoftwareRasterizer rasterizer;
+	rasterizer.Init(BenchmarkWidth, BenchmarkHeight);
+	rasterizer.SetTextures(&colorTexture, &normalTexture);
+
+	Renderer renderer;
+	bool succeeded = renderer.Init(&device);
+
+	succeeded = succeeded && RunSoftwareFrames(renderer, rasterizer, "direct lights", frameCount);
+
+	renderer.SwitchLightField();
+	succeeded = succeeded && RunSoftwareFrames(renderer, rasterizer, "clustered lights", frameCount);
+
+	renderer.Term();
+	rasterizer.Term();
+	device.Term();
+
+	return succeeded ? 0 : 1;
+}
+
+// Frames as in the software benchmark, with markers recorded for all of them
+int RunProfile(UINT frameCount)
+{
+	Profiler::SetThreadName("Main");
+
+	SoftwareTexture colorTexture;
+	SoftwareTexture normalTexture;
+	std::string errors;
+	if (!colorTexture.Load("Brick.dds", errors) || !normalTexture.Load("BrickNM.dds", errors))
+	{
+		Report(("Profile textures are not available: " + errors + "\n").c_str());
+		return 1;
+	}
+
+	// Creation of resources is in the trace too
+	Profiler::Start();
+
+	NullRenderDevice device;
+	if (!device.Init(HeadlessWidth, HeadlessHeight))
+	{
+		Profiler::Stop();
+		return 1;
+	}
+
+	SoftwareRasterizer rasterizer;
+	rasterizer.Init(HeadlessWidth, HeadlessHeight);
+	rasterizer.SetTextures(&colorTexture, &normalTexture);
+
+	Renderer renderer;
+	bool succeeded = renderer.Init(&device);
+
+	UINT frame = 0;
+	for (; frame < frameCount && succeeded; frame++)
+	{
+		PROFILE_SCOPE("Frame");
+
+		succeeded = renderer.Update() && renderer.Render() && renderer.RenderSoftware(rasterizer);
+	}
+
+	Profiler::Stop();
+
+	renderer.Term();
+	rasterizer.Term();
+	device.Term();
+
+	bool written = Profiler::WriteChromeTrace(ProfileTraceFile);
+
+	char report[256];
+	sprintf_s(report, "%u frames, trace %s %s, %u events dropped\n", frame, ProfileTraceFile,
+		written ? "written" : "not written", Profiler::GetDroppedCount());
+	Report(report);
+
+	return succeeded && written ? 0 : 1;
+}
+
+// Input arrives at random times since the previous frame read it, frame work advances the clock
+static void SimulatePacing(const PacingScenario& scenario, IFrameClock& clock, FramePacer& pacer, UINT frameCount)
+{
+	uint32_t random = 1;
+	int64_t readTime = clock.GetTime();
+	for (UINT frame = 0; frame < frameCount; frame++)
+	{
+		pacer.BeginFrame();
+
+		int64_t now = clock.GetTime();
+		random = random * 1664525 + 1013904223;
+		pacer.AddInput(readTime + (int64_t)((now - readTime) * ((random >> 8) / 16777216.0)));
+		readTime = now;
+
+		bool spike = scenario.spikeEvery != 0 && frame % scenario.spikeEvery == scenario.spikeEvery - 1;
+		clock.SleepUntil(now + (int64_t)((spike ? scenario.spikeMs : scenario.workMs) * 1.0e6));
+
+		pacer.Present();
+	}
+}
+
+// Scenarios run on the simulated clock, so they take no time and give the same results everywhere
+// Last one runs on the system clock and shows how close its sleeps get
+int RunPacingSimulation()
+{
+	bool succeeded = true;
+	for (const PacingScenario& scenario : PacingScenarios)
+	{
+		SimulatedFrameClock clock;
+		FramePacer pacer(&clock);
+		pacer.SetTargetFrameRate(scenario.frameRate);
+
+		SimulatePacing(scenario, clock, pacer, PacingFrameCount);
+
+		double intervalMs = pacer.GetFrameIntervals().GetAverage();
+		double rate = intervalMs > 0.0 ? 1000.0 / intervalMs : 0.0;
+		bool passed = scenario.expectedRate == 0.0 || fabs(rate - scenario.expectedRate) <= scenario.expectedRate * PacingRateTolerance;
+		succeeded = succeeded && passed;
+
+		Report(("Simulated " + std::string(scenario.name) + (passed ? "" : ", rate is off") + "\n" + pacer.FormatStats()).c_str());
+	}
+
+	SystemFrameClock clock;
+	FramePacer pacer(&clock);
+	pacer.SetTargetFrameRate(PacingScenarios[0].frameRate);
+
+	SimulatePacing(PacingScenarios[0], clock, pacer, SystemPacingFrameCount);
+
+	Report(("System clock " + std::string(PacingScenarios[0].name) + "\n" + pacer.FormatStats()).c_str());
+
+	return succeeded ? 0 : 1;
+}
+
+#ifndef _WIN32
+
+// Without a window only the headless modes are there:
+// "-null [frames]", "-software [frames]", "-profile [frames]", "-pacing" and "-regression [record]"
+int main(int argc, char** argv)
+{
+	if (argc > 1 && strcmp(argv[1], "-pacing") == 0)
+	{
+		return RunPacingSimulation();
+	}
+	if (argc > 1 && strcmp(argv[1], "-regression") == 0)
+	{
+		return RunRegression(argc > 2 && strcmp(argv[2], "record") == 0);
+	}
+
+	int frameCount = argc > 2 ? atoi(argv[2]) : 0;
+	if (argc > 1 && strcmp(argv[1], "-software") == 0)
+	{
+		return RunSoftwareBenchmark(frameCount > 0 ? (UINT)frameCount : 100);
+	}
+	if (argc > 1 && strcmp(argv[1], "-profile") == 0)
+	{
+		return RunProfile(frameCount > 0 ? (UINT)frameCount : 100);
+	}
+
+	return RunHeadless(frameCount > 0 ? (UINT)frameCount : 1000);
+}
+
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Platform.h"
+
+// Modes which run without a window, on Windows from the command line of the app
+// Elsewhere they are all there is, see main in Headless.cpp
+
+// Renders frames on the null device and reports their CPU cost, and GPU pass times of its fake clock
+int RunHeadless(UINT frameCount);
+
+// Renders frames with the software rasterizer at 1080p and reports frames per second
+// Brick.dds and BrickNM.dds are read from the working directory
+int RunSoftwareBenchmark(UINT frameCount);
+
+// Renders frames as RunSoftwareBenchmark at 720p with CPU markers recorded, the trace goes to Profile.json
+int RunProfile(UINT frameCount);
+
+// Runs the frame pacer on a simulated clock through frames of several loads and reports rates and input latency
+// Returns 0 when the rates are the expected ones
+int RunPacingSimulation();
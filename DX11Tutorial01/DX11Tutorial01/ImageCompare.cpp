@@ -0,0 +1,132 @@
+#include "ImageCompare.h"
+
+#include <math.h>
+
+struct LabColor
+{
+	float l;
+	float a;
+	float b;
+};
+
+static float LabCurve(float t)
+{
+	return t > 216.0f / 24389.0f ? cbrtf(t) : (24389.0f / 27.0f * t + 16.0f) / 116.0f;
+}
+
+// sRGB with D65 white
+static void ConvertToLab(const Image& image, std::vector<LabColor>& lab)
+{
+	float linear[256];
+	for (int i = 0; i < 256; i++)
+	{
+		float c = i / 255.0f;
+		linear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	size_t count = (size_t)image.width * image.height;
+	lab.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		const uint8_t* pPixel = &image.pixels[i * 4];
+		float r = linear[pPixel[0]];
+		float g = linear[pPixel[1]];
+		float b = linear[pPixel[2]];
+
+		float x = LabCurve((0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.95047f);
+		float y = LabCurve(0.2126f * r + 0.7152f * g + 0.0722f * b);
+		float z = LabCurve((0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.08883f);
+
+		lab[i].l = 116.0f * y - 16.0f;
+		lab[i].a = 500.0f * (x - y);
+		lab[i].b = 200.0f * (y - z);
+	}
+}
+
+// Graphic arts weights, reference is the golden color
+static float DeltaE94(const LabColor& reference, const LabColor& color)
+{
+	float c1 = sqrtf(reference.a * reference.a + reference.b * reference.b);
+	float c2 = sqrtf(color.a * color.a + color.b * color.b);
+	float dl = reference.l - color.l;
+	float dc = c1 - c2;
+	float da = reference.a - color.a;
+	float db = reference.b - color.b;
+	float dh2 = da * da + db * db - dc * dc;
+
+	float sc = 1.0f + 0.045f * c1;
+	float sh = 1.0f + 0.015f * c1;
+	return sqrtf(dl * dl + (dc / sc) * (dc / sc) + (dh2 > 0.0f ? dh2 : 0.0f) / (sh * sh));
+}
+
+bool CompareImages(const Image& golden, const Image& image, const ImageTolerance& tolerance, ImageDifference& difference, Image* pDiff)
+{
+	if (golden.width != image.width || golden.height != image.height
+		|| golden.pixels.size() != image.pixels.size() || image.pixels.size() != (size_t)image.width * image.height * 4)
+	{
+		return false;
+	}
+
+	std::vector<LabColor> goldenLab;
+	std::vector<LabColor> imageLab;
+	ConvertToLab(golden, goldenLab);
+	ConvertToLab(image, imageLab);
+
+	if (pDiff != NULL)
+	{
+		pDiff->width = image.width;
+		pDiff->height = image.height;
+		pDiff->pixels.resize(image.pixels.size());
+	}
+
+	const int width = (int)image.width;
+	const int height = (int)image.height;
+	const int radius = (int)tolerance.radius;
+
+	double totalDeltaE = 0.0;
+	difference.badPixels = 0;
+	difference.maxDeltaE = 0.0f;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			const LabColor& color = imageLab[y * width + x];
+			float deltaE = DeltaE94(goldenLab[y * width + x], color);
+
+			// Closest golden pixel around, only when the one in place differs
+			for (int ny = y - radius; ny <= y + radius && deltaE > tolerance.maxDeltaE; ny++)
+			{
+				for (int nx = x - radius; nx <= x + radius; nx++)
+				{
+					if (nx >= 0 && ny >= 0 && nx < width && ny < height)
+					{
+						float neighbor = DeltaE94(goldenLab[ny * width + nx], color);
+						deltaE = neighbor < deltaE ? neighbor : deltaE;
+					}
+				}
+			}
+
+			bool bad = deltaE > tolerance.maxDeltaE;
+			difference.badPixels += bad ? 1 : 0;
+			difference.maxDeltaE = deltaE > difference.maxDeltaE ? deltaE : difference.maxDeltaE;
+			totalDeltaE += deltaE;
+
+			if (pDiff != NULL)
+			{
+				uint8_t* pPixel = &pDiff->pixels[(y * width + x) * 4];
+				uint8_t gray = (uint8_t)(color.l * 255.0f / 100.0f * 0.5f + 0.5f);
+				pPixel[0] = bad ? 255 : gray;
+				pPixel[1] = bad ? 0 : gray;
+				pPixel[2] = bad ? 0 : gray;
+				pPixel[3] = 255;
+			}
+		}
+	}
+
+	size_t count = (size_t)width * height;
+	difference.badFraction = count != 0 ? (float)difference.badPixels / count : 0.0f;
+	difference.meanDeltaE = count != 0 ? (float)(totalDeltaE / count) : 0.0f;
+	difference.passed = difference.badFraction <= tolerance.maxBadFraction;
+
+	return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "DDSImage.h"
+
+struct ImageTolerance
+{
+	float maxDeltaE;      // CIE94 color difference a pixel may have, 2.3 is about just noticeable
+	float maxBadFraction; // Part of the pixels which may be over maxDeltaE
+	unsigned int radius;  // Pixels match golden ones this far away, so edges moved by rounding are not counted
+};
+
+struct ImageDifference
+{
+	unsigned int badPixels; // Over maxDeltaE
+	float badFraction;
+	float maxDeltaE;
+	float meanDeltaE;
+	bool passed;
+};
+
+// Perceptual comparison of RGBA8 images, colors are taken as sRGB and compared in CIELAB, alpha is ignored
+// Fails when the sizes differ, difference is then not filled
+// Diff image, when given, is the image in gray with pixels over the tolerance in red
+bool CompareImages(const Image& golden, const Image& image, const ImageTolerance& tolerance, ImageDifference& difference, Image* pDiff);
@@ -0,0 +1,40 @@
+#include "InstancePacker.h"
+
+#include <assert.h>
+
+using namespace DirectX;
+
+void PackInstances(const XMFLOAT4X4* pModel, const XMFLOAT4X4* pNormal, unsigned int count, InstanceData* pDst)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		pDst[i].modelMatrix = pModel[i];
+		pDst[i].normalMatrix = pNormal[i];
+	}
+}
+
+unsigned int DrawInstances(IRenderContext* pContext, RenderResource* pInstanceBuffer, unsigned int bufferCapacity, unsigned int indexCount,
+	const XMFLOAT4X4* pModel, const XMFLOAT4X4* pNormal, unsigned int count)
+{
+	unsigned int drawCount = 0;
+	for (unsigned int first = 0; first < count; first += bufferCapacity)
+	{
+		unsigned int batchCount = count - first < bufferCapacity ? count - first : bufferCapacity;
+
+		void* pData = NULL;
+		HRESULT result = pContext->Map(pInstanceBuffer, MAP_WRITE_DISCARD, &pData);
+		assert(SUCCEEDED(result));
+		if (FAILED(result))
+		{
+			break;
+		}
+
+		PackInstances(pModel + first, pNormal + first, batchCount, (InstanceData*)pData);
+		pContext->Unmap(pInstanceBuffer);
+
+		pContext->DrawIndexedInstanced(indexCount, batchCount, 0, 0, 0);
+		drawCount++;
+	}
+
+	return drawCount;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include "RenderDevice.h"
+
+// Per-instance data as laid out in the instance vertex buffer
+// Matrices are stored transposed as in ModelBuffer, so HLSL rebuilds them with transpose(float4x4(...))
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 modelMatrix;
+	DirectX::XMFLOAT4X4 normalMatrix;
+};
+
+// Pack model and normal matrices of count objects into GPU instance layout
+// Inputs are in the layout produced by ComputeModelNormalMatrices
+// pDst may point to write-combined memory, so it is written strictly sequentially and never read
+void PackInstances(const DirectX::XMFLOAT4X4* pModel, const DirectX::XMFLOAT4X4* pNormal, unsigned int count, InstanceData* pDst);
+
+// Draw count instances of an indexed mesh from a dynamic instance buffer which holds bufferCapacity of them
+// Larger counts are drawn in batches, each one discards the buffer and packs its instances into it
+// Returns the number of draws
+unsigned int DrawInstances(IRenderContext* pContext, RenderResource* pInstanceBuffer, unsigned int bufferCapacity, unsigned int indexCount,
+	const DirectX::XMFLOAT4X4* pModel, const DirectX::XMFLOAT4X4* pNormal, unsigned int count);
@@ -0,0 +1,430 @@
+#include "JobSystem.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+
+#include "Profiler.h"
+
+// Failed attempts to find a job before an idle worker goes to sleep
+static const unsigned int SpinCount = 64;
+
+// Worker index is only meaningful for the system it was given by
+static thread_local const JobSystem* t_pJobSystem = NULL;
+static thread_local unsigned int t_workerIndex = JobSystem::NoWorker;
+
+WorkStealingDeque::WorkStealingDeque()
+	: m_mask(0)
+	, m_top(0)
+	, m_bottom(0)
+{
+}
+
+void WorkStealingDeque::Init(unsigned int capacity)
+{
+	assert(capacity != 0 && (capacity & (capacity - 1)) == 0);
+
+	m_jobs.reset(new std::atomic<Job*>[capacity]);
+	m_mask = capacity - 1;
+	m_top = 0;
+	m_bottom = 0;
+}
+
+bool WorkStealingDeque::Push(Job* pJob)
+{
+	int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+	int64_t top = m_top.load(std::memory_order_acquire);
+	if (bottom - top > m_mask)
+	{
+		return false;
+	}
+
+	// Release makes the job visible to a thief which sees the new bottom
+	m_jobs[bottom & m_mask].store(pJob, std::memory_order_relaxed);
+	m_bottom.store(bottom + 1, std::memory_order_release);
+
+	return true;
+}
+
+Job* WorkStealingDeque::Pop()
+{
+	int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	m_bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = m_top.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		// Empty
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return NULL;
+	}
+
+	Job* pJob = m_jobs[bottom & m_mask].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		// Last job, race with thieves for it
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			pJob = NULL;
+		}
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	return pJob;
+}
+
+Job* WorkStealingDeque::Steal()
+{
+	int64_t top = m_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+	if (top >= bottom)
+	{
+		return NULL;
+	}
+
+	Job* pJob = m_jobs[top & m_mask].load(std::memory_order_relaxed);
+	if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		return NULL;
+	}
+
+	return pJob;
+}
+
+JobSystem::JobSystem()
+	: m_firstAttached(0)
+	, m_sleeping(0)
+	, m_quit(false)
+{
+}
+
+JobSystem::~JobSystem()
+{
+	Term();
+}
+
+void JobSystem::Init(unsigned int workerCount, unsigned int attachedCount)
+{
+	assert(m_workers.empty());
+
+	workerCount = workerCount > 0 ? workerCount : 1;
+	for (unsigned int i = 0; i < workerCount + attachedCount; i++)
+	{
+		std::unique_ptr<Worker> worker(new Worker());
+		worker->deque.Init(MaxJobsPerWorker);
+		worker->jobs.reset(new Job[MaxJobsPerWorker]);
+		worker->allocated = 0;
+		worker->random = i * 2654435761u + 1;
+		worker->attached = false;
+		for (unsigned int j = 0; j < MaxJobsPerWorker; j++)
+		{
+			worker->jobs[j].unfinished = 0;
+		}
+		m_workers.push_back(std::move(worker));
+	}
+
+	m_firstAttached = workerCount;
+	m_quit = false;
+	t_pJobSystem = this;
+	t_workerIndex = 0;
+	for (unsigned int i = 1; i < workerCount; i++)
+	{
+		m_threads.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+}
+
+void JobSystem::Term()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+	m_threads.clear();
+	m_workers.clear();
+	m_firstAttached = 0;
+
+	if (t_pJobSystem == this)
+	{
+		t_pJobSystem = NULL;
+		t_workerIndex = NoWorker;
+	}
+}
+
+unsigned int JobSystem::GetWorkerIndex() const
+{
+	return IsWorker() ? t_workerIndex : NoWorker;
+}
+
+bool JobSystem::IsWorker() const
+{
+	return t_pJobSystem == this && t_workerIndex < m_workers.size();
+}
+
+bool JobSystem::Attach()
+{
+	// Worker of this system or another one, which would lose its worker
+	if (t_pJobSystem != NULL)
+	{
+		fprintf(stderr, "JobSystem::Attach called on a thread which is already a worker\n");
+		abort();
+	}
+
+	// Acquire pairs with the release of Detach, so the job ring is seen as the previous thread left it
+	for (unsigned int i = m_firstAttached; i < m_workers.size(); i++)
+	{
+		bool attached = false;
+		if (m_workers[i]->attached.compare_exchange_strong(attached, true, std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			t_pJobSystem = this;
+			t_workerIndex = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::Detach()
+{
+	RequireWorker("Detach");
+	if (t_workerIndex < m_firstAttached)
+	{
+		fprintf(stderr, "JobSystem::Detach called on worker %u, which is not attached\n", t_workerIndex);
+		abort();
+	}
+
+	m_workers[t_workerIndex]->attached.store(false, std::memory_order_release);
+	t_pJobSystem = NULL;
+	t_workerIndex = NoWorker;
+}
+
+Job* JobSystem::CreateJob(const std::function<void()>& function, Job* pParent)
+{
+	RequireWorker("CreateJob");
+
+	Worker& worker = *m_workers[t_workerIndex];
+
+	Job* pJob = &worker.jobs[worker.allocated++ & (MaxJobsPerWorker - 1)];
+	assert(pJob->unfinished.load(std::memory_order_relaxed) == 0);
+
+	pJob->function = function;
+	pJob->pParent = pParent;
+	pJob->unfinished.store(1, std::memory_order_relaxed);
+	pJob->pending.store(1, std::memory_order_relaxed);
+	pJob->dependentCount = 0;
+
+	if (pParent != NULL)
+	{
+		pParent->unfinished.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return pJob;
+}
+
+void JobSystem::AddDependency(Job* pJob, Job* pDependency)
+{
+	assert(pDependency->dependentCount < Job::MaxDependents);
+
+	pJob->pending.fetch_add(1, std::memory_order_relaxed);
+	pDependency->dependents[pDependency->dependentCount++] = pJob;
+}
+
+void JobSystem::Run(Job* pJob)
+{
+	RequireWorker("Run");
+
+	if (pJob->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		Push(pJob);
+	}
+}
+
+void JobSystem::Wait(Job* pJob)
+{
+	RequireWorker("Wait");
+
+	unsigned int worker = t_workerIndex;
+	while (!IsFinished(pJob))
+	{
+		Job* pOther = GetJob(worker);
+		if (pOther != NULL)
+		{
+			Execute(pOther);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::ParallelFor(unsigned int count, unsigned int batchSize, const std::function<void(unsigned int first, unsigned int count)>& function)
+{
+	RequireWorker("ParallelFor");
+
+	if (count == 0)
+	{
+		return;
+	}
+	unsigned int maxBatches = GetWorkerCount() * BatchesPerWorker;
+	unsigned int minBatchSize = (count + maxBatches - 1) / maxBatches;
+	batchSize = batchSize > minBatchSize ? batchSize : minBatchSize;
+
+	// Single batch does not need scheduling
+	if (count <= batchSize)
+	{
+		function(0, count);
+		return;
+	}
+
+	Job* pRoot = CreateJob(std::function<void()>());
+	for (unsigned int first = 0; first < count; first += batchSize)
+	{
+		unsigned int batchCount = count - first < batchSize ? count - first : batchSize;
+		Run(CreateJob([&function, first, batchCount] { function(first, batchCount); }, pRoot));
+	}
+	Run(pRoot);
+
+	Wait(pRoot);
+}
+
+void JobSystem::WorkerLoop(unsigned int worker)
+{
+	t_pJobSystem = this;
+	t_workerIndex = worker;
+
+	char name[32];
+	snprintf(name, sizeof(name), "Job worker %u", worker);
+	Profiler::SetThreadName(name);
+
+	unsigned int idle = 0;
+	while (!m_quit.load(std::memory_order_relaxed))
+	{
+		Job* pJob = GetJob(worker);
+		if (pJob != NULL)
+		{
+			Execute(pJob);
+			idle = 0;
+		}
+		else if (++idle < SpinCount)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			// Timeout covers wakeups missed between the check and the wait
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			if (!m_quit)
+			{
+				m_sleeping++;
+				m_wake.wait_for(lock, std::chrono::milliseconds(1));
+				m_sleeping--;
+			}
+		}
+	}
+}
+
+// Worker state of another thread or system would be corrupted, so this is not left to assert
+void JobSystem::RequireWorker(const char* pCall) const
+{
+	if (!IsWorker())
+	{
+		fprintf(stderr, "JobSystem::%s called on a thread which is not a worker of this system\n", pCall);
+		abort();
+	}
+}
+
+void JobSystem::Push(Job* pJob)
+{
+	Worker& worker = *m_workers[t_workerIndex];
+	if (!worker.deque.Push(pJob))
+	{
+		// Deque is full, run in place
+		Execute(pJob);
+		return;
+	}
+
+	if (m_sleeping.load(std::memory_order_relaxed) > 0)
+	{
+		m_wake.notify_one();
+	}
+}
+
+Job* JobSystem::GetJob(unsigned int worker)
+{
+	Worker& self = *m_workers[worker];
+
+	Job* pJob = self.deque.Pop();
+	if (pJob != NULL)
+	{
+		return pJob;
+	}
+
+	// Steal starting from a random victim
+	unsigned int workerCount = (unsigned int)m_workers.size();
+	self.random = self.random * 1664525u + 1013904223u;
+	unsigned int start = (self.random >> 16) % workerCount;
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		unsigned int victim = (start + i) % workerCount;
+		if (victim == worker)
+		{
+			continue;
+		}
+
+		pJob = m_workers[victim]->deque.Steal();
+		if (pJob != NULL)
+		{
+			return pJob;
+		}
+	}
+
+	return NULL;
+}
+
+void JobSystem::Execute(Job* pJob)
+{
+	if (pJob->function)
+	{
+		pJob->function();
+	}
+	Finish(pJob);
+}
+
+void JobSystem::Finish(Job* pJob)
+{
+	// Read everything needed before the job may be reused
+	Job* pParent = pJob->pParent;
+	unsigned int dependentCount = pJob->dependentCount;
+	Job* dependents[Job::MaxDependents];
+	for (unsigned int i = 0; i < dependentCount; i++)
+	{
+		dependents[i] = pJob->dependents[i];
+	}
+
+	if (pJob->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1)
+	{
+		return;
+	}
+
+	for (unsigned int i = 0; i < dependentCount; i++)
+	{
+		Run(dependents[i]);
+	}
+
+	if (pParent != NULL)
+	{
+		Finish(pParent);
+	}
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job
+{
+	static const unsigned int MaxDependents = 8;
+
+	std::function<void()> function;
+	Job* pParent;
+
+	std::atomic<int> unfinished; // Job itself plus its unfinished children
+	std::atomic<int> pending;    // Unfinished dependencies plus one until the job is run
+
+	Job* dependents[MaxDependents];
+	unsigned int dependentCount;
+};
+
+// Chase-Lev work stealing deque of fixed capacity
+// Owner pushes and pops at the bottom, other threads steal from the top
+class WorkStealingDeque
+{
+public:
+	WorkStealingDeque();
+
+	void Init(unsigned int capacity);
+
+	bool Push(Job* pJob);
+	Job* Pop();
+	Job* Steal();
+
+private:
+	std::unique_ptr<std::atomic<Job*>[]> m_jobs;
+	int64_t m_mask;
+
+	std::atomic<int64_t> m_top;
+	std::atomic<int64_t> m_bottom;
+};
+
+// Work stealing job scheduler with one deque per worker
+// The thread which calls Init is worker 0, only workers may create, run and wait for jobs
+// Calls from other threads abort, in release builds too
+// Threads the system does not own, like texture loaders, may become workers with Attach
+// A thread is a worker of one system at a time
+class JobSystem
+{
+public:
+	static const unsigned int MaxJobsPerWorker = 4096;
+	static const unsigned int BatchesPerWorker = 8;
+	static const unsigned int NoWorker = 0xFFFFFFFF;
+
+	JobSystem();
+	~JobSystem();
+
+	// attachedCount workers have no thread of their own, they are left for Attach
+	void Init(unsigned int workerCount, unsigned int attachedCount = 0);
+	void Term();
+
+	// Attached workers included
+	unsigned int GetWorkerCount() const { return (unsigned int)m_workers.size(); }
+	// Index of the calling worker, NoWorker on threads which are not workers of this system
+	unsigned int GetWorkerIndex() const;
+	bool IsWorker() const;
+
+	// Calling thread takes a free attached worker until Detach, fails when all of them are taken
+	bool Attach();
+	// Jobs the thread waited for are finished, others left in its deque are stolen by the rest
+	void Detach();
+
+	// Job is finished when its function and all children are finished
+	// Jobs come from a per-worker ring, so no more than MaxJobsPerWorker may be alive on one worker
+	Job* CreateJob(const std::function<void()>& function, Job* pParent = NULL);
+	// pJob is started after pDependency is finished, neither of them may be run yet
+	void AddDependency(Job* pJob, Job* pDependency);
+	void Run(Job* pJob);
+
+	// Executes other jobs while waiting
+	void Wait(Job* pJob);
+	bool IsFinished(const Job* pJob) const { return pJob->unfinished.load(std::memory_order_acquire) == 0; }
+
+	// Call function for batches of at least batchSize items and wait for all of them
+	// Batches are enlarged so that there are no more than BatchesPerWorker per worker
+	void ParallelFor(unsigned int count, unsigned int batchSize, const std::function<void(unsigned int first, unsigned int count)>& function);
+
+private:
+	struct Worker
+	{
+		WorkStealingDeque deque;
+		std::unique_ptr<Job[]> jobs;
+		unsigned int allocated;
+		unsigned int random;
+		std::atomic<bool> attached; // Taken by a thread, attached workers only
+	};
+
+	void WorkerLoop(unsigned int worker);
+	void RequireWorker(const char* pCall) const;
+
+	void Push(Job* pJob);
+	Job* GetJob(unsigned int worker);
+	void Execute(Job* pJob);
+	void Finish(Job* pJob);
+
+private:
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::vector<std::thread> m_threads;
+	unsigned int m_firstAttached;
+
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wake;
+	std::atomic<int> m_sleeping;
+	std::atomic<bool> m_quit;
+};
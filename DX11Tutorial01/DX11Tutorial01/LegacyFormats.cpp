@@ -0,0 +1,415 @@
+#include "LegacyFormats.h"
+
+#include <assert.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define LEGACY_FORMATS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define LEGACY_FORMATS_NEON
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang compile intrinsics only inside functions built for the instruction set
+#if defined(LEGACY_FORMATS_X86) && !defined(_MSC_VER)
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#endif
+
+// Bits forced on in every 32 bit word of the converted data
+static uint32_t GetAlphaPattern(LegacyFormat format)
+{
+	switch (format)
+	{
+	case LEGACY_FORMAT_X8B8G8R8:
+		return 0xff000000;
+	case LEGACY_FORMAT_X1R5G5B5:
+		return 0x80008000;
+	case LEGACY_FORMAT_X4R4G4B4:
+		return 0xf000f000;
+	default:
+		return 0;
+	}
+}
+
+unsigned int GetLegacySourceSize(LegacyFormat format)
+{
+	switch (format)
+	{
+	case LEGACY_FORMAT_R8G8B8:
+	case LEGACY_FORMAT_B8G8R8:
+		return 3;
+	case LEGACY_FORMAT_X8B8G8R8:
+		return 4;
+	case LEGACY_FORMAT_X1R5G5B5:
+	case LEGACY_FORMAT_X4R4G4B4:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+unsigned int GetLegacyTargetSize(LegacyFormat format)
+{
+	switch (format)
+	{
+	case LEGACY_FORMAT_R8G8B8:
+	case LEGACY_FORMAT_B8G8R8:
+	case LEGACY_FORMAT_X8B8G8R8:
+		return 4;
+	case LEGACY_FORMAT_X1R5G5B5:
+	case LEGACY_FORMAT_X4R4G4B4:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+//
+// Scalar reference, also used for the tails of vector loops
+//
+
+// swap - source has blue in the lowest byte
+static void ExpandRGB24Scalar(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount, bool swap)
+{
+	const int r = swap ? 2 : 0;
+	const int b = swap ? 0 : 2;
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		pDst[0] = pSrc[r];
+		pDst[1] = pSrc[1];
+		pDst[2] = pSrc[b];
+		pDst[3] = 0xff;
+		pSrc += 3;
+		pDst += 4;
+	}
+}
+
+// Data is little endian, so byte i of the pattern goes to every byte with the same offset in a word
+static void SetAlphaScalar(const uint8_t* pSrc, uint8_t* pDst, size_t byteCount, uint32_t pattern)
+{
+	for (size_t i = 0; i < byteCount; i++)
+	{
+		pDst[i] = pSrc[i] | (uint8_t)(pattern >> (i % 4 * 8));
+	}
+}
+
+//
+// SSSE3 and AVX2
+//
+
+#ifdef LEGACY_FORMATS_X86
+// Moves four 3 byte pixels from the low 12 bytes to 4 byte slots, alpha slots are cleared
+static __m128i GetExpandMask(bool swap)
+{
+	return swap
+		? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+		: _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+}
+
+// 16 pixels per iteration from three loads, so nothing is read past the source
+TARGET_SSSE3
+static size_t ExpandRGB24SSSE3(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount, bool swap)
+{
+	const __m128i mask = GetExpandMask(swap);
+	const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+
+	size_t i = 0;
+	for (; i + 16 <= pixelCount; i += 16)
+	{
+		const __m128i v0 = _mm_loadu_si128((const __m128i*)(pSrc + 0));
+		const __m128i v1 = _mm_loadu_si128((const __m128i*)(pSrc + 16));
+		const __m128i v2 = _mm_loadu_si128((const __m128i*)(pSrc + 32));
+
+		const __m128i p0 = v0;
+		const __m128i p1 = _mm_alignr_epi8(v1, v0, 12);
+		const __m128i p2 = _mm_alignr_epi8(v2, v1, 8);
+		const __m128i p3 = _mm_srli_si128(v2, 4);
+
+		_mm_storeu_si128((__m128i*)(pDst + 0), _mm_or_si128(_mm_shuffle_epi8(p0, mask), alpha));
+		_mm_storeu_si128((__m128i*)(pDst + 16), _mm_or_si128(_mm_shuffle_epi8(p1, mask), alpha));
+		_mm_storeu_si128((__m128i*)(pDst + 32), _mm_or_si128(_mm_shuffle_epi8(p2, mask), alpha));
+		_mm_storeu_si128((__m128i*)(pDst + 48), _mm_or_si128(_mm_shuffle_epi8(p3, mask), alpha));
+
+		pSrc += 48;
+		pDst += 64;
+	}
+	return i;
+}
+
+TARGET_SSSE3
+static size_t SetAlphaSSSE3(const uint8_t* pSrc, uint8_t* pDst, size_t byteCount, uint32_t pattern)
+{
+	const __m128i alpha = _mm_set1_epi32((int)pattern);
+
+	size_t i = 0;
+	for (; i + 64 <= byteCount; i += 64)
+	{
+		const __m128i v0 = _mm_loadu_si128((const __m128i*)(pSrc + i + 0));
+		const __m128i v1 = _mm_loadu_si128((const __m128i*)(pSrc + i + 16));
+		const __m128i v2 = _mm_loadu_si128((const __m128i*)(pSrc + i + 32));
+		const __m128i v3 = _mm_loadu_si128((const __m128i*)(pSrc + i + 48));
+		_mm_storeu_si128((__m128i*)(pDst + i + 0), _mm_or_si128(v0, alpha));
+		_mm_storeu_si128((__m128i*)(pDst + i + 16), _mm_or_si128(v1, alpha));
+		_mm_storeu_si128((__m128i*)(pDst + i + 32), _mm_or_si128(v2, alpha));
+		_mm_storeu_si128((__m128i*)(pDst + i + 48), _mm_or_si128(v3, alpha));
+	}
+	for (; i + 16 <= byteCount; i += 16)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i*)(pSrc + i));
+		_mm_storeu_si128((__m128i*)(pDst + i), _mm_or_si128(v, alpha));
+	}
+	return i;
+}
+
+// Shuffles stay within 128 bit lanes, so each lane is loaded with its own 12 bytes
+// Every lane load reads 16 bytes, loop stops early enough not to read past the source
+TARGET_AVX2
+static size_t ExpandRGB24AVX2(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount, bool swap)
+{
+	const __m256i mask = _mm256_broadcastsi128_si256(GetExpandMask(swap));
+	const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+
+	size_t i = 0;
+	for (; i + 16 + 2 <= pixelCount; i += 16)
+	{
+		const __m256i v0 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(pSrc + 0))),
+			_mm_loadu_si128((const __m128i*)(pSrc + 12)), 1);
+		const __m256i v1 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(pSrc + 24))),
+			_mm_loadu_si128((const __m128i*)(pSrc + 36)), 1);
+
+		_mm256_storeu_si256((__m256i*)(pDst + 0), _mm256_or_si256(_mm256_shuffle_epi8(v0, mask), alpha));
+		_mm256_storeu_si256((__m256i*)(pDst + 32), _mm256_or_si256(_mm256_shuffle_epi8(v1, mask), alpha));
+
+		pSrc += 48;
+		pDst += 64;
+	}
+	return i;
+}
+
+TARGET_AVX2
+static size_t SetAlphaAVX2(const uint8_t* pSrc, uint8_t* pDst, size_t byteCount, uint32_t pattern)
+{
+	const __m256i alpha = _mm256_set1_epi32((int)pattern);
+
+	size_t i = 0;
+	for (; i + 128 <= byteCount; i += 128)
+	{
+		const __m256i v0 = _mm256_loadu_si256((const __m256i*)(pSrc + i + 0));
+		const __m256i v1 = _mm256_loadu_si256((const __m256i*)(pSrc + i + 32));
+		const __m256i v2 = _mm256_loadu_si256((const __m256i*)(pSrc + i + 64));
+		const __m256i v3 = _mm256_loadu_si256((const __m256i*)(pSrc + i + 96));
+		_mm256_storeu_si256((__m256i*)(pDst + i + 0), _mm256_or_si256(v0, alpha));
+		_mm256_storeu_si256((__m256i*)(pDst + i + 32), _mm256_or_si256(v1, alpha));
+		_mm256_storeu_si256((__m256i*)(pDst + i + 64), _mm256_or_si256(v2, alpha));
+		_mm256_storeu_si256((__m256i*)(pDst + i + 96), _mm256_or_si256(v3, alpha));
+	}
+	for (; i + 32 <= byteCount; i += 32)
+	{
+		const __m256i v = _mm256_loadu_si256((const __m256i*)(pSrc + i));
+		_mm256_storeu_si256((__m256i*)(pDst + i), _mm256_or_si256(v, alpha));
+	}
+	return i;
+}
+
+static bool IsSSSE3Supported()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 9)) != 0;
+#else
+	return __builtin_cpu_supports("ssse3") != 0;
+#endif
+}
+
+// Needs OS support for the upper halves of YMM registers, not only the CPU flag
+static bool IsAVX2Supported()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+
+	__cpuid(info, 1);
+	const int OSXSAVE = 1 << 27;
+	const int AVX = 1 << 28;
+	if ((info[2] & (OSXSAVE | AVX)) != (OSXSAVE | AVX) || (_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif // LEGACY_FORMATS_X86
+
+//
+// NEON
+//
+
+#ifdef LEGACY_FORMATS_NEON
+static size_t ExpandRGB24NEON(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount, bool swap)
+{
+	const uint8x16_t alpha = vdupq_n_u8(0xff);
+
+	size_t i = 0;
+	for (; i + 16 <= pixelCount; i += 16)
+	{
+		const uint8x16x3_t src = vld3q_u8(pSrc);
+		uint8x16x4_t dst;
+		dst.val[0] = swap ? src.val[2] : src.val[0];
+		dst.val[1] = src.val[1];
+		dst.val[2] = swap ? src.val[0] : src.val[2];
+		dst.val[3] = alpha;
+		vst4q_u8(pDst, dst);
+
+		pSrc += 48;
+		pDst += 64;
+	}
+	return i;
+}
+
+static size_t SetAlphaNEON(const uint8_t* pSrc, uint8_t* pDst, size_t byteCount, uint32_t pattern)
+{
+	const uint8x16_t alpha = vreinterpretq_u8_u32(vdupq_n_u32(pattern));
+
+	size_t i = 0;
+	for (; i + 64 <= byteCount; i += 64)
+	{
+		const uint8x16_t v0 = vld1q_u8(pSrc + i + 0);
+		const uint8x16_t v1 = vld1q_u8(pSrc + i + 16);
+		const uint8x16_t v2 = vld1q_u8(pSrc + i + 32);
+		const uint8x16_t v3 = vld1q_u8(pSrc + i + 48);
+		vst1q_u8(pDst + i + 0, vorrq_u8(v0, alpha));
+		vst1q_u8(pDst + i + 16, vorrq_u8(v1, alpha));
+		vst1q_u8(pDst + i + 32, vorrq_u8(v2, alpha));
+		vst1q_u8(pDst + i + 48, vorrq_u8(v3, alpha));
+	}
+	for (; i + 16 <= byteCount; i += 16)
+	{
+		vst1q_u8(pDst + i, vorrq_u8(vld1q_u8(pSrc + i), alpha));
+	}
+	return i;
+}
+#endif // LEGACY_FORMATS_NEON
+
+static SimdLevel DetectSimdLevel()
+{
+#if defined(LEGACY_FORMATS_X86)
+	if (IsAVX2Supported())
+	{
+		return SIMD_LEVEL_AVX2;
+	}
+	if (IsSSSE3Supported())
+	{
+		return SIMD_LEVEL_SSSE3;
+	}
+	return SIMD_LEVEL_SCALAR;
+#elif defined(LEGACY_FORMATS_NEON)
+	return SIMD_LEVEL_NEON;
+#else
+	return SIMD_LEVEL_SCALAR;
+#endif
+}
+
+SimdLevel GetSimdLevel()
+{
+	static const SimdLevel level = DetectSimdLevel();
+	return level;
+}
+
+bool IsSimdLevelSupported(SimdLevel level)
+{
+	switch (level)
+	{
+	case SIMD_LEVEL_SCALAR:
+		return true;
+#if defined(LEGACY_FORMATS_X86)
+	case SIMD_LEVEL_SSSE3:
+		return GetSimdLevel() >= SIMD_LEVEL_SSSE3;
+	case SIMD_LEVEL_AVX2:
+		return GetSimdLevel() == SIMD_LEVEL_AVX2;
+#elif defined(LEGACY_FORMATS_NEON)
+	case SIMD_LEVEL_NEON:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+void ConvertLegacyPixels(LegacyFormat format, const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount)
+{
+	ConvertLegacyPixels(format, pSrc, pDst, pixelCount, GetSimdLevel());
+}
+
+void ConvertLegacyPixels(LegacyFormat format, const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount, SimdLevel level)
+{
+	assert(IsSimdLevelSupported(level));
+
+	if (format == LEGACY_FORMAT_R8G8B8 || format == LEGACY_FORMAT_B8G8R8)
+	{
+		const bool swap = format == LEGACY_FORMAT_R8G8B8;
+
+		// Vector loop converts the head, scalar one finishes the rest
+		size_t done = 0;
+		switch (level)
+		{
+#if defined(LEGACY_FORMATS_X86)
+		case SIMD_LEVEL_SSSE3:
+			done = ExpandRGB24SSSE3(pSrc, pDst, pixelCount, swap);
+			break;
+		case SIMD_LEVEL_AVX2:
+			done = ExpandRGB24AVX2(pSrc, pDst, pixelCount, swap);
+			break;
+#elif defined(LEGACY_FORMATS_NEON)
+		case SIMD_LEVEL_NEON:
+			done = ExpandRGB24NEON(pSrc, pDst, pixelCount, swap);
+			break;
+#endif
+		default:
+			break;
+		}
+		ExpandRGB24Scalar(pSrc + done * 3, pDst + done * 4, pixelCount - done, swap);
+	}
+	else
+	{
+		const uint32_t pattern = GetAlphaPattern(format);
+		assert(pattern != 0);
+
+		// Vector loops handle multiples of 16 bytes, so pattern stays aligned to words in the tail
+		const size_t byteCount = pixelCount * GetLegacySourceSize(format);
+		size_t done = 0;
+		switch (level)
+		{
+#if defined(LEGACY_FORMATS_X86)
+		case SIMD_LEVEL_SSSE3:
+			done = SetAlphaSSSE3(pSrc, pDst, byteCount, pattern);
+			break;
+		case SIMD_LEVEL_AVX2:
+			done = SetAlphaAVX2(pSrc, pDst, byteCount, pattern);
+			break;
+#elif defined(LEGACY_FORMATS_NEON)
+		case SIMD_LEVEL_NEON:
+			done = SetAlphaNEON(pSrc, pDst, byteCount, pattern);
+			break;
+#endif
+		default:
+			break;
+		}
+		SetAlphaScalar(pSrc + done, pDst + done, byteCount - done, pattern);
+	}
+}
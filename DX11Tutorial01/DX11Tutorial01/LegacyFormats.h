@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Legacy DDS pixel formats without a DXGI equivalent, converted to the nearest supported one on load
+enum LegacyFormat
+{
+	LEGACY_FORMAT_NONE = 0,
+	LEGACY_FORMAT_R8G8B8,   // 24 bit, blue in the lowest byte, converted to R8G8B8A8
+	LEGACY_FORMAT_B8G8R8,   // 24 bit, red in the lowest byte, converted to R8G8B8A8
+	LEGACY_FORMAT_X8B8G8R8, // Converted to R8G8B8A8 with opaque alpha
+	LEGACY_FORMAT_X1R5G5B5, // Converted to B5G5R5A1 with opaque alpha
+	LEGACY_FORMAT_X4R4G4B4  // Converted to B4G4R4A4 with opaque alpha
+};
+
+enum SimdLevel
+{
+	SIMD_LEVEL_SCALAR = 0,
+	SIMD_LEVEL_SSSE3,
+	SIMD_LEVEL_AVX2,
+	SIMD_LEVEL_NEON
+};
+
+// Bytes per pixel in the file and after conversion
+unsigned int GetLegacySourceSize(LegacyFormat format);
+unsigned int GetLegacyTargetSize(LegacyFormat format);
+
+// Best level supported by the CPU, detected once
+SimdLevel GetSimdLevel();
+bool IsSimdLevelSupported(SimdLevel level);
+
+// Source and destination must not overlap, all levels give the same bytes
+void ConvertLegacyPixels(LegacyFormat format, const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount);
+void ConvertLegacyPixels(LegacyFormat format, const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount, SimdLevel level);
@@ -0,0 +1,235 @@
+#include "LightClusters.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace DirectX;
+
+// Contribution below this is invisible in 8-bit output
+static const float LightCutoffIntensity = 1.0f / 256.0f;
+// First depth slice covers everything closer than this, so tiny near plane does not waste slices
+static const float ClusterNear = 0.1f;
+
+float LightCutoffRadius(const XMFLOAT3& color)
+{
+	float intensity = std::max(color.x, std::max(color.y, color.z));
+
+	// intensity / (0.2 + d^2) = cutoff
+	float distSqr = intensity / LightCutoffIntensity - 0.2f;
+	return distSqr > 0 ? sqrtf(distSqr) : 0.0f;
+}
+
+LightClusters::LightClusters()
+	: m_shaderParams(0, 0, 0, 0)
+	, m_nearPlane(0)
+	, m_farPlane(0)
+	, m_width(0)
+	, m_height(0)
+{
+	memset(&m_proj, 0, sizeof(m_proj));
+}
+
+void LightClusters::Setup(const XMFLOAT4X4& proj, float nearPlane, float farPlane, unsigned int width, unsigned int height)
+{
+	if (memcmp(&proj, &m_proj, sizeof(proj)) == 0 && nearPlane == m_nearPlane && farPlane == m_farPlane && width == m_width && height == m_height)
+	{
+		return;
+	}
+
+	m_proj = proj;
+	m_nearPlane = nearPlane;
+	m_farPlane = farPlane;
+	m_width = width;
+	m_height = height;
+
+	unsigned int tileWidth = (width + CountX - 1) / CountX;
+	unsigned int tileHeight = (height + CountY - 1) / CountY;
+
+	float clusterNear = std::max(ClusterNear, nearPlane);
+	float sliceScale = CountZ / logf(farPlane / clusterNear);
+	m_shaderParams = XMFLOAT4((float)tileWidth, (float)tileHeight, sliceScale, -logf(clusterNear) * sliceScale);
+
+	m_sliceDepths.resize(CountZ + 1);
+	for (unsigned int z = 0; z <= CountZ; z++)
+	{
+		m_sliceDepths[z] = clusterNear * powf(farPlane / clusterNear, (float)z / CountZ);
+	}
+	m_sliceDepths[0] = nearPlane;
+	m_sliceDepths[CountZ] = farPlane;
+
+	// View space bounds of each froxel, x_view = x_ndc * z / proj[0][0]
+	m_clusterBoxes.resize(Count);
+	for (unsigned int z = 0; z < CountZ; z++)
+	{
+		float z0 = m_sliceDepths[z];
+		float z1 = m_sliceDepths[z + 1];
+		for (unsigned int y = 0; y < CountY; y++)
+		{
+			float ndcTop = 1.0f - 2.0f * (y * tileHeight) / height;
+			float ndcBottom = 1.0f - 2.0f * ((y + 1) * tileHeight) / height;
+			for (unsigned int x = 0; x < CountX; x++)
+			{
+				float ndcLeft = 2.0f * (x * tileWidth) / width - 1.0f;
+				float ndcRight = 2.0f * ((x + 1) * tileWidth) / width - 1.0f;
+
+				AABB& box = m_clusterBoxes[(z * CountY + y) * CountX + x];
+				box.min.x = std::min(ndcLeft * z0, ndcLeft * z1) / proj.m[0][0];
+				box.max.x = std::max(ndcRight * z0, ndcRight * z1) / proj.m[0][0];
+				box.min.y = std::min(ndcBottom * z0, ndcBottom * z1) / proj.m[1][1];
+				box.max.y = std::max(ndcTop * z0, ndcTop * z1) / proj.m[1][1];
+				box.min.z = z0;
+				box.max.z = z1;
+			}
+		}
+	}
+}
+
+void LightClusters::Assign(const ClusterLight* pLights, unsigned int count, const XMFLOAT4X4& view, unsigned int maxIndices)
+{
+	TransformLights(pLights, count, view);
+
+	m_pairs.clear();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const XMFLOAT4& sphere = m_viewLights[i];
+		float r = sphere.w;
+
+		float zMin = std::max(sphere.z - r, m_nearPlane);
+		float zMax = std::min(sphere.z + r, m_farPlane);
+		if (zMin > zMax)
+		{
+			continue;
+		}
+
+		// Slice range is widened by one, the exact test below rejects extra ones
+		unsigned int z0 = GetSlice(zMin);
+		unsigned int z1 = std::min(GetSlice(zMax) + 1, CountZ - 1);
+		z0 = z0 > 0 ? z0 - 1 : 0;
+
+		for (unsigned int z = z0; z <= z1; z++)
+		{
+			// Box extents along x depend only on tile column and slice, along y only on tile row and slice
+			const AABB* pSlice = &m_clusterBoxes[z * CountY * CountX];
+
+			unsigned int x0 = 0;
+			while (x0 < CountX && pSlice[x0].max.x < sphere.x - r)
+			{
+				x0++;
+			}
+			unsigned int x1 = x0;
+			while (x1 < CountX && pSlice[x1].min.x <= sphere.x + r)
+			{
+				x1++;
+			}
+
+			// Rows go from top of the screen down
+			unsigned int y0 = 0;
+			while (y0 < CountY && pSlice[y0 * CountX].min.y > sphere.y + r)
+			{
+				y0++;
+			}
+			unsigned int y1 = y0;
+			while (y1 < CountY && pSlice[y1 * CountX].max.y >= sphere.y - r)
+			{
+				y1++;
+			}
+
+			for (unsigned int y = y0; y < y1; y++)
+			{
+				for (unsigned int x = x0; x < x1; x++)
+				{
+					unsigned int cluster = (z * CountY + y) * CountX + x;
+					if (Intersects(cluster, sphere))
+					{
+						Pair pair = { cluster, i };
+						m_pairs.push_back(pair);
+					}
+				}
+			}
+		}
+	}
+
+	BuildRanges(maxIndices);
+}
+
+void LightClusters::AssignReference(const ClusterLight* pLights, unsigned int count, const XMFLOAT4X4& view, unsigned int maxIndices)
+{
+	TransformLights(pLights, count, view);
+
+	m_pairs.clear();
+	for (unsigned int cluster = 0; cluster < Count; cluster++)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (Intersects(cluster, m_viewLights[i]))
+			{
+				Pair pair = { cluster, i };
+				m_pairs.push_back(pair);
+			}
+		}
+	}
+
+	BuildRanges(maxIndices);
+}
+
+void LightClusters::TransformLights(const ClusterLight* pLights, unsigned int count, const XMFLOAT4X4& view)
+{
+	XMMATRIX viewMatrix = XMLoadFloat4x4(&view);
+
+	m_viewLights.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMVECTOR pos = XMVector3TransformCoord(XMLoadFloat4(&pLights[i].pos), viewMatrix);
+		XMStoreFloat4(&m_viewLights[i], pos);
+		m_viewLights[i].w = pLights[i].pos.w;
+	}
+}
+
+void LightClusters::BuildRanges(unsigned int maxIndices)
+{
+	m_ranges.assign(Count, Range{ 0, 0 });
+	for (const Pair& pair : m_pairs)
+	{
+		m_ranges[pair.cluster].count++;
+	}
+
+	// Clusters which do not fit get truncated light lists
+	unsigned int offset = 0;
+	for (Range& range : m_ranges)
+	{
+		range.offset = offset;
+		range.count = std::min(range.count, maxIndices - offset);
+		offset += range.count;
+	}
+
+	// Stable scatter keeps lights of each cluster in increasing order
+	m_lightIndices.resize(offset);
+	std::vector<unsigned int> filled(Count, 0);
+	for (const Pair& pair : m_pairs)
+	{
+		const Range& range = m_ranges[pair.cluster];
+		unsigned int& fill = filled[pair.cluster];
+		if (fill < range.count)
+		{
+			m_lightIndices[range.offset + fill++] = pair.light;
+		}
+	}
+}
+
+unsigned int LightClusters::GetSlice(float depth) const
+{
+	float slice = floorf(logf(depth) * m_shaderParams.z + m_shaderParams.w);
+	return slice <= 0 ? 0 : std::min((unsigned int)slice, CountZ - 1);
+}
+
+bool LightClusters::Intersects(unsigned int cluster, const XMFLOAT4& sphere) const
+{
+	const AABB& box = m_clusterBoxes[cluster];
+
+	float dx = std::max(std::max(box.min.x - sphere.x, sphere.x - box.max.x), 0.0f);
+	float dy = std::max(std::max(box.min.y - sphere.y, sphere.y - box.max.y), 0.0f);
+	float dz = std::max(std::max(box.min.z - sphere.z, sphere.z - box.max.z), 0.0f);
+
+	return dx * dx + dy * dy + dz * dz <= sphere.w * sphere.w;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "FrustumCulling.h"
+
+// Point light as laid out in the light structured buffer
+struct ClusterLight
+{
+	DirectX::XMFLOAT4 pos;   // w - cutoff radius
+	DirectX::XMFLOAT4 color;
+};
+
+// Distance where attenuation 1/(0.2 + d^2) brings light intensity below LightCutoffIntensity
+float LightCutoffRadius(const DirectX::XMFLOAT3& color);
+
+// Assignment of point lights to view space froxels
+// Screen is split into CountX x CountY tiles, depth is split into CountZ exponential slices
+// Must match CLUSTERS_X/Y/Z in ColorShader.hlsl
+class LightClusters
+{
+public:
+	static const unsigned int CountX = 16;
+	static const unsigned int CountY = 9;
+	static const unsigned int CountZ = 24;
+	static const unsigned int Count = CountX * CountY * CountZ;
+
+	// Part of the light index list which belongs to a cluster
+	struct Range
+	{
+		unsigned int offset;
+		unsigned int count;
+	};
+
+	LightClusters();
+
+	// Recompute cluster bounds, proj is perspective matrix in DirectXMath convention
+	void Setup(const DirectX::XMFLOAT4X4& proj, float nearPlane, float farPlane, unsigned int width, unsigned int height);
+
+	// Bin lights with world space positions, at most maxIndices light indices are stored
+	void Assign(const ClusterLight* pLights, unsigned int count, const DirectX::XMFLOAT4X4& view, unsigned int maxIndices);
+	// Brute force version of Assign which tests every light against every cluster
+	void AssignReference(const ClusterLight* pLights, unsigned int count, const DirectX::XMFLOAT4X4& view, unsigned int maxIndices);
+
+	const std::vector<Range>& GetRanges() const { return m_ranges; }
+	const std::vector<unsigned int>& GetLightIndices() const { return m_lightIndices; }
+
+	// x, y - tile size in pixels, z, w - scale and bias to get depth slice from log of view depth
+	DirectX::XMFLOAT4 GetShaderParams() const { return m_shaderParams; }
+
+private:
+	struct Pair
+	{
+		unsigned int cluster;
+		unsigned int light;
+	};
+
+	void TransformLights(const ClusterLight* pLights, unsigned int count, const DirectX::XMFLOAT4X4& view);
+	void BuildRanges(unsigned int maxIndices);
+
+	unsigned int GetSlice(float depth) const;
+	bool Intersects(unsigned int cluster, const DirectX::XMFLOAT4& sphere) const;
+
+private:
+	std::vector<AABB> m_clusterBoxes;
+	std::vector<float> m_sliceDepths;
+
+	std::vector<DirectX::XMFLOAT4> m_viewLights; // View space position and radius
+	std::vector<Pair> m_pairs;                   // Light assignments before sorting by cluster
+	std::vector<Range> m_ranges;
+	std::vector<unsigned int> m_lightIndices;
+
+	DirectX::XMFLOAT4 m_shaderParams;
+
+	DirectX::XMFLOAT4X4 m_proj;
+	float m_nearPlane;
+	float m_farPlane;
+	unsigned int m_width;
+	unsigned int m_height;
+};
@@ -0,0 +1,294 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <new>
+
+MappedFile::MappedFile()
+	: m_pData(NULL)
+	, m_size(0)
+	, m_open(false)
+	, m_error(0)
+#ifdef _WIN32
+	, m_mapping(NULL)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+static const size_t PageSize = 4096;
+// Reads are split, so sizes fit the DWORD and ssize_t counts of the OS calls
+static const size_t MaxReadSize = 1 << 30;
+
+void MappedFile::Prefault(const uint8_t* pData, size_t size)
+{
+	// Volatile sum keeps reads from being optimized out
+	volatile uint8_t sum = 0;
+	for (size_t offset = 0; offset < size; offset += PageSize)
+	{
+		sum += pData[offset];
+	}
+	if (size != 0)
+	{
+		sum += pData[size - 1];
+	}
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* path, FileAccess access)
+{
+	Close();
+
+	// Writers are not shared, so the file can not be truncated under the mapping
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		m_error = GetLastError();
+		return false;
+	}
+
+	bool loaded = Load(file, access);
+	CloseHandle(file);
+	return loaded;
+}
+
+bool MappedFile::Open(const wchar_t* path, FileAccess access)
+{
+	Close();
+
+	HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		m_error = GetLastError();
+		return false;
+	}
+
+	bool loaded = Load(file, access);
+	CloseHandle(file);
+	return loaded;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData != NULL && !m_buffer)
+	{
+		UnmapViewOfFile(m_pData);
+	}
+	if (m_mapping != NULL)
+	{
+		CloseHandle(m_mapping);
+	}
+
+	m_buffer.reset();
+	m_pData = NULL;
+	m_mapping = NULL;
+	m_size = 0;
+	m_open = false;
+}
+
+bool MappedFile::Load(void* file, FileAccess access)
+{
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		m_error = GetLastError();
+		return false;
+	}
+	if ((unsigned long long)size.QuadPart > (size_t)-1)
+	{
+		m_error = ERROR_FILE_TOO_LARGE;
+		return false;
+	}
+
+	// Zero sized mapping can not be created, empty files have nothing to read either
+	if (size.QuadPart != 0)
+	{
+		bool loaded = access == FILE_ACCESS_READ ? Read(file, (size_t)size.QuadPart) : Map(file, (size_t)size.QuadPart);
+		if (!loaded)
+		{
+			return false;
+		}
+	}
+
+	m_size = (size_t)size.QuadPart;
+	m_open = true;
+	return true;
+}
+
+// View keeps the mapping object alive, file handle can be closed right after
+bool MappedFile::Map(void* file, size_t size)
+{
+	UNREFERENCED_PARAMETER(size);
+
+	m_mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_mapping == NULL)
+	{
+		m_error = GetLastError();
+		return false;
+	}
+
+	m_pData = (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_pData == NULL)
+	{
+		m_error = GetLastError();
+		CloseHandle(m_mapping);
+		m_mapping = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+bool MappedFile::Read(void* file, size_t size)
+{
+	m_buffer.reset(new (std::nothrow) uint8_t[size]);
+	if (!m_buffer)
+	{
+		m_error = ERROR_NOT_ENOUGH_MEMORY;
+		return false;
+	}
+
+	for (size_t offset = 0; offset < size;)
+	{
+		DWORD chunk = (DWORD)(size - offset < MaxReadSize ? size - offset : MaxReadSize);
+		DWORD bytesRead = 0;
+		if (!ReadFile(file, m_buffer.get() + offset, chunk, &bytesRead, NULL) || bytesRead == 0)
+		{
+			m_error = bytesRead == 0 ? ERROR_HANDLE_EOF : GetLastError();
+			m_buffer.reset();
+			return false;
+		}
+		offset += bytesRead;
+	}
+
+	m_pData = m_buffer.get();
+	return true;
+}
+
+#else
+
+bool MappedFile::Open(const char* path, FileAccess access)
+{
+	Close();
+
+	int file = open(path, O_RDONLY | O_CLOEXEC);
+	if (file < 0)
+	{
+		m_error = errno;
+		return false;
+	}
+
+	bool loaded = Load(file, access);
+	close(file);
+	return loaded;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData != NULL && !m_buffer)
+	{
+		munmap((void*)m_pData, m_size);
+	}
+
+	m_buffer.reset();
+	m_pData = NULL;
+	m_size = 0;
+	m_open = false;
+}
+
+bool MappedFile::Load(int file, FileAccess access)
+{
+	struct stat info;
+	if (fstat(file, &info) != 0)
+	{
+		m_error = errno;
+		return false;
+	}
+	if (!S_ISREG(info.st_mode))
+	{
+		m_error = EINVAL;
+		return false;
+	}
+	if ((unsigned long long)info.st_size > (size_t)-1)
+	{
+		m_error = EFBIG;
+		return false;
+	}
+
+	// Zero sized mapping can not be created, empty files have nothing to read either
+	if (info.st_size != 0)
+	{
+		bool loaded = access == FILE_ACCESS_READ ? Read(file, (size_t)info.st_size) : Map(file, (size_t)info.st_size);
+		if (!loaded)
+		{
+			return false;
+		}
+	}
+
+	m_size = (size_t)info.st_size;
+	m_open = true;
+	return true;
+}
+
+// Mapping stays valid after the descriptor is closed
+bool MappedFile::Map(int file, size_t size)
+{
+	void* pData = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (pData == MAP_FAILED)
+	{
+		m_error = errno;
+		return false;
+	}
+
+	// Loaders walk the file front to back once
+	madvise(pData, size, MADV_SEQUENTIAL);
+	m_pData = (const uint8_t*)pData;
+
+	return true;
+}
+
+bool MappedFile::Read(int file, size_t size)
+{
+	m_buffer.reset(new (std::nothrow) uint8_t[size]);
+	if (!m_buffer)
+	{
+		m_error = ENOMEM;
+		return false;
+	}
+
+	for (size_t offset = 0; offset < size;)
+	{
+		size_t chunk = size - offset < MaxReadSize ? size - offset : MaxReadSize;
+		ssize_t bytesRead = read(file, m_buffer.get() + offset, chunk);
+		if (bytesRead < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (bytesRead <= 0)
+		{
+			// File got shorter since fstat
+			m_error = bytesRead == 0 ? EIO : errno;
+			m_buffer.reset();
+			return false;
+		}
+		offset += (size_t)bytesRead;
+	}
+
+	m_pData = m_buffer.get();
+	return true;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+enum FileAccess
+{
+	FILE_ACCESS_MAP = 0, // Map the file, pages are read on first access
+	FILE_ACCESS_READ     // Read the whole file into a buffer at open, as loaders did before mapping
+};
+
+// Read only view of a whole file mapped into memory
+// Pages are read by the OS on first access, so nothing is copied into a separate buffer
+// Files can be read into a buffer instead, to compare the two and for file systems where mapping is slow
+// Mapping is kept until Close, pointers into it are valid until then
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Empty files open with NULL data
+	bool Open(const char* path, FileAccess access = FILE_ACCESS_MAP);
+#ifdef _WIN32
+	bool Open(const wchar_t* path, FileAccess access = FILE_ACCESS_MAP);
+#endif
+	void Close();
+
+	bool IsOpen() const { return m_open; }
+	const uint8_t* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_size; }
+
+	// Reads one byte of every page, so later accesses do not wait for disk
+	void Prefault() const { Prefault(m_pData, m_size); }
+	static void Prefault(const uint8_t* pData, size_t size);
+
+	// GetLastError or errno value of the last failed Open
+	unsigned long GetError() const { return m_error; }
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+#ifdef _WIN32
+	bool Load(void* file, FileAccess access);
+	bool Map(void* file, size_t size);
+	bool Read(void* file, size_t size);
+#else
+	bool Load(int file, FileAccess access);
+	bool Map(int file, size_t size);
+	bool Read(int file, size_t size);
+#endif
+
+private:
+	const uint8_t* m_pData;
+	size_t m_size;
+	bool m_open;
+	unsigned long m_error;
+	std::unique_ptr<uint8_t[]> m_buffer; // Data of FILE_ACCESS_READ
+
+#ifdef _WIN32
+	void* m_mapping;
+#endif
+};
@@ -0,0 +1,463 @@
+#include "MipGenerator.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include <vector>
+
+#include "JobSystem.h"
+
+// MIP_GENERATOR_NO_SIMD builds the scalar reference only, it gives the same pixels
+#if (defined(_M_X64) || defined(__SSE2__)) && !defined(MIP_GENERATOR_NO_SIMD)
+#define MIP_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+static const float Pi = 3.14159265358979f;
+static const float KaiserAlpha = 4.0f;
+static const float KaiserWidth = 3.0f; // Destination pixels on each side
+static const unsigned int RowsPerJob = 8;
+static const unsigned int LinearToSRGBSize = 65536;
+
+// Source pixels and weights for every destination pixel along one axis
+struct FilterTaps
+{
+	unsigned int tapCount;
+	std::vector<uint32_t> indices; // Clamped to the source, so edges repeat
+	std::vector<float> weights;
+};
+
+// 8 bit value to filtered space, and back for sRGB
+// Color which is not sRGB is value / 255 * colorScale + colorOffset, so SSE2 converts it without the table
+struct ConversionTables
+{
+	float color[256];
+	float alpha[256];
+	float colorScale;
+	float colorOffset;
+	const uint8_t* pLinearToSRGB; // NULL unless color is sRGB
+};
+
+static float SRGBToLinear(float value)
+{
+	return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSRGB(float value)
+{
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+static uint8_t ToUnorm8(float value)
+{
+	value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	return (uint8_t)(value * 255.0f + 0.5f);
+}
+
+// Table steps are far below half a step of the 8 bit result, so powf is not needed per pixel
+static const uint8_t* GetLinearToSRGBTable()
+{
+	struct Table
+	{
+		uint8_t values[LinearToSRGBSize];
+
+		Table()
+		{
+			for (unsigned int i = 0; i < LinearToSRGBSize; i++)
+			{
+				values[i] = ToUnorm8(LinearToSRGB((float)i / (LinearToSRGBSize - 1)));
+			}
+		}
+	};
+
+	static const Table table;
+	return table.values;
+}
+
+static float BesselI0(float x)
+{
+	float sum = 1.0f;
+	float term = 1.0f;
+	for (int k = 1; k < 32 && term > sum * 1e-8f; k++)
+	{
+		const float half = x / (2.0f * k);
+		term *= half * half;
+		sum += term;
+	}
+	return sum;
+}
+
+static float KaiserWeight(float t)
+{
+	if (fabsf(t) >= KaiserWidth)
+	{
+		return 0.0f;
+	}
+
+	const float r = t / KaiserWidth;
+	const float sinc = fabsf(t) < 1e-6f ? 1.0f : sinf(Pi * t) / (Pi * t);
+	return sinc * BesselI0(KaiserAlpha * sqrtf(1.0f - r * r)) / BesselI0(KaiserAlpha);
+}
+
+static void BuildTaps(uint32_t srcSize, uint32_t dstSize, MipFilter filter, FilterTaps& taps)
+{
+	// Filter is defined in destination pixels, stretched over the source
+	const float scale = (float)srcSize / dstSize;
+	const float radius = filter == MIP_FILTER_BOX ? 0.5f * scale : KaiserWidth * scale;
+
+	std::vector<int> first(dstSize);
+	taps.tapCount = 0;
+	for (uint32_t x = 0; x < dstSize; x++)
+	{
+		const float center = (x + 0.5f) * scale;
+		first[x] = (int)floorf(center - radius);
+		const int last = (int)ceilf(center + radius);
+		taps.tapCount = (unsigned int)(last - first[x]) > taps.tapCount ? (unsigned int)(last - first[x]) : taps.tapCount;
+	}
+
+	taps.indices.resize((size_t)dstSize * taps.tapCount);
+	taps.weights.resize((size_t)dstSize * taps.tapCount);
+	for (uint32_t x = 0; x < dstSize; x++)
+	{
+		const float center = (x + 0.5f) * scale;
+		float sum = 0.0f;
+		for (unsigned int j = 0; j < taps.tapCount; j++)
+		{
+			const int i = first[x] + (int)j;
+			float weight = 0.0f;
+			if (filter == MIP_FILTER_BOX)
+			{
+				// Part of the source pixel covered by the destination one
+				const float left = (float)i > center - radius ? (float)i : center - radius;
+				const float right = (float)(i + 1) < center + radius ? (float)(i + 1) : center + radius;
+				weight = right > left ? right - left : 0.0f;
+			}
+			else
+			{
+				weight = KaiserWeight((i + 0.5f - center) / scale);
+			}
+
+			taps.indices[x * taps.tapCount + j] = (uint32_t)(i < 0 ? 0 : (i >= (int)srcSize ? (int)srcSize - 1 : i));
+			taps.weights[x * taps.tapCount + j] = weight;
+			sum += weight;
+		}
+
+		for (unsigned int j = 0; j < taps.tapCount; j++)
+		{
+			taps.weights[x * taps.tapCount + j] /= sum;
+		}
+	}
+}
+
+static void BuildTables(unsigned int flags, ConversionTables& tables)
+{
+	const bool srgb = (flags & MIP_FLAG_SRGB) && !(flags & MIP_FLAG_NORMAL_MAP);
+	tables.colorScale = flags & MIP_FLAG_NORMAL_MAP ? 2.0f : 1.0f;
+	tables.colorOffset = flags & MIP_FLAG_NORMAL_MAP ? -1.0f : 0.0f;
+	for (unsigned int i = 0; i < 256; i++)
+	{
+		const float value = i / 255.0f;
+		tables.color[i] = srgb ? SRGBToLinear(value) : value * tables.colorScale + tables.colorOffset;
+		tables.alpha[i] = value;
+	}
+	tables.pLinearToSRGB = srgb ? GetLinearToSRGBTable() : NULL;
+}
+
+static void StorePixel(const float* pValue, unsigned int flags, const ConversionTables& tables, uint8_t* pDst)
+{
+	if (flags & MIP_FLAG_NORMAL_MAP)
+	{
+		float x = pValue[0];
+		float y = pValue[1];
+		float z = pValue[2];
+		const float length = sqrtf(x * x + y * y + z * z);
+		if (length > 0.0f)
+		{
+			x /= length;
+			y /= length;
+			z /= length;
+		}
+		else
+		{
+			x = 0.0f;
+			y = 0.0f;
+			z = 1.0f;
+		}
+		pDst[0] = ToUnorm8(x * 0.5f + 0.5f);
+		pDst[1] = ToUnorm8(y * 0.5f + 0.5f);
+		pDst[2] = ToUnorm8(z * 0.5f + 0.5f);
+	}
+	else if (tables.pLinearToSRGB != NULL)
+	{
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			const float value = pValue[c] < 0.0f ? 0.0f : (pValue[c] > 1.0f ? 1.0f : pValue[c]);
+			pDst[c] = tables.pLinearToSRGB[(unsigned int)(value * (LinearToSRGBSize - 1) + 0.5f)];
+		}
+	}
+	else
+	{
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			pDst[c] = ToUnorm8(pValue[c]);
+		}
+	}
+	pDst[3] = ToUnorm8(pValue[3]);
+}
+
+//
+// Filtering, vertical taps are summed into a row of the source width, horizontal ones into a row of the destination
+// SSE2 converts and stores four pixels a step, operation order matches the scalar code so results are the same
+//
+
+#ifndef MIP_GENERATOR_SSE2
+static void AccumulateRow(const uint8_t* pSrc, uint32_t width, float weight, const ConversionTables& tables, float* pRow)
+{
+	for (uint32_t x = 0; x < width; x++)
+	{
+		const uint8_t* pPixel = pSrc + x * 4;
+		pRow[x * 4 + 0] = pRow[x * 4 + 0] + weight * tables.color[pPixel[0]];
+		pRow[x * 4 + 1] = pRow[x * 4 + 1] + weight * tables.color[pPixel[1]];
+		pRow[x * 4 + 2] = pRow[x * 4 + 2] + weight * tables.color[pPixel[2]];
+		pRow[x * 4 + 3] = pRow[x * 4 + 3] + weight * tables.alpha[pPixel[3]];
+	}
+}
+
+static void FilterPixel(const float* pRow, const uint32_t* pIndices, const float* pWeights, unsigned int tapCount, float* pValue)
+{
+	float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (unsigned int j = 0; j < tapCount; j++)
+	{
+		const float* pPixel = pRow + pIndices[j] * 4;
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			sum[c] = sum[c] + pWeights[j] * pPixel[c];
+		}
+	}
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		pValue[c] = sum[c];
+	}
+}
+
+static void StoreRow(const float* pValues, uint32_t width, unsigned int flags, const ConversionTables& tables, uint8_t* pDst)
+{
+	for (uint32_t x = 0; x < width; x++)
+	{
+		StorePixel(pValues + x * 4, flags, tables, pDst + x * 4);
+	}
+}
+#else
+static void AccumulateRow(const uint8_t* pSrc, uint32_t width, float weight, const ConversionTables& tables, float* pRow)
+{
+	const __m128 w = _mm_set1_ps(weight);
+	uint32_t x = 0;
+	if (tables.pLinearToSRGB == NULL)
+	{
+		// Same division as the tables are built with, alpha lanes are not scaled
+		const __m128 scale = _mm_setr_ps(tables.colorScale, tables.colorScale, tables.colorScale, 1.0f);
+		const __m128 offset = _mm_setr_ps(tables.colorOffset, tables.colorOffset, tables.colorOffset, 0.0f);
+		const __m128 max = _mm_set1_ps(255.0f);
+		const __m128i zero = _mm_setzero_si128();
+		for (; x + 4 <= width; x += 4)
+		{
+			const __m128i pixels = _mm_loadu_si128((const __m128i*)(pSrc + x * 4));
+			const __m128i low = _mm_unpacklo_epi8(pixels, zero);
+			const __m128i high = _mm_unpackhi_epi8(pixels, zero);
+			const __m128i values[4] =
+			{
+				_mm_unpacklo_epi16(low, zero), _mm_unpackhi_epi16(low, zero), _mm_unpacklo_epi16(high, zero), _mm_unpackhi_epi16(high, zero)
+			};
+			for (unsigned int i = 0; i < 4; i++)
+			{
+				const __m128 value = _mm_add_ps(_mm_mul_ps(_mm_div_ps(_mm_cvtepi32_ps(values[i]), max), scale), offset);
+				float* pPixel = pRow + (x + i) * 4;
+				_mm_storeu_ps(pPixel, _mm_add_ps(_mm_loadu_ps(pPixel), _mm_mul_ps(w, value)));
+			}
+		}
+	}
+
+	for (; x < width; x++)
+	{
+		const uint8_t* pPixel = pSrc + x * 4;
+		const __m128 value = _mm_setr_ps(tables.color[pPixel[0]], tables.color[pPixel[1]], tables.color[pPixel[2]], tables.alpha[pPixel[3]]);
+		_mm_storeu_ps(pRow + x * 4, _mm_add_ps(_mm_loadu_ps(pRow + x * 4), _mm_mul_ps(w, value)));
+	}
+}
+
+static void FilterPixel(const float* pRow, const uint32_t* pIndices, const float* pWeights, unsigned int tapCount, float* pValue)
+{
+	__m128 sum = _mm_setzero_ps();
+	for (unsigned int j = 0; j < tapCount; j++)
+	{
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(pWeights[j]), _mm_loadu_ps(pRow + pIndices[j] * 4)));
+	}
+	_mm_storeu_ps(pValue, sum);
+}
+
+// Clamped to [0, 1], scaled and rounded by lane, as ToUnorm8 does with a scale of 255
+static __m128i ScaleToUnorm(__m128 value, __m128 scale)
+{
+	value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), _mm_set1_ps(0.5f)));
+}
+
+static void StoreRow(const float* pValues, uint32_t width, unsigned int flags, const ConversionTables& tables, uint8_t* pDst)
+{
+	const __m128 max = _mm_set1_ps(255.0f);
+	uint32_t x = 0;
+	if (flags & MIP_FLAG_NORMAL_MAP)
+	{
+		// Transposed, so a register holds one component of four pixels
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		for (; x + 4 <= width; x += 4)
+		{
+			__m128 nx = _mm_loadu_ps(pValues + x * 4);
+			__m128 ny = _mm_loadu_ps(pValues + x * 4 + 4);
+			__m128 nz = _mm_loadu_ps(pValues + x * 4 + 8);
+			__m128 alpha = _mm_loadu_ps(pValues + x * 4 + 12);
+			_MM_TRANSPOSE4_PS(nx, ny, nz, alpha);
+
+			// Zero length lanes get the flat normal instead of the quotients
+			const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+			const __m128 valid = _mm_cmpgt_ps(length, zero);
+			nx = _mm_and_ps(valid, _mm_div_ps(nx, length));
+			ny = _mm_and_ps(valid, _mm_div_ps(ny, length));
+			nz = _mm_or_ps(_mm_and_ps(valid, _mm_div_ps(nz, length)), _mm_andnot_ps(valid, one));
+
+			const __m128i pixels = _mm_or_si128(
+				_mm_or_si128(ScaleToUnorm(_mm_add_ps(_mm_mul_ps(nx, half), half), max), _mm_slli_epi32(ScaleToUnorm(_mm_add_ps(_mm_mul_ps(ny, half), half), max), 8)),
+				_mm_or_si128(_mm_slli_epi32(ScaleToUnorm(_mm_add_ps(_mm_mul_ps(nz, half), half), max), 16), _mm_slli_epi32(ScaleToUnorm(alpha, max), 24)));
+			_mm_storeu_si128((__m128i*)(pDst + x * 4), pixels);
+		}
+	}
+	else if (tables.pLinearToSRGB != NULL)
+	{
+		// Table indices of color and alpha of a pixel at once, only the lookups are scalar
+		const __m128 scale = _mm_setr_ps(LinearToSRGBSize - 1, LinearToSRGBSize - 1, LinearToSRGBSize - 1, 255.0f);
+		for (; x < width; x++)
+		{
+			alignas(16) uint32_t indices[4];
+			_mm_store_si128((__m128i*)indices, ScaleToUnorm(_mm_loadu_ps(pValues + x * 4), scale));
+			pDst[x * 4 + 0] = tables.pLinearToSRGB[indices[0]];
+			pDst[x * 4 + 1] = tables.pLinearToSRGB[indices[1]];
+			pDst[x * 4 + 2] = tables.pLinearToSRGB[indices[2]];
+			pDst[x * 4 + 3] = (uint8_t)indices[3];
+		}
+	}
+	else
+	{
+		// Four pixels packed into one store
+		for (; x + 4 <= width; x += 4)
+		{
+			__m128i values[4];
+			for (unsigned int i = 0; i < 4; i++)
+			{
+				values[i] = ScaleToUnorm(_mm_loadu_ps(pValues + (x + i) * 4), max);
+			}
+			const __m128i pixels = _mm_packus_epi16(_mm_packs_epi32(values[0], values[1]), _mm_packs_epi32(values[2], values[3]));
+			_mm_storeu_si128((__m128i*)(pDst + x * 4), pixels);
+		}
+	}
+
+	for (; x < width; x++)
+	{
+		StorePixel(pValues + x * 4, flags, tables, pDst + x * 4);
+	}
+}
+#endif
+
+static void FilterRows(const uint8_t* pSrc, uint32_t srcWidth, uint8_t* pDst, uint32_t dstWidth,
+	const FilterTaps& horizontal, const FilterTaps& vertical, unsigned int flags, const ConversionTables& tables,
+	uint32_t firstRow, uint32_t rowCount)
+{
+	std::vector<float> row((size_t)srcWidth * 4);
+	std::vector<float> dstRow((size_t)dstWidth * 4);
+	for (uint32_t y = firstRow; y < firstRow + rowCount; y++)
+	{
+		for (float& value : row)
+		{
+			value = 0.0f;
+		}
+		for (unsigned int j = 0; j < vertical.tapCount; j++)
+		{
+			const size_t tap = (size_t)y * vertical.tapCount + j;
+			AccumulateRow(pSrc + (size_t)vertical.indices[tap] * srcWidth * 4, srcWidth, vertical.weights[tap], tables, row.data());
+		}
+
+		for (uint32_t x = 0; x < dstWidth; x++)
+		{
+			const size_t tap = (size_t)x * horizontal.tapCount;
+			FilterPixel(row.data(), &horizontal.indices[tap], &horizontal.weights[tap], horizontal.tapCount, &dstRow[x * 4]);
+		}
+		StoreRow(dstRow.data(), dstWidth, flags, tables, pDst + (size_t)y * dstWidth * 4);
+	}
+}
+
+unsigned int GetFullMipCount(uint32_t width, uint32_t height)
+{
+	unsigned int count = 1;
+	while (width > 1 || height > 1)
+	{
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		count++;
+	}
+	return count;
+}
+
+size_t GetMipChainSize(uint32_t width, uint32_t height)
+{
+	size_t size = 0;
+	for (unsigned int i = GetFullMipCount(width, height); i > 0; i--)
+	{
+		size += (size_t)width * height * 4;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	return size;
+}
+
+void GenerateMip(const uint8_t* pSrc, uint32_t srcWidth, uint32_t srcHeight, uint8_t* pDst,
+	MipFilter filter, unsigned int flags, JobSystem* pJobs)
+{
+	assert(srcWidth > 0 && srcHeight > 0);
+
+	const uint32_t dstWidth = srcWidth > 1 ? srcWidth / 2 : 1;
+	const uint32_t dstHeight = srcHeight > 1 ? srcHeight / 2 : 1;
+
+	FilterTaps horizontal;
+	FilterTaps vertical;
+	BuildTaps(srcWidth, dstWidth, filter, horizontal);
+	BuildTaps(srcHeight, dstHeight, filter, vertical);
+
+	ConversionTables tables;
+	BuildTables(flags, tables);
+
+	if (pJobs != NULL && dstHeight > RowsPerJob)
+	{
+		pJobs->ParallelFor(dstHeight, RowsPerJob, [&](unsigned int first, unsigned int count)
+		{
+			FilterRows(pSrc, srcWidth, pDst, dstWidth, horizontal, vertical, flags, tables, first, count);
+		});
+	}
+	else
+	{
+		FilterRows(pSrc, srcWidth, pDst, dstWidth, horizontal, vertical, flags, tables, 0, dstHeight);
+	}
+}
+
+void GenerateMipChain(uint8_t* pChain, uint32_t width, uint32_t height, MipFilter filter, unsigned int flags, JobSystem* pJobs)
+{
+	for (unsigned int i = GetFullMipCount(width, height); i > 1; i--)
+	{
+		uint8_t* pDst = pChain + (size_t)width * height * 4;
+		GenerateMip(pChain, width, height, pDst, filter, flags, pJobs);
+
+		pChain = pDst;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class JobSystem;
+
+enum MipFilter
+{
+	MIP_FILTER_BOX = 0, // Area average, cheap enough for load time
+	MIP_FILTER_KAISER   // Kaiser windowed sinc, sharper, for offline use
+};
+
+enum MipFlags
+{
+	MIP_FLAG_SRGB = 0x1,      // Color is filtered in linear space
+	MIP_FLAG_NORMAL_MAP = 0x2 // Color is a normal, renormalized after filtering
+};
+
+// Levels of a full chain down to 1x1
+unsigned int GetFullMipCount(uint32_t width, uint32_t height);
+// Bytes of a full RGBA8 chain, mips tightly packed one after another
+size_t GetMipChainSize(uint32_t width, uint32_t height);
+
+// Works on 8 bit RGBA or BGRA, alpha is always filtered linearly
+// Next level is half the size rounded down, as D3D expects
+// Rows of the destination are split between jobs when pJobs is given, then the caller has to be a worker
+void GenerateMip(const uint8_t* pSrc, uint32_t srcWidth, uint32_t srcHeight, uint8_t* pDst,
+	MipFilter filter, unsigned int flags, JobSystem* pJobs = NULL);
+
+// pChain holds the top mip, the rest of the chain is written after it, each level made from the previous one
+void GenerateMipChain(uint8_t* pChain, uint32_t width, uint32_t height, MipFilter filter, unsigned int flags, JobSystem* pJobs = NULL);
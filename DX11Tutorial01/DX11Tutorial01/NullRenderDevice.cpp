@@ -0,0 +1,790 @@
+#include "NullRenderDevice.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SAFE_RELEASE(p) \
+if (p != NULL) { \
+	p->Release(); \
+	p = NULL;\
+}
+
+// Made up costs of the fake GPU clock, so timestamps follow the commands between them
+static const uint64_t NullTimestampFrequency = 1000000000;
+static const uint64_t NullCommandTicks = 500;
+static const uint64_t NullTriangleTicks = 2;
+
+static const char* CommandNames[NULL_COMMAND_COUNT] = {
+	"ClearState",
+	"ClearRenderTargetView",
+	"ClearDepthStencilView",
+	"IASetVertexBuffers",
+	"IASetIndexBuffer",
+	"IASetInputLayout",
+	"IASetPrimitiveTopology",
+	"VSSetShader",
+	"VSSetConstantBuffers",
+	"RSSetState",
+	"RSSetViewport",
+	"RSSetScissorRect",
+	"PSSetShader",
+	"PSSetConstantBuffers",
+	"PSSetShaderResources",
+	"PSSetSamplers",
+	"OMSetRenderTargets",
+	"OMSetBlendState",
+	"OMSetDepthStencilState",
+	"Draw",
+	"DrawIndexed",
+	"DrawIndexedInstanced",
+	"Map",
+	"Unmap",
+	"Begin",
+	"End",
+	"ExecuteCommandList",
+	"Present"
+};
+
+const char* GetNullCommandName(NullCommandType type)
+{
+	return type < NULL_COMMAND_COUNT ? CommandNames[type] : "Unknown";
+}
+
+// Object which is counted in the live objects of its device
+template <class Base>
+class NullObject : public Base
+{
+public:
+	explicit NullObject(std::atomic<int>* pLiveObjects)
+		: m_pLiveObjects(pLiveObjects)
+	{
+		(*m_pLiveObjects)++;
+	}
+
+	virtual void Release()
+	{
+		(*m_pLiveObjects)--;
+		delete this;
+	}
+
+protected:
+	std::atomic<int>* m_pLiveObjects;
+};
+
+typedef NullObject<RenderVertexShader> NullVertexShader;
+typedef NullObject<RenderPixelShader> NullPixelShader;
+typedef NullObject<RenderInputLayout> NullInputLayout;
+typedef NullObject<RenderRasterizerState> NullRasterizerState;
+typedef NullObject<RenderBlendState> NullBlendState;
+typedef NullObject<RenderDepthStencilState> NullDepthStencilState;
+typedef NullObject<RenderSamplerState> NullSamplerState;
+
+class NullResource : public NullObject<RenderResource>
+{
+public:
+	NullResource(std::atomic<int>* pLiveObjects, RenderUsage usage, size_t size)
+		: NullObject(pLiveObjects)
+		, usage(usage)
+		, mapped(false)
+	{
+		if (usage == USAGE_DYNAMIC)
+		{
+			memory.resize(size);
+		}
+	}
+
+	RenderUsage usage;
+	std::vector<uint8_t> memory; // Dynamic resources only
+	bool mapped;
+};
+
+class NullQuery : public NullObject<RenderQuery>
+{
+public:
+	NullQuery(std::atomic<int>* pLiveObjects, RenderQueryType type)
+		: NullObject(pLiveObjects)
+		, type(type)
+		, ended(false)
+		, readyFrame(0)
+		, ticks(0)
+	{
+	}
+
+	RenderQueryType type;
+	bool ended;
+	unsigned int readyFrame; // Timestamp and disjoint queries
+	uint64_t ticks;          // Timestamp queries
+};
+
+class NullCommandList : public NullObject<RenderCommandList>
+{
+public:
+	explicit NullCommandList(std::atomic<int>* pLiveObjects)
+		: NullObject(pLiveObjects)
+	{
+	}
+
+	std::vector<NullCommand> commands;
+	NullFrameStats stats;
+};
+
+struct NullVertexBufferBinding
+{
+	const void* pBuffer;
+	unsigned int stride;
+	unsigned int offset;
+};
+
+struct NullConstantBufferBinding
+{
+	const void* pBuffer;
+	unsigned int firstConstant;
+	unsigned int numConstants;
+};
+
+// Everything commands can bind, all zeros is the default state
+struct NullPipelineState
+{
+	NullVertexBufferBinding vertexBuffers[RenderMaxVertexBuffers];
+	const void* pIndexBuffer;
+	RenderFormat indexFormat;
+	unsigned int indexOffset;
+	const void* pInputLayout;
+	RenderTopology topology;
+
+	const void* pVertexShader;
+	NullConstantBufferBinding vsConstantBuffers[RenderMaxConstantBuffers];
+
+	const void* pRasterizerState;
+	RenderViewport viewport;
+	RenderRect scissorRect;
+
+	const void* pPixelShader;
+	NullConstantBufferBinding psConstantBuffers[RenderMaxConstantBuffers];
+	const void* psResources[RenderMaxShaderResources];
+	const void* psSamplers[RenderMaxSamplers];
+
+	unsigned int renderTargetCount;
+	const void* renderTargets[RenderMaxRenderTargets];
+	const void* pDepth;
+	const void* pBlendState;
+	const void* pDepthStencilState;
+};
+
+// Following functions store value in the state and tell whether it was different
+template <class T>
+static bool SetState(T& state, const T& value)
+{
+	bool changed = !(state == value);
+	state = value;
+	return changed;
+}
+
+static bool SetState(NullVertexBufferBinding& state, const NullVertexBufferBinding& value)
+{
+	bool changed = state.pBuffer != value.pBuffer || state.stride != value.stride || state.offset != value.offset;
+	state = value;
+	return changed;
+}
+
+static bool SetState(NullConstantBufferBinding& state, const NullConstantBufferBinding& value)
+{
+	bool changed = state.pBuffer != value.pBuffer || state.firstConstant != value.firstConstant || state.numConstants != value.numConstants;
+	state = value;
+	return changed;
+}
+
+static bool SetState(RenderViewport& state, const RenderViewport& value)
+{
+	bool changed = state.x != value.x || state.y != value.y || state.width != value.width || state.height != value.height
+		|| state.minDepth != value.minDepth || state.maxDepth != value.maxDepth;
+	state = value;
+	return changed;
+}
+
+static bool SetState(RenderRect& state, const RenderRect& value)
+{
+	bool changed = state.left != value.left || state.top != value.top || state.right != value.right || state.bottom != value.bottom;
+	state = value;
+	return changed;
+}
+
+static const void* GetFirst(unsigned int count, const void* const* ppObjects)
+{
+	return count != 0 ? ppObjects[0] : NULL;
+}
+
+// Immediate or deferred context which logs commands and counts them
+class NullRenderContext : public NullObject<IRenderContext>
+{
+public:
+	explicit NullRenderContext(std::atomic<int>* pLiveObjects)
+		: NullObject(pLiveObjects)
+		, m_clockTicks(0)
+		, m_frame(0)
+		, m_queryLatency(0)
+	{
+		ResetState();
+		ResetStats();
+	}
+
+	// Timestamp and disjoint queries ended in a frame are there only after as many later frames
+	void SetQueryLatency(unsigned int frames)
+	{
+		m_queryLatency = frames;
+	}
+
+	void EndFrame()
+	{
+		m_frame++;
+	}
+
+	void ResetState()
+	{
+		m_state = NullPipelineState();
+	}
+
+	// Moves commands and stats since the previous call out of the context
+	void TakeLog(std::vector<NullCommand>& commands, NullFrameStats& stats)
+	{
+		commands.swap(m_commands);
+		m_commands.clear();
+		stats = m_stats;
+		m_clockTicks = GetClockTicks();
+		ResetStats();
+	}
+
+	void AddCommand(NullCommandType type, const void* pObject)
+	{
+		NullCommand command = { type, false, 0, 0, 0, pObject };
+		m_commands.push_back(command);
+		m_stats.commandCount++;
+	}
+
+	virtual void ClearState()
+	{
+		ResetState();
+		AddCommand(NULL_COMMAND_CLEAR_STATE, NULL);
+	}
+
+	virtual void ClearRenderTargetView(RenderResource* pTarget, const float color[4])
+	{
+		UNREFERENCED_PARAMETER(color);
+
+		AddCommand(NULL_COMMAND_CLEAR_RENDER_TARGET, pTarget);
+	}
+
+	virtual void ClearDepthStencilView(RenderResource* pDepth, float depth)
+	{
+		UNREFERENCED_PARAMETER(depth);
+
+		AddCommand(NULL_COMMAND_CLEAR_DEPTH, pDepth);
+	}
+
+	virtual void IASetVertexBuffers(unsigned int startSlot, unsigned int count, RenderResource* const* ppBuffers, const unsigned int* pStrides, const unsigned int* pOffsets)
+	{
+		assert(startSlot + count <= RenderMaxVertexBuffers);
+
+		bool changed = false;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			NullVertexBufferBinding binding = { ppBuffers[i], pStrides[i], pOffsets[i] };
+			changed = SetState(m_state.vertexBuffers[startSlot + i], binding) || changed;
+		}
+		AddBind(NULL_COMMAND_SET_VERTEX_BUFFERS, changed, startSlot, count, GetFirst(count, (const void* const*)ppBuffers));
+	}
+
+	virtual void IASetIndexBuffer(RenderResource* pBuffer, RenderFormat format, unsigned int offset)
+	{
+		bool changed = SetState(m_state.pIndexBuffer, (const void*)pBuffer);
+		changed = SetState(m_state.indexFormat, format) || changed;
+		changed = SetState(m_state.indexOffset, offset) || changed;
+		AddBind(NULL_COMMAND_SET_INDEX_BUFFER, changed, 0, 1, pBuffer);
+	}
+
+	virtual void IASetInputLayout(RenderInputLayout* pLayout)
+	{
+		AddBind(NULL_COMMAND_SET_INPUT_LAYOUT, SetState(m_state.pInputLayout, (const void*)pLayout), 0, 1, pLayout);
+	}
+
+	virtual void IASetPrimitiveTopology(RenderTopology topology)
+	{
+		AddBind(NULL_COMMAND_SET_TOPOLOGY, SetState(m_state.topology, topology), 0, 1, NULL);
+	}
+
+	virtual void VSSetShader(RenderVertexShader* pShader)
+	{
+		AddBind(NULL_COMMAND_SET_VERTEX_SHADER, SetState(m_state.pVertexShader, (const void*)pShader), 0, 1, pShader);
+	}
+
+	virtual void VSSetConstantBuffers(unsigned int startSlot, unsigned int count, RenderResource* const* ppBuffers, const unsigned int* pFirstConstant, const unsigned int* pNumConstants)
+	{
+		bool changed = SetConstantBuffers(m_state.vsConstantBuffers, startSlot, count, ppBuffers, pFirstConstant, pNumConstants);
+		AddBind(NULL_COMMAND_SET_VS_CONSTANT_BUFFERS, changed, startSlot, count, GetFirst(count, (const void* const*)ppBuffers));
+	}
+
+	virtual void RSSetState(RenderRasterizerState* pState)
+	{
+		AddBind(NULL_COMMAND_SET_RASTERIZER_STATE, SetState(m_state.pRasterizerState, (const void*)pState), 0, 1, pState);
+	}
+
+	virtual void RSSetViewport(const RenderViewport& viewport)
+	{
+		AddBind(NULL_COMMAND_SET_VIEWPORT, SetState(m_state.viewport, viewport), 0, 1, NULL);
+	}
+
+	virtual void RSSetScissorRect(const RenderRect& rect)
+	{
+		AddBind(NULL_COMMAND_SET_SCISSOR_RECT, SetState(m_state.scissorRect, rect), 0, 1, NULL);
+	}
+
+	virtual void PSSetShader(RenderPixelShader* pShader)
+	{
+		AddBind(NULL_COMMAND_SET_PIXEL_SHADER, SetState(m_state.pPixelShader, (const void*)pShader), 0, 1, pShader);
+	}
+
+	virtual void PSSetConstantBuffers(unsigned int startSlot, unsigned int count, RenderResource* const* ppBuffers, const unsigned int* pFirstConstant, const unsigned int* pNumConstants)
+	{
+		bool changed = SetConstantBuffers(m_state.psConstantBuffers, startSlot, count, ppBuffers, pFirstConstant, pNumConstants);
+		AddBind(NULL_COMMAND_SET_PS_CONSTANT_BUFFERS, changed, startSlot, count, GetFirst(count, (const void* const*)ppBuffers));
+	}
+
+	virtual void PSSetShaderResources(unsigned int startSlot, unsigned int count, RenderResource* const* ppResources)
+	{
+		assert(startSlot + count <= RenderMaxShaderResources);
+
+		bool changed = false;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			changed = SetState(m_state.psResources[startSlot + i], (const void*)ppResources[i]) || changed;
+		}
+		AddBind(NULL_COMMAND_SET_PS_SHADER_RESOURCES, changed, startSlot, count, GetFirst(count, (const void* const*)ppResources));
+	}
+
+	virtual void PSSetSamplers(unsigned int startSlot, unsigned int count, RenderSamplerState* const* ppSamplers)
+	{
+		assert(startSlot + count <= RenderMaxSamplers);
+
+		bool changed = false;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			changed = SetState(m_state.psSamplers[startSlot + i], (const void*)ppSamplers[i]) || changed;
+		}
+		AddBind(NULL_COMMAND_SET_PS_SAMPLERS, changed, startSlot, count, GetFirst(count, (const void* const*)ppSamplers));
+	}
+
+	virtual void OMSetRenderTargets(unsigned int count, RenderResource* const* ppTargets, RenderResource* pDepth)
+	{
+		assert(count <= RenderMaxRenderTargets);
+
+		// Targets past count are unbound
+		bool changed = SetState(m_state.renderTargetCount, count);
+		for (unsigned int i = 0; i < RenderMaxRenderTargets; i++)
+		{
+			changed = SetState(m_state.renderTargets[i], i < count ? (const void*)ppTargets[i] : NULL) || changed;
+		}
+		changed = SetState(m_state.pDepth, (const void*)pDepth) || changed;
+		AddBind(NULL_COMMAND_SET_RENDER_TARGETS, changed, 0, count, GetFirst(count, (const void* const*)ppTargets));
+	}
+
+	virtual void OMSetBlendState(RenderBlendState* pState)
+	{
+		AddBind(NULL_COMMAND_SET_BLEND_STATE, SetState(m_state.pBlendState, (const void*)pState), 0, 1, pState);
+	}
+
+	virtual void OMSetDepthStencilState(RenderDepthStencilState* pState)
+	{
+		AddBind(NULL_COMMAND_SET_DEPTH_STENCIL_STATE, SetState(m_state.pDepthStencilState, (const void*)pState), 0, 1, pState);
+	}
+
+	virtual void Draw(unsigned int vertexCount, unsigned int startVertex)
+	{
+		UNREFERENCED_PARAMETER(startVertex);
+
+		AddDraw(NULL_COMMAND_DRAW, vertexCount, 1);
+	}
+
+	virtual void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+	{
+		UNREFERENCED_PARAMETER(startIndex);
+		UNREFERENCED_PARAMETER(baseVertex);
+
+		AddDraw(NULL_COMMAND_DRAW_INDEXED, indexCount, 1);
+	}
+
+	virtual void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+	{
+		UNREFERENCED_PARAMETER(startIndex);
+		UNREFERENCED_PARAMETER(baseVertex);
+		UNREFERENCED_PARAMETER(startInstance);
+
+		AddDraw(NULL_COMMAND_DRAW_INDEXED_INSTANCED, indexCount, instanceCount);
+	}
+
+	virtual HRESULT Map(RenderResource* pBuffer, RenderMap mapType, void** ppData)
+	{
+		UNREFERENCED_PARAMETER(mapType);
+
+		NullResource* pResource = static_cast<NullResource*>(pBuffer);
+		if (pResource == NULL || pResource->usage != USAGE_DYNAMIC || pResource->mapped)
+		{
+			return E_INVALIDARG;
+		}
+
+		pResource->mapped = true;
+		*ppData = pResource->memory.data();
+
+		AddCommand(NULL_COMMAND_MAP, pBuffer);
+		m_stats.mapCount++;
+
+		return S_OK;
+	}
+
+	virtual void Unmap(RenderResource* pBuffer)
+	{
+		NullResource* pResource = static_cast<NullResource*>(pBuffer);
+		assert(pResource->mapped);
+		pResource->mapped = false;
+
+		AddCommand(NULL_COMMAND_UNMAP, pBuffer);
+	}
+
+	virtual void Begin(RenderQuery* pQuery)
+	{
+		NullQuery* pNullQuery = static_cast<NullQuery*>(pQuery);
+		assert(pNullQuery->type == QUERY_TIMESTAMP_DISJOINT);
+		pNullQuery->ended = false;
+
+		AddCommand(NULL_COMMAND_BEGIN_QUERY, pQuery);
+	}
+
+	virtual void End(RenderQuery* pQuery)
+	{
+		NullQuery* pNullQuery = static_cast<NullQuery*>(pQuery);
+		pNullQuery->ended = true;
+		pNullQuery->readyFrame = m_frame + m_queryLatency;
+		pNullQuery->ticks = GetClockTicks();
+
+		AddCommand(NULL_COMMAND_END_QUERY, pQuery);
+	}
+
+	// There is no GPU to wait for
+	virtual HRESULT GetData(RenderQuery* pQuery, bool flush, bool* pDone)
+	{
+		UNREFERENCED_PARAMETER(flush);
+
+		*pDone = static_cast<NullQuery*>(pQuery)->ended;
+		return S_OK;
+	}
+
+	virtual HRESULT GetTimestamp(RenderQuery* pQuery, uint64_t* pTicks)
+	{
+		const NullQuery* pNullQuery = static_cast<const NullQuery*>(pQuery);
+		assert(pNullQuery->type == QUERY_TIMESTAMP);
+		if (!IsReady(pNullQuery))
+		{
+			return S_FALSE;
+		}
+
+		*pTicks = pNullQuery->ticks;
+		return S_OK;
+	}
+
+	virtual HRESULT GetTimestampDisjoint(RenderQuery* pQuery, RenderTimestampDisjoint* pData)
+	{
+		const NullQuery* pNullQuery = static_cast<const NullQuery*>(pQuery);
+		assert(pNullQuery->type == QUERY_TIMESTAMP_DISJOINT);
+		if (!IsReady(pNullQuery))
+		{
+			return S_FALSE;
+		}
+
+		pData->frequency = NullTimestampFrequency;
+		pData->disjoint = false;
+		return S_OK;
+	}
+
+	virtual HRESULT FinishCommandList(RenderCommandList** ppList)
+	{
+		NullCommandList* pList = new NullCommandList(m_pLiveObjects);
+		TakeLog(pList->commands, pList->stats);
+		ResetState();
+
+		*ppList = pList;
+		return S_OK;
+	}
+
+	virtual void ExecuteCommandList(RenderCommandList* pList)
+	{
+		const NullCommandList* pCommandList = static_cast<const NullCommandList*>(pList);
+
+		AddCommand(NULL_COMMAND_EXECUTE_COMMAND_LIST, pList);
+		m_commands.insert(m_commands.end(), pCommandList->commands.begin(), pCommandList->commands.end());
+
+		const NullFrameStats& stats = pCommandList->stats;
+		m_stats.commandCount += stats.commandCount;
+		m_stats.drawCount += stats.drawCount;
+		m_stats.triangleCount += stats.triangleCount;
+		m_stats.bindCount += stats.bindCount;
+		m_stats.stateChanges += stats.stateChanges;
+		m_stats.mapCount += stats.mapCount;
+		m_stats.commandListCount++;
+
+		ResetState();
+	}
+
+private:
+	void ResetStats()
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	// Commands of executed command lists are counted in the stats, so they take their time too
+	uint64_t GetClockTicks() const
+	{
+		return m_clockTicks + m_stats.commandCount * NullCommandTicks + m_stats.triangleCount * NullTriangleTicks;
+	}
+
+	bool IsReady(const NullQuery* pQuery) const
+	{
+		return pQuery->ended && m_frame >= pQuery->readyFrame;
+	}
+
+	void AddBind(NullCommandType type, bool changed, unsigned int slot, unsigned int count, const void* pObject)
+	{
+		NullCommand command = { type, changed, slot, count, 0, pObject };
+		m_commands.push_back(command);
+		m_stats.commandCount++;
+		m_stats.bindCount++;
+		m_stats.stateChanges += changed ? 1 : 0;
+	}
+
+	// Only triangle lists are drawn
+	void AddDraw(NullCommandType type, unsigned int count, unsigned int instanceCount)
+	{
+		NullCommand command = { type, false, 0, count, instanceCount, NULL };
+		m_commands.push_back(command);
+		m_stats.commandCount++;
+		m_stats.drawCount++;
+		m_stats.triangleCount += (uint64_t)(count / 3) * instanceCount;
+	}
+
+	bool SetConstantBuffers(NullConstantBufferBinding* pState, unsigned int startSlot, unsigned int count, RenderResource* const* ppBuffers, const unsigned int* pFirstConstant, const unsigned int* pNumConstants)
+	{
+		assert(startSlot + count <= RenderMaxConstantBuffers);
+
+		bool changed = false;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			NullConstantBufferBinding binding = { ppBuffers[i], pFirstConstant[i], pNumConstants[i] };
+			changed = SetState(pState[startSlot + i], binding) || changed;
+		}
+		return changed;
+	}
+
+private:
+	NullPipelineState m_state;
+	std::vector<NullCommand> m_commands;
+	NullFrameStats m_stats;
+
+	uint64_t m_clockTicks; // Fake GPU clock at the last TakeLog
+	unsigned int m_frame;
+	unsigned int m_queryLatency;
+};
+
+NullRenderDevice::NullRenderDevice()
+	: m_pContext(NULL)
+	, m_pBackBuffer(NULL)
+	, m_width(0)
+	, m_height(0)
+	, m_frameCount(0)
+	, m_liveObjects(0)
+{
+	memset(&m_frameStats, 0, sizeof(m_frameStats));
+}
+
+bool NullRenderDevice::Init(unsigned int width, unsigned int height)
+{
+	m_width = width;
+	m_height = height;
+	m_frameCount = 0;
+	m_frameLog.clear();
+	memset(&m_frameStats, 0, sizeof(m_frameStats));
+
+	m_pContext = new NullRenderContext(&m_liveObjects);
+
+	HRESULT result = CreateBackBuffer();
+	if (FAILED(result))
+	{
+		Term();
+	}
+
+	return SUCCEEDED(result);
+}
+
+void NullRenderDevice::Term()
+{
+	SAFE_RELEASE(m_pBackBuffer);
+	SAFE_RELEASE(m_pContext);
+
+	if (m_liveObjects != 0)
+	{
+		char message[128];
+		sprintf_s(message, "Null render device has %d live objects at exit\n", (int)m_liveObjects);
+		OutputDebugStringA(message);
+	}
+}
+
+HRESULT NullRenderDevice::CreateBackBuffer()
+{
+	RenderTextureDesc desc = { m_width, m_height, FORMAT_R8G8B8A8_UNORM, USAGE_DEFAULT, BIND_RENDER_TARGET };
+	return CreateTexture(desc, NULL, 0, &m_pBackBuffer);
+}
+
+HRESULT NullRenderDevice::ResizeBackBuffer(unsigned int width, unsigned int height)
+{
+	// New back buffer may get the address of the old one, so nothing bound may refer to it
+	m_pContext->ResetState();
+	SAFE_RELEASE(m_pBackBuffer);
+
+	m_width = width;
+	m_height = height;
+
+	return CreateBackBuffer();
+}
+
+HRESULT NullRenderDevice::Present()
+{
+	m_pContext->AddCommand(NULL_COMMAND_PRESENT, m_pBackBuffer);
+	m_pContext->TakeLog(m_frameLog, m_frameStats);
+	m_pContext->EndFrame();
+	m_frameCount++;
+
+	return S_OK;
+}
+
+HRESULT NullRenderDevice::CreateBuffer(const RenderBufferDesc& desc, const void* pData, RenderResource** ppBuffer)
+{
+	if (desc.size == 0 || (desc.usage == USAGE_IMMUTABLE && pData == NULL)
+		|| ((desc.bindFlags & BIND_SHADER_RESOURCE) != 0 && desc.stride == 0))
+	{
+		return E_INVALIDARG;
+	}
+
+	*ppBuffer = new NullResource(&m_liveObjects, desc.usage, desc.size);
+	return S_OK;
+}
+
+HRESULT NullRenderDevice::CreateTexture(const RenderTextureDesc& desc, const void* pData, unsigned int rowPitch, RenderResource** ppTexture)
+{
+	UNREFERENCED_PARAMETER(rowPitch);
+
+	if (desc.width == 0 || desc.height == 0 || desc.usage == USAGE_DYNAMIC || (desc.usage == USAGE_IMMUTABLE && pData == NULL))
+	{
+		return E_INVALIDARG;
+	}
+
+	*ppTexture = new NullResource(&m_liveObjects, desc.usage, 0);
+	return S_OK;
+}
+
+HRESULT NullRenderDevice::CreateTexture(const TextureData& data, RenderResource** ppTexture)
+{
+	if (data.subresources.empty())
+	{
+		return E_INVALIDARG;
+	}
+
+	*ppTexture = new NullResource(&m_liveObjects, USAGE_IMMUTABLE, 0);
+	return S_OK;
+}
+
+HRESULT NullRenderDevice::CreateVertexShader(const void* pBytecode, size_t size, RenderVertexShader** ppShader)
+{
+	if (pBytecode == NULL || size == 0)
+	{
+		return E_INVALIDARG;
+	}
+
+	*ppShader = new NullVertexShader(&m_liveObjects);
+	return S_OK;
+}
+
+HRESULT NullRenderDevice::CreatePixelShader(const void* pBytecode, size_t size, RenderPixelShader** ppShader)
+{
+	if (pBytecode == NULL || size == 0)
+	{
+		return E_INVALIDARG;
+	}
+
+	*ppShader = new NullPixelShader(&m_liveObjects);
+	return S_OK;
+}
+
+HRESULT NullRenderDevice::CreateInputLayout(const RenderInputElement* pElements, unsigned int count, const void* pBytecode, size_t size, RenderInputLayout** ppLayout)
+{
+	UNREFERENCED_PARAMETER(pElements);
+
+	if (count == 0 || pBytecode == NULL || size == 0)
+	{
+		return E_INVALIDARG;
+	}
+
+	*ppLayout = new NullInputLayout(&m_liveObjects);
+	return S_OK;
+}
+
+HRESULT NullRenderDevice::CreateRasterizerState(const RenderRasterizerDesc& desc, RenderRasterizerState** ppState)
+{
+	UNREFERENCED_PARAMETER(desc);
+
+	*ppState = new NullRasterizerState(&m_liveObjects);
+	return S_OK;
+}
+
+HRESULT NullRenderDevice::CreateBlendState(const RenderBlendDesc& desc, RenderBlendState** ppState)
+{
+	UNREFERENCED_PARAMETER(desc);
+
+	*ppState = new NullBlendState(&m_liveObjects);
+	return S_OK;
+}
+
+HRESULT NullRenderDevice::CreateDepthStencilState(const RenderDepthStencilDesc& desc, RenderDepthStencilState** ppState)
+{
+	UNREFERENCED_PARAMETER(desc);
+
+	*ppState = new NullDepthStencilState(&m_liveObjects);
+	return S_OK;
+}
+
+HRESULT NullRenderDevice::CreateSamplerState(const RenderSamplerDesc& desc, RenderSamplerState** ppState)
+{
+	UNREFERENCED_PARAMETER(desc);
+
+	*ppState = new NullSamplerState(&m_liveObjects);
+	return S_OK;
+}
+
+HRESULT NullRenderDevice::CreateQuery(RenderQueryType type, RenderQuery** ppQuery)
+{
+	*ppQuery = new NullQuery(&m_liveObjects, type);
+	return S_OK;
+}
+
+HRESULT NullRenderDevice::CreateDeferredContext(IRenderContext** ppContext)
+{
+	*ppContext = new NullRenderContext(&m_liveObjects);
+	return S_OK;
+}
+
+IRenderContext* NullRenderDevice::GetImmediateContext()
+{
+	return m_pContext;
+}
+
+void NullRenderDevice::SetQueryLatency(unsigned int frames)
+{
+	m_pContext->SetQueryLatency(frames);
+}
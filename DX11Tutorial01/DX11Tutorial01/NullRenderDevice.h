@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include "RenderDevice.h"
+#include "ShaderCache.h"
+#include "TextureLoader.h"
+
+class NullRenderContext;
+
+enum NullCommandType
+{
+	NULL_COMMAND_CLEAR_STATE = 0,
+	NULL_COMMAND_CLEAR_RENDER_TARGET,
+	NULL_COMMAND_CLEAR_DEPTH,
+	NULL_COMMAND_SET_VERTEX_BUFFERS,
+	NULL_COMMAND_SET_INDEX_BUFFER,
+	NULL_COMMAND_SET_INPUT_LAYOUT,
+	NULL_COMMAND_SET_TOPOLOGY,
+	NULL_COMMAND_SET_VERTEX_SHADER,
+	NULL_COMMAND_SET_VS_CONSTANT_BUFFERS,
+	NULL_COMMAND_SET_RASTERIZER_STATE,
+	NULL_COMMAND_SET_VIEWPORT,
+	NULL_COMMAND_SET_SCISSOR_RECT,
+	NULL_COMMAND_SET_PIXEL_SHADER,
+	NULL_COMMAND_SET_PS_CONSTANT_BUFFERS,
+	NULL_COMMAND_SET_PS_SHADER_RESOURCES,
+	NULL_COMMAND_SET_PS_SAMPLERS,
+	NULL_COMMAND_SET_RENDER_TARGETS,
+	NULL_COMMAND_SET_BLEND_STATE,
+	NULL_COMMAND_SET_DEPTH_STENCIL_STATE,
+	NULL_COMMAND_DRAW,
+	NULL_COMMAND_DRAW_INDEXED,
+	NULL_COMMAND_DRAW_INDEXED_INSTANCED,
+	NULL_COMMAND_MAP,
+	NULL_COMMAND_UNMAP,
+	NULL_COMMAND_BEGIN_QUERY,
+	NULL_COMMAND_END_QUERY,
+	NULL_COMMAND_EXECUTE_COMMAND_LIST,
+	NULL_COMMAND_PRESENT,
+	NULL_COMMAND_COUNT
+};
+
+// One call on a null context
+struct NullCommand
+{
+	NullCommandType type;
+	bool stateChange;           // Bind which changed pipeline state
+	unsigned int slot;          // First slot of binds
+	unsigned int count;         // Slots of binds, vertices or indices of draws
+	unsigned int instanceCount; // Instances of draws
+	const void* pObject;        // First bound object, cleared target, mapped buffer or begun or ended query
+};
+
+// Counters of the commands executed on the immediate context, executed command lists included
+struct NullFrameStats
+{
+	unsigned int commandCount;
+	unsigned int drawCount;
+	uint64_t triangleCount;
+	unsigned int bindCount;    // Commands which set pipeline state
+	unsigned int stateChanges; // Binds which changed something, the rest bound what was already there
+	unsigned int mapCount;
+	unsigned int commandListCount;
+};
+
+const char* GetNullCommandName(NullCommandType type);
+
+// Device which creates objects without a GPU and logs commands instead of executing them
+// Each context tracks pipeline state, so redundant binds are told from state changes
+// Dynamic buffers have memory to map, event queries are done as soon as they are ended
+// Timestamps come from a fake GPU clock which advances with the commands, they are there after the query latency
+// Shaders and textures are made up by the stub compiler and parser
+class NullRenderDevice : public IRenderDevice
+{
+public:
+	NullRenderDevice();
+
+	bool Init(unsigned int width, unsigned int height);
+	// Objects still alive after Term were leaked by the user
+	void Term();
+
+	virtual const char* GetName() const { return "Null"; }
+
+	virtual HRESULT CreateBuffer(const RenderBufferDesc& desc, const void* pData, RenderResource** ppBuffer);
+	virtual HRESULT CreateTexture(const RenderTextureDesc& desc, const void* pData, unsigned int rowPitch, RenderResource** ppTexture);
+	virtual HRESULT CreateTexture(const TextureData& data, RenderResource** ppTexture);
+
+	virtual HRESULT CreateVertexShader(const void* pBytecode, size_t size, RenderVertexShader** ppShader);
+	virtual HRESULT CreatePixelShader(const void* pBytecode, size_t size, RenderPixelShader** ppShader);
+	virtual HRESULT CreateInputLayout(const RenderInputElement* pElements, unsigned int count, const void* pBytecode, size_t size, RenderInputLayout** ppLayout);
+
+	virtual HRESULT CreateRasterizerState(const RenderRasterizerDesc& desc, RenderRasterizerState** ppState);
+	virtual HRESULT CreateBlendState(const RenderBlendDesc& desc, RenderBlendState** ppState);
+	virtual HRESULT CreateDepthStencilState(const RenderDepthStencilDesc& desc, RenderDepthStencilState** ppState);
+	virtual HRESULT CreateSamplerState(const RenderSamplerDesc& desc, RenderSamplerState** ppState);
+	virtual HRESULT CreateQuery(RenderQueryType type, RenderQuery** ppQuery);
+
+	virtual HRESULT CreateDeferredContext(IRenderContext** ppContext);
+	virtual IRenderContext* GetImmediateContext();
+
+	virtual RenderResource* GetBackBuffer() { return m_pBackBuffer; }
+	virtual unsigned int GetBackBufferWidth() const { return m_width; }
+	virtual unsigned int GetBackBufferHeight() const { return m_height; }
+	virtual HRESULT ResizeBackBuffer(unsigned int width, unsigned int height);
+	// Ends the frame, its log and stats replace the ones of the previous frame
+	virtual HRESULT Present();
+
+	virtual IShaderCompiler* GetShaderCompiler() { return &m_shaderCompiler; }
+	virtual ITextureParser* GetTextureParser() { return &m_textureParser; }
+	virtual const char* GetShaderCacheDirectory() const { return "ShaderCacheNull"; }
+
+	// Last presented frame
+	const std::vector<NullCommand>& GetFrameLog() const { return m_frameLog; }
+	const NullFrameStats& GetFrameStats() const { return m_frameStats; }
+	unsigned int GetFrameCount() const { return m_frameCount; }
+
+	// Frames presented before timestamps of the immediate context can be read, 0 by default, call after Init
+	void SetQueryLatency(unsigned int frames);
+
+	// Objects created and not released, the ones owned by the device included
+	int GetLiveObjectCount() const { return m_liveObjects; }
+
+private:
+	HRESULT CreateBackBuffer();
+
+private:
+	NullRenderContext* m_pContext;
+	RenderResource* m_pBackBuffer;
+	unsigned int m_width;
+	unsigned int m_height;
+
+	std::vector<NullCommand> m_frameLog;
+	NullFrameStats m_frameStats;
+	unsigned int m_frameCount;
+
+	std::atomic<int> m_liveObjects;
+
+	StubShaderCompiler m_shaderCompiler;
+	StubTextureParser m_textureParser;
+};
@@ -0,0 +1,34 @@
+Texture2D AccumTexture : register(t0);
+Texture2D RevealageTexture : register(t1);
+
+struct VSOutput
+{
+	float4 pos : SV_Position;
+};
+
+// Fullscreen triangle
+VSOutput VS(uint vertexId : SV_VertexID)
+{
+	float2 uv = float2((vertexId << 1) & 2, vertexId & 2);
+
+	VSOutput output;
+	output.pos = float4(uv * float2(2, -2) + float2(-1, 1), 0, 1);
+
+	return output;
+}
+
+float4 PS(in VSOutput input) : SV_Target0
+{
+	int3 pixel = int3(input.pos.xy, 0);
+
+	float revealage = RevealageTexture.Load(pixel).r;
+	if (revealage == 1.0)
+	{
+		discard;
+	}
+
+	float4 accum = AccumTexture.Load(pixel);
+
+	// Average color of transparent fragments, covers 1 - revealage of the background
+	return float4(accum.rgb / clamp(accum.a, 1e-4, 5e4), 1.0 - revealage);
+}
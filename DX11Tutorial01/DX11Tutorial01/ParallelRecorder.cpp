@@ -0,0 +1,88 @@
+#include "ParallelRecorder.h"
+
+#include <assert.h>
+
+void NullRecordBackend::BeginRecord(unsigned int chunkCount)
+{
+	// Chunks left unrecorded keep NoWorker
+	Chunk empty = { JobSystem::NoWorker, 0, 0 };
+	m_chunks.assign(chunkCount, empty);
+	m_submitted.clear();
+}
+
+bool NullRecordBackend::RecordChunk(unsigned int worker, unsigned int chunk, unsigned int firstItem, unsigned int itemCount)
+{
+	// Every chunk is recorded once, so no locking is needed
+	Chunk& recorded = m_chunks[chunk];
+	recorded.worker = worker;
+	recorded.firstItem = firstItem;
+	recorded.itemCount = itemCount;
+	return true;
+}
+
+void NullRecordBackend::SubmitChunk(unsigned int chunk)
+{
+	m_submitted.push_back(chunk);
+}
+
+void PartitionChunk(unsigned int itemCount, unsigned int chunkCount, unsigned int chunk, unsigned int* pFirstItem, unsigned int* pItemCount)
+{
+	unsigned int baseCount = itemCount / chunkCount;
+	unsigned int remainder = itemCount % chunkCount;
+
+	// First remainder chunks get one item more
+	*pFirstItem = chunk * baseCount + (chunk < remainder ? chunk : remainder);
+	*pItemCount = baseCount + (chunk < remainder ? 1 : 0);
+}
+
+ParallelRecorder::ParallelRecorder()
+	: m_pJobs(NULL)
+{
+}
+
+void ParallelRecorder::Init(JobSystem* pJobs)
+{
+	m_pJobs = pJobs;
+}
+
+void ParallelRecorder::Term()
+{
+	m_pJobs = NULL;
+}
+
+bool ParallelRecorder::Record(IRecordBackend* pBackend, unsigned int itemCount, unsigned int chunkCount)
+{
+	assert(m_pJobs != NULL);
+
+	pBackend->BeginRecord(chunkCount);
+	if (chunkCount == 0)
+	{
+		return true;
+	}
+
+	std::atomic<bool> failed(false);
+	JobSystem* pJobs = m_pJobs;
+	m_pJobs->ParallelFor(chunkCount, 1, [pJobs, pBackend, itemCount, chunkCount, &failed](unsigned int firstChunk, unsigned int count)
+	{
+		unsigned int worker = pJobs->GetWorkerIndex();
+		for (unsigned int chunk = firstChunk; chunk < firstChunk + count; chunk++)
+		{
+			unsigned int firstItem = 0;
+			unsigned int chunkItems = 0;
+			PartitionChunk(itemCount, chunkCount, chunk, &firstItem, &chunkItems);
+
+			if (!pBackend->RecordChunk(worker, chunk, firstItem, chunkItems))
+			{
+				failed = true;
+			}
+		}
+	});
+
+	// Submission order does not depend on which worker recorded what
+	for (unsigned int chunk = 0; chunk < chunkCount; chunk++)
+	{
+		pBackend->SubmitChunk(chunk);
+	}
+
+	return !failed;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include "JobSystem.h"
+
+// Records chunks of draw items, each worker has its own recording context
+class IRecordBackend
+{
+public:
+	virtual ~IRecordBackend() {}
+
+	// Called on the submitting thread before chunks are recorded
+	virtual void BeginRecord(unsigned int chunkCount) = 0;
+	// Called on any worker, a worker records one chunk at a time
+	virtual bool RecordChunk(unsigned int worker, unsigned int chunk, unsigned int firstItem, unsigned int itemCount) = 0;
+	// Called on the submitting thread in increasing chunk order after all chunks are recorded
+	virtual void SubmitChunk(unsigned int chunk) = 0;
+};
+
+// Backend which only remembers what was recorded and submitted, to test scheduling without a device
+class NullRecordBackend : public IRecordBackend
+{
+public:
+	struct Chunk
+	{
+		unsigned int worker;
+		unsigned int firstItem;
+		unsigned int itemCount;
+	};
+
+	virtual void BeginRecord(unsigned int chunkCount);
+	virtual bool RecordChunk(unsigned int worker, unsigned int chunk, unsigned int firstItem, unsigned int itemCount);
+	virtual void SubmitChunk(unsigned int chunk);
+
+	const std::vector<Chunk>& GetChunks() const { return m_chunks; }
+	const std::vector<unsigned int>& GetSubmitted() const { return m_submitted; }
+
+private:
+	std::vector<Chunk> m_chunks;
+	std::vector<unsigned int> m_submitted;
+};
+
+// Split itemCount items into chunkCount contiguous chunks which differ in size by at most one
+void PartitionChunk(unsigned int itemCount, unsigned int chunkCount, unsigned int chunk, unsigned int* pFirstItem, unsigned int* pItemCount);
+
+// Records chunks in parallel on the job system workers and submits them in chunk order
+// Worker index passed to the backend is the job system worker index
+class ParallelRecorder
+{
+public:
+	ParallelRecorder();
+
+	void Init(JobSystem* pJobs);
+	void Term();
+
+	unsigned int GetWorkerCount() const { return m_pJobs != NULL ? m_pJobs->GetWorkerCount() : 0; }
+
+	// Must be called on a job system worker
+	// Chunks are submitted even if some of them failed to record, returns false in this case
+	bool Record(IRecordBackend* pBackend, unsigned int itemCount, unsigned int chunkCount);
+
+private:
+	JobSystem* m_pJobs;
+};
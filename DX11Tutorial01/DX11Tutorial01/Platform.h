@@ -0,0 +1,45 @@
+#pragma once
+
+// Windows types and calls used by the renderer, mapped to the C runtime where there is no Windows SDK
+#ifdef _WIN32
+
+#include <windows.h>
+
+#else
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef int32_t HRESULT;
+typedef int BOOL;
+typedef uint8_t BYTE;
+typedef int32_t LONG;
+typedef float FLOAT;
+typedef unsigned int UINT;
+typedef uint16_t UINT16;
+typedef uint64_t UINT64;
+
+#define TRUE 1
+#define FALSE 0
+
+#define S_OK ((HRESULT)0)
+#define S_FALSE ((HRESULT)1)
+#define E_NOTIMPL ((HRESULT)0x80004001)
+#define E_FAIL ((HRESULT)0x80004005)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000E)
+#define E_INVALIDARG ((HRESULT)0x80070057)
+
+#define UNREFERENCED_PARAMETER(P) (void)(P)
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+// Buffer must be an array, as with the template overload of the secure CRT
+#define sprintf_s(buffer, ...) snprintf(buffer, sizeof(buffer), __VA_ARGS__)
+
+inline void OutputDebugStringA(const char* pMessage)
+{
+	fputs(pMessage, stderr);
+}
+
+#endif
@@ -0,0 +1,254 @@
+#include "Profiler.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Platform.h"
+
+struct ProfileEvent
+{
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+};
+
+// Events are written by the owning thread only, the exporter reads them up to count
+struct ProfileThreadBuffer
+{
+	std::unique_ptr<ProfileEvent[]> events; // Allocated on the first event
+	std::atomic<unsigned int> count;
+	std::atomic<unsigned int> dropped;
+	unsigned int id;
+	std::string name;
+};
+
+std::atomic<bool> Profiler::s_enabled(false);
+
+// Buffers stay after their threads exit, so the trace keeps events of the whole capture
+static std::mutex s_buffersMutex;
+static std::vector<std::unique_ptr<ProfileThreadBuffer>> s_buffers;
+static thread_local ProfileThreadBuffer* t_pBuffer = NULL;
+static ProfileThreadBuffer* s_pGpuBuffer = NULL;
+
+// Ticks and time at the capture bounds, ticks are converted with their ratio
+static uint64_t s_startTicks = 0;
+static uint64_t s_stopTicks = 0;
+static std::chrono::steady_clock::time_point s_startTime;
+static std::chrono::steady_clock::time_point s_stopTime;
+
+// Ticks and time at static initialization, for GetTicksPerSecond
+static const uint64_t s_processTicks = Profiler::GetTimestamp();
+static const std::chrono::steady_clock::time_point s_processTime = std::chrono::steady_clock::now();
+
+// Called with the buffers mutex locked
+static ProfileThreadBuffer* CreateBuffer()
+{
+	std::unique_ptr<ProfileThreadBuffer> buffer(new ProfileThreadBuffer());
+	buffer->count = 0;
+	buffer->dropped = 0;
+	buffer->id = (unsigned int)s_buffers.size() + 1;
+
+	s_buffers.push_back(std::move(buffer));
+	return s_buffers.back().get();
+}
+
+static ProfileThreadBuffer* GetThreadBuffer()
+{
+	if (t_pBuffer == NULL)
+	{
+		std::lock_guard<std::mutex> lock(s_buffersMutex);
+		t_pBuffer = CreateBuffer();
+	}
+	return t_pBuffer;
+}
+
+static ProfileThreadBuffer* GetGpuBuffer()
+{
+	std::lock_guard<std::mutex> lock(s_buffersMutex);
+	if (s_pGpuBuffer == NULL)
+	{
+		s_pGpuBuffer = CreateBuffer();
+		s_pGpuBuffer->name = "GPU";
+	}
+	return s_pGpuBuffer;
+}
+
+static void AddBufferEvent(ProfileThreadBuffer* pBuffer, const char* name, uint64_t start, uint64_t end)
+{
+	if (!pBuffer->events)
+	{
+		pBuffer->events.reset(new ProfileEvent[Profiler::MaxEventsPerThread]);
+	}
+
+	unsigned int count = pBuffer->count.load(std::memory_order_relaxed);
+	if (count < Profiler::MaxEventsPerThread)
+	{
+		pBuffer->events[count] = ProfileEvent{ name, start, end };
+		pBuffer->count.store(count + 1, std::memory_order_release);
+	}
+	else
+	{
+		pBuffer->dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void Profiler::Start()
+{
+	std::lock_guard<std::mutex> lock(s_buffersMutex);
+	for (std::unique_ptr<ProfileThreadBuffer>& buffer : s_buffers)
+	{
+		buffer->count.store(0, std::memory_order_relaxed);
+		buffer->dropped.store(0, std::memory_order_relaxed);
+	}
+
+	s_startTime = std::chrono::steady_clock::now();
+	s_startTicks = GetTimestamp();
+	s_stopTicks = 0;
+	s_enabled.store(true, std::memory_order_release);
+}
+
+void Profiler::Stop()
+{
+	if (s_enabled.exchange(false))
+	{
+		s_stopTicks = GetTimestamp();
+		s_stopTime = std::chrono::steady_clock::now();
+	}
+}
+
+double Profiler::GetTicksPerSecond()
+{
+	uint64_t ticks = GetTimestamp();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - s_processTime).count();
+
+	return seconds > 0.0 && ticks > s_processTicks ? (ticks - s_processTicks) / seconds : 1.0e9;
+}
+
+void Profiler::AddEvent(const char* name, uint64_t start, uint64_t end)
+{
+	AddBufferEvent(GetThreadBuffer(), name, start, end);
+}
+
+void Profiler::AddGpuEvent(const char* name, uint64_t start, uint64_t end)
+{
+	AddBufferEvent(GetGpuBuffer(), name, start, end);
+}
+
+unsigned int Profiler::GetDroppedCount()
+{
+	std::lock_guard<std::mutex> lock(s_buffersMutex);
+
+	unsigned int dropped = 0;
+	for (const std::unique_ptr<ProfileThreadBuffer>& buffer : s_buffers)
+	{
+		dropped += buffer->dropped.load(std::memory_order_relaxed);
+	}
+	return dropped;
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ProfileThreadBuffer* pBuffer = GetThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(s_buffersMutex);
+	pBuffer->name = name;
+}
+
+// Control characters are not allowed in JSON strings, the ones without a short escape are written as \u
+static void WriteJsonString(std::ostream& json, const char* text)
+{
+	json << '"';
+	for (const char* pChar = text; *pChar != 0; pChar++)
+	{
+		unsigned char c = (unsigned char)*pChar;
+		if (c == '"' || c == '\\')
+		{
+			json << '\\' << *pChar;
+		}
+		else if (c == '\n' || c == '\r' || c == '\t')
+		{
+			json << '\\' << (c == '\n' ? 'n' : c == '\r' ? 'r' : 't');
+		}
+		else if (c < 0x20)
+		{
+			char escape[8];
+			sprintf_s(escape, "\\u%04x", c);
+			json << escape;
+		}
+		else
+		{
+			json << *pChar;
+		}
+	}
+	json << '"';
+}
+
+bool Profiler::WriteChromeTrace(const char* fileName)
+{
+	// Capture in progress is exported up to now
+	uint64_t stopTicks = s_stopTicks;
+	std::chrono::steady_clock::time_point stopTime = s_stopTime;
+	if (IsEnabled() || stopTicks == 0)
+	{
+		stopTicks = GetTimestamp();
+		stopTime = std::chrono::steady_clock::now();
+	}
+
+	double captureUs = std::chrono::duration<double, std::micro>(stopTime - s_startTime).count();
+	double ticksPerUs = captureUs > 0.0 && stopTicks > s_startTicks ? (stopTicks - s_startTicks) / captureUs : 1.0;
+
+	std::ostringstream json;
+	json.setf(std::ios::fixed);
+	json.precision(3);
+	json << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+	std::lock_guard<std::mutex> lock(s_buffersMutex);
+
+	bool first = true;
+	unsigned int dropped = 0;
+	for (const std::unique_ptr<ProfileThreadBuffer>& buffer : s_buffers)
+	{
+		unsigned int count = buffer->count.load(std::memory_order_acquire);
+		dropped += buffer->dropped.load(std::memory_order_relaxed);
+		if (count == 0)
+		{
+			continue;
+		}
+
+		char defaultName[32];
+		sprintf_s(defaultName, "Thread %u", buffer->id);
+
+		json << (first ? "" : ",") << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->id << ", \"args\": {\"name\": ";
+		WriteJsonString(json, buffer->name.empty() ? defaultName : buffer->name.c_str());
+		json << "}}";
+		first = false;
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const ProfileEvent& event = buffer->events[i];
+			if (event.start < s_startTicks)
+			{
+				continue; // Opened during an earlier capture
+			}
+
+			json << ",\n{\"name\": ";
+			WriteJsonString(json, event.name);
+			json << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->id
+				<< ", \"ts\": " << (event.start - s_startTicks) / ticksPerUs
+				<< ", \"dur\": " << (event.end - event.start) / ticksPerUs << "}";
+		}
+	}
+
+	json << "\n], \"otherData\": {\"droppedEvents\": " << dropped << "}}\n";
+
+	std::ofstream file(fileName, std::ios::trunc);
+	file << json.str();
+	return (bool)file;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define PROFILER_RDTSC
+#else
+#include <chrono>
+#endif
+
+// Scoped CPU markers written to per-thread event buffers without locks, exported as Chrome trace events
+// Markers are recorded between Start and Stop only, otherwise a marker tests one flag and does nothing else
+// Names are kept as pointers, so they must be string literals or outlive the export
+class Profiler
+{
+public:
+	static const unsigned int MaxEventsPerThread = 64 * 1024; // Later events of a capture are dropped
+
+	// Captures restart from empty buffers, call them between frames when no markers are open
+	static void Start();
+	static void Stop();
+	static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+	// Trace of the last capture, opens in chrome://tracing or Perfetto
+	static bool WriteChromeTrace(const char* fileName);
+	// Events which did not fit in the buffers during the last capture
+	static unsigned int GetDroppedCount();
+
+	// Thread name shown in the trace, unnamed threads are numbered
+	static void SetThreadName(const char* name);
+
+	// Ticks, converted to time with the clock measured over the capture
+	static uint64_t GetTimestamp()
+	{
+#ifdef PROFILER_RDTSC
+		return __rdtsc();
+#else
+		return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+	}
+
+	// Rate of the ticks measured since the process started, for clocks which are converted to ticks
+	static double GetTicksPerSecond();
+
+	static void AddEvent(const char* name, uint64_t start, uint64_t end);
+	// Event of the GPU track, in ticks as the CPU markers, written by one thread at a time
+	static void AddGpuEvent(const char* name, uint64_t start, uint64_t end);
+
+private:
+	static std::atomic<bool> s_enabled;
+};
+
+// Marker from construction to the end of the scope, name as for Profiler
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name)
+		: m_name(name)
+		, m_start(0)
+	{
+		if (Profiler::IsEnabled())
+		{
+			m_start = Profiler::GetTimestamp();
+		}
+	}
+
+	// Event of a scope opened while recording is kept, so no check of the flag here
+	~ProfileScope()
+	{
+		if (m_start != 0)
+		{
+			Profiler::AddEvent(m_name, m_start, Profiler::GetTimestamp());
+		}
+	}
+
+private:
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+	const char* m_name;
+	uint64_t m_start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
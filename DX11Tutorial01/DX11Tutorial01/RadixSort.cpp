@@ -0,0 +1,72 @@
+#include "RadixSort.h"
+
+#include <string.h>
+
+static const unsigned int RadixBits = 8;
+static const unsigned int RadixSize = 1 << RadixBits;
+static const unsigned int PassCount = 32 / RadixBits;
+
+static const unsigned int DepthKeyMax = 0xFFFF;
+
+void RadixSort::Sort(const unsigned int* pKeys, unsigned int count)
+{
+	m_keys.assign(pKeys, pKeys + count);
+	m_indices.resize(count);
+	m_tempKeys.resize(count);
+	m_tempIndices.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		m_indices[i] = i;
+	}
+
+	// Histograms of all passes are gathered in one read of the keys
+	unsigned int histograms[PassCount][RadixSize];
+	memset(histograms, 0, sizeof(histograms));
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned int key = pKeys[i];
+		for (unsigned int pass = 0; pass < PassCount; pass++)
+		{
+			histograms[pass][(key >> (pass * RadixBits)) & (RadixSize - 1)]++;
+		}
+	}
+
+	for (unsigned int pass = 0; pass < PassCount; pass++)
+	{
+		unsigned int* pHistogram = histograms[pass];
+		unsigned int shift = pass * RadixBits;
+
+		// All keys have the same digit, order does not change
+		if (count == 0 || pHistogram[(m_keys[0] >> shift) & (RadixSize - 1)] == count)
+		{
+			continue;
+		}
+
+		unsigned int offset = 0;
+		for (unsigned int digit = 0; digit < RadixSize; digit++)
+		{
+			unsigned int digitCount = pHistogram[digit];
+			pHistogram[digit] = offset;
+			offset += digitCount;
+		}
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int key = m_keys[i];
+			unsigned int dst = pHistogram[(key >> shift) & (RadixSize - 1)]++;
+			m_tempKeys[dst] = key;
+			m_tempIndices[dst] = m_indices[i];
+		}
+
+		m_keys.swap(m_tempKeys);
+		m_indices.swap(m_tempIndices);
+	}
+}
+
+unsigned int BackToFrontKey(float depth, float nearPlane, float farPlane)
+{
+	float t = (depth - nearPlane) / (farPlane - nearPlane);
+	t = t < 0 ? 0 : (t > 1 ? 1 : t);
+
+	return DepthKeyMax - (unsigned int)(t * DepthKeyMax + 0.5f);
+}
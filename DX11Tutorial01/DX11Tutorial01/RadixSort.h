@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+// Stable LSD radix sort of 32-bit keys, eight bits per pass
+// Result is the permutation of input indices, passes where all keys share the digit are skipped,
+// so keys quantized to 16 bits take two passes
+class RadixSort
+{
+public:
+	void Sort(const unsigned int* pKeys, unsigned int count);
+
+	// Indices of input keys in increasing key order
+	const std::vector<unsigned int>& GetIndices() const { return m_indices; }
+
+private:
+	std::vector<unsigned int> m_keys;
+	std::vector<unsigned int> m_indices;
+	std::vector<unsigned int> m_tempKeys;
+	std::vector<unsigned int> m_tempIndices;
+};
+
+// Sort key which orders view depths from far to near, depth is quantized to 16 bits over [nearPlane, farPlane]
+unsigned int BackToFrontKey(float depth, float nearPlane, float farPlane);
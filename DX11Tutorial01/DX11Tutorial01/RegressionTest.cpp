@@ -0,0 +1,479 @@
+#include "RegressionTest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+#include "NullRenderDevice.h"
+#include "Renderer.h"
+#include "SoftwareRasterizer.h"
+
+namespace fs = std::filesystem;
+
+static const char* ScriptFileName = "Regression.txt";
+static const char* GoldenDirectory = "Golden";
+static const char* OutputDirectory = "Regression";
+static const char* ReportFileName = "Report.json";
+static const double FrameTime = 1.0 / 60.0; // Animation step, so frames do not depend on the clock
+
+static bool ScriptError(const char* fileName, UINT line, const std::string& message, std::string& errors)
+{
+	std::ostringstream text;
+	text << fileName << "(" << line << "): " << message;
+	errors = text.str();
+	return false;
+}
+
+bool LoadRegressionScript(const char* fileName, RegressionScript& script, std::string& errors)
+{
+	std::ifstream file(fileName);
+	if (!file)
+	{
+		errors = std::string("can not open ") + fileName;
+		return false;
+	}
+
+	script.width = 320;
+	script.height = 180;
+	script.tolerance.maxDeltaE = 2.3f;
+	script.tolerance.maxBadFraction = 0.001f;
+	script.tolerance.radius = 1;
+	script.paths.clear();
+
+	std::string lineText;
+	UINT line = 0;
+	while (std::getline(file, lineText))
+	{
+		line++;
+		std::istringstream words(lineText.substr(0, lineText.find('#')));
+		std::string command;
+		if (!(words >> command))
+		{
+			continue;
+		}
+
+		if (command == "size")
+		{
+			if (!(words >> script.width >> script.height) || script.width == 0 || script.height == 0
+				|| script.width > SoftwareRasterizer::MaxSize || script.height > SoftwareRasterizer::MaxSize)
+			{
+				return ScriptError(fileName, line, "size needs width and height up to 4096", errors);
+			}
+		}
+		else if (command == "tolerance")
+		{
+			if (!(words >> script.tolerance.maxDeltaE >> script.tolerance.maxBadFraction >> script.tolerance.radius))
+			{
+				return ScriptError(fileName, line, "tolerance needs delta E, bad pixel fraction and radius", errors);
+			}
+		}
+		else if (command == "path")
+		{
+			CameraPath path = {};
+			if (!(words >> path.name >> path.frameCount) || path.frameCount == 0)
+			{
+				return ScriptError(fileName, line, "path needs a name and frame count", errors);
+			}
+
+			std::string option;
+			while (words >> option)
+			{
+				if (option == "lightfield")
+				{
+					path.lightField = true;
+				}
+				else if (option == "flatnormals")
+				{
+					path.flatNormals = true;
+				}
+				else
+				{
+					return ScriptError(fileName, line, "unknown path option " + option, errors);
+				}
+			}
+			script.paths.push_back(path);
+		}
+		else if (command == "key" || command == "capture")
+		{
+			if (script.paths.empty())
+			{
+				return ScriptError(fileName, line, command + " has to follow a path", errors);
+			}
+
+			CameraPath& path = script.paths.back();
+			if (command == "key")
+			{
+				CameraKey key;
+				if (!(words >> key.frame >> key.lon >> key.lat >> key.dist))
+				{
+					return ScriptError(fileName, line, "key needs frame, longitude, latitude and distance", errors);
+				}
+				if (key.frame >= path.frameCount || (!path.keys.empty() && key.frame <= path.keys.back().frame))
+				{
+					return ScriptError(fileName, line, "key frames have to increase and be within the path", errors);
+				}
+
+				// Degrees in the script
+				key.lon = key.lon * (float)M_PI / 180.0f;
+				key.lat = key.lat * (float)M_PI / 180.0f;
+				path.keys.push_back(key);
+			}
+			else
+			{
+				UINT frame;
+				while (words >> frame)
+				{
+					if (frame >= path.frameCount)
+					{
+						return ScriptError(fileName, line, "capture is past the end of the path", errors);
+					}
+					path.captures.push_back(frame);
+				}
+			}
+		}
+		else
+		{
+			return ScriptError(fileName, line, "unknown command " + command, errors);
+		}
+	}
+
+	for (const CameraPath& path : script.paths)
+	{
+		if (path.keys.empty())
+		{
+			errors = std::string(fileName) + ": path " + path.name + " has no camera keys";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static CameraKey GetCamera(const CameraPath& path, UINT frame)
+{
+	size_t next = 0;
+	while (next < path.keys.size() && path.keys[next].frame < frame)
+	{
+		next++;
+	}
+
+	if (next == 0)
+	{
+		return path.keys.front();
+	}
+	if (next == path.keys.size())
+	{
+		return path.keys.back();
+	}
+
+	const CameraKey& a = path.keys[next - 1];
+	const CameraKey& b = path.keys[next];
+	float t = (float)(frame - a.frame) / (b.frame - a.frame);
+
+	CameraKey key;
+	key.frame = frame;
+	key.lon = a.lon + (b.lon - a.lon) * t;
+	key.lat = a.lat + (b.lat - a.lat) * t;
+	key.dist = a.dist + (b.dist - a.dist) * t;
+	return key;
+}
+
+struct FrameTiming
+{
+	double updateMs;   // Update, CPU stages of the frame
+	double renderMs;   // Render, commands on the null device
+	double softwareMs; // RenderSoftware, the offscreen image
+};
+
+struct CaptureResult
+{
+	UINT frame;
+	const char* status; // "passed", "failed", "recorded", "missing" or "error"
+	ImageDifference difference;
+};
+
+struct PathResult
+{
+	const CameraPath* pPath;
+	std::vector<FrameTiming> timings;
+	std::vector<CaptureResult> captures;
+	bool rendered;
+};
+
+static std::string GetCaptureName(const CameraPath& path, UINT frame, const char* suffix)
+{
+	char name[32];
+	sprintf_s(name, "_%04u%s.dds", frame, suffix);
+	return path.name + name;
+}
+
+static void Report(const std::string& report)
+{
+#ifdef _WIN32
+	OutputDebugStringA(report.c_str());
+#endif
+	printf("%s", report.c_str());
+	fflush(stdout);
+}
+
+static CaptureResult CheckCapture(const CameraPath& path, UINT frame, const SoftwareRasterizer& rasterizer,
+	const ImageTolerance& tolerance, bool record)
+{
+	CaptureResult result = {};
+	result.frame = frame;
+
+	Image image;
+	image.width = rasterizer.GetWidth();
+	image.height = rasterizer.GetHeight();
+	image.pixels.resize((size_t)image.width * image.height * 4);
+	memcpy(image.pixels.data(), rasterizer.GetPixels(), image.pixels.size());
+
+	std::string name = GetCaptureName(path, frame, "");
+	std::string goldenPath = (fs::path(GoldenDirectory) / name).string();
+	std::string errors;
+
+	if (record)
+	{
+		result.status = WriteDDSImage(goldenPath, image, errors) ? "recorded" : "error";
+	}
+	else
+	{
+		// Errors of files written for a look at what changed are not reported
+		std::string writeErrors;
+		std::vector<Image> golden;
+		Image diff;
+		if (!ReadDDSImage(goldenPath, golden, errors))
+		{
+			result.status = "missing";
+		}
+		else if (!CompareImages(golden[0], image, tolerance, result.difference, &diff))
+		{
+			result.status = "error";
+			errors = goldenPath + " is not of the target size";
+		}
+		else if (result.difference.passed)
+		{
+			result.status = "passed";
+		}
+		else
+		{
+			result.status = "failed";
+			WriteDDSImage((fs::path(OutputDirectory) / GetCaptureName(path, frame, "_diff")).string(), diff, writeErrors);
+		}
+
+		if (strcmp(result.status, "passed") != 0)
+		{
+			WriteDDSImage((fs::path(OutputDirectory) / name).string(), image, writeErrors);
+		}
+	}
+
+	char report[256];
+	if (strcmp(result.status, "passed") == 0 || strcmp(result.status, "failed") == 0)
+	{
+		sprintf_s(report, "  %-24s %-8s delta E max %.2f mean %.3f, %.4f%% over tolerance\n", name.c_str(), result.status,
+			result.difference.maxDeltaE, result.difference.meanDeltaE, result.difference.badFraction * 100.0f);
+	}
+	else if (!errors.empty())
+	{
+		sprintf_s(report, "  %-24s %-8s %s\n", name.c_str(), result.status, errors.c_str());
+	}
+	else
+	{
+		sprintf_s(report, "  %-24s %s\n", name.c_str(), result.status);
+	}
+	Report(report);
+
+	return result;
+}
+
+static bool RunPath(const CameraPath& path, const RegressionScript& script, const SoftwareTexture& colorTexture,
+	const SoftwareTexture& normalTexture, bool record, PathResult& result)
+{
+	NullRenderDevice device;
+	if (!device.Init(script.width, script.height))
+	{
+		return false;
+	}
+
+	SoftwareRasterizer rasterizer;
+	rasterizer.Init(script.width, script.height);
+	rasterizer.SetTextures(&colorTexture, &normalTexture);
+
+	Renderer renderer;
+	bool succeeded = renderer.Init(&device);
+	if (path.lightField)
+	{
+		renderer.SwitchLightField();
+	}
+	if (path.flatNormals)
+	{
+		renderer.SwitchNormalMode();
+	}
+
+	for (UINT frame = 0; frame < path.frameCount && succeeded; frame++)
+	{
+		CameraKey camera = GetCamera(path, frame);
+		renderer.SetCamera(camera.lon, camera.lat, camera.dist);
+		renderer.SetAnimationTime(frame * FrameTime);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		succeeded = renderer.Update();
+		std::chrono::steady_clock::time_point updated = std::chrono::steady_clock::now();
+		succeeded = succeeded && renderer.Render();
+		std::chrono::steady_clock::time_point rendered = std::chrono::steady_clock::now();
+		succeeded = succeeded && renderer.RenderSoftware(rasterizer);
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		FrameTiming timing;
+		timing.updateMs = std::chrono::duration<double, std::milli>(updated - start).count();
+		timing.renderMs = std::chrono::duration<double, std::milli>(rendered - updated).count();
+		timing.softwareMs = std::chrono::duration<double, std::milli>(end - rendered).count();
+		result.timings.push_back(timing);
+
+		if (succeeded && std::find(path.captures.begin(), path.captures.end(), frame) != path.captures.end())
+		{
+			result.captures.push_back(CheckCapture(path, frame, rasterizer, script.tolerance, record));
+		}
+	}
+
+	renderer.Term();
+	rasterizer.Term();
+	device.Term();
+
+	return succeeded;
+}
+
+// Average, 95th percentile and maximum of one timing over the frames of a path
+static void WriteTimingSummary(std::ostream& json, const char* name, const std::vector<FrameTiming>& timings, double FrameTiming::* pValue)
+{
+	std::vector<double> values;
+	double total = 0.0;
+	for (const FrameTiming& timing : timings)
+	{
+		values.push_back(timing.*pValue);
+		total += timing.*pValue;
+	}
+	std::sort(values.begin(), values.end());
+
+	size_t count = values.size();
+	json << "\"" << name << "\": {\"avg\": " << (count != 0 ? total / count : 0.0)
+		<< ", \"p95\": " << (count != 0 ? values[(count - 1) * 95 / 100] : 0.0)
+		<< ", \"max\": " << (count != 0 ? values.back() : 0.0) << "}";
+}
+
+static bool WriteReport(const std::string& fileName, const RegressionScript& script, const std::vector<PathResult>& results, bool record, bool passed)
+{
+	std::ostringstream json;
+	json.setf(std::ios::fixed);
+	json.precision(4);
+
+	json << "{\n  \"mode\": \"" << (record ? "record" : "compare") << "\",\n"
+		<< "  \"width\": " << script.width << ",\n  \"height\": " << script.height << ",\n"
+		<< "  \"tolerance\": {\"maxDeltaE\": " << script.tolerance.maxDeltaE << ", \"maxBadFraction\": " << script.tolerance.maxBadFraction
+		<< ", \"radius\": " << script.tolerance.radius << "},\n"
+		<< "  \"passed\": " << (passed ? "true" : "false") << ",\n"
+		<< "  \"paths\": [";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const PathResult& result = results[i];
+		json << (i != 0 ? "," : "") << "\n    {\n      \"name\": \"" << result.pPath->name << "\",\n"
+			<< "      \"rendered\": " << (result.rendered ? "true" : "false") << ",\n"
+			<< "      \"summaryMs\": {";
+		WriteTimingSummary(json, "update", result.timings, &FrameTiming::updateMs);
+		json << ", ";
+		WriteTimingSummary(json, "render", result.timings, &FrameTiming::renderMs);
+		json << ", ";
+		WriteTimingSummary(json, "software", result.timings, &FrameTiming::softwareMs);
+		json << "},\n      \"frames\": [";
+
+		for (size_t frame = 0; frame < result.timings.size(); frame++)
+		{
+			const FrameTiming& timing = result.timings[frame];
+			json << (frame != 0 ? ", " : "") << (frame % 4 == 0 ? "\n        " : "")
+				<< "{\"update\": " << timing.updateMs << ", \"render\": " << timing.renderMs << ", \"software\": " << timing.softwareMs << "}";
+		}
+		json << "\n      ],\n      \"captures\": [";
+
+		for (size_t capture = 0; capture < result.captures.size(); capture++)
+		{
+			const CaptureResult& item = result.captures[capture];
+			json << (capture != 0 ? "," : "") << "\n        {\"frame\": " << item.frame << ", \"status\": \"" << item.status << "\""
+				<< ", \"maxDeltaE\": " << item.difference.maxDeltaE << ", \"meanDeltaE\": " << item.difference.meanDeltaE
+				<< ", \"badFraction\": " << item.difference.badFraction << "}";
+		}
+		json << "\n      ]\n    }";
+	}
+	json << "\n  ]\n}\n";
+
+	std::ofstream file(fileName, std::ios::trunc);
+	file << json.str();
+	return (bool)file;
+}
+
+int RunRegression(bool record)
+{
+	RegressionScript script;
+	std::string errors;
+	if (!LoadRegressionScript(ScriptFileName, script, errors))
+	{
+		Report("Regression script is not valid: " + errors + "\n");
+		return 1;
+	}
+
+	SoftwareTexture colorTexture;
+	SoftwareTexture normalTexture;
+	if (!colorTexture.Load("Brick.dds", errors) || !normalTexture.Load("BrickNM.dds", errors))
+	{
+		Report("Regression textures are not available: " + errors + "\n");
+		return 1;
+	}
+
+	// Captures of the last run are not mixed with the ones of this run
+	std::error_code error;
+	fs::remove_all(OutputDirectory, error);
+	fs::create_directories(OutputDirectory, error);
+	if (record)
+	{
+		fs::create_directories(GoldenDirectory, error);
+	}
+
+	bool passed = true;
+	std::vector<PathResult> results;
+	for (const CameraPath& path : script.paths)
+	{
+		Report("Path " + path.name + "\n");
+
+		PathResult result;
+		result.pPath = &path;
+		result.rendered = RunPath(path, script, colorTexture, normalTexture, record, result);
+		passed = passed && result.rendered;
+		if (!result.rendered)
+		{
+			Report("  rendering failed\n");
+		}
+		for (const CaptureResult& capture : result.captures)
+		{
+			passed = passed && (strcmp(capture.status, "passed") == 0 || strcmp(capture.status, "recorded") == 0);
+		}
+		results.push_back(result);
+	}
+
+	std::string reportPath = (fs::path(OutputDirectory) / ReportFileName).string();
+	if (!WriteReport(reportPath, script, results, record, passed))
+	{
+		Report("Can not write " + reportPath + "\n");
+		passed = false;
+	}
+
+	Report(std::string(passed ? "Regression passed" : "Regression FAILED") + ", report in " + reportPath + "\n");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ImageCompare.h"
+#include "Platform.h"
+
+// Camera position at a frame of a path, angles in radians
+struct CameraKey
+{
+	UINT frame;
+	float lon;
+	float lat;
+	float dist;
+};
+
+struct CameraPath
+{
+	std::string name;
+	UINT frameCount;
+	bool lightField;
+	bool flatNormals;
+	std::vector<CameraKey> keys;  // Increasing frames, camera is linear between them
+	std::vector<UINT> captures;   // Frames compared with golden images
+};
+
+struct RegressionScript
+{
+	UINT width;                   // Offscreen target of all paths
+	UINT height;
+	ImageTolerance tolerance;
+	std::vector<CameraPath> paths;
+};
+
+// Text script, see Regression.txt for the commands
+bool LoadRegressionScript(const char* fileName, RegressionScript& script, std::string& errors);
+
+// Renders the paths of Regression.txt with the software rasterizer and compares captures with images in Golden
+// Record stores the captures as new golden images instead
+// Timings of all frames go to Regression/Report.json, with captures and diffs of failed frames
+// Returns 0 when all captures match
+int RunRegression(bool record);
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Platform.h"
+
+class IShaderCompiler;
+class ITextureParser;
+struct TextureData;
+
+static const unsigned int RenderMaxVertexBuffers = 4;
+static const unsigned int RenderMaxRenderTargets = 8;
+static const unsigned int RenderMaxConstantBuffers = 14;
+static const unsigned int RenderMaxShaderResources = 16;
+static const unsigned int RenderMaxSamplers = 16;
+
+// Values of the enums below match their D3D11 and DXGI counterparts
+
+enum RenderFormat
+{
+	FORMAT_UNKNOWN = 0,
+	FORMAT_R32G32B32A32_FLOAT = 2,
+	FORMAT_R32G32B32_FLOAT = 6,
+	FORMAT_R16G16B16A16_FLOAT = 10,
+	FORMAT_R32G32_FLOAT = 16,
+	FORMAT_R32G32_UINT = 17,
+	FORMAT_R8G8B8A8_UNORM = 28,
+	FORMAT_R32_UINT = 42,
+	FORMAT_D24_UNORM_S8_UINT = 45,
+	FORMAT_R16_FLOAT = 54,
+	FORMAT_R16_UINT = 57
+};
+
+enum RenderUsage
+{
+	USAGE_DEFAULT = 0,
+	USAGE_IMMUTABLE = 1,
+	USAGE_DYNAMIC = 2 // Written by the CPU with Map
+};
+
+enum RenderBindFlags
+{
+	BIND_VERTEX_BUFFER = 0x1,
+	BIND_INDEX_BUFFER = 0x2,
+	BIND_CONSTANT_BUFFER = 0x4,
+	BIND_SHADER_RESOURCE = 0x8,
+	BIND_RENDER_TARGET = 0x20,
+	BIND_DEPTH_STENCIL = 0x40
+};
+
+enum RenderMap
+{
+	MAP_WRITE_DISCARD = 4,
+	MAP_WRITE_NO_OVERWRITE = 5
+};
+
+enum RenderQueryType
+{
+	QUERY_EVENT = 0,
+	QUERY_TIMESTAMP = 2,
+	QUERY_TIMESTAMP_DISJOINT = 3
+};
+
+enum RenderTopology
+{
+	TOPOLOGY_UNDEFINED = 0,
+	TOPOLOGY_TRIANGLE_LIST = 4
+};
+
+enum RenderCullMode
+{
+	CULL_NONE = 1,
+	CULL_FRONT = 2,
+	CULL_BACK = 3
+};
+
+enum RenderBlend
+{
+	BLEND_ZERO = 1,
+	BLEND_ONE = 2,
+	BLEND_SRC_COLOR = 3,
+	BLEND_INV_SRC_COLOR = 4,
+	BLEND_SRC_ALPHA = 5,
+	BLEND_INV_SRC_ALPHA = 6
+};
+
+enum RenderComparison
+{
+	COMPARISON_NEVER = 1,
+	COMPARISON_LESS = 2,
+	COMPARISON_EQUAL = 3,
+	COMPARISON_LESS_EQUAL = 4,
+	COMPARISON_ALWAYS = 8
+};
+
+enum RenderFilter
+{
+	FILTER_MIN_MAG_MIP_POINT = 0,
+	FILTER_MIN_MAG_LINEAR_MIP_POINT = 0x14,
+	FILTER_MIN_MAG_MIP_LINEAR = 0x15,
+	FILTER_ANISOTROPIC = 0x55
+};
+
+struct RenderBufferDesc
+{
+	unsigned int size;
+	RenderUsage usage;
+	unsigned int bindFlags;  // RenderBindFlags
+	unsigned int stride;     // Element size of the shader resource view
+	RenderFormat viewFormat; // Typed view, FORMAT_UNKNOWN makes a structured buffer
+};
+
+// 2D texture with one mip, a view is made for each of the shader resource, render target and depth stencil binds
+struct RenderTextureDesc
+{
+	unsigned int width;
+	unsigned int height;
+	RenderFormat format;
+	RenderUsage usage;
+	unsigned int bindFlags;
+};
+
+struct RenderInputElement
+{
+	const char* semanticName;
+	unsigned int semanticIndex;
+	RenderFormat format;
+	unsigned int slot;
+	unsigned int offset;
+	bool perInstance; // Advances once per instance
+};
+
+// Solid fill with depth clip
+struct RenderRasterizerDesc
+{
+	RenderCullMode cullMode;
+};
+
+// Blend operation is add and all channels are written
+struct RenderTargetBlendDesc
+{
+	bool blendEnable;
+	RenderBlend srcBlend;
+	RenderBlend destBlend;
+	RenderBlend srcBlendAlpha;
+	RenderBlend destBlendAlpha;
+};
+
+struct RenderBlendDesc
+{
+	bool independentBlendEnable; // Only the first target is used otherwise
+	RenderTargetBlendDesc renderTarget[RenderMaxRenderTargets];
+};
+
+// Stencil is not used
+struct RenderDepthStencilDesc
+{
+	bool depthEnable;
+	bool depthWrite;
+	RenderComparison depthFunc;
+};
+
+// Addressing wraps, all mips are used
+struct RenderSamplerDesc
+{
+	RenderFilter filter;
+	unsigned int maxAnisotropy;
+};
+
+struct RenderViewport
+{
+	float x;
+	float y;
+	float width;
+	float height;
+	float minDepth;
+	float maxDepth;
+};
+
+struct RenderRect
+{
+	int left;
+	int top;
+	int right;
+	int bottom;
+};
+
+// Timestamps between Begin and End of a disjoint query are comparable only when it is not disjoint
+struct RenderTimestampDisjoint
+{
+	uint64_t frequency; // Ticks per second
+	bool disjoint;
+};
+
+// Objects are created by a device and released with Release, a NULL object binds nothing
+class RenderObject
+{
+public:
+	virtual void Release() = 0;
+
+protected:
+	virtual ~RenderObject() {}
+};
+
+// Buffer or texture together with the views its bind flags ask for
+class RenderResource : public RenderObject {};
+class RenderVertexShader : public RenderObject {};
+class RenderPixelShader : public RenderObject {};
+class RenderInputLayout : public RenderObject {};
+class RenderRasterizerState : public RenderObject {};
+class RenderBlendState : public RenderObject {};
+class RenderDepthStencilState : public RenderObject {};
+class RenderSamplerState : public RenderObject {};
+// Event query is done once the GPU has executed everything before its End
+// Timestamp query holds the GPU clock at its End, in ticks of the frequency of a disjoint query around it
+class RenderQuery : public RenderObject {};
+class RenderCommandList : public RenderObject {};
+
+// Commands of the immediate context or of a deferred one, which records a command list
+// A context is used by one thread at a time
+class IRenderContext : public RenderObject
+{
+public:
+	virtual void ClearState() = 0;
+	virtual void ClearRenderTargetView(RenderResource* pTarget, const float color[4]) = 0;
+	virtual void ClearDepthStencilView(RenderResource* pDepth, float depth) = 0;
+
+	virtual void IASetVertexBuffers(unsigned int startSlot, unsigned int count, RenderResource* const* ppBuffers, const unsigned int* pStrides, const unsigned int* pOffsets) = 0;
+	virtual void IASetIndexBuffer(RenderResource* pBuffer, RenderFormat format, unsigned int offset) = 0;
+	virtual void IASetInputLayout(RenderInputLayout* pLayout) = 0;
+	virtual void IASetPrimitiveTopology(RenderTopology topology) = 0;
+
+	virtual void VSSetShader(RenderVertexShader* pShader) = 0;
+	// Ranges are measured in 16-byte constants, as ConstantBufferRange
+	virtual void VSSetConstantBuffers(unsigned int startSlot, unsigned int count, RenderResource* const* ppBuffers, const unsigned int* pFirstConstant, const unsigned int* pNumConstants) = 0;
+
+	virtual void RSSetState(RenderRasterizerState* pState) = 0;
+	virtual void RSSetViewport(const RenderViewport& viewport) = 0;
+	virtual void RSSetScissorRect(const RenderRect& rect) = 0;
+
+	virtual void PSSetShader(RenderPixelShader* pShader) = 0;
+	virtual void PSSetConstantBuffers(unsigned int startSlot, unsigned int count, RenderResource* const* ppBuffers, const unsigned int* pFirstConstant, const unsigned int* pNumConstants) = 0;
+	virtual void PSSetShaderResources(unsigned int startSlot, unsigned int count, RenderResource* const* ppResources) = 0;
+	virtual void PSSetSamplers(unsigned int startSlot, unsigned int count, RenderSamplerState* const* ppSamplers) = 0;
+
+	virtual void OMSetRenderTargets(unsigned int count, RenderResource* const* ppTargets, RenderResource* pDepth) = 0;
+	virtual void OMSetBlendState(RenderBlendState* pState) = 0;
+	virtual void OMSetDepthStencilState(RenderDepthStencilState* pState) = 0;
+
+	virtual void Draw(unsigned int vertexCount, unsigned int startVertex) = 0;
+	virtual void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) = 0;
+	virtual void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance) = 0;
+
+	// Dynamic buffers only
+	virtual HRESULT Map(RenderResource* pBuffer, RenderMap mapType, void** ppData) = 0;
+	virtual void Unmap(RenderResource* pBuffer) = 0;
+
+	// Disjoint queries only, the other ones are just ended
+	virtual void Begin(RenderQuery* pQuery) = 0;
+	virtual void End(RenderQuery* pQuery) = 0;
+	// Event queries, returns S_FALSE while the query is not done, flush submits pending commands so it gets done
+	virtual HRESULT GetData(RenderQuery* pQuery, bool flush, bool* pDone) = 0;
+	// Timestamp and disjoint queries, return S_FALSE while the data is not there and never flush
+	virtual HRESULT GetTimestamp(RenderQuery* pQuery, uint64_t* pTicks) = 0;
+	virtual HRESULT GetTimestampDisjoint(RenderQuery* pQuery, RenderTimestampDisjoint* pData) = 0;
+
+	// Context state is reset after a command list is recorded and after it is executed
+	virtual HRESULT FinishCommandList(RenderCommandList** ppList) = 0;
+	virtual void ExecuteCommandList(RenderCommandList* pList) = 0;
+};
+
+// Creates render objects and presents the back buffer
+// Objects are created on one thread, any of them may be released on another
+class IRenderDevice
+{
+public:
+	virtual ~IRenderDevice() {}
+
+	virtual const char* GetName() const = 0;
+
+	// Data is the whole buffer or the top mip, it may be NULL for resources which are not immutable
+	virtual HRESULT CreateBuffer(const RenderBufferDesc& desc, const void* pData, RenderResource** ppBuffer) = 0;
+	virtual HRESULT CreateTexture(const RenderTextureDesc& desc, const void* pData, unsigned int rowPitch, RenderResource** ppTexture) = 0;
+	// Shader resource texture from the output of GetTextureParser
+	virtual HRESULT CreateTexture(const TextureData& data, RenderResource** ppTexture) = 0;
+
+	// Bytecode comes from GetShaderCompiler
+	virtual HRESULT CreateVertexShader(const void* pBytecode, size_t size, RenderVertexShader** ppShader) = 0;
+	virtual HRESULT CreatePixelShader(const void* pBytecode, size_t size, RenderPixelShader** ppShader) = 0;
+	virtual HRESULT CreateInputLayout(const RenderInputElement* pElements, unsigned int count, const void* pBytecode, size_t size, RenderInputLayout** ppLayout) = 0;
+
+	virtual HRESULT CreateRasterizerState(const RenderRasterizerDesc& desc, RenderRasterizerState** ppState) = 0;
+	virtual HRESULT CreateBlendState(const RenderBlendDesc& desc, RenderBlendState** ppState) = 0;
+	virtual HRESULT CreateDepthStencilState(const RenderDepthStencilDesc& desc, RenderDepthStencilState** ppState) = 0;
+	virtual HRESULT CreateSamplerState(const RenderSamplerDesc& desc, RenderSamplerState** ppState) = 0;
+	virtual HRESULT CreateQuery(RenderQueryType type, RenderQuery** ppQuery) = 0;
+
+	virtual HRESULT CreateDeferredContext(IRenderContext** ppContext) = 0;
+	// Owned by the device
+	virtual IRenderContext* GetImmediateContext() = 0;
+
+	// Render target owned by the device, it is replaced by ResizeBackBuffer
+	virtual RenderResource* GetBackBuffer() = 0;
+	virtual unsigned int GetBackBufferWidth() const = 0;
+	virtual unsigned int GetBackBufferHeight() const = 0;
+	virtual HRESULT ResizeBackBuffer(unsigned int width, unsigned int height) = 0;
+	virtual HRESULT Present() = 0;
+
+	// Shaders and textures are prepared on other threads in the form this device takes
+	virtual IShaderCompiler* GetShaderCompiler() = 0;
+	virtual ITextureParser* GetTextureParser() = 0;
+	// Bytecode of one device is not valid for another, so each has its own cache
+	virtual const char* GetShaderCacheDirectory() const = 0;
+};
@@ -1,11 +1,16 @@
 #include "Renderer.h"
 
 #include <stdio.h>
-#include <tchar.h>
+#include <string.h>
 #include <assert.h>
+#include <float.h>
 #include <DirectXMath.h>
-#include <d3dcompiler.h>
-#include "DDSTextureLoader11.h"
+#include "InstancePacker.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include "SceneData.h"
+#include "SoftwareRasterizer.h"
+#include "TransformBatch.h"
 
 #include <chrono>
 #define _USE_MATH_DEFINES
@@ -13,39 +18,30 @@
 
 using namespace DirectX;
 
-static const UINT IndicesCount = 36;
-
-static const XMVECTORF32 TransPos1{ 2.5f, 0, 0 };
-static const XMVECTORF32 TransPos2{ 3.0f, 0.5f, 0.5f };
-
-struct TextureVertex
-{
-	XMVECTORF32 pos;
-	XMFLOAT2 uv;
-	XMFLOAT3 normal;
-	XMFLOAT3 tangent;
-};
-
-struct ModelBuffer
-{
-	XMMATRIX modelMatrix;
-	XMMATRIX normalMatrix;
-	XMVECTORF32 objColor;
-};
-
-struct Light
-{
-	XMVECTORF32 pos;
-	XMVECTORF32 color;
-};
-
-struct SceneBuffer
-{
-	XMMATRIX VP;
-	XMVECTORI32 lightParams; // x - lights count
-
-	Light lights[4];
-};
+static const UINT MaxInstances = 4096;
+static const UINT ConstantBufferRingSize = 1024 * 1024;
+static const UINT MaxLights = 4096;
+static const UINT MaxLightIndices = LightClusters::Count * 64;
+static const UINT MainLightCount = 3;
+static const UINT LightFieldSize = 48;
+static const UINT LightCount = MainLightCount + LightFieldSize * LightFieldSize;
+static const UINT MaxWorkers = 64;
+static const UINT MatrixBatchSize = 256;
+static const uint64_t ShaderCacheSize = 64 * 1024 * 1024;
+static const UINT ChunksPerWorker = 2;
+static const UINT MinChunkObjects = 32;
+static const uint64_t TextureBudget = 64 * 1024 * 1024;
+static const uint64_t TextureStreamBudget = 4 * 1024 * 1024; // Per frame
+static const UINT MinResidentTextureSize = 64;
+static const UINT TextureLoaderThreads = 2;
+static const char* TextureArchivePath = "Textures.pak";
+static const UINT NoMip = ~0u;
+static const UINT PlaceholderColor = 0xff808080;   // Gray, ABGR
+static const UINT PlaceholderNormal = 0xffff8080;  // Flat normal, ABGR
+static const FLOAT BackColor[4] = {0.25f, 0.25f, 0.25f, 1.0f};
+
+static const XMFLOAT3 TransPos1{ 2.5f, 0, 0 };
+static const XMFLOAT3 TransPos2{ 3.0f, 0.5f, 0.5f };
 
 #define SAFE_RELEASE(p) \
 if (p != NULL) { \
@@ -56,120 +52,95 @@ if (p != NULL) { \
 Renderer::Renderer()
 	: m_pDevice(NULL)
 	, m_pContext(NULL)
-	, m_pSwapChain(NULL)
-	, m_pBackBufferRTV(NULL)
+	, m_vertexShaderBuild(ShaderBuilder::InvalidBuildId)
+	, m_instancedVertexShaderBuild(ShaderBuilder::InvalidBuildId)
+	, m_transVertexShaderBuild(ShaderBuilder::InvalidBuildId)
+	, m_oitCompositeVertexShaderBuild(ShaderBuilder::InvalidBuildId)
+	, m_oitCompositePixelShaderBuild(ShaderBuilder::InvalidBuildId)
+	, m_pendingShaderBuilds(0)
 	, m_pDepth(NULL)
-	, m_pDepthDSV(NULL)
-	, m_width(0)
-	, m_height(0)
+	, m_pOITAccum(NULL)
+	, m_pOITRevealage(NULL)
 	, m_pVertexBuffer(NULL)
 	, m_pIndexBuffer(NULL)
 	, m_pVertexShader(NULL)
-	, m_pPixelShader(NULL)
 	, m_pInputLayout(NULL)
+	, m_pInstancedVertexShader(NULL)
+	, m_pInstancedInputLayout(NULL)
+	, m_pInstanceBuffer(NULL)
 	, m_pTexture(NULL)
-	, m_pTextureSRV(NULL)
 	, m_pTextureNM(NULL)
-	, m_pTextureNMSRV(NULL)
+	, m_textureIndex(0)
+	, m_textureNMIndex(0)
 	, m_pSamplerState(NULL)
-	, m_pModelBuffer(NULL)
-	, m_pModelBuffer2(NULL)
-	, m_pSceneBuffer(NULL)
-	, m_pRasterizerState(NULL)
-	, m_usec(0)
-	, m_lon(0.0f)
-	, m_lat(0.0f)
-	, m_dist(10.0f)
-	, m_mode(0)
-	, m_pModelBuffer3(NULL)
-	, m_pModelBuffer4(NULL)
+	, m_pLightBuffer(NULL)
+	, m_pClusterBuffer(NULL)
+	, m_pLightIndexBuffer(NULL)
 	, m_pTransVertexBuffer(NULL)
 	, m_pTransIndexBuffer(NULL)
 	, m_pTransVertexShader(NULL)
-	, m_pTransPixelShader(NULL)
 	, m_pTransInputLayout(NULL)
 	, m_pTransRasterizerState(NULL)
+	, m_pTransBlendState(NULL)
 	, m_pTransDepthState(NULL)
+	, m_pOITBlendState(NULL)
+	, m_pOITCompositeVertexShader(NULL)
+	, m_pOITCompositePixelShader(NULL)
+	, m_pRasterizerState(NULL)
+	, m_width(0)
+	, m_height(0)
+	, m_usec(0)
+	, m_animationTime(-1.0)
+	, m_lon(0.0f)
+	, m_lat(0.0f)
+	, m_dist(10.0f)
+	, m_mode(0)
+	, m_shaderKey(0)
+	, m_instancing(false)
+	, m_lightField(false)
+	, m_transparencyMode(TransparencySorted)
+	, m_parallelRecording(false)
 {
+	XMStoreFloat4x4(&m_viewProjMatrix, XMMatrixIdentity());
 }
 
-bool Renderer::Init(HWND hWnd)
+bool Renderer::Init(IRenderDevice* pDevice)
 {
-	HRESULT result;
+	PROFILE_SCOPE("Renderer::Init");
 
-	// Create a DirectX graphics interface factory.
-	IDXGIFactory* pFactory = NULL;
-	result = CreateDXGIFactory(__uuidof(IDXGIFactory), (void**)&pFactory);
-	assert(SUCCEEDED(result));
+	std::chrono::steady_clock::time_point initStart = std::chrono::steady_clock::now();
 
-	// Select hardware adapter
-	IDXGIAdapter* pSelectedAdapter = NULL;
-	if (SUCCEEDED(result))
-	{
-		IDXGIAdapter* pAdapter = NULL;
-		UINT adapterIdx = 0;
-		while (SUCCEEDED(pFactory->EnumAdapters(adapterIdx, &pAdapter)))
-		{
-			DXGI_ADAPTER_DESC desc;
-			pAdapter->GetDesc(&desc);
+	HRESULT result = S_OK;
 
-			if (wcscmp(desc.Description, L"Microsoft Basic Render Driver") != 0)
-			{
-				pSelectedAdapter = pAdapter;
-				break;
-			}
+	m_pDevice = pDevice;
+	m_pContext = pDevice->GetImmediateContext();
+	m_width = pDevice->GetBackBufferWidth();
+	m_height = pDevice->GetBackBufferHeight();
 
-			pAdapter->Release();
+	// Start job system, the main thread is worker 0, texture loader threads attach to make mips with jobs
+	{
+		UINT workerCount = std::thread::hardware_concurrency();
+		workerCount = workerCount < 1 ? 1 : (workerCount > MaxWorkers ? MaxWorkers : workerCount);
 
-			adapterIdx++;
-		}
+		m_jobs.Init(workerCount, TextureLoaderThreads);
 	}
-	assert(pSelectedAdapter != NULL);
 
-	// Create DirectX 11 device
-	D3D_FEATURE_LEVEL level;
-	D3D_FEATURE_LEVEL levels[] = { D3D_FEATURE_LEVEL_11_0 };
+	// Create depth and transparency targets of the back buffer size
+	result = SetupBackBuffer();
+
+	// Open shader cache, shaders are compiled every time if it is not available
 	if (SUCCEEDED(result))
 	{
-		result = D3D11CreateDevice(pSelectedAdapter, D3D_DRIVER_TYPE_UNKNOWN, NULL,
-			D3D11_CREATE_DEVICE_DEBUG, levels, 1, D3D11_SDK_VERSION, &m_pDevice, &level, &m_pContext);
-		assert(level == D3D_FEATURE_LEVEL_11_0);
-		assert(SUCCEEDED(result));
-	}
-
-	// Create swapchain
-	if (SUCCEEDED(result))
-	{
-		RECT rc;
-		GetClientRect(hWnd, &rc);
-		m_width = rc.right - rc.left;
-		m_height = rc.bottom - rc.top;
-
-		DXGI_SWAP_CHAIN_DESC swapChainDesc = { 0 };
-		swapChainDesc.BufferCount = 2;
-		swapChainDesc.BufferDesc.Width = m_width;
-		swapChainDesc.BufferDesc.Height = m_height;
-		swapChainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-		swapChainDesc.BufferDesc.RefreshRate.Numerator = 0;
-		swapChainDesc.BufferDesc.RefreshRate.Denominator = 1;
-		swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-		swapChainDesc.OutputWindow = hWnd;
-		swapChainDesc.SampleDesc.Count = 1;
-		swapChainDesc.SampleDesc.Quality = 0;
-		swapChainDesc.Windowed = true;
-		swapChainDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
-		swapChainDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
-		swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
-		swapChainDesc.Flags = 0;
-
-		result = pFactory->CreateSwapChain(m_pDevice, &swapChainDesc, &m_pSwapChain);
-		assert(SUCCEEDED(result));
+		if (!m_shaderCache.Init(m_pDevice->GetShaderCacheDirectory(), ShaderCacheSize))
+		{
+			OutputDebugStringA("Shader cache is not available\n");
+		}
 	}
 
-	// Create render target views
+	// Start building all shaders in background, scene creation waits for the ones it needs
 	if (SUCCEEDED(result))
 	{
-		result = SetupBackBuffer();
+		result = QueueShaders();
 	}
 
 	// Create scene for render
@@ -181,48 +152,59 @@ bool Renderer::Init(HWND hWnd)
 	// Create texture samplers
 	if (SUCCEEDED(result))
 	{
-		D3D11_SAMPLER_DESC samplerDesc = {};
-		samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-		samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-		samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-		samplerDesc.MinLOD = 0;
-		samplerDesc.MaxLOD = 1000;
-		//samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
-		//samplerDesc.Filter = D3D11_FILTER_MIN_MAG_LINEAR_MIP_POINT;
-		//samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-		samplerDesc.Filter = D3D11_FILTER_ANISOTROPIC;
-		samplerDesc.MaxAnisotropy = 16;
+		RenderSamplerDesc samplerDesc = {};
+		//samplerDesc.filter = FILTER_MIN_MAG_MIP_POINT;
+		//samplerDesc.filter = FILTER_MIN_MAG_LINEAR_MIP_POINT;
+		//samplerDesc.filter = FILTER_MIN_MAG_MIP_LINEAR;
+		samplerDesc.filter = FILTER_ANISOTROPIC;
+		samplerDesc.maxAnisotropy = 16;
+
+		result = m_pDevice->CreateSamplerState(samplerDesc, &m_pSamplerState);
+	}
+
+	// Create timestamp queries of the frames in flight
+	if (SUCCEEDED(result))
+	{
+		result = m_gpuProfiler.Init(m_pDevice);
+	}
 
-		result = m_pDevice->CreateSamplerState(&samplerDesc, &m_pSamplerState);
+	// Shader variants of the first frame, the rest keep building
+	if (SUCCEEDED(result) && !ResolveShaders())
+	{
+		result = E_FAIL;
 	}
 
-	SAFE_RELEASE(pSelectedAdapter);
-	SAFE_RELEASE(pFactory);
+	if (SUCCEEDED(result))
+	{
+		char timing[128];
+		sprintf_s(timing, "Renderer init %.2f ms, critical shaders %.2f ms\n",
+			std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - initStart).count(), m_shaderBuilder.GetCriticalPathMs());
+		OutputDebugStringA(timing);
+	}
 
 	return SUCCEEDED(result);
 }
 
 void Renderer::Term()
 {
+	m_gpuProfiler.Term();
 	DestroyScene();
+	m_shaderBuilder.Term();
+	m_shaderCache.Term();
+	m_jobs.Term();
 
-	SAFE_RELEASE(m_pDepthDSV);
-	SAFE_RELEASE(m_pDepth);
-	SAFE_RELEASE(m_pBackBufferRTV);
-	SAFE_RELEASE(m_pSwapChain);
-	SAFE_RELEASE(m_pContext);
-	SAFE_RELEASE(m_pDevice);
+	ReleaseBackBuffer();
+	m_pContext = NULL;
+	m_pDevice = NULL;
 }
 
 void Renderer::Resize(UINT width, UINT height)
 {
 	if (width != m_width || height != m_height)
 	{
-		SAFE_RELEASE(m_pDepthDSV);
-		SAFE_RELEASE(m_pDepth);
-		SAFE_RELEASE(m_pBackBufferRTV);
+		ReleaseBackBuffer();
 
-		HRESULT result = m_pSwapChain->ResizeBuffers(2, width, height, DXGI_FORMAT_R8G8B8A8_UNORM, 0);
+		HRESULT result = m_pDevice->ResizeBackBuffer(width, height);
 		if (SUCCEEDED(result))
 		{
 			m_width = width;
@@ -236,93 +218,313 @@ void Renderer::Resize(UINT width, UINT height)
 
 bool Renderer::Update()
 {
+	PROFILE_SCOPE("Update");
+
 	size_t usec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 	if (m_usec == 0)
 	{
 		m_usec = usec; // Initial update
 	}
 
-	double elapsedSec = (usec - m_usec) / 1000000.0;
-
-	ModelBuffer cb;
-	XMMATRIX m = XMMatrixRotationAxis({ 0,1,0 }, (float)elapsedSec * 0.5f);
-
-	cb.modelMatrix = XMMatrixTranspose(m);
-	//cb.normalMatrix = XMMatrixTranspose(XMMatrixTranspose(XMMatrixInverse(NULL, m)));
-	cb.normalMatrix = XMMatrixInverse(NULL, m);
-	m_pContext->UpdateSubresource(m_pModelBuffer, 0, NULL, &cb, 0, 0);
-
-	cb.modelMatrix = XMMatrixTranspose(XMMatrixTranslation(1.5f, 0, 0));
-	cb.normalMatrix = XMMatrixIdentity();
-	m_pContext->UpdateSubresource(m_pModelBuffer2, 0, NULL, &cb, 0, 0);
+	double elapsedSec = m_animationTime >= 0.0 ? m_animationTime : (usec - m_usec) / 1000000.0;
 
-	cb.modelMatrix = XMMatrixTranspose(XMMatrixTranslation(TransPos1.f[0], TransPos1.f[1], TransPos1.f[2]));
-	cb.objColor = XMVECTORF32{0.75f, 0, 0.75f, 0.15f};
-	m_pContext->UpdateSubresource(m_pModelBuffer3, 0, NULL, &cb, 0, 0);
+	// Animate first cube
+	XMFLOAT4 rotation;
+	XMStoreFloat4(&rotation, XMQuaternionRotationAxis(XMVECTORF32{ 0,1,0 }, (float)elapsedSec * 0.5f));
+	m_transforms.SetRotation(m_opaqueObjects[0].entity, rotation);
 
-	cb.modelMatrix = XMMatrixTranspose(XMMatrixTranslation(TransPos2.f[0], TransPos2.f[1], TransPos2.f[2]));
-	cb.objColor = XMVECTORF32{ 0.1f, 0, 0.6f, 0.8f };
-	m_pContext->UpdateSubresource(m_pModelBuffer4, 0, NULL, &cb, 0, 0);
+	m_transforms.Update();
 
-	// Setup scene buffer
-	SceneBuffer scb;
+	// Shader variants are selected by features instead of branching in shaders, transparency adds its own
+	UINT lightCount = GetLightCount();
+	UINT features = m_mode == 0 ? SHADER_FEATURE_NORMAL_MAP : 0;
+	m_shaderKey = MakeShaderKey(features, GetShaderLightBucket(lightCount));
+	if (!ResolveShaders())
+	{
+		return false;
+	}
 
+	// Setup camera
 	static const float nearPlane = 0.001f;
 	static const float farPlane = 100.0f;
 	static const float fov = (float)M_PI * 2.0 / 3.0;
 
-	XMMATRIX view = XMMatrixInverse(NULL, XMMatrixTranslation(0, 0, -m_dist) * XMMatrixRotationAxis({ 1,0,0 }, m_lat) * XMMatrixRotationAxis({ 0,1,0 }, m_lon));
+	XMMATRIX view = XMMatrixInverse(NULL, XMMatrixTranslation(0, 0, -m_dist) * XMMatrixRotationAxis(XMVECTORF32{ 1,0,0 }, m_lat) * XMMatrixRotationAxis(XMVECTORF32{ 0,1,0 }, m_lon));
 
 	float width = nearPlane / tanf(fov / 2.0);
 	float height = ((float)m_height / m_width) * width;
-	scb.VP = XMMatrixTranspose(view * XMMatrixPerspectiveLH(width, height, nearPlane, farPlane));
+	XMMATRIX proj = XMMatrixPerspectiveLH(width, height, nearPlane, farPlane);
+	float focalPixels = nearPlane / width * m_width; // Pixels per unit at distance 1
+	XMMATRIX viewProj = view * proj;
+
+	XMFLOAT4X4 viewMatrix;
+	XMFLOAT4X4 projMatrix;
+	XMFLOAT4X4 viewProjMatrix;
+	XMStoreFloat4x4(&viewMatrix, view);
+	XMStoreFloat4x4(&projMatrix, proj);
+	XMStoreFloat4x4(&viewProjMatrix, viewProj);
+	m_viewProjMatrix = viewProjMatrix;
+
+	// CPU stages of the frame run as jobs, matrices are computed for cubes which passed culling
+	Job* pCullJob = m_jobs.CreateJob([this, &viewProjMatrix] { CullOpaqueObjects(viewProjMatrix); });
+	Job* pMatricesJob = m_jobs.CreateJob([this] { ComputeVisibleMatrices(); });
+	Job* pLightJob = m_jobs.CreateJob([this, &viewMatrix, &projMatrix] { AssignLights(viewMatrix, projMatrix, nearPlane, farPlane); });
+	Job* pSortJob = m_jobs.CreateJob([this, &viewMatrix] { SortTransparentObjects(viewMatrix, nearPlane, farPlane); });
+	m_jobs.AddDependency(pMatricesJob, pCullJob);
+
+	m_jobs.Run(pMatricesJob);
+	m_jobs.Run(pCullJob);
+	m_jobs.Run(pLightJob);
+	m_jobs.Run(pSortJob);
+
+	// Context is used by the main thread only, so lights are uploaded while the rest of the jobs run
+	m_jobs.Wait(pLightJob);
+	bool lightsUploaded = UploadLights();
+
+	// Jobs reference locals of this function, so all of them are waited for before return
+	m_jobs.Wait(pMatricesJob);
+	m_jobs.Wait(pSortJob);
+
+	if (!lightsUploaded)
+	{
+		return false;
+	}
+
+	UpdateTextureStreaming(viewMatrix, focalPixels);
+
+	// All constant buffer data of the frame goes to the ring
+	HRESULT result = m_constantBuffers.Map(m_pContext);
+	if (FAILED(result))
+	{
+		return false;
+	}
+
+	// Instances are packed into the instance buffer as they are drawn
+	UINT visibleCount = (UINT)m_visibleObjects.size();
+	if (!m_instancing)
+	{
+		for (UINT i = 0; i < visibleCount; i++)
+		{
+			SceneObject& object = m_opaqueObjects[m_visibleObjects[i]];
+
+			ModelBuffer cb;
+			cb.modelMatrix = XMLoadFloat4x4(&m_modelMatrices[i]);
+			cb.normalMatrix = XMLoadFloat4x4(&m_normalMatrices[i]);
+			cb.objColor = XMVECTORF32{ object.color.x, object.color.y, object.color.z, object.color.w };
+			m_constantBuffers.Upload(m_pContext, &cb, sizeof(cb), &object.modelBuffer);
+		}
+	}
 
-	scb.lightParams.i[1] = m_mode;
+	// Transparent quads
+	for (SceneObject& object : m_transObjects)
+	{
+		ModelBuffer cb;
+		cb.modelMatrix = XMMatrixTranspose(XMLoadFloat4x4(&m_transforms.GetWorldMatrix(object.entity)));
+		cb.normalMatrix = XMMatrixIdentity();
+		cb.objColor = XMVECTORF32{ object.color.x, object.color.y, object.color.z, object.color.w };
+		m_constantBuffers.Upload(m_pContext, &cb, sizeof(cb), &object.modelBuffer);
+	}
 
-	// Setup lights
-	/*
-	scb.lightParams.i[0] = 1;
-	scb.lights[0].pos = XMVECTORF32{ 0, 1, 0, 0 };
-	scb.lights[0].color = XMVECTORF32{ 0.75f, 0, 0, 0 };
-	*/
+	// Setup scene buffer
+	SceneBuffer scb;
+	FillSceneBuffer(scb);
 
-	scb.lightParams.i[0] = 3;
-	scb.lights[0].pos = XMVECTORF32{ 0, 1, 0, 0 };
-	scb.lights[0].color = XMVECTORF32{ 0.75f, 0, 0, 0 };
-	scb.lights[1].pos = XMVECTORF32{ 3, 1, 0, 0 };
-	scb.lights[1].color = XMVECTORF32{ 0, 0.75f, 0, 0 };
-	scb.lights[2].pos = XMVECTORF32{ 0, 0, 2, 0 };
-	scb.lights[2].color = XMVECTORF32{ 1, 1, 1, 0 };
+	m_constantBuffers.Upload(m_pContext, &scb, sizeof(scb), &m_sceneBuffer);
 
-	m_pContext->UpdateSubresource(m_pSceneBuffer, 0, NULL, &scb, 0, 0);
+	m_constantBuffers.Unmap(m_pContext);
 
 	return true;
 }
 
+void Renderer::FillSceneBuffer(SceneBuffer& scb) const
+{
+	UINT lightCount = GetLightCount();
+
+	scb.VP = XMMatrixTranspose(XMLoadFloat4x4(&m_viewProjMatrix));
+
+	scb.lightParams.i[0] = (int)lightCount;
+	scb.lightParams.i[1] = 0;
+	scb.lightParams.i[2] = 0;
+	scb.lightParams.i[3] = 0;
+	scb.clusterParams = m_lightClusters.GetShaderParams();
+}
+
+void Renderer::CullOpaqueObjects(const XMFLOAT4X4& viewProj)
+{
+	PROFILE_SCOPE("CullOpaqueObjects");
+
+	UINT opaqueCount = (UINT)m_opaqueObjects.size();
+	bool rebuild = m_opaqueBVH.GetBoxCount() != opaqueCount;
+	bool refit = false;
+	m_opaqueBoxes.resize(opaqueCount);
+	for (UINT i = 0; i < opaqueCount; i++)
+	{
+		EntityId entity = m_opaqueObjects[i].entity;
+		if (rebuild || m_transforms.IsUpdated(entity))
+		{
+			static const AABB CubeBox = { XMFLOAT3{ -0.5f, -0.5f, -0.5f }, XMFLOAT3{ 0.5f, 0.5f, 0.5f } };
+			m_opaqueBoxes[i] = TransformAABB(CubeBox, m_transforms.GetWorldMatrix(entity));
+			refit = true;
+		}
+	}
+	if (rebuild)
+	{
+		m_opaqueBVH.Build(m_opaqueBoxes.data(), opaqueCount);
+	}
+	else if (refit)
+	{
+		m_opaqueBVH.Refit(m_opaqueBoxes.data());
+	}
+
+	Frustum frustum;
+	ExtractFrustumPlanes(viewProj, frustum);
+
+	m_visibleObjects.clear();
+	m_opaqueBVH.Cull(frustum, m_visibleObjects);
+}
+
+void Renderer::ComputeVisibleMatrices()
+{
+	PROFILE_SCOPE("ComputeVisibleMatrices");
+
+	UINT visibleCount = (UINT)m_visibleObjects.size();
+	m_worldMatrices.resize(visibleCount);
+	m_modelMatrices.resize(visibleCount);
+	m_normalMatrices.resize(visibleCount);
+
+	UINT batchFlags = m_transforms.HasNonUniformScale() ? TRANSFORM_BATCH_GENERAL : TRANSFORM_BATCH_UNIFORM_SCALE;
+	m_jobs.ParallelFor(visibleCount, MatrixBatchSize, [this, batchFlags](unsigned int first, unsigned int count)
+	{
+		for (UINT i = first; i < first + count; i++)
+		{
+			m_worldMatrices[i] = m_transforms.GetWorldMatrix(m_opaqueObjects[m_visibleObjects[i]].entity);
+		}
+		ComputeModelNormalMatrices(m_worldMatrices.data() + first, count, batchFlags, m_modelMatrices.data() + first, m_normalMatrices.data() + first);
+	});
+}
+
+void Renderer::SortTransparentObjects(const XMFLOAT4X4& view, float nearPlane, float farPlane)
+{
+	PROFILE_SCOPE("SortTransparentObjects");
+
+	// Sort transparent quads back to front, OIT mode does not use the order
+	XMMATRIX viewMatrix = XMLoadFloat4x4(&view);
+
+	UINT transCount = (UINT)m_transObjects.size();
+	m_transKeys.resize(transCount);
+	for (UINT i = 0; i < transCount; i++)
+	{
+		const XMFLOAT4X4& world = m_transforms.GetWorldMatrix(m_transObjects[i].entity);
+		XMVECTOR viewPos = XMVector3TransformCoord(XMVECTORF32{ world._41, world._42, world._43, 1 }, viewMatrix);
+		m_transKeys[i] = BackToFrontKey(XMVectorGetZ(viewPos), nearPlane, farPlane);
+	}
+	m_transSort.Sort(m_transKeys.data(), transCount);
+}
+
+void Renderer::AssignLights(const XMFLOAT4X4& view, const XMFLOAT4X4& proj, float nearPlane, float farPlane)
+{
+	PROFILE_SCOPE("AssignLights");
+
+	UINT lightCount = GetLightCount();
+
+	m_lightClusters.Setup(proj, nearPlane, farPlane, m_width, m_height);
+	m_lightClusters.Assign(m_lights.data(), lightCount, view, MaxLightIndices);
+}
+
+bool Renderer::UploadLights()
+{
+	PROFILE_SCOPE("UploadLights");
+
+	const std::vector<LightClusters::Range>& ranges = m_lightClusters.GetRanges();
+	const std::vector<UINT>& indices = m_lightClusters.GetLightIndices();
+
+	// Upload cluster light lists
+	void* pData = NULL;
+	HRESULT result = m_pContext->Map(m_pClusterBuffer, MAP_WRITE_DISCARD, &pData);
+	assert(SUCCEEDED(result));
+	if (SUCCEEDED(result))
+	{
+		memcpy(pData, ranges.data(), sizeof(LightClusters::Range) * ranges.size());
+		m_pContext->Unmap(m_pClusterBuffer);
+
+		result = m_pContext->Map(m_pLightIndexBuffer, MAP_WRITE_DISCARD, &pData);
+		assert(SUCCEEDED(result));
+	}
+	if (SUCCEEDED(result))
+	{
+		if (!indices.empty())
+		{
+			memcpy(pData, indices.data(), sizeof(UINT) * indices.size());
+		}
+		m_pContext->Unmap(m_pLightIndexBuffer);
+	}
+
+	return SUCCEEDED(result);
+}
+
 bool Renderer::Render()
 {
+	PROFILE_SCOPE("Render");
+
 	m_pContext->ClearState();
 
-	ID3D11RenderTargetView* views[] = {m_pBackBufferRTV};
-	m_pContext->OMSetRenderTargets(1, views, m_pDepthDSV);
+	m_gpuProfiler.BeginFrame(m_pContext);
+
+	{
+		GpuPassScope pass(m_gpuProfiler, m_pContext, "Clear");
 
-	static const FLOAT BackColor[4] = {0.25f, 0.25f, 0.25f, 1.0f};
-	m_pContext->ClearRenderTargetView(m_pBackBufferRTV, BackColor);
-	m_pContext->ClearDepthStencilView(m_pDepthDSV, D3D11_CLEAR_DEPTH, 1.0f, 0);
+		m_pContext->ClearRenderTargetView(m_pDevice->GetBackBuffer(), BackColor);
+		m_pContext->ClearDepthStencilView(m_pDepth, 1.0f);
+	}
 
-	D3D11_VIEWPORT viewport{0, 0, (float)m_width, (float)m_height, 0.0f, 1.0f};
-	m_pContext->RSSetViewports(1, &viewport);
-	D3D11_RECT rect{ 0, 0, (LONG)m_width, (LONG)m_height };
-	m_pContext->RSSetScissorRects(1, &rect);
+	SetupRenderTargets(m_pContext);
 
 	RenderScene();
 
-	HRESULT result = m_pSwapChain->Present(0, 0);
+	m_constantBuffers.EndFrame(m_pContext);
+	m_gpuProfiler.EndFrame(m_pContext);
+
+	HRESULT result = m_pDevice->Present();
 	assert(SUCCEEDED(result));
 
 	return SUCCEEDED(result);
 }
 
+bool Renderer::RenderSoftware(SoftwareRasterizer& rasterizer)
+{
+	PROFILE_SCOPE("RenderSoftware");
+
+	// Light clusters are made for the back buffer size
+	if (rasterizer.GetWidth() != m_width || rasterizer.GetHeight() != m_height)
+	{
+		return false;
+	}
+
+	SceneBuffer scb;
+	FillSceneBuffer(scb);
+
+	rasterizer.SetScene(scb, m_shaderKey);
+	rasterizer.SetLights(m_lights.data(), m_lightClusters.GetRanges().data(), m_lightClusters.GetLightIndices().data());
+	rasterizer.Clear(BackColor, 1.0f);
+
+	// Same cubes with the same matrices as the opaque draws of Render
+	UINT visibleCount = (UINT)m_visibleObjects.size();
+	for (UINT i = 0; i < visibleCount; i++)
+	{
+		const SceneObject& object = m_opaqueObjects[m_visibleObjects[i]];
+
+		ModelBuffer cb;
+		cb.modelMatrix = XMLoadFloat4x4(&m_modelMatrices[i]);
+		cb.normalMatrix = XMLoadFloat4x4(&m_normalMatrices[i]);
+		cb.objColor = XMVECTORF32{ object.color.x, object.color.y, object.color.z, object.color.w };
+		rasterizer.DrawIndexed(CubeVertices, CubeIndices, CubeIndexCount, cb);
+	}
+
+	rasterizer.Flush(&m_jobs);
+
+	return true;
+}
+
 void Renderer::MouseMove(int dx, int dy)
 {
 	m_lon += (float)dx / m_width * 5.0f;
@@ -347,50 +549,87 @@ void Renderer::MouseWheel(int dz)
 	}
 }
 
+void Renderer::SetCamera(float lon, float lat, float dist)
+{
+	m_lon = lon;
+	m_lat = lat < -(float)M_PI / 2 ? -(float)M_PI / 2 : (lat > (float)M_PI / 2 ? (float)M_PI / 2 : lat);
+	m_dist = dist < 0 ? 0 : dist;
+}
+
+void Renderer::SetAnimationTime(double seconds)
+{
+	m_animationTime = seconds;
+}
+
 void Renderer::SwitchNormalMode()
 {
 	m_mode = (m_mode + 1) % 2;
 }
 
+void Renderer::SwitchInstancingMode()
+{
+	m_instancing = !m_instancing;
+}
+
+void Renderer::SwitchLightField()
+{
+	m_lightField = !m_lightField;
+}
+
+void Renderer::SwitchTransparencyMode()
+{
+	m_transparencyMode = (TransparencyMode)((m_transparencyMode + 1) % TransparencyModeCount);
+}
+
+void Renderer::SwitchParallelMode()
+{
+	m_parallelRecording = !m_parallelRecording;
+}
+
 HRESULT Renderer::SetupBackBuffer()
 {
-	ID3D11Texture2D* pBackBuffer = NULL;
-	HRESULT result = m_pSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (LPVOID*)&pBackBuffer);
+	PROFILE_SCOPE("SetupBackBuffer");
+
+	RenderTextureDesc depthDesc = { m_width, m_height, FORMAT_D24_UNORM_S8_UINT, USAGE_DEFAULT, BIND_DEPTH_STENCIL };
+
+	HRESULT result = m_pDevice->CreateTexture(depthDesc, NULL, 0, &m_pDepth);
 	assert(SUCCEEDED(result));
+
+	// Create order-independent transparency targets
 	if (SUCCEEDED(result))
 	{
-		result = m_pDevice->CreateRenderTargetView(pBackBuffer, NULL, &m_pBackBufferRTV);
-		assert(SUCCEEDED(result));
-
-		SAFE_RELEASE(pBackBuffer);
+		result = CreateRenderTarget(FORMAT_R16G16B16A16_FLOAT, &m_pOITAccum);
 	}
 	if (SUCCEEDED(result))
 	{
-		D3D11_TEXTURE2D_DESC depthDesc = {};
-		depthDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-		depthDesc.ArraySize = 1;
-		depthDesc.MipLevels = 1;
-		depthDesc.Usage = D3D11_USAGE_DEFAULT;
-		depthDesc.Height = m_height;
-		depthDesc.Width = m_width;
-		depthDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-		depthDesc.CPUAccessFlags = 0;
-		depthDesc.MiscFlags = 0;
-		depthDesc.SampleDesc.Count = 1;
-		depthDesc.SampleDesc.Quality = 0;
-
-		result = m_pDevice->CreateTexture2D(&depthDesc, NULL, &m_pDepth);
-		if (SUCCEEDED(result))
-		{
-			result = m_pDevice->CreateDepthStencilView(m_pDepth, NULL, &m_pDepthDSV);
-		}
+		result = CreateRenderTarget(FORMAT_R16_FLOAT, &m_pOITRevealage);
 	}
 
 	return result;
 }
 
+HRESULT Renderer::CreateRenderTarget(RenderFormat format, RenderResource** ppTexture)
+{
+	RenderTextureDesc desc = { m_width, m_height, format, USAGE_DEFAULT, BIND_RENDER_TARGET | BIND_SHADER_RESOURCE };
+
+	HRESULT result = m_pDevice->CreateTexture(desc, NULL, 0, ppTexture);
+	assert(SUCCEEDED(result));
+
+	return result;
+}
+
+void Renderer::ReleaseBackBuffer()
+{
+	SAFE_RELEASE(m_pOITRevealage);
+	SAFE_RELEASE(m_pOITAccum);
+
+	SAFE_RELEASE(m_pDepth);
+}
+
 HRESULT Renderer::CreateTransparentObjects()
 {
+	PROFILE_SCOPE("CreateTransparentObjects");
+
 	// Textured cube
 	static const XMVECTORF32 Vertices[4] = {
 		{0, -1, -1, 1},
@@ -403,304 +642,330 @@ HRESULT Renderer::CreateTransparentObjects()
 	};
 
 	// Create vertex buffer
-	D3D11_BUFFER_DESC vertexBufferDesc = { 0 };
-	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	vertexBufferDesc.ByteWidth = sizeof(Vertices);
-	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDesc.CPUAccessFlags = 0;
-	vertexBufferDesc.MiscFlags = 0;
-	vertexBufferDesc.StructureByteStride = 0;
-
-	D3D11_SUBRESOURCE_DATA vertexData = { 0 };
-	vertexData.pSysMem = Vertices;
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
-
-	HRESULT result = m_pDevice->CreateBuffer(&vertexBufferDesc, &vertexData, &m_pTransVertexBuffer);
+	RenderBufferDesc vertexBufferDesc = { sizeof(Vertices), USAGE_DEFAULT, BIND_VERTEX_BUFFER, 0, FORMAT_UNKNOWN };
+
+	HRESULT result = m_pDevice->CreateBuffer(vertexBufferDesc, Vertices, &m_pTransVertexBuffer);
 	assert(SUCCEEDED(result));
 
 	// Create index buffer
 	if (SUCCEEDED(result))
 	{
-		D3D11_BUFFER_DESC indexBufferDesc = { 0 };
-		indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-		indexBufferDesc.ByteWidth = sizeof(Indices);
-		indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-		indexBufferDesc.CPUAccessFlags = 0;
-		indexBufferDesc.MiscFlags = 0;
-		indexBufferDesc.StructureByteStride = 0;
-
-		D3D11_SUBRESOURCE_DATA indexData = { 0 };
-		indexData.pSysMem = Indices;
-		indexData.SysMemPitch = 0;
-		indexData.SysMemSlicePitch = 0;
+		RenderBufferDesc indexBufferDesc = { sizeof(Indices), USAGE_DEFAULT, BIND_INDEX_BUFFER, 0, FORMAT_UNKNOWN };
 
-		result = m_pDevice->CreateBuffer(&indexBufferDesc, &indexData, &m_pTransIndexBuffer);
+		result = m_pDevice->CreateBuffer(indexBufferDesc, Indices, &m_pTransIndexBuffer);
 		assert(SUCCEEDED(result));
 	}
 
 	// Create vertex shader
-	ID3DBlob* pBlob = NULL;
-	m_pTransVertexShader = CreateVertexShader(_T("TransColorShader.hlsl"), &pBlob);
-	// Create pixel shader
-	if (m_pTransVertexShader)
-	{
-		m_pTransPixelShader = CreatePixelShader(_T("TransColorShader.hlsl"));
-	}
-	assert(m_pTransVertexShader != NULL && m_pTransPixelShader != NULL);
-	if (m_pTransVertexShader == NULL || m_pTransPixelShader == NULL)
+	m_pTransVertexShader = CreateVertexShader(m_transVertexShaderBuild);
+	assert(m_pTransVertexShader != NULL);
+	if (m_pTransVertexShader == NULL)
 	{
 		result = E_FAIL;
 	}
+	// Pixel shaders and OIT composite shaders are created by ResolveShaders
+	m_transPixelShaders.assign(m_transPixelPermutations.GetVariantCount(), NULL);
 
 	// Create input layout
 	if (SUCCEEDED(result))
 	{
-		D3D11_INPUT_ELEMENT_DESC inputLayoutDesc[1] = {
-			D3D11_INPUT_ELEMENT_DESC{"POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0}
+		RenderInputElement inputLayoutDesc[1] = {
+			RenderInputElement{"POSITION", 0, FORMAT_R32G32B32A32_FLOAT, 0, 0, false}
 		};
 
-		result = m_pDevice->CreateInputLayout(inputLayoutDesc, 1, pBlob->GetBufferPointer(), pBlob->GetBufferSize(), &m_pTransInputLayout);
+		result = CreateInputLayout(inputLayoutDesc, 1, m_transVertexShaderBuild, &m_pTransInputLayout);
 		assert(SUCCEEDED(result));
 	}
-	SAFE_RELEASE(pBlob);
 
-	// Create model constant buffer
+	// Create transparent quads
 	if (SUCCEEDED(result))
 	{
-		D3D11_BUFFER_DESC cbDesc = { 0 };
-		cbDesc.ByteWidth = sizeof(ModelBuffer);
-		cbDesc.Usage = D3D11_USAGE_DEFAULT;
-		cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		cbDesc.CPUAccessFlags = 0;
-		cbDesc.MiscFlags = 0;
-		cbDesc.StructureByteStride = 0;
+		EntityId entity = m_transforms.CreateEntity(InvalidEntity);
+		m_transforms.SetPosition(entity, TransPos1);
 
-		result = m_pDevice->CreateBuffer(&cbDesc, NULL, &m_pModelBuffer3);
-		if (SUCCEEDED(result))
-		{
-			result = m_pDevice->CreateBuffer(&cbDesc, NULL, &m_pModelBuffer4);
-		}
+		AddObject(entity, XMFLOAT4{ 0.75f, 0, 0.75f, 0.15f }, m_transObjects);
+	}
+	if (SUCCEEDED(result))
+	{
+		EntityId entity = m_transforms.CreateEntity(InvalidEntity);
+		m_transforms.SetPosition(entity, TransPos2);
+
+		AddObject(entity, XMFLOAT4{ 0.1f, 0, 0.6f, 0.8f }, m_transObjects);
 	}
 
 	// Create rasterizer state
 	if (SUCCEEDED(result))
 	{
-		D3D11_RASTERIZER_DESC rasterizerDesc;
-		rasterizerDesc.FillMode = D3D11_FILL_SOLID;
-		rasterizerDesc.CullMode = D3D11_CULL_NONE;
-		rasterizerDesc.FrontCounterClockwise = FALSE;
-		rasterizerDesc.DepthBias = 0;
-		rasterizerDesc.SlopeScaledDepthBias = 0.0f;
-		rasterizerDesc.DepthBiasClamp = 0.0f;
-		rasterizerDesc.DepthClipEnable = TRUE;
-		rasterizerDesc.ScissorEnable = FALSE;
-		rasterizerDesc.MultisampleEnable = FALSE;
-		rasterizerDesc.AntialiasedLineEnable = FALSE;
+		RenderRasterizerDesc rasterizerDesc = { CULL_NONE };
 
-		result = m_pDevice->CreateRasterizerState(&rasterizerDesc, &m_pTransRasterizerState);
+		result = m_pDevice->CreateRasterizerState(rasterizerDesc, &m_pTransRasterizerState);
 	}
 
 	// Create blend state
 	if (SUCCEEDED(result))
 	{
-		D3D11_BLEND_DESC blendDesc = { 0 };
-		blendDesc.RenderTarget[0].BlendEnable = TRUE;
-		blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
-		blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
-		blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
-		blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-		blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ONE;
-		blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ZERO;
-		blendDesc.RenderTarget[0].RenderTargetWriteMask = 0xF;
+		RenderBlendDesc blendDesc = {};
+		blendDesc.renderTarget[0].blendEnable = true;
+		blendDesc.renderTarget[0].destBlend = BLEND_INV_SRC_ALPHA;
+		blendDesc.renderTarget[0].srcBlend = BLEND_SRC_ALPHA;
+		blendDesc.renderTarget[0].destBlendAlpha = BLEND_ONE;
+		blendDesc.renderTarget[0].srcBlendAlpha = BLEND_ZERO;
+
+		result = m_pDevice->CreateBlendState(blendDesc, &m_pTransBlendState);
+	}
 
-		result = m_pDevice->CreateBlendState(&blendDesc, &m_pTransBlendState);
+	// Create OIT blend state, accumulation is additive and revealage is multiplied by 1 - alpha
+	if (SUCCEEDED(result))
+	{
+		RenderBlendDesc blendDesc = {};
+		blendDesc.independentBlendEnable = true;
+		blendDesc.renderTarget[0].blendEnable = true;
+		blendDesc.renderTarget[0].destBlend = BLEND_ONE;
+		blendDesc.renderTarget[0].srcBlend = BLEND_ONE;
+		blendDesc.renderTarget[0].destBlendAlpha = BLEND_ONE;
+		blendDesc.renderTarget[0].srcBlendAlpha = BLEND_ONE;
+		blendDesc.renderTarget[1].blendEnable = true;
+		blendDesc.renderTarget[1].destBlend = BLEND_INV_SRC_COLOR;
+		blendDesc.renderTarget[1].srcBlend = BLEND_ZERO;
+		blendDesc.renderTarget[1].destBlendAlpha = BLEND_INV_SRC_ALPHA;
+		blendDesc.renderTarget[1].srcBlendAlpha = BLEND_ZERO;
+
+		result = m_pDevice->CreateBlendState(blendDesc, &m_pOITBlendState);
 	}
 
 	// Create depth state
 	if (SUCCEEDED(result))
 	{
-		D3D11_DEPTH_STENCIL_DESC dsDesc = { 0 };
-		dsDesc.DepthEnable = TRUE;
-		dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
-		dsDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-		dsDesc.StencilEnable = FALSE;
+		RenderDepthStencilDesc dsDesc = { true, false, COMPARISON_LESS_EQUAL };
 
-		result = m_pDevice->CreateDepthStencilState(&dsDesc, &m_pTransDepthState);
+		result = m_pDevice->CreateDepthStencilState(dsDesc, &m_pTransDepthState);
 	}
 
 	return result;
 }
 
-HRESULT Renderer::CreateScene()
+HRESULT Renderer::CreateLights()
 {
-	// Textured cube
-	static const TextureVertex Vertices[24] = {
-		// Bottom face
-		{{-0.5, -0.5,  0.5, 1}, {0,1}, {0,-1,0}, {1,0,0}},
-		{{ 0.5, -0.5,  0.5, 1}, {1,1}, {0,-1,0}, {1,0,0}},
-		{{ 0.5, -0.5, -0.5, 1}, {1,0}, {0,-1,0}, {1,0,0}},
-		{{-0.5, -0.5, -0.5, 1}, {0,0}, {0,-1,0}, {1,0,0}},
-		// Top face
-		{{-0.5,  0.5, -0.5, 1}, {0,1}, {0,1,0}, {1,0,0}},
-		{{ 0.5,  0.5, -0.5, 1}, {1,1}, {0,1,0}, {1,0,0}},
-		{{ 0.5,  0.5,  0.5, 1}, {1,0}, {0,1,0}, {1,0,0}},
-		{{-0.5,  0.5,  0.5, 1}, {0,0}, {0,1,0}, {1,0,0}},
-		// Front face
-		{{ 0.5, -0.5, -0.5, 1}, {0,1}, {1,0,0}, {0,0,1}},
-		{{ 0.5, -0.5,  0.5, 1}, {1,1}, {1,0,0}, {0,0,1}},
-		{{ 0.5,  0.5,  0.5, 1}, {1,0}, {1,0,0}, {0,0,1}},
-		{{ 0.5,  0.5, -0.5, 1}, {0,0}, {1,0,0}, {0,0,1}},
-		// Back face
-		{{-0.5, -0.5,  0.5, 1}, {0,1}, {-1,0,0}, {0,0,-1}},
-		{{-0.5, -0.5, -0.5, 1}, {1,1}, {-1,0,0}, {0,0,-1}},
-		{{-0.5,  0.5, -0.5, 1}, {1,0}, {-1,0,0}, {0,0,-1}},
-		{{-0.5,  0.5,  0.5, 1}, {0,0}, {-1,0,0}, {0,0,-1}},
-		// Left face
-		{{ 0.5, -0.5,  0.5, 1}, {0,1}, {0,0,1}, {-1,0,0}},
-		{{-0.5, -0.5,  0.5, 1}, {1,1}, {0,0,1}, {-1,0,0}},
-		{{-0.5,  0.5,  0.5, 1}, {1,0}, {0,0,1}, {-1,0,0}},
-		{{ 0.5,  0.5,  0.5, 1}, {0,0}, {0,0,1}, {-1,0,0}},
-		// Right face
-		{{-0.5, -0.5, -0.5, 1}, {0,1}, {0,0,-1}, {1,0,0}},
-		{{ 0.5, -0.5, -0.5, 1}, {1,1}, {0,0,-1}, {1,0,0}},
-		{{ 0.5,  0.5, -0.5, 1}, {1,0}, {0,0,-1}, {1,0,0}},
-		{{-0.5,  0.5, -0.5, 1}, {0,0}, {0,0,-1}, {1,0,0}},
-	};
-	static const UINT16 Indices[IndicesCount] = {
-		0, 2, 1, 0, 3, 2,
-		4, 6, 5, 4, 7, 6,
-		8, 10, 9, 8, 11, 10,
-		12, 14, 13, 12, 15, 14, 
-		16, 18, 17, 16, 19, 18,
-		20, 22, 21, 20, 23, 22
+	PROFILE_SCOPE("CreateLights");
+
+	// Main lights
+	static const ClusterLight MainLights[MainLightCount] = {
+		{ { 0, 1, 0, 0 }, { 0.75f, 0, 0, 0 } },
+		{ { 3, 1, 0, 0 }, { 0, 0.75f, 0, 0 } },
+		{ { 0, 0, 2, 0 }, { 1, 1, 1, 0 } }
 	};
+	m_lights.assign(MainLights, MainLights + MainLightCount);
 
-	// Create vertex buffer
-	D3D11_BUFFER_DESC vertexBufferDesc = { 0 };
-	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	vertexBufferDesc.ByteWidth = sizeof(Vertices);
-	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDesc.CPUAccessFlags = 0;
-	vertexBufferDesc.MiscFlags = 0;
-	vertexBufferDesc.StructureByteStride = 0;
-
-	D3D11_SUBRESOURCE_DATA vertexData = { 0 };
-	vertexData.pSysMem = Vertices;
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
-
-	HRESULT result = m_pDevice->CreateBuffer(&vertexBufferDesc, &vertexData, &m_pVertexBuffer);
+	// Field of dim lights around cubes
+	for (UINT z = 0; z < LightFieldSize; z++)
+	{
+		for (UINT x = 0; x < LightFieldSize; x++)
+		{
+			float u = (float)x / (LightFieldSize - 1);
+			float v = (float)z / (LightFieldSize - 1);
+
+			ClusterLight light;
+			light.pos = XMFLOAT4{ -12.0f + 24.0f * u, sinf(x * 0.7f + z * 1.3f), -12.0f + 24.0f * v, 0 };
+			light.color = XMFLOAT4{ 0.02f * u, 0.02f * (1.0f - u), 0.02f * v, 0 };
+			m_lights.push_back(light);
+		}
+	}
+	assert(m_lights.size() == LightCount && LightCount <= MaxLights);
+
+	for (ClusterLight& light : m_lights)
+	{
+		light.pos.w = LightCutoffRadius(XMFLOAT3{ light.color.x, light.color.y, light.color.z });
+	}
+
+	// Create light buffer, lights do not move so it is immutable
+	RenderBufferDesc lightBufferDesc = { (UINT)(sizeof(ClusterLight) * m_lights.size()), USAGE_IMMUTABLE, BIND_SHADER_RESOURCE, sizeof(ClusterLight), FORMAT_UNKNOWN };
+
+	HRESULT result = m_pDevice->CreateBuffer(lightBufferDesc, m_lights.data(), &m_pLightBuffer);
 	assert(SUCCEEDED(result));
 
-	// Create index buffer
+	// Create cluster buffer, offset and count of light indices per cluster
 	if (SUCCEEDED(result))
 	{
-		D3D11_BUFFER_DESC indexBufferDesc = { 0 };
-		indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-		indexBufferDesc.ByteWidth = sizeof(Indices);
-		indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-		indexBufferDesc.CPUAccessFlags = 0;
-		indexBufferDesc.MiscFlags = 0;
-		indexBufferDesc.StructureByteStride = 0;
+		RenderBufferDesc clusterBufferDesc = { sizeof(LightClusters::Range) * LightClusters::Count, USAGE_DYNAMIC, BIND_SHADER_RESOURCE, sizeof(LightClusters::Range), FORMAT_R32G32_UINT };
 
-		D3D11_SUBRESOURCE_DATA indexData = { 0 };
-		indexData.pSysMem = Indices;
-		indexData.SysMemPitch = 0;
-		indexData.SysMemSlicePitch = 0;
+		result = m_pDevice->CreateBuffer(clusterBufferDesc, NULL, &m_pClusterBuffer);
+		assert(SUCCEEDED(result));
+	}
+
+	// Create light index buffer
+	if (SUCCEEDED(result))
+	{
+		RenderBufferDesc indexBufferDesc = { sizeof(UINT) * MaxLightIndices, USAGE_DYNAMIC, BIND_SHADER_RESOURCE, sizeof(UINT), FORMAT_R32_UINT };
 
-		result = m_pDevice->CreateBuffer(&indexBufferDesc, &indexData, &m_pIndexBuffer);
+		result = m_pDevice->CreateBuffer(indexBufferDesc, NULL, &m_pLightIndexBuffer);
 		assert(SUCCEEDED(result));
 	}
 
-	// Create vertex shader
-	ID3DBlob* pBlob = NULL;
-	m_pVertexShader = CreateVertexShader(_T("ColorShader.hlsl"), &pBlob);
-	// Create pixel shader
-	if (m_pVertexShader)
+	return result;
+}
+
+UINT Renderer::GetLightCount() const
+{
+	return m_lightField ? LightCount : MainLightCount;
+}
+
+HRESULT Renderer::CreateScene()
+{
+	PROFILE_SCOPE("CreateScene");
+
+
+	// Create vertex buffer of the textured cube
+	RenderBufferDesc vertexBufferDesc = { sizeof(CubeVertices), USAGE_DEFAULT, BIND_VERTEX_BUFFER, 0, FORMAT_UNKNOWN };
+
+	HRESULT result = m_pDevice->CreateBuffer(vertexBufferDesc, CubeVertices, &m_pVertexBuffer);
+	assert(SUCCEEDED(result));
+
+	// Create index buffer
+	if (SUCCEEDED(result))
 	{
-		m_pPixelShader = CreatePixelShader(_T("ColorShader.hlsl"));
+		RenderBufferDesc indexBufferDesc = { sizeof(CubeIndices), USAGE_DEFAULT, BIND_INDEX_BUFFER, 0, FORMAT_UNKNOWN };
+
+		result = m_pDevice->CreateBuffer(indexBufferDesc, CubeIndices, &m_pIndexBuffer);
+		assert(SUCCEEDED(result));
 	}
-	assert(m_pVertexShader != NULL && m_pPixelShader != NULL);
-	if (m_pVertexShader == NULL || m_pPixelShader == NULL)
+
+	// Create vertex shader
+	m_pVertexShader = CreateVertexShader(m_vertexShaderBuild);
+	assert(m_pVertexShader != NULL);
+	if (m_pVertexShader == NULL)
 	{
 		result = E_FAIL;
 	}
+	// Pixel shaders are created by ResolveShaders
+	m_pixelShaders.assign(m_pixelPermutations.GetVariantCount(), NULL);
 
 	// Create input layout
 	if (SUCCEEDED(result))
 	{
-		D3D11_INPUT_ELEMENT_DESC inputLayoutDesc[4] = {
-			D3D11_INPUT_ELEMENT_DESC{"POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-			D3D11_INPUT_ELEMENT_DESC{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, sizeof(XMVECTORF32), D3D11_INPUT_PER_VERTEX_DATA, 0},
-			D3D11_INPUT_ELEMENT_DESC{"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, sizeof(XMVECTORF32) + sizeof(XMFLOAT2), D3D11_INPUT_PER_VERTEX_DATA, 0},
-			D3D11_INPUT_ELEMENT_DESC{"TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, sizeof(XMVECTORF32) + sizeof(XMFLOAT2) + sizeof(XMFLOAT3), D3D11_INPUT_PER_VERTEX_DATA, 0},
+		RenderInputElement inputLayoutDesc[4] = {
+			RenderInputElement{"POSITION", 0, FORMAT_R32G32B32A32_FLOAT, 0, 0, false},
+			RenderInputElement{"TEXCOORD", 0, FORMAT_R32G32_FLOAT, 0, sizeof(XMVECTORF32), false},
+			RenderInputElement{"NORMAL", 0, FORMAT_R32G32B32_FLOAT, 0, sizeof(XMVECTORF32) + sizeof(XMFLOAT2), false},
+			RenderInputElement{"TANGENT", 0, FORMAT_R32G32B32_FLOAT, 0, sizeof(XMVECTORF32) + sizeof(XMFLOAT2) + sizeof(XMFLOAT3), false},
 		};
 
-		result = m_pDevice->CreateInputLayout(inputLayoutDesc, 4, pBlob->GetBufferPointer(), pBlob->GetBufferSize(), &m_pInputLayout);
+		result = CreateInputLayout(inputLayoutDesc, 4, m_vertexShaderBuild, &m_pInputLayout);
 		assert(SUCCEEDED(result));
 	}
-	SAFE_RELEASE(pBlob);
 
-	// Create model constant buffer
+	// Create instanced vertex shader
 	if (SUCCEEDED(result))
 	{
-		D3D11_BUFFER_DESC cbDesc = { 0 };
-		cbDesc.ByteWidth = sizeof(ModelBuffer);
-		cbDesc.Usage = D3D11_USAGE_DEFAULT;
-		cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		cbDesc.CPUAccessFlags = 0;
-		cbDesc.MiscFlags = 0;
-		cbDesc.StructureByteStride = 0;
-
-		result = m_pDevice->CreateBuffer(&cbDesc, NULL, &m_pModelBuffer);
-		if (SUCCEEDED(result))
+		m_pInstancedVertexShader = CreateVertexShader(m_instancedVertexShaderBuild);
+		assert(m_pInstancedVertexShader != NULL);
+		if (m_pInstancedVertexShader == NULL)
 		{
-			result = m_pDevice->CreateBuffer(&cbDesc, NULL, &m_pModelBuffer2);
+			result = E_FAIL;
 		}
 	}
 
-	// Create scene constant buffer
+	// Create instanced input layout
 	if (SUCCEEDED(result))
 	{
-		D3D11_BUFFER_DESC cbDesc = { 0 };
-		cbDesc.ByteWidth = sizeof(SceneBuffer);
-		cbDesc.Usage = D3D11_USAGE_DEFAULT;
-		cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		cbDesc.CPUAccessFlags = 0;
-		cbDesc.MiscFlags = 0;
-		cbDesc.StructureByteStride = 0;
+		RenderInputElement inputLayoutDesc[12] = {
+			RenderInputElement{"POSITION", 0, FORMAT_R32G32B32A32_FLOAT, 0, 0, false},
+			RenderInputElement{"TEXCOORD", 0, FORMAT_R32G32_FLOAT, 0, sizeof(XMVECTORF32), false},
+			RenderInputElement{"NORMAL", 0, FORMAT_R32G32B32_FLOAT, 0, sizeof(XMVECTORF32) + sizeof(XMFLOAT2), false},
+			RenderInputElement{"TANGENT", 0, FORMAT_R32G32B32_FLOAT, 0, sizeof(XMVECTORF32) + sizeof(XMFLOAT2) + sizeof(XMFLOAT3), false},
+			RenderInputElement{"MODEL", 0, FORMAT_R32G32B32A32_FLOAT, 1, 0, true},
+			RenderInputElement{"MODEL", 1, FORMAT_R32G32B32A32_FLOAT, 1, 16, true},
+			RenderInputElement{"MODEL", 2, FORMAT_R32G32B32A32_FLOAT, 1, 32, true},
+			RenderInputElement{"MODEL", 3, FORMAT_R32G32B32A32_FLOAT, 1, 48, true},
+			RenderInputElement{"NORMALMATRIX", 0, FORMAT_R32G32B32A32_FLOAT, 1, 64, true},
+			RenderInputElement{"NORMALMATRIX", 1, FORMAT_R32G32B32A32_FLOAT, 1, 80, true},
+			RenderInputElement{"NORMALMATRIX", 2, FORMAT_R32G32B32A32_FLOAT, 1, 96, true},
+			RenderInputElement{"NORMALMATRIX", 3, FORMAT_R32G32B32A32_FLOAT, 1, 112, true},
+		};
 
-		result = m_pDevice->CreateBuffer(&cbDesc, NULL, &m_pSceneBuffer);
+		result = CreateInputLayout(inputLayoutDesc, 12, m_instancedVertexShaderBuild, &m_pInstancedInputLayout);
+		assert(SUCCEEDED(result));
 	}
 
-	// Create rasterizer state
+	// Create instance buffer
 	if (SUCCEEDED(result))
 	{
-		D3D11_RASTERIZER_DESC rasterizerDesc;
-		rasterizerDesc.FillMode = D3D11_FILL_SOLID;
-		rasterizerDesc.CullMode = D3D11_CULL_BACK;
-		rasterizerDesc.FrontCounterClockwise = FALSE;
-		rasterizerDesc.DepthBias = 0;
-		rasterizerDesc.SlopeScaledDepthBias = 0.0f;
-		rasterizerDesc.DepthBiasClamp = 0.0f;
-		rasterizerDesc.DepthClipEnable = TRUE;
-		rasterizerDesc.ScissorEnable = FALSE;
-		rasterizerDesc.MultisampleEnable = FALSE;
-		rasterizerDesc.AntialiasedLineEnable = FALSE;
+		RenderBufferDesc instanceBufferDesc = { sizeof(InstanceData) * MaxInstances, USAGE_DYNAMIC, BIND_VERTEX_BUFFER, 0, FORMAT_UNKNOWN };
 
-		result = m_pDevice->CreateRasterizerState(&rasterizerDesc, &m_pRasterizerState);
+		result = m_pDevice->CreateBuffer(instanceBufferDesc, NULL, &m_pInstanceBuffer);
+		assert(SUCCEEDED(result));
 	}
 
-	// Create textures
+	// Create cubes
 	if (SUCCEEDED(result))
 	{
-		//result = DirectX::CreateDDSTextureFromFile(m_pDevice, L"Rocks.dds", (ID3D11Resource**)&m_pTexture, &m_pTextureSRV);
-		result = DirectX::CreateDDSTextureFromFile(m_pDevice, L"Brick.dds", (ID3D11Resource**)&m_pTexture, &m_pTextureSRV);
+		EntityId entity = m_transforms.CreateEntity(InvalidEntity);
+
+		AddObject(entity, XMFLOAT4{ 1, 1, 1, 1 }, m_opaqueObjects);
+	}
+	if (SUCCEEDED(result))
+	{
+		EntityId entity = m_transforms.CreateEntity(InvalidEntity);
+		m_transforms.SetPosition(entity, XMFLOAT3{ 1.5f, 0, 0 });
+
+		AddObject(entity, XMFLOAT4{ 1, 1, 1, 1 }, m_opaqueObjects);
+	}
+
+	// Create constant buffer ring for model and scene buffers
+	if (SUCCEEDED(result))
+	{
+		result = m_constantBuffers.Init(m_pDevice, ConstantBufferRingSize);
+	}
+
+	// Create deferred contexts for parallel recording, one per job system worker
+	if (SUCCEEDED(result))
+	{
+		UINT workerCount = m_jobs.GetWorkerCount();
+
+		m_deferredContexts.resize(workerCount, NULL);
+		for (UINT i = 0; i < workerCount && SUCCEEDED(result); i++)
+		{
+			result = m_pDevice->CreateDeferredContext(&m_deferredContexts[i]);
+			assert(SUCCEEDED(result));
+		}
+		if (SUCCEEDED(result))
+		{
+			m_recorder.Init(&m_jobs);
+		}
+	}
+
+	// Create rasterizer state
+	if (SUCCEEDED(result))
+	{
+		RenderRasterizerDesc rasterizerDesc = { CULL_BACK };
+
+		result = m_pDevice->CreateRasterizerState(rasterizerDesc, &m_pRasterizerState);
+	}
+
+	// Create textures
+	if (SUCCEEDED(result))
+	{
+		// Packed textures are optional, loose files are used for anything not in the archive
+		if (!m_textureArchive.Open(TextureArchivePath))
+		{
+			OutputDebugStringA("Texture archive is not available, loading loose files\n");
+		}
+		m_textureLoader.Init(m_pDevice->GetTextureParser(), TextureLoaderThreads, m_textureArchive.IsOpen() ? &m_textureArchive : NULL, &m_jobs);
+		m_textureStreamer.Init(TextureBudget, TextureStreamBudget, MinResidentTextureSize);
+
+		//m_textureIndex = (UINT)m_streamedTextures.size();
+		//result = AddStreamedTexture("Rocks.dds", PlaceholderColor, &m_pTexture);
+		m_textureIndex = (UINT)m_streamedTextures.size();
+		result = AddStreamedTexture("Brick.dds", PlaceholderColor, &m_pTexture);
 	}
 	if (SUCCEEDED(result))
 	{
-		result = DirectX::CreateDDSTextureFromFile(m_pDevice, L"BrickNM.dds", (ID3D11Resource**)&m_pTextureNM, &m_pTextureNMSRV);
+		m_textureNMIndex = (UINT)m_streamedTextures.size();
+		result = AddStreamedTexture("BrickNM.dds", PlaceholderNormal, &m_pTextureNM);
+	}
+
+	if (SUCCEEDED(result))
+	{
+		result = CreateLights();
 	}
 
 	if (SUCCEEDED(result))
@@ -713,242 +978,668 @@ HRESULT Renderer::CreateScene()
 
 void Renderer::DestroyScene()
 {
+	SAFE_RELEASE(m_pOITCompositePixelShader);
+	SAFE_RELEASE(m_pOITCompositeVertexShader);
+	SAFE_RELEASE(m_pOITBlendState);
+
 	SAFE_RELEASE(m_pTransDepthState);
 
 	SAFE_RELEASE(m_pTransBlendState);
 	SAFE_RELEASE(m_pTransRasterizerState);
 
-	SAFE_RELEASE(m_pModelBuffer3);
-	SAFE_RELEASE(m_pModelBuffer4);
+	m_transObjects.clear();
 	SAFE_RELEASE(m_pTransVertexBuffer);
 	SAFE_RELEASE(m_pTransIndexBuffer);
 	SAFE_RELEASE(m_pTransVertexShader);
-	SAFE_RELEASE(m_pTransPixelShader);
+	ReleasePixelShaderVariants(m_transPixelShaders);
 	SAFE_RELEASE(m_pTransInputLayout);
 
 	SAFE_RELEASE(m_pSamplerState);
 
-	SAFE_RELEASE(m_pTextureNMSRV);
-	SAFE_RELEASE(m_pTextureNM);
+	SAFE_RELEASE(m_pLightIndexBuffer);
+	SAFE_RELEASE(m_pClusterBuffer);
+	SAFE_RELEASE(m_pLightBuffer);
+	m_lights.clear();
+
+	m_textureLoader.Term();
+	m_textureArchive.Close();
+	m_completedLoads.clear();
+	m_streamedTextures.clear();
+	m_streamedTextureIndices.clear();
+	m_textureStreamer.Term();
 
-	SAFE_RELEASE(m_pTextureSRV);
+	SAFE_RELEASE(m_pTextureNM);
 	SAFE_RELEASE(m_pTexture);
 
 	SAFE_RELEASE(m_pRasterizerState);
-	SAFE_RELEASE(m_pModelBuffer2);
-	SAFE_RELEASE(m_pModelBuffer);
-	SAFE_RELEASE(m_pSceneBuffer);
+	m_opaqueObjects.clear();
+	m_opaqueBVH.Clear();
+	m_constantBuffers.Term();
+
+	m_recorder.Term();
+	for (RenderCommandList*& pCommandList : m_commandLists)
+	{
+		SAFE_RELEASE(pCommandList);
+	}
+	m_commandLists.clear();
+	for (IRenderContext*& pContext : m_deferredContexts)
+	{
+		SAFE_RELEASE(pContext);
+	}
+	m_deferredContexts.clear();
+
+	m_transforms.Clear();
 
 	SAFE_RELEASE(m_pInputLayout);
 
-	SAFE_RELEASE(m_pPixelShader);
+	SAFE_RELEASE(m_pInstanceBuffer);
+	SAFE_RELEASE(m_pInstancedInputLayout);
+	SAFE_RELEASE(m_pInstancedVertexShader);
+
+	ReleasePixelShaderVariants(m_pixelShaders);
 	SAFE_RELEASE(m_pVertexShader);
 
 	SAFE_RELEASE(m_pIndexBuffer);
 	SAFE_RELEASE(m_pVertexBuffer);
 }
 
-void Renderer::RenderScene()
+HRESULT Renderer::CreatePlaceholderTexture(UINT color, RenderResource** ppTexture)
 {
-	// Render transparents
-	//RenderSceneTransparent();
+	PROFILE_SCOPE("CreatePlaceholderTexture");
 
-	ID3D11Buffer* vertexBuffers[] = {m_pVertexBuffer};
-	UINT stride = sizeof(TextureVertex);
-	UINT offset = 0;
+	RenderTextureDesc desc = { 1, 1, FORMAT_R8G8B8A8_UNORM, USAGE_IMMUTABLE, BIND_SHADER_RESOURCE };
 
-	m_pContext->IASetVertexBuffers(0, 1, vertexBuffers, &stride, &offset);
-	m_pContext->IASetIndexBuffer(m_pIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+	return m_pDevice->CreateTexture(desc, &color, sizeof(color), ppTexture);
+}
 
-	m_pContext->IASetInputLayout(m_pInputLayout);
+// Placeholder is used until the small mips are loaded in background, the rest is streamed in by UpdateTextureStreaming
+HRESULT Renderer::AddStreamedTexture(const char* fileName, UINT placeholderColor, RenderResource** ppTexture)
+{
+	HRESULT result = CreatePlaceholderTexture(placeholderColor, ppTexture);
+	if (SUCCEEDED(result))
+	{
+		StreamedTexture texture = { fileName, TextureStreamer::InvalidTextureId, TextureLoader::InvalidLoadId, NoMip, 0, 0, ppTexture };
+		m_streamedTextures.push_back(texture);
 
-	m_pContext->VSSetShader(m_pVertexShader, NULL, 0);
-	m_pContext->PSSetShader(m_pPixelShader, NULL, 0);
+		QueueTextureLoad(m_streamedTextures.back(), NoMip);
+	}
 
+	return result;
+}
+
+// Loader skips mips bigger than maxSize, size is not known before the first load, so it only gets small mips
+void Renderer::QueueTextureLoad(StreamedTexture& texture, UINT residentMip)
+{
+	if (texture.load != TextureLoader::InvalidLoadId)
 	{
-		ID3D11Buffer* constBuffers[] = { m_pSceneBuffer };
-		m_pContext->VSSetConstantBuffers(1, 1, constBuffers);
-		m_pContext->PSSetConstantBuffers(1, 1, constBuffers);
+		texture.nextMip = residentMip;
+		return;
 	}
 
-	m_pContext->RSSetState(m_pRasterizerState);
-	m_pContext->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	UINT maxSize = MinResidentTextureSize;
+	if (residentMip != NoMip)
+	{
+		maxSize = (texture.width > texture.height ? texture.width : texture.height) >> residentMip;
+		if (maxSize == 0)
+		{
+			maxSize = 1;
+		}
+	}
 
-	ID3D11ShaderResourceView* textures[] = {m_pTextureSRV, m_pTextureNMSRV};
-	m_pContext->PSSetShaderResources(0, 2, textures);
+	texture.load = m_textureLoader.Load(texture.fileName, maxSize);
+	texture.nextMip = NoMip;
+}
+
+// Resources are created for finished loads, previous textures stay if anything fails
+void Renderer::ProcessTextureLoads()
+{
+	PROFILE_SCOPE("ProcessTextureLoads");
+
+	m_textureLoader.PopCompleted(m_completedLoads);
+	for (TextureLoader::LoadId load : m_completedLoads)
+	{
+		UINT index = 0;
+		while (index < m_streamedTextures.size() && m_streamedTextures[index].load != load)
+		{
+			index++;
+		}
+
+		// Every queued load has its texture, a load without one is released and dropped
+		assert(index < m_streamedTextures.size());
+		if (index == m_streamedTextures.size())
+		{
+			m_textureLoader.Release(load);
+			continue;
+		}
+		StreamedTexture& texture = m_streamedTextures[index];
+		texture.load = TextureLoader::InvalidLoadId;
+
+		HRESULT result = E_FAIL;
+		if (m_textureLoader.IsSucceeded(load))
+		{
+			const TextureData& data = m_textureLoader.GetData(load);
+
+			RenderResource* pTexture = NULL;
+			result = m_pDevice->CreateTexture(data, &pTexture);
+			if (SUCCEEDED(result))
+			{
+				RenderResource*& pOldTexture = *texture.ppTexture;
+				SAFE_RELEASE(pOldTexture);
+
+				pOldTexture = pTexture;
+
+				// First load has the pinned mips the streamer starts with
+				if (texture.id == TextureStreamer::InvalidTextureId)
+				{
+					texture.width = data.fileWidth;
+					texture.height = data.fileHeight;
+					texture.id = m_textureStreamer.Add(data.fileWidth, data.fileHeight, data.mipSizes);
+					m_streamedTextureIndices.push_back(index);
+				}
+			}
+		}
+		m_textureLoader.Release(load);
+
+		if (FAILED(result))
+		{
+			char message[256];
+			sprintf_s(message, "Failed to load texture %s\n", texture.fileName);
+			OutputDebugStringA(message);
+		}
+
+		if (texture.nextMip != NoMip)
+		{
+			QueueTextureLoad(texture, texture.nextMip);
+		}
+	}
+}
+
+// Textures are wanted at the size one texture repeat takes on the nearest visible cube face
+void Renderer::UpdateTextureStreaming(const XMFLOAT4X4& view, float focalPixels)
+{
+	PROFILE_SCOPE("UpdateTextureStreaming");
+
+	static const float MinDepth = 0.1f;
 
-	ID3D11SamplerState* samplers[] = {m_pSamplerState};
-	m_pContext->PSSetSamplers(0, 1, samplers);
+	ProcessTextureLoads();
 
-	// First triangle
+	float nearest = FLT_MAX;
+	for (UINT index : m_visibleObjects)
 	{
-		ID3D11Buffer* constBuffers[] = { m_pModelBuffer };
-		m_pContext->VSSetConstantBuffers(0, 1, constBuffers);
+		const AABB& box = m_opaqueBoxes[index];
+		XMFLOAT3 center{ (box.min.x + box.max.x) * 0.5f, (box.min.y + box.max.y) * 0.5f, (box.min.z + box.max.z) * 0.5f };
+		XMFLOAT3 extent{ box.max.x - center.x, box.max.y - center.y, box.max.z - center.z };
 
-		m_pContext->DrawIndexed(IndicesCount, 0, 0);
+		float depth = center.x * view._13 + center.y * view._23 + center.z * view._33 + view._43
+			- sqrtf(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+		nearest = depth < nearest ? depth : nearest;
 	}
 
-	// Second triangle
+	// Textures still on placeholders are not known to the streamer yet
+	TextureStreamer::TextureId textureId = m_streamedTextures[m_textureIndex].id;
+	TextureStreamer::TextureId textureNMId = m_streamedTextures[m_textureNMIndex].id;
+	if (!m_visibleObjects.empty())
 	{
-		ID3D11Buffer* constBuffers[] = { m_pModelBuffer2 };
-		m_pContext->VSSetConstantBuffers(0, 1, constBuffers);
+		float screenSize = focalPixels / (nearest > MinDepth ? nearest : MinDepth);
+		if (textureId != TextureStreamer::InvalidTextureId)
+		{
+			m_textureStreamer.RequestUsage(textureId, screenSize);
+		}
+		if (m_mode == 0 && textureNMId != TextureStreamer::InvalidTextureId)
+		{
+			m_textureStreamer.RequestUsage(textureNMId, screenSize);
+		}
+	}
 
-		m_pContext->DrawIndexed(IndicesCount, 0, 0);
+	// Changed textures are loaded again with their new top mip
+	m_textureStreamer.Update(m_textureChanges);
+	for (const TextureStreamer::Change& change : m_textureChanges)
+	{
+		QueueTextureLoad(m_streamedTextures[m_streamedTextureIndices[change.id]], change.residentMip);
 	}
+}
+
+void Renderer::AddObject(EntityId entity, const XMFLOAT4& color, std::vector<SceneObject>& objects)
+{
+	SceneObject object = { entity, color, { 0, 0 } };
+	objects.push_back(object);
+}
+
+void Renderer::RenderScene()
+{
+	PROFILE_SCOPE("RenderScene");
+
+	m_gpuProfiler.BeginPass(m_pContext, "Opaque");
+
+	UINT visibleCount = (UINT)m_visibleObjects.size();
+
+	if (m_parallelRecording && !m_instancing)
+	{
+		// Chunks of cubes are recorded on deferred contexts and executed in order
+		UINT chunkCount = (UINT)m_deferredContexts.size() * ChunksPerWorker;
+		UINT maxChunks = (visibleCount + MinChunkObjects - 1) / MinChunkObjects;
+		chunkCount = chunkCount < maxChunks ? chunkCount : maxChunks;
+
+		bool recorded = m_recorder.Record(this, visibleCount, chunkCount);
+		assert(recorded);
+		UNREFERENCED_PARAMETER(recorded);
+
+		// Command lists leave immediate context in default state
+		SetupRenderTargets(m_pContext);
+	}
+	else
+	{
+		SetupOpaqueState(m_pContext);
+
+		if (m_instancing)
+		{
+			// All cubes at once, or in batches of MaxInstances
+			DrawInstances(m_pContext, m_pInstanceBuffer, MaxInstances, CubeIndexCount, m_modelMatrices.data(), m_normalMatrices.data(), visibleCount);
+		}
+		else
+		{
+			DrawOpaqueObjects(m_pContext, 0, visibleCount);
+		}
+	}
+
+	m_gpuProfiler.EndPass(m_pContext);
 
 	// Render transparents
 	RenderSceneTransparent();
 }
 
+void Renderer::SetupRenderTargets(IRenderContext* pContext)
+{
+	RenderResource* views[] = {m_pDevice->GetBackBuffer()};
+	pContext->OMSetRenderTargets(1, views, m_pDepth);
+
+	RenderViewport viewport{0, 0, (float)m_width, (float)m_height, 0.0f, 1.0f};
+	pContext->RSSetViewport(viewport);
+	RenderRect rect{ 0, 0, (int)m_width, (int)m_height };
+	pContext->RSSetScissorRect(rect);
+}
+
+void Renderer::SetupOpaqueState(IRenderContext* pContext)
+{
+	if (m_instancing)
+	{
+		RenderResource* vertexBuffers[] = {m_pVertexBuffer, m_pInstanceBuffer};
+		UINT strides[] = {sizeof(TextureVertex), sizeof(InstanceData)};
+		UINT offsets[] = {0, 0};
+
+		pContext->IASetVertexBuffers(0, 2, vertexBuffers, strides, offsets);
+		pContext->IASetInputLayout(m_pInstancedInputLayout);
+		pContext->VSSetShader(m_pInstancedVertexShader);
+	}
+	else
+	{
+		RenderResource* vertexBuffers[] = {m_pVertexBuffer};
+		UINT stride = sizeof(TextureVertex);
+		UINT offset = 0;
+
+		pContext->IASetVertexBuffers(0, 1, vertexBuffers, &stride, &offset);
+		pContext->IASetInputLayout(m_pInputLayout);
+		pContext->VSSetShader(m_pVertexShader);
+	}
+	pContext->IASetIndexBuffer(m_pIndexBuffer, FORMAT_R16_UINT, 0);
+
+	pContext->PSSetShader(GetPixelShaderVariant(m_pixelPermutations, m_pixelShaders, m_shaderKey));
+
+	{
+		RenderResource* constBuffers[] = { m_constantBuffers.GetBuffer() };
+		pContext->VSSetConstantBuffers(1, 1, constBuffers, &m_sceneBuffer.firstConstant, &m_sceneBuffer.numConstants);
+		pContext->PSSetConstantBuffers(1, 1, constBuffers, &m_sceneBuffer.firstConstant, &m_sceneBuffer.numConstants);
+	}
+
+	pContext->RSSetState(m_pRasterizerState);
+	pContext->IASetPrimitiveTopology(TOPOLOGY_TRIANGLE_LIST);
+
+	RenderResource* textures[] = {m_pTexture, m_pTextureNM, m_pLightBuffer, m_pClusterBuffer, m_pLightIndexBuffer};
+	pContext->PSSetShaderResources(0, 5, textures);
+
+	RenderSamplerState* samplers[] = {m_pSamplerState};
+	pContext->PSSetSamplers(0, 1, samplers);
+}
+
+void Renderer::DrawOpaqueObjects(IRenderContext* pContext, UINT firstObject, UINT objectCount)
+{
+	for (UINT i = firstObject; i < firstObject + objectCount; i++)
+	{
+		const SceneObject& object = m_opaqueObjects[m_visibleObjects[i]];
+
+		RenderResource* constBuffers[] = { m_constantBuffers.GetBuffer() };
+		pContext->VSSetConstantBuffers(0, 1, constBuffers, &object.modelBuffer.firstConstant, &object.modelBuffer.numConstants);
+
+		pContext->DrawIndexed(CubeIndexCount, 0, 0);
+	}
+}
+
+void Renderer::BeginRecord(unsigned int chunkCount)
+{
+	m_commandLists.resize(chunkCount, NULL);
+}
+
+bool Renderer::RecordChunk(unsigned int worker, unsigned int chunk, unsigned int firstItem, unsigned int itemCount)
+{
+	PROFILE_SCOPE("RecordChunk");
+
+	IRenderContext* pContext = m_deferredContexts[worker];
+
+	SetupRenderTargets(pContext);
+	SetupOpaqueState(pContext);
+	DrawOpaqueObjects(pContext, firstItem, itemCount);
+
+	HRESULT result = pContext->FinishCommandList(&m_commandLists[chunk]);
+	assert(SUCCEEDED(result));
+
+	return SUCCEEDED(result);
+}
+
+void Renderer::SubmitChunk(unsigned int chunk)
+{
+	if (m_commandLists[chunk] != NULL)
+	{
+		m_pContext->ExecuteCommandList(m_commandLists[chunk]);
+		SAFE_RELEASE(m_commandLists[chunk]);
+	}
+}
+
 void Renderer::RenderSceneTransparent()
 {
-	ID3D11Buffer* vertexBuffers[] = { m_pTransVertexBuffer };
+	PROFILE_SCOPE("RenderSceneTransparent");
+	GpuPassScope pass(m_gpuProfiler, m_pContext, "Transparent");
+
+	RenderResource* vertexBuffers[] = { m_pTransVertexBuffer };
 	UINT stride = sizeof(XMVECTORF32);
 	UINT offset = 0;
 
 	m_pContext->IASetVertexBuffers(0, 1, vertexBuffers, &stride, &offset);
-	m_pContext->IASetIndexBuffer(m_pTransIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+	m_pContext->IASetIndexBuffer(m_pTransIndexBuffer, FORMAT_R16_UINT, 0);
 
 	m_pContext->IASetInputLayout(m_pTransInputLayout);
 
-	m_pContext->VSSetShader(m_pTransVertexShader, NULL, 0);
-	m_pContext->PSSetShader(m_pTransPixelShader, NULL, 0);
+	m_pContext->VSSetShader(m_pTransVertexShader);
 
 	{
-		ID3D11Buffer* constBuffers[] = { m_pSceneBuffer };
-		m_pContext->VSSetConstantBuffers(1, 1, constBuffers);
-		m_pContext->PSSetConstantBuffers(1, 1, constBuffers);
+		RenderResource* constBuffers[] = { m_constantBuffers.GetBuffer() };
+		m_pContext->VSSetConstantBuffers(1, 1, constBuffers, &m_sceneBuffer.firstConstant, &m_sceneBuffer.numConstants);
+		m_pContext->PSSetConstantBuffers(1, 1, constBuffers, &m_sceneBuffer.firstConstant, &m_sceneBuffer.numConstants);
 	}
 
-	m_pContext->RSSetState(m_pRasterizerState);
-	m_pContext->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	m_pContext->IASetPrimitiveTopology(TOPOLOGY_TRIANGLE_LIST);
 
 	m_pContext->RSSetState(m_pTransRasterizerState);
-	m_pContext->OMSetBlendState(m_pTransBlendState, NULL, 0xFFFFFFFF);
 
-	m_pContext->OMSetDepthStencilState(m_pTransDepthState, 0);
+	m_pContext->OMSetDepthStencilState(m_pTransDepthState);
 
-	XMMATRIX view = XMMatrixTranslation(0, 0, -m_dist) * XMMatrixRotationAxis({ 1,0,0 }, m_lat) * XMMatrixRotationAxis({ 0,1,0 }, m_lon);
-	XMVECTOR cameraPos = XMVector4Transform(XMVECTOR{ 0,0,0,1 }, view);
-	XMVECTOR cameraDir = -cameraPos / m_dist;
+	if (m_transparencyMode == TransparencyOIT)
+	{
+		RenderTransparentOIT();
+	}
+	else
+	{
+		RenderTransparentSorted();
+	}
+}
 
-	float transDist1 = XMVector3Dot(TransPos1.v - cameraPos, cameraDir).m128_f32[0];
-	float transDist2 = XMVector3Dot(TransPos2.v - cameraPos, cameraDir).m128_f32[0];
+void Renderer::RenderTransparentSorted()
+{
+	m_pContext->PSSetShader(GetPixelShaderVariant(m_transPixelPermutations, m_transPixelShaders, m_shaderKey & ~SHADER_FEATURE_OIT));
+	m_pContext->OMSetBlendState(m_pTransBlendState);
 
-	if (transDist1 < transDist2)
+	for (UINT index : m_transSort.GetIndices())
 	{
-		// Second transparent quad
-		{
-			ID3D11Buffer* constBuffers[] = { m_pModelBuffer4 };
-			m_pContext->VSSetConstantBuffers(0, 1, constBuffers);
-			m_pContext->PSSetConstantBuffers(0, 1, constBuffers);
+		const SceneObject& object = m_transObjects[index];
 
-			m_pContext->DrawIndexed(6, 0, 0);
-		}
-		// First transparent quad
-		{
-			ID3D11Buffer* constBuffers[] = { m_pModelBuffer3 };
-			m_pContext->VSSetConstantBuffers(0, 1, constBuffers);
-			m_pContext->PSSetConstantBuffers(0, 1, constBuffers);
+		RenderResource* constBuffers[] = { m_constantBuffers.GetBuffer() };
+		m_pContext->VSSetConstantBuffers(0, 1, constBuffers, &object.modelBuffer.firstConstant, &object.modelBuffer.numConstants);
+		m_pContext->PSSetConstantBuffers(0, 1, constBuffers, &object.modelBuffer.firstConstant, &object.modelBuffer.numConstants);
 
-			m_pContext->DrawIndexed(6, 0, 0);
-		}
+		m_pContext->DrawIndexed(6, 0, 0);
 	}
-	else
+}
+
+void Renderer::RenderTransparentOIT()
+{
+	// Accumulate transparent surfaces in any order, depth test against opaque scene
+	static const FLOAT AccumClear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	static const FLOAT RevealageClear[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	m_pContext->ClearRenderTargetView(m_pOITAccum, AccumClear);
+	m_pContext->ClearRenderTargetView(m_pOITRevealage, RevealageClear);
+
+	RenderResource* oitViews[] = { m_pOITAccum, m_pOITRevealage };
+	m_pContext->OMSetRenderTargets(2, oitViews, m_pDepth);
+
+	m_pContext->PSSetShader(GetPixelShaderVariant(m_transPixelPermutations, m_transPixelShaders, m_shaderKey | SHADER_FEATURE_OIT));
+	m_pContext->OMSetBlendState(m_pOITBlendState);
+
+	for (const SceneObject& object : m_transObjects)
 	{
-		// First transparent quad
-		{
-			ID3D11Buffer* constBuffers[] = { m_pModelBuffer3 };
-			m_pContext->VSSetConstantBuffers(0, 1, constBuffers);
-			m_pContext->PSSetConstantBuffers(0, 1, constBuffers);
+		RenderResource* constBuffers[] = { m_constantBuffers.GetBuffer() };
+		m_pContext->VSSetConstantBuffers(0, 1, constBuffers, &object.modelBuffer.firstConstant, &object.modelBuffer.numConstants);
+		m_pContext->PSSetConstantBuffers(0, 1, constBuffers, &object.modelBuffer.firstConstant, &object.modelBuffer.numConstants);
 
-			m_pContext->DrawIndexed(6, 0, 0);
-		}
-		// Second transparent quad
-		{
-			ID3D11Buffer* constBuffers[] = { m_pModelBuffer4 };
-			m_pContext->VSSetConstantBuffers(0, 1, constBuffers);
-			m_pContext->PSSetConstantBuffers(0, 1, constBuffers);
+		m_pContext->DrawIndexed(6, 0, 0);
+	}
 
-			m_pContext->DrawIndexed(6, 0, 0);
-		}
+	// Composite over back buffer
+	RenderResource* views[] = { m_pDevice->GetBackBuffer() };
+	m_pContext->OMSetRenderTargets(1, views, NULL);
+	m_pContext->OMSetBlendState(m_pTransBlendState);
+
+	m_pContext->IASetInputLayout(NULL);
+	m_pContext->VSSetShader(m_pOITCompositeVertexShader);
+	m_pContext->PSSetShader(m_pOITCompositePixelShader);
+
+	RenderResource* textures[] = { m_pOITAccum, m_pOITRevealage };
+	m_pContext->PSSetShaderResources(0, 2, textures);
+
+	m_pContext->Draw(3, 0);
+
+	// Targets are written again next frame
+	RenderResource* nullTextures[] = { NULL, NULL };
+	m_pContext->PSSetShaderResources(0, 2, nullTextures);
+
+	m_pContext->OMSetRenderTargets(1, views, m_pDepth);
+}
+
+bool Renderer::LoadShaderSource(const char* shaderSource, std::string& source)
+{
+	MappedFile file;
+	if (!file.Open(shaderSource))
+	{
+		return false;
+	}
+
+	source.assign((const char*)file.GetData(), file.GetSize());
+
+	return !source.empty();
+}
+
+HRESULT Renderer::QueueShaders()
+{
+	std::string colorSource;
+	std::string transSource;
+	std::string compositeSource;
+	if (!LoadShaderSource("ColorShader.hlsl", colorSource)
+		|| !LoadShaderSource("TransColorShader.hlsl", transSource)
+		|| !LoadShaderSource("OITComposite.hlsl", compositeSource))
+	{
+		return E_FAIL;
+	}
+
+	// Features of the first frame, see Update, lights are not created yet so their count comes from the constants
+	m_shaderKey = MakeShaderKey(m_mode == 0 ? SHADER_FEATURE_NORMAL_MAP : 0, GetShaderLightBucket(GetLightCount()));
+
+	// Vertex shaders are needed for input layouts at scene creation
+	m_vertexShaderBuild = AddShaderBuild(colorSource, "ColorShader.hlsl", "VS", "vs_5_0", 0, true);
+	m_instancedVertexShaderBuild = AddShaderBuild(colorSource, "ColorShader.hlsl", "VSInstanced", "vs_5_0", 0, true);
+	m_transVertexShaderBuild = AddShaderBuild(transSource, "TransColorShader.hlsl", "VS", "vs_5_0", 0, true);
+
+	// Pixel shaders for all normal mapping and light count combinations, and for sorted and OIT transparency
+	m_pixelPermutations.Init(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_LIGHT_BUCKET);
+	m_transPixelPermutations.Init(SHADER_FEATURE_OIT);
+	AddPixelShaderBuilds(colorSource, "ColorShader.hlsl", "PS", m_pixelPermutations, m_pixelShaderBuilds);
+	AddPixelShaderBuilds(transSource, "TransColorShader.hlsl", "PS", m_transPixelPermutations, m_transPixelShaderBuilds);
+
+	// Composite shaders are needed in OIT transparency mode only
+	m_oitCompositeVertexShaderBuild = AddShaderBuild(compositeSource, "OITComposite.hlsl", "VS", "vs_5_0", 0, m_transparencyMode == TransparencyOIT);
+	m_oitCompositePixelShaderBuild = AddShaderBuild(compositeSource, "OITComposite.hlsl", "PS", "ps_5_0", 0, m_transparencyMode == TransparencyOIT);
+
+	m_pendingShaderBuilds = (UINT)(m_pixelShaderBuilds.size() + m_transPixelShaderBuilds.size()) + 2;
+
+	m_shaderBuilder.Start(&m_shaderCache, m_pDevice->GetShaderCompiler(), std::thread::hardware_concurrency());
+
+	return S_OK;
+}
+
+ShaderBuilder::BuildId Renderer::AddShaderBuild(const std::string& source, const char* fileName, const char* entryPoint, const char* profile, ShaderKey key, bool critical)
+{
+	ShaderRequest request;
+	request.source = source;
+	request.entryPoint = entryPoint;
+	request.profile = profile;
+	request.flags = 0;
+	GetShaderDefines(key, request.defines);
+
+	char name[256];
+	sprintf_s(name, "%s %s key %u", fileName, entryPoint, key);
+
+	return m_shaderBuilder.Add(request, name, critical);
+}
+
+void Renderer::AddPixelShaderBuilds(const std::string& source, const char* fileName, const char* entryPoint, const ShaderPermutations& permutations, std::vector<ShaderBuilder::BuildId>& builds)
+{
+	// Variant of the first frame is critical
+	UINT firstVariant = permutations.GetVariantIndex(m_transparencyMode == TransparencyOIT ? (m_shaderKey | SHADER_FEATURE_OIT) : m_shaderKey);
+
+	builds.resize(permutations.GetVariantCount());
+	for (UINT i = 0; i < permutations.GetVariantCount(); i++)
+	{
+		builds[i] = AddShaderBuild(source, fileName, entryPoint, "ps_5_0", permutations.GetVariantKey(i), i == firstVariant);
 	}
 }
 
-ID3D11VertexShader* Renderer::CreateVertexShader(LPCTSTR shaderSource, ID3DBlob** ppBlob)
+bool Renderer::ResolveShaders()
 {
-	ID3D11VertexShader* pVertexShader = NULL;
+	if (m_pendingShaderBuilds == 0)
+	{
+		return true;
+	}
+
+	// Shaders of this frame are waited for, others are created once their builds are done
+	bool oit = m_transparencyMode == TransparencyOIT;
+	UINT opaqueVariant = m_pixelPermutations.GetVariantIndex(m_shaderKey);
+	UINT transVariant = m_transPixelPermutations.GetVariantIndex(oit ? (m_shaderKey | SHADER_FEATURE_OIT) : (m_shaderKey & ~SHADER_FEATURE_OIT));
 
-	FILE* pFile = NULL;
+	bool resolved = true;
+	for (UINT i = 0; i < (UINT)m_pixelShaders.size(); i++)
+	{
+		resolved = ResolvePixelShader(m_pixelShaderBuilds[i], i == opaqueVariant, &m_pixelShaders[i]) && resolved;
+	}
+	for (UINT i = 0; i < (UINT)m_transPixelShaders.size(); i++)
+	{
+		resolved = ResolvePixelShader(m_transPixelShaderBuilds[i], i == transVariant, &m_transPixelShaders[i]) && resolved;
+	}
+	resolved = ResolveVertexShader(m_oitCompositeVertexShaderBuild, oit, &m_pOITCompositeVertexShader) && resolved;
+	resolved = ResolvePixelShader(m_oitCompositePixelShaderBuild, oit, &m_pOITCompositePixelShader) && resolved;
 
-	_tfopen_s(&pFile, shaderSource, _T("rb"));
-	if (pFile != NULL)
+	if (m_pendingShaderBuilds == 0)
 	{
-		fseek(pFile, 0, SEEK_END);
-		int size = ftell(pFile);
-		fseek(pFile, 0, SEEK_SET);
+		// All shaders are ready, report startup compilation
+		OutputDebugStringA(m_shaderBuilder.GetReport().c_str());
+	}
 
-		char* pSourceCode = (char*)malloc((size_t)size + 1);
-		fread(pSourceCode, size, 1, pFile);
-		pSourceCode[size] = 0;
+	return resolved;
+}
 
-		fclose(pFile);
+bool Renderer::ResolveVertexShader(ShaderBuilder::BuildId& build, bool wait, RenderVertexShader** ppShader)
+{
+	if (build != ShaderBuilder::InvalidBuildId && (wait || m_shaderBuilder.IsDone(build)))
+	{
+		*ppShader = CreateVertexShader(build);
+		build = ShaderBuilder::InvalidBuildId;
+		m_pendingShaderBuilds--;
+	}
 
-		ID3DBlob* pError = NULL;
-		HRESULT result = D3DCompile(pSourceCode, size, "", NULL, NULL, "VS", "vs_5_0", 0, 0, ppBlob, &pError);
-		if (!SUCCEEDED(result))
-		{
-			const char *pMsg = (const char*)pError->GetBufferPointer();
-			OutputDebugStringA(pMsg);
-		}
-		else
-		{
-			result = m_pDevice->CreateVertexShader((*ppBlob)->GetBufferPointer(), (*ppBlob)->GetBufferSize(), NULL, &pVertexShader);
-			assert(SUCCEEDED(result));
-		}
+	return !wait || *ppShader != NULL;
+}
 
-		SAFE_RELEASE(pError);
+bool Renderer::ResolvePixelShader(ShaderBuilder::BuildId& build, bool wait, RenderPixelShader** ppShader)
+{
+	if (build != ShaderBuilder::InvalidBuildId && (wait || m_shaderBuilder.IsDone(build)))
+	{
+		*ppShader = CreatePixelShader(build);
+		build = ShaderBuilder::InvalidBuildId;
+		m_pendingShaderBuilds--;
 	}
 
-	return pVertexShader;
+	return !wait || *ppShader != NULL;
 }
 
-ID3D11PixelShader* Renderer::CreatePixelShader(LPCTSTR shaderSource)
+RenderVertexShader* Renderer::CreateVertexShader(ShaderBuilder::BuildId build)
 {
-	ID3D11PixelShader* pPixelShader = NULL;
+	PROFILE_SCOPE("CreateVertexShader");
 
-	FILE* pFile = NULL;
+	RenderVertexShader* pVertexShader = NULL;
 
-	_tfopen_s(&pFile, shaderSource, _T("rb"));
-	if (pFile != NULL)
+	if (m_shaderBuilder.Wait(build))
 	{
-		fseek(pFile, 0, SEEK_END);
-		int size = ftell(pFile);
-		fseek(pFile, 0, SEEK_SET);
+		const std::vector<uint8_t>& bytecode = m_shaderBuilder.GetBytecode(build);
 
-		char* pSourceCode = (char*)malloc((size_t)size + 1);
-		fread(pSourceCode, size, 1, pFile);
-		pSourceCode[size] = 0;
+		HRESULT result = m_pDevice->CreateVertexShader(bytecode.data(), bytecode.size(), &pVertexShader);
+		assert(SUCCEEDED(result));
+		UNREFERENCED_PARAMETER(result);
+	}
+	else
+	{
+		OutputDebugStringA(m_shaderBuilder.GetErrors(build).c_str());
+	}
 
-		fclose(pFile);
+	return pVertexShader;
+}
 
-		ID3DBlob* pBlob = NULL;
-		ID3DBlob* pError = NULL;
-		HRESULT result = D3DCompile(pSourceCode, size, "", NULL, NULL, "PS", "ps_5_0", 0, 0, &pBlob, &pError);
-		if (!SUCCEEDED(result))
-		{
-			const char* pMsg = (const char*)pError->GetBufferPointer();
-			OutputDebugStringA(pMsg);
-		}
-		else
-		{
-			result = m_pDevice->CreatePixelShader(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), NULL, &pPixelShader);
-			assert(SUCCEEDED(result));
-		}
+RenderPixelShader* Renderer::CreatePixelShader(ShaderBuilder::BuildId build)
+{
+	PROFILE_SCOPE("CreatePixelShader");
+
+	RenderPixelShader* pPixelShader = NULL;
+
+	if (m_shaderBuilder.Wait(build))
+	{
+		const std::vector<uint8_t>& bytecode = m_shaderBuilder.GetBytecode(build);
 
-		SAFE_RELEASE(pError);
-		SAFE_RELEASE(pBlob);
+		HRESULT result = m_pDevice->CreatePixelShader(bytecode.data(), bytecode.size(), &pPixelShader);
+		assert(SUCCEEDED(result));
+		UNREFERENCED_PARAMETER(result);
+	}
+	else
+	{
+		OutputDebugStringA(m_shaderBuilder.GetErrors(build).c_str());
 	}
 
 	return pPixelShader;
 }
+
+HRESULT Renderer::CreateInputLayout(const RenderInputElement* pElements, UINT count, ShaderBuilder::BuildId build, RenderInputLayout** ppLayout)
+{
+	PROFILE_SCOPE("CreateInputLayout");
+
+	const std::vector<uint8_t>& bytecode = m_shaderBuilder.GetBytecode(build);
+
+	return m_pDevice->CreateInputLayout(pElements, count, bytecode.data(), bytecode.size(), ppLayout);
+}
+
+void Renderer::ReleasePixelShaderVariants(std::vector<RenderPixelShader*>& shaders)
+{
+	for (RenderPixelShader*& pShader : shaders)
+	{
+		SAFE_RELEASE(pShader);
+	}
+	shaders.clear();
+}
+
+RenderPixelShader* Renderer::GetPixelShaderVariant(const ShaderPermutations& permutations, const std::vector<RenderPixelShader*>& shaders, ShaderKey key) const
+{
+	return shaders[permutations.GetVariantIndex(key)];
+}
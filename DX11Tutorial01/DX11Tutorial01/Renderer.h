@@ -1,87 +1,256 @@
 #pragma once
 
-#include <d3d11.h>
-#include <dxgi.h>
+#include <vector>
 
-class Renderer
+#include "ConstantBufferRing.h"
+#include "FrustumCulling.h"
+#include "GpuProfiler.h"
+#include "JobSystem.h"
+#include "LightClusters.h"
+#include "ParallelRecorder.h"
+#include "RadixSort.h"
+#include "RenderDevice.h"
+#include "ShaderBuilder.h"
+#include "ShaderCache.h"
+#include "ShaderPermutations.h"
+#include "TextureLoader.h"
+#include "TextureStreamer.h"
+#include "TransformSystem.h"
+
+class SoftwareRasterizer;
+struct SceneBuffer;
+
+class Renderer : private IRecordBackend
 {
 public:
 	Renderer();
 
-	bool Init(HWND hWnd);
+	// Device is owned by the caller and must outlive the renderer
+	bool Init(IRenderDevice* pDevice);
 	void Term();
 
 	void Resize(UINT width, UINT height);
 
 	bool Update();
 	bool Render();
+	// Opaque pass of the frame prepared by Update, drawn on the CPU as a reference for Render
+	// Rasterizer has to be of the back buffer size, its textures are set by the caller
+	bool RenderSoftware(SoftwareRasterizer& rasterizer);
 
 	void MouseMove(int dx, int dy);
 	void MouseWheel(int dz);
+	// Camera of the next updates, angles in radians as MouseMove and MouseWheel change them
+	void SetCamera(float lon, float lat, float dist);
+	// Animation of the next updates is at the given time in seconds, negative returns it to the clock
+	void SetAnimationTime(double seconds);
 
 	void SwitchNormalMode();
+	void SwitchInstancingMode();
+	void SwitchLightField();
+	void SwitchTransparencyMode();
+	void SwitchParallelMode();
+
+	// GPU times of the frame and of its passes, measured in Render
+	const GpuProfiler& GetGpuProfiler() const { return m_gpuProfiler; }
+
+private:
+	struct SceneObject
+	{
+		EntityId entity;
+		DirectX::XMFLOAT4 color;
+		ConstantBufferRange modelBuffer; // Valid for the current frame only
+	};
+
+	// Texture which is recreated with a different top mip when its residency changes
+	// Placeholder is used until the first load is done, loads are made one at a time
+	struct StreamedTexture
+	{
+		const char* fileName;
+		TextureStreamer::TextureId id; // Invalid until the first load is done
+		TextureLoader::LoadId load;    // Load in progress
+		UINT nextMip;                  // Resident mip to load after the current load, NoMip if none
+		UINT width;
+		UINT height;
+		RenderResource** ppTexture;
+	};
+
+	enum TransparencyMode
+	{
+		TransparencySorted = 0, // Back to front sorted draws
+		TransparencyOIT,        // Weighted blended order-independent transparency
+		TransparencyModeCount
+	};
 
 private:
 	HRESULT SetupBackBuffer();
+	HRESULT CreateRenderTarget(RenderFormat format, RenderResource** ppTexture);
+	void ReleaseBackBuffer();
 
 	HRESULT CreateTransparentObjects();
+	HRESULT CreateLights();
+	// Lights in use, known before they are created
+	UINT GetLightCount() const;
 	HRESULT CreateScene();
 	void DestroyScene();
+
+	// Per-frame CPU stages, run as jobs
+	void CullOpaqueObjects(const DirectX::XMFLOAT4X4& viewProj);
+	void ComputeVisibleMatrices();
+	void SortTransparentObjects(const DirectX::XMFLOAT4X4& view, float nearPlane, float farPlane);
+	void FillSceneBuffer(SceneBuffer& scb) const;
+
+	void AssignLights(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj, float nearPlane, float farPlane);
+	bool UploadLights();
+
 	void RenderScene();
+	void SetupRenderTargets(IRenderContext* pContext);
+	void SetupOpaqueState(IRenderContext* pContext);
+	void DrawOpaqueObjects(IRenderContext* pContext, UINT firstObject, UINT objectCount);
 	void RenderSceneTransparent();
+	void RenderTransparentSorted();
+	void RenderTransparentOIT();
+
+	HRESULT CreatePlaceholderTexture(UINT color, RenderResource** ppTexture);
+	HRESULT AddStreamedTexture(const char* fileName, UINT placeholderColor, RenderResource** ppTexture);
+	void QueueTextureLoad(StreamedTexture& texture, UINT residentMip);
+	void ProcessTextureLoads();
+	void UpdateTextureStreaming(const DirectX::XMFLOAT4X4& view, float focalPixels);
+
+	void AddObject(EntityId entity, const DirectX::XMFLOAT4& color, std::vector<SceneObject>& objects);
+
+	// Shaders are built in background, ones which are not needed yet are created once ready
+	bool LoadShaderSource(const char* shaderSource, std::string& source);
+	HRESULT QueueShaders();
+	ShaderBuilder::BuildId AddShaderBuild(const std::string& source, const char* fileName, const char* entryPoint, const char* profile, ShaderKey key, bool critical);
+	void AddPixelShaderBuilds(const std::string& source, const char* fileName, const char* entryPoint, const ShaderPermutations& permutations, std::vector<ShaderBuilder::BuildId>& builds);
+	bool ResolveShaders();
+	bool ResolveVertexShader(ShaderBuilder::BuildId& build, bool wait, RenderVertexShader** ppShader);
+	bool ResolvePixelShader(ShaderBuilder::BuildId& build, bool wait, RenderPixelShader** ppShader);
+
+	// Wait for the build and create shader from its bytecode, which the builder keeps for input layouts
+	RenderVertexShader* CreateVertexShader(ShaderBuilder::BuildId build);
+	RenderPixelShader*  CreatePixelShader(ShaderBuilder::BuildId build);
+	HRESULT CreateInputLayout(const RenderInputElement* pElements, UINT count, ShaderBuilder::BuildId build, RenderInputLayout** ppLayout);
 
-	ID3D11VertexShader* CreateVertexShader(LPCTSTR shaderSource, ID3DBlob** ppBlob);
-	ID3D11PixelShader*  CreatePixelShader(LPCTSTR shaderSource);
+	void ReleasePixelShaderVariants(std::vector<RenderPixelShader*>& shaders);
+	RenderPixelShader* GetPixelShaderVariant(const ShaderPermutations& permutations, const std::vector<RenderPixelShader*>& shaders, ShaderKey key) const;
+
+	// Recording of opaque draws on deferred contexts
+	virtual void BeginRecord(unsigned int chunkCount);
+	virtual bool RecordChunk(unsigned int worker, unsigned int chunk, unsigned int firstItem, unsigned int itemCount);
+	virtual void SubmitChunk(unsigned int chunk);
 
 private:
-	ID3D11Device* m_pDevice;
-	ID3D11DeviceContext* m_pContext;
+	IRenderDevice* m_pDevice;
+	IRenderContext* m_pContext; // Immediate context of the device
+
+	JobSystem m_jobs;
+
+	ShaderCache m_shaderCache;
+	ShaderBuilder m_shaderBuilder;
+
+	// Builds which are not turned into shaders yet are valid
+	ShaderBuilder::BuildId m_vertexShaderBuild;
+	ShaderBuilder::BuildId m_instancedVertexShaderBuild;
+	ShaderBuilder::BuildId m_transVertexShaderBuild;
+	ShaderBuilder::BuildId m_oitCompositeVertexShaderBuild;
+	ShaderBuilder::BuildId m_oitCompositePixelShaderBuild;
+	std::vector<ShaderBuilder::BuildId> m_pixelShaderBuilds;
+	std::vector<ShaderBuilder::BuildId> m_transPixelShaderBuilds;
+	UINT m_pendingShaderBuilds; // Builds left for ResolveShaders
+
+	ParallelRecorder m_recorder;
+	std::vector<IRenderContext*> m_deferredContexts; // One per recording worker
+	std::vector<RenderCommandList*> m_commandLists;  // One per chunk
+
+	RenderResource* m_pDepth;
+
+	RenderResource* m_pOITAccum;
+	RenderResource* m_pOITRevealage;
+
+	RenderResource* m_pVertexBuffer;
+	RenderResource* m_pIndexBuffer;
+	RenderVertexShader* m_pVertexShader;
+	ShaderPermutations m_pixelPermutations;
+	std::vector<RenderPixelShader*> m_pixelShaders; // One per variant
+	RenderInputLayout* m_pInputLayout;
+
+	RenderVertexShader* m_pInstancedVertexShader;
+	RenderInputLayout* m_pInstancedInputLayout;
+	RenderResource* m_pInstanceBuffer;
+
+	RenderResource* m_pTexture;
+	RenderResource* m_pTextureNM;
+
+	TextureArchive m_textureArchive;
+	TextureLoader m_textureLoader;
+	std::vector<TextureLoader::LoadId> m_completedLoads;
+
+	TextureStreamer m_textureStreamer;
+	std::vector<StreamedTexture> m_streamedTextures;
+	std::vector<UINT> m_streamedTextureIndices; // Index in m_streamedTextures by streamer texture id
+	std::vector<TextureStreamer::Change> m_textureChanges;
+	UINT m_textureIndex;
+	UINT m_textureNMIndex;
+
+	RenderSamplerState* m_pSamplerState;
 
-	IDXGISwapChain* m_pSwapChain;
-	ID3D11RenderTargetView* m_pBackBufferRTV;
+	RenderResource* m_pLightBuffer;
+	RenderResource* m_pClusterBuffer;
+	RenderResource* m_pLightIndexBuffer;
 
-	ID3D11Texture2D* m_pDepth;
-	ID3D11DepthStencilView* m_pDepthDSV;
+	ConstantBufferRing m_constantBuffers;
+	GpuProfiler m_gpuProfiler;
+	ConstantBufferRange m_sceneBuffer;
 
-	ID3D11Buffer* m_pVertexBuffer;
-	ID3D11Buffer* m_pIndexBuffer;
-	ID3D11VertexShader* m_pVertexShader;
-	ID3D11PixelShader* m_pPixelShader;
-	ID3D11InputLayout* m_pInputLayout;
+	RenderResource* m_pTransVertexBuffer;
+	RenderResource* m_pTransIndexBuffer;
+	RenderVertexShader* m_pTransVertexShader;
+	ShaderPermutations m_transPixelPermutations;
+	std::vector<RenderPixelShader*> m_transPixelShaders;
+	RenderInputLayout* m_pTransInputLayout;
+	RenderRasterizerState* m_pTransRasterizerState;
+	RenderBlendState* m_pTransBlendState;
+	RenderDepthStencilState* m_pTransDepthState;
 
-	ID3D11Resource* m_pTexture;
-	ID3D11ShaderResourceView* m_pTextureSRV;
+	RenderBlendState* m_pOITBlendState;
+	RenderVertexShader* m_pOITCompositeVertexShader;
+	RenderPixelShader* m_pOITCompositePixelShader;
 
-	ID3D11Resource* m_pTextureNM;
-	ID3D11ShaderResourceView* m_pTextureNMSRV;
+	RenderRasterizerState* m_pRasterizerState;
 
-	ID3D11SamplerState* m_pSamplerState;
+	TransformSystem m_transforms;
+	std::vector<SceneObject> m_opaqueObjects;
+	std::vector<SceneObject> m_transObjects;
+	std::vector<UINT> m_transKeys;
+	RadixSort m_transSort;
 
-	ID3D11Buffer* m_pModelBuffer;
-	ID3D11Buffer* m_pModelBuffer2;
-	ID3D11Buffer* m_pSceneBuffer;
+	BoundingVolumeHierarchy m_opaqueBVH;
+	std::vector<AABB> m_opaqueBoxes;
+	std::vector<UINT> m_visibleObjects; // Indices of opaque objects which passed culling
 
-	ID3D11Buffer* m_pModelBuffer3;
-	ID3D11Buffer* m_pModelBuffer4;
-	ID3D11Buffer* m_pTransVertexBuffer;
-	ID3D11Buffer* m_pTransIndexBuffer;
-	ID3D11VertexShader* m_pTransVertexShader;
-	ID3D11PixelShader* m_pTransPixelShader;
-	ID3D11InputLayout* m_pTransInputLayout;
-	ID3D11RasterizerState* m_pTransRasterizerState;
-	ID3D11BlendState* m_pTransBlendState;
-	ID3D11DepthStencilState* m_pTransDepthState;
+	std::vector<ClusterLight> m_lights;
+	LightClusters m_lightClusters;
 
-	ID3D11RasterizerState* m_pRasterizerState;
+	std::vector<DirectX::XMFLOAT4X4> m_worldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> m_modelMatrices;
+	std::vector<DirectX::XMFLOAT4X4> m_normalMatrices;
+	DirectX::XMFLOAT4X4 m_viewProjMatrix; // Of the current frame
 
 	UINT m_width;
 	UINT m_height;
 
 	size_t m_usec;
+	double m_animationTime; // Negative when the animation follows the clock
 
 	float m_lon;
 	float m_lat;
 	float m_dist;
 
 	int m_mode;
+	ShaderKey m_shaderKey; // Scene shader features of the current frame
+	bool m_instancing;
+	bool m_lightField;
+	TransparencyMode m_transparencyMode;
+	bool m_parallelRecording;
 };
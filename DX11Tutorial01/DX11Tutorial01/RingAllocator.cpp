@@ -0,0 +1,108 @@
+#include "RingAllocator.h"
+
+#include <assert.h>
+
+RingAllocator::RingAllocator()
+	: m_size(0)
+	, m_alignment(1)
+	, m_head(0)
+	, m_tail(0)
+	, m_used(0)
+	, m_total(0)
+{
+}
+
+void RingAllocator::Init(size_t size, size_t alignment)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+	assert(size % alignment == 0);
+
+	m_size = size;
+	m_alignment = alignment;
+
+	Reset();
+}
+
+void RingAllocator::Reset()
+{
+	m_head = 0;
+	m_tail = 0;
+	m_used = 0;
+	m_total = 0;
+
+	m_frames.clear();
+}
+
+size_t RingAllocator::Allocate(size_t size)
+{
+	size_t alignedSize = AlignSize(size);
+	if (alignedSize == 0 || alignedSize > m_size)
+	{
+		return InvalidOffset;
+	}
+
+	if (m_used == 0)
+	{
+		// Nothing in flight, so start from the beginning to avoid wasting space at wraparound
+		// Pending frames own no memory in this case, so they end at the new head too
+		m_head = 0;
+		m_tail = 0;
+		for (FrameMark& mark : m_frames)
+		{
+			mark.end = 0;
+		}
+	}
+
+	size_t offset = InvalidOffset;
+	size_t skipped = 0;
+	if (m_head > m_tail || m_used == 0)
+	{
+		// Free space is [head, size) and [0, tail)
+		if (m_head + alignedSize <= m_size)
+		{
+			offset = m_head;
+		}
+		else if (alignedSize <= m_tail)
+		{
+			skipped = m_size - m_head;
+			offset = 0;
+		}
+	}
+	else if (m_head + alignedSize <= m_tail)
+	{
+		// Free space is [head, tail)
+		offset = m_head;
+	}
+
+	if (offset == InvalidOffset)
+	{
+		return InvalidOffset;
+	}
+
+	m_head = offset + alignedSize;
+	m_used += skipped + alignedSize;
+	m_total += skipped + alignedSize;
+
+	return offset;
+}
+
+void RingAllocator::FinishFrame(uint64_t frameIndex)
+{
+	assert(m_frames.empty() || m_frames.back().frameIndex < frameIndex);
+
+	FrameMark mark = { frameIndex, m_head, m_total };
+	m_frames.push_back(mark);
+}
+
+void RingAllocator::ReleaseFrames(uint64_t completedFrame)
+{
+	while (!m_frames.empty() && m_frames.front().frameIndex <= completedFrame)
+	{
+		const FrameMark& mark = m_frames.front();
+
+		m_tail = mark.end;
+		m_used = (size_t)(m_total - mark.total);
+
+		m_frames.pop_front();
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+
+// Bookkeeping of a ring buffer shared by several frames in flight
+// Memory allocated during a frame is returned once that frame is known to be completed
+class RingAllocator
+{
+public:
+	static const size_t InvalidOffset = (size_t)-1;
+
+public:
+	RingAllocator();
+
+	// alignment must be a power of two, size must be a multiple of alignment
+	void Init(size_t size, size_t alignment);
+	void Reset();
+
+	// Returns offset of the allocated block or InvalidOffset if there is no room
+	size_t Allocate(size_t size);
+
+	// All allocations since the previous FinishFrame belong to frameIndex
+	void FinishFrame(uint64_t frameIndex);
+	// Return memory of all frames up to completedFrame inclusive
+	void ReleaseFrames(uint64_t completedFrame);
+
+	bool HasPendingFrames() const { return !m_frames.empty(); }
+	uint64_t GetOldestPendingFrame() const { return m_frames.front().frameIndex; }
+
+	size_t GetSize() const { return m_size; }
+	size_t GetUsedSize() const { return m_used; }
+
+private:
+	struct FrameMark
+	{
+		uint64_t frameIndex;
+		size_t end;   // Head position at the end of the frame
+		uint64_t total; // Total allocated bytes at the end of the frame
+	};
+
+	size_t AlignSize(size_t size) const { return (size + m_alignment - 1) & ~(m_alignment - 1); }
+
+private:
+	size_t m_size;
+	size_t m_alignment;
+
+	size_t m_head; // Next allocation starts here
+	size_t m_tail; // Oldest allocation in use starts here
+	size_t m_used; // Bytes in use, including space skipped at wraparound
+
+	uint64_t m_total; // Bytes ever allocated, including space skipped at wraparound
+
+	std::deque<FrameMark> m_frames;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include "Platform.h"
+
+// Vertex and constant buffer layouts of ColorShader.hlsl
+// Shared by the renderer and the software rasterizer, which implements the same shader on the CPU
+
+struct TextureVertex
+{
+	DirectX::XMVECTORF32 pos;
+	DirectX::XMFLOAT2 uv;
+	DirectX::XMFLOAT3 normal;
+	DirectX::XMFLOAT3 tangent;
+};
+
+// Matrices are stored transposed, as HLSL expects them
+struct ModelBuffer
+{
+	DirectX::XMMATRIX modelMatrix;
+	DirectX::XMMATRIX normalMatrix;
+	DirectX::XMVECTORF32 objColor;
+};
+
+struct SceneBuffer
+{
+	DirectX::XMMATRIX VP;
+	DirectX::XMVECTORI32 lightParams; // x - lights count
+	DirectX::XMFLOAT4 clusterParams;  // See LightClusters::GetShaderParams
+};
+
+// Unit cube centered at the origin, faces are clockwise when seen from outside
+static const UINT CubeVertexCount = 24;
+static const UINT CubeIndexCount = 36;
+
+extern const TextureVertex CubeVertices[CubeVertexCount];
+extern const UINT16 CubeIndices[CubeIndexCount];
@@ -0,0 +1,224 @@
+#include "ShaderBuilder.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "Profiler.h"
+
+ShaderBuilder::ShaderBuilder()
+	: m_pCache(NULL)
+	, m_pCompiler(NULL)
+	, m_nextBuild(0)
+{
+}
+
+ShaderBuilder::~ShaderBuilder()
+{
+	Term();
+}
+
+ShaderBuilder::BuildId ShaderBuilder::Add(const ShaderRequest& request, const std::string& name, bool critical)
+{
+	assert(m_threads.empty());
+
+	std::unique_ptr<Build> build(new Build());
+	build->request = request;
+	build->name = name;
+	build->critical = critical;
+	build->done = false;
+	build->succeeded = false;
+	build->timing = Timing{ 0, 0, 0, false };
+
+	m_builds.push_back(std::move(build));
+	return (BuildId)m_builds.size() - 1;
+}
+
+void ShaderBuilder::Start(ShaderCache* pCache, IShaderCompiler* pCompiler, unsigned int threadCount)
+{
+	assert(m_threads.empty());
+
+	m_pCache = pCache;
+	m_pCompiler = pCompiler;
+	m_startTime = std::chrono::steady_clock::now();
+
+	m_order.clear();
+	for (BuildId id = 0; id < m_builds.size(); id++)
+	{
+		m_order.push_back(id);
+	}
+	std::stable_sort(m_order.begin(), m_order.end(), [this](BuildId a, BuildId b) { return m_builds[a]->critical && !m_builds[b]->critical; });
+	m_nextBuild = 0;
+
+	// No more threads than builds
+	threadCount = std::max(1u, std::min(threadCount, (unsigned int)m_builds.size()));
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		m_threads.push_back(std::thread(&ShaderBuilder::WorkerLoop, this, i));
+	}
+}
+
+void ShaderBuilder::Term()
+{
+	// Threads leave when there are no builds left
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+	m_threads.clear();
+
+	m_builds.clear();
+	m_order.clear();
+	m_nextBuild = 0;
+}
+
+bool ShaderBuilder::IsDone(BuildId id) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_builds[id]->done;
+}
+
+bool ShaderBuilder::Wait(BuildId id)
+{
+	assert(!m_threads.empty());
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	const Build& build = *m_builds[id];
+	m_buildDone.wait(lock, [&build] { return build.done; });
+
+	return build.succeeded;
+}
+
+bool ShaderBuilder::WaitAll()
+{
+	bool succeeded = true;
+	for (BuildId id = 0; id < m_builds.size(); id++)
+	{
+		succeeded = Wait(id) && succeeded;
+	}
+	return succeeded;
+}
+
+const std::vector<uint8_t>& ShaderBuilder::GetBytecode(BuildId id) const
+{
+	assert(IsDone(id));
+	return m_builds[id]->bytecode;
+}
+
+const std::string& ShaderBuilder::GetErrors(BuildId id) const
+{
+	assert(IsDone(id));
+	return m_builds[id]->errors;
+}
+
+const ShaderBuilder::Timing& ShaderBuilder::GetTiming(BuildId id) const
+{
+	assert(IsDone(id));
+	return m_builds[id]->timing;
+}
+
+double ShaderBuilder::GetCriticalPathMs() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	double criticalMs = 0;
+	for (const std::unique_ptr<Build>& build : m_builds)
+	{
+		if (build->critical && build->done)
+		{
+			criticalMs = std::max(criticalMs, build->timing.endMs);
+		}
+	}
+	return criticalMs;
+}
+
+std::string ShaderBuilder::GetReport() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::string report = "   start      end  thread  source    name\n";
+	unsigned int compiled = 0;
+	unsigned int cached = 0;
+	double criticalMs = 0;
+	double totalMs = 0;
+	for (BuildId id : m_order)
+	{
+		const Build& build = *m_builds[id];
+		if (!build.done)
+		{
+			continue;
+		}
+
+		char line[512];
+		snprintf(line, sizeof(line), "%8.2f %8.2f  %6u  %-8s %c %s%s\n", build.timing.startMs, build.timing.endMs, build.timing.thread,
+			build.timing.cached ? "cache" : "compile", build.critical ? '*' : ' ', build.name.c_str(), build.succeeded ? "" : " FAILED");
+		report += line;
+
+		if (build.timing.cached)
+		{
+			cached++;
+		}
+		else
+		{
+			compiled++;
+		}
+		totalMs = std::max(totalMs, build.timing.endMs);
+		if (build.critical)
+		{
+			criticalMs = std::max(criticalMs, build.timing.endMs);
+		}
+	}
+
+	char summary[256];
+	snprintf(summary, sizeof(summary), "%u compiled, %u from cache, critical path %.2f ms, all builds %.2f ms (* - critical)\n",
+		compiled, cached, criticalMs, totalMs);
+	report += summary;
+
+	return report;
+}
+
+void ShaderBuilder::WorkerLoop(unsigned int thread)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "Shader builder %u", thread);
+	Profiler::SetThreadName(name);
+
+	for (;;)
+	{
+		Build* pBuild = NULL;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_nextBuild == m_order.size())
+			{
+				return;
+			}
+			pBuild = m_builds[m_order[m_nextBuild++]].get();
+		}
+
+		PROFILE_SCOPE("Shader build");
+
+		// Build is owned by this thread until it is marked done
+		std::vector<uint8_t> bytecode;
+		std::string errors;
+		bool cached = false;
+		double startMs = GetElapsedMs();
+		bool succeeded = m_pCache->GetBytecode(pBuild->request, m_pCompiler, bytecode, &errors, &cached);
+		double endMs = GetElapsedMs();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			pBuild->bytecode.swap(bytecode);
+			pBuild->errors.swap(errors);
+			pBuild->succeeded = succeeded;
+			pBuild->timing = Timing{ startMs, endMs, thread, cached };
+			pBuild->done = true;
+		}
+		m_buildDone.notify_all();
+	}
+}
+
+double ShaderBuilder::GetElapsedMs() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startTime).count();
+}
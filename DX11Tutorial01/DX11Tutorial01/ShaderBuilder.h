@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ShaderCache.h"
+
+// Compiles shaders through the cache on a pool of threads
+// All builds are added before Start, critical ones are started first
+class ShaderBuilder
+{
+public:
+	typedef unsigned int BuildId;
+	static const BuildId InvalidBuildId = ~0u;
+
+	// Times are in milliseconds since Start
+	struct Timing
+	{
+		double startMs;
+		double endMs;
+		unsigned int thread;
+		bool cached;
+	};
+
+	ShaderBuilder();
+	~ShaderBuilder();
+
+	BuildId Add(const ShaderRequest& request, const std::string& name, bool critical);
+	void Start(ShaderCache* pCache, IShaderCompiler* pCompiler, unsigned int threadCount);
+	// Waits for all builds and stops threads, builds are forgotten
+	void Term();
+
+	bool IsDone(BuildId id) const;
+	// Returns false if the build failed, errors are in GetErrors
+	bool Wait(BuildId id);
+	// Returns false if any build failed
+	bool WaitAll();
+
+	// Valid once the build is done
+	const std::vector<uint8_t>& GetBytecode(BuildId id) const;
+	const std::string& GetErrors(BuildId id) const;
+	const Timing& GetTiming(BuildId id) const;
+
+	// Time when the last critical build finished
+	double GetCriticalPathMs() const;
+	// One line per finished build in start order and a summary
+	std::string GetReport() const;
+
+private:
+	struct Build
+	{
+		ShaderRequest request;
+		std::string name;
+		bool critical;
+
+		bool done;
+		bool succeeded;
+		std::vector<uint8_t> bytecode;
+		std::string errors;
+		Timing timing;
+	};
+
+	void WorkerLoop(unsigned int thread);
+	double GetElapsedMs() const;
+
+private:
+	std::vector<std::unique_ptr<Build>> m_builds;
+	std::vector<BuildId> m_order; // Critical builds first
+
+	ShaderCache* m_pCache;
+	IShaderCompiler* m_pCompiler;
+	std::vector<std::thread> m_threads;
+	std::chrono::steady_clock::time_point m_startTime;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_buildDone;
+	size_t m_nextBuild;
+};
@@ -0,0 +1,492 @@
+#include "ShaderCache.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static const uint32_t EntryMagic = 0x31434853; // "SHC1"
+static const char* IndexFileName = "index.txt";
+static const char* EntryExtension = ".cso";
+static const char* TempExtension = ".tmp";
+// Temporary files younger than this may still be written by another process sharing the directory
+static const std::chrono::minutes StaleTempAge(10);
+
+static const uint64_t FNVOffset = 14695981039346656037ull;
+static const uint64_t FNVPrime = 1099511628211ull;
+
+struct EntryHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint64_t size;
+	uint64_t checksum;
+};
+
+static uint64_t HashBytes(uint64_t hash, const void* pData, size_t size)
+{
+	const uint8_t* pBytes = (const uint8_t*)pData;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ pBytes[i]) * FNVPrime;
+	}
+	return hash;
+}
+
+// Terminating zero is hashed too, so that field boundaries are part of the key
+static uint64_t HashString(uint64_t hash, const std::string& str)
+{
+	return HashBytes(hash, str.c_str(), str.size() + 1);
+}
+
+uint64_t HashShaderRequest(const ShaderRequest& request)
+{
+	uint32_t version = ShaderCache::Version;
+	uint64_t hash = FNVOffset;
+	hash = HashBytes(hash, &version, sizeof(version));
+	hash = HashString(hash, request.source);
+	hash = HashString(hash, request.entryPoint);
+	hash = HashString(hash, request.profile);
+	hash = HashBytes(hash, &request.flags, sizeof(request.flags));
+
+	uint32_t defineCount = (uint32_t)request.defines.size();
+	hash = HashBytes(hash, &defineCount, sizeof(defineCount));
+	for (const ShaderDefine& define : request.defines)
+	{
+		hash = HashString(hash, define.name);
+		hash = HashString(hash, define.value);
+	}
+
+	return hash;
+}
+
+StubShaderCompiler::StubShaderCompiler(unsigned int delayMs)
+	: m_delayMs(delayMs)
+	, m_compileCount(0)
+{
+}
+
+bool StubShaderCompiler::Compile(const ShaderRequest& request, std::vector<uint8_t>& bytecode, std::string& errors)
+{
+	m_compileCount++;
+
+	if (m_delayMs != 0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(m_delayMs));
+	}
+
+	if (request.source.find(request.entryPoint) == std::string::npos)
+	{
+		errors = "error: entry point '" + request.entryPoint + "' not found\n";
+		return false;
+	}
+
+	// Bytecode is the key followed by entry point and profile, so different requests never give the same blob
+	uint64_t key = HashShaderRequest(request);
+	std::string text = request.entryPoint + " " + request.profile;
+
+	bytecode.resize(sizeof(key) + text.size());
+	memcpy(bytecode.data(), &key, sizeof(key));
+	memcpy(bytecode.data() + sizeof(key), text.data(), text.size());
+
+	return true;
+}
+
+ShaderCache::ShaderCache()
+	: m_maxSize(0)
+	, m_totalSize(0)
+	, m_useCounter(0)
+	, m_indexDirty(false)
+	, m_hitCount(0)
+	, m_missCount(0)
+{
+}
+
+ShaderCache::~ShaderCache()
+{
+	Term();
+}
+
+bool ShaderCache::Init(const std::string& directory, uint64_t maxSize)
+{
+	assert(m_directory.empty());
+
+	std::error_code error;
+	fs::create_directories(directory, error);
+	if (!fs::is_directory(directory, error))
+	{
+		return false;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_directory = directory;
+	m_maxSize = maxSize;
+	m_hitCount = 0;
+	m_missCount = 0;
+
+	if (!LoadIndex())
+	{
+		// Start from scratch, entry files which read back are taken in again below
+		m_entries.clear();
+		m_useCounter = 0;
+	}
+
+	// Drop entries which lost their files
+	uint64_t totalSize = 0;
+	for (auto it = m_entries.begin(); it != m_entries.end();)
+	{
+		uint64_t fileSize = fs::file_size(GetEntryPath(it->first), error);
+		if (error || fileSize != sizeof(EntryHeader) + it->second.size)
+		{
+			fs::remove(GetEntryPath(it->first), error);
+			it = m_entries.erase(it);
+			m_indexDirty = true;
+		}
+		else
+		{
+			totalSize += it->second.size;
+			++it;
+		}
+	}
+	m_totalSize = totalSize;
+
+	// Other processes may share the directory, so only stale temporary files are removed
+	// and complete entries the index does not know about are taken into it as least recently used
+	const fs::file_time_type staleTime = fs::file_time_type::clock::now() - StaleTempAge;
+	std::vector<uint8_t> bytecode;
+	for (const fs::directory_entry& file : fs::directory_iterator(m_directory, error))
+	{
+		fs::path path = file.path();
+		if (path.extension() == TempExtension)
+		{
+			fs::file_time_type writeTime = fs::last_write_time(path, error);
+			if (!error && writeTime < staleTime)
+			{
+				fs::remove(path, error);
+			}
+		}
+		else if (path.extension() == EntryExtension)
+		{
+			uint64_t key = strtoull(path.stem().string().c_str(), NULL, 16);
+			if (m_entries.find(key) != m_entries.end() && GetEntryPath(key) == path.string())
+			{
+				continue;
+			}
+
+			// Entries are renamed into place whole, one which does not read back is damaged
+			if (GetEntryPath(key) == path.string() && ReadEntry(key, bytecode))
+			{
+				Entry entry = { bytecode.size(), 0 };
+				m_entries[key] = entry;
+				m_totalSize += entry.size;
+				m_indexDirty = true;
+			}
+			else
+			{
+				fs::remove(path, error);
+			}
+		}
+	}
+
+	// Budget could be lowered since the last run
+	Evict(0);
+	lock.unlock();
+
+	SaveIndex();
+
+	return true;
+}
+
+void ShaderCache::Term()
+{
+	SaveIndex();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_directory.clear();
+	m_entries.clear();
+	m_totalSize = 0;
+}
+
+bool ShaderCache::GetBytecode(const ShaderRequest& request, IShaderCompiler* pCompiler, std::vector<uint8_t>& bytecode, std::string* pErrors, bool* pCached)
+{
+	uint64_t key = HashShaderRequest(request);
+
+	// File is read without lock, an entry evicted meanwhile is just a miss
+	bool indexed = false;
+	uint64_t size = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(key);
+		if (!m_directory.empty() && it != m_entries.end())
+		{
+			indexed = true;
+			size = it->second.size;
+		}
+	}
+
+	bool cached = indexed && ReadEntry(key, bytecode) && bytecode.size() == size;
+	if (indexed)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(key);
+		if (cached && it != m_entries.end())
+		{
+			it->second.lastUse = ++m_useCounter;
+			m_indexDirty = true;
+		}
+		else if (!cached && !m_directory.empty())
+		{
+			// Damaged entry is compiled again
+			RemoveEntry(key);
+		}
+	}
+
+	if (pCached != NULL)
+	{
+		*pCached = cached;
+	}
+	if (cached)
+	{
+		m_hitCount++;
+		return true;
+	}
+	m_missCount++;
+
+	std::string errors;
+	if (!pCompiler->Compile(request, bytecode, errors))
+	{
+		if (pErrors != NULL)
+		{
+			*pErrors = errors;
+		}
+		return false;
+	}
+
+	// Entry file is written without lock, a concurrent miss of the same request renames the same content over it
+	bool store = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		store = !m_directory.empty() && m_entries.find(key) == m_entries.end();
+	}
+	if (!store || !WriteEntry(key, bytecode))
+	{
+		return true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_directory.empty() || m_entries.find(key) != m_entries.end())
+		{
+			return true;
+		}
+
+		Entry entry = { bytecode.size(), ++m_useCounter };
+		m_entries[key] = entry;
+		m_totalSize += entry.size;
+		m_indexDirty = true;
+
+		Evict(key);
+	}
+
+	// Index is saved on every new entry, so a crash loses at most recency of hits
+	SaveIndex();
+
+	return true;
+}
+
+std::string ShaderCache::GetEntryPath(uint64_t key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+
+	return (fs::path(m_directory) / (std::string(name) + EntryExtension)).string();
+}
+
+bool ShaderCache::ReadEntry(uint64_t key, std::vector<uint8_t>& bytecode) const
+{
+	std::ifstream file(GetEntryPath(key), std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	EntryHeader header;
+	if (!file.read((char*)&header, sizeof(header))
+		|| header.magic != EntryMagic || header.version != Version || header.key != key)
+	{
+		return false;
+	}
+
+	bytecode.resize((size_t)header.size);
+	if (header.size != 0 && !file.read((char*)bytecode.data(), header.size))
+	{
+		return false;
+	}
+
+	return HashBytes(FNVOffset, bytecode.data(), bytecode.size()) == header.checksum;
+}
+
+bool ShaderCache::WriteEntry(uint64_t key, const std::vector<uint8_t>& bytecode) const
+{
+	EntryHeader header;
+	header.magic = EntryMagic;
+	header.version = Version;
+	header.key = key;
+	header.size = bytecode.size();
+	header.checksum = HashBytes(FNVOffset, bytecode.data(), bytecode.size());
+
+	std::string data((const char*)&header, sizeof(header));
+	data.append((const char*)bytecode.data(), bytecode.size());
+
+	return WriteFileAtomic(GetEntryPath(key), data);
+}
+
+bool ShaderCache::WriteFileAtomic(const std::string& path, const std::string& data) const
+{
+	// Temporary name is unique per process, thread and write, other processes may share the directory
+	static std::atomic<unsigned int> writeCounter(0);
+	std::ostringstream tempPath;
+	tempPath << path << "." << getpid() << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << "." << writeCounter++ << TempExtension;
+
+	{
+		std::ofstream file(tempPath.str(), std::ios::binary | std::ios::trunc);
+		if (!file.write(data.data(), data.size()) || !file.flush())
+		{
+			file.close();
+			std::error_code error;
+			fs::remove(tempPath.str(), error);
+			return false;
+		}
+	}
+
+	// Rename replaces the old file in one step, readers see either the old or the new one
+	std::error_code error;
+	fs::rename(tempPath.str(), path, error);
+	if (error)
+	{
+		fs::remove(tempPath.str(), error);
+		return false;
+	}
+
+	return true;
+}
+
+bool ShaderCache::LoadIndex()
+{
+	std::ifstream file((fs::path(m_directory) / IndexFileName).string());
+	if (!file)
+	{
+		return false;
+	}
+
+	std::string magic;
+	uint32_t version = 0;
+	if (!(file >> magic >> version >> m_useCounter) || magic != "ShaderCache" || version != Version)
+	{
+		return false;
+	}
+
+	std::string keyText;
+	Entry entry;
+	while (file >> keyText >> entry.size >> entry.lastUse)
+	{
+		m_entries[strtoull(keyText.c_str(), NULL, 16)] = entry;
+		m_useCounter = std::max(m_useCounter, entry.lastUse);
+	}
+
+	return file.eof();
+}
+
+bool ShaderCache::SaveIndex()
+{
+	// Index is formatted under the lock and written without it, saves are serialized
+	// so that an older index never replaces a newer one
+	std::lock_guard<std::mutex> indexLock(m_indexMutex);
+
+	std::string path;
+	std::ostringstream index;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_directory.empty() || !m_indexDirty)
+		{
+			return true;
+		}
+
+		path = (fs::path(m_directory) / IndexFileName).string();
+		index << "ShaderCache " << Version << " " << m_useCounter << "\n";
+
+		char key[32];
+		for (const auto& item : m_entries)
+		{
+			snprintf(key, sizeof(key), "%016llx", (unsigned long long)item.first);
+			index << key << " " << item.second.size << " " << item.second.lastUse << "\n";
+		}
+		m_indexDirty = false;
+	}
+
+	bool saved = WriteFileAtomic(path, index.str());
+	if (!saved)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_indexDirty = true;
+	}
+	return saved;
+}
+
+void ShaderCache::RemoveEntry(uint64_t key)
+{
+	auto it = m_entries.find(key);
+	if (it != m_entries.end())
+	{
+		m_totalSize -= it->second.size;
+		m_entries.erase(it);
+		m_indexDirty = true;
+	}
+
+	std::error_code error;
+	fs::remove(GetEntryPath(key), error);
+}
+
+void ShaderCache::Evict(uint64_t keepKey)
+{
+	if (m_totalSize <= m_maxSize)
+	{
+		return;
+	}
+
+	// Oldest first
+	std::vector<std::pair<uint64_t, uint64_t>> byUse;
+	byUse.reserve(m_entries.size());
+	for (const auto& item : m_entries)
+	{
+		byUse.push_back(std::make_pair(item.second.lastUse, item.first));
+	}
+	std::sort(byUse.begin(), byUse.end());
+
+	for (size_t i = 0; i < byUse.size() && m_totalSize > m_maxSize; i++)
+	{
+		if (byUse[i].second != keepKey)
+		{
+			RemoveEntry(byUse[i].second);
+		}
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ShaderDefine
+{
+	std::string name;
+	std::string value;
+};
+
+// Everything which affects compiled bytecode
+struct ShaderRequest
+{
+	std::string source; // Full source text, so includes have to be expanded by the caller
+	std::string entryPoint;
+	std::string profile;
+	std::vector<ShaderDefine> defines;
+	unsigned int flags; // Compiler flags
+};
+
+class IShaderCompiler
+{
+public:
+	virtual ~IShaderCompiler() {}
+
+	// May be called from several threads at once
+	virtual bool Compile(const ShaderRequest& request, std::vector<uint8_t>& bytecode, std::string& errors) = 0;
+};
+
+// Compiler which makes up bytecode from the request, to use the cache without a device
+// Fails if the entry point is not found in the source, delay imitates compilation time
+class StubShaderCompiler : public IShaderCompiler
+{
+public:
+	StubShaderCompiler(unsigned int delayMs = 0);
+
+	virtual bool Compile(const ShaderRequest& request, std::vector<uint8_t>& bytecode, std::string& errors);
+
+	unsigned int GetCompileCount() const { return m_compileCount; }
+
+private:
+	unsigned int m_delayMs;
+	std::atomic<unsigned int> m_compileCount;
+};
+
+// 64-bit FNV-1a hash of all request fields
+uint64_t HashShaderRequest(const ShaderRequest& request);
+
+// Content addressed cache of compiled shaders on disk
+// Entry files and index are written to temporary files and renamed, so a crash never leaves a partial entry
+// Least recently used entries are evicted when the cache grows over its size budget
+class ShaderCache
+{
+public:
+	static const uint32_t Version = 1;
+
+	ShaderCache();
+	~ShaderCache();
+
+	// Loads index, takes in entries other processes added to the directory and removes damaged files
+	// Cache passes requests to the compiler if it fails
+	bool Init(const std::string& directory, uint64_t maxSize);
+	// Saves index
+	void Term();
+
+	// Thread safe, compiler is called without lock, so concurrent misses of the same request compile twice
+	// pCached tells whether bytecode came from the cache
+	bool GetBytecode(const ShaderRequest& request, IShaderCompiler* pCompiler, std::vector<uint8_t>& bytecode, std::string* pErrors = NULL, bool* pCached = NULL);
+
+	unsigned int GetHitCount() const { return m_hitCount; }
+	unsigned int GetMissCount() const { return m_missCount; }
+	uint64_t GetTotalSize() const { return m_totalSize; }
+
+private:
+	struct Entry
+	{
+		uint64_t size;
+		uint64_t lastUse;
+	};
+
+	std::string GetEntryPath(uint64_t key) const;
+	bool ReadEntry(uint64_t key, std::vector<uint8_t>& bytecode) const;
+	bool WriteEntry(uint64_t key, const std::vector<uint8_t>& bytecode) const;
+	bool WriteFileAtomic(const std::string& path, const std::string& data) const;
+
+	bool LoadIndex();
+	// Writes the index if it changed, takes the mutex itself
+	bool SaveIndex();
+	// Following functions expect the mutex to be locked
+	void RemoveEntry(uint64_t key);
+	void Evict(uint64_t keepKey);
+
+private:
+	std::string m_directory; // Empty if cache is not available
+	uint64_t m_maxSize;
+
+	std::mutex m_mutex;
+	std::mutex m_indexMutex; // Held while the index is saved, taken before m_mutex
+	std::unordered_map<uint64_t, Entry> m_entries;
+	std::atomic<uint64_t> m_totalSize;
+	uint64_t m_useCounter;
+	bool m_indexDirty;
+
+	std::atomic<unsigned int> m_hitCount;
+	std::atomic<unsigned int> m_missCount;
+};
@@ -0,0 +1,70 @@
+#include "ShaderPermutations.h"
+
+#include <assert.h>
+
+static const unsigned int InvalidVariant = ~0u;
+
+ShaderLightBucket GetShaderLightBucket(unsigned int lightCount)
+{
+	return lightCount <= MaxDirectLights ? SHADER_LIGHTS_DIRECT : SHADER_LIGHTS_CLUSTERED;
+}
+
+ShaderKey MakeShaderKey(unsigned int features, ShaderLightBucket lightBucket)
+{
+	return (features & ~SHADER_FEATURE_LIGHT_BUCKET) | ((ShaderKey)lightBucket << ShaderLightBucketShift);
+}
+
+static ShaderLightBucket GetKeyLightBucket(ShaderKey key)
+{
+	return (ShaderLightBucket)((key & SHADER_FEATURE_LIGHT_BUCKET) >> ShaderLightBucketShift);
+}
+
+void GetShaderDefines(ShaderKey key, std::vector<ShaderDefine>& defines)
+{
+	ShaderLightBucket lightBucket = GetKeyLightBucket(key);
+
+	defines.clear();
+	defines.push_back(ShaderDefine{ "NORMAL_MAP", (key & SHADER_FEATURE_NORMAL_MAP) ? "1" : "0" });
+	defines.push_back(ShaderDefine{ "OIT", (key & SHADER_FEATURE_OIT) ? "1" : "0" });
+	defines.push_back(ShaderDefine{ "LIGHTS_CLUSTERED", lightBucket == SHADER_LIGHTS_CLUSTERED ? "1" : "0" });
+	defines.push_back(ShaderDefine{ "MAX_DIRECT_LIGHTS", std::to_string(MaxDirectLights) });
+}
+
+ShaderPermutations::ShaderPermutations()
+	: m_supportedFeatures(0)
+{
+}
+
+void ShaderPermutations::Init(ShaderKey supportedFeatures)
+{
+	m_supportedFeatures = supportedFeatures;
+	m_keys.clear();
+	m_indices.assign(supportedFeatures + 1, InvalidVariant);
+
+	// Every subset of supported bits, in increasing order
+	ShaderKey key = 0;
+	for (;;)
+	{
+		if (GetKeyLightBucket(key) < SHADER_LIGHT_BUCKET_COUNT)
+		{
+			m_indices[key] = (unsigned int)m_keys.size();
+			m_keys.push_back(key);
+		}
+
+		if (key == supportedFeatures)
+		{
+			break;
+		}
+		key = (key - supportedFeatures) & supportedFeatures;
+	}
+}
+
+unsigned int ShaderPermutations::GetVariantIndex(ShaderKey key) const
+{
+	key &= m_supportedFeatures;
+
+	unsigned int variant = m_indices[key];
+	assert(variant != InvalidVariant);
+
+	return variant;
+}
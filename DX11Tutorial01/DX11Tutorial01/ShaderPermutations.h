@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+#include "ShaderCache.h"
+
+// Feature bits of a shader variant
+enum ShaderFeatureFlags
+{
+	SHADER_FEATURE_NORMAL_MAP = 0x1,      // Tangent space normal mapping
+	SHADER_FEATURE_OIT = 0x2,             // Transparency writes weighted blended OIT targets instead of blended color
+	SHADER_FEATURE_LIGHT_BUCKET = 0xC     // Light count bucket, see ShaderLightBucket
+};
+
+static const unsigned int ShaderLightBucketShift = 2;
+
+enum ShaderLightBucket
+{
+	SHADER_LIGHTS_DIRECT = 0,    // Up to MaxDirectLights lights, each pixel loops over all of them
+	SHADER_LIGHTS_CLUSTERED = 1, // Any light count, pixels loop over their cluster light lists
+	SHADER_LIGHT_BUCKET_COUNT
+};
+
+static const unsigned int MaxDirectLights = 8;
+
+typedef unsigned int ShaderKey;
+
+ShaderLightBucket GetShaderLightBucket(unsigned int lightCount);
+ShaderKey MakeShaderKey(unsigned int features, ShaderLightBucket lightBucket);
+
+// All feature macros are defined to 0 or 1, in a fixed order so that equal keys give equal cache keys
+void GetShaderDefines(ShaderKey key, std::vector<ShaderDefine>& defines);
+
+// Bookkeeping for variants of one shader entry point
+// Variants are all valid combinations of the supported features, numbered densely from 0
+class ShaderPermutations
+{
+public:
+	ShaderPermutations();
+
+	void Init(ShaderKey supportedFeatures);
+
+	ShaderKey GetSupportedFeatures() const { return m_supportedFeatures; }
+	unsigned int GetVariantCount() const { return (unsigned int)m_keys.size(); }
+	ShaderKey GetVariantKey(unsigned int variant) const { return m_keys[variant]; }
+
+	// Features the shader does not support are ignored
+	unsigned int GetVariantIndex(ShaderKey key) const;
+
+private:
+	ShaderKey m_supportedFeatures;
+	std::vector<ShaderKey> m_keys;
+	std::vector<unsigned int> m_indices; // Variant index by key, for keys within supported features
+};
@@ -0,0 +1,936 @@
+#include "SoftwareRasterizer.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "JobSystem.h"
+#include "Profiler.h"
+
+// SOFTWARE_RASTERIZER_NO_SIMD builds the scalar lanes only, it gives the same pixels
+#if (defined(_M_X64) || defined(__SSE2__)) && !defined(SOFTWARE_RASTERIZER_NO_SIMD)
+#define SOFTWARE_RASTERIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace DirectX;
+
+static const int SubpixelBits = 4;
+static const int SubpixelScale = 1 << SubpixelBits;
+// Clip space x and y are clipped to this many times w, which bounds snapped coordinates
+static const float GuardBand = 2.0f;
+// Edge function values beyond this do not change sign within a tile
+static const int32_t EdgeTrivialLimit = 1 << 29;
+static const unsigned int MaxClipVertices = 9;
+static const unsigned int AttributeCount = 11;
+static const unsigned int PlaneCount = 13; // Depth, attributes divided by w, 1/w
+
+// Four lanes, one per pixel of a 2x2 quad: (x, y), (x + 1, y), (x, y + 1), (x + 1, y + 1)
+// Masks are 4 bits, lane 0 in bit 0
+#ifdef SOFTWARE_RASTERIZER_SSE2
+
+struct Float4
+{
+	__m128 v;
+};
+
+struct Int4
+{
+	__m128i v;
+};
+
+static inline Float4 Splat(float value) { return { _mm_set1_ps(value) }; }
+static inline Float4 Set(float x, float y, float z, float w) { return { _mm_setr_ps(x, y, z, w) }; }
+static inline void Store(Float4 a, float* pValues) { _mm_storeu_ps(pValues, a.v); }
+
+static inline Float4 operator+(Float4 a, Float4 b) { return { _mm_add_ps(a.v, b.v) }; }
+static inline Float4 operator-(Float4 a, Float4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+static inline Float4 operator*(Float4 a, Float4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+static inline Float4 operator/(Float4 a, Float4 b) { return { _mm_div_ps(a.v, b.v) }; }
+static inline Float4 Min(Float4 a, Float4 b) { return { _mm_min_ps(a.v, b.v) }; }
+static inline Float4 Max(Float4 a, Float4 b) { return { _mm_max_ps(a.v, b.v) }; }
+static inline Float4 Sqrt(Float4 a) { return { _mm_sqrt_ps(a.v) }; }
+static inline int LessMask(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+
+static inline Int4 SplatInt(int32_t value) { return { _mm_set1_epi32(value) }; }
+static inline Int4 SetInt(int32_t x, int32_t y, int32_t z, int32_t w) { return { _mm_setr_epi32(x, y, z, w) }; }
+static inline Int4 operator+(Int4 a, Int4 b) { return { _mm_add_epi32(a.v, b.v) }; }
+// a >= b, as a > b - 1, b is never the smallest int
+static inline int GreaterEqualMask(Int4 a, Int4 b) { return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(a.v, _mm_sub_epi32(b.v, _mm_set1_epi32(1))))); }
+
+// RGBA8 texel to one channel per lane, 0 to 255
+static inline Float4 UnpackTexel(uint32_t texel)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i bytes = _mm_cvtsi32_si128((int)texel);
+	return { _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero)) };
+}
+
+#else
+
+struct Float4
+{
+	float v[4];
+};
+
+struct Int4
+{
+	int32_t v[4];
+};
+
+static inline Float4 Splat(float value) { return { { value, value, value, value } }; }
+static inline Float4 Set(float x, float y, float z, float w) { return { { x, y, z, w } }; }
+static inline void Store(Float4 a, float* pValues) { memcpy(pValues, a.v, sizeof(a.v)); }
+
+static inline Float4 operator+(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] + b.v[i]; return r; }
+static inline Float4 operator-(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] - b.v[i]; return r; }
+static inline Float4 operator*(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] * b.v[i]; return r; }
+static inline Float4 operator/(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] / b.v[i]; return r; }
+static inline Float4 Min(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = b.v[i] < a.v[i] ? b.v[i] : a.v[i]; return r; }
+static inline Float4 Max(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = b.v[i] > a.v[i] ? b.v[i] : a.v[i]; return r; }
+static inline Float4 Sqrt(Float4 a) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = sqrtf(a.v[i]); return r; }
+static inline int LessMask(Float4 a, Float4 b) { int mask = 0; for (int i = 0; i < 4; i++) mask |= (a.v[i] < b.v[i] ? 1 : 0) << i; return mask; }
+
+static inline Int4 SplatInt(int32_t value) { return { { value, value, value, value } }; }
+static inline Int4 SetInt(int32_t x, int32_t y, int32_t z, int32_t w) { return { { x, y, z, w } }; }
+static inline Int4 operator+(Int4 a, Int4 b) { Int4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] + b.v[i]; return r; }
+static inline int GreaterEqualMask(Int4 a, Int4 b) { int mask = 0; for (int i = 0; i < 4; i++) mask |= (a.v[i] >= b.v[i] ? 1 : 0) << i; return mask; }
+
+static inline Float4 UnpackTexel(uint32_t texel) { return { { (float)(texel & 0xff), (float)((texel >> 8) & 0xff), (float)((texel >> 16) & 0xff), (float)(texel >> 24) } }; }
+
+#endif
+
+static inline Float4 Dot(const Float4 a[3], const Float4 b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline unsigned int CountLanes(int mask)
+{
+	return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+}
+
+static inline uint8_t ToUnorm8(float value)
+{
+	value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	return (uint8_t)(value * 255.0f + 0.5f);
+}
+
+static inline uint32_t PackColor(float r, float g, float b, float a)
+{
+	return (uint32_t)ToUnorm8(r) | ((uint32_t)ToUnorm8(g) << 8) | ((uint32_t)ToUnorm8(b) << 16) | ((uint32_t)ToUnorm8(a) << 24);
+}
+
+static inline Float4 Lerp(Float4 a, Float4 b, Float4 t)
+{
+	return a + (b - a) * t;
+}
+
+static inline int FloorToInt(float value)
+{
+	int truncated = (int)value;
+	return truncated - (value < (float)truncated ? 1 : 0);
+}
+
+static inline unsigned int WrapCoord(int coord, unsigned int size)
+{
+	if ((size & (size - 1)) == 0)
+	{
+		return (unsigned int)coord & (size - 1);
+	}
+
+	int wrapped = coord % (int)size;
+	return (unsigned int)(wrapped < 0 ? wrapped + (int)size : wrapped);
+}
+
+static inline uint32_t LoadTexel(const Image& mip, unsigned int x, unsigned int y)
+{
+	uint32_t texel;
+	memcpy(&texel, &mip.pixels[((size_t)y * mip.width + x) * 4], sizeof(texel));
+	return texel;
+}
+
+// Wrapped bilinear fetch of one mip, texel centers are at half integers
+// Channels are in lanes, 0 to 255
+static Float4 SampleBilinear(const Image& mip, float u, float v)
+{
+	float tu = u * mip.width - 0.5f;
+	float tv = v * mip.height - 0.5f;
+	int iu = FloorToInt(tu);
+	int iv = FloorToInt(tv);
+	Float4 wu = Splat(tu - (float)iu);
+	Float4 wv = Splat(tv - (float)iv);
+
+	unsigned int x0 = WrapCoord(iu, mip.width);
+	unsigned int y0 = WrapCoord(iv, mip.height);
+	unsigned int x1 = x0 + 1 < mip.width ? x0 + 1 : 0;
+	unsigned int y1 = y0 + 1 < mip.height ? y0 + 1 : 0;
+
+	Float4 top = Lerp(UnpackTexel(LoadTexel(mip, x0, y0)), UnpackTexel(LoadTexel(mip, x1, y0)), wu);
+	Float4 bottom = Lerp(UnpackTexel(LoadTexel(mip, x0, y1)), UnpackTexel(LoadTexel(mip, x1, y1)), wu);
+	return Lerp(top, bottom, wv);
+}
+
+// Trilinear sample for all lanes, level of detail comes from the quad as with coarse derivatives
+// Missing texture reads as zero, as an unbound shader resource does
+static void SampleQuad(const SoftwareTexture* pTexture, Float4 u, Float4 v, Float4 color[3])
+{
+	if (pTexture == NULL || pTexture->GetMipCount() == 0)
+	{
+		color[0] = color[1] = color[2] = Splat(0.0f);
+		return;
+	}
+
+	float us[4];
+	float vs[4];
+	Store(u, us);
+	Store(v, vs);
+
+	const Image& top = pTexture->GetMip(0);
+	float dudx = (us[1] - us[0]) * top.width;
+	float dvdx = (vs[1] - vs[0]) * top.height;
+	float dudy = (us[2] - us[0]) * top.width;
+	float dvdy = (vs[2] - vs[0]) * top.height;
+	float rho = std::max(sqrtf(dudx * dudx + dvdx * dvdx), sqrtf(dudy * dudy + dvdy * dvdy));
+
+	float maxLod = (float)(pTexture->GetMipCount() - 1);
+	float lod = rho > 0.0f ? log2f(rho) : 0.0f;
+	lod = lod < 0.0f ? 0.0f : (lod > maxLod ? maxLod : lod);
+
+	unsigned int mip = (unsigned int)lod;
+	Float4 blend = Splat(lod - mip);
+	bool trilinear = lod > (float)mip;
+
+	// Texels of a lane are one vector, transposed to a lane per pixel at the end
+	float lanes[4][4];
+	for (int i = 0; i < 4; i++)
+	{
+		Float4 texel = SampleBilinear(pTexture->GetMip(mip), us[i], vs[i]);
+		if (trilinear)
+		{
+			texel = Lerp(texel, SampleBilinear(pTexture->GetMip(mip + 1), us[i], vs[i]), blend);
+		}
+		Store(texel, lanes[i]);
+	}
+
+	Float4 scale = Splat(1.0f / 255.0f);
+	for (int c = 0; c < 3; c++)
+	{
+		color[c] = Set(lanes[0][c], lanes[1][c], lanes[2][c], lanes[3][c]) * scale;
+	}
+}
+
+// ShadeLight of ColorShader, lanes outside of laneMask get nothing
+static void ShadeLight(const ClusterLight& light, const Float4 worldPos[3], const Float4 normal[3], const Float4 matColor[3], Float4 laneMask, Float4 color[3])
+{
+	Float4 l[3] = {
+		Splat(light.pos.x) - worldPos[0],
+		Splat(light.pos.y) - worldPos[1],
+		Splat(light.pos.z) - worldPos[2]
+	};
+	Float4 distSqr = Dot(l, l);
+	Float4 invDist = Splat(1.0f) / Sqrt(distSqr);
+	for (int c = 0; c < 3; c++)
+	{
+		l[c] = l[c] * invDist;
+	}
+
+	Float4 ndotl = Max(Dot(l, normal), Splat(0.0f));
+	Float4 atten = Splat(1.0f) / (Splat(0.2f) + distSqr);
+	Float4 scale = ndotl * atten * laneMask;
+
+	color[0] = color[0] + matColor[0] * Splat(light.color.x) * scale;
+	color[1] = color[1] + matColor[1] * Splat(light.color.y) * scale;
+	color[2] = color[2] + matColor[2] * Splat(light.color.z) * scale;
+}
+
+bool SoftwareTexture::Load(const char* fileName, std::string& errors)
+{
+	m_mips.clear();
+	return ReadDDSImage(fileName, m_mips, errors);
+}
+
+void SoftwareTexture::CreateSolid(uint32_t color)
+{
+	Image image;
+	image.width = 1;
+	image.height = 1;
+	image.pixels = { (uint8_t)color, (uint8_t)(color >> 8), (uint8_t)(color >> 16), (uint8_t)(color >> 24) };
+
+	m_mips.assign(1, image);
+}
+
+SoftwareRasterizer::SoftwareRasterizer()
+	: m_width(0)
+	, m_height(0)
+	, m_tilesX(0)
+	, m_tilesY(0)
+	, m_clearPending(false)
+	, m_clearColor(0)
+	, m_clearDepth(1.0f)
+	, m_clusterParams(0, 0, 0, 0)
+	, m_lightCount(0)
+	, m_normalMap(false)
+	, m_clustered(false)
+	, m_pLights(NULL)
+	, m_pRanges(NULL)
+	, m_pLightIndices(NULL)
+	, m_pColorTexture(NULL)
+	, m_pNormalTexture(NULL)
+{
+	memset(&m_viewProj, 0, sizeof(m_viewProj));
+	memset(&m_pendingStats, 0, sizeof(m_pendingStats));
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool SoftwareRasterizer::Init(unsigned int width, unsigned int height)
+{
+	return Resize(width, height);
+}
+
+void SoftwareRasterizer::Term()
+{
+	m_color.clear();
+	m_depth.clear();
+	m_tiles.clear();
+	m_clipVertices.clear();
+	m_triangles.clear();
+
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+}
+
+bool SoftwareRasterizer::Resize(unsigned int width, unsigned int height)
+{
+	assert(m_triangles.empty());
+	if (width == 0 || height == 0 || width > MaxSize || height > MaxSize)
+	{
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_tilesX = (width + TileSize - 1) / TileSize;
+	m_tilesY = (height + TileSize - 1) / TileSize;
+
+	m_color.assign((size_t)width * height, 0);
+	m_depth.assign((size_t)width * height, 1.0f);
+
+	m_tiles.resize(m_tilesX * m_tilesY);
+	for (unsigned int y = 0; y < m_tilesY; y++)
+	{
+		for (unsigned int x = 0; x < m_tilesX; x++)
+		{
+			Tile& tile = m_tiles[y * m_tilesX + x];
+			unsigned int tileX = x * TileSize;
+			unsigned int tileY = y * TileSize;
+			tile.x = (int)tileX;
+			tile.y = (int)tileY;
+			tile.width = (int)(width - tileX < TileSize ? width - tileX : TileSize);
+			tile.height = (int)(height - tileY < TileSize ? height - tileY : TileSize);
+			tile.triangles.clear();
+		}
+	}
+
+	return true;
+}
+
+void SoftwareRasterizer::SetScene(const SceneBuffer& scene, ShaderKey key)
+{
+	XMStoreFloat4x4(&m_viewProj, scene.VP);
+	m_clusterParams = scene.clusterParams;
+	m_lightCount = std::min((unsigned int)std::max(scene.lightParams.i[0], 0), MaxDirectLights);
+	m_normalMap = (key & SHADER_FEATURE_NORMAL_MAP) != 0;
+	m_clustered = ((key & SHADER_FEATURE_LIGHT_BUCKET) >> ShaderLightBucketShift) == SHADER_LIGHTS_CLUSTERED;
+}
+
+void SoftwareRasterizer::SetLights(const ClusterLight* pLights, const LightClusters::Range* pRanges, const unsigned int* pLightIndices)
+{
+	m_pLights = pLights;
+	m_pRanges = pRanges;
+	m_pLightIndices = pLightIndices;
+}
+
+void SoftwareRasterizer::SetTextures(const SoftwareTexture* pColor, const SoftwareTexture* pNormal)
+{
+	m_pColorTexture = pColor;
+	m_pNormalTexture = pNormal;
+}
+
+void SoftwareRasterizer::Clear(const float color[4], float depth)
+{
+	// Earlier draws would be cleared too
+	assert(m_triangles.empty());
+
+	m_clearPending = true;
+	m_clearColor = PackColor(color[0], color[1], color[2], color[3]);
+	m_clearDepth = depth;
+}
+
+void SoftwareRasterizer::DrawIndexed(const TextureVertex* pVertices, const UINT16* pIndices, unsigned int indexCount, const ModelBuffer& model)
+{
+	XMFLOAT4X4 modelMatrix;
+	XMFLOAT4X4 normalMatrix;
+	XMStoreFloat4x4(&modelMatrix, model.modelMatrix);
+	XMStoreFloat4x4(&normalMatrix, model.normalMatrix);
+
+	// Vertex stage, every vertex up to the largest index is transformed once
+	unsigned int vertexCount = 0;
+	for (unsigned int i = 0; i < indexCount; i++)
+	{
+		vertexCount = std::max(vertexCount, (unsigned int)pIndices[i] + 1);
+	}
+	m_clipVertices.resize(vertexCount);
+
+	// Matrices are transposed, so each output component is a dot product with a row
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		const TextureVertex& vertex = pVertices[i];
+		ClipVertex& out = m_clipVertices[i];
+
+		float worldPos[4];
+		for (int r = 0; r < 4; r++)
+		{
+			const float* row = modelMatrix.m[r];
+			worldPos[r] = vertex.pos.f[0] * row[0] + vertex.pos.f[1] * row[1] + vertex.pos.f[2] * row[2] + vertex.pos.f[3] * row[3];
+		}
+		for (int r = 0; r < 4; r++)
+		{
+			const float* row = m_viewProj.m[r];
+			out.pos[r] = worldPos[0] * row[0] + worldPos[1] * row[1] + worldPos[2] * row[2] + worldPos[3] * row[3];
+		}
+
+		float* pAttributes = out.attributes;
+		pAttributes[0] = worldPos[0];
+		pAttributes[1] = worldPos[1];
+		pAttributes[2] = worldPos[2];
+		pAttributes[3] = vertex.uv.x;
+		pAttributes[4] = vertex.uv.y;
+		for (int r = 0; r < 3; r++)
+		{
+			const float* row = normalMatrix.m[r];
+			pAttributes[5 + r] = vertex.normal.x * row[0] + vertex.normal.y * row[1] + vertex.normal.z * row[2];
+			pAttributes[8 + r] = vertex.tangent.x * row[0] + vertex.tangent.y * row[1] + vertex.tangent.z * row[2];
+		}
+	}
+
+	// Clip planes as dot products with clip space position, near and far first
+	static const float ClipPlanes[6][4] = {
+		{ 0, 0, 1, 0 },
+		{ 0, 0, -1, 1 },
+		{ 1, 0, 0, GuardBand },
+		{ -1, 0, 0, GuardBand },
+		{ 0, 1, 0, GuardBand },
+		{ 0, -1, 0, GuardBand }
+	};
+
+	unsigned int triangleCount = indexCount / 3;
+	m_pendingStats.drawCount++;
+	m_pendingStats.triangleCount += triangleCount;
+
+	for (unsigned int t = 0; t < triangleCount; t++)
+	{
+		const ClipVertex* pTriangle[3] = {
+			&m_clipVertices[pIndices[t * 3]],
+			&m_clipVertices[pIndices[t * 3 + 1]],
+			&m_clipVertices[pIndices[t * 3 + 2]]
+		};
+
+		unsigned int outsideAll = 0x3f;
+		unsigned int outsideAny = 0;
+		for (int v = 0; v < 3; v++)
+		{
+			unsigned int outside = 0;
+			for (int p = 0; p < 6; p++)
+			{
+				const float* plane = ClipPlanes[p];
+				const float* pos = pTriangle[v]->pos;
+				if (pos[0] * plane[0] + pos[1] * plane[1] + pos[2] * plane[2] + pos[3] * plane[3] < 0.0f)
+				{
+					outside |= 1 << p;
+				}
+			}
+			outsideAll &= outside;
+			outsideAny |= outside;
+		}
+
+		if (outsideAll != 0)
+		{
+			m_pendingStats.culledCount++;
+			continue;
+		}
+		if (outsideAny == 0)
+		{
+			if (!SetupTriangle(*pTriangle[0], *pTriangle[1], *pTriangle[2]))
+			{
+				m_pendingStats.culledCount++;
+			}
+			continue;
+		}
+
+		// Sutherland-Hodgman against the planes crossed, the polygon stays convex and keeps its winding
+		m_pendingStats.clippedCount++;
+
+		ClipVertex polygons[2][MaxClipVertices];
+		unsigned int counts[2] = { 3, 0 };
+		for (int v = 0; v < 3; v++)
+		{
+			polygons[0][v] = *pTriangle[v];
+		}
+
+		unsigned int current = 0;
+		for (int p = 0; p < 6 && counts[current] != 0; p++)
+		{
+			if ((outsideAny & (1 << p)) == 0)
+			{
+				continue;
+			}
+
+			const float* plane = ClipPlanes[p];
+			const ClipVertex* pIn = polygons[current];
+			ClipVertex* pOut = polygons[1 - current];
+			unsigned int inCount = counts[current];
+			unsigned int outCount = 0;
+
+			for (unsigned int v = 0; v < inCount; v++)
+			{
+				const ClipVertex& a = pIn[v];
+				const ClipVertex& b = pIn[(v + 1) % inCount];
+				float da = a.pos[0] * plane[0] + a.pos[1] * plane[1] + a.pos[2] * plane[2] + a.pos[3] * plane[3];
+				float db = b.pos[0] * plane[0] + b.pos[1] * plane[1] + b.pos[2] * plane[2] + b.pos[3] * plane[3];
+
+				if (da >= 0.0f)
+				{
+					pOut[outCount++] = a;
+				}
+				if ((da >= 0.0f) != (db >= 0.0f))
+				{
+					float s = da / (da - db);
+					ClipVertex& clipped = pOut[outCount++];
+					for (int c = 0; c < 4; c++)
+					{
+						clipped.pos[c] = a.pos[c] + (b.pos[c] - a.pos[c]) * s;
+					}
+					for (unsigned int c = 0; c < AttributeCount; c++)
+					{
+						clipped.attributes[c] = a.attributes[c] + (b.attributes[c] - a.attributes[c]) * s;
+					}
+				}
+			}
+
+			assert(outCount <= MaxClipVertices);
+			counts[1 - current] = outCount;
+			current = 1 - current;
+		}
+
+		// Fan of the clipped polygon, the triangle is culled when none of its parts is left
+		const ClipVertex* pPolygon = polygons[current];
+		bool binned = false;
+		for (unsigned int v = 2; v < counts[current]; v++)
+		{
+			binned = SetupTriangle(pPolygon[0], pPolygon[v - 1], pPolygon[v]) || binned;
+		}
+		if (!binned)
+		{
+			m_pendingStats.culledCount++;
+		}
+	}
+}
+
+bool SoftwareRasterizer::SetupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2)
+{
+	const ClipVertex* pVertices[3] = { &v0, &v1, &v2 };
+
+	Triangle triangle;
+	float invW[3];
+	float depth[3];
+	for (int v = 0; v < 3; v++)
+	{
+		const float* pos = pVertices[v]->pos;
+		invW[v] = 1.0f / pos[3];
+
+		// Viewport transform, y goes down
+		float x = (pos[0] * invW[v] * 0.5f + 0.5f) * m_width;
+		float y = (0.5f - pos[1] * invW[v] * 0.5f) * m_height;
+		triangle.x[v] = (int32_t)floorf(x * SubpixelScale + 0.5f);
+		triangle.y[v] = (int32_t)floorf(y * SubpixelScale + 0.5f);
+		depth[v] = pos[2] * invW[v];
+	}
+
+	// Clockwise triangles have positive area with y going down, the rest are back faces
+	int64_t area = (int64_t)(triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) -
+		(int64_t)(triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+	if (area <= 0)
+	{
+		return false;
+	}
+
+	// Pixels with a center inside bounds, clamped to the target
+	int32_t minX = std::min(triangle.x[0], std::min(triangle.x[1], triangle.x[2]));
+	int32_t minY = std::min(triangle.y[0], std::min(triangle.y[1], triangle.y[2]));
+	int32_t maxX = std::max(triangle.x[0], std::max(triangle.x[1], triangle.x[2]));
+	int32_t maxY = std::max(triangle.y[0], std::max(triangle.y[1], triangle.y[2]));
+	triangle.minX = std::max((minX - SubpixelScale / 2 + SubpixelScale - 1) >> SubpixelBits, 0);
+	triangle.minY = std::max((minY - SubpixelScale / 2 + SubpixelScale - 1) >> SubpixelBits, 0);
+	triangle.maxX = std::min((maxX - SubpixelScale / 2) >> SubpixelBits, (int)m_width - 1);
+	triangle.maxY = std::min((maxY - SubpixelScale / 2) >> SubpixelBits, (int)m_height - 1);
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+	{
+		return false;
+	}
+
+	// Barycentrics of vertex 1 and 2 as planes over pixels, relative to vertex 0
+	double pixelArea = (double)area / (SubpixelScale * SubpixelScale);
+	double b1dx = (triangle.y[2] - triangle.y[0]) / (SubpixelScale * pixelArea);
+	double b1dy = (triangle.x[0] - triangle.x[2]) / (SubpixelScale * pixelArea);
+	double b2dx = (triangle.y[0] - triangle.y[1]) / (SubpixelScale * pixelArea);
+	double b2dy = (triangle.x[1] - triangle.x[0]) / (SubpixelScale * pixelArea);
+
+	// Depth is linear in screen space, attributes are linear after division by w
+	for (unsigned int p = 0; p < PlaneCount; p++)
+	{
+		float values[3];
+		for (int v = 0; v < 3; v++)
+		{
+			if (p == 0)
+			{
+				values[v] = depth[v];
+			}
+			else if (p <= AttributeCount)
+			{
+				values[v] = pVertices[v]->attributes[p - 1] * invW[v];
+			}
+			else
+			{
+				values[v] = invW[v];
+			}
+		}
+
+		double d1 = (double)values[1] - values[0];
+		double d2 = (double)values[2] - values[0];
+		triangle.planes[p][0] = values[0];
+		triangle.planes[p][1] = (float)(d1 * b1dx + d2 * b2dx);
+		triangle.planes[p][2] = (float)(d1 * b1dy + d2 * b2dy);
+	}
+
+	m_triangles.push_back(triangle);
+	BinTriangle((unsigned int)m_triangles.size() - 1);
+
+	return true;
+}
+
+void SoftwareRasterizer::BinTriangle(unsigned int index)
+{
+	const Triangle& triangle = m_triangles[index];
+
+	unsigned int firstX = triangle.minX / TileSize;
+	unsigned int firstY = triangle.minY / TileSize;
+	unsigned int lastX = triangle.maxX / TileSize;
+	unsigned int lastY = triangle.maxY / TileSize;
+
+	for (unsigned int y = firstY; y <= lastY; y++)
+	{
+		for (unsigned int x = firstX; x <= lastX; x++)
+		{
+			m_tiles[y * m_tilesX + x].triangles.push_back(index);
+		}
+	}
+	m_pendingStats.binnedCount += (lastX - firstX + 1) * (lastY - firstY + 1);
+}
+
+void SoftwareRasterizer::Flush(JobSystem* pJobs)
+{
+	PROFILE_SCOPE("SoftwareRasterizer::Flush");
+
+	unsigned int tileCount = (unsigned int)m_tiles.size();
+	if (pJobs != NULL && tileCount > 1)
+	{
+		pJobs->ParallelFor(tileCount, 1, [this](unsigned int first, unsigned int count)
+		{
+			for (unsigned int i = first; i < first + count; i++)
+			{
+				RasterizeTile(m_tiles[i]);
+			}
+		});
+	}
+	else
+	{
+		for (Tile& tile : m_tiles)
+		{
+			RasterizeTile(tile);
+		}
+	}
+
+	for (Tile& tile : m_tiles)
+	{
+		m_pendingStats.quadCount += tile.quadCount;
+		m_pendingStats.shadedQuadCount += tile.shadedQuadCount;
+		m_pendingStats.pixelCount += tile.pixelCount;
+		tile.triangles.clear();
+	}
+
+	m_stats = m_pendingStats;
+	memset(&m_pendingStats, 0, sizeof(m_pendingStats));
+
+	m_triangles.clear();
+	m_clearPending = false;
+}
+
+void SoftwareRasterizer::RasterizeTile(Tile& tile)
+{
+	PROFILE_SCOPE("RasterizeTile");
+
+	tile.quadCount = 0;
+	tile.shadedQuadCount = 0;
+	tile.pixelCount = 0;
+
+	if (m_clearPending)
+	{
+		for (int y = tile.y; y < tile.y + tile.height; y++)
+		{
+			size_t row = (size_t)y * m_width + tile.x;
+			std::fill(m_color.begin() + row, m_color.begin() + row + tile.width, m_clearColor);
+			std::fill(m_depth.begin() + row, m_depth.begin() + row + tile.width, m_clearDepth);
+		}
+	}
+
+	for (unsigned int index : tile.triangles)
+	{
+		RasterizeTriangle(m_triangles[index], tile);
+	}
+}
+
+void SoftwareRasterizer::RasterizeTriangle(const Triangle& triangle, Tile& tile)
+{
+	// Quads start on even pixels, tiles do too, so quads never cross tiles
+	int startX = std::max(triangle.minX, tile.x) & ~1;
+	int startY = std::max(triangle.minY, tile.y) & ~1;
+	int endX = std::min(triangle.maxX, tile.x + tile.width - 1);
+	int endY = std::min(triangle.maxY, tile.y + tile.height - 1);
+	if (startX > endX || startY > endY)
+	{
+		return;
+	}
+
+	// Edge k is opposite vertex k, inside is positive
+	// Values at pixel centers are exact in fixed point, tile relative ones fit in 32 bits
+	int32_t edgeStart[3];
+	int32_t edgeStepX[3];
+	int32_t edgeStepY[3];
+	int32_t edgeBias[3];
+	for (int k = 0; k < 3; k++)
+	{
+		int a = (k + 1) % 3;
+		int b = (k + 2) % 3;
+		int32_t dx = triangle.x[b] - triangle.x[a];
+		int32_t dy = triangle.y[b] - triangle.y[a];
+
+		// Top-left rule, pixel centers exactly on other edges belong to the neighbor
+		bool topLeft = (dy == 0 && dx > 0) || dy < 0;
+		edgeBias[k] = topLeft ? 0 : 1;
+
+		int32_t centerX = startX * SubpixelScale + SubpixelScale / 2;
+		int32_t centerY = startY * SubpixelScale + SubpixelScale / 2;
+		int64_t start = (int64_t)dx * (centerY - triangle.y[a]) - (int64_t)dy * (centerX - triangle.x[a]);
+		if (start <= -EdgeTrivialLimit)
+		{
+			return;
+		}
+		if (start >= EdgeTrivialLimit)
+		{
+			edgeStart[k] = EdgeTrivialLimit;
+			edgeStepX[k] = 0;
+			edgeStepY[k] = 0;
+		}
+		else
+		{
+			edgeStart[k] = (int32_t)start;
+			edgeStepX[k] = -dy * SubpixelScale;
+			edgeStepY[k] = dx * SubpixelScale;
+		}
+	}
+
+	Int4 laneEdgeOffsets[3];
+	Int4 edgeThresholds[3];
+	for (int k = 0; k < 3; k++)
+	{
+		laneEdgeOffsets[k] = SetInt(0, edgeStepX[k], edgeStepY[k], edgeStepX[k] + edgeStepY[k]);
+		edgeThresholds[k] = SplatInt(edgeBias[k]);
+	}
+
+	const float originX = (float)triangle.x[0] / SubpixelScale;
+	const float originY = (float)triangle.y[0] / SubpixelScale;
+	const Float4 laneOffsetX = Set(0.5f, 1.5f, 0.5f, 1.5f);
+	const Float4 laneOffsetY = Set(0.5f, 0.5f, 1.5f, 1.5f);
+
+	int tileRight = tile.x + tile.width;
+	int tileBottom = tile.y + tile.height;
+
+	for (int y = startY; y <= endY; y += 2)
+	{
+		// Odd sized targets have quads with a row or column outside
+		int validRows = y + 1 < tileBottom ? 0xf : 0x3;
+
+		for (int x = startX; x <= endX; x += 2)
+		{
+			int validLanes = validRows & (x + 1 < tileRight ? 0xf : 0x5);
+
+			int mask = validLanes;
+			for (int k = 0; k < 3 && mask != 0; k++)
+			{
+				int32_t edge = edgeStart[k] + edgeStepX[k] * (x - startX) + edgeStepY[k] * (y - startY);
+				mask &= GreaterEqualMask(SplatInt(edge) + laneEdgeOffsets[k], edgeThresholds[k]);
+			}
+			if (mask == 0)
+			{
+				continue;
+			}
+			tile.quadCount++;
+
+			Float4 dx = Splat((float)x - originX) + laneOffsetX;
+			Float4 dy = Splat((float)y - originY) + laneOffsetY;
+
+			// Early depth test, the shader does not write depth
+			size_t row0 = (size_t)y * m_width + x;
+			size_t row1 = row0 + m_width;
+			float stored[4] = {
+				m_depth[row0],
+				(validLanes & 0x2) ? m_depth[row0 + 1] : 0.0f,
+				(validLanes & 0x4) ? m_depth[row1] : 0.0f,
+				(validLanes & 0x8) ? m_depth[row1 + 1] : 0.0f
+			};
+
+			Float4 depth = Splat(triangle.planes[0][0]) + Splat(triangle.planes[0][1]) * dx + Splat(triangle.planes[0][2]) * dy;
+			mask &= LessMask(depth, Set(stored[0], stored[1], stored[2], stored[3]));
+			if (mask == 0)
+			{
+				continue;
+			}
+			tile.shadedQuadCount++;
+
+			// Attributes for all lanes, uncovered ones are helpers for derivatives
+			Float4 attributes[AttributeCount];
+			Float4 w = Splat(1.0f) / (Splat(triangle.planes[12][0]) + Splat(triangle.planes[12][1]) * dx + Splat(triangle.planes[12][2]) * dy);
+			for (unsigned int a = 0; a < AttributeCount; a++)
+			{
+				const float* plane = triangle.planes[a + 1];
+				attributes[a] = (Splat(plane[0]) + Splat(plane[1]) * dx + Splat(plane[2]) * dy) * w;
+			}
+
+			const Float4* worldPos = &attributes[0];
+			const Float4* inputNormal = &attributes[5];
+			const Float4* tangent = &attributes[8];
+
+			Float4 matColor[3];
+			SampleQuad(m_pColorTexture, attributes[3], attributes[4], matColor);
+
+			Float4 normal[3];
+			if (m_normalMap)
+			{
+				Float4 nm[3];
+				SampleQuad(m_pNormalTexture, attributes[3], attributes[4], nm);
+				for (int c = 0; c < 3; c++)
+				{
+					nm[c] = (nm[c] - Splat(0.5f)) * Splat(2.0f);
+				}
+
+				Float4 binormal[3] = {
+					inputNormal[1] * tangent[2] - inputNormal[2] * tangent[1],
+					inputNormal[2] * tangent[0] - inputNormal[0] * tangent[2],
+					inputNormal[0] * tangent[1] - inputNormal[1] * tangent[0]
+				};
+				for (int c = 0; c < 3; c++)
+				{
+					normal[c] = nm[0] * tangent[c] + nm[1] * binormal[c] + inputNormal[c];
+				}
+			}
+			else
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					normal[c] = inputNormal[c];
+				}
+			}
+
+			Float4 color[3] = { Splat(0.0f), Splat(0.0f), Splat(0.0f) };
+			if (m_clustered)
+			{
+				if (m_pRanges != NULL)
+				{
+					// SV_Position.w is view space depth, lanes of a quad are in one or a few clusters
+					float ws[4];
+					Store(w, ws);
+
+					unsigned int clusters[4];
+					for (int i = 0; i < 4; i++)
+					{
+						float px = x + (i & 1) + 0.5f;
+						float py = y + (i >> 1) + 0.5f;
+						unsigned int cx = std::min((unsigned int)(px / m_clusterParams.x), LightClusters::CountX - 1);
+						unsigned int cy = std::min((unsigned int)(py / m_clusterParams.y), LightClusters::CountY - 1);
+						float slice = floorf(logf(ws[i]) * m_clusterParams.z + m_clusterParams.w);
+						unsigned int cz = (unsigned int)std::min(std::max(slice, 0.0f), (float)(LightClusters::CountZ - 1));
+						clusters[i] = (cz * LightClusters::CountY + cy) * LightClusters::CountX + cx;
+					}
+
+					int remaining = 0xf;
+					while (remaining != 0)
+					{
+						unsigned int first = 0;
+						while ((remaining & (1 << first)) == 0)
+						{
+							first++;
+						}
+
+						unsigned int cluster = clusters[first];
+						int lanes = 0;
+						for (int i = 0; i < 4; i++)
+						{
+							lanes |= (clusters[i] == cluster ? 1 : 0) << i;
+						}
+						remaining &= ~lanes;
+
+						Float4 laneMask = lanes == 0xf ? Splat(1.0f) : Set((float)(lanes & 1), (float)((lanes >> 1) & 1), (float)((lanes >> 2) & 1), (float)((lanes >> 3) & 1));
+						const LightClusters::Range& range = m_pRanges[cluster];
+						for (unsigned int i = 0; i < range.count; i++)
+						{
+							ShadeLight(m_pLights[m_pLightIndices[range.offset + i]], worldPos, normal, matColor, laneMask, color);
+						}
+					}
+				}
+			}
+			else if (m_pLights != NULL)
+			{
+				// Few lights, all of them are applied without cluster lookup
+				for (unsigned int i = 0; i < m_lightCount; i++)
+				{
+					ShadeLight(m_pLights[i], worldPos, normal, matColor, Splat(1.0f), color);
+				}
+			}
+
+			float r[4];
+			float g[4];
+			float b[4];
+			float z[4];
+			Store(color[0], r);
+			Store(color[1], g);
+			Store(color[2], b);
+			Store(depth, z);
+
+			for (int i = 0; i < 4; i++)
+			{
+				if (mask & (1 << i))
+				{
+					size_t pixel = (i < 2 ? row0 : row1) + (i & 1);
+					m_color[pixel] = PackColor(r[i], g[i], b[i], 1.0f);
+					m_depth[pixel] = z[i];
+				}
+			}
+			tile.pixelCount += CountLanes(mask);
+		}
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "DDSImage.h"
+#include "LightClusters.h"
+#include "SceneData.h"
+#include "ShaderPermutations.h"
+
+class JobSystem;
+
+// RGBA8 mip chain sampled by the software rasterizer
+class SoftwareTexture
+{
+public:
+	// Any DDS file the texture tool reads, block compressed ones are decoded
+	bool Load(const char* fileName, std::string& errors);
+	// Single texel, color is ABGR as for the renderer placeholders
+	void CreateSolid(uint32_t color);
+
+	unsigned int GetMipCount() const { return (unsigned int)m_mips.size(); }
+	const Image& GetMip(unsigned int mip) const { return m_mips[mip]; }
+
+private:
+	std::vector<Image> m_mips; // Largest first
+};
+
+struct SoftwareRasterizerStats
+{
+	unsigned int drawCount;
+	unsigned int triangleCount;    // Triangles given to draws
+	unsigned int culledCount;      // Back facing, outside of the clip volume or between pixel centers
+	unsigned int clippedCount;     // Triangles which needed clipping
+	unsigned int binnedCount;      // Triangle and tile pairs
+	uint64_t quadCount;            // 2x2 quads with at least one pixel covered
+	uint64_t shadedQuadCount;      // Quads which passed depth test and were shaded
+	uint64_t pixelCount;           // Pixels written
+};
+
+// Tile based CPU implementation of the opaque ColorShader pass, a reference for the GPU output
+// Draws run the vertex stage right away and bin triangles to tiles, Flush rasterizes tiles in parallel
+// Follows D3D11 rules: clockwise front faces with back face culling, top-left fill rule,
+// perspective correct attributes, LESS depth test, wrapped trilinear sampling and UNORM rounding
+// Derivatives for mip selection come from 2x2 quads, as on the GPU
+class SoftwareRasterizer
+{
+public:
+	static const unsigned int TileSize = 64;
+	static const unsigned int MaxSize = 4096; // Fixed point edge functions need it
+
+	SoftwareRasterizer();
+
+	bool Init(unsigned int width, unsigned int height);
+	void Term();
+	bool Resize(unsigned int width, unsigned int height);
+
+	// Shader state, pointers are used by Flush, so they must stay valid until it is done
+	// Key selects the normal map and light bucket features as for the GPU variants
+	void SetScene(const SceneBuffer& scene, ShaderKey key);
+	// Lights are indexed directly or through cluster ranges and light indices, as in ColorShader
+	void SetLights(const ClusterLight* pLights, const LightClusters::Range* pRanges, const unsigned int* pLightIndices);
+	void SetTextures(const SoftwareTexture* pColor, const SoftwareTexture* pNormal);
+
+	// Applied to each tile by Flush, before the triangles binned to it
+	void Clear(const float color[4], float depth);
+	void DrawIndexed(const TextureVertex* pVertices, const UINT16* pIndices, unsigned int indexCount, const ModelBuffer& model);
+	// Tiles are split between jobs when pJobs is given, then the caller has to be a worker
+	void Flush(JobSystem* pJobs = NULL);
+
+	// Pixels are RGBA8 as R8G8B8A8_UNORM, rows of width pixels
+	const uint32_t* GetPixels() const { return m_color.data(); }
+	unsigned int GetWidth() const { return m_width; }
+	unsigned int GetHeight() const { return m_height; }
+
+	// Counters of the draws rasterized by the last Flush
+	const SoftwareRasterizerStats& GetStats() const { return m_stats; }
+
+private:
+	// Vertex shader output, positions are in clip space
+	struct ClipVertex
+	{
+		float pos[4];
+		float attributes[11]; // World position, uv, normal, tangent
+	};
+
+	// Snapped screen space triangle with attribute planes
+	struct Triangle
+	{
+		int32_t x[3]; // Fixed point, 1/16 pixel
+		int32_t y[3];
+		int minX;     // Bounds of pixel centers, inclusive and within the target
+		int minY;
+		int maxX;
+		int maxY;
+		float planes[13][3]; // Depth, attributes divided by w and 1/w: value at vertex 0, change per pixel in x and y
+	};
+
+	struct Tile
+	{
+		int x;
+		int y;
+		int width;
+		int height;
+		std::vector<unsigned int> triangles; // In draw order
+
+		// Counters of the last rasterization, summed by Flush
+		uint64_t quadCount;
+		uint64_t shadedQuadCount;
+		uint64_t pixelCount;
+	};
+
+	// False when the triangle is back facing or covers no pixel centers
+	bool SetupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2);
+	void BinTriangle(unsigned int triangle);
+	void RasterizeTile(Tile& tile);
+	void RasterizeTriangle(const Triangle& triangle, Tile& tile);
+
+	unsigned int m_width;
+	unsigned int m_height;
+	unsigned int m_tilesX;
+	unsigned int m_tilesY;
+
+	std::vector<uint32_t> m_color;
+	std::vector<float> m_depth;
+	std::vector<Tile> m_tiles;
+
+	std::vector<ClipVertex> m_clipVertices; // Of the current draw
+	std::vector<Triangle> m_triangles;      // Binned since the last Flush
+
+	bool m_clearPending;
+	uint32_t m_clearColor;
+	float m_clearDepth;
+
+	DirectX::XMFLOAT4X4 m_viewProj; // Transposed, as in SceneBuffer
+	DirectX::XMFLOAT4 m_clusterParams;
+	unsigned int m_lightCount;
+	bool m_normalMap;
+	bool m_clustered;
+
+	const ClusterLight* m_pLights;
+	const LightClusters::Range* m_pRanges;
+	const unsigned int* m_pLightIndices;
+	const SoftwareTexture* m_pColorTexture;
+	const SoftwareTexture* m_pNormalTexture;
+
+	SoftwareRasterizerStats m_pendingStats; // Draws since the last Flush
+	SoftwareRasterizerStats m_stats;
+};
@@ -0,0 +1,212 @@
+#include "TextureArchive.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+static const uint64_t FNVOffset = 14695981039346656037ull;
+static const uint64_t FNVPrime = 1099511628211ull;
+
+static uint64_t AlignOffset(uint64_t offset)
+{
+	return (offset + TextureArchive::PayloadAlignment - 1) / TextureArchive::PayloadAlignment * TextureArchive::PayloadAlignment;
+}
+
+TextureArchive::TextureArchive()
+	: m_pEntries(NULL)
+{
+}
+
+bool TextureArchive::Open(const std::string& path)
+{
+	Close();
+
+	if (!m_file.Open(path.c_str()))
+	{
+		return false;
+	}
+
+	// Everything is checked against the file size, so lookups never read outside of the mapping
+	const uint8_t* pData = m_file.GetData();
+	uint64_t size = m_file.GetSize();
+
+	Header header;
+	if (size < sizeof(header))
+	{
+		Close();
+		return false;
+	}
+	memcpy(&header, pData, sizeof(header));
+
+	if (header.magic != Magic || header.version != Version
+		|| header.tableOffset % sizeof(uint64_t) != 0
+		|| header.tableOffset > size || (size - header.tableOffset) / sizeof(Entry) < header.entryCount
+		|| header.namesOffset > size || size - header.namesOffset < header.namesSize)
+	{
+		Close();
+		return false;
+	}
+
+	m_pEntries = (const Entry*)(pData + header.tableOffset);
+	const char* pNames = (const char*)(pData + header.namesOffset);
+
+	m_names.reserve(header.entryCount);
+	for (uint32_t i = 0; i < header.entryCount; i++)
+	{
+		const Entry& entry = m_pEntries[i];
+		if (entry.offset > size || size - entry.offset < entry.size
+			|| entry.nameOffset > header.namesSize || header.namesSize - entry.nameOffset < entry.nameSize)
+		{
+			Close();
+			return false;
+		}
+
+		m_names.push_back(std::string(pNames + entry.nameOffset, entry.nameSize));
+		if (!m_index.insert(std::make_pair(m_names.back(), (size_t)i)).second)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void TextureArchive::Close()
+{
+	m_file.Close();
+	m_pEntries = NULL;
+	m_names.clear();
+	m_index.clear();
+}
+
+bool TextureArchive::Find(const std::string& name, const uint8_t** ppData, size_t* pSize) const
+{
+	auto it = m_index.find(name);
+	if (it == m_index.end())
+	{
+		return false;
+	}
+
+	GetEntryData(it->second, ppData, pSize);
+	return true;
+}
+
+void TextureArchive::GetEntryData(size_t index, const uint8_t** ppData, size_t* pSize) const
+{
+	assert(index < m_names.size());
+
+	*ppData = m_file.GetData() + m_pEntries[index].offset;
+	*pSize = (size_t)m_pEntries[index].size;
+}
+
+bool TextureArchive::Verify(size_t index) const
+{
+	const uint8_t* pData = NULL;
+	size_t size = 0;
+	GetEntryData(index, &pData, &size);
+
+	return HashData(pData, size) == m_pEntries[index].checksum;
+}
+
+uint64_t TextureArchive::HashData(const uint8_t* pData, size_t size)
+{
+	uint64_t hash = FNVOffset;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ pData[i]) * FNVPrime;
+	}
+	return hash;
+}
+
+bool TextureArchiveWriter::Add(const std::string& name, const std::string& path)
+{
+	if (!m_names.insert(std::make_pair(name, m_sources.size())).second)
+	{
+		return false;
+	}
+
+	m_sources.push_back(Source{ name, path });
+	return true;
+}
+
+bool TextureArchiveWriter::Write(const std::string& path, std::string& errors) const
+{
+	std::string tempPath = path + ".tmp";
+	std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		errors = "can not create " + tempPath;
+		return false;
+	}
+
+	// Header is written last, once offsets are known
+	static const char Padding[TextureArchive::PayloadAlignment] = {};
+	uint64_t offset = AlignOffset(sizeof(TextureArchive::Header));
+	file.write(Padding, offset);
+
+	std::vector<TextureArchive::Entry> entries;
+	std::string names;
+	for (const Source& source : m_sources)
+	{
+		MappedFile sourceFile;
+		if (!sourceFile.Open(source.path.c_str()))
+		{
+			errors = "can not open " + source.path;
+			break;
+		}
+
+		TextureArchive::Entry entry;
+		entry.offset = offset;
+		entry.size = sourceFile.GetSize();
+		entry.checksum = TextureArchive::HashData(sourceFile.GetData(), sourceFile.GetSize());
+		entry.nameOffset = (uint32_t)names.size();
+		entry.nameSize = (uint32_t)source.name.size();
+		entries.push_back(entry);
+		names += source.name;
+
+		uint64_t nextOffset = AlignOffset(offset + entry.size);
+		file.write((const char*)sourceFile.GetData(), sourceFile.GetSize());
+		file.write(Padding, nextOffset - offset - entry.size);
+		offset = nextOffset;
+	}
+
+	TextureArchive::Header header = {};
+	header.magic = TextureArchive::Magic;
+	header.version = TextureArchive::Version;
+	header.entryCount = (uint32_t)entries.size();
+	header.tableOffset = offset;
+	header.namesOffset = offset + entries.size() * sizeof(TextureArchive::Entry);
+	header.namesSize = names.size();
+
+	file.write((const char*)entries.data(), entries.size() * sizeof(TextureArchive::Entry));
+	file.write(names.data(), names.size());
+	file.seekp(0);
+	file.write((const char*)&header, sizeof(header));
+	file.close();
+
+	std::error_code error;
+	if (!errors.empty() || !file)
+	{
+		if (errors.empty())
+		{
+			errors = "can not write " + tempPath;
+		}
+		fs::remove(tempPath, error);
+		return false;
+	}
+
+	fs::rename(tempPath, path, error);
+	if (error)
+	{
+		errors = "can not rename " + tempPath + " to " + path;
+		fs::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Many texture files packed into one, so loading them costs a single open
+// Layout is a header, payloads aligned to PayloadAlignment, entry table and entry names
+// Payloads are stored as is, so DDS data is parsed straight from the mapped archive
+class TextureArchive
+{
+public:
+	static const uint32_t Magic = 0x52415854; // "TXAR"
+	static const uint32_t Version = 1;
+	static const uint32_t PayloadAlignment = 4096;
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t reserved;
+		uint64_t tableOffset; // Entry array
+		uint64_t namesOffset; // Names of all entries, not zero terminated
+		uint64_t namesSize;
+	};
+
+	struct Entry
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint64_t checksum; // FNV-1a of the payload
+		uint32_t nameOffset;
+		uint32_t nameSize;
+	};
+
+	TextureArchive();
+
+	// Header and table are checked, payloads only by Verify
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return m_file.IsOpen(); }
+	size_t GetEntryCount() const { return m_names.size(); }
+	const std::string& GetEntryName(size_t index) const { return m_names[index]; }
+
+	// Thread safe, data points into the mapping and is valid until Close
+	bool Find(const std::string& name, const uint8_t** ppData, size_t* pSize) const;
+	void GetEntryData(size_t index, const uint8_t** ppData, size_t* pSize) const;
+
+	// Compares payload checksum
+	bool Verify(size_t index) const;
+
+	static uint64_t HashData(const uint8_t* pData, size_t size);
+
+private:
+	MappedFile m_file;
+	const Entry* m_pEntries;
+	std::vector<std::string> m_names;
+	std::unordered_map<std::string, size_t> m_index;
+};
+
+// Builds an archive from files on disk, names are how entries are found later
+class TextureArchiveWriter
+{
+public:
+	// Fails on duplicate names
+	bool Add(const std::string& name, const std::string& path);
+
+	// Archive is written to a temporary file and renamed, errors name the file which failed
+	bool Write(const std::string& path, std::string& errors) const;
+
+	size_t GetEntryCount() const { return m_sources.size(); }
+
+private:
+	struct Source
+	{
+		std::string name;
+		std::string path;
+	};
+
+private:
+	std::vector<Source> m_sources;
+	std::unordered_map<std::string, size_t> m_names;
+};
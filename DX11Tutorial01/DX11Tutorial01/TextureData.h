@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+// Same layout as D3D11_SUBRESOURCE_DATA
+struct TextureSubresource
+{
+	const void* pData;
+	uint32_t rowPitch;
+	uint32_t slicePitch;
+};
+
+// Parsed texture ready for resource creation
+// May be moved but not copied while subresources point into pixels
+struct TextureData
+{
+	uint32_t dimension; // D3D11_RESOURCE_DIMENSION
+	uint32_t format;    // DXGI_FORMAT
+	uint32_t width;     // Size of the top mip in subresources
+	uint32_t height;
+	uint32_t depth;
+	uint32_t mipCount;  // Mips in subresources, ones skipped by maxSize are not counted
+	uint32_t arraySize;
+	bool cubeMap;
+	std::vector<TextureSubresource> subresources; // Point into the file or pixels, mip by mip for each array item
+	std::vector<uint8_t> pixels;                  // Converted from a legacy format, empty when the file is used as is
+
+	// Whole file, including skipped mips
+	uint32_t fileWidth;
+	uint32_t fileHeight;
+	std::vector<uint64_t> mipSizes; // Bytes of each mip level for all array items
+};
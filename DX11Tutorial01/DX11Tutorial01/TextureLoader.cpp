@@ -0,0 +1,223 @@
+#include "TextureLoader.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "JobSystem.h"
+#include "Platform.h"
+#include "Profiler.h"
+
+static const uint32_t DDSMagic = 0x20534444; // "DDS "
+static const size_t DDSHeaderSize = 4 + 124; // Magic and DDS_HEADER
+
+bool StubTextureParser::Parse(const uint8_t* pData, size_t size, size_t maxSize, JobSystem* pJobs, TextureData& data)
+{
+	UNREFERENCED_PARAMETER(maxSize);
+	UNREFERENCED_PARAMETER(pJobs);
+
+	if (size < DDSHeaderSize)
+	{
+		return false;
+	}
+
+	uint32_t magic = 0;
+	memcpy(&magic, pData, sizeof(magic));
+	if (magic != DDSMagic)
+	{
+		return false;
+	}
+
+	data = TextureData();
+	data.dimension = 3; // D3D11_RESOURCE_DIMENSION_TEXTURE2D
+	data.width = 1;
+	data.height = 1;
+	data.depth = 1;
+	data.mipCount = 1;
+	data.arraySize = 1;
+	data.cubeMap = false;
+	data.subresources.push_back(TextureSubresource{ pData + DDSHeaderSize, (uint32_t)(size - DDSHeaderSize), (uint32_t)(size - DDSHeaderSize) });
+	data.fileWidth = 1;
+	data.fileHeight = 1;
+	data.mipSizes.push_back(size - DDSHeaderSize);
+
+	return true;
+}
+
+TextureLoader::TextureLoader()
+	: m_pParser(NULL)
+	, m_pArchive(NULL)
+	, m_pJobs(NULL)
+	, m_stop(false)
+	, m_pendingCount(0)
+	, m_nextId(0)
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+	Term();
+}
+
+void TextureLoader::Init(ITextureParser* pParser, unsigned int threadCount, const TextureArchive* pArchive, JobSystem* pJobs)
+{
+	assert(m_threads.empty());
+
+	m_pParser = pParser;
+	m_pArchive = pArchive;
+	m_pJobs = pJobs;
+	m_stop = false;
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		m_threads.push_back(std::thread(&TextureLoader::WorkerLoop, this));
+	}
+}
+
+void TextureLoader::Term()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_requestAdded.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+	m_threads.clear();
+
+	m_requests.clear();
+	m_queue.clear();
+	m_completed.clear();
+	m_pendingCount = 0;
+	m_pParser = NULL;
+	m_pArchive = NULL;
+	m_pJobs = NULL;
+}
+
+TextureLoader::LoadId TextureLoader::Load(const std::string& path, size_t maxSize)
+{
+	assert(!m_threads.empty());
+
+	std::unique_ptr<Request> request(new Request());
+	request->path = path;
+	request->maxSize = maxSize;
+	request->succeeded = false;
+
+	LoadId id;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		id = m_nextId++;
+		m_requests[id] = std::move(request);
+		m_queue.push_back(id);
+		m_pendingCount++;
+	}
+	m_requestAdded.notify_one();
+
+	return id;
+}
+
+void TextureLoader::PopCompleted(std::vector<LoadId>& loads)
+{
+	loads.clear();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	loads.swap(m_completed);
+}
+
+bool TextureLoader::IsSucceeded(LoadId id) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_requests.at(id)->succeeded;
+}
+
+const std::string& TextureLoader::GetPath(LoadId id) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_requests.at(id)->path;
+}
+
+const TextureData& TextureLoader::GetData(LoadId id) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_requests.at(id)->data;
+}
+
+void TextureLoader::Release(LoadId id)
+{
+	std::unique_ptr<Request> request;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_requests.find(id);
+		assert(it != m_requests.end());
+		request = std::move(it->second);
+		m_requests.erase(it);
+	}
+
+	// File is unmapped outside of the lock
+	request.reset();
+}
+
+unsigned int TextureLoader::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pendingCount;
+}
+
+void TextureLoader::WorkerLoop()
+{
+	Profiler::SetThreadName("Texture loader");
+
+	// Parsing goes on without jobs when there is no worker left
+	JobSystem* pJobs = m_pJobs != NULL && m_pJobs->Attach() ? m_pJobs : NULL;
+
+	for (;;)
+	{
+		Request* pRequest = NULL;
+		LoadId id = InvalidLoadId;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_requestAdded.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+			if (m_stop)
+			{
+				break;
+			}
+
+			id = m_queue.front();
+			m_queue.pop_front();
+			pRequest = m_requests[id].get();
+		}
+
+		PROFILE_SCOPE("Texture load");
+
+		// Request is owned by this thread until it is completed
+		const uint8_t* pData = NULL;
+		size_t size = 0;
+		bool succeeded = m_pArchive != NULL && m_pArchive->Find(pRequest->path, &pData, &size);
+		if (!succeeded && pRequest->file.Open(pRequest->path.c_str()))
+		{
+			pData = pRequest->file.GetData();
+			size = pRequest->file.GetSize();
+			succeeded = true;
+		}
+		if (succeeded)
+		{
+			MappedFile::Prefault(pData, size);
+			succeeded = m_pParser->Parse(pData, size, pRequest->maxSize, pJobs, pRequest->data);
+		}
+		if (!succeeded)
+		{
+			pRequest->file.Close();
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		pRequest->succeeded = succeeded;
+		m_completed.push_back(id);
+		m_pendingCount--;
+	}
+
+	if (pJobs != NULL)
+	{
+		pJobs->Detach();
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "MappedFile.h"
+#include "TextureArchive.h"
+#include "TextureData.h"
+
+class JobSystem;
+
+class ITextureParser
+{
+public:
+	virtual ~ITextureParser() {}
+
+	// May be called from several threads at once, mips bigger than maxSize are skipped (0 - none)
+	// Mips made by the parser are split between jobs when pJobs is given, the caller is a worker then
+	virtual bool Parse(const uint8_t* pData, size_t size, size_t maxSize, JobSystem* pJobs, TextureData& data) = 0;
+};
+
+// Parser which only checks the DDS magic and makes one subresource of the rest, to run loads without a device
+class StubTextureParser : public ITextureParser
+{
+public:
+	virtual bool Parse(const uint8_t* pData, size_t size, size_t maxSize, JobSystem* pJobs, TextureData& data);
+};
+
+// Reads and parses texture files on background threads
+// Files are mapped and their pages are touched on a loader thread, so resource creation on the
+// render thread does not wait for disk
+// Paths found in the archive are served from it, others are loaded as loose files
+// Finished loads are taken from the completion queue and released once resources are created
+class TextureLoader
+{
+public:
+	typedef unsigned int LoadId;
+	static const LoadId InvalidLoadId = ~0u;
+
+	TextureLoader();
+	~TextureLoader();
+
+	// Archive has to stay open until Term
+	// Loader threads attach to pJobs for parsing, it needs threadCount attached workers and has to outlive Term
+	void Init(ITextureParser* pParser, unsigned int threadCount, const TextureArchive* pArchive = NULL, JobSystem* pJobs = NULL);
+	// Loads not started yet are dropped, finished ones are released
+	void Term();
+
+	// Thread safe
+	LoadId Load(const std::string& path, size_t maxSize);
+
+	// Loads finished since the previous call, failed ones included
+	void PopCompleted(std::vector<LoadId>& loads);
+
+	// Valid for popped loads until they are released
+	bool IsSucceeded(LoadId id) const;
+	const std::string& GetPath(LoadId id) const;
+	const TextureData& GetData(LoadId id) const;
+	// Unmaps the file, so subresources become invalid
+	void Release(LoadId id);
+
+	// Loads queued or in progress
+	unsigned int GetPendingCount() const;
+
+private:
+	struct Request
+	{
+		std::string path;
+		size_t maxSize;
+
+		bool succeeded;
+		MappedFile file; // Not open for archive entries
+		TextureData data;
+	};
+
+	void WorkerLoop();
+
+private:
+	ITextureParser* m_pParser;
+	const TextureArchive* m_pArchive;
+	JobSystem* m_pJobs;
+	std::vector<std::thread> m_threads;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_requestAdded;
+	bool m_stop;
+
+	std::unordered_map<LoadId, std::unique_ptr<Request>> m_requests;
+	std::deque<LoadId> m_queue;
+	std::vector<LoadId> m_completed;
+	unsigned int m_pendingCount;
+	LoadId m_nextId;
+};
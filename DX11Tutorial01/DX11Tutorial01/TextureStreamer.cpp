@@ -0,0 +1,231 @@
+#include "TextureStreamer.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+
+TextureStreamer::TextureStreamer()
+	: m_budget(0)
+	, m_streamBudget(0)
+	, m_minResidentSize(0)
+	, m_residentSize(0)
+	, m_frame(0)
+{
+}
+
+void TextureStreamer::Init(uint64_t budget, uint64_t streamBudget, unsigned int minResidentSize)
+{
+	m_budget = budget;
+	m_streamBudget = streamBudget;
+	m_minResidentSize = minResidentSize;
+	m_residentSize = 0;
+	m_frame = 0;
+}
+
+void TextureStreamer::Term()
+{
+	m_textures.clear();
+	m_residentSize = 0;
+}
+
+TextureStreamer::TextureId TextureStreamer::Add(unsigned int width, unsigned int height, const std::vector<uint64_t>& mipSizes)
+{
+	assert(!mipSizes.empty());
+
+	Texture texture;
+	texture.width = width;
+	texture.height = height;
+	texture.mipSizes = mipSizes;
+	texture.mipLastUse.assign(mipSizes.size(), 0);
+	texture.screenSize = 0;
+
+	// First mip which fits into the minimal size, or the smallest one
+	unsigned int mipCount = (unsigned int)mipSizes.size();
+	texture.pinnedMip = mipCount - 1;
+	for (unsigned int mip = 0; mip < mipCount; mip++)
+	{
+		if (std::max(width >> mip, height >> mip) <= m_minResidentSize)
+		{
+			texture.pinnedMip = mip;
+			break;
+		}
+	}
+	texture.residentMip = texture.pinnedMip;
+	texture.reportedMip = texture.pinnedMip;
+	texture.wantedMip = texture.pinnedMip;
+
+	// Pinned mips are counted even if they do not fit, they are needed to draw anything
+	for (unsigned int mip = texture.pinnedMip; mip < mipCount; mip++)
+	{
+		m_residentSize += mipSizes[mip];
+	}
+
+	m_textures.push_back(texture);
+	return (TextureId)m_textures.size() - 1;
+}
+
+void TextureStreamer::RequestUsage(TextureId id, float screenSize)
+{
+	Texture& texture = m_textures[id];
+	texture.screenSize = std::max(texture.screenSize, screenSize);
+}
+
+void TextureStreamer::Update(std::vector<Change>& changes)
+{
+	uint64_t frame = ++m_frame;
+
+	// Wanted mips of this update, unused textures need nothing above their pinned mips
+	std::vector<TextureId> requests;
+	for (TextureId id = 0; id < m_textures.size(); id++)
+	{
+		Texture& texture = m_textures[id];
+		if (texture.screenSize > 0)
+		{
+			texture.wantedMip = GetMipForScreenSize(texture, texture.screenSize);
+			for (size_t mip = texture.wantedMip; mip < texture.mipLastUse.size(); mip++)
+			{
+				texture.mipLastUse[mip] = frame;
+			}
+		}
+		else
+		{
+			texture.wantedMip = texture.pinnedMip;
+		}
+		texture.screenSize = 0;
+
+		if (texture.wantedMip < texture.residentMip)
+		{
+			requests.push_back(id);
+		}
+	}
+
+	// Budget could be lowered, mips wanted now are evicted only if nothing else is left
+	if (m_residentSize > m_budget && !Evict(0, frame, InvalidTextureId) && !Evict(0, frame + 1, InvalidTextureId))
+	{
+		// Pinned mips alone do not fit
+		for (Texture& texture : m_textures)
+		{
+			for (; texture.residentMip < texture.pinnedMip; texture.residentMip++)
+			{
+				m_residentSize -= texture.mipSizes[texture.residentMip];
+			}
+		}
+	}
+
+	// Textures furthest from their wanted mips first
+	std::stable_sort(requests.begin(), requests.end(), [this](TextureId a, TextureId b)
+	{
+		return m_textures[a].residentMip - m_textures[a].wantedMip > m_textures[b].residentMip - m_textures[b].wantedMip;
+	});
+
+	uint64_t streamed = 0;
+	for (TextureId id : requests)
+	{
+		Texture& texture = m_textures[id];
+		uint64_t size = texture.mipSizes[texture.residentMip - 1];
+		if (m_streamBudget != 0 && streamed != 0 && streamed + size > m_streamBudget)
+		{
+			break;
+		}
+
+		// Only mips nobody wanted in this update make room
+		if (!Evict(size, frame, id))
+		{
+			continue;
+		}
+
+		texture.residentMip--;
+		m_residentSize += size;
+		streamed += size;
+	}
+
+	changes.clear();
+	for (TextureId id = 0; id < m_textures.size(); id++)
+	{
+		Texture& texture = m_textures[id];
+		if (texture.residentMip != texture.reportedMip)
+		{
+			texture.reportedMip = texture.residentMip;
+			changes.push_back(Change{ id, texture.residentMip });
+		}
+	}
+}
+
+// Mip whose size is closest to the screen size from above, so there is at least one texel per pixel
+unsigned int TextureStreamer::GetMipForScreenSize(const Texture& texture, float screenSize) const
+{
+	float size = (float)std::max(texture.width, texture.height);
+	float mip = floorf(log2f(size / screenSize));
+
+	return (unsigned int)std::min(std::max(mip, 0.0f), (float)texture.pinnedMip);
+}
+
+bool TextureStreamer::Evict(uint64_t size, uint64_t lastUse, TextureId keepId)
+{
+	if (m_residentSize + size <= m_budget)
+	{
+		return true;
+	}
+
+	// Nothing is evicted if it would not be enough anyway
+	uint64_t needed = m_residentSize + size - m_budget;
+	if (GetEvictableSize(lastUse, keepId) < needed)
+	{
+		return false;
+	}
+
+	while (m_residentSize + size > m_budget)
+	{
+		// Biggest resident mip is the least recently used one of its texture,
+		// ties go to the bigger mip, then to the lower id
+		TextureId victim = InvalidTextureId;
+		for (TextureId id = 0; id < m_textures.size(); id++)
+		{
+			const Texture& texture = m_textures[id];
+			if (id == keepId || texture.residentMip >= texture.pinnedMip || texture.mipLastUse[texture.residentMip] >= lastUse)
+			{
+				continue;
+			}
+			if (victim == InvalidTextureId)
+			{
+				victim = id;
+				continue;
+			}
+
+			const Texture& best = m_textures[victim];
+			uint64_t use = texture.mipLastUse[texture.residentMip];
+			uint64_t bestUse = best.mipLastUse[best.residentMip];
+			if (use < bestUse || (use == bestUse && texture.mipSizes[texture.residentMip] > best.mipSizes[best.residentMip]))
+			{
+				victim = id;
+			}
+		}
+
+		assert(victim != InvalidTextureId);
+		Texture& texture = m_textures[victim];
+		m_residentSize -= texture.mipSizes[texture.residentMip];
+		texture.residentMip++;
+	}
+
+	return true;
+}
+
+uint64_t TextureStreamer::GetEvictableSize(uint64_t lastUse, TextureId keepId) const
+{
+	uint64_t size = 0;
+	for (TextureId id = 0; id < m_textures.size(); id++)
+	{
+		const Texture& texture = m_textures[id];
+		if (id == keepId)
+		{
+			continue;
+		}
+
+		for (unsigned int mip = texture.residentMip; mip < texture.pinnedMip && texture.mipLastUse[mip] < lastUse; mip++)
+		{
+			size += texture.mipSizes[mip];
+		}
+	}
+	return size;
+}
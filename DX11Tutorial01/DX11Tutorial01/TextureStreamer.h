@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+// Decides which mips of streamed textures are resident under a memory budget
+// A texture always keeps a contiguous chain from its resident mip down to the smallest one,
+// so it can be recreated with the resident mip as the top one when residency changes
+// Textures start with their small mips only, bigger ones are streamed in one level per update
+// while they are used on screen, and least recently used mips are evicted to stay in budget
+// Nothing here depends on time or the device, so the same usage always gives the same residency
+class TextureStreamer
+{
+public:
+	typedef unsigned int TextureId;
+	static const TextureId InvalidTextureId = ~0u;
+
+	struct Change
+	{
+		TextureId id;
+		unsigned int residentMip;
+	};
+
+	TextureStreamer();
+
+	// Mips not bigger than minResidentSize are never evicted, streamBudget limits bytes streamed in per update (0 - no limit)
+	void Init(uint64_t budget, uint64_t streamBudget, unsigned int minResidentSize);
+	void Term();
+
+	// mipSizes are in bytes from the biggest mip to the smallest one, width and height are of mip 0
+	TextureId Add(unsigned int width, unsigned int height, const std::vector<uint64_t>& mipSizes);
+
+	// Reports on screen size in pixels of one texture repeat, the largest use in a frame counts
+	void RequestUsage(TextureId id, float screenSize);
+
+	// Applies usage reported since the previous update, changes get textures whose resident mip changed
+	void Update(std::vector<Change>& changes);
+
+	// Lowering the budget evicts mips on the next update
+	void SetBudget(uint64_t budget) { m_budget = budget; }
+
+	unsigned int GetResidentMip(TextureId id) const { return m_textures[id].residentMip; }
+	unsigned int GetWantedMip(TextureId id) const { return m_textures[id].wantedMip; }
+	unsigned int GetMipCount(TextureId id) const { return (unsigned int)m_textures[id].mipSizes.size(); }
+	uint64_t GetResidentSize() const { return m_residentSize; }
+	uint64_t GetBudget() const { return m_budget; }
+	uint64_t GetFrame() const { return m_frame; }
+
+private:
+	struct Texture
+	{
+		unsigned int width;
+		unsigned int height;
+		std::vector<uint64_t> mipSizes;
+		std::vector<uint64_t> mipLastUse; // Last update the mip was wanted in, never smaller for smaller mips
+		unsigned int residentMip;
+		unsigned int reportedMip; // Resident mip the caller knows about
+		unsigned int pinnedMip;   // This and smaller mips are never evicted
+		unsigned int wantedMip;
+		float screenSize;         // Largest use since the previous update
+	};
+
+	unsigned int GetMipForScreenSize(const Texture& texture, float screenSize) const;
+	// Evicts least recently used mips not wanted after lastUse until size fits the budget
+	bool Evict(uint64_t size, uint64_t lastUse, TextureId keepId);
+	uint64_t GetEvictableSize(uint64_t lastUse, TextureId keepId) const;
+
+private:
+	std::vector<Texture> m_textures;
+
+	uint64_t m_budget;
+	uint64_t m_streamBudget;
+	unsigned int m_minResidentSize;
+
+	uint64_t m_residentSize;
+	uint64_t m_frame;
+};
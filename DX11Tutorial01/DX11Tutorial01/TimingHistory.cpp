@@ -0,0 +1,61 @@
+#include "TimingHistory.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+TimingHistory::TimingHistory()
+{
+	Clear();
+}
+
+void TimingHistory::Add(double ms)
+{
+	m_samples[m_next] = ms;
+	m_next = (m_next + 1) % HistorySize;
+	m_count = m_count < HistorySize ? m_count + 1 : HistorySize;
+}
+
+void TimingHistory::Clear()
+{
+	memset(m_samples, 0, sizeof(m_samples));
+	m_next = 0;
+	m_count = 0;
+}
+
+double TimingHistory::GetLast() const
+{
+	return m_count != 0 ? m_samples[(m_next + HistorySize - 1) % HistorySize] : 0.0;
+}
+
+double TimingHistory::GetMin() const
+{
+	return m_count != 0 ? *std::min_element(m_samples, m_samples + m_count) : 0.0;
+}
+
+double TimingHistory::GetAverage() const
+{
+	double sum = 0.0;
+	for (unsigned int i = 0; i < m_count; i++)
+	{
+		sum += m_samples[i];
+	}
+	return m_count != 0 ? sum / m_count : 0.0;
+}
+
+double TimingHistory::GetPercentile(double percent) const
+{
+	if (m_count == 0)
+	{
+		return 0.0;
+	}
+
+	double rank = ceil(percent / 100.0 * m_count);
+	unsigned int index = rank < 1.0 ? 0 : (rank > m_count ? m_count - 1 : (unsigned int)rank - 1);
+
+	double samples[HistorySize];
+	memcpy(samples, m_samples, m_count * sizeof(double));
+	std::nth_element(samples, samples + index, samples + m_count);
+	return samples[index];
+}
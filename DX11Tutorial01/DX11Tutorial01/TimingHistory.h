@@ -0,0 +1,26 @@
+#pragma once
+
+// Rolling statistics of the last samples, older ones are overwritten
+class TimingHistory
+{
+public:
+	static const unsigned int HistorySize = 128;
+
+	TimingHistory();
+
+	void Add(double ms);
+	void Clear();
+
+	unsigned int GetCount() const { return m_count; }
+	double GetLast() const;
+	// All are 0 while there are no samples
+	double GetMin() const;
+	double GetAverage() const;
+	// Nearest rank, 99 gives the 99th percentile
+	double GetPercentile(double percent) const;
+
+private:
+	double m_samples[HistorySize];
+	unsigned int m_next;
+	unsigned int m_count;
+};
@@ -1,3 +1,8 @@
+// Permutation features, see ShaderPermutations.h
+#ifndef OIT
+#define OIT 0
+#endif
+
 cbuffer ModelBuffer : register(b0)
 {
     float4x4 modelMatrix;
@@ -5,17 +10,11 @@ cbuffer ModelBuffer : register(b0)
 	float4 objColor;
 }
 
-struct Light
-{
-	float4 pos;
-	float4 color;
-};
-
 cbuffer SceneBuffer : register(b1)
 {
     float4x4 VP;
 	int4 lightParams;
-	Light lights[4];
+	float4 clusterParams;
 }
 
 struct VSInput
@@ -37,7 +36,31 @@ VSOutput VS(in VSInput vertex)
 	return output;
 }
 
+#if OIT
+struct PSOutput
+{
+	float4 accum : SV_Target0;
+	float revealage : SV_Target1;
+};
+
+// Weighted blended order-independent transparency
+PSOutput PS(in VSOutput input)
+{
+	float4 color = objColor;
+
+	// Depth weight from view space depth (SV_Position.w)
+	float depth = input.pos.w;
+	float weight = color.a * clamp(10.0 / (1e-5 + pow(depth / 5.0, 2.0) + pow(depth / 200.0, 6.0)), 1e-2, 3e3);
+
+	PSOutput output;
+	output.accum = float4(color.rgb * color.a, color.a) * weight;
+	output.revealage = color.a;
+
+	return output;
+}
+#else
 float4 PS(in VSOutput input) : SV_Target0
 {
 	return objColor;
 }
+#endif
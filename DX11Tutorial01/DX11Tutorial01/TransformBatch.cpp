@@ -0,0 +1,332 @@
+#include "TransformBatch.h"
+
+#include <assert.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TRANSFORM_BATCH_SSE 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// AVX code is built for the instruction set alone and picked at run time
+#if defined(TRANSFORM_BATCH_SSE) && !defined(_MSC_VER)
+#define TARGET_AVX __attribute__((target("avx")))
+#else
+#define TARGET_AVX
+#endif
+
+using namespace DirectX;
+
+void ComputeModelNormalMatricesScalar(const XMFLOAT4X4* pWorld, unsigned int count, unsigned int flags,
+	XMFLOAT4X4* pModel, XMFLOAT4X4* pNormal)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const XMFLOAT4X4& world = pWorld[i];
+
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				pModel[i].m[c][r] = world.m[r][c];
+			}
+		}
+
+		// Rows of inverse-transpose of 3x3 part
+		float n[3][3];
+		if (flags & TRANSFORM_BATCH_UNIFORM_SCALE)
+		{
+			// Orthogonal rows of equal length s, so inverse-transpose is the matrix itself divided by s^2
+			float invScale2 = 1.0f / (world._11 * world._11 + world._12 * world._12 + world._13 * world._13);
+			for (int r = 0; r < 3; r++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					n[r][c] = world.m[r][c] * invScale2;
+				}
+			}
+		}
+		else
+		{
+			// Cofactor rows are cross products of the other two rows
+			for (int r = 0; r < 3; r++)
+			{
+				const float* a = world.m[(r + 1) % 3];
+				const float* b = world.m[(r + 2) % 3];
+				n[r][0] = a[1] * b[2] - a[2] * b[1];
+				n[r][1] = a[2] * b[0] - a[0] * b[2];
+				n[r][2] = a[0] * b[1] - a[1] * b[0];
+			}
+			float invDet = 1.0f / (world._11 * n[0][0] + world._12 * n[0][1] + world._13 * n[0][2]);
+			for (int r = 0; r < 3; r++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					n[r][c] *= invDet;
+				}
+			}
+		}
+
+		XMFLOAT4X4& normal = pNormal[i];
+		for (int c = 0; c < 3; c++)
+		{
+			normal.m[c][0] = n[0][c];
+			normal.m[c][1] = n[1][c];
+			normal.m[c][2] = n[2][c];
+			normal.m[c][3] = 0.0f;
+		}
+		normal._41 = 0.0f;
+		normal._42 = 0.0f;
+		normal._43 = 0.0f;
+		normal._44 = 1.0f;
+	}
+}
+
+#ifdef TRANSFORM_BATCH_SSE
+namespace
+{
+	const __m128 LastRow = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+	// Store transposed world matrix, returns its rows transposed (columns of world)
+	inline void StoreModel(const XMFLOAT4X4& world, XMFLOAT4X4& model, __m128 columns[4])
+	{
+		columns[0] = _mm_loadu_ps(world.m[0]);
+		columns[1] = _mm_loadu_ps(world.m[1]);
+		columns[2] = _mm_loadu_ps(world.m[2]);
+		columns[3] = _mm_loadu_ps(world.m[3]);
+		_MM_TRANSPOSE4_PS(columns[0], columns[1], columns[2], columns[3]);
+
+		_mm_storeu_ps(model.m[0], columns[0]);
+		_mm_storeu_ps(model.m[1], columns[1]);
+		_mm_storeu_ps(model.m[2], columns[2]);
+		_mm_storeu_ps(model.m[3], columns[3]);
+	}
+
+	void ComputeUniformSSE(const XMFLOAT4X4& world, XMFLOAT4X4& model, XMFLOAT4X4& normal)
+	{
+		__m128 columns[4];
+		StoreModel(world, model, columns);
+
+		// Lane 0 holds squared length of the first row
+		__m128 scale2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(columns[0], columns[0]), _mm_mul_ps(columns[1], columns[1])), _mm_mul_ps(columns[2], columns[2]));
+		__m128 invScale2 = _mm_div_ps(_mm_set1_ps(1.0f), _mm_shuffle_ps(scale2, scale2, _MM_SHUFFLE(0, 0, 0, 0)));
+
+		// Drop translation from the w lane
+		const __m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+		invScale2 = _mm_and_ps(invScale2, mask);
+
+		_mm_storeu_ps(normal.m[0], _mm_mul_ps(columns[0], invScale2));
+		_mm_storeu_ps(normal.m[1], _mm_mul_ps(columns[1], invScale2));
+		_mm_storeu_ps(normal.m[2], _mm_mul_ps(columns[2], invScale2));
+		_mm_storeu_ps(normal.m[3], LastRow);
+	}
+
+	// Four matrices per step, each lane of a vector belongs to its own matrix
+	void ComputeGeneralSSE(const XMFLOAT4X4* pWorld, XMFLOAT4X4* pModel, XMFLOAT4X4* pNormal)
+	{
+		__m128 columns[4];
+		for (int k = 0; k < 4; k++)
+		{
+			StoreModel(pWorld[k], pModel[k], columns);
+		}
+
+		// a[r][c] - element (r, c) of all four matrices
+		__m128 a[3][4];
+		for (int r = 0; r < 3; r++)
+		{
+			a[r][0] = _mm_loadu_ps(pWorld[0].m[r]);
+			a[r][1] = _mm_loadu_ps(pWorld[1].m[r]);
+			a[r][2] = _mm_loadu_ps(pWorld[2].m[r]);
+			a[r][3] = _mm_loadu_ps(pWorld[3].m[r]);
+			_MM_TRANSPOSE4_PS(a[r][0], a[r][1], a[r][2], a[r][3]);
+		}
+
+		// n[r][c] - element (r, c) of cofactor matrix
+		__m128 n[3][3];
+		for (int r = 0; r < 3; r++)
+		{
+			const __m128* x = a[(r + 1) % 3];
+			const __m128* y = a[(r + 2) % 3];
+			n[r][0] = _mm_sub_ps(_mm_mul_ps(x[1], y[2]), _mm_mul_ps(x[2], y[1]));
+			n[r][1] = _mm_sub_ps(_mm_mul_ps(x[2], y[0]), _mm_mul_ps(x[0], y[2]));
+			n[r][2] = _mm_sub_ps(_mm_mul_ps(x[0], y[1]), _mm_mul_ps(x[1], y[0]));
+		}
+
+		__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0][0], n[0][0]), _mm_mul_ps(a[0][1], n[0][1])), _mm_mul_ps(a[0][2], n[0][2]));
+		__m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+		for (int c = 0; c < 3; c++)
+		{
+			__m128 row0 = _mm_mul_ps(n[0][c], invDet);
+			__m128 row1 = _mm_mul_ps(n[1][c], invDet);
+			__m128 row2 = _mm_mul_ps(n[2][c], invDet);
+			__m128 row3 = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+			_mm_storeu_ps(pNormal[0].m[c], row0);
+			_mm_storeu_ps(pNormal[1].m[c], row1);
+			_mm_storeu_ps(pNormal[2].m[c], row2);
+			_mm_storeu_ps(pNormal[3].m[c], row3);
+		}
+		for (int k = 0; k < 4; k++)
+		{
+			_mm_storeu_ps(pNormal[k].m[3], LastRow);
+		}
+	}
+
+	// Transpose 4x4 blocks in both 128-bit halves independently
+	TARGET_AVX inline void Transpose256(__m256& r0, __m256& r1, __m256& r2, __m256& r3)
+	{
+		__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+		__m256 t1 = _mm256_unpackhi_ps(r0, r1);
+		__m256 t2 = _mm256_unpacklo_ps(r2, r3);
+		__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+		r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	}
+
+	TARGET_AVX inline __m256 LoadRows(const XMFLOAT4X4& low, const XMFLOAT4X4& high, int r)
+	{
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(low.m[r])), _mm_loadu_ps(high.m[r]), 1);
+	}
+
+	// Eight matrices per step, lane k holds matrix k
+	TARGET_AVX void ComputeGeneralAVX(const XMFLOAT4X4* pWorld, XMFLOAT4X4* pModel, XMFLOAT4X4* pNormal)
+	{
+		__m128 columns[4];
+		for (int k = 0; k < 8; k++)
+		{
+			StoreModel(pWorld[k], pModel[k], columns);
+		}
+
+		__m256 a[3][4];
+		for (int r = 0; r < 3; r++)
+		{
+			for (int k = 0; k < 4; k++)
+			{
+				a[r][k] = LoadRows(pWorld[k], pWorld[k + 4], r);
+			}
+			Transpose256(a[r][0], a[r][1], a[r][2], a[r][3]);
+		}
+
+		__m256 n[3][3];
+		for (int r = 0; r < 3; r++)
+		{
+			const __m256* x = a[(r + 1) % 3];
+			const __m256* y = a[(r + 2) % 3];
+			n[r][0] = _mm256_sub_ps(_mm256_mul_ps(x[1], y[2]), _mm256_mul_ps(x[2], y[1]));
+			n[r][1] = _mm256_sub_ps(_mm256_mul_ps(x[2], y[0]), _mm256_mul_ps(x[0], y[2]));
+			n[r][2] = _mm256_sub_ps(_mm256_mul_ps(x[0], y[1]), _mm256_mul_ps(x[1], y[0]));
+		}
+
+		__m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[0][0], n[0][0]), _mm256_mul_ps(a[0][1], n[0][1])), _mm256_mul_ps(a[0][2], n[0][2]));
+		__m256 invDet = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+
+		for (int c = 0; c < 3; c++)
+		{
+			__m256 rows[4] = {
+				_mm256_mul_ps(n[0][c], invDet),
+				_mm256_mul_ps(n[1][c], invDet),
+				_mm256_mul_ps(n[2][c], invDet),
+				_mm256_setzero_ps()
+			};
+			Transpose256(rows[0], rows[1], rows[2], rows[3]);
+
+			for (int k = 0; k < 4; k++)
+			{
+				_mm_storeu_ps(pNormal[k].m[c], _mm256_castps256_ps128(rows[k]));
+				_mm_storeu_ps(pNormal[k + 4].m[c], _mm256_extractf128_ps(rows[k], 1));
+			}
+		}
+		for (int k = 0; k < 8; k++)
+		{
+			_mm_storeu_ps(pNormal[k].m[3], LastRow);
+		}
+	}
+
+	// Needs OS support for the upper halves of YMM registers, not only the CPU flag
+	bool IsAVXSupported()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 1);
+		const int OSXSAVE = 1 << 27;
+		const int AVX = 1 << 28;
+		return (info[2] & (OSXSAVE | AVX)) == (OSXSAVE | AVX) && (_xgetbv(0) & 6) == 6;
+#else
+		return __builtin_cpu_supports("avx") != 0;
+#endif
+	}
+}
+#endif // TRANSFORM_BATCH_SSE
+
+static TransformBatchPath DetectTransformBatchPath()
+{
+#ifdef TRANSFORM_BATCH_SSE
+	return IsAVXSupported() ? TRANSFORM_BATCH_PATH_AVX : TRANSFORM_BATCH_PATH_SSE;
+#else
+	return TRANSFORM_BATCH_PATH_SCALAR;
+#endif
+}
+
+TransformBatchPath GetTransformBatchPath()
+{
+	static const TransformBatchPath path = DetectTransformBatchPath();
+	return path;
+}
+
+bool IsTransformBatchPathSupported(TransformBatchPath path)
+{
+	return path <= GetTransformBatchPath();
+}
+
+void ComputeModelNormalMatrices(const XMFLOAT4X4* pWorld, unsigned int count, unsigned int flags,
+	XMFLOAT4X4* pModel, XMFLOAT4X4* pNormal)
+{
+	ComputeModelNormalMatrices(pWorld, count, flags, pModel, pNormal, GetTransformBatchPath());
+}
+
+void ComputeModelNormalMatrices(const XMFLOAT4X4* pWorld, unsigned int count, unsigned int flags,
+	XMFLOAT4X4* pModel, XMFLOAT4X4* pNormal, TransformBatchPath path)
+{
+	assert(IsTransformBatchPathSupported(path));
+
+	unsigned int i = 0;
+	switch (path)
+	{
+#ifdef TRANSFORM_BATCH_SSE
+	case TRANSFORM_BATCH_PATH_SSE:
+	case TRANSFORM_BATCH_PATH_AVX:
+		if (flags & TRANSFORM_BATCH_UNIFORM_SCALE)
+		{
+			for (; i < count; i++)
+			{
+				ComputeUniformSSE(pWorld[i], pModel[i], pNormal[i]);
+			}
+		}
+		else
+		{
+			if (path == TRANSFORM_BATCH_PATH_AVX)
+			{
+				for (; i + 8 <= count; i += 8)
+				{
+					ComputeGeneralAVX(pWorld + i, pModel + i, pNormal + i);
+				}
+			}
+			for (; i + 4 <= count; i += 4)
+			{
+				ComputeGeneralSSE(pWorld + i, pModel + i, pNormal + i);
+			}
+		}
+		break;
+#endif
+	default:
+		break;
+	}
+
+	ComputeModelNormalMatricesScalar(pWorld + i, count - i, flags, pModel + i, pNormal + i);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+enum TransformBatchFlags
+{
+	TRANSFORM_BATCH_GENERAL = 0,
+	TRANSFORM_BATCH_UNIFORM_SCALE = 1 // All matrices are rotation, uniform scale and translation only
+};
+
+enum TransformBatchPath
+{
+	TRANSFORM_BATCH_PATH_SCALAR = 0,
+	TRANSFORM_BATCH_PATH_SSE, // 4 matrices per step
+	TRANSFORM_BATCH_PATH_AVX  // 8 matrices per step, SSE for the rest
+};
+
+// Best path supported by the CPU, detected once
+TransformBatchPath GetTransformBatchPath();
+bool IsTransformBatchPathSupported(TransformBatchPath path);
+
+// Compute shader ready model and normal matrices for count world matrices
+// Both outputs are stored transposed, as HLSL expects them in constant and instance buffers:
+//   pModel[i]  - transpose(world[i])
+//   pNormal[i] - transpose(inverse(transpose(world[i]))), only upper 3x3 part is meaningful
+// Uses the best path the CPU supports, scalar code for the rest
+void ComputeModelNormalMatrices(const DirectX::XMFLOAT4X4* pWorld, unsigned int count, unsigned int flags,
+	DirectX::XMFLOAT4X4* pModel, DirectX::XMFLOAT4X4* pNormal);
+void ComputeModelNormalMatrices(const DirectX::XMFLOAT4X4* pWorld, unsigned int count, unsigned int flags,
+	DirectX::XMFLOAT4X4* pModel, DirectX::XMFLOAT4X4* pNormal, TransformBatchPath path);
+
+// Scalar version of the above, used for tails and as a reference
+void ComputeModelNormalMatricesScalar(const DirectX::XMFLOAT4X4* pWorld, unsigned int count, unsigned int flags,
+	DirectX::XMFLOAT4X4* pModel, DirectX::XMFLOAT4X4* pNormal);
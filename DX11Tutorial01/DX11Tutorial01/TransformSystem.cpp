@@ -0,0 +1,141 @@
+#include "TransformSystem.h"
+
+#include <assert.h>
+
+using namespace DirectX;
+
+static bool IsUniform(const XMFLOAT3& scale)
+{
+	return scale.x == scale.y && scale.x == scale.z;
+}
+
+TransformSystem::TransformSystem()
+	: m_firstDirty(InvalidEntity)
+	, m_nonUniformCount(0)
+	, m_stamp(1)
+{
+}
+
+void TransformSystem::Reserve(unsigned int count)
+{
+	m_parents.reserve(count);
+	m_positions.reserve(count);
+	m_rotations.reserve(count);
+	m_scales.reserve(count);
+	m_world.reserve(count);
+	m_dirty.reserve(count);
+	m_updateStamps.reserve(count);
+}
+
+void TransformSystem::Clear()
+{
+	m_parents.clear();
+	m_positions.clear();
+	m_rotations.clear();
+	m_scales.clear();
+	m_world.clear();
+	m_dirty.clear();
+	m_updateStamps.clear();
+
+	m_firstDirty = InvalidEntity;
+	m_nonUniformCount = 0;
+}
+
+EntityId TransformSystem::CreateEntity(EntityId parent)
+{
+	EntityId id = (EntityId)m_parents.size();
+	assert(parent == InvalidEntity || parent < id);
+
+	m_parents.push_back(parent);
+	m_positions.push_back(XMFLOAT3(0, 0, 0));
+	m_rotations.push_back(XMFLOAT4(0, 0, 0, 1));
+	m_scales.push_back(XMFLOAT3(1, 1, 1));
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	m_world.push_back(identity);
+
+	m_dirty.push_back(0);
+	m_updateStamps.push_back(0);
+
+	MarkDirty(id);
+
+	return id;
+}
+
+void TransformSystem::SetPosition(EntityId id, const XMFLOAT3& position)
+{
+	m_positions[id] = position;
+	MarkDirty(id);
+}
+
+void TransformSystem::SetRotation(EntityId id, const XMFLOAT4& rotation)
+{
+	m_rotations[id] = rotation;
+	MarkDirty(id);
+}
+
+void TransformSystem::SetScale(EntityId id, const XMFLOAT3& scale)
+{
+	if (!IsUniform(m_scales[id]))
+	{
+		m_nonUniformCount--;
+	}
+	if (!IsUniform(scale))
+	{
+		m_nonUniformCount++;
+	}
+
+	m_scales[id] = scale;
+	MarkDirty(id);
+}
+
+unsigned int TransformSystem::Update()
+{
+	m_stamp++;
+
+	if (m_firstDirty == InvalidEntity)
+	{
+		return 0;
+	}
+
+	unsigned int updatedCount = 0;
+
+	EntityId count = (EntityId)m_parents.size();
+	for (EntityId id = m_firstDirty; id < count; id++)
+	{
+		EntityId parent = m_parents[id];
+		bool parentUpdated = parent != InvalidEntity && m_updateStamps[parent] == m_stamp;
+		if (!m_dirty[id] && !parentUpdated)
+		{
+			continue;
+		}
+
+		XMMATRIX world = XMMatrixScalingFromVector(XMLoadFloat3(&m_scales[id]))
+			* XMMatrixRotationQuaternion(XMLoadFloat4(&m_rotations[id]))
+			* XMMatrixTranslationFromVector(XMLoadFloat3(&m_positions[id]));
+		if (parent != InvalidEntity)
+		{
+			world = world * XMLoadFloat4x4(&m_world[parent]);
+		}
+		XMStoreFloat4x4(&m_world[id], world);
+
+		m_dirty[id] = 0;
+		m_updateStamps[id] = m_stamp;
+
+		updatedCount++;
+	}
+
+	m_firstDirty = InvalidEntity;
+
+	return updatedCount;
+}
+
+void TransformSystem::MarkDirty(EntityId id)
+{
+	m_dirty[id] = 1;
+	if (m_firstDirty == InvalidEntity || id < m_firstDirty)
+	{
+		m_firstDirty = id;
+	}
+}
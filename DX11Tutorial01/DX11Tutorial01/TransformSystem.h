@@ -0,0 +1,62 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+typedef unsigned int EntityId;
+
+static const EntityId InvalidEntity = 0xFFFFFFFF;
+
+// Entity transforms stored as structure of arrays
+// Parent entity must be created before its children, so world matrices are updated in one forward pass
+class TransformSystem
+{
+public:
+	TransformSystem();
+
+	void Reserve(unsigned int count);
+	void Clear();
+
+	EntityId CreateEntity(EntityId parent);
+
+	unsigned int GetEntityCount() const { return (unsigned int)m_parents.size(); }
+
+	void SetPosition(EntityId id, const DirectX::XMFLOAT3& position);
+	void SetRotation(EntityId id, const DirectX::XMFLOAT4& rotation); // Rotation quaternion
+	void SetScale(EntityId id, const DirectX::XMFLOAT3& scale);
+
+	const DirectX::XMFLOAT3& GetPosition(EntityId id) const { return m_positions[id]; }
+	const DirectX::XMFLOAT4& GetRotation(EntityId id) const { return m_rotations[id]; }
+	const DirectX::XMFLOAT3& GetScale(EntityId id) const { return m_scales[id]; }
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(EntityId id) const { return m_world[id]; }
+
+	// True if any entity has different scale factors along axes
+	bool HasNonUniformScale() const { return m_nonUniformCount > 0; }
+
+	// Recompute world matrices of changed entities and their children
+	// Returns count of recomputed world matrices
+	unsigned int Update();
+
+	// True if world matrix was recomputed by the last Update call
+	bool IsUpdated(EntityId id) const { return m_updateStamps[id] == m_stamp; }
+	// Lowest entity changed since the last Update, where it starts, InvalidEntity if there is none
+	EntityId GetFirstDirty() const { return m_firstDirty; }
+
+private:
+	void MarkDirty(EntityId id);
+
+private:
+	std::vector<EntityId> m_parents;
+
+	std::vector<DirectX::XMFLOAT3> m_positions;
+	std::vector<DirectX::XMFLOAT4> m_rotations;
+	std::vector<DirectX::XMFLOAT3> m_scales;
+	std::vector<DirectX::XMFLOAT4X4> m_world;
+
+	std::vector<unsigned char> m_dirty;
+	std::vector<unsigned int> m_updateStamps;
+
+	EntityId m_firstDirty; // No entities before this one are dirty
+	unsigned int m_nonUniformCount;
+	unsigned int m_stamp;
+};
@@ -0,0 +1,335 @@
+#pragma once
+
+// Scalar implementation of the part of DirectXMath the renderer uses, for Linux builds which could not get
+// DirectXMath itself (see README.md). Matrices are row major and vectors are rows, as in DirectXMath
+// Only the functions the tree calls are here, a build with DirectXMath is the reference
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define XM_CALLCONV
+
+namespace DirectX
+{
+
+struct alignas(16) XMVECTOR
+{
+	float f[4];
+};
+
+typedef const XMVECTOR FXMVECTOR;
+
+struct XMFLOAT2
+{
+	float x;
+	float y;
+
+	XMFLOAT2() = default;
+	XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+};
+
+struct XMFLOAT3
+{
+	float x;
+	float y;
+	float z;
+
+	XMFLOAT3() = default;
+	XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+};
+
+struct XMFLOAT4
+{
+	float x;
+	float y;
+	float z;
+	float w;
+
+	XMFLOAT4() = default;
+	XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+};
+
+struct XMFLOAT4X4
+{
+	union
+	{
+		struct
+		{
+			float _11, _12, _13, _14;
+			float _21, _22, _23, _24;
+			float _31, _32, _33, _34;
+			float _41, _42, _43, _44;
+		};
+		float m[4][4];
+	};
+};
+
+struct alignas(16) XMVECTORF32
+{
+	union
+	{
+		float f[4];
+		XMVECTOR v;
+	};
+
+	operator XMVECTOR() const { return v; }
+};
+
+struct alignas(16) XMVECTORI32
+{
+	union
+	{
+		int32_t i[4];
+		XMVECTOR v;
+	};
+
+	operator XMVECTOR() const { return v; }
+};
+
+struct alignas(16) XMMATRIX
+{
+	XMVECTOR r[4];
+};
+
+typedef const XMMATRIX& FXMMATRIX;
+typedef const XMMATRIX& CXMMATRIX;
+
+inline XMVECTOR XMVectorSet(float x, float y, float z, float w)
+{
+	XMVECTOR v = { { x, y, z, w } };
+	return v;
+}
+
+inline float XMVectorGetZ(FXMVECTOR v)
+{
+	return v.f[2];
+}
+
+inline XMMATRIX XMMatrixSet(
+	float m00, float m01, float m02, float m03,
+	float m10, float m11, float m12, float m13,
+	float m20, float m21, float m22, float m23,
+	float m30, float m31, float m32, float m33)
+{
+	XMMATRIX m;
+	m.r[0] = XMVectorSet(m00, m01, m02, m03);
+	m.r[1] = XMVectorSet(m10, m11, m12, m13);
+	m.r[2] = XMVectorSet(m20, m21, m22, m23);
+	m.r[3] = XMVectorSet(m30, m31, m32, m33);
+	return m;
+}
+
+inline XMMATRIX XMMatrixMultiply(FXMMATRIX a, CXMMATRIX b)
+{
+	XMMATRIX m;
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			m.r[i].f[j] = a.r[i].f[0] * b.r[0].f[j] + a.r[i].f[1] * b.r[1].f[j] + a.r[i].f[2] * b.r[2].f[j] + a.r[i].f[3] * b.r[3].f[j];
+		}
+	}
+	return m;
+}
+
+inline XMMATRIX operator*(FXMMATRIX a, CXMMATRIX b)
+{
+	return XMMatrixMultiply(a, b);
+}
+
+inline XMMATRIX XMMatrixIdentity()
+{
+	return XMMatrixSet(
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, 1, 0,
+		0, 0, 0, 1);
+}
+
+inline XMMATRIX XMMatrixTranspose(FXMMATRIX m)
+{
+	XMMATRIX t;
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			t.r[i].f[j] = m.r[j].f[i];
+		}
+	}
+	return t;
+}
+
+// Gauss-Jordan elimination with partial pivoting, the determinant is not returned
+inline XMMATRIX XMMatrixInverse(XMVECTOR* pDeterminant, FXMMATRIX m)
+{
+	double a[4][8];
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			a[i][j] = m.r[i].f[j];
+			a[i][j + 4] = i == j ? 1.0 : 0.0;
+		}
+	}
+
+	for (int c = 0; c < 4; c++)
+	{
+		int pivot = c;
+		for (int i = c + 1; i < 4; i++)
+		{
+			if (fabs(a[i][c]) > fabs(a[pivot][c]))
+			{
+				pivot = i;
+			}
+		}
+		for (int j = 0; j < 8; j++)
+		{
+			double t = a[c][j];
+			a[c][j] = a[pivot][j];
+			a[pivot][j] = t;
+		}
+
+		double d = a[c][c];
+		for (int j = 0; j < 8; j++)
+		{
+			a[c][j] /= d;
+		}
+		for (int i = 0; i < 4; i++)
+		{
+			if (i != c)
+			{
+				double k = a[i][c];
+				for (int j = 0; j < 8; j++)
+				{
+					a[i][j] -= k * a[c][j];
+				}
+			}
+		}
+	}
+
+	if (pDeterminant != NULL)
+	{
+		*pDeterminant = XMVectorSet(0, 0, 0, 0);
+	}
+
+	XMMATRIX inverse;
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			inverse.r[i].f[j] = (float)a[i][j + 4];
+		}
+	}
+	return inverse;
+}
+
+inline XMMATRIX XMMatrixTranslation(float x, float y, float z)
+{
+	return XMMatrixSet(
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, 1, 0,
+		x, y, z, 1);
+}
+
+inline XMMATRIX XMMatrixTranslationFromVector(FXMVECTOR v)
+{
+	return XMMatrixTranslation(v.f[0], v.f[1], v.f[2]);
+}
+
+inline XMMATRIX XMMatrixScalingFromVector(FXMVECTOR v)
+{
+	return XMMatrixSet(
+		v.f[0], 0, 0, 0,
+		0, v.f[1], 0, 0,
+		0, 0, v.f[2], 0,
+		0, 0, 0, 1);
+}
+
+inline XMMATRIX XMMatrixRotationQuaternion(FXMVECTOR q)
+{
+	float x = q.f[0];
+	float y = q.f[1];
+	float z = q.f[2];
+	float w = q.f[3];
+
+	return XMMatrixSet(
+		1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w), 0,
+		2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w), 0,
+		2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y), 0,
+		0, 0, 0, 1);
+}
+
+// Axis must be normalized
+inline XMVECTOR XMQuaternionRotationAxis(FXMVECTOR axis, float angle)
+{
+	float s = sinf(angle * 0.5f);
+	return XMVectorSet(axis.f[0] * s, axis.f[1] * s, axis.f[2] * s, cosf(angle * 0.5f));
+}
+
+inline XMMATRIX XMMatrixRotationAxis(FXMVECTOR axis, float angle)
+{
+	return XMMatrixRotationQuaternion(XMQuaternionRotationAxis(axis, angle));
+}
+
+inline XMMATRIX XMMatrixPerspectiveLH(float viewWidth, float viewHeight, float nearZ, float farZ)
+{
+	float range = farZ / (farZ - nearZ);
+	return XMMatrixSet(
+		2 * nearZ / viewWidth, 0, 0, 0,
+		0, 2 * nearZ / viewHeight, 0, 0,
+		0, 0, range, 1,
+		0, 0, -range * nearZ, 0);
+}
+
+inline XMVECTOR XMVector3TransformCoord(FXMVECTOR v, FXMMATRIX m)
+{
+	XMVECTOR r;
+	for (int c = 0; c < 4; c++)
+	{
+		r.f[c] = v.f[0] * m.r[0].f[c] + v.f[1] * m.r[1].f[c] + v.f[2] * m.r[2].f[c] + m.r[3].f[c];
+	}
+	return XMVectorSet(r.f[0] / r.f[3], r.f[1] / r.f[3], r.f[2] / r.f[3], 1);
+}
+
+inline XMVECTOR XMLoadFloat3(const XMFLOAT3* pSource)
+{
+	return XMVectorSet(pSource->x, pSource->y, pSource->z, 0);
+}
+
+inline XMVECTOR XMLoadFloat4(const XMFLOAT4* pSource)
+{
+	return XMVectorSet(pSource->x, pSource->y, pSource->z, pSource->w);
+}
+
+inline void XMStoreFloat4(XMFLOAT4* pDestination, FXMVECTOR v)
+{
+	pDestination->x = v.f[0];
+	pDestination->y = v.f[1];
+	pDestination->z = v.f[2];
+	pDestination->w = v.f[3];
+}
+
+inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* pSource)
+{
+	const float (*m)[4] = pSource->m;
+	return XMMatrixSet(
+		m[0][0], m[0][1], m[0][2], m[0][3],
+		m[1][0], m[1][1], m[1][2], m[1][3],
+		m[2][0], m[2][1], m[2][2], m[2][3],
+		m[3][0], m[3][1], m[3][2], m[3][3]);
+}
+
+inline void XMStoreFloat4x4(XMFLOAT4X4* pDestination, FXMMATRIX m)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			pDestination->m[i][j] = m.r[i].f[j];
+		}
+	}
+}
+
+}
@@ -0,0 +1,1473 @@
+#include "BlockCompress.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+// BLOCK_COMPRESS_NO_SIMD builds the scalar reference only, it gives the same blocks
+#if (defined(_M_X64) || defined(__SSE2__)) && !defined(BLOCK_COMPRESS_NO_SIMD)
+#define BLOCK_COMPRESS_SSE2
+#include <emmintrin.h>
+#endif
+
+static const unsigned int BlockPixels = 16;
+
+// BC7 2, 3 and 4 bit index weights, out of 64
+static const int BC7Weights2[4] = { 0, 21, 43, 64 };
+static const int BC7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const int BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+// Half way between neighbouring weights
+static const float BC7Thresholds2[3] = { 10.5f, 32.0f, 53.5f };
+static const float BC7Thresholds3[7] = { 4.5f, 13.5f, 22.5f, 32.0f, 41.5f, 50.5f, 59.5f };
+static const float BC7Thresholds4[15] = { 2.0f, 6.5f, 11.0f, 15.0f, 19.0f, 23.5f, 28.0f, 32.0f, 36.0f, 40.5f, 45.0f, 49.0f, 53.0f, 57.5f, 62.0f };
+static const float StepThresholds[7] = { 0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f };
+
+// Block pixels split by channel, so SIMD code processes 4 pixels at once
+struct BlockChannels
+{
+	float c[4][BlockPixels];
+};
+
+static BlockChannels LoadChannels(const uint8_t* pPixels)
+{
+	BlockChannels channels;
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			channels.c[c][i] = pPixels[i * 4 + c];
+		}
+	}
+	return channels;
+}
+
+static int Clamp(int value, int minValue, int maxValue)
+{
+	return value < minValue ? minValue : (value > maxValue ? maxValue : value);
+}
+
+//
+// Palette index search, pixels are projected on the line between endpoints
+// Axis is scaled so palette entries land on their steps or weights, thresholds lie half way between them
+//
+
+#ifndef BLOCK_COMPRESS_SSE2
+static void FindSteps(const BlockChannels& channels, const float base[4], const float axis[4],
+	const float* pThresholds, unsigned int thresholdCount, uint8_t* pSteps)
+{
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		float t = (channels.c[0][i] - base[0]) * axis[0];
+		t = t + (channels.c[1][i] - base[1]) * axis[1];
+		t = t + (channels.c[2][i] - base[2]) * axis[2];
+		t = t + (channels.c[3][i] - base[3]) * axis[3];
+
+		unsigned int step = 0;
+		for (unsigned int j = 0; j < thresholdCount; j++)
+		{
+			step += t > pThresholds[j] ? 1 : 0;
+		}
+		pSteps[i] = (uint8_t)step;
+	}
+}
+#else
+static void FindSteps(const BlockChannels& channels, const float base[4], const float axis[4],
+	const float* pThresholds, unsigned int thresholdCount, uint8_t* pSteps)
+{
+	for (unsigned int i = 0; i < BlockPixels; i += 4)
+	{
+		// Same operation order as the scalar code, so results match bit for bit
+		__m128 t = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&channels.c[0][i]), _mm_set1_ps(base[0])), _mm_set1_ps(axis[0]));
+		t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&channels.c[1][i]), _mm_set1_ps(base[1])), _mm_set1_ps(axis[1])));
+		t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&channels.c[2][i]), _mm_set1_ps(base[2])), _mm_set1_ps(axis[2])));
+		t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&channels.c[3][i]), _mm_set1_ps(base[3])), _mm_set1_ps(axis[3])));
+
+		// Comparison gives -1 where the threshold is passed
+		__m128i step = _mm_setzero_si128();
+		for (unsigned int j = 0; j < thresholdCount; j++)
+		{
+			step = _mm_sub_epi32(step, _mm_castps_si128(_mm_cmpgt_ps(t, _mm_set1_ps(pThresholds[j]))));
+		}
+
+		const __m128i step16 = _mm_packs_epi32(step, step);
+		const uint32_t steps = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(step16, step16));
+		memcpy(pSteps + i, &steps, sizeof(steps));
+	}
+}
+#endif
+
+// Axis from e0 to e1 scaled so e1 is at stepCount, zero for equal endpoints
+static void GetStepAxis(const int e0[4], const int e1[4], unsigned int channelCount, float stepCount, float base[4], float axis[4])
+{
+	int lengthSq = 0;
+	for (unsigned int c = 0; c < channelCount; c++)
+	{
+		lengthSq += (e1[c] - e0[c]) * (e1[c] - e0[c]);
+	}
+
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		base[c] = c < channelCount ? (float)e0[c] : 0.0f;
+		axis[c] = c < channelCount && lengthSq > 0 ? (e1[c] - e0[c]) * stepCount / lengthSq : 0.0f;
+	}
+}
+
+//
+// Endpoint fitting, of the first pixelCount pixels
+//
+
+// Mean and direction of the largest variance, found with power iteration
+static void ComputePrincipalAxis(const BlockChannels& channels, unsigned int pixelCount, unsigned int channelCount, float mean[4], float axis[4])
+{
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		mean[c] = 0.0f;
+		axis[c] = 0.0f;
+		for (unsigned int i = 0; c < channelCount && i < pixelCount; i++)
+		{
+			mean[c] += channels.c[c][i];
+		}
+		mean[c] /= pixelCount;
+	}
+
+	float covariance[4][4] = {};
+	for (unsigned int i = 0; i < pixelCount; i++)
+	{
+		for (unsigned int a = 0; a < channelCount; a++)
+		{
+			for (unsigned int b = 0; b < channelCount; b++)
+			{
+				covariance[a][b] += (channels.c[a][i] - mean[a]) * (channels.c[b][i] - mean[b]);
+			}
+		}
+	}
+
+	// Row of the channel with the largest variance is a good start
+	unsigned int largest = 0;
+	for (unsigned int c = 1; c < channelCount; c++)
+	{
+		largest = covariance[c][c] > covariance[largest][largest] ? c : largest;
+	}
+	float v[4] = { covariance[largest][0], covariance[largest][1], covariance[largest][2], covariance[largest][3] };
+
+	for (unsigned int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[4] = {};
+		float maxComponent = 0.0f;
+		for (unsigned int a = 0; a < channelCount; a++)
+		{
+			for (unsigned int b = 0; b < channelCount; b++)
+			{
+				next[a] += covariance[a][b] * v[b];
+			}
+			maxComponent = fabsf(next[a]) > maxComponent ? fabsf(next[a]) : maxComponent;
+		}
+		if (maxComponent == 0.0f)
+		{
+			break;
+		}
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			v[c] = next[c] / maxComponent;
+		}
+	}
+
+	float length = 0.0f;
+	for (unsigned int c = 0; c < channelCount; c++)
+	{
+		length += v[c] * v[c];
+	}
+	length = sqrtf(length);
+
+	for (unsigned int c = 0; c < channelCount; c++)
+	{
+		axis[c] = length > 0.0f ? v[c] / length : 1.0f / sqrtf((float)channelCount);
+	}
+}
+
+// Extent of the pixels along the axis
+static void GetAxisEndpoints(const BlockChannels& channels, unsigned int pixelCount, unsigned int channelCount,
+	const float mean[4], const float axis[4], float e0[4], float e1[4])
+{
+	float minT = 0.0f;
+	float maxT = 0.0f;
+	for (unsigned int i = 0; i < pixelCount; i++)
+	{
+		float t = 0.0f;
+		for (unsigned int c = 0; c < channelCount; c++)
+		{
+			t += (channels.c[c][i] - mean[c]) * axis[c];
+		}
+		minT = t < minT ? t : minT;
+		maxT = t > maxT ? t : maxT;
+	}
+
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		e0[c] = mean[c] + axis[c] * minT;
+		e1[c] = mean[c] + axis[c] * maxT;
+	}
+}
+
+// Least squares endpoints for pixels at the given positions between them (0 - e0, 1 - e1)
+static bool SolveEndpoints(const BlockChannels& channels, unsigned int pixelCount, unsigned int channelCount,
+	const float weights[BlockPixels], float e0[4], float e1[4])
+{
+	float aa = 0.0f;
+	float ab = 0.0f;
+	float bb = 0.0f;
+	float ax[4] = {};
+	float bx[4] = {};
+	for (unsigned int i = 0; i < pixelCount; i++)
+	{
+		const float b = weights[i];
+		const float a = 1.0f - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (unsigned int c = 0; c < channelCount; c++)
+		{
+			ax[c] += a * channels.c[c][i];
+			bx[c] += b * channels.c[c][i];
+		}
+	}
+
+	const float det = aa * bb - ab * ab;
+	if (fabsf(det) < 1e-6f)
+	{
+		return false;
+	}
+
+	for (unsigned int c = 0; c < channelCount; c++)
+	{
+		e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+		e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+	}
+	return true;
+}
+
+//
+// BC1 color
+//
+
+static uint16_t QuantizeRGB565(const float color[4])
+{
+	const int r = Clamp((int)floorf(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+	const int g = Clamp((int)floorf(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+	const int b = Clamp((int)floorf(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void ExpandRGB565(uint16_t value, int color[4])
+{
+	const int r = (value >> 11) & 31;
+	const int g = (value >> 5) & 63;
+	const int b = value & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+	color[3] = 255;
+}
+
+// Palette entries by step from c0 to c1, 4 color mode
+static void GetBC1StepPalette(uint16_t c0, uint16_t c1, int palette[4][4])
+{
+	ExpandRGB565(c0, palette[0]);
+	ExpandRGB565(c1, palette[3]);
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		palette[1][c] = (2 * palette[0][c] + palette[3][c] + 1) / 3;
+		palette[2][c] = (palette[0][c] + 2 * palette[3][c] + 1) / 3;
+	}
+}
+
+static uint32_t EvaluateBC1(const uint8_t* pPixels, const BlockChannels& channels, uint16_t c0, uint16_t c1, uint8_t steps[BlockPixels])
+{
+	int palette[4][4];
+	GetBC1StepPalette(c0, c1, palette);
+
+	float base[4];
+	float axis[4];
+	GetStepAxis(palette[0], palette[3], 3, 3.0f, base, axis);
+	FindSteps(channels, base, axis, StepThresholds, 3, steps);
+
+	uint32_t error = 0;
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			const int d = pPixels[i * 4 + c] - palette[steps[i]][c];
+			error += d * d;
+		}
+	}
+	return error;
+}
+
+// Always uses the 4 color mode, as BC3 color blocks do
+static void EncodeBC1Color(const uint8_t* pPixels, uint8_t* pBlock)
+{
+	const BlockChannels channels = LoadChannels(pPixels);
+
+	float mean[4];
+	float axis[4];
+	float e0[4];
+	float e1[4];
+	ComputePrincipalAxis(channels, BlockPixels, 3, mean, axis);
+	GetAxisEndpoints(channels, BlockPixels, 3, mean, axis, e0, e1);
+
+	uint16_t bestC0 = QuantizeRGB565(e0);
+	uint16_t bestC1 = QuantizeRGB565(e1);
+	uint8_t bestSteps[BlockPixels];
+	uint32_t bestError = EvaluateBC1(pPixels, channels, bestC0, bestC1, bestSteps);
+
+	// Refit endpoints to the chosen steps while it helps
+	for (unsigned int iteration = 0; iteration < 2 && bestError > 0; iteration++)
+	{
+		float weights[BlockPixels];
+		for (unsigned int i = 0; i < BlockPixels; i++)
+		{
+			weights[i] = bestSteps[i] / 3.0f;
+		}
+		if (!SolveEndpoints(channels, BlockPixels, 3, weights, e0, e1))
+		{
+			break;
+		}
+
+		const uint16_t c0 = QuantizeRGB565(e0);
+		const uint16_t c1 = QuantizeRGB565(e1);
+		uint8_t steps[BlockPixels];
+		const uint32_t error = EvaluateBC1(pPixels, channels, c0, c1, steps);
+		if (error >= bestError)
+		{
+			break;
+		}
+
+		bestC0 = c0;
+		bestC1 = c1;
+		bestError = error;
+		memcpy(bestSteps, steps, sizeof(steps));
+	}
+
+	// c0 > c1 selects the 4 color mode in BC1, equal endpoints need index 0 only
+	if (bestC0 < bestC1)
+	{
+		const uint16_t c = bestC0;
+		bestC0 = bestC1;
+		bestC1 = c;
+		for (unsigned int i = 0; i < BlockPixels; i++)
+		{
+			bestSteps[i] = (uint8_t)(3 - bestSteps[i]);
+		}
+	}
+	else if (bestC0 == bestC1)
+	{
+		memset(bestSteps, 0, sizeof(bestSteps));
+	}
+
+	static const uint32_t StepIndices[4] = { 0, 2, 3, 1 };
+	uint32_t indices = 0;
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		indices |= StepIndices[bestSteps[i]] << (i * 2);
+	}
+
+	pBlock[0] = (uint8_t)bestC0;
+	pBlock[1] = (uint8_t)(bestC0 >> 8);
+	pBlock[2] = (uint8_t)bestC1;
+	pBlock[3] = (uint8_t)(bestC1 >> 8);
+	memcpy(pBlock + 4, &indices, sizeof(indices));
+}
+
+static void DecodeBC1Color(const uint8_t* pBlock, bool allowThreeColors, uint8_t* pPixels)
+{
+	const uint16_t c0 = (uint16_t)(pBlock[0] | (pBlock[1] << 8));
+	const uint16_t c1 = (uint16_t)(pBlock[2] | (pBlock[3] << 8));
+
+	int palette[4][4];
+	ExpandRGB565(c0, palette[0]);
+	ExpandRGB565(c1, palette[1]);
+	if (c0 > c1 || !allowThreeColors)
+	{
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+		}
+	}
+	else
+	{
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+
+	uint32_t indices = 0;
+	memcpy(&indices, pBlock + 4, sizeof(indices));
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		const int* pColor = palette[(indices >> (i * 2)) & 3];
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			pPixels[i * 4 + c] = (uint8_t)pColor[c];
+		}
+	}
+}
+
+//
+// BC4 single channel, used for BC3 alpha and BC5
+//
+
+static void EncodeBC4(const uint8_t* pPixels, unsigned int channel, uint8_t* pBlock)
+{
+	int minValue = 255;
+	int maxValue = 0;
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		const int value = pPixels[i * 4 + channel];
+		minValue = value < minValue ? value : minValue;
+		maxValue = value > maxValue ? value : maxValue;
+	}
+
+	// a0 > a1 selects 8 interpolated values, steps go from a0 to a1
+	uint8_t steps[BlockPixels] = {};
+	if (maxValue > minValue)
+	{
+		BlockChannels channels = {};
+		for (unsigned int i = 0; i < BlockPixels; i++)
+		{
+			channels.c[0][i] = pPixels[i * 4 + channel];
+		}
+
+		const int e0[4] = { maxValue };
+		const int e1[4] = { minValue };
+		float base[4];
+		float axis[4];
+		GetStepAxis(e0, e1, 1, 7.0f, base, axis);
+		FindSteps(channels, base, axis, StepThresholds, 7, steps);
+	}
+
+	uint64_t indices = 0;
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		const uint64_t index = steps[i] == 0 ? 0 : (steps[i] == 7 ? 1 : steps[i] + 1);
+		indices |= index << (i * 3);
+	}
+
+	pBlock[0] = (uint8_t)maxValue;
+	pBlock[1] = (uint8_t)minValue;
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		pBlock[2 + i] = (uint8_t)(indices >> (i * 8));
+	}
+}
+
+static void DecodeBC4(const uint8_t* pBlock, unsigned int channel, uint8_t* pPixels)
+{
+	const int a0 = pBlock[0];
+	const int a1 = pBlock[1];
+
+	int palette[8];
+	palette[0] = a0;
+	palette[1] = a1;
+	if (a0 > a1)
+	{
+		for (int i = 1; i < 7; i++)
+		{
+			palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+		}
+	}
+	else
+	{
+		for (int i = 1; i < 5; i++)
+		{
+			palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	uint64_t indices = 0;
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		indices |= (uint64_t)pBlock[2 + i] << (i * 8);
+	}
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		pPixels[i * 4 + channel] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+	}
+}
+
+//
+// BC7, all 8 modes are decoded, modes 1, 5 and 6 are encoded
+//
+
+struct BitWriter
+{
+	uint8_t* pData;
+	unsigned int position;
+
+	void Write(uint32_t value, unsigned int bits)
+	{
+		for (unsigned int i = 0; i < bits; i++, position++)
+		{
+			pData[position / 8] |= (uint8_t)(((value >> i) & 1) << (position % 8));
+		}
+	}
+};
+
+struct BitReader
+{
+	const uint8_t* pData;
+	unsigned int position;
+
+	uint32_t Read(unsigned int bits)
+	{
+		uint32_t value = 0;
+		for (unsigned int i = 0; i < bits; i++, position++)
+		{
+			value |= (uint32_t)((pData[position / 8] >> (position % 8)) & 1) << i;
+		}
+		return value;
+	}
+};
+
+// Fields of a mode, stored in this order after the mode bits, then endpoints channel by channel, p-bits and indices
+struct BC7Mode
+{
+	unsigned int subsetCount;
+	unsigned int partitionBits;
+	unsigned int rotationBits;
+	unsigned int indexSelectionBits;
+	unsigned int colorBits;          // RGB of an endpoint, without the p-bit
+	unsigned int alphaBits;          // 0 when alpha is 255
+	unsigned int endpointPBits;      // 1 for a p-bit per endpoint
+	unsigned int sharedPBits;        // 1 for a p-bit per subset
+	unsigned int indexBits;
+	unsigned int secondaryIndexBits; // Alpha of modes 4 and 5, or color when the index selection bit is set
+};
+
+static const unsigned int BC7ModeCount = 8;
+
+static const BC7Mode BC7Modes[BC7ModeCount] =
+{
+	{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+	{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+	{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+	{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+	{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+	{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+	{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+	{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+};
+
+static const unsigned int BC7PartitionCount = 64;
+
+// Subset of each pixel
+static const uint8_t BC7Partitions2[64][BlockPixels] =
+{
+	{ 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1 },
+	{ 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1 },
+	{ 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1 },
+	{ 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 1, 1, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1, 1 },
+	{ 0, 0, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1 },
+	{ 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1 },
+	{ 0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 1 },
+	{ 0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1 },
+	{ 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1 },
+	{ 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1, 1 },
+	{ 0, 1, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0 },
+	{ 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0 },
+	{ 0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0 },
+	{ 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0 },
+	{ 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1 },
+	{ 0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0 },
+	{ 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0 },
+	{ 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0 },
+	{ 0, 0, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0, 0 },
+	{ 0, 0, 0, 1, 0, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0 },
+	{ 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0 },
+	{ 0, 1, 1, 1, 0, 0, 0, 1, 1, 0, 0, 0, 1, 1, 1, 0 },
+	{ 0, 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 0 },
+	{ 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1 },
+	{ 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1 },
+	{ 0, 1, 0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0 },
+	{ 0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0 },
+	{ 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0 },
+	{ 0, 1, 0, 1, 0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0 },
+	{ 0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 1 },
+	{ 0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1, 0, 0, 1, 0, 1 },
+	{ 0, 1, 1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 1, 0 },
+	{ 0, 0, 0, 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 0, 0, 0 },
+	{ 0, 0, 1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1, 0, 0 },
+	{ 0, 0, 1, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1, 1, 0, 0 },
+	{ 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0 },
+	{ 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 1, 1 },
+	{ 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1 },
+	{ 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0, 0, 0 },
+	{ 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0 },
+	{ 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0, 0, 0, 0 },
+	{ 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0 },
+	{ 0, 0, 0, 0, 0, 1, 0, 0, 1, 1, 1, 0, 0, 1, 0, 0 },
+	{ 0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 1 },
+	{ 0, 0, 1, 1, 0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 1 },
+	{ 0, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0 },
+	{ 0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0, 0, 0, 1, 1, 0 },
+	{ 0, 1, 1, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 0, 0, 1 },
+	{ 0, 1, 1, 0, 0, 0, 1, 1, 0, 0, 1, 1, 1, 0, 0, 1 },
+	{ 0, 1, 1, 1, 1, 1, 1, 0, 1, 0, 0, 0, 0, 0, 0, 1 },
+	{ 0, 0, 0, 1, 1, 0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1 },
+	{ 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1 },
+	{ 0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0 },
+	{ 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0 },
+	{ 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1 }
+};
+
+static const uint8_t BC7Partitions3[64][BlockPixels] =
+{
+	{ 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2 },
+	{ 0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1 },
+	{ 0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+	{ 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2 },
+	{ 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2 },
+	{ 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 },
+	{ 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 },
+	{ 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2 },
+	{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+	{ 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2 },
+	{ 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2 },
+	{ 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2 },
+	{ 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2 },
+	{ 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0 },
+	{ 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2 },
+	{ 0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0 },
+	{ 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2 },
+	{ 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1 },
+	{ 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2 },
+	{ 0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1 },
+	{ 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2 },
+	{ 0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0 },
+	{ 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0 },
+	{ 0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2 },
+	{ 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0 },
+	{ 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1 },
+	{ 0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2 },
+	{ 0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2 },
+	{ 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1 },
+	{ 0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2 },
+	{ 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1 },
+	{ 0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2 },
+	{ 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0 },
+	{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0 },
+	{ 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 },
+	{ 0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0 },
+	{ 0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1 },
+	{ 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1 },
+	{ 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1 },
+	{ 0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2 },
+	{ 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1 },
+	{ 0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1 },
+	{ 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1 },
+	{ 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 },
+	{ 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 },
+	{ 0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1 },
+	{ 0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2 },
+	{ 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2 },
+	{ 0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2 },
+	{ 0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2 },
+	{ 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2 },
+	{ 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2 },
+	{ 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2 },
+	{ 0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2 },
+	{ 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1 },
+	{ 0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2 },
+	{ 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 },
+	{ 0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0 }
+};
+
+// Pixel of the second subset whose index has an implied 0 top bit, pixel 0 is the anchor of the first subset
+static const uint8_t BC7Anchors2[BC7PartitionCount] =
+{
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+	15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+	 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+};
+
+// Anchors of the second and third subsets of 3 subset partitions
+static const uint8_t BC7Anchors3[2][BC7PartitionCount] =
+{
+	{
+		 3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+		 3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+		 8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+		 3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3
+	},
+	{
+		15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+		15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+		15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+		15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8
+	}
+};
+
+static const uint8_t* GetBC7Partition(unsigned int subsetCount, unsigned int partition)
+{
+	static const uint8_t OneSubset[BlockPixels] = {};
+	return subsetCount == 1 ? OneSubset : (subsetCount == 2 ? BC7Partitions2[partition] : BC7Partitions3[partition]);
+}
+
+static unsigned int GetBC7Anchor(unsigned int subsetCount, unsigned int partition, unsigned int subset)
+{
+	if (subset == 0)
+	{
+		return 0;
+	}
+	return subsetCount == 2 ? BC7Anchors2[partition] : BC7Anchors3[subset - 1][partition];
+}
+
+static bool IsBC7Anchor(unsigned int subsetCount, unsigned int partition, unsigned int pixel)
+{
+	for (unsigned int subset = 0; subset < subsetCount; subset++)
+	{
+		if (GetBC7Anchor(subsetCount, partition, subset) == pixel)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static const int* GetBC7Weights(unsigned int indexBits)
+{
+	return indexBits == 2 ? BC7Weights2 : (indexBits == 3 ? BC7Weights3 : BC7Weights4);
+}
+
+static const float* GetBC7Thresholds(unsigned int indexBits)
+{
+	return indexBits == 2 ? BC7Thresholds2 : (indexBits == 3 ? BC7Thresholds3 : BC7Thresholds4);
+}
+
+static int InterpolateBC7(int e0, int e1, int weight)
+{
+	return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+}
+
+// Stored value of the given bits, p-bit included, to 8 bits by repeating its top bits
+static int ExpandBC7(int value, unsigned int bits)
+{
+	value <<= 8 - bits;
+	return value | (value >> bits);
+}
+
+// Nearest value of the given bits ending with pBit, -1 for none, expanded to 8 bits
+static int QuantizeBC7(float value, unsigned int bits, int pBit)
+{
+	const int maxValue = (1 << bits) - 1;
+	const float scaled = value * maxValue / 255.0f;
+	const int stored = pBit < 0
+		? Clamp((int)floorf(scaled + 0.5f), 0, maxValue)
+		: (Clamp((int)floorf((scaled - pBit) * 0.5f + 0.5f), 0, maxValue >> 1) << 1) | pBit;
+	return ExpandBC7(stored, bits);
+}
+
+// All fields of a block, endpoints expanded to 8 bits
+struct BC7Block
+{
+	unsigned int mode;
+	unsigned int partition;
+	unsigned int rotation;
+	unsigned int indexSelection;
+	int endpoints[3][2][4];
+	uint8_t indices[BlockPixels];
+	uint8_t secondaryIndices[BlockPixels];
+};
+
+// Endpoints must keep the p-bits of the mode, anchor indices must have a 0 top bit
+static void WriteBC7Block(const BC7Block& block, uint8_t* pBlock)
+{
+	const BC7Mode& mode = BC7Modes[block.mode];
+	const unsigned int pBits = mode.endpointPBits | mode.sharedPBits;
+	const unsigned int channelCount = mode.alphaBits != 0 ? 4 : 3;
+
+	memset(pBlock, 0, 16);
+	BitWriter writer = { pBlock, 0 };
+	writer.Write(1 << block.mode, block.mode + 1);
+	writer.Write(block.partition, mode.partitionBits);
+	writer.Write(block.rotation, mode.rotationBits);
+	writer.Write(block.indexSelection, mode.indexSelectionBits);
+
+	for (unsigned int c = 0; c < channelCount; c++)
+	{
+		const unsigned int bits = (c < 3 ? mode.colorBits : mode.alphaBits) + pBits;
+		for (unsigned int s = 0; s < mode.subsetCount; s++)
+		{
+			writer.Write(block.endpoints[s][0][c] >> (8 - bits) >> pBits, bits - pBits);
+			writer.Write(block.endpoints[s][1][c] >> (8 - bits) >> pBits, bits - pBits);
+		}
+	}
+
+	const unsigned int pBitShift = 8 - mode.colorBits - 1;
+	for (unsigned int s = 0; s < mode.subsetCount; s++)
+	{
+		for (unsigned int e = 0; e < 2 * mode.endpointPBits + mode.sharedPBits; e++)
+		{
+			writer.Write((block.endpoints[s][e][0] >> pBitShift) & 1, 1);
+		}
+	}
+
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		assert(block.indices[i] >> (mode.indexBits - 1) == 0 || !IsBC7Anchor(mode.subsetCount, block.partition, i));
+		writer.Write(block.indices[i], IsBC7Anchor(mode.subsetCount, block.partition, i) ? mode.indexBits - 1 : mode.indexBits);
+	}
+	for (unsigned int i = 0; i < BlockPixels && mode.secondaryIndexBits != 0; i++)
+	{
+		writer.Write(block.secondaryIndices[i], i == 0 ? mode.secondaryIndexBits - 1 : mode.secondaryIndexBits);
+	}
+	assert(writer.position == 128);
+}
+
+// Fails on the reserved mode, whose first byte is 0
+static bool ReadBC7Block(const uint8_t* pBlock, BC7Block& block)
+{
+	// Mode is the number of zero bits before the first set one
+	BitReader reader = { pBlock, 0 };
+	block.mode = 0;
+	while (block.mode < BC7ModeCount && reader.Read(1) == 0)
+	{
+		block.mode++;
+	}
+	if (block.mode == BC7ModeCount)
+	{
+		return false;
+	}
+
+	const BC7Mode& mode = BC7Modes[block.mode];
+	const unsigned int pBits = mode.endpointPBits | mode.sharedPBits;
+	block.partition = reader.Read(mode.partitionBits);
+	block.rotation = reader.Read(mode.rotationBits);
+	block.indexSelection = reader.Read(mode.indexSelectionBits);
+
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		const unsigned int bits = c < 3 ? mode.colorBits : mode.alphaBits;
+		for (unsigned int s = 0; s < mode.subsetCount; s++)
+		{
+			block.endpoints[s][0][c] = (int)reader.Read(bits) << pBits;
+			block.endpoints[s][1][c] = (int)reader.Read(bits) << pBits;
+		}
+	}
+
+	for (unsigned int s = 0; s < mode.subsetCount; s++)
+	{
+		int pBit[2] = {};
+		if (mode.endpointPBits != 0)
+		{
+			pBit[0] = (int)reader.Read(1);
+			pBit[1] = (int)reader.Read(1);
+		}
+		else if (mode.sharedPBits != 0)
+		{
+			pBit[0] = (int)reader.Read(1);
+			pBit[1] = pBit[0];
+		}
+
+		for (unsigned int e = 0; e < 2; e++)
+		{
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				const unsigned int bits = c < 3 ? mode.colorBits : mode.alphaBits;
+				int& value = block.endpoints[s][e][c];
+				value = bits != 0 ? ExpandBC7(value | pBit[e], bits + pBits) : 255;
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		block.indices[i] = (uint8_t)reader.Read(IsBC7Anchor(mode.subsetCount, block.partition, i) ? mode.indexBits - 1 : mode.indexBits);
+	}
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		block.secondaryIndices[i] = mode.secondaryIndexBits != 0
+			? (uint8_t)reader.Read(i == 0 ? mode.secondaryIndexBits - 1 : mode.secondaryIndexBits)
+			: block.indices[i];
+	}
+	assert(reader.position == 128);
+	return true;
+}
+
+static bool DecodeBC7(const uint8_t* pBlock, uint8_t* pPixels)
+{
+	BC7Block block;
+	if (!ReadBC7Block(pBlock, block))
+	{
+		return false;
+	}
+
+	// Modes without secondary indices use the same ones for alpha
+	const BC7Mode& mode = BC7Modes[block.mode];
+	const uint8_t* pPartition = GetBC7Partition(mode.subsetCount, block.partition);
+	const bool swapIndices = block.indexSelection != 0;
+	const uint8_t* pColorIndices = swapIndices ? block.secondaryIndices : block.indices;
+	const uint8_t* pAlphaIndices = swapIndices ? block.indices : block.secondaryIndices;
+	const int* pColorWeights = GetBC7Weights(swapIndices ? mode.secondaryIndexBits : mode.indexBits);
+	const int* pAlphaWeights = GetBC7Weights(swapIndices || mode.secondaryIndexBits == 0 ? mode.indexBits : mode.secondaryIndexBits);
+
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		const int (*pEndpoints)[4] = block.endpoints[pPartition[i]];
+		int color[4];
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			color[c] = InterpolateBC7(pEndpoints[0][c], pEndpoints[1][c], pColorWeights[pColorIndices[i]]);
+		}
+		color[3] = InterpolateBC7(pEndpoints[0][3], pEndpoints[1][3], pAlphaWeights[pAlphaIndices[i]]);
+
+		// Rotation 1 - 3 swaps alpha with red, green or blue
+		if (block.rotation != 0)
+		{
+			const int value = color[3];
+			color[3] = color[block.rotation - 1];
+			color[block.rotation - 1] = value;
+		}
+
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			pPixels[i * 4 + c] = (uint8_t)color[c];
+		}
+	}
+	return true;
+}
+
+// Endpoint fit of one subset: channels, bits per channel with the p-bit,
+// p-bit combinations to try (1 without p-bits, 2 for a shared one, 4 for one per endpoint) and index bits
+struct BC7SubsetFit
+{
+	unsigned int channelCount;
+	unsigned int bits;
+	unsigned int pBitCombinations;
+	unsigned int indexBits;
+};
+
+static uint32_t EvaluateBC7(const BlockChannels& channels, unsigned int pixelCount, unsigned int channelCount,
+	const int endpoints[2][4], unsigned int indexBits, uint8_t steps[BlockPixels])
+{
+	const int* pWeights = GetBC7Weights(indexBits);
+
+	float base[4];
+	float axis[4];
+	GetStepAxis(endpoints[0], endpoints[1], channelCount, 64.0f, base, axis);
+	FindSteps(channels, base, axis, GetBC7Thresholds(indexBits), (1 << indexBits) - 1, steps);
+
+	uint32_t error = 0;
+	for (unsigned int i = 0; i < pixelCount; i++)
+	{
+		for (unsigned int c = 0; c < channelCount; c++)
+		{
+			const int d = (int)channels.c[c][i] - InterpolateBC7(endpoints[0][c], endpoints[1][c], pWeights[steps[i]]);
+			error += d * d;
+		}
+	}
+	return error;
+}
+
+// Tries all p-bit combinations for the endpoints, returns the best error
+static uint32_t FitBC7PBits(const BlockChannels& channels, unsigned int pixelCount, const BC7SubsetFit& fit,
+	const float e0[4], const float e1[4], int best[2][4], uint8_t bestSteps[BlockPixels])
+{
+	uint32_t bestError = UINT32_MAX;
+	for (unsigned int combination = 0; combination < fit.pBitCombinations; combination++)
+	{
+		const int pBit0 = fit.pBitCombinations == 1 ? -1 : (int)(combination & 1);
+		const int pBit1 = fit.pBitCombinations == 4 ? (int)(combination >> 1) : pBit0;
+
+		int endpoints[2][4] = {};
+		for (unsigned int c = 0; c < fit.channelCount; c++)
+		{
+			endpoints[0][c] = QuantizeBC7(e0[c], fit.bits, pBit0);
+			endpoints[1][c] = QuantizeBC7(e1[c], fit.bits, pBit1);
+		}
+
+		uint8_t steps[BlockPixels];
+		const uint32_t error = EvaluateBC7(channels, pixelCount, fit.channelCount, endpoints, fit.indexBits, steps);
+		if (error < bestError)
+		{
+			bestError = error;
+			memcpy(best, endpoints, sizeof(endpoints));
+			memcpy(bestSteps, steps, BlockPixels);
+		}
+	}
+	return bestError;
+}
+
+// Endpoints and indices of the first pixelCount pixels, the first one is the anchor and gets an index below half
+static uint32_t FitBC7Subset(const BlockChannels& channels, unsigned int pixelCount, const BC7SubsetFit& fit,
+	int endpoints[2][4], uint8_t steps[BlockPixels])
+{
+	float mean[4];
+	float axis[4];
+	float e0[4];
+	float e1[4];
+	ComputePrincipalAxis(channels, pixelCount, fit.channelCount, mean, axis);
+	GetAxisEndpoints(channels, pixelCount, fit.channelCount, mean, axis, e0, e1);
+
+	uint32_t bestError = FitBC7PBits(channels, pixelCount, fit, e0, e1, endpoints, steps);
+
+	const int* pWeights = GetBC7Weights(fit.indexBits);
+	for (unsigned int iteration = 0; iteration < 2 && bestError > 0; iteration++)
+	{
+		float weights[BlockPixels];
+		for (unsigned int i = 0; i < pixelCount; i++)
+		{
+			weights[i] = pWeights[steps[i]] / 64.0f;
+		}
+		if (!SolveEndpoints(channels, pixelCount, fit.channelCount, weights, e0, e1))
+		{
+			break;
+		}
+
+		int refitted[2][4];
+		uint8_t refittedSteps[BlockPixels];
+		const uint32_t error = FitBC7PBits(channels, pixelCount, fit, e0, e1, refitted, refittedSteps);
+		if (error >= bestError)
+		{
+			break;
+		}
+
+		bestError = error;
+		memcpy(endpoints, refitted, sizeof(refitted));
+		memcpy(steps, refittedSteps, BlockPixels);
+	}
+
+	// Weights are symmetric, so swapping endpoints keeps the colors
+	const unsigned int maxIndex = (1 << fit.indexBits) - 1;
+	if (steps[0] > maxIndex / 2)
+	{
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			const int value = endpoints[0][c];
+			endpoints[0][c] = endpoints[1][c];
+			endpoints[1][c] = value;
+		}
+		for (unsigned int i = 0; i < pixelCount; i++)
+		{
+			steps[i] = (uint8_t)(maxIndex - steps[i]);
+		}
+	}
+	return bestError;
+}
+
+// Pixels of one subset moved to the front, anchor first, pPixels gets their positions in the block
+static unsigned int GatherBC7Subset(const BlockChannels& channels, const uint8_t* pPartition, unsigned int subset, unsigned int anchor,
+	BlockChannels& subsetChannels, uint8_t pPixels[BlockPixels])
+{
+	unsigned int count = 0;
+	pPixels[count++] = (uint8_t)anchor;
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		if (pPartition[i] == subset && i != anchor)
+		{
+			pPixels[count++] = (uint8_t)i;
+		}
+	}
+
+	subsetChannels = BlockChannels();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			subsetChannels.c[c][i] = channels.c[c][pPixels[i]];
+		}
+	}
+	return count;
+}
+
+// Pixel count, sums and sums of products of RGB, from which the covariance of a subset follows
+struct RGBMoments
+{
+	float count;
+	float sums[3];
+	float products[3][3];
+};
+
+static void AddMoments(RGBMoments& moments, const RGBMoments& other, float scale)
+{
+	moments.count += other.count * scale;
+	for (unsigned int a = 0; a < 3; a++)
+	{
+		moments.sums[a] += other.sums[a] * scale;
+		for (unsigned int b = 0; b < 3; b++)
+		{
+			moments.products[a][b] += other.products[a][b] * scale;
+		}
+	}
+}
+
+// Squared distance of the pixels from their principal axis, estimates how well a subset fits before its endpoints are
+static float GetLineError(const RGBMoments& moments)
+{
+	if (moments.count == 0.0f)
+	{
+		return 0.0f;
+	}
+
+	float covariance[3][3];
+	for (unsigned int a = 0; a < 3; a++)
+	{
+		for (unsigned int b = 0; b < 3; b++)
+		{
+			covariance[a][b] = moments.products[a][b] - moments.sums[a] * moments.sums[b] / moments.count;
+		}
+	}
+
+	// Total variance less the variance along the axis, the largest eigenvalue
+	unsigned int largest = 0;
+	for (unsigned int c = 1; c < 3; c++)
+	{
+		largest = covariance[c][c] > covariance[largest][largest] ? c : largest;
+	}
+	float v[3] = { covariance[largest][0], covariance[largest][1], covariance[largest][2] };
+	float cv[3] = {};
+	for (unsigned int iteration = 0; iteration < 4; iteration++)
+	{
+		float maxComponent = 0.0f;
+		for (unsigned int a = 0; a < 3; a++)
+		{
+			cv[a] = covariance[a][0] * v[0] + covariance[a][1] * v[1] + covariance[a][2] * v[2];
+			maxComponent = fabsf(cv[a]) > maxComponent ? fabsf(cv[a]) : maxComponent;
+		}
+		if (maxComponent == 0.0f)
+		{
+			return 0.0f;
+		}
+		for (unsigned int a = 0; a < 3; a++)
+		{
+			v[a] = cv[a] / maxComponent;
+		}
+	}
+
+	const float lengthSq = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+	float variance = 0.0f;
+	for (unsigned int a = 0; a < 3; a++)
+	{
+		variance += v[a] * (covariance[a][0] * v[0] + covariance[a][1] * v[1] + covariance[a][2] * v[2]);
+	}
+	return covariance[0][0] + covariance[1][1] + covariance[2][2] - variance / lengthSq;
+}
+
+// Partitions with the smallest line errors are fitted, the estimate seldom misses a better one further down
+static const unsigned int BC7PartitionCandidates = 4;
+
+// Two subsets with 6 bit RGB endpoints, a p-bit per subset and 3 bit indices, alpha is 255 and not in the error
+static uint32_t EncodeBC7Mode1(const BlockChannels& channels, BC7Block& best)
+{
+	// Moments of the second subset are summed, the first one gets the rest
+	RGBMoments total = {};
+	RGBMoments pixelMoments[BlockPixels];
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		pixelMoments[i].count = 1.0f;
+		for (unsigned int a = 0; a < 3; a++)
+		{
+			pixelMoments[i].sums[a] = channels.c[a][i];
+			for (unsigned int b = 0; b < 3; b++)
+			{
+				pixelMoments[i].products[a][b] = channels.c[a][i] * channels.c[b][i];
+			}
+		}
+	}
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		AddMoments(total, pixelMoments[i], 1.0f);
+	}
+
+	float lineErrors[BC7PartitionCount];
+	for (unsigned int partition = 0; partition < BC7PartitionCount; partition++)
+	{
+		RGBMoments second = {};
+		for (unsigned int i = 0; i < BlockPixels; i++)
+		{
+			if (BC7Partitions2[partition][i] != 0)
+			{
+				AddMoments(second, pixelMoments[i], 1.0f);
+			}
+		}
+		RGBMoments first = total;
+		AddMoments(first, second, -1.0f);
+		lineErrors[partition] = GetLineError(first) + GetLineError(second);
+	}
+
+	static const BC7SubsetFit Fit = { 3, 7, 2, 3 };
+	uint32_t bestError = UINT32_MAX;
+	for (unsigned int candidate = 0; candidate < BC7PartitionCandidates; candidate++)
+	{
+		unsigned int partition = 0;
+		for (unsigned int p = 1; p < BC7PartitionCount; p++)
+		{
+			partition = lineErrors[p] < lineErrors[partition] ? p : partition;
+		}
+		lineErrors[partition] = INFINITY;
+
+		BC7Block block = {};
+		block.mode = 1;
+		block.partition = partition;
+
+		uint32_t error = 0;
+		for (unsigned int s = 0; s < 2; s++)
+		{
+			BlockChannels subsetChannels;
+			uint8_t pixels[BlockPixels];
+			const unsigned int count = GatherBC7Subset(channels, BC7Partitions2[partition], s, GetBC7Anchor(2, partition, s), subsetChannels, pixels);
+
+			uint8_t steps[BlockPixels];
+			error += FitBC7Subset(subsetChannels, count, Fit, block.endpoints[s], steps);
+			for (unsigned int i = 0; i < count; i++)
+			{
+				block.indices[pixels[i]] = steps[i];
+			}
+			block.endpoints[s][0][3] = 255;
+			block.endpoints[s][1][3] = 255;
+		}
+
+		if (error < bestError)
+		{
+			bestError = error;
+			best = block;
+		}
+	}
+	return bestError;
+}
+
+// One subset with 7 bit RGB and 8 bit alpha endpoints and 2 bit indices for each, red, green or blue may be rotated into alpha
+static uint32_t EncodeBC7Mode5(const BlockChannels& channels, BC7Block& best)
+{
+	static const BC7SubsetFit ColorFit = { 3, 7, 1, 2 };
+	static const BC7SubsetFit AlphaFit = { 1, 8, 1, 2 };
+
+	uint32_t bestError = UINT32_MAX;
+	for (unsigned int rotation = 0; rotation < 4; rotation++)
+	{
+		BlockChannels rotated = channels;
+		if (rotation != 0)
+		{
+			memcpy(rotated.c[rotation - 1], channels.c[3], sizeof(rotated.c[3]));
+			memcpy(rotated.c[3], channels.c[rotation - 1], sizeof(rotated.c[3]));
+		}
+		BlockChannels alpha = BlockChannels();
+		memcpy(alpha.c[0], rotated.c[3], sizeof(alpha.c[0]));
+
+		BC7Block block = {};
+		block.mode = 5;
+		block.rotation = rotation;
+
+		int alphaEndpoints[2][4];
+		uint32_t error = FitBC7Subset(rotated, BlockPixels, ColorFit, block.endpoints[0], block.indices);
+		error += FitBC7Subset(alpha, BlockPixels, AlphaFit, alphaEndpoints, block.secondaryIndices);
+		block.endpoints[0][0][3] = alphaEndpoints[0][0];
+		block.endpoints[0][1][3] = alphaEndpoints[1][0];
+
+		if (error < bestError)
+		{
+			bestError = error;
+			best = block;
+		}
+	}
+	return bestError;
+}
+
+// One subset with 7 bit RGBA endpoints, a p-bit per endpoint and 4 bit indices
+static uint32_t EncodeBC7Mode6(const BlockChannels& channels, BC7Block& best)
+{
+	static const BC7SubsetFit Fit = { 4, 8, 4, 4 };
+
+	best = BC7Block();
+	best.mode = 6;
+	return FitBC7Subset(channels, BlockPixels, Fit, best.endpoints[0], best.indices);
+}
+
+// Mode 6 suits smooth blocks, 5 blocks whose alpha or one channel does not follow the others and 1 blocks with two colors
+static void EncodeBC7(const uint8_t* pPixels, uint8_t* pBlock)
+{
+	const BlockChannels channels = LoadChannels(pPixels);
+
+	BC7Block best;
+	uint32_t bestError = EncodeBC7Mode6(channels, best);
+
+	if (bestError > 0)
+	{
+		BC7Block block;
+		const uint32_t error = EncodeBC7Mode5(channels, block);
+		if (error < bestError)
+		{
+			bestError = error;
+			best = block;
+		}
+	}
+
+	uint32_t alphaError = 0;
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		const int d = 255 - pPixels[i * 4 + 3];
+		alphaError += d * d;
+	}
+	if (bestError > alphaError)
+	{
+		BC7Block block;
+		const uint32_t error = EncodeBC7Mode1(channels, block) + alphaError;
+		if (error < bestError)
+		{
+			bestError = error;
+			best = block;
+		}
+	}
+
+	WriteBC7Block(best, pBlock);
+}
+
+//
+// Public interface
+//
+
+unsigned int GetBlockSize(BlockFormat format)
+{
+	return format == BLOCK_FORMAT_BC1 ? 8 : 16;
+}
+
+const char* GetBlockFormatName(BlockFormat format)
+{
+	static const char* Names[BLOCK_FORMAT_COUNT] = { "BC1", "BC3", "BC5", "BC7" };
+	return Names[format];
+}
+
+void EncodeBlock(BlockFormat format, const uint8_t* pPixels, uint8_t* pBlock)
+{
+	switch (format)
+	{
+	case BLOCK_FORMAT_BC1:
+		EncodeBC1Color(pPixels, pBlock);
+		break;
+	case BLOCK_FORMAT_BC3:
+		EncodeBC4(pPixels, 3, pBlock);
+		EncodeBC1Color(pPixels, pBlock + 8);
+		break;
+	case BLOCK_FORMAT_BC5:
+		EncodeBC4(pPixels, 0, pBlock);
+		EncodeBC4(pPixels, 1, pBlock + 8);
+		break;
+	case BLOCK_FORMAT_BC7:
+		EncodeBC7(pPixels, pBlock);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+bool DecodeBlock(BlockFormat format, const uint8_t* pBlock, uint8_t* pPixels)
+{
+	switch (format)
+	{
+	case BLOCK_FORMAT_BC1:
+		DecodeBC1Color(pBlock, true, pPixels);
+		return true;
+	case BLOCK_FORMAT_BC3:
+		DecodeBC1Color(pBlock + 8, false, pPixels);
+		DecodeBC4(pBlock, 3, pPixels);
+		return true;
+	case BLOCK_FORMAT_BC5:
+		for (unsigned int i = 0; i < BlockPixels; i++)
+		{
+			pPixels[i * 4 + 2] = 0;
+			pPixels[i * 4 + 3] = 255;
+		}
+		DecodeBC4(pBlock, 0, pPixels);
+		DecodeBC4(pBlock + 8, 1, pPixels);
+		return true;
+	case BLOCK_FORMAT_BC7:
+		return DecodeBC7(pBlock, pPixels);
+	default:
+		assert(false);
+		return false;
+	}
+}
+
+static uint32_t GetBlockCount(uint32_t size)
+{
+	return size > 0 ? (size + 3) / 4 : 1;
+}
+
+size_t GetCompressedSize(BlockFormat format, uint32_t width, uint32_t height)
+{
+	return (size_t)GetBlockCount(width) * GetBlockCount(height) * GetBlockSize(format);
+}
+
+void EncodeImageRows(BlockFormat format, const uint8_t* pImage, uint32_t width, uint32_t height,
+	uint32_t firstRow, uint32_t rowCount, uint8_t* pBlocks)
+{
+	const uint32_t blocksX = GetBlockCount(width);
+	const unsigned int blockSize = GetBlockSize(format);
+
+	uint8_t pixels[BlockPixels * 4];
+	for (uint32_t by = firstRow; by < firstRow + rowCount; by++)
+	{
+		for (uint32_t bx = 0; bx < blocksX; bx++)
+		{
+			for (uint32_t y = 0; y < 4; y++)
+			{
+				const uint32_t py = by * 4 + y < height ? by * 4 + y : height - 1;
+				for (uint32_t x = 0; x < 4; x++)
+				{
+					const uint32_t px = bx * 4 + x < width ? bx * 4 + x : width - 1;
+					memcpy(pixels + (y * 4 + x) * 4, pImage + ((size_t)py * width + px) * 4, 4);
+				}
+			}
+			EncodeBlock(format, pixels, pBlocks + ((size_t)by * blocksX + bx) * blockSize);
+		}
+	}
+}
+
+bool DecodeImage(BlockFormat format, const uint8_t* pBlocks, uint32_t width, uint32_t height, uint8_t* pImage)
+{
+	const uint32_t blocksX = GetBlockCount(width);
+	const uint32_t blocksY = GetBlockCount(height);
+	const unsigned int blockSize = GetBlockSize(format);
+
+	uint8_t pixels[BlockPixels * 4];
+	for (uint32_t by = 0; by < blocksY; by++)
+	{
+		for (uint32_t bx = 0; bx < blocksX; bx++)
+		{
+			if (!DecodeBlock(format, pBlocks + ((size_t)by * blocksX + bx) * blockSize, pixels))
+			{
+				return false;
+			}
+
+			for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++)
+			{
+				for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++)
+				{
+					memcpy(pImage + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, pixels + (y * 4 + x) * 4, 4);
+				}
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum BlockFormat
+{
+	BLOCK_FORMAT_BC1 = 0, // RGB, 1 bit alpha is not used
+	BLOCK_FORMAT_BC3,     // RGBA
+	BLOCK_FORMAT_BC5,     // RG, for normal maps
+	BLOCK_FORMAT_BC7,     // RGBA, encoded in modes 1, 5 and 6
+
+	BLOCK_FORMAT_COUNT
+};
+
+// Bytes of one 4x4 block
+unsigned int GetBlockSize(BlockFormat format);
+const char* GetBlockFormatName(BlockFormat format);
+
+// Blocks are 16 RGBA8 pixels row by row
+void EncodeBlock(BlockFormat format, const uint8_t* pPixels, uint8_t* pBlock);
+// Channels not stored by the format are 0, alpha 255
+// Fails on the reserved BC7 mode, whose first byte is 0
+bool DecodeBlock(BlockFormat format, const uint8_t* pBlock, uint8_t* pPixels);
+
+// Image is RGBA8 with rows of width * 4 bytes, blocks on the right and bottom edges repeat the last pixel
+// firstRow and rowCount are in blocks, so an image may be compressed by several threads at once
+void EncodeImageRows(BlockFormat format, const uint8_t* pImage, uint32_t width, uint32_t height,
+	uint32_t firstRow, uint32_t rowCount, uint8_t* pBlocks);
+bool DecodeImage(BlockFormat format, const uint8_t* pBlocks, uint32_t width, uint32_t height, uint8_t* pImage);
+
+size_t GetCompressedSize(BlockFormat format, uint32_t width, uint32_t height);
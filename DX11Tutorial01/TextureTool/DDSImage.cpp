@@ -0,0 +1,441 @@
+#include "DDSImage.h"
+
+#include <string.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "LegacyFormats.h"
+#include "MappedFile.h"
+
+namespace fs = std::filesystem;
+
+#define MAKE_FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+static const uint32_t DDSMagic = MAKE_FOURCC('D', 'D', 'S', ' ');
+
+// DDSD_ and DDPF_ flags
+static const uint32_t HeaderCaps = 0x1;
+static const uint32_t HeaderHeight = 0x2;
+static const uint32_t HeaderWidth = 0x4;
+static const uint32_t HeaderPitch = 0x8;
+static const uint32_t HeaderPixelFormat = 0x1000;
+static const uint32_t HeaderMipCount = 0x20000;
+static const uint32_t HeaderLinearSize = 0x80000;
+static const uint32_t HeaderVolume = 0x800000;
+static const uint32_t PixelFormatAlpha = 0x1;
+static const uint32_t PixelFormatFourCC = 0x4;
+static const uint32_t PixelFormatRGB = 0x40;
+static const uint32_t CapsComplex = 0x8;
+static const uint32_t CapsTexture = 0x1000;
+static const uint32_t CapsMipMap = 0x400000;
+static const uint32_t Caps2CubeMap = 0x200;
+
+// DXGI_FORMAT values
+static const uint32_t FormatRGBA8 = 28;
+static const uint32_t FormatRGBA8SRGB = 29;
+static const uint32_t FormatBC1 = 71;
+static const uint32_t FormatBC1SRGB = 72;
+static const uint32_t FormatBC3 = 77;
+static const uint32_t FormatBC3SRGB = 78;
+static const uint32_t FormatBC5 = 83;
+static const uint32_t FormatBGRA8 = 87;
+static const uint32_t FormatBGRX8 = 88;
+static const uint32_t FormatBGRA8SRGB = 91;
+static const uint32_t FormatBGRX8SRGB = 93;
+static const uint32_t FormatBC7 = 98;
+static const uint32_t FormatBC7SRGB = 99;
+
+static const uint32_t ResourceDimensionTexture2D = 3;
+
+struct DDSPixelFormat
+{
+	uint32_t size;
+	uint32_t flags;
+	uint32_t fourCC;
+	uint32_t bitCount;
+	uint32_t masks[4]; // R, G, B, A
+};
+
+struct DDSHeader
+{
+	uint32_t size;
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t pitchOrLinearSize;
+	uint32_t depth;
+	uint32_t mipMapCount;
+	uint32_t reserved1[11];
+	DDSPixelFormat pixelFormat;
+	uint32_t caps;
+	uint32_t caps2;
+	uint32_t caps3;
+	uint32_t caps4;
+	uint32_t reserved2;
+};
+
+struct DDSHeaderDX10
+{
+	uint32_t format;
+	uint32_t resourceDimension;
+	uint32_t miscFlag;
+	uint32_t arraySize;
+	uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DDSHeader) == 124, "DDSHeader must match DDS_HEADER");
+static_assert(sizeof(DDSHeaderDX10) == 20, "DDSHeaderDX10 must match DDS_HEADER_DXT10");
+
+// How stored pixels are turned into RGBA8
+struct SourceFormat
+{
+	bool blocks;
+	BlockFormat blockFormat;
+	LegacyFormat legacyFormat;
+	unsigned int pixelSize; // Uncompressed only
+	bool swapRB;
+	bool opaque;
+};
+
+static bool SetBlockFormat(BlockFormat format, SourceFormat& source)
+{
+	source.blocks = true;
+	source.blockFormat = format;
+	return true;
+}
+
+static bool SetPixelFormat(unsigned int pixelSize, bool swapRB, bool opaque, SourceFormat& source)
+{
+	source.pixelSize = pixelSize;
+	source.swapRB = swapRB;
+	source.opaque = opaque;
+	return true;
+}
+
+static bool SetLegacyFormat(LegacyFormat format, SourceFormat& source)
+{
+	source.legacyFormat = format;
+	source.pixelSize = GetLegacySourceSize(format);
+	return true;
+}
+
+static bool GetDX10Format(uint32_t format, SourceFormat& source)
+{
+	switch (format)
+	{
+	case FormatRGBA8:
+	case FormatRGBA8SRGB:
+		return SetPixelFormat(4, false, false, source);
+	case FormatBGRA8:
+	case FormatBGRA8SRGB:
+		return SetPixelFormat(4, true, false, source);
+	case FormatBGRX8:
+	case FormatBGRX8SRGB:
+		return SetPixelFormat(4, true, true, source);
+	case FormatBC1:
+	case FormatBC1SRGB:
+		return SetBlockFormat(BLOCK_FORMAT_BC1, source);
+	case FormatBC3:
+	case FormatBC3SRGB:
+		return SetBlockFormat(BLOCK_FORMAT_BC3, source);
+	case FormatBC5:
+		return SetBlockFormat(BLOCK_FORMAT_BC5, source);
+	case FormatBC7:
+	case FormatBC7SRGB:
+		return SetBlockFormat(BLOCK_FORMAT_BC7, source);
+	default:
+		return false;
+	}
+}
+
+static bool IsMask(const DDSPixelFormat& pixelFormat, uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{
+	return pixelFormat.masks[0] == r && pixelFormat.masks[1] == g && pixelFormat.masks[2] == b && pixelFormat.masks[3] == a;
+}
+
+static bool GetLegacyHeaderFormat(const DDSPixelFormat& pixelFormat, SourceFormat& source)
+{
+	if (pixelFormat.flags & PixelFormatFourCC)
+	{
+		switch (pixelFormat.fourCC)
+		{
+		case MAKE_FOURCC('D', 'X', 'T', '1'):
+			return SetBlockFormat(BLOCK_FORMAT_BC1, source);
+		case MAKE_FOURCC('D', 'X', 'T', '4'):
+		case MAKE_FOURCC('D', 'X', 'T', '5'):
+			return SetBlockFormat(BLOCK_FORMAT_BC3, source);
+		case MAKE_FOURCC('A', 'T', 'I', '2'):
+		case MAKE_FOURCC('B', 'C', '5', 'U'):
+			return SetBlockFormat(BLOCK_FORMAT_BC5, source);
+		default:
+			return false;
+		}
+	}
+
+	if (!(pixelFormat.flags & PixelFormatRGB))
+	{
+		return false;
+	}
+
+	if (pixelFormat.bitCount == 32)
+	{
+		if (IsMask(pixelFormat, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
+		{
+			return SetPixelFormat(4, false, false, source);
+		}
+		if (IsMask(pixelFormat, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000))
+		{
+			return SetPixelFormat(4, true, false, source);
+		}
+		if (IsMask(pixelFormat, 0x00ff0000, 0x0000ff00, 0x000000ff, 0))
+		{
+			return SetPixelFormat(4, true, true, source);
+		}
+		if (IsMask(pixelFormat, 0x000000ff, 0x0000ff00, 0x00ff0000, 0))
+		{
+			return SetLegacyFormat(LEGACY_FORMAT_X8B8G8R8, source);
+		}
+	}
+	else if (pixelFormat.bitCount == 24)
+	{
+		if (IsMask(pixelFormat, 0x00ff0000, 0x0000ff00, 0x000000ff, 0))
+		{
+			return SetLegacyFormat(LEGACY_FORMAT_R8G8B8, source);
+		}
+		if (IsMask(pixelFormat, 0x000000ff, 0x0000ff00, 0x00ff0000, 0))
+		{
+			return SetLegacyFormat(LEGACY_FORMAT_B8G8R8, source);
+		}
+	}
+	return false;
+}
+
+static void ExpandPixels(const SourceFormat& source, const uint8_t* pSrc, size_t pixelCount, uint8_t* pDst)
+{
+	if (source.legacyFormat != LEGACY_FORMAT_NONE)
+	{
+		ConvertLegacyPixels(source.legacyFormat, pSrc, pDst, pixelCount);
+		return;
+	}
+
+	memcpy(pDst, pSrc, pixelCount * 4);
+	for (size_t i = 0; i < pixelCount && (source.swapRB || source.opaque); i++)
+	{
+		uint8_t* pPixel = pDst + i * 4;
+		if (source.swapRB)
+		{
+			const uint8_t r = pPixel[2];
+			pPixel[2] = pPixel[0];
+			pPixel[0] = r;
+		}
+		if (source.opaque)
+		{
+			pPixel[3] = 255;
+		}
+	}
+}
+
+bool ReadDDSImage(const std::string& path, std::vector<Image>& mips, std::string& errors)
+{
+	mips.clear();
+
+	MappedFile file;
+	if (!file.Open(path.c_str()))
+	{
+		errors = "can not open " + path;
+		return false;
+	}
+
+	const uint8_t* pData = file.GetData();
+	const size_t size = file.GetSize();
+
+	uint32_t magic = 0;
+	DDSHeader header;
+	if (size < sizeof(magic) + sizeof(header))
+	{
+		errors = path + " is too small for a DDS file";
+		return false;
+	}
+	memcpy(&magic, pData, sizeof(magic));
+	memcpy(&header, pData + sizeof(magic), sizeof(header));
+	size_t offset = sizeof(magic) + sizeof(header);
+
+	if (magic != DDSMagic || header.size != sizeof(DDSHeader) || header.pixelFormat.size != sizeof(DDSPixelFormat))
+	{
+		errors = path + " is not a DDS file";
+		return false;
+	}
+	if ((header.flags & HeaderVolume) || (header.caps2 & Caps2CubeMap) || header.width == 0 || header.height == 0)
+	{
+		errors = path + " is not a 2D texture";
+		return false;
+	}
+
+	SourceFormat source = {};
+	bool supported = false;
+	if ((header.pixelFormat.flags & PixelFormatFourCC) && header.pixelFormat.fourCC == MAKE_FOURCC('D', 'X', '1', '0'))
+	{
+		DDSHeaderDX10 header10;
+		if (size < offset + sizeof(header10))
+		{
+			errors = path + " is truncated";
+			return false;
+		}
+		memcpy(&header10, pData + offset, sizeof(header10));
+		offset += sizeof(header10);
+
+		if (header10.resourceDimension != ResourceDimensionTexture2D || header10.arraySize != 1)
+		{
+			errors = path + " is not a 2D texture";
+			return false;
+		}
+		supported = GetDX10Format(header10.format, source);
+	}
+	else
+	{
+		supported = GetLegacyHeaderFormat(header.pixelFormat, source);
+	}
+	if (!supported)
+	{
+		errors = path + " has an unsupported pixel format";
+		return false;
+	}
+
+	const uint32_t mipCount = header.mipMapCount > 0 ? header.mipMapCount : 1;
+	uint32_t width = header.width;
+	uint32_t height = header.height;
+	for (uint32_t mip = 0; mip < mipCount; mip++)
+	{
+		const size_t mipSize = source.blocks
+			? GetCompressedSize(source.blockFormat, width, height)
+			: (size_t)width * height * source.pixelSize;
+		if (size - offset < mipSize)
+		{
+			errors = path + " is truncated";
+			return false;
+		}
+
+		Image image;
+		image.width = width;
+		image.height = height;
+		image.pixels.resize((size_t)width * height * 4);
+		if (!source.blocks)
+		{
+			ExpandPixels(source, pData + offset, (size_t)width * height, image.pixels.data());
+		}
+		else if (!DecodeImage(source.blockFormat, pData + offset, width, height, image.pixels.data()))
+		{
+			errors = path + " has BC7 blocks in the reserved mode";
+			return false;
+		}
+		mips.push_back(std::move(image));
+
+		offset += mipSize;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	return true;
+}
+
+// Written to a temporary file first, so an existing file is replaced only by a complete one
+static bool WriteDDSFile(const std::string& path, const DDSHeader& header, const DDSHeaderDX10* pHeader10,
+	const std::vector<std::vector<uint8_t>>& mips, std::string& errors)
+{
+	std::string tempPath = path + ".tmp";
+	std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		errors = "can not create " + tempPath;
+		return false;
+	}
+
+	file.write((const char*)&DDSMagic, sizeof(DDSMagic));
+	file.write((const char*)&header, sizeof(header));
+	if (pHeader10 != NULL)
+	{
+		file.write((const char*)pHeader10, sizeof(*pHeader10));
+	}
+	for (const std::vector<uint8_t>& mip : mips)
+	{
+		file.write((const char*)mip.data(), mip.size());
+	}
+	file.close();
+
+	std::error_code error;
+	if (!file)
+	{
+		errors = "can not write " + tempPath;
+		fs::remove(tempPath, error);
+		return false;
+	}
+
+	fs::rename(tempPath, path, error);
+	if (error)
+	{
+		errors = "can not rename " + tempPath + " to " + path;
+		fs::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+bool WriteDDSImage(const std::string& path, BlockFormat format, uint32_t width, uint32_t height,
+	const std::vector<std::vector<uint8_t>>& mips, std::string& errors)
+{
+	DDSHeader header = {};
+	header.size = sizeof(DDSHeader);
+	header.flags = HeaderCaps | HeaderHeight | HeaderWidth | HeaderPixelFormat | HeaderMipCount | HeaderLinearSize;
+	header.height = height;
+	header.width = width;
+	header.pitchOrLinearSize = (uint32_t)GetCompressedSize(format, width, height);
+	header.mipMapCount = (uint32_t)mips.size();
+	header.pixelFormat.size = sizeof(DDSPixelFormat);
+	header.pixelFormat.flags = PixelFormatFourCC;
+	header.caps = CapsTexture | (mips.size() > 1 ? CapsComplex | CapsMipMap : 0);
+
+	DDSHeaderDX10 header10 = {};
+	switch (format)
+	{
+	case BLOCK_FORMAT_BC1:
+		header.pixelFormat.fourCC = MAKE_FOURCC('D', 'X', 'T', '1');
+		break;
+	case BLOCK_FORMAT_BC3:
+		header.pixelFormat.fourCC = MAKE_FOURCC('D', 'X', 'T', '5');
+		break;
+	case BLOCK_FORMAT_BC5:
+		header.pixelFormat.fourCC = MAKE_FOURCC('A', 'T', 'I', '2');
+		break;
+	default:
+		header.pixelFormat.fourCC = MAKE_FOURCC('D', 'X', '1', '0');
+		header10.format = FormatBC7;
+		header10.resourceDimension = ResourceDimensionTexture2D;
+		header10.arraySize = 1;
+		break;
+	}
+
+	return WriteDDSFile(path, header, header10.format != 0 ? &header10 : NULL, mips, errors);
+}
+
+bool WriteDDSImage(const std::string& path, const Image& image, std::string& errors)
+{
+	DDSHeader header = {};
+	header.size = sizeof(DDSHeader);
+	header.flags = HeaderCaps | HeaderHeight | HeaderWidth | HeaderPixelFormat | HeaderPitch;
+	header.height = image.height;
+	header.width = image.width;
+	header.pitchOrLinearSize = image.width * 4;
+	header.pixelFormat.size = sizeof(DDSPixelFormat);
+	header.pixelFormat.flags = PixelFormatRGB | PixelFormatAlpha;
+	header.pixelFormat.bitCount = 32;
+	header.pixelFormat.masks[0] = 0x000000ff;
+	header.pixelFormat.masks[1] = 0x0000ff00;
+	header.pixelFormat.masks[2] = 0x00ff0000;
+	header.pixelFormat.masks[3] = 0xff000000;
+	header.caps = CapsTexture;
+
+	std::vector<std::vector<uint8_t>> mips(1, image.pixels);
+	return WriteDDSFile(path, header, NULL, mips, errors);
+}
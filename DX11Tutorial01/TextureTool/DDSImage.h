@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "BlockCompress.h"
+
+// Uncompressed RGBA8 image, rows are width * 4 bytes
+struct Image
+{
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint8_t> pixels;
+};
+
+// Reads all mips of a 2D DDS texture and expands them to RGBA8
+// Supported are 32 bit RGBA/BGRA/BGRX, legacy 24 bit and X8B8G8R8, BC1, BC3, BC5 and BC7
+bool ReadDDSImage(const std::string& path, std::vector<Image>& mips, std::string& errors);
+
+// Writes block compressed mips, largest first, in a file CreateDDSTextureFromFile loads
+// BC1, BC3 and BC5 use the legacy header, BC7 the DX10 one
+bool WriteDDSImage(const std::string& path, BlockFormat format, uint32_t width, uint32_t height,
+	const std::vector<std::vector<uint8_t>>& mips, std::string& errors);
+
+// Writes a single uncompressed RGBA8 mip, which ReadDDSImage reads back unchanged
+bool WriteDDSImage(const std::string& path, const Image& image, std::string& errors);
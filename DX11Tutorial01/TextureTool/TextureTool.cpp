@@ -0,0 +1,332 @@
+// Command line tool for texture assets
+//   TextureTool pack <archive> <directory or file>...
+//   TextureTool list <archive>
+//   TextureTool verify <archive>
+//   TextureTool compress <bc1|bc3|bc5|bc7> <input> <output> [options]
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BlockCompress.h"
+#include "DDSImage.h"
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include "TextureArchive.h"
+
+namespace fs = std::filesystem;
+
+static void PrintUsage()
+{
+	printf("Usage:\n");
+	printf("  TextureTool pack <archive> <directory or file>...\n");
+	printf("      Packs .dds files, files in directories are named by their path relative to the directory\n");
+	printf("  TextureTool list <archive>\n");
+	printf("  TextureTool verify <archive>\n");
+	printf("  TextureTool compress <bc1|bc3|bc5|bc7> <input> <output> [options]\n");
+	printf("      Block compresses all mips of a DDS texture, BC5 keeps red and green for normal maps\n");
+	printf("      Inputs with a single mip get a full chain. Prints PSNR of each mip and throughput\n");
+	printf("      -threads <count>        Worker threads, all cores by default\n");
+	printf("      -filter <box|kaiser>    Mip filter, kaiser by default\n");
+	printf("      -mips                   Make the chain from the top mip even if the input has one\n");
+	printf("      -srgb                   Filter color in linear space\n");
+	printf("      -normal                 Renormalize filtered normals\n");
+}
+
+static bool IsDDSFile(const fs::path& path)
+{
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower(c); });
+	return extension == ".dds";
+}
+
+static int Pack(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	// Name and path, sorted by name so the same input always gives the same archive
+	std::vector<std::pair<std::string, std::string>> files;
+	for (int i = 3; i < argc; i++)
+	{
+		fs::path input = argv[i];
+		std::error_code error;
+		if (fs::is_directory(input, error))
+		{
+			for (const fs::directory_entry& file : fs::recursive_directory_iterator(input, error))
+			{
+				if (file.is_regular_file(error) && IsDDSFile(file.path()))
+				{
+					files.push_back(std::make_pair(fs::relative(file.path(), input, error).generic_string(), file.path().string()));
+				}
+			}
+		}
+		else if (fs::is_regular_file(input, error))
+		{
+			files.push_back(std::make_pair(input.filename().generic_string(), input.string()));
+		}
+		else
+		{
+			fprintf(stderr, "error: %s not found\n", argv[i]);
+			return 1;
+		}
+	}
+	std::sort(files.begin(), files.end());
+
+	TextureArchiveWriter writer;
+	for (const auto& file : files)
+	{
+		if (!writer.Add(file.first, file.second))
+		{
+			fprintf(stderr, "error: %s is added twice\n", file.first.c_str());
+			return 1;
+		}
+	}
+
+	std::string errors;
+	if (!writer.Write(argv[2], errors))
+	{
+		fprintf(stderr, "error: %s\n", errors.c_str());
+		return 1;
+	}
+
+	printf("%zu textures packed to %s\n", writer.GetEntryCount(), argv[2]);
+	return 0;
+}
+
+static int List(int argc, char** argv, bool verify)
+{
+	if (argc != 3)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	TextureArchive archive;
+	if (!archive.Open(argv[2]))
+	{
+		fprintf(stderr, "error: %s is not a valid archive\n", argv[2]);
+		return 1;
+	}
+
+	unsigned int failed = 0;
+	for (size_t i = 0; i < archive.GetEntryCount(); i++)
+	{
+		const uint8_t* pData = NULL;
+		size_t size = 0;
+		archive.GetEntryData(i, &pData, &size);
+
+		bool valid = !verify || archive.Verify(i);
+		printf("%12zu  %s%s\n", size, archive.GetEntryName(i).c_str(), valid ? "" : "  CORRUPTED");
+		failed += valid ? 0 : 1;
+	}
+
+	if (verify)
+	{
+		printf("%zu entries, %u corrupted\n", archive.GetEntryCount(), failed);
+	}
+	return failed == 0 ? 0 : 1;
+}
+
+static bool ParseBlockFormat(const char* name, BlockFormat& format)
+{
+	for (int i = 0; i < BLOCK_FORMAT_COUNT; i++)
+	{
+		std::string formatName = GetBlockFormatName((BlockFormat)i);
+		std::transform(formatName.begin(), formatName.end(), formatName.begin(), [](char c) { return (char)tolower(c); });
+		if (formatName == name)
+		{
+			format = (BlockFormat)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Only channels the format stores are compared
+static double ComputePSNR(BlockFormat format, const std::vector<uint8_t>& original, const std::vector<uint8_t>& decoded)
+{
+	static const bool Channels[BLOCK_FORMAT_COUNT][4] =
+	{
+		{ true, true, true, false }, // BC1
+		{ true, true, true, true },  // BC3
+		{ true, true, false, false }, // BC5
+		{ true, true, true, true }   // BC7
+	};
+
+	double errorSum = 0.0;
+	size_t count = 0;
+	for (size_t i = 0; i < original.size(); i++)
+	{
+		if (Channels[format][i % 4])
+		{
+			const double d = (double)original[i] - decoded[i];
+			errorSum += d * d;
+			count++;
+		}
+	}
+
+	const double mse = errorSum / count;
+	return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+}
+
+static int Compress(int argc, char** argv)
+{
+	BlockFormat format = BLOCK_FORMAT_BC1;
+	if (argc < 5 || !ParseBlockFormat(argv[2], format))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	unsigned int threadCount = std::thread::hardware_concurrency();
+	MipFilter filter = MIP_FILTER_KAISER;
+	bool regenerateMips = false;
+	unsigned int mipFlags = 0;
+	for (int i = 5; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+		{
+			threadCount = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-filter") == 0 && i + 1 < argc && (strcmp(argv[i + 1], "box") == 0 || strcmp(argv[i + 1], "kaiser") == 0))
+		{
+			filter = strcmp(argv[++i], "box") == 0 ? MIP_FILTER_BOX : MIP_FILTER_KAISER;
+		}
+		else if (strcmp(argv[i], "-mips") == 0)
+		{
+			regenerateMips = true;
+		}
+		else if (strcmp(argv[i], "-srgb") == 0)
+		{
+			mipFlags |= MIP_FLAG_SRGB;
+		}
+		else if (strcmp(argv[i], "-normal") == 0)
+		{
+			mipFlags |= MIP_FLAG_NORMAL_MAP;
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+	threadCount = threadCount > 0 ? threadCount : 1;
+
+	std::vector<Image> mips;
+	std::string errors;
+	if (!ReadDDSImage(argv[3], mips, errors))
+	{
+		fprintf(stderr, "error: %s\n", errors.c_str());
+		return 1;
+	}
+
+	JobSystem jobs;
+	jobs.Init(threadCount);
+
+	const uint32_t width = mips[0].width;
+	const uint32_t height = mips[0].height;
+	const unsigned int mipCount = GetFullMipCount(width, height);
+	if ((mips.size() == 1 || regenerateMips) && mipCount > 1)
+	{
+		std::vector<uint8_t> chain(GetMipChainSize(width, height));
+		std::copy(mips[0].pixels.begin(), mips[0].pixels.end(), chain.begin());
+
+		auto mipStart = std::chrono::steady_clock::now();
+		GenerateMipChain(chain.data(), width, height, filter, mipFlags, &jobs);
+		double mipMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mipStart).count();
+		printf("Generated %u mips with the %s filter in %.1f ms\n", mipCount - 1, filter == MIP_FILTER_BOX ? "box" : "kaiser", mipMilliseconds);
+
+		mips.resize(mipCount);
+		size_t offset = 0;
+		for (unsigned int i = 0; i < mipCount; i++)
+		{
+			mips[i].width = width >> i > 0 ? width >> i : 1;
+			mips[i].height = height >> i > 0 ? height >> i : 1;
+			const size_t size = (size_t)mips[i].width * mips[i].height * 4;
+			mips[i].pixels.assign(chain.begin() + offset, chain.begin() + offset + size);
+			offset += size;
+		}
+	}
+
+	// Block rows of all mips make one parallel loop, so small mips do not leave threads idle
+	std::vector<std::vector<uint8_t>> blocks(mips.size());
+	std::vector<uint32_t> firstRows;
+	uint32_t rowCount = 0;
+	size_t pixelCount = 0;
+	for (size_t i = 0; i < mips.size(); i++)
+	{
+		blocks[i].resize(GetCompressedSize(format, mips[i].width, mips[i].height));
+		firstRows.push_back(rowCount);
+		rowCount += (mips[i].height + 3) / 4;
+		pixelCount += (size_t)mips[i].width * mips[i].height;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	jobs.ParallelFor(rowCount, 4, [&](unsigned int first, unsigned int count)
+	{
+		for (unsigned int row = first; row < first + count; row++)
+		{
+			size_t mip = std::upper_bound(firstRows.begin(), firstRows.end(), row) - firstRows.begin() - 1;
+			const Image& image = mips[mip];
+			EncodeImageRows(format, image.pixels.data(), image.width, image.height, row - firstRows[mip], 1, blocks[mip].data());
+		}
+	});
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	jobs.Term();
+
+	printf("%s: %ux%u, %zu mips, %s\n", argv[3], mips[0].width, mips[0].height, mips.size(), GetBlockFormatName(format));
+	std::vector<uint8_t> decoded;
+	for (size_t i = 0; i < mips.size(); i++)
+	{
+		decoded.resize(mips[i].pixels.size());
+		DecodeImage(format, blocks[i].data(), mips[i].width, mips[i].height, decoded.data());
+		printf("  mip %2zu %5ux%-5u PSNR %6.2f dB\n", i, mips[i].width, mips[i].height, ComputePSNR(format, mips[i].pixels, decoded));
+	}
+	printf("Encoded %.2f Mpixels in %.1f ms on %u threads, %.2f Mpixels/s\n",
+		pixelCount / 1e6, milliseconds, threadCount, pixelCount / 1e3 / milliseconds);
+
+	if (!WriteDDSImage(argv[4], format, mips[0].width, mips[0].height, blocks, errors))
+	{
+		fprintf(stderr, "error: %s\n", errors.c_str());
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 2 && strcmp(argv[1], "pack") == 0)
+	{
+		return Pack(argc, argv);
+	}
+	if (argc >= 2 && strcmp(argv[1], "list") == 0)
+	{
+		return List(argc, argv, false);
+	}
+	if (argc >= 2 && strcmp(argv[1], "verify") == 0)
+	{
+		return List(argc, argv, true);
+	}
+	if (argc >= 2 && strcmp(argv[1], "compress") == 0)
+	{
+		return Compress(argc, argv);
+	}
+
+	PrintUsage();
+	return 1;
+}
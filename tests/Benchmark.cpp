@@ -0,0 +1,68 @@
+#include "Benchmark.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+
+static bool s_quick = false;
+
+void InitBenchmark(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		s_quick = s_quick || strcmp(argv[i], "-quick") == 0;
+	}
+}
+
+bool IsQuickBenchmark()
+{
+	return s_quick;
+}
+
+uint32_t BenchmarkSize(uint32_t fullSize, uint32_t quickSize)
+{
+	return s_quick ? quickSize : fullSize;
+}
+
+static int64_t GetNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+BenchmarkTimer::BenchmarkTimer()
+	: m_start(GetNanoseconds())
+{
+}
+
+double BenchmarkTimer::GetSeconds() const
+{
+	return (GetNanoseconds() - m_start) / 1.0e9;
+}
+
+void ReportBenchmark(const char* name, double seconds, double itemCount, const char* unit)
+{
+	double perItem = itemCount > 0.0 ? seconds / itemCount : 0.0;
+	double perSecond = seconds > 0.0 ? itemCount / seconds : 0.0;
+
+	const char* prefix = "";
+	if (perSecond >= 1.0e9)
+	{
+		perSecond /= 1.0e9;
+		prefix = "G";
+	}
+	else if (perSecond >= 1.0e6)
+	{
+		perSecond /= 1.0e6;
+		prefix = "M";
+	}
+	else if (perSecond >= 1.0e3)
+	{
+		perSecond /= 1.0e3;
+		prefix = "k";
+	}
+
+	printf("%-44s %10.3f ms %12.2f ns/%s %10.2f %s%s%s/s\n",
+		name, seconds * 1.0e3, perItem * 1.0e9, unit, perSecond, prefix, prefix[0] != 0 && unit[1] != 0 ? " " : "", unit);
+	fflush(stdout);
+}
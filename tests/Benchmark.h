@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+// Benchmarks print one line per case with the best time of a few runs
+// With "-quick", as ctest runs them, they do a small part of the work, only to show they still run
+void InitBenchmark(int argc, char** argv);
+bool IsQuickBenchmark();
+
+// Full size, or the quick one in quick runs
+uint32_t BenchmarkSize(uint32_t fullSize, uint32_t quickSize);
+
+class BenchmarkTimer
+{
+public:
+	BenchmarkTimer();
+
+	double GetSeconds() const;
+
+private:
+	int64_t m_start;
+};
+
+// Seconds of the fastest of the runs of function
+template <typename Function>
+double MeasureBest(unsigned int runCount, Function function)
+{
+	double best = 0.0;
+	for (unsigned int i = 0; i < runCount; i++)
+	{
+		BenchmarkTimer timer;
+		function();
+		double seconds = timer.GetSeconds();
+		best = i == 0 || seconds < best ? seconds : best;
+	}
+	return best;
+}
+
+// Time per item and items per second, with the unit the items are counted in
+void ReportBenchmark(const char* name, double seconds, double itemCount, const char* unit);
@@ -0,0 +1,92 @@
+#include <math.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "BlockCompress.h"
+#include "Platform.h"
+#include "Test.h"
+
+static const unsigned int RunCount = 3;
+
+// Channels each format stores, the PSNR is over these
+static const unsigned int ChannelCounts[BLOCK_FORMAT_COUNT] = { 3, 4, 2, 4 };
+
+static double GetPSNR(const uint8_t* pA, const uint8_t* pB, size_t pixelCount, unsigned int channelCount)
+{
+	double error = 0.0;
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		for (unsigned int c = 0; c < channelCount; c++)
+		{
+			const double d = (double)pA[i * 4 + c] - pB[i * 4 + c];
+			error += d * d;
+		}
+	}
+	const double mse = error / ((double)pixelCount * channelCount);
+	return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+// Smooth color waves with noise and blocks of flat color with hard edges, alpha follows neither or is 255
+static std::vector<uint8_t> MakeImage(uint32_t width, uint32_t height, bool opaque)
+{
+	TestRandom random(1);
+	std::vector<uint8_t> image((size_t)width * height * 4);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint8_t* pPixel = &image[((size_t)y * width + x) * 4];
+			const bool flat = (x / 24 + y / 40) % 5 == 0;
+			for (unsigned int c = 0; c < 3; c++)
+			{
+				const float wave = 128.0f + 100.0f * sinf(x * (0.02f + c * 0.011f) + y * (0.015f * (3 - c)));
+				const int value = flat ? 60 * (int)c + 40 : (int)wave + (int)random.Next(9) - 4;
+				pPixel[c] = (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+			}
+			pPixel[3] = opaque ? 255 : (uint8_t)(128.0f + 127.0f * cosf((x + 2 * y) * 0.01f));
+		}
+	}
+	return image;
+}
+
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	const uint32_t width = BenchmarkSize(512, 64);
+	const uint32_t height = width;
+	const size_t pixelCount = (size_t)width * height;
+	for (unsigned int opaque = 0; opaque < 2; opaque++)
+	{
+		const std::vector<uint8_t> image = MakeImage(width, height, opaque != 0);
+		const char* imageName = opaque != 0 ? "opaque" : "alpha";
+
+		for (unsigned int format = 0; format < BLOCK_FORMAT_COUNT; format++)
+		{
+			const BlockFormat blockFormat = (BlockFormat)format;
+			std::vector<uint8_t> blocks(GetCompressedSize(blockFormat, width, height));
+			std::vector<uint8_t> decoded(pixelCount * 4);
+
+			const double encodeSeconds = MeasureBest(RunCount, [&]()
+			{
+				EncodeImageRows(blockFormat, image.data(), width, height, 0, (height + 3) / 4, blocks.data());
+			});
+			const double decodeSeconds = MeasureBest(RunCount, [&]()
+			{
+				DecodeImage(blockFormat, blocks.data(), width, height, decoded.data());
+			});
+			const double psnr = GetPSNR(image.data(), decoded.data(), pixelCount, ChannelCounts[format]);
+
+			char name[64];
+			sprintf_s(name, "%s, %s encode, %.2f dB", imageName, GetBlockFormatName(blockFormat), psnr);
+			ReportBenchmark(name, encodeSeconds, (double)pixelCount, "pixel");
+			sprintf_s(name, "%s, %s decode", imageName, GetBlockFormatName(blockFormat));
+			ReportBenchmark(name, decodeSeconds, (double)pixelCount, "pixel");
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,304 @@
+#include <math.h>
+#include <string.h>
+
+#include <vector>
+
+#include "BlockCompress.h"
+#include "Test.h"
+
+static const unsigned int BlockPixels = 16;
+static const unsigned int RandomBlockCount = 1024;
+
+// Checksums of the pixels of RandomBlockCount blocks of each BC7 mode, as Mesa's llvmpipe decodes them
+static const uint32_t ModeChecksums[8] =
+{
+	0x6AE42F80, 0x91021539, 0xDB795977, 0xF5E47B61, 0xD9712AF5, 0xEADE69FC, 0x903CF314, 0xC80B0E8C
+};
+
+// FNV-1a
+static uint32_t Checksum(const uint8_t* pData, size_t size, uint32_t hash)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ pData[i]) * 16777619u;
+	}
+	return hash;
+}
+
+// Random bits after the bits which select the mode
+static void MakeRandomBlock(TestRandom& random, unsigned int mode, uint8_t* pBlock)
+{
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		pBlock[i] = (uint8_t)random.Next();
+	}
+	pBlock[0] = (uint8_t)((pBlock[0] & ~((2u << mode) - 1)) | (1u << mode));
+}
+
+struct TestBitWriter
+{
+	uint8_t* pData;
+	unsigned int position;
+
+	void Write(uint32_t value, unsigned int bits)
+	{
+		for (unsigned int i = 0; i < bits; i++, position++)
+		{
+			pData[position / 8] |= (uint8_t)(((value >> i) & 1) << (position % 8));
+		}
+	}
+};
+
+// Block of mode 1 or 2 whose subset s has endpoints black and full channel s, all index bits are set
+// Pixels get the last index but the anchors, whose top bit is implied 0, so they are the only ones between the endpoints
+static void MakeAnchorBlock(unsigned int mode, unsigned int partition, uint8_t* pBlock)
+{
+	const unsigned int subsetCount = mode == 1 ? 2 : 3;
+	const unsigned int colorBits = mode == 1 ? 6 : 5;
+
+	memset(pBlock, 0, 16);
+	TestBitWriter writer = { pBlock, 0 };
+	writer.Write(1 << mode, mode + 1);
+	writer.Write(partition, 6);
+	for (unsigned int c = 0; c < 3; c++)
+	{
+		for (unsigned int s = 0; s < subsetCount; s++)
+		{
+			writer.Write(0, colorBits);
+			writer.Write(c == s ? (1 << colorBits) - 1 : 0, colorBits);
+		}
+	}
+	// Shared p-bits of mode 1 stay 0
+	writer.position += mode == 1 ? 2 : 0;
+	while (writer.position < 128)
+	{
+		writer.Write(1, 1);
+	}
+}
+
+static double GetPSNR(const uint8_t* pA, const uint8_t* pB, size_t pixelCount, unsigned int channelCount)
+{
+	double error = 0.0;
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		for (unsigned int c = 0; c < channelCount; c++)
+		{
+			const double d = (double)pA[i * 4 + c] - pB[i * 4 + c];
+			error += d * d;
+		}
+	}
+	const double mse = error / (pixelCount * channelCount);
+	return mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+static void EncodeAndDecode(BlockFormat format, const uint8_t* pPixels, uint8_t* pBlock, uint8_t* pDecoded)
+{
+	EncodeBlock(format, pPixels, pBlock);
+	CHECK(DecodeBlock(format, pBlock, pDecoded));
+}
+
+TEST(BC7AnchorsLieInTheirSubsets)
+{
+	for (unsigned int mode = 1; mode <= 2; mode++)
+	{
+		const unsigned int subsetCount = mode == 1 ? 2 : 3;
+		for (unsigned int partition = 0; partition < 64; partition++)
+		{
+			uint8_t block[16];
+			uint8_t pixels[BlockPixels * 4];
+			MakeAnchorBlock(mode, partition, block);
+			REQUIRE(DecodeBlock(BLOCK_FORMAT_BC7, block, pixels));
+
+			unsigned int anchorCounts[3] = {};
+			unsigned int pixelCounts[3] = {};
+			for (unsigned int i = 0; i < BlockPixels; i++)
+			{
+				// Subset is the channel which is not 0
+				unsigned int subset = 0;
+				while (subset < 2 && pixels[i * 4 + subset] == 0)
+				{
+					subset++;
+				}
+				const uint8_t value = pixels[i * 4 + subset];
+				CHECK(value != 0);
+				pixelCounts[subset]++;
+				anchorCounts[subset] += value < 200 ? 1 : 0;
+			}
+
+			CHECK(pixels[0] > 0 && pixels[0] < 200);
+			for (unsigned int s = 0; s < subsetCount; s++)
+			{
+				CHECK(pixelCounts[s] > 0);
+				CHECK(anchorCounts[s] == 1);
+			}
+		}
+	}
+}
+
+TEST(BC7DecodesAllModes)
+{
+	for (unsigned int mode = 0; mode < 8; mode++)
+	{
+		TestRandom random(mode + 1);
+		uint32_t hash = 2166136261u;
+		for (unsigned int i = 0; i < RandomBlockCount; i++)
+		{
+			uint8_t block[16];
+			uint8_t pixels[BlockPixels * 4];
+			MakeRandomBlock(random, mode, block);
+			REQUIRE(DecodeBlock(BLOCK_FORMAT_BC7, block, pixels));
+			hash = Checksum(pixels, sizeof(pixels), hash);
+		}
+		CHECK(hash == ModeChecksums[mode]);
+	}
+}
+
+TEST(BC7ReservedModeFails)
+{
+	uint8_t block[16] = {};
+	uint8_t pixels[BlockPixels * 4];
+	CHECK(!DecodeBlock(BLOCK_FORMAT_BC7, block, pixels));
+}
+
+TEST(BC7UsesMode6ForSmoothBlocks)
+{
+	uint8_t pixels[BlockPixels * 4];
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		pixels[i * 4 + 0] = (uint8_t)(40 + i * 10);
+		pixels[i * 4 + 1] = (uint8_t)(200 - i * 8);
+		pixels[i * 4 + 2] = (uint8_t)(90 + i * 3);
+		pixels[i * 4 + 3] = (uint8_t)(255 - i * 5);
+	}
+
+	uint8_t block[16];
+	uint8_t decoded[BlockPixels * 4];
+	EncodeAndDecode(BLOCK_FORMAT_BC7, pixels, block, decoded);
+	CHECK((block[0] & 0x7f) == 1 << 6);
+	CHECK(GetPSNR(pixels, decoded, BlockPixels, 4) > 45.0);
+}
+
+TEST(BC7UsesMode5ForIndependentAlpha)
+{
+	// Color goes left to right, alpha top to bottom, which no single line through RGBA follows
+	uint8_t pixels[BlockPixels * 4];
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		pixels[i * 4 + 0] = (uint8_t)(30 + (i % 4) * 60);
+		pixels[i * 4 + 1] = (uint8_t)(20 + (i % 4) * 40);
+		pixels[i * 4 + 2] = (uint8_t)(10 + (i % 4) * 20);
+		pixels[i * 4 + 3] = (uint8_t)(255 - (i / 4) * 80);
+	}
+
+	uint8_t block[16];
+	uint8_t decoded[BlockPixels * 4];
+	EncodeAndDecode(BLOCK_FORMAT_BC7, pixels, block, decoded);
+	CHECK((block[0] & 0x3f) == 1 << 5);
+	CHECK(GetPSNR(pixels, decoded, BlockPixels, 4) > 40.0);
+}
+
+TEST(BC7UsesMode1ForTwoSubsets)
+{
+	// Shades of red on the left half and of blue on the right one, opaque, no single line goes through both
+	uint8_t pixels[BlockPixels * 4];
+	for (unsigned int i = 0; i < BlockPixels; i++)
+	{
+		const bool right = i % 4 >= 2;
+		const uint8_t shade = (uint8_t)(100 + (i / 4) * 40);
+		pixels[i * 4 + 0] = right ? 30 : shade;
+		pixels[i * 4 + 1] = 40;
+		pixels[i * 4 + 2] = right ? shade : 30;
+		pixels[i * 4 + 3] = 255;
+	}
+
+	uint8_t block[16];
+	uint8_t decoded[BlockPixels * 4];
+	EncodeAndDecode(BLOCK_FORMAT_BC7, pixels, block, decoded);
+	CHECK((block[0] & 3) == 1 << 1);
+	CHECK(GetPSNR(pixels, decoded, BlockPixels, 4) > 38.0);
+}
+
+TEST(EncodedBlocksRoundTrip)
+{
+	static const BlockFormat Formats[] = { BLOCK_FORMAT_BC1, BLOCK_FORMAT_BC3, BLOCK_FORMAT_BC5, BLOCK_FORMAT_BC7 };
+	static const unsigned int ChannelCounts[] = { 3, 4, 2, 4 };
+	// Smooth noisy blocks, the worst format gets above this
+	static const double MinPSNR[] = { 30.0, 30.0, 35.0, 35.0 };
+
+	for (unsigned int f = 0; f < 4; f++)
+	{
+		TestRandom random(10 + f);
+		std::vector<uint8_t> pixels(256 * BlockPixels * 4);
+		for (size_t block = 0; block < 256; block++)
+		{
+			int base[4];
+			int slope[4];
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				base[c] = (int)random.Next(160);
+				slope[c] = (int)random.Next(13) - 6;
+			}
+			for (unsigned int i = 0; i < BlockPixels; i++)
+			{
+				for (unsigned int c = 0; c < 4; c++)
+				{
+					const int value = base[c] + 40 + slope[c] * (int)(i % 4 + i / 4) + (int)random.Next(5) - 2;
+					pixels[(block * BlockPixels + i) * 4 + c] = (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+				}
+			}
+		}
+
+		std::vector<uint8_t> blocks(256 * GetBlockSize(Formats[f]));
+		std::vector<uint8_t> decoded(pixels.size());
+		for (size_t block = 0; block < 256; block++)
+		{
+			EncodeAndDecode(Formats[f], &pixels[block * BlockPixels * 4], &blocks[block * GetBlockSize(Formats[f])], &decoded[block * BlockPixels * 4]);
+		}
+		CHECK(GetPSNR(pixels.data(), decoded.data(), pixels.size() / 4, ChannelCounts[f]) > MinPSNR[f]);
+	}
+}
+
+TEST(BC7RandomPixelsRoundTrip)
+{
+	// Each encoded block must decode, whichever mode it picked
+	TestRandom random(20);
+	for (unsigned int block = 0; block < 512; block++)
+	{
+		uint8_t pixels[BlockPixels * 4];
+		for (uint8_t& value : pixels)
+		{
+			value = (uint8_t)random.Next();
+		}
+		// Some blocks opaque, so mode 1 gets picked too
+		for (unsigned int i = 0; block % 2 == 0 && i < BlockPixels; i++)
+		{
+			pixels[i * 4 + 3] = 255;
+		}
+
+		uint8_t encoded[16];
+		uint8_t decoded[BlockPixels * 4];
+		EncodeAndDecode(BLOCK_FORMAT_BC7, pixels, encoded, decoded);
+		CHECK(GetPSNR(pixels, decoded, BlockPixels, 4) > 10.0);
+	}
+}
+
+TEST(ImageEdgesRepeatLastPixel)
+{
+	// 5x3 image is 2x1 blocks, the second one holds a single column
+	std::vector<uint8_t> image(5 * 3 * 4);
+	for (size_t i = 0; i < image.size() / 4; i++)
+	{
+		image[i * 4 + 0] = (uint8_t)(i * 17);
+		image[i * 4 + 1] = 128;
+		image[i * 4 + 2] = (uint8_t)(255 - i * 17);
+		image[i * 4 + 3] = 255;
+	}
+
+	std::vector<uint8_t> blocks(GetCompressedSize(BLOCK_FORMAT_BC7, 5, 3));
+	REQUIRE(blocks.size() == 2 * 16);
+	EncodeImageRows(BLOCK_FORMAT_BC7, image.data(), 5, 3, 0, 1, blocks.data());
+
+	std::vector<uint8_t> decoded(image.size());
+	REQUIRE(DecodeImage(BLOCK_FORMAT_BC7, blocks.data(), 5, 3, decoded.data()));
+	CHECK(GetPSNR(image.data(), decoded.data(), 5 * 3, 4) > 35.0);
+}
@@ -0,0 +1,97 @@
+#include "FakeRenderContext.h"
+
+static const uint64_t DefaultFrequency = 1000000000;
+
+FakeRenderContext::FakeRenderContext(IRenderContext* pContext)
+	: m_pContext(pContext)
+	, m_frame(0)
+	, m_completedFrames(0)
+	, m_latency(UINT64_MAX)
+	, m_ticks(0)
+	, m_frequency(DefaultFrequency)
+	, m_disjoint(false)
+	, m_waitCount(0)
+{
+}
+
+void FakeRenderContext::EndFrame()
+{
+	m_frame++;
+	if (m_latency != UINT64_MAX && m_frame > m_latency)
+	{
+		CompleteFrames(m_frame - m_latency);
+	}
+}
+
+void FakeRenderContext::CompleteFrames(uint64_t frame)
+{
+	m_completedFrames = frame > m_completedFrames ? frame : m_completedFrames;
+}
+
+void FakeRenderContext::Begin(RenderQuery* pQuery)
+{
+	m_queries[pQuery].ended = false;
+}
+
+void FakeRenderContext::End(RenderQuery* pQuery)
+{
+	QueryState& state = m_queries[pQuery];
+	state.ended = true;
+	state.frame = m_frame;
+	state.ticks = m_ticks;
+	state.frequency = m_frequency;
+	state.disjoint = m_disjoint;
+}
+
+HRESULT FakeRenderContext::GetData(RenderQuery* pQuery, bool flush, bool* pDone)
+{
+	*pDone = GetDoneQuery(pQuery) != NULL;
+	if (*pDone)
+	{
+		return S_OK;
+	}
+
+	// Not done yet this call, as a GPU behind the CPU, the next one finds the frame completed
+	auto it = m_queries.find(pQuery);
+	if (flush && it != m_queries.end() && it->second.ended)
+	{
+		CompleteFrames(it->second.frame + 1);
+		m_waitCount++;
+	}
+	return S_FALSE;
+}
+
+HRESULT FakeRenderContext::GetTimestamp(RenderQuery* pQuery, uint64_t* pTicks)
+{
+	const QueryState* pState = GetDoneQuery(pQuery);
+	if (pState == NULL)
+	{
+		return S_FALSE;
+	}
+
+	*pTicks = pState->ticks;
+	return S_OK;
+}
+
+HRESULT FakeRenderContext::GetTimestampDisjoint(RenderQuery* pQuery, RenderTimestampDisjoint* pData)
+{
+	const QueryState* pState = GetDoneQuery(pQuery);
+	if (pState == NULL)
+	{
+		return S_FALSE;
+	}
+
+	pData->frequency = pState->frequency;
+	pData->disjoint = pState->disjoint;
+	return S_OK;
+}
+
+const FakeRenderContext::QueryState* FakeRenderContext::GetDoneQuery(RenderQuery* pQuery) const
+{
+	auto it = m_queries.find(pQuery);
+	if (it == m_queries.end() || !it->second.ended || it->second.frame >= m_completedFrames)
+	{
+		return NULL;
+	}
+	return &it->second;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <unordered_map>
+
+#include "RenderDevice.h"
+
+// Context whose queries are answered by a fake GPU the test drives, other calls go to the context it wraps
+// Queries are created by the wrapped device and only used as keys here
+// Commands go to the current frame, a query is done once the GPU completed the frame it was ended in
+// Waiting for an event query with a flush completes its frame, as the CPU would block until the GPU got there
+class FakeRenderContext : public IRenderContext
+{
+public:
+	explicit FakeRenderContext(IRenderContext* pContext);
+
+	// Frames submitted to the GPU, the current one included once EndFrame is called for it
+	void EndFrame();
+	uint64_t GetFrame() const { return m_frame; }
+
+	// Completes the frames before frame
+	void CompleteFrames(uint64_t frame);
+	uint64_t GetCompletedFrames() const { return m_completedFrames; }
+	// EndFrame completes frames so that no more than latency frames are in flight, UINT64_MAX completes none
+	void SetLatency(uint64_t latency) { m_latency = latency; }
+
+	// GPU clock read by timestamp queries when they are ended
+	void AdvanceTicks(uint64_t ticks) { m_ticks += ticks; }
+	void SetFrequency(uint64_t frequency) { m_frequency = frequency; }
+	// Disjoint queries ended while set report the frame as disjoint
+	void SetDisjoint(bool disjoint) { m_disjoint = disjoint; }
+
+	// Calls which waited for the GPU
+	unsigned int GetWaitCount() const { return m_waitCount; }
+
+	virtual void Release() {}
+
+	virtual void ClearState() { m_pContext->ClearState(); }
+	virtual void ClearRenderTargetView(RenderResource* pTarget, const float color[4]) { m_pContext->ClearRenderTargetView(pTarget, color); }
+	virtual void ClearDepthStencilView(RenderResource* pDepth, float depth) { m_pContext->ClearDepthStencilView(pDepth, depth); }
+
+	virtual void IASetVertexBuffers(unsigned int startSlot, unsigned int count, RenderResource* const* ppBuffers, const unsigned int* pStrides, const unsigned int* pOffsets)
+	{
+		m_pContext->IASetVertexBuffers(startSlot, count, ppBuffers, pStrides, pOffsets);
+	}
+	virtual void IASetIndexBuffer(RenderResource* pBuffer, RenderFormat format, unsigned int offset) { m_pContext->IASetIndexBuffer(pBuffer, format, offset); }
+	virtual void IASetInputLayout(RenderInputLayout* pLayout) { m_pContext->IASetInputLayout(pLayout); }
+	virtual void IASetPrimitiveTopology(RenderTopology topology) { m_pContext->IASetPrimitiveTopology(topology); }
+
+	virtual void VSSetShader(RenderVertexShader* pShader) { m_pContext->VSSetShader(pShader); }
+	virtual void VSSetConstantBuffers(unsigned int startSlot, unsigned int count, RenderResource* const* ppBuffers, const unsigned int* pFirstConstant, const unsigned int* pNumConstants)
+	{
+		m_pContext->VSSetConstantBuffers(startSlot, count, ppBuffers, pFirstConstant, pNumConstants);
+	}
+
+	virtual void RSSetState(RenderRasterizerState* pState) { m_pContext->RSSetState(pState); }
+	virtual void RSSetViewport(const RenderViewport& viewport) { m_pContext->RSSetViewport(viewport); }
+	virtual void RSSetScissorRect(const RenderRect& rect) { m_pContext->RSSetScissorRect(rect); }
+
+	virtual void PSSetShader(RenderPixelShader* pShader) { m_pContext->PSSetShader(pShader); }
+	virtual void PSSetConstantBuffers(unsigned int startSlot, unsigned int count, RenderResource* const* ppBuffers, const unsigned int* pFirstConstant, const unsigned int* pNumConstants)
+	{
+		m_pContext->PSSetConstantBuffers(startSlot, count, ppBuffers, pFirstConstant, pNumConstants);
+	}
+	virtual void PSSetShaderResources(unsigned int startSlot, unsigned int count, RenderResource* const* ppResources) { m_pContext->PSSetShaderResources(startSlot, count, ppResources); }
+	virtual void PSSetSamplers(unsigned int startSlot, unsigned int count, RenderSamplerState* const* ppSamplers) { m_pContext->PSSetSamplers(startSlot, count, ppSamplers); }
+
+	virtual void OMSetRenderTargets(unsigned int count, RenderResource* const* ppTargets, RenderResource* pDepth) { m_pContext->OMSetRenderTargets(count, ppTargets, pDepth); }
+	virtual void OMSetBlendState(RenderBlendState* pState) { m_pContext->OMSetBlendState(pState); }
+	virtual void OMSetDepthStencilState(RenderDepthStencilState* pState) { m_pContext->OMSetDepthStencilState(pState); }
+
+	virtual void Draw(unsigned int vertexCount, unsigned int startVertex) { m_pContext->Draw(vertexCount, startVertex); }
+	virtual void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) { m_pContext->DrawIndexed(indexCount, startIndex, baseVertex); }
+	virtual void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+	{
+		m_pContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	}
+
+	virtual HRESULT Map(RenderResource* pBuffer, RenderMap mapType, void** ppData) { return m_pContext->Map(pBuffer, mapType, ppData); }
+	virtual void Unmap(RenderResource* pBuffer) { m_pContext->Unmap(pBuffer); }
+
+	virtual void Begin(RenderQuery* pQuery);
+	virtual void End(RenderQuery* pQuery);
+	virtual HRESULT GetData(RenderQuery* pQuery, bool flush, bool* pDone);
+	virtual HRESULT GetTimestamp(RenderQuery* pQuery, uint64_t* pTicks);
+	virtual HRESULT GetTimestampDisjoint(RenderQuery* pQuery, RenderTimestampDisjoint* pData);
+
+	virtual HRESULT FinishCommandList(RenderCommandList** ppList) { return m_pContext->FinishCommandList(ppList); }
+	virtual void ExecuteCommandList(RenderCommandList* pList) { m_pContext->ExecuteCommandList(pList); }
+
+private:
+	struct QueryState
+	{
+		bool ended;
+		uint64_t frame;
+		uint64_t ticks;
+		uint64_t frequency;
+		bool disjoint;
+	};
+
+	FakeRenderContext(const FakeRenderContext&) = delete;
+	FakeRenderContext& operator=(const FakeRenderContext&) = delete;
+
+	// NULL while the query is not done
+	const QueryState* GetDoneQuery(RenderQuery* pQuery) const;
+
+private:
+	IRenderContext* m_pContext;
+
+	uint64_t m_frame;
+	uint64_t m_completedFrames;
+	uint64_t m_latency;
+	uint64_t m_ticks;
+	uint64_t m_frequency;
+	bool m_disjoint;
+	unsigned int m_waitCount;
+
+	std::unordered_map<RenderQuery*, QueryState> m_queries;
+};
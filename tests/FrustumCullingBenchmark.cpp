@@ -0,0 +1,88 @@
+#include <stdio.h>
+
+#include <vector>
+
+#include "Benchmark.h"
+#include "FrustumCulling.h"
+#include "Test.h"
+
+using namespace DirectX;
+
+static const unsigned int RunCount = 5;
+
+// Test of each box against the six planes, what the hierarchy replaces
+static void CullBruteForce(const Frustum& frustum, const std::vector<AABB>& boxes, std::vector<unsigned int>& visible)
+{
+	for (unsigned int i = 0; i < boxes.size(); i++)
+	{
+		const AABB& box = boxes[i];
+		bool outside = false;
+		for (const XMFLOAT4& plane : frustum.planes)
+		{
+			float distance = plane.x * (plane.x >= 0 ? box.max.x : box.min.x)
+				+ plane.y * (plane.y >= 0 ? box.max.y : box.min.y)
+				+ plane.z * (plane.z >= 0 ? box.max.z : box.min.z) + plane.w;
+			outside = outside || distance < 0;
+		}
+		if (!outside)
+		{
+			visible.push_back(i);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	// Unit boxes spread over a 1000 unit cube, a camera in the middle with a 90 degree field of view
+	unsigned int count = BenchmarkSize(1000000, 10000);
+	TestRandom random(11);
+	std::vector<AABB> boxes(count);
+	for (AABB& box : boxes)
+	{
+		float x = random.NextFloat(-500, 500);
+		float y = random.NextFloat(-500, 500);
+		float z = random.NextFloat(-500, 500);
+		box = AABB{ XMFLOAT3{ x - 0.5f, y - 0.5f, z - 0.5f }, XMFLOAT3{ x + 0.5f, y + 0.5f, z + 0.5f } };
+	}
+
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMMatrixPerspectiveLH(2.0f, 2.0f, 1.0f, 300.0f));
+	Frustum frustum;
+	ExtractFrustumPlanes(viewProj, frustum);
+
+	std::vector<unsigned int> visible;
+	visible.reserve(count);
+
+	double seconds = MeasureBest(RunCount, [&]()
+	{
+		visible.clear();
+		CullBruteForce(frustum, boxes, visible);
+	});
+	ReportBenchmark("Brute force", seconds, count, "box");
+	size_t bruteForceVisible = visible.size();
+
+	BoundingVolumeHierarchy bvh;
+	seconds = MeasureBest(RunCount, [&]()
+	{
+		bvh.Build(boxes.data(), count);
+	});
+	ReportBenchmark("BVH build", seconds, count, "box");
+
+	seconds = MeasureBest(RunCount, [&]()
+	{
+		bvh.Refit(boxes.data());
+	});
+	ReportBenchmark("BVH refit", seconds, count, "box");
+
+	seconds = MeasureBest(RunCount, [&]()
+	{
+		visible.clear();
+		bvh.Cull(frustum, visible);
+	});
+	ReportBenchmark("BVH cull", seconds, count, "box");
+
+	printf("%zu of %u boxes visible, %zu by brute force\n", visible.size(), count, bruteForceVisible);
+	return visible.size() == bruteForceVisible ? 0 : 1;
+}
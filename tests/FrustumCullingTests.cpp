@@ -0,0 +1,162 @@
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "FrustumCulling.h"
+#include "Test.h"
+
+using namespace DirectX;
+
+static AABB MakeBox(float x, float y, float z, float halfSize)
+{
+	AABB box = { XMFLOAT3{ x - halfSize, y - halfSize, z - halfSize }, XMFLOAT3{ x + halfSize, y + halfSize, z + halfSize } };
+	return box;
+}
+
+static void MakeRandomBoxes(TestRandom& random, unsigned int count, std::vector<AABB>& boxes)
+{
+	boxes.resize(count);
+	for (AABB& box : boxes)
+	{
+		box = MakeBox(random.NextFloat(-100, 100), random.NextFloat(-100, 100), random.NextFloat(-100, 100), random.NextFloat(0, 3));
+	}
+}
+
+// Frustum of a camera at the origin looking down +z
+static Frustum MakeCameraFrustum(float nearPlane, float farPlane)
+{
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMMatrixPerspectiveLH(2.0f * nearPlane, 2.0f * nearPlane, nearPlane, farPlane));
+
+	Frustum frustum;
+	ExtractFrustumPlanes(viewProj, frustum);
+	return frustum;
+}
+
+// Box is culled only when it is fully outside one plane, as the hierarchy does
+static void CullBruteForce(const Frustum& frustum, const std::vector<AABB>& boxes, std::vector<unsigned int>& visible)
+{
+	for (unsigned int i = 0; i < boxes.size(); i++)
+	{
+		const AABB& box = boxes[i];
+		bool outside = false;
+		for (const XMFLOAT4& plane : frustum.planes)
+		{
+			float distance = plane.x * (plane.x >= 0 ? box.max.x : box.min.x)
+				+ plane.y * (plane.y >= 0 ? box.max.y : box.min.y)
+				+ plane.z * (plane.z >= 0 ? box.max.z : box.min.z) + plane.w;
+			outside = outside || distance < 0;
+		}
+		if (!outside)
+		{
+			visible.push_back(i);
+		}
+	}
+}
+
+TEST(PlanesOfPerspectiveFrustum)
+{
+	Frustum frustum = MakeCameraFrustum(1.0f, 100.0f);
+
+	std::vector<AABB> boxes;
+	boxes.push_back(MakeBox(0, 0, 10, 0.5f));    // In front
+	boxes.push_back(MakeBox(0, 0, -10, 0.5f));   // Behind
+	boxes.push_back(MakeBox(0, 0, 200, 0.5f));   // Past the far plane
+	boxes.push_back(MakeBox(50, 0, 10, 0.5f));   // Right of the 90 degree field of view
+	boxes.push_back(MakeBox(0, -50, 10, 0.5f));  // Below
+	boxes.push_back(MakeBox(10, 0, 10, 0.5f));   // Across the right plane
+	boxes.push_back(MakeBox(0, 0, 100, 0.5f));   // Across the far plane
+
+	BoundingVolumeHierarchy bvh;
+	bvh.Build(boxes.data(), (unsigned int)boxes.size());
+
+	std::vector<unsigned int> visible;
+	bvh.Cull(frustum, visible);
+	std::sort(visible.begin(), visible.end());
+
+	std::vector<unsigned int> expected = { 0, 5, 6 };
+	CHECK(visible == expected);
+}
+
+TEST(HierarchyMatchesBruteForce)
+{
+	TestRandom random(3);
+	for (unsigned int iteration = 0; iteration < 50; iteration++)
+	{
+		std::vector<AABB> boxes;
+		MakeRandomBoxes(random, 1 + random.Next(5000), boxes);
+
+		Frustum frustum;
+		for (XMFLOAT4& plane : frustum.planes)
+		{
+			float x = random.NextFloat(-1, 1);
+			float y = random.NextFloat(-1, 1);
+			float z = random.NextFloat(-1, 1);
+			float length = sqrtf(x * x + y * y + z * z);
+			plane = XMFLOAT4{ x / length, y / length, z / length, random.NextFloat(0, 80) };
+		}
+
+		BoundingVolumeHierarchy bvh;
+		bvh.Build(boxes.data(), (unsigned int)boxes.size());
+		CHECK(bvh.GetBoxCount() == boxes.size());
+
+		std::vector<unsigned int> visible;
+		bvh.Cull(frustum, visible);
+		std::sort(visible.begin(), visible.end());
+
+		std::vector<unsigned int> expected;
+		CullBruteForce(frustum, boxes, expected);
+		REQUIRE(visible == expected);
+	}
+}
+
+// Boxes which moved anywhere are still found after a refit, however loose the tree got
+TEST(RefitFollowsMovedBoxes)
+{
+	TestRandom random(5);
+	std::vector<AABB> boxes;
+	MakeRandomBoxes(random, 3000, boxes);
+
+	BoundingVolumeHierarchy bvh;
+	bvh.Build(boxes.data(), (unsigned int)boxes.size());
+
+	Frustum frustum = MakeCameraFrustum(1.0f, 60.0f);
+	for (unsigned int frame = 0; frame < 10; frame++)
+	{
+		MakeRandomBoxes(random, 3000, boxes);
+		bvh.Refit(boxes.data());
+
+		std::vector<unsigned int> visible;
+		bvh.Cull(frustum, visible);
+		std::sort(visible.begin(), visible.end());
+
+		std::vector<unsigned int> expected;
+		CullBruteForce(frustum, boxes, expected);
+		REQUIRE(visible == expected);
+	}
+}
+
+TEST(TransformedBoxContainsTheRotatedCorners)
+{
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixRotationAxis(XMVECTORF32{ 0, 1, 0 }, 0.785398f) * XMMatrixTranslation(10, 0, 0));
+
+	AABB box = TransformAABB(MakeBox(0, 0, 0, 1), world);
+
+	// Cube turned by 45 degrees spans sqrt(2) around its center
+	CHECK(fabsf(box.min.x - (10 - 1.41421f)) < 1e-4f);
+	CHECK(fabsf(box.max.x - (10 + 1.41421f)) < 1e-4f);
+	CHECK(fabsf(box.min.y + 1) < 1e-4f);
+	CHECK(fabsf(box.max.z - 1.41421f) < 1e-4f);
+}
+
+TEST(EmptyHierarchyCullsNothing)
+{
+	BoundingVolumeHierarchy bvh;
+	bvh.Build(NULL, 0);
+
+	std::vector<unsigned int> visible;
+	bvh.Cull(MakeCameraFrustum(1.0f, 100.0f), visible);
+	CHECK(visible.empty());
+}
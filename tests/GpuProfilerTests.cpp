@@ -0,0 +1,270 @@
+#include <string.h>
+
+#include <string>
+
+#include "FakeRenderContext.h"
+#include "GpuProfiler.h"
+#include "NullRenderDevice.h"
+#include "Test.h"
+#include "TimingHistory.h"
+
+// One tick of the fake GPU clock is a millisecond, so times are exact
+static const uint64_t TicksPerSecond = 1000;
+
+TEST(HistoryIsZeroWhileEmpty)
+{
+	TimingHistory history;
+	CHECK(history.GetCount() == 0);
+	CHECK(history.GetLast() == 0.0);
+	CHECK(history.GetMin() == 0.0);
+	CHECK(history.GetAverage() == 0.0);
+	CHECK(history.GetPercentile(99.0) == 0.0);
+}
+
+TEST(HistoryStats)
+{
+	// Out of order, so min and percentiles do not just take the ends
+	TimingHistory history;
+	for (unsigned int i = 0; i < 100; i++)
+	{
+		history.Add((double)((i * 37) % 100 + 1));
+	}
+
+	CHECK(history.GetCount() == 100);
+	CHECK(history.GetLast() == (double)((99 * 37) % 100 + 1));
+	CHECK(history.GetMin() == 1.0);
+	CHECK(history.GetAverage() == 50.5);
+	// Nearest rank
+	CHECK(history.GetPercentile(99.0) == 99.0);
+	CHECK(history.GetPercentile(50.0) == 50.0);
+	CHECK(history.GetPercentile(100.0) == 100.0);
+	CHECK(history.GetPercentile(0.0) == 1.0);
+
+	history.Clear();
+	CHECK(history.GetCount() == 0);
+	CHECK(history.GetAverage() == 0.0);
+}
+
+TEST(HistoryKeepsLastSamples)
+{
+	TimingHistory history;
+	const unsigned int SampleCount = TimingHistory::HistorySize + 72;
+	for (unsigned int i = 0; i < SampleCount; i++)
+	{
+		history.Add((double)i);
+	}
+
+	// Samples 72 to 199 are left
+	CHECK(history.GetCount() == TimingHistory::HistorySize);
+	CHECK(history.GetLast() == SampleCount - 1.0);
+	CHECK(history.GetMin() == 72.0);
+	CHECK(history.GetAverage() == (72.0 + SampleCount - 1.0) / 2.0);
+	CHECK(history.GetPercentile(99.0) == 198.0);
+	CHECK(history.GetPercentile(100.0) == 199.0);
+}
+
+// Null device for the queries, fake GPU for their results
+struct ProfilerFixture
+{
+	NullRenderDevice device;
+	FakeRenderContext* pContext;
+	GpuProfiler profiler;
+
+	explicit ProfilerFixture(uint64_t latency)
+		: pContext(NULL)
+	{
+		device.Init(64, 64);
+		pContext = new FakeRenderContext(device.GetImmediateContext());
+		pContext->SetLatency(latency);
+		pContext->SetFrequency(TicksPerSecond);
+		profiler.Init(&device);
+	}
+
+	~ProfilerFixture()
+	{
+		profiler.Term();
+		delete pContext;
+		device.Term();
+	}
+
+	// Clear of 1 ms, then the opaque pass with the sky nested in it
+	void RunFrame(uint64_t opaqueTicks, uint64_t skyTicks)
+	{
+		profiler.BeginFrame(pContext);
+		{
+			GpuPassScope clear(profiler, pContext, "Clear");
+			pContext->AdvanceTicks(1);
+		}
+		{
+			GpuPassScope opaque(profiler, pContext, "Opaque");
+			pContext->AdvanceTicks(opaqueTicks - skyTicks);
+			GpuPassScope sky(profiler, pContext, "Sky");
+			pContext->AdvanceTicks(skyTicks);
+		}
+		profiler.EndFrame(pContext);
+		pContext->EndFrame();
+	}
+
+	// GPU catches up, the next frame reads everything before it
+	void ReadAll()
+	{
+		pContext->CompleteFrames(pContext->GetFrame());
+		profiler.BeginFrame(pContext);
+		profiler.EndFrame(pContext);
+		pContext->EndFrame();
+	}
+
+	void GetStats(unsigned int index, GpuPassStats& stats) const
+	{
+		profiler.GetPassStats(index, stats);
+	}
+};
+
+TEST(MeasuresFramesAndNestedPasses)
+{
+	ProfilerFixture fixture(2);
+
+	for (unsigned int i = 0; i < 10; i++)
+	{
+		fixture.RunFrame(i + 2, 1);
+	}
+	// Frames are read once the fake GPU completed them, the last three are not yet
+	CHECK(fixture.profiler.GetMeasuredFrameCount() == 7);
+	fixture.ReadAll();
+
+	CHECK(fixture.profiler.GetMeasuredFrameCount() == 10);
+	CHECK(fixture.profiler.GetSkippedFrameCount() == 0);
+	CHECK(fixture.profiler.GetDisjointFrameCount() == 0);
+	REQUIRE(fixture.profiler.GetPassCount() == 4);
+
+	// Frame first, then passes in the order they began
+	GpuPassStats stats;
+	fixture.GetStats(0, stats);
+	CHECK(strcmp(stats.name, "Frame") == 0);
+	CHECK(stats.count == 10);
+	CHECK(stats.lastMs == 12.0);
+	CHECK(stats.minMs == 3.0);
+	CHECK(stats.avgMs == 7.5);
+	CHECK(stats.p99Ms == 12.0);
+
+	fixture.GetStats(1, stats);
+	CHECK(strcmp(stats.name, "Clear") == 0);
+	CHECK(stats.minMs == 1.0);
+	CHECK(stats.p99Ms == 1.0);
+
+	// Nested pass is inside the enclosing one, which still covers it
+	fixture.GetStats(2, stats);
+	CHECK(strcmp(stats.name, "Opaque") == 0);
+	CHECK(stats.lastMs == 11.0);
+	CHECK(stats.minMs == 2.0);
+	CHECK(stats.avgMs == 6.5);
+	fixture.GetStats(3, stats);
+	CHECK(strcmp(stats.name, "Sky") == 0);
+	CHECK(stats.count == 10);
+	CHECK(stats.avgMs == 1.0);
+
+	std::string text = fixture.profiler.FormatStats();
+	CHECK(text.find("GPU frames: 10 measured, 0 skipped, 0 disjoint") != std::string::npos);
+	CHECK(text.find("GPU Opaque") != std::string::npos);
+}
+
+TEST(StatsCoverTheLastFramesOnly)
+{
+	ProfilerFixture fixture(1);
+
+	const unsigned int FrameCount = TimingHistory::HistorySize + 50;
+	for (unsigned int i = 0; i < FrameCount; i++)
+	{
+		fixture.RunFrame(i < 50 ? 100 : 2, 1);
+	}
+	fixture.ReadAll();
+
+	// Slow frames at the start are overwritten
+	GpuPassStats stats;
+	fixture.GetStats(2, stats);
+	CHECK(fixture.profiler.GetMeasuredFrameCount() == FrameCount);
+	CHECK(stats.count == TimingHistory::HistorySize);
+	CHECK(stats.avgMs == 2.0);
+	CHECK(stats.p99Ms == 2.0);
+}
+
+// With the GPU that far behind, the slot of a frame is still pending when it comes around again
+TEST(FrameOfPendingSlotIsSkipped)
+{
+	ProfilerFixture fixture(UINT64_MAX);
+
+	for (unsigned int i = 0; i < 10; i++)
+	{
+		fixture.RunFrame(2, 1);
+	}
+	CHECK(fixture.profiler.GetMeasuredFrameCount() == 0);
+	CHECK(fixture.profiler.GetSkippedFrameCount() == 10 - GpuProfiler::FrameLatency);
+	CHECK(fixture.profiler.GetPassCount() == 0);
+
+	// Reading the pending slots frees them, so the next frame is measured again
+	fixture.ReadAll();
+	CHECK(fixture.profiler.GetMeasuredFrameCount() == GpuProfiler::FrameLatency);
+	CHECK(fixture.profiler.GetSkippedFrameCount() == 10 - GpuProfiler::FrameLatency);
+	fixture.ReadAll();
+	CHECK(fixture.profiler.GetMeasuredFrameCount() == GpuProfiler::FrameLatency + 1);
+
+	// Profiler never waits for the GPU
+	CHECK(fixture.pContext->GetWaitCount() == 0);
+}
+
+TEST(DisjointFramesAreNotMeasured)
+{
+	ProfilerFixture fixture(2);
+
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		// Disjoint query takes the state at the end of the frame
+		fixture.pContext->SetDisjoint(i == 2 || i == 3);
+		fixture.pContext->SetFrequency(i == 5 ? 0 : TicksPerSecond);
+		fixture.RunFrame(100 + i, 1);
+	}
+	fixture.pContext->SetDisjoint(false);
+	fixture.pContext->SetFrequency(TicksPerSecond);
+	fixture.ReadAll();
+
+	CHECK(fixture.profiler.GetDisjointFrameCount() == 3);
+	CHECK(fixture.profiler.GetMeasuredFrameCount() == 5);
+
+	GpuPassStats stats;
+	fixture.GetStats(2, stats);
+	CHECK(stats.count == 5);
+	CHECK(stats.minMs == 100.0);
+	CHECK(stats.lastMs == 107.0);
+	CHECK(stats.avgMs == (100.0 + 101.0 + 104.0 + 106.0 + 107.0) / 5.0);
+}
+
+// Passes past MaxPasses are not measured, their ends do not close the pass enclosing them
+TEST(OverflowingPassesAreDropped)
+{
+	ProfilerFixture fixture(1);
+
+	fixture.profiler.BeginFrame(fixture.pContext);
+	{
+		GpuPassScope outer(fixture.profiler, fixture.pContext, "Outer");
+		for (unsigned int i = 0; i < GpuProfiler::MaxPasses + 4; i++)
+		{
+			GpuPassScope inner(fixture.profiler, fixture.pContext, "Inner");
+			fixture.pContext->AdvanceTicks(1);
+		}
+		fixture.pContext->AdvanceTicks(10);
+	}
+	fixture.profiler.EndFrame(fixture.pContext);
+	fixture.pContext->EndFrame();
+	fixture.ReadAll();
+
+	REQUIRE(fixture.profiler.GetPassCount() == 3);
+	GpuPassStats stats;
+	fixture.GetStats(1, stats);
+	CHECK(strcmp(stats.name, "Outer") == 0);
+	CHECK(stats.lastMs == GpuProfiler::MaxPasses + 4 + 10.0);
+
+	fixture.GetStats(2, stats);
+	CHECK(strcmp(stats.name, "Inner") == 0);
+	CHECK(stats.count == GpuProfiler::MaxPasses - 1);
+	CHECK(stats.p99Ms == 1.0);
+}
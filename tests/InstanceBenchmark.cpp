@@ -0,0 +1,54 @@
+#include <vector>
+
+#include "Benchmark.h"
+#include "InstancePacker.h"
+#include "NullRenderDevice.h"
+
+using namespace DirectX;
+
+static const unsigned int BufferCapacity = 4096;
+static const unsigned int CubeIndexCount = 36;
+static const unsigned int RunCount = 10;
+
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	unsigned int count = BenchmarkSize(100000, 5000);
+
+	std::vector<XMFLOAT4X4> model(count);
+	std::vector<XMFLOAT4X4> normal(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMStoreFloat4x4(&model[i], XMMatrixTranslation((float)i, 0, 0));
+		XMStoreFloat4x4(&normal[i], XMMatrixIdentity());
+	}
+
+	// Packing alone, into memory as large as all instances
+	std::vector<InstanceData> instances(count);
+	double seconds = MeasureBest(RunCount, [&]()
+	{
+		PackInstances(model.data(), normal.data(), count, instances.data());
+	});
+	ReportBenchmark("PackInstances", seconds, count, "instance");
+	ReportBenchmark("PackInstances bytes", seconds, (double)count * sizeof(InstanceData), "B");
+
+	// Batches of the instance buffer on the null device, maps and draws included
+	NullRenderDevice device;
+	device.Init(64, 64);
+	RenderResource* pInstanceBuffer = NULL;
+	RenderBufferDesc desc = { sizeof(InstanceData) * BufferCapacity, USAGE_DYNAMIC, BIND_VERTEX_BUFFER, 0, FORMAT_UNKNOWN };
+	device.CreateBuffer(desc, NULL, &pInstanceBuffer);
+
+	seconds = MeasureBest(RunCount, [&]()
+	{
+		DrawInstances(device.GetImmediateContext(), pInstanceBuffer, BufferCapacity, CubeIndexCount, model.data(), normal.data(), count);
+		device.Present();
+	});
+	ReportBenchmark("DrawInstances, 4096 per batch", seconds, count, "instance");
+
+	pInstanceBuffer->Release();
+	device.Term();
+
+	return 0;
+}
@@ -0,0 +1,137 @@
+#include <vector>
+
+#include "FakeRenderContext.h"
+#include "InstancePacker.h"
+#include "NullRenderDevice.h"
+#include "Test.h"
+
+using namespace DirectX;
+
+static const unsigned int BufferCapacity = 4096;
+static const unsigned int CubeIndexCount = 36;
+
+// Matrices tell their instance by the translation
+static void MakeMatrices(unsigned int count, std::vector<XMFLOAT4X4>& model, std::vector<XMFLOAT4X4>& normal)
+{
+	model.resize(count);
+	normal.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMStoreFloat4x4(&model[i], XMMatrixTranslation((float)i, 0, 0));
+		XMStoreFloat4x4(&normal[i], XMMatrixTranslation(0, (float)i, 0));
+	}
+}
+
+// Checks every batch when it is unmapped, instances of a batch follow the ones of the previous batch
+class InstanceCheckContext : public FakeRenderContext
+{
+public:
+	explicit InstanceCheckContext(IRenderContext* pContext)
+		: FakeRenderContext(pContext)
+		, m_pMapped(NULL)
+		, m_nextInstance(0)
+		, m_mismatches(0)
+	{
+	}
+
+	virtual HRESULT Map(RenderResource* pBuffer, RenderMap mapType, void** ppData)
+	{
+		HRESULT result = FakeRenderContext::Map(pBuffer, mapType, ppData);
+		m_pMapped = SUCCEEDED(result) ? (const InstanceData*)*ppData : NULL;
+		return result;
+	}
+
+	virtual void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+	{
+		for (unsigned int i = 0; i < instanceCount; i++)
+		{
+			bool matches = m_pMapped != NULL && m_pMapped[i].modelMatrix._41 == (float)m_nextInstance && m_pMapped[i].normalMatrix._42 == (float)m_nextInstance;
+			m_mismatches += matches ? 0 : 1;
+			m_nextInstance++;
+		}
+		FakeRenderContext::DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	}
+
+	unsigned int GetInstanceCount() const { return m_nextInstance; }
+	unsigned int GetMismatchCount() const { return m_mismatches; }
+
+private:
+	const InstanceData* m_pMapped;
+	unsigned int m_nextInstance;
+	unsigned int m_mismatches;
+};
+
+TEST(PackInstancesCopiesMatrices)
+{
+	std::vector<XMFLOAT4X4> model;
+	std::vector<XMFLOAT4X4> normal;
+	MakeMatrices(5, model, normal);
+
+	InstanceData instances[5];
+	PackInstances(model.data(), normal.data(), 5, instances);
+	for (unsigned int i = 0; i < 5; i++)
+	{
+		CHECK(instances[i].modelMatrix._41 == (float)i);
+		CHECK(instances[i].normalMatrix._42 == (float)i);
+		CHECK(instances[i].modelMatrix._44 == 1.0f);
+	}
+}
+
+static void DrawAndCheck(unsigned int count)
+{
+	NullRenderDevice device;
+	REQUIRE(device.Init(64, 64));
+
+	RenderResource* pInstanceBuffer = NULL;
+	RenderBufferDesc desc = { sizeof(InstanceData) * BufferCapacity, USAGE_DYNAMIC, BIND_VERTEX_BUFFER, 0, FORMAT_UNKNOWN };
+	REQUIRE(SUCCEEDED(device.CreateBuffer(desc, NULL, &pInstanceBuffer)));
+
+	std::vector<XMFLOAT4X4> model;
+	std::vector<XMFLOAT4X4> normal;
+	MakeMatrices(count, model, normal);
+
+	InstanceCheckContext context(device.GetImmediateContext());
+	unsigned int drawCount = DrawInstances(&context, pInstanceBuffer, BufferCapacity, CubeIndexCount, model.data(), normal.data(), count);
+	device.Present();
+
+	unsigned int expectedDraws = (count + BufferCapacity - 1) / BufferCapacity;
+	CHECK(drawCount == expectedDraws);
+	CHECK(context.GetInstanceCount() == count);
+	CHECK(context.GetMismatchCount() == 0);
+
+	const NullFrameStats& stats = device.GetFrameStats();
+	CHECK(stats.drawCount == expectedDraws);
+	CHECK(stats.mapCount == expectedDraws);
+	CHECK(stats.triangleCount == (uint64_t)count * CubeIndexCount / 3);
+
+	unsigned int largestBatch = 0;
+	for (const NullCommand& command : device.GetFrameLog())
+	{
+		if (command.type == NULL_COMMAND_DRAW_INDEXED_INSTANCED)
+		{
+			largestBatch = command.instanceCount > largestBatch ? command.instanceCount : largestBatch;
+		}
+	}
+	CHECK(largestBatch == (count < BufferCapacity ? count : BufferCapacity));
+
+	pInstanceBuffer->Release();
+	device.Term();
+}
+
+TEST(InstancesWhichFitAreOneDraw)
+{
+	DrawAndCheck(1);
+	DrawAndCheck(BufferCapacity);
+}
+
+// Every instance is drawn with the matrices of its object, none past the buffer is dropped
+TEST(HundredThousandInstancesAreDrawnInBatches)
+{
+	DrawAndCheck(BufferCapacity + 1);
+	DrawAndCheck(100000);
+}
+
+TEST(NoInstancesNoDraws)
+{
+	DrawAndCheck(0);
+}
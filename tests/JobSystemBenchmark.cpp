@@ -0,0 +1,102 @@
+#include <stdio.h>
+
+#include <atomic>
+#include <thread>
+
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "Platform.h"
+
+static const unsigned int RunCount = 3;
+static const unsigned int MaxWorkers = 64;
+
+// Overhead of scheduling: empty jobs, created one by one and by ParallelFor
+static void BenchmarkOverhead(JobSystem& jobs, unsigned int jobCount)
+{
+	unsigned int workerCount = jobs.GetWorkerCount();
+	char name[64];
+
+	double seconds = MeasureBest(RunCount, [&]()
+	{
+		Job* pRoot = jobs.CreateJob(std::function<void()>());
+		for (unsigned int i = 0; i < jobCount; i++)
+		{
+			jobs.Run(jobs.CreateJob([] {}, pRoot));
+			// Jobs of a worker come from a ring, the root keeps them from being reused too soon
+			if ((i + 1) % (JobSystem::MaxJobsPerWorker / 2) == 0)
+			{
+				jobs.Run(pRoot);
+				jobs.Wait(pRoot);
+				pRoot = jobs.CreateJob(std::function<void()>());
+			}
+		}
+		jobs.Run(pRoot);
+		jobs.Wait(pRoot);
+	});
+	sprintf_s(name, "Empty jobs, %u workers", workerCount);
+	ReportBenchmark(name, seconds, jobCount, "job");
+
+	std::atomic<unsigned int> sum(0);
+	seconds = MeasureBest(RunCount, [&]()
+	{
+		for (unsigned int i = 0; i < jobCount / 1000; i++)
+		{
+			jobs.ParallelFor(1000, 1, [&sum](unsigned int first, unsigned int count)
+			{
+				UNREFERENCED_PARAMETER(first);
+				sum += count;
+			});
+		}
+	});
+	sprintf_s(name, "ParallelFor of 1000, %u workers", workerCount);
+	ReportBenchmark(name, seconds, jobCount, "item");
+}
+
+// Scaling: the same arithmetic split over the workers
+static void BenchmarkScaling(JobSystem& jobs, unsigned int itemCount)
+{
+	static const unsigned int WorkPerItem = 256;
+
+	std::atomic<uint32_t> result(0);
+	double seconds = MeasureBest(RunCount, [&]()
+	{
+		jobs.ParallelFor(itemCount, 64, [&result](unsigned int first, unsigned int count)
+		{
+			uint32_t hash = 0;
+			for (unsigned int i = first; i < first + count; i++)
+			{
+				uint32_t x = i;
+				for (unsigned int j = 0; j < WorkPerItem; j++)
+				{
+					x = x * 1664525u + 1013904223u;
+				}
+				hash ^= x;
+			}
+			result ^= hash;
+		});
+	});
+
+	char name[64];
+	sprintf_s(name, "Compute, %u workers", jobs.GetWorkerCount());
+	ReportBenchmark(name, seconds, itemCount, "item");
+}
+
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	printf("%u hardware threads\n", std::thread::hardware_concurrency());
+
+	unsigned int jobCount = BenchmarkSize(1000000, 10000);
+	unsigned int itemCount = BenchmarkSize(4000000, 40000);
+	for (unsigned int workerCount = 1; workerCount <= MaxWorkers; workerCount *= 2)
+	{
+		JobSystem jobs;
+		jobs.Init(workerCount);
+
+		BenchmarkOverhead(jobs, jobCount);
+		BenchmarkScaling(jobs, itemCount);
+	}
+
+	return 0;
+}
@@ -0,0 +1,358 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+#include "Platform.h"
+#include "Test.h"
+
+// Jobs of the deque tests are only told apart by address
+static const unsigned int DequeCapacity = 256;
+
+TEST(DequePopsInReverseOrderAndStealsInOrder)
+{
+	std::vector<Job> jobs(4);
+	WorkStealingDeque deque;
+	deque.Init(DequeCapacity);
+
+	for (Job& job : jobs)
+	{
+		CHECK(deque.Push(&job));
+	}
+	CHECK(deque.Steal() == &jobs[0]);
+	CHECK(deque.Pop() == &jobs[3]);
+	CHECK(deque.Steal() == &jobs[1]);
+	CHECK(deque.Pop() == &jobs[2]);
+	CHECK(deque.Pop() == NULL);
+	CHECK(deque.Steal() == NULL);
+}
+
+TEST(DequeRejectsPushWhenFull)
+{
+	std::vector<Job> jobs(DequeCapacity + 1);
+	WorkStealingDeque deque;
+	deque.Init(DequeCapacity);
+
+	for (unsigned int i = 0; i < DequeCapacity; i++)
+	{
+		CHECK(deque.Push(&jobs[i]));
+	}
+	CHECK(!deque.Push(&jobs[DequeCapacity]));
+
+	// Room again after a steal, the ring wraps
+	CHECK(deque.Steal() == &jobs[0]);
+	CHECK(deque.Push(&jobs[DequeCapacity]));
+	CHECK(deque.Pop() == &jobs[DequeCapacity]);
+}
+
+// Owner pushes and pops while thieves steal, every job is taken exactly once
+TEST(DequeStress)
+{
+	static const unsigned int JobCount = 200000;
+	static const unsigned int ThiefCount = 3;
+
+	std::vector<Job> jobs(JobCount);
+	std::vector<std::atomic<int>> taken(JobCount);
+	for (std::atomic<int>& count : taken)
+	{
+		count = 0;
+	}
+
+	WorkStealingDeque deque;
+	deque.Init(DequeCapacity);
+	std::atomic<bool> done(false);
+
+	auto take = [&jobs, &taken](Job* pJob)
+	{
+		taken[pJob - jobs.data()].fetch_add(1, std::memory_order_relaxed);
+	};
+
+	std::vector<std::thread> thieves;
+	for (unsigned int i = 0; i < ThiefCount; i++)
+	{
+		thieves.push_back(std::thread([&deque, &done, &take]
+		{
+			while (!done.load(std::memory_order_acquire))
+			{
+				Job* pJob = deque.Steal();
+				if (pJob != NULL)
+				{
+					take(pJob);
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+		}));
+	}
+
+	// Bursts of pushes, each followed by a few pops, so the owner races the thieves for the last jobs
+	TestRandom random(9);
+	unsigned int pushed = 0;
+	while (pushed < JobCount)
+	{
+		unsigned int burst = 1 + random.Next(DequeCapacity);
+		for (unsigned int i = 0; i < burst && pushed < JobCount; i++)
+		{
+			if (deque.Push(&jobs[pushed]))
+			{
+				pushed++;
+			}
+		}
+
+		unsigned int pops = random.Next(burst + 1);
+		for (unsigned int i = 0; i < pops; i++)
+		{
+			Job* pJob = deque.Pop();
+			if (pJob != NULL)
+			{
+				take(pJob);
+			}
+		}
+	}
+
+	for (Job* pJob = deque.Pop(); pJob != NULL; pJob = deque.Pop())
+	{
+		take(pJob);
+	}
+	done.store(true, std::memory_order_release);
+	for (std::thread& thief : thieves)
+	{
+		thief.join();
+	}
+
+	unsigned int wrong = 0;
+	for (std::atomic<int>& count : taken)
+	{
+		wrong += count.load() != 1 ? 1 : 0;
+	}
+	CHECK(wrong == 0);
+}
+
+TEST(ParallelForCoversEachItemOnce)
+{
+	for (unsigned int workerCount = 1; workerCount <= 8; workerCount *= 2)
+	{
+		JobSystem jobs;
+		jobs.Init(workerCount);
+
+		for (unsigned int i = 0; i < 50; i++)
+		{
+			unsigned int count = 1 + i * 997 % 100000;
+			std::vector<std::atomic<int>> hits(count);
+			for (std::atomic<int>& hit : hits)
+			{
+				hit = 0;
+			}
+
+			jobs.ParallelFor(count, 1 + i % 64, [&hits](unsigned int first, unsigned int batchCount)
+			{
+				for (unsigned int j = first; j < first + batchCount; j++)
+				{
+					hits[j]++;
+				}
+			});
+
+			unsigned int wrong = 0;
+			for (std::atomic<int>& hit : hits)
+			{
+				wrong += hit.load() != 1 ? 1 : 0;
+			}
+			CHECK(wrong == 0);
+		}
+	}
+}
+
+TEST(DependenciesRunInOrder)
+{
+	JobSystem jobs;
+	jobs.Init(4);
+
+	for (unsigned int i = 0; i < 2000; i++)
+	{
+		std::atomic<int> stage(0);
+		std::atomic<bool> outOfOrder(false);
+
+		Job* pA = jobs.CreateJob([&] { outOfOrder = outOfOrder || stage != 0; stage = 1; });
+		Job* pB = jobs.CreateJob([&] { outOfOrder = outOfOrder || stage != 1; stage = 2; });
+		Job* pC = jobs.CreateJob([&] { outOfOrder = outOfOrder || stage != 2; stage = 3; });
+		Job* pD = jobs.CreateJob([&] { outOfOrder = outOfOrder || stage < 1; });
+		jobs.AddDependency(pB, pA);
+		jobs.AddDependency(pC, pB);
+		jobs.AddDependency(pD, pA);
+
+		jobs.Run(pC);
+		jobs.Run(pD);
+		jobs.Run(pB);
+		jobs.Run(pA);
+		jobs.Wait(pC);
+		jobs.Wait(pD);
+
+		CHECK(!outOfOrder);
+		CHECK(stage == 3);
+	}
+}
+
+TEST(ParentFinishesAfterChildren)
+{
+	JobSystem jobs;
+	jobs.Init(4);
+
+	std::atomic<unsigned int> finished(0);
+	Job* pRoot = jobs.CreateJob(std::function<void()>());
+	for (unsigned int i = 0; i < 1000; i++)
+	{
+		jobs.Run(jobs.CreateJob([&finished] { finished++; }, pRoot));
+	}
+	jobs.Run(pRoot);
+	jobs.Wait(pRoot);
+
+	CHECK(jobs.IsFinished(pRoot));
+	CHECK(finished == 1000);
+}
+
+TEST(OnlyWorkersAreWorkers)
+{
+	JobSystem jobs;
+	jobs.Init(4);
+	CHECK(jobs.IsWorker());
+	CHECK(jobs.GetWorkerIndex() == 0);
+
+	// Jobs run on the workers
+	std::atomic<unsigned int> outsideJobs(0);
+	jobs.ParallelFor(10000, 1, [&jobs, &outsideJobs](unsigned int first, unsigned int count)
+	{
+		UNREFERENCED_PARAMETER(first);
+		UNREFERENCED_PARAMETER(count);
+		outsideJobs += jobs.GetWorkerIndex() < jobs.GetWorkerCount() ? 0 : 1;
+	});
+	CHECK(outsideJobs == 0);
+
+	bool outsideIsWorker = true;
+	unsigned int outsideIndex = 0;
+	std::thread outside([&]
+	{
+		outsideIsWorker = jobs.IsWorker();
+		outsideIndex = jobs.GetWorkerIndex();
+	});
+	outside.join();
+	CHECK(!outsideIsWorker);
+	CHECK(outsideIndex == JobSystem::NoWorker);
+}
+
+// Threads the system does not own take the attached workers, one each, and run jobs like the rest
+TEST(AttachedThreadsAreWorkers)
+{
+	JobSystem jobs;
+	jobs.Init(2, 2);
+	CHECK(jobs.GetWorkerCount() == 4);
+
+	std::atomic<unsigned int> covered(0);
+	std::atomic<unsigned int> attachedCount(0);
+	unsigned int indices[2] = { JobSystem::NoWorker, JobSystem::NoWorker };
+	std::vector<std::thread> threads;
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		threads.push_back(std::thread([&, i]
+		{
+			if (!jobs.Attach())
+			{
+				return;
+			}
+			attachedCount++;
+			indices[i] = jobs.GetWorkerIndex();
+			for (unsigned int j = 0; j < 100; j++)
+			{
+				jobs.ParallelFor(1000, 1, [&covered](unsigned int first, unsigned int count)
+				{
+					UNREFERENCED_PARAMETER(first);
+					covered += count;
+				});
+			}
+			jobs.Detach();
+		}));
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	CHECK(attachedCount == 2);
+	CHECK(covered == 2 * 100 * 1000);
+	CHECK(indices[0] >= 2 && indices[0] < 4);
+	CHECK(indices[1] >= 2 && indices[1] < 4);
+
+	// No more than attachedCount threads at once, a detached worker is free again
+	bool attached[3] = {};
+	bool isWorker = true;
+	std::thread outside([&]
+	{
+		attached[0] = jobs.Attach();
+		std::thread second([&]
+		{
+			attached[1] = jobs.Attach();
+			std::thread third([&] { attached[2] = jobs.Attach(); });
+			third.join();
+			jobs.Detach();
+		});
+		second.join();
+		jobs.Detach();
+		isWorker = jobs.IsWorker();
+	});
+	outside.join();
+	CHECK(attached[0] && attached[1] && !attached[2]);
+	CHECK(!isWorker);
+}
+
+// Worker index of a thread belongs to one system, workers of another are not its workers
+TEST(WorkersOfOtherSystemsAreNotWorkers)
+{
+	JobSystem first;
+	first.Init(2, 1);
+	JobSystem second;
+
+	bool secondOnOwnThread = false;
+	bool firstOnSecondThread = true;
+	unsigned int firstIndexOnSecondThread = 0;
+	std::atomic<unsigned int> firstInSecondJobs(0);
+	bool attachedToFirst = false;
+	unsigned int attachedIndex = JobSystem::NoWorker;
+	std::thread other([&]
+	{
+		second.Init(2, 1);
+		secondOnOwnThread = second.IsWorker() && second.GetWorkerIndex() == 0;
+		firstOnSecondThread = first.IsWorker();
+		firstIndexOnSecondThread = first.GetWorkerIndex();
+		second.ParallelFor(1000, 1, [&](unsigned int start, unsigned int count)
+		{
+			UNREFERENCED_PARAMETER(start);
+			UNREFERENCED_PARAMETER(count);
+			firstInSecondJobs += first.IsWorker() ? 1 : 0;
+		});
+		second.Term();
+		// Term releases the thread, so it may attach elsewhere
+		attachedToFirst = first.Attach();
+		if (attachedToFirst)
+		{
+			attachedIndex = first.GetWorkerIndex();
+			first.Detach();
+		}
+	});
+	other.join();
+
+	CHECK(secondOnOwnThread);
+	CHECK(!firstOnSecondThread);
+	CHECK(firstIndexOnSecondThread == JobSystem::NoWorker);
+	CHECK(firstInSecondJobs == 0);
+	CHECK(attachedToFirst);
+	CHECK(attachedIndex == 2);
+
+	CHECK(first.IsWorker());
+	CHECK(first.GetWorkerIndex() == 0);
+	CHECK(!second.IsWorker());
+	CHECK(second.GetWorkerIndex() == JobSystem::NoWorker);
+
+	first.Term();
+	CHECK(!first.IsWorker());
+}
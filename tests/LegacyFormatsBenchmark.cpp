@@ -0,0 +1,51 @@
+#include <stdio.h>
+
+#include <vector>
+
+#include "Benchmark.h"
+#include "LegacyFormats.h"
+#include "Platform.h"
+#include "Test.h"
+
+static const unsigned int RunCount = 5;
+
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	static const LegacyFormat Formats[] = { LEGACY_FORMAT_R8G8B8, LEGACY_FORMAT_B8G8R8, LEGACY_FORMAT_X8B8G8R8, LEGACY_FORMAT_X1R5G5B5, LEGACY_FORMAT_X4R4G4B4 };
+	static const char* FormatNames[] = { "", "R8G8B8", "B8G8R8", "X8B8G8R8", "X1R5G5B5", "X4R4G4B4" };
+	static const char* LevelNames[] = { "scalar", "SSSE3", "AVX2", "NEON" };
+
+	// 2048x2048
+	size_t pixelCount = BenchmarkSize(4 * 1024 * 1024, 64 * 1024);
+	TestRandom random(5);
+	std::vector<uint8_t> src(pixelCount * 4);
+	for (uint8_t& value : src)
+	{
+		value = (uint8_t)random.Next();
+	}
+	std::vector<uint8_t> dst(pixelCount * 4);
+
+	for (LegacyFormat format : Formats)
+	{
+		for (unsigned int level = SIMD_LEVEL_SCALAR; level <= SIMD_LEVEL_NEON; level++)
+		{
+			if (!IsSimdLevelSupported((SimdLevel)level))
+			{
+				continue;
+			}
+
+			double seconds = MeasureBest(RunCount, [&]()
+			{
+				ConvertLegacyPixels(format, src.data(), dst.data(), pixelCount, (SimdLevel)level);
+			});
+
+			char name[64];
+			sprintf_s(name, "%s, %s", FormatNames[format], LevelNames[level]);
+			ReportBenchmark(name, seconds, (double)pixelCount, "pixel");
+		}
+	}
+
+	return 0;
+}
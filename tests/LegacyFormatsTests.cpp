@@ -0,0 +1,137 @@
+#include <stdio.h>
+
+#include <vector>
+
+#include "LegacyFormats.h"
+#include "Test.h"
+
+static const LegacyFormat Formats[] = { LEGACY_FORMAT_R8G8B8, LEGACY_FORMAT_B8G8R8, LEGACY_FORMAT_X8B8G8R8, LEGACY_FORMAT_X1R5G5B5, LEGACY_FORMAT_X4R4G4B4 };
+static const SimdLevel SimdLevels[] = { SIMD_LEVEL_SSSE3, SIMD_LEVEL_AVX2, SIMD_LEVEL_NEON };
+static const char* SimdLevelNames[] = { "scalar", "SSSE3", "AVX2", "NEON" };
+static const size_t MaxTailPixels = 300;
+static const uint8_t Guard = 0xCD;
+
+// Pixel by pixel, from the format descriptions
+static void ConvertReference(LegacyFormat format, const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount)
+{
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		switch (format)
+		{
+		case LEGACY_FORMAT_R8G8B8:
+			pDst[i * 4 + 0] = pSrc[i * 3 + 2];
+			pDst[i * 4 + 1] = pSrc[i * 3 + 1];
+			pDst[i * 4 + 2] = pSrc[i * 3 + 0];
+			pDst[i * 4 + 3] = 0xFF;
+			break;
+		case LEGACY_FORMAT_B8G8R8:
+			pDst[i * 4 + 0] = pSrc[i * 3 + 0];
+			pDst[i * 4 + 1] = pSrc[i * 3 + 1];
+			pDst[i * 4 + 2] = pSrc[i * 3 + 2];
+			pDst[i * 4 + 3] = 0xFF;
+			break;
+		case LEGACY_FORMAT_X8B8G8R8:
+			pDst[i * 4 + 0] = pSrc[i * 4 + 0];
+			pDst[i * 4 + 1] = pSrc[i * 4 + 1];
+			pDst[i * 4 + 2] = pSrc[i * 4 + 2];
+			pDst[i * 4 + 3] = 0xFF;
+			break;
+		case LEGACY_FORMAT_X1R5G5B5:
+			pDst[i * 2 + 0] = pSrc[i * 2 + 0];
+			pDst[i * 2 + 1] = pSrc[i * 2 + 1] | 0x80;
+			break;
+		case LEGACY_FORMAT_X4R4G4B4:
+			pDst[i * 2 + 0] = pSrc[i * 2 + 0];
+			pDst[i * 2 + 1] = pSrc[i * 2 + 1] | 0xF0;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static std::vector<uint8_t> MakeSource(TestRandom& random, LegacyFormat format, size_t pixelCount, size_t offset)
+{
+	std::vector<uint8_t> src(offset + pixelCount * GetLegacySourceSize(format));
+	for (uint8_t& value : src)
+	{
+		value = (uint8_t)random.Next();
+	}
+	return src;
+}
+
+// Converts at an offset into a guarded buffer, so misaligned pointers and writes past the end show
+static std::vector<uint8_t> Convert(LegacyFormat format, const std::vector<uint8_t>& src, size_t srcOffset, size_t pixelCount, SimdLevel level, size_t dstOffset)
+{
+	std::vector<uint8_t> dst(dstOffset + pixelCount * GetLegacyTargetSize(format) + 64, Guard);
+	ConvertLegacyPixels(format, src.data() + srcOffset, dst.data() + dstOffset, pixelCount, level);
+	return std::vector<uint8_t>(dst.begin() + dstOffset, dst.end());
+}
+
+TEST(SizesOfFormats)
+{
+	CHECK(GetLegacySourceSize(LEGACY_FORMAT_R8G8B8) == 3);
+	CHECK(GetLegacyTargetSize(LEGACY_FORMAT_R8G8B8) == 4);
+	CHECK(GetLegacySourceSize(LEGACY_FORMAT_X8B8G8R8) == 4);
+	CHECK(GetLegacySourceSize(LEGACY_FORMAT_X1R5G5B5) == 2);
+	CHECK(GetLegacyTargetSize(LEGACY_FORMAT_X4R4G4B4) == 2);
+}
+
+TEST(ScalarMatchesReference)
+{
+	TestRandom random(1);
+	for (LegacyFormat format : Formats)
+	{
+		for (size_t pixelCount = 0; pixelCount <= MaxTailPixels; pixelCount++)
+		{
+			std::vector<uint8_t> src = MakeSource(random, format, pixelCount, 0);
+			std::vector<uint8_t> expected(pixelCount * GetLegacyTargetSize(format) + 64, Guard);
+			ConvertReference(format, src.data(), expected.data(), pixelCount);
+
+			CHECK(Convert(format, src, 0, pixelCount, SIMD_LEVEL_SCALAR, 0) == expected);
+		}
+	}
+}
+
+// Every pixel count up to 300 covers all tails of the 16 and 32 byte loops, and several whole iterations
+TEST(SimdMatchesScalar)
+{
+	TestRandom random(2);
+	for (SimdLevel level : SimdLevels)
+	{
+		if (!IsSimdLevelSupported(level))
+		{
+			printf("%s is not supported, skipped\n", SimdLevelNames[level]);
+			continue;
+		}
+
+		for (LegacyFormat format : Formats)
+		{
+			unsigned int mismatches = 0;
+			for (size_t pixelCount = 0; pixelCount <= MaxTailPixels; pixelCount++)
+			{
+				size_t srcOffset = pixelCount % 4;
+				size_t dstOffset = (pixelCount / 4) % 4;
+				std::vector<uint8_t> src = MakeSource(random, format, pixelCount, srcOffset);
+
+				std::vector<uint8_t> expected = Convert(format, src, srcOffset, pixelCount, SIMD_LEVEL_SCALAR, 0);
+				mismatches += Convert(format, src, srcOffset, pixelCount, level, dstOffset) != expected ? 1 : 0;
+			}
+			CHECK(mismatches == 0);
+		}
+	}
+}
+
+TEST(BestLevelIsSupported)
+{
+	CHECK(IsSimdLevelSupported(SIMD_LEVEL_SCALAR));
+	CHECK(IsSimdLevelSupported(GetSimdLevel()));
+
+	TestRandom random(3);
+	std::vector<uint8_t> src = MakeSource(random, LEGACY_FORMAT_R8G8B8, 1000, 0);
+	std::vector<uint8_t> dst(1000 * 4);
+	std::vector<uint8_t> expected(1000 * 4);
+	ConvertLegacyPixels(LEGACY_FORMAT_R8G8B8, src.data(), dst.data(), 1000);
+	ConvertReference(LEGACY_FORMAT_R8G8B8, src.data(), expected.data(), 1000);
+	CHECK(dst == expected);
+}
@@ -0,0 +1,71 @@
+#include <math.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "Benchmark.h"
+#include "LightClusters.h"
+#include "Platform.h"
+#include "Test.h"
+
+using namespace DirectX;
+
+static const float NearPlane = 0.001f;
+static const float FarPlane = 100.0f;
+static const float FieldOfView = 2.0944f;
+static const unsigned int Width = 1920;
+static const unsigned int Height = 1080;
+static const unsigned int MaxIndices = LightClusters::Count * 64;
+static const unsigned int RunCount = 3;
+
+static void Benchmark(unsigned int lightCount, bool reference)
+{
+	float viewWidth = 2.0f * NearPlane * tanf(FieldOfView * 0.5f);
+	XMFLOAT4X4 proj;
+	XMStoreFloat4x4(&proj, XMMatrixPerspectiveLH(viewWidth, viewWidth * Height / Width, NearPlane, FarPlane));
+	XMFLOAT4X4 view;
+	XMStoreFloat4x4(&view, XMMatrixTranslation(0, 0, 10));
+
+	TestRandom random(lightCount);
+	std::vector<ClusterLight> lights(lightCount);
+	for (ClusterLight& light : lights)
+	{
+		XMFLOAT3 color{ random.NextFloat(0, 0.1f), random.NextFloat(0, 0.1f), random.NextFloat(0, 0.1f) };
+		light.pos = XMFLOAT4{ random.NextFloat(-30, 30), random.NextFloat(-10, 10), random.NextFloat(-20, 110), LightCutoffRadius(color) };
+		light.color = XMFLOAT4{ color.x, color.y, color.z, 0 };
+	}
+
+	LightClusters clusters;
+	clusters.Setup(proj, NearPlane, FarPlane, Width, Height);
+
+	double seconds = MeasureBest(RunCount, [&]()
+	{
+		if (reference)
+		{
+			clusters.AssignReference(lights.data(), lightCount, view, MaxIndices);
+		}
+		else
+		{
+			clusters.Assign(lights.data(), lightCount, view, MaxIndices);
+		}
+	});
+
+	char name[64];
+	sprintf_s(name, "%s, %u lights", reference ? "AssignReference" : "Assign", lightCount);
+	ReportBenchmark(name, seconds, lightCount, "light");
+}
+
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	unsigned int lightCounts[] = { 100, 1000, 10000 };
+	for (unsigned int lightCount : lightCounts)
+	{
+		unsigned int count = BenchmarkSize(lightCount, lightCount / 10);
+		Benchmark(count, false);
+		Benchmark(count, true);
+	}
+
+	return 0;
+}
@@ -0,0 +1,140 @@
+#include <math.h>
+
+#include <vector>
+
+#include "LightClusters.h"
+#include "Test.h"
+
+using namespace DirectX;
+
+static const float NearPlane = 0.001f;
+static const float FarPlane = 100.0f;
+static const float FieldOfView = 2.0944f; // 120 degrees wide, as Renderer
+static const unsigned int NoIndexLimit = 1u << 24;
+
+static void SetupClusters(LightClusters& clusters, unsigned int width, unsigned int height)
+{
+	float viewWidth = 2.0f * NearPlane * tanf(FieldOfView * 0.5f);
+	float viewHeight = viewWidth * height / width;
+
+	XMFLOAT4X4 proj;
+	XMStoreFloat4x4(&proj, XMMatrixPerspectiveLH(viewWidth, viewHeight, NearPlane, FarPlane));
+	clusters.Setup(proj, NearPlane, FarPlane, width, height);
+}
+
+// Dim lights in front of the camera, some behind it and past the far plane
+static void MakeLights(TestRandom& random, unsigned int count, std::vector<ClusterLight>& lights)
+{
+	lights.resize(count);
+	for (ClusterLight& light : lights)
+	{
+		XMFLOAT3 color{ random.NextFloat(0, 0.1f), random.NextFloat(0, 0.1f), random.NextFloat(0, 0.1f) };
+		light.pos = XMFLOAT4{ random.NextFloat(-30, 30), random.NextFloat(-10, 10), random.NextFloat(-20, 110), LightCutoffRadius(color) };
+		light.color = XMFLOAT4{ color.x, color.y, color.z, 0 };
+	}
+}
+
+static bool SameAssignment(const LightClusters& a, const LightClusters& b)
+{
+	if (a.GetLightIndices() != b.GetLightIndices() || a.GetRanges().size() != b.GetRanges().size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < a.GetRanges().size(); i++)
+	{
+		if (a.GetRanges()[i].offset != b.GetRanges()[i].offset || a.GetRanges()[i].count != b.GetRanges()[i].count)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void CompareWithReference(TestRandom& random, unsigned int lightCount, unsigned int maxIndices)
+{
+	unsigned int width = 800 + random.Next(1000);
+	unsigned int height = 600 + random.Next(500);
+
+	LightClusters fast;
+	LightClusters reference;
+	SetupClusters(fast, width, height);
+	SetupClusters(reference, width, height);
+
+	XMFLOAT4X4 view;
+	XMStoreFloat4x4(&view, XMMatrixTranslation(random.NextFloat(-2, 2), 0, 10));
+
+	std::vector<ClusterLight> lights;
+	MakeLights(random, lightCount, lights);
+
+	fast.Assign(lights.data(), lightCount, view, maxIndices);
+	reference.AssignReference(lights.data(), lightCount, view, maxIndices);
+
+	CHECK(fast.GetRanges().size() == LightClusters::Count);
+	CHECK(fast.GetLightIndices().size() <= maxIndices);
+	CHECK(SameAssignment(fast, reference));
+}
+
+TEST(AssignMatchesReference)
+{
+	TestRandom random(3);
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		CompareWithReference(random, 1 + random.Next(3000), NoIndexLimit);
+	}
+}
+
+TEST(AssignMatchesReferenceWithTenThousandLights)
+{
+	TestRandom random(4);
+	CompareWithReference(random, 10000, NoIndexLimit);
+}
+
+// Lists of the clusters which do not fit are cut the same way
+TEST(AssignMatchesReferenceWhenIndicesRunOut)
+{
+	TestRandom random(5);
+	CompareWithReference(random, 2000, 1000);
+}
+
+TEST(LightReachesOnlyNearbyClusters)
+{
+	LightClusters clusters;
+	SetupClusters(clusters, 1600, 900);
+
+	XMFLOAT4X4 view;
+	XMStoreFloat4x4(&view, XMMatrixIdentity());
+
+	// Small light straight ahead is in a few clusters around the center of the screen
+	ClusterLight light = { XMFLOAT4{ 0, 0, 5, 0.5f }, XMFLOAT4{ 1, 1, 1, 0 } };
+	clusters.Assign(&light, 1, view, NoIndexLimit);
+
+	unsigned int litClusters = 0;
+	bool offCenter = false;
+	for (unsigned int i = 0; i < LightClusters::Count; i++)
+	{
+		const LightClusters::Range& range = clusters.GetRanges()[i];
+		if (range.count != 0)
+		{
+			litClusters++;
+			unsigned int x = i % LightClusters::CountX;
+			unsigned int y = (i / LightClusters::CountX) % LightClusters::CountY;
+			offCenter = offCenter || x < 6 || x > 9 || y < 2 || y > 6;
+		}
+	}
+	CHECK(litClusters != 0);
+	CHECK(litClusters < 40);
+	CHECK(!offCenter);
+
+	// Behind the camera, none
+	light.pos = XMFLOAT4{ 0, 0, -5, 0.5f };
+	clusters.Assign(&light, 1, view, NoIndexLimit);
+	CHECK(clusters.GetLightIndices().empty());
+}
+
+TEST(CutoffRadiusGrowsWithIntensity)
+{
+	float dim = LightCutoffRadius(XMFLOAT3{ 0.01f, 0.01f, 0.01f });
+	float bright = LightCutoffRadius(XMFLOAT3{ 1, 0.5f, 0.1f });
+	CHECK(dim > 0);
+	CHECK(bright > dim);
+}
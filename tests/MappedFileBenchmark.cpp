@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "MappedFile.h"
+#include "Platform.h"
+#include "Test.h"
+
+namespace fs = std::filesystem;
+
+static const unsigned int RunCount = 5;
+
+// Files are read from the file cache after the first run, so this is the cost of the copy
+// and of the page faults, not of the disk
+static void Benchmark(const std::vector<std::string>& paths, size_t fileSize, FileAccess access, bool copyAll)
+{
+	std::vector<uint8_t> upload(fileSize);
+	double seconds = MeasureBest(RunCount, [&]()
+	{
+		for (const std::string& path : paths)
+		{
+			MappedFile file;
+			if (!file.Open(path.c_str(), access))
+			{
+				printf("Could not open %s\n", path.c_str());
+				return;
+			}
+			// Data is copied once more on its way to the GPU, as resource creation does
+			// Header only is how a loader which skips mips over its size limit uses a file
+			memcpy(upload.data(), file.GetData(), copyAll ? file.GetSize() : 128);
+		}
+	});
+
+	char name[64];
+	sprintf_s(name, "%s, %s, %zu KB files", access == FILE_ACCESS_MAP ? "Map" : "Read", copyAll ? "whole file" : "header", fileSize / 1024);
+	ReportBenchmark(name, seconds, (double)fileSize * paths.size(), "B");
+}
+
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	size_t fileSizes[] = { 64 * 1024, 4 * 1024 * 1024 };
+	for (size_t fileSize : fileSizes)
+	{
+		// 128 MB of files of each size
+		unsigned int fileCount = BenchmarkSize((uint32_t)(128 * 1024 * 1024 / fileSize), 4);
+
+		fs::create_directories("MappedFileBenchmark");
+		std::vector<char> data(fileSize, 'x');
+		std::vector<std::string> paths;
+		for (unsigned int i = 0; i < fileCount; i++)
+		{
+			paths.push_back((fs::path("MappedFileBenchmark") / ("File" + std::to_string(i) + ".bin")).string());
+			std::ofstream file(paths.back(), std::ios::binary | std::ios::trunc);
+			file.write(data.data(), data.size());
+		}
+
+		Benchmark(paths, fileSize, FILE_ACCESS_MAP, true);
+		Benchmark(paths, fileSize, FILE_ACCESS_READ, true);
+		Benchmark(paths, fileSize, FILE_ACCESS_MAP, false);
+		Benchmark(paths, fileSize, FILE_ACCESS_READ, false);
+
+		std::error_code error;
+		fs::remove_all("MappedFileBenchmark", error);
+	}
+
+	return 0;
+}
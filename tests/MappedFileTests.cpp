@@ -0,0 +1,94 @@
+#include <errno.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "Test.h"
+
+namespace fs = std::filesystem;
+
+static const FileAccess Accesses[] = { FILE_ACCESS_MAP, FILE_ACCESS_READ };
+
+static std::string WriteTestFile(const char* name, const std::vector<uint8_t>& data)
+{
+	fs::create_directories("MappedFileTests");
+	std::string path = (fs::path("MappedFileTests") / name).string();
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write((const char*)data.data(), data.size());
+	return path;
+}
+
+TEST(OpensWholeFile)
+{
+	// Not a multiple of the page size
+	TestRandom random(1);
+	std::vector<uint8_t> data(3 * 4096 + 123);
+	for (uint8_t& value : data)
+	{
+		value = (uint8_t)random.Next();
+	}
+	std::string path = WriteTestFile("Data.bin", data);
+
+	for (FileAccess access : Accesses)
+	{
+		MappedFile file;
+		REQUIRE(file.Open(path.c_str(), access));
+		CHECK(file.IsOpen());
+		REQUIRE(file.GetSize() == data.size());
+		CHECK(std::vector<uint8_t>(file.GetData(), file.GetData() + file.GetSize()) == data);
+		file.Prefault();
+
+		file.Close();
+		CHECK(!file.IsOpen());
+		CHECK(file.GetData() == NULL);
+		CHECK(file.GetSize() == 0);
+	}
+}
+
+TEST(OpensEmptyFile)
+{
+	std::string path = WriteTestFile("Empty.bin", std::vector<uint8_t>());
+
+	for (FileAccess access : Accesses)
+	{
+		MappedFile file;
+		CHECK(file.Open(path.c_str(), access));
+		CHECK(file.GetData() == NULL);
+		CHECK(file.GetSize() == 0);
+	}
+}
+
+TEST(ReportsErrors)
+{
+	for (FileAccess access : Accesses)
+	{
+		MappedFile file;
+		CHECK(!file.Open("MappedFileTests/Missing.bin", access));
+		CHECK(file.GetError() == ENOENT);
+		CHECK(!file.IsOpen());
+
+		fs::create_directories("MappedFileTests");
+		CHECK(!file.Open("MappedFileTests", access));
+		CHECK(file.GetError() == EINVAL);
+	}
+}
+
+// Open of another file closes the previous one, a reopened file does not keep old data
+TEST(ReopensAcrossAccesses)
+{
+	std::string small = WriteTestFile("Small.bin", std::vector<uint8_t>(10, 1));
+	std::string large = WriteTestFile("Large.bin", std::vector<uint8_t>(100000, 2));
+
+	MappedFile file;
+	CHECK(file.Open(large.c_str(), FILE_ACCESS_READ));
+	CHECK(file.Open(small.c_str(), FILE_ACCESS_MAP));
+	REQUIRE(file.GetSize() == 10);
+	CHECK(file.GetData()[9] == 1);
+	CHECK(file.Open(large.c_str(), FILE_ACCESS_MAP));
+	CHECK(file.Open(small.c_str(), FILE_ACCESS_READ));
+	REQUIRE(file.GetSize() == 10);
+	CHECK(file.GetData()[0] == 1);
+}
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include "Platform.h"
+#include "Test.h"
+
+static const unsigned int RunCount = 3;
+
+struct MipCase
+{
+	const char* name;
+	MipFilter filter;
+	unsigned int flags;
+};
+
+static const MipCase Cases[] =
+{
+	{ "box", MIP_FILTER_BOX, 0 },
+	{ "box sRGB", MIP_FILTER_BOX, MIP_FLAG_SRGB },
+	{ "box normal map", MIP_FILTER_BOX, MIP_FLAG_NORMAL_MAP },
+	{ "Kaiser", MIP_FILTER_KAISER, 0 }
+};
+
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	// 8K, as the largest textures the tutorial loads without mips
+	const uint32_t size = BenchmarkSize(8192, 256);
+	std::vector<uint8_t> top((size_t)size * size * 4);
+	TestRandom random(3);
+	for (uint8_t& value : top)
+	{
+		value = (uint8_t)random.Next();
+	}
+	// Top mip is only read, so it is copied once
+	std::vector<uint8_t> chain(GetMipChainSize(size, size));
+	memcpy(chain.data(), top.data(), top.size());
+
+	printf("%u hardware threads\n", std::thread::hardware_concurrency());
+
+	// Rate is given in pixels of the top mip, the rest of the chain adds a third to them
+	unsigned int maxWorkers = std::thread::hardware_concurrency();
+	for (unsigned int workerCount = 1; workerCount == 1 || workerCount <= maxWorkers; workerCount *= 2)
+	{
+		JobSystem jobs;
+		jobs.Init(workerCount);
+		for (const MipCase& mipCase : Cases)
+		{
+			double seconds = MeasureBest(RunCount, [&]()
+			{
+				GenerateMipChain(chain.data(), size, size, mipCase.filter, mipCase.flags, workerCount > 1 ? &jobs : NULL);
+			});
+
+			char name[64];
+			sprintf_s(name, "%ux%u %s, %u workers", size, size, mipCase.name, workerCount);
+			ReportBenchmark(name, seconds, (double)size * size, "pixel");
+		}
+	}
+
+	return 0;
+}
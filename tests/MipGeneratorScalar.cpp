@@ -0,0 +1,7 @@
+// Scalar reference build of the mip generator, the SSE2 code of the library is tested against it
+#define MIP_GENERATOR_NO_SIMD
+#define GetFullMipCount ScalarGetFullMipCount
+#define GetMipChainSize ScalarGetMipChainSize
+#define GenerateMip ScalarGenerateMip
+#define GenerateMipChain ScalarGenerateMipChain
+#include "MipGenerator.cpp"
@@ -0,0 +1,126 @@
+#include <vector>
+
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include "Test.h"
+
+// MipGeneratorScalar.cpp
+void ScalarGenerateMipChain(uint8_t* pChain, uint32_t width, uint32_t height, MipFilter filter, unsigned int flags, JobSystem* pJobs);
+
+struct MipSize
+{
+	uint32_t width;
+	uint32_t height;
+};
+
+// Odd sizes take three taps, widths which are not a multiple of 4 leave scalar tails in SSE2 rows
+static const MipSize Sizes[] = { { 1, 1 }, { 2, 2 }, { 5, 3 }, { 7, 1 }, { 1, 9 }, { 64, 64 }, { 257, 129 }, { 300, 200 } };
+static const MipFilter Filters[] = { MIP_FILTER_BOX, MIP_FILTER_KAISER };
+static const unsigned int Flags[] = { 0, MIP_FLAG_SRGB, MIP_FLAG_NORMAL_MAP, MIP_FLAG_SRGB | MIP_FLAG_NORMAL_MAP };
+
+static std::vector<uint8_t> MakeChain(uint32_t width, uint32_t height, uint32_t seed)
+{
+	std::vector<uint8_t> chain(GetMipChainSize(width, height));
+	TestRandom random(seed);
+	for (size_t i = 0; i < (size_t)width * height * 4; i++)
+	{
+		chain[i] = (uint8_t)random.Next();
+	}
+	return chain;
+}
+
+TEST(ChainSizes)
+{
+	CHECK(GetFullMipCount(1, 1) == 1);
+	CHECK(GetFullMipCount(256, 256) == 9);
+	CHECK(GetFullMipCount(300, 7) == 9);
+	CHECK(GetMipChainSize(1, 1) == 4);
+	CHECK(GetMipChainSize(4, 2) == (8 + 2 + 1) * 4);
+	CHECK(GetMipChainSize(5, 3) == (15 + 2 + 1) * 4);
+}
+
+TEST(BoxAveragesEvenSizes)
+{
+	// Halves of a step round up
+	uint8_t chain[(4 + 1) * 4] = { 0, 10, 255, 0, 255, 20, 255, 255, 0, 30, 255, 0, 255, 40, 255, 255 };
+	GenerateMipChain(chain, 2, 2, MIP_FILTER_BOX, 0);
+	CHECK(chain[16] == 128);
+	CHECK(chain[17] == 25);
+	CHECK(chain[18] == 255);
+	CHECK(chain[19] == 128);
+
+	// Tilts to opposite sides cancel out, the average is renormalized
+	uint8_t normals[(4 + 1) * 4] = { 0, 128, 128, 255, 255, 128, 128, 255, 0, 128, 128, 255, 255, 128, 128, 255 };
+	GenerateMipChain(normals, 2, 2, MIP_FILTER_BOX, MIP_FLAG_NORMAL_MAP);
+	CHECK(normals[16] == 128);
+	CHECK(normals[17] == 218);
+	CHECK(normals[18] == 218);
+	CHECK(normals[19] == 255);
+
+	// Normals which cancel out completely become flat, a row of 4 takes the SSE2 path
+	std::vector<uint8_t> flat(GetMipChainSize(8, 1));
+	for (unsigned int x = 0; x < 8; x++)
+	{
+		const uint8_t value = x % 2 == 0 ? 0 : 255;
+		flat[x * 4 + 0] = value;
+		flat[x * 4 + 1] = value;
+		flat[x * 4 + 2] = value;
+		flat[x * 4 + 3] = 255;
+	}
+	GenerateMipChain(flat.data(), 8, 1, MIP_FILTER_BOX, MIP_FLAG_NORMAL_MAP);
+	for (unsigned int x = 0; x < 4; x++)
+	{
+		CHECK(flat[32 + x * 4 + 0] == 128);
+		CHECK(flat[32 + x * 4 + 1] == 128);
+		CHECK(flat[32 + x * 4 + 2] == 255);
+	}
+}
+
+TEST(SRGBIsFilteredInLinearSpace)
+{
+	// Average of black and white is brighter than the middle value
+	uint8_t chain[(2 + 1) * 4] = { 0, 0, 0, 0, 255, 255, 255, 255 };
+	GenerateMipChain(chain, 2, 1, MIP_FILTER_BOX, MIP_FLAG_SRGB);
+	CHECK(chain[8] == 188);
+	CHECK(chain[11] == 128);
+}
+
+// SSE2 and scalar code do the same operations in the same order, so chains are the same to the bit
+TEST(MatchesScalarReference)
+{
+	uint32_t seed = 1;
+	for (const MipSize& size : Sizes)
+	{
+		for (MipFilter filter : Filters)
+		{
+			for (unsigned int flags : Flags)
+			{
+				std::vector<uint8_t> chain = MakeChain(size.width, size.height, seed);
+				std::vector<uint8_t> reference = chain;
+				GenerateMipChain(chain.data(), size.width, size.height, filter, flags);
+				ScalarGenerateMipChain(reference.data(), size.width, size.height, filter, flags, NULL);
+				CHECK(chain == reference);
+				seed++;
+			}
+		}
+	}
+}
+
+// Each row is made by one job, so splitting does not change results
+TEST(JobsMatchSingleThread)
+{
+	JobSystem jobs;
+	jobs.Init(4);
+
+	for (MipFilter filter : Filters)
+	{
+		for (unsigned int flags : Flags)
+		{
+			std::vector<uint8_t> chain = MakeChain(300, 200, flags + 100);
+			std::vector<uint8_t> single = chain;
+			GenerateMipChain(chain.data(), 300, 200, filter, flags, &jobs);
+			GenerateMipChain(single.data(), 300, 200, filter, flags);
+			CHECK(chain == single);
+		}
+	}
+}
@@ -0,0 +1,118 @@
+#include <stdio.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "ParallelRecorder.h"
+#include "Platform.h"
+
+static const unsigned int RunCount = 3;
+static const unsigned int MaxWorkers = 8;
+static const unsigned int WorkPerItem = 64;
+
+// Null backend plus some arithmetic per item, in place of building commands for a draw
+class BusyRecordBackend : public NullRecordBackend
+{
+public:
+	BusyRecordBackend()
+		: m_result(0)
+	{
+	}
+
+	virtual bool RecordChunk(unsigned int worker, unsigned int chunk, unsigned int firstItem, unsigned int itemCount)
+	{
+		NullRecordBackend::RecordChunk(worker, chunk, firstItem, itemCount);
+
+		uint32_t hash = 0;
+		for (unsigned int i = firstItem; i < firstItem + itemCount; i++)
+		{
+			uint32_t x = i;
+			for (unsigned int j = 0; j < WorkPerItem; j++)
+			{
+				x = x * 1664525u + 1013904223u;
+			}
+			hash ^= x;
+		}
+		m_result ^= hash;
+		return true;
+	}
+
+private:
+	std::atomic<uint32_t> m_result;
+};
+
+// All chunks recorded and submitted once, in order
+static bool IsComplete(const NullRecordBackend& backend, unsigned int chunkCount)
+{
+	const std::vector<unsigned int>& submitted = backend.GetSubmitted();
+	if (submitted.size() != chunkCount)
+	{
+		return false;
+	}
+	for (unsigned int i = 0; i < chunkCount; i++)
+	{
+		if (submitted[i] != i || backend.GetChunks()[i].worker == JobSystem::NoWorker)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	printf("%u hardware threads\n", std::thread::hardware_concurrency());
+
+	unsigned int itemCount = BenchmarkSize(100000, 1000);
+	unsigned int incomplete = 0;
+	for (unsigned int workerCount = 1; workerCount <= MaxWorkers; workerCount *= 2)
+	{
+		JobSystem jobs;
+		jobs.Init(workerCount);
+		ParallelRecorder recorder;
+		recorder.Init(&jobs);
+
+		// One chunk is the single threaded case, more chunks than workers balance the load
+		const unsigned int chunkCounts[] = { 1, workerCount, workerCount * 4, 64 };
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			unsigned int chunkCount = chunkCounts[i];
+			if (i > 0 && chunkCount == chunkCounts[i - 1])
+			{
+				continue;
+			}
+
+			BusyRecordBackend backend;
+			double seconds = MeasureBest(RunCount, [&]()
+			{
+				recorder.Record(&backend, itemCount, chunkCount);
+			});
+			incomplete += IsComplete(backend, chunkCount) ? 0 : 1;
+
+			char name[64];
+			sprintf_s(name, "Record, %u workers, %u chunks", workerCount, chunkCount);
+			ReportBenchmark(name, seconds, itemCount, "item");
+
+			// Scheduling cost alone
+			NullRecordBackend null;
+			seconds = MeasureBest(RunCount, [&]()
+			{
+				recorder.Record(&null, itemCount, chunkCount);
+			});
+			incomplete += IsComplete(null, chunkCount) ? 0 : 1;
+
+			sprintf_s(name, "Null, %u workers, %u chunks", workerCount, chunkCount);
+			ReportBenchmark(name, seconds, chunkCount, "chunk");
+		}
+
+		recorder.Term();
+		jobs.Term();
+	}
+
+	return incomplete == 0 ? 0 : 1;
+}
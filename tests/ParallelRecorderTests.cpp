@@ -0,0 +1,164 @@
+#include <vector>
+
+#include "JobSystem.h"
+#include "ParallelRecorder.h"
+#include "Test.h"
+
+static const unsigned int ChunkCounts[] = { 1, 2, 3, 7, 8, 16, 33, 64 };
+static const unsigned int ItemCounts[] = { 0, 1, 5, 64, 1000, 1001 };
+
+// Fails the chunks it is told to, records the rest as the null backend does
+class FailingRecordBackend : public NullRecordBackend
+{
+public:
+	explicit FailingRecordBackend(unsigned int failedChunk)
+		: m_failedChunk(failedChunk)
+	{
+	}
+
+	virtual bool RecordChunk(unsigned int worker, unsigned int chunk, unsigned int firstItem, unsigned int itemCount)
+	{
+		NullRecordBackend::RecordChunk(worker, chunk, firstItem, itemCount);
+		return chunk != m_failedChunk;
+	}
+
+private:
+	unsigned int m_failedChunk;
+};
+
+// Every item is in exactly one chunk, chunks follow each other and differ in size by at most one
+static bool CoversItemsOnce(const std::vector<NullRecordBackend::Chunk>& chunks, unsigned int itemCount)
+{
+	std::vector<unsigned int> covered(itemCount, 0);
+	unsigned int next = 0;
+	unsigned int minCount = itemCount;
+	unsigned int maxCount = 0;
+	for (const NullRecordBackend::Chunk& chunk : chunks)
+	{
+		if (chunk.firstItem != next || chunk.firstItem + chunk.itemCount > itemCount)
+		{
+			return false;
+		}
+		for (unsigned int i = chunk.firstItem; i < chunk.firstItem + chunk.itemCount; i++)
+		{
+			covered[i]++;
+		}
+		next += chunk.itemCount;
+		minCount = chunk.itemCount < minCount ? chunk.itemCount : minCount;
+		maxCount = chunk.itemCount > maxCount ? chunk.itemCount : maxCount;
+	}
+
+	for (unsigned int count : covered)
+	{
+		if (count != 1)
+		{
+			return false;
+		}
+	}
+	return next == itemCount && maxCount - minCount <= 1;
+}
+
+static bool SubmittedInOrder(const std::vector<unsigned int>& submitted, unsigned int chunkCount)
+{
+	if (submitted.size() != chunkCount)
+	{
+		return false;
+	}
+	for (unsigned int i = 0; i < chunkCount; i++)
+	{
+		if (submitted[i] != i)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+TEST(PartitionCoversEachItemOnce)
+{
+	for (unsigned int itemCount : ItemCounts)
+	{
+		for (unsigned int chunkCount : ChunkCounts)
+		{
+			std::vector<NullRecordBackend::Chunk> chunks(chunkCount);
+			for (unsigned int i = 0; i < chunkCount; i++)
+			{
+				chunks[i].worker = 0;
+				PartitionChunk(itemCount, chunkCount, i, &chunks[i].firstItem, &chunks[i].itemCount);
+			}
+			CHECK(CoversItemsOnce(chunks, itemCount));
+		}
+	}
+}
+
+TEST(RecordsEveryChunkAndSubmitsInOrder)
+{
+	for (unsigned int workerCount = 1; workerCount <= 8; workerCount++)
+	{
+		JobSystem jobs;
+		jobs.Init(workerCount);
+		ParallelRecorder recorder;
+		recorder.Init(&jobs);
+		CHECK(recorder.GetWorkerCount() == workerCount);
+
+		for (unsigned int itemCount : ItemCounts)
+		{
+			for (unsigned int chunkCount : ChunkCounts)
+			{
+				NullRecordBackend backend;
+				CHECK(recorder.Record(&backend, itemCount, chunkCount));
+
+				const std::vector<NullRecordBackend::Chunk>& chunks = backend.GetChunks();
+				REQUIRE(chunks.size() == chunkCount);
+				unsigned int badWorkers = 0;
+				for (const NullRecordBackend::Chunk& chunk : chunks)
+				{
+					badWorkers += chunk.worker < workerCount ? 0 : 1;
+				}
+				CHECK(badWorkers == 0);
+				CHECK(CoversItemsOnce(chunks, itemCount));
+				CHECK(SubmittedInOrder(backend.GetSubmitted(), chunkCount));
+			}
+		}
+
+		recorder.Term();
+		jobs.Term();
+	}
+}
+
+TEST(NoChunksSubmitNothing)
+{
+	JobSystem jobs;
+	jobs.Init(4);
+	ParallelRecorder recorder;
+	recorder.Init(&jobs);
+
+	NullRecordBackend backend;
+	CHECK(recorder.Record(&backend, 100, 0));
+	CHECK(backend.GetChunks().empty());
+	CHECK(backend.GetSubmitted().empty());
+
+	recorder.Term();
+	jobs.Term();
+}
+
+// One failed chunk fails the recording, but all chunks are still submitted
+TEST(FailedChunkIsStillSubmitted)
+{
+	JobSystem jobs;
+	jobs.Init(4);
+	ParallelRecorder recorder;
+	recorder.Init(&jobs);
+
+	FailingRecordBackend backend(5);
+	CHECK(!recorder.Record(&backend, 1000, 16));
+	CHECK(CoversItemsOnce(backend.GetChunks(), 1000));
+	CHECK(SubmittedInOrder(backend.GetSubmitted(), 16));
+
+	// Recorder is not left in a failed state
+	NullRecordBackend good;
+	CHECK(recorder.Record(&good, 1000, 16));
+
+	recorder.Term();
+	jobs.Term();
+}
@@ -0,0 +1,63 @@
+#include <stdio.h>
+
+#include "Benchmark.h"
+#include "Profiler.h"
+
+#ifdef _MSC_VER
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE __attribute__((noinline))
+#endif
+
+static const unsigned int RunCount = 5;
+
+// Calls are out of line, so each one is a marked or unmarked scope around the same work
+static volatile unsigned int s_work = 0;
+
+static NOINLINE void UnmarkedCall()
+{
+	s_work = s_work + 1;
+}
+
+static NOINLINE void MarkedCall()
+{
+	PROFILE_SCOPE("Marker");
+
+	s_work = s_work + 1;
+}
+
+static void CallMany(void (*pCall)(), unsigned int callCount)
+{
+	for (unsigned int i = 0; i < callCount; i++)
+	{
+		pCall();
+	}
+}
+
+// Cost of a marker while the profiler is stopped and while it records, over the same call without one
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	unsigned int callCount = BenchmarkSize(20000000, 100000);
+	double unmarked = MeasureBest(RunCount, [&]() { CallMany(UnmarkedCall, callCount); });
+	ReportBenchmark("Unmarked call", unmarked, callCount, "call");
+
+	double stopped = MeasureBest(RunCount, [&]() { CallMany(MarkedCall, callCount); });
+	ReportBenchmark("Marker, profiler stopped", stopped, callCount, "call");
+
+	// Capture is restarted before the buffer is full, so every marker is stored
+	const unsigned int captureCalls = Profiler::MaxEventsPerThread / 2;
+	double recording = MeasureBest(RunCount, [&]()
+	{
+		Profiler::Start();
+		CallMany(MarkedCall, captureCalls);
+		Profiler::Stop();
+	});
+	ReportBenchmark("Marker, profiler recording", recording, captureCalls, "call");
+
+	unsigned int dropped = Profiler::GetDroppedCount();
+	printf("Marker cost over the unmarked call: %.2f ns stopped, %.2f ns recording, %u events dropped\n",
+		(stopped - unmarked) * 1e9 / callCount, recording * 1e9 / captureCalls - unmarked * 1e9 / callCount, dropped);
+	return dropped == 0 ? 0 : 1;
+}
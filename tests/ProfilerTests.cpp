@@ -0,0 +1,214 @@
+#include <stdlib.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Profiler.h"
+#include "Test.h"
+
+static const char* TraceName = "ProfilerTests.json";
+
+// Trace is written one object per line, lines are returned without the separating commas
+static std::vector<std::string> WriteTrace()
+{
+	std::vector<std::string> lines;
+	if (!Profiler::WriteChromeTrace(TraceName))
+	{
+		return lines;
+	}
+
+	std::ifstream file(TraceName);
+	std::string line;
+	while (std::getline(file, line))
+	{
+		lines.push_back(line.empty() || line.back() != ',' ? line : line.substr(0, line.size() - 1));
+	}
+	return lines;
+}
+
+static unsigned int CountLines(const std::vector<std::string>& lines, const std::string& text)
+{
+	unsigned int count = 0;
+	for (const std::string& line : lines)
+	{
+		count += line.find(text) != std::string::npos ? 1 : 0;
+	}
+	return count;
+}
+
+static const std::string* FindLine(const std::vector<std::string>& lines, const std::string& text)
+{
+	for (const std::string& line : lines)
+	{
+		if (line.find(text) != std::string::npos)
+		{
+			return &line;
+		}
+	}
+	return NULL;
+}
+
+// Value of a number field of the line, -1 when the line has no such field
+static double GetNumber(const std::string& line, const char* field)
+{
+	std::string key = std::string("\"") + field + "\": ";
+	size_t position = line.find(key);
+	return position == std::string::npos ? -1.0 : atof(line.c_str() + position + key.size());
+}
+
+// Scope is recorded when opened while recording, whenever it closes
+TEST(RecordsBetweenStartAndStop)
+{
+	{
+		PROFILE_SCOPE("BeforeStart");
+	}
+	{
+		PROFILE_SCOPE("OpenedBeforeStart");
+		Profiler::Start();
+	}
+	CHECK(Profiler::IsEnabled());
+	{
+		PROFILE_SCOPE("Recorded");
+	}
+	{
+		PROFILE_SCOPE("OpenedWhileRecording");
+		Profiler::Stop();
+	}
+	CHECK(!Profiler::IsEnabled());
+	{
+		PROFILE_SCOPE("AfterStop");
+	}
+
+	std::vector<std::string> lines = WriteTrace();
+	REQUIRE(!lines.empty());
+	CHECK(CountLines(lines, "\"name\": \"Recorded\"") == 1);
+	CHECK(CountLines(lines, "\"name\": \"OpenedWhileRecording\"") == 1);
+	CHECK(CountLines(lines, "BeforeStart") == 0);
+	CHECK(CountLines(lines, "AfterStop") == 0);
+	CHECK(CountLines(lines, "\"droppedEvents\": 0") == 1);
+}
+
+// Event of a scope opened during an earlier capture is left out of the next one
+TEST(StartForgetsEarlierCapture)
+{
+	Profiler::Start();
+	uint64_t earlierStart = Profiler::GetTimestamp();
+	Profiler::AddEvent("Earlier", earlierStart, Profiler::GetTimestamp());
+	Profiler::Stop();
+
+	Profiler::Start();
+	Profiler::AddEvent("OpenedInEarlier", earlierStart, Profiler::GetTimestamp());
+	uint64_t start = Profiler::GetTimestamp();
+	Profiler::AddEvent("Current", start, Profiler::GetTimestamp());
+	Profiler::Stop();
+
+	std::vector<std::string> lines = WriteTrace();
+	CHECK(CountLines(lines, "\"name\": \"Current\"") == 1);
+	CHECK(CountLines(lines, "Earlier") == 0);
+}
+
+TEST(CountsDroppedEvents)
+{
+	Profiler::Start();
+	for (unsigned int i = 0; i < Profiler::MaxEventsPerThread + 10; i++)
+	{
+		uint64_t start = Profiler::GetTimestamp();
+		Profiler::AddEvent("Full", start, Profiler::GetTimestamp());
+	}
+	Profiler::Stop();
+	CHECK(Profiler::GetDroppedCount() == 10);
+
+	std::vector<std::string> lines = WriteTrace();
+	CHECK(CountLines(lines, "\"name\": \"Full\"") == Profiler::MaxEventsPerThread);
+	CHECK(CountLines(lines, "\"droppedEvents\": 10") == 1);
+
+	// New capture starts from empty buffers
+	Profiler::Start();
+	CHECK(Profiler::GetDroppedCount() == 0);
+	Profiler::Stop();
+}
+
+TEST(EscapesNames)
+{
+	std::thread thread([]()
+	{
+		Profiler::SetThreadName("Thread \"quoted\"");
+		PROFILE_SCOPE("Back\\slash, new\nline, tab\t, return\r, bell\a");
+	});
+
+	Profiler::Start();
+	thread.join();
+	Profiler::Stop();
+
+	std::vector<std::string> lines = WriteTrace();
+	CHECK(CountLines(lines, "\"args\": {\"name\": \"Thread \\\"quoted\\\"\"}") == 1);
+	CHECK(CountLines(lines, "\"name\": \"Back\\\\slash, new\\nline, tab\\t, return\\r, bell\\u0007\"") == 1);
+
+	// Raw control characters would split or break the lines
+	std::ifstream file(TraceName, std::ios::binary);
+	std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	unsigned int controlCount = 0;
+	for (char c : text)
+	{
+		controlCount += (unsigned char)c < 0x20 && c != '\n' ? 1 : 0;
+	}
+	CHECK(controlCount == 0);
+}
+
+// Each thread has its own track, events are in the track of the thread which recorded them
+TEST(WritesTrackPerThread)
+{
+	static const unsigned int EventCount = 3;
+
+	Profiler::Start();
+	std::thread first([]()
+	{
+		Profiler::SetThreadName("First");
+		for (unsigned int i = 0; i < EventCount; i++)
+		{
+			PROFILE_SCOPE("FirstEvent");
+		}
+	});
+	std::thread second([]()
+	{
+		Profiler::SetThreadName("Second");
+		for (unsigned int i = 0; i < EventCount; i++)
+		{
+			PROFILE_SCOPE("SecondEvent");
+		}
+	});
+	first.join();
+	second.join();
+	Profiler::Stop();
+
+	std::vector<std::string> lines = WriteTrace();
+	CHECK(CountLines(lines, "\"name\": \"thread_name\"") == 2);
+	const std::string* pFirst = FindLine(lines, "{\"name\": \"First\"}");
+	const std::string* pSecond = FindLine(lines, "{\"name\": \"Second\"}");
+	REQUIRE(pFirst != NULL && pSecond != NULL);
+	double firstTid = GetNumber(*pFirst, "tid");
+	double secondTid = GetNumber(*pSecond, "tid");
+	CHECK(firstTid > 0.0);
+	CHECK(secondTid > 0.0);
+	CHECK(firstTid != secondTid);
+
+	CHECK(CountLines(lines, "\"name\": \"FirstEvent\"") == EventCount);
+	CHECK(CountLines(lines, "\"name\": \"SecondEvent\"") == EventCount);
+	unsigned int badEvents = 0;
+	for (const std::string& line : lines)
+	{
+		bool isFirst = line.find("\"name\": \"FirstEvent\"") != std::string::npos;
+		bool isSecond = line.find("\"name\": \"SecondEvent\"") != std::string::npos;
+		if (isFirst || isSecond)
+		{
+			bool isGood = line.find("\"ph\": \"X\"") != std::string::npos
+				&& GetNumber(line, "tid") == (isFirst ? firstTid : secondTid)
+				&& GetNumber(line, "ts") >= 0.0 && GetNumber(line, "dur") >= 0.0;
+			badEvents += isGood ? 0 : 1;
+		}
+	}
+	CHECK(badEvents == 0);
+}
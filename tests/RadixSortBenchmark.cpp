@@ -0,0 +1,62 @@
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Platform.h"
+#include "RadixSort.h"
+#include "Test.h"
+
+static const unsigned int RunCount = 5;
+
+static void Benchmark(const char* keyName, const std::vector<unsigned int>& keys)
+{
+	unsigned int count = (unsigned int)keys.size();
+	char name[64];
+
+	RadixSort sort;
+	double seconds = MeasureBest(RunCount, [&]()
+	{
+		sort.Sort(keys.data(), count);
+	});
+	sprintf_s(name, "RadixSort, %s", keyName);
+	ReportBenchmark(name, seconds, count, "key");
+
+	// What the radix sort replaces, a stable comparison sort of the indices
+	std::vector<unsigned int> indices(count);
+	seconds = MeasureBest(RunCount, [&]()
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			indices[i] = i;
+		}
+		std::stable_sort(indices.begin(), indices.end(), [&keys](unsigned int a, unsigned int b) { return keys[a] < keys[b]; });
+	});
+	sprintf_s(name, "std::stable_sort, %s", keyName);
+	ReportBenchmark(name, seconds, count, "key");
+}
+
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	unsigned int count = BenchmarkSize(1000000, 10000);
+	TestRandom random(7);
+	std::vector<unsigned int> keys(count);
+
+	for (unsigned int& key : keys)
+	{
+		key = random.Next();
+	}
+	Benchmark("32-bit keys", keys);
+
+	// Depth keys of BackToFrontKey, two passes
+	for (unsigned int& key : keys)
+	{
+		key = BackToFrontKey(random.NextFloat(0.001f, 100.0f), 0.001f, 100.0f);
+	}
+	Benchmark("16-bit depth keys", keys);
+
+	return 0;
+}
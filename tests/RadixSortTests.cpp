@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <vector>
+
+#include "RadixSort.h"
+#include "Test.h"
+
+// Indices of a stable sort, what the radix sort has to give
+static std::vector<unsigned int> ReferenceSort(const std::vector<unsigned int>& keys)
+{
+	std::vector<unsigned int> indices(keys.size());
+	for (unsigned int i = 0; i < indices.size(); i++)
+	{
+		indices[i] = i;
+	}
+	std::stable_sort(indices.begin(), indices.end(), [&keys](unsigned int a, unsigned int b) { return keys[a] < keys[b]; });
+	return indices;
+}
+
+static void CheckSort(const std::vector<unsigned int>& keys)
+{
+	RadixSort sort;
+	sort.Sort(keys.data(), (unsigned int)keys.size());
+	CHECK(sort.GetIndices() == ReferenceSort(keys));
+}
+
+TEST(SortsFullKeys)
+{
+	TestRandom random(1);
+	for (unsigned int i = 0; i < 10; i++)
+	{
+		std::vector<unsigned int> keys(random.Next(5000));
+		for (unsigned int& key : keys)
+		{
+			key = random.Next();
+		}
+		CheckSort(keys);
+	}
+}
+
+// Passes of the upper bytes are skipped
+TEST(SortsShortKeys)
+{
+	TestRandom random(2);
+	for (unsigned int i = 0; i < 10; i++)
+	{
+		std::vector<unsigned int> keys(random.Next(5000));
+		for (unsigned int& key : keys)
+		{
+			key = random.Next() & 0xFFFF;
+		}
+		CheckSort(keys);
+	}
+}
+
+// Many equal keys, their indices stay in input order
+TEST(KeepsOrderOfEqualKeys)
+{
+	TestRandom random(3);
+	std::vector<unsigned int> keys(10000);
+	for (unsigned int& key : keys)
+	{
+		key = random.Next(7) << 24;
+	}
+	CheckSort(keys);
+
+	std::vector<unsigned int> same(100, 42);
+	CheckSort(same);
+}
+
+TEST(SortsMillionKeys)
+{
+	TestRandom random(4);
+	std::vector<unsigned int> keys(1000000);
+	for (unsigned int& key : keys)
+	{
+		key = random.Next();
+	}
+	CheckSort(keys);
+}
+
+TEST(SortsEmptyAndSingleKey)
+{
+	RadixSort sort;
+	sort.Sort(NULL, 0);
+	CHECK(sort.GetIndices().empty());
+
+	unsigned int key = 7;
+	sort.Sort(&key, 1);
+	REQUIRE(sort.GetIndices().size() == 1);
+	CHECK(sort.GetIndices()[0] == 0);
+}
+
+TEST(BackToFrontKeyOrdersFarFirst)
+{
+	CHECK(BackToFrontKey(100.0f, 0.001f, 100.0f) < BackToFrontKey(50.0f, 0.001f, 100.0f));
+	CHECK(BackToFrontKey(50.0f, 0.001f, 100.0f) < BackToFrontKey(0.001f, 0.001f, 100.0f));
+	CHECK(BackToFrontKey(0.001f, 0.001f, 100.0f) <= 0xFFFF);
+
+	// Out of the range clamps to its ends
+	CHECK(BackToFrontKey(1000.0f, 0.001f, 100.0f) == BackToFrontKey(100.0f, 0.001f, 100.0f));
+	CHECK(BackToFrontKey(-1.0f, 0.001f, 100.0f) == BackToFrontKey(0.001f, 0.001f, 100.0f));
+}
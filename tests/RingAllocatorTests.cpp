@@ -0,0 +1,350 @@
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#include "ConstantBufferRing.h"
+#include "FakeRenderContext.h"
+#include "NullRenderDevice.h"
+#include "RingAllocator.h"
+#include "Test.h"
+
+static bool Overlap(size_t offsetA, size_t sizeA, size_t offsetB, size_t sizeB)
+{
+	return offsetA < offsetB + sizeB && offsetB < offsetA + sizeA;
+}
+
+TEST(AllocationsAreAligned)
+{
+	RingAllocator ring;
+	ring.Init(4096, 256);
+
+	CHECK(ring.Allocate(1) == 0);
+	CHECK(ring.Allocate(256) == 256);
+	CHECK(ring.Allocate(257) == 512);
+	CHECK(ring.Allocate(100) == 1024);
+	CHECK(ring.GetUsedSize() == 1280);
+}
+
+TEST(InvalidSizesFail)
+{
+	RingAllocator ring;
+	ring.Init(1024, 256);
+
+	CHECK(ring.Allocate(0) == RingAllocator::InvalidOffset);
+	CHECK(ring.Allocate(1025) == RingAllocator::InvalidOffset);
+	CHECK(ring.Allocate(1024) == 0);
+	CHECK(ring.Allocate(1) == RingAllocator::InvalidOffset);
+}
+
+TEST(MemoryIsReusedAfterItsFrameIsReleased)
+{
+	RingAllocator ring;
+	ring.Init(1024, 256);
+
+	CHECK(ring.Allocate(512) == 0);
+	ring.FinishFrame(0);
+	CHECK(ring.Allocate(512) == 512);
+	ring.FinishFrame(1);
+
+	// Full until frame 0 is done
+	CHECK(ring.Allocate(256) == RingAllocator::InvalidOffset);
+	ring.ReleaseFrames(0);
+	CHECK(ring.GetUsedSize() == 512);
+	CHECK(ring.Allocate(256) == 0);
+	CHECK(ring.Allocate(256) == 256);
+	CHECK(ring.Allocate(256) == RingAllocator::InvalidOffset);
+	ring.FinishFrame(2);
+
+	CHECK(ring.HasPendingFrames());
+	CHECK(ring.GetOldestPendingFrame() == 1);
+	ring.ReleaseFrames(2);
+	CHECK(!ring.HasPendingFrames());
+	CHECK(ring.GetUsedSize() == 0);
+}
+
+TEST(WraparoundSkipsTheEndOfTheRing)
+{
+	RingAllocator ring;
+	ring.Init(1024, 256);
+
+	CHECK(ring.Allocate(512) == 0);
+	ring.FinishFrame(0);
+	CHECK(ring.Allocate(256) == 512);
+	ring.FinishFrame(1);
+	ring.ReleaseFrames(0);
+
+	// [768, 1024) is too small, so the block goes to the start and the end is used until frame 2 is done
+	CHECK(ring.Allocate(512) == 0);
+	CHECK(ring.GetUsedSize() == 256 + 256 + 512);
+	ring.FinishFrame(2);
+
+	ring.ReleaseFrames(1);
+	CHECK(ring.GetUsedSize() == 256 + 512);
+	CHECK(ring.Allocate(512) == RingAllocator::InvalidOffset);
+	CHECK(ring.Allocate(256) == 512);
+	ring.FinishFrame(3);
+
+	ring.ReleaseFrames(3);
+	CHECK(ring.GetUsedSize() == 0);
+}
+
+TEST(EmptyRingStartsFromTheBeginning)
+{
+	RingAllocator ring;
+	ring.Init(1024, 256);
+
+	CHECK(ring.Allocate(768) == 0);
+	ring.FinishFrame(0);
+	ring.ReleaseFrames(0);
+
+	// Nothing in flight, so a block which would not fit after the head does not wait
+	CHECK(ring.Allocate(1024) == 0);
+	ring.FinishFrame(1);
+	ring.ReleaseFrames(1);
+	CHECK(ring.GetUsedSize() == 0);
+}
+
+TEST(FrameWithoutAllocationsIsReleased)
+{
+	RingAllocator ring;
+	ring.Init(1024, 256);
+
+	CHECK(ring.Allocate(256) == 0);
+	ring.FinishFrame(0);
+	ring.FinishFrame(1);
+	ring.ReleaseFrames(1);
+	CHECK(ring.GetUsedSize() == 0);
+	CHECK(!ring.HasPendingFrames());
+}
+
+// Live blocks never overlap, stay in the ring and used size is the aligned sizes plus the skipped ends
+TEST(RandomFramesKeepLiveBlocksApart)
+{
+	struct Block
+	{
+		size_t offset;
+		size_t size;
+		uint64_t frame;
+	};
+
+	const size_t Size = 64 * 256;
+	RingAllocator ring;
+	ring.Init(Size, 256);
+
+	TestRandom random(1);
+	std::deque<Block> live;
+	unsigned int failedCount = 0;
+	unsigned int allocationCount = 0;
+	for (uint64_t frame = 0; frame < 20000; frame++)
+	{
+		unsigned int count = random.Next(6);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			size_t size = 1 + random.Next(2000);
+			size_t offset = ring.Allocate(size);
+			if (offset == RingAllocator::InvalidOffset)
+			{
+				failedCount++;
+				continue;
+			}
+			allocationCount++;
+
+			size_t alignedSize = (size + 255) & ~(size_t)255;
+			REQUIRE(offset % 256 == 0);
+			REQUIRE(offset + alignedSize <= Size);
+			for (const Block& block : live)
+			{
+				REQUIRE(!Overlap(offset, alignedSize, block.offset, block.size));
+			}
+			live.push_back(Block{ offset, alignedSize, frame });
+		}
+		ring.FinishFrame(frame);
+
+		// GPU is 0 to 3 frames behind
+		uint64_t behind = random.Next(4);
+		if (frame >= behind)
+		{
+			uint64_t completed = frame - behind;
+			ring.ReleaseFrames(completed);
+			while (!live.empty() && live.front().frame <= completed)
+			{
+				live.pop_front();
+			}
+		}
+
+		size_t liveSize = 0;
+		for (const Block& block : live)
+		{
+			liveSize += block.size;
+		}
+		REQUIRE(ring.GetUsedSize() >= liveSize);
+		REQUIRE(ring.GetUsedSize() <= Size);
+		if (live.empty())
+		{
+			REQUIRE(ring.GetUsedSize() == 0);
+		}
+	}
+
+	CHECK(allocationCount > 10 * failedCount);
+	CHECK(failedCount != 0);
+}
+
+// Null device for the buffer and the queries, fake GPU for the frame fences
+struct RingFixture
+{
+	NullRenderDevice device;
+	FakeRenderContext* pContext;
+	ConstantBufferRing ring;
+
+	RingFixture(UINT size, uint64_t latency)
+		: pContext(NULL)
+	{
+		device.Init(64, 64);
+		pContext = new FakeRenderContext(device.GetImmediateContext());
+		pContext->SetLatency(latency);
+		ring.Init(&device, size);
+	}
+
+	~RingFixture()
+	{
+		ring.Term();
+		delete pContext;
+		device.Term();
+	}
+};
+
+TEST(ConstantBufferRangesAreInConstants)
+{
+	RingFixture fixture(4096, 2);
+
+	uint8_t data[300];
+	for (unsigned int i = 0; i < sizeof(data); i++)
+	{
+		data[i] = (uint8_t)i;
+	}
+
+	ConstantBufferRange first = {};
+	ConstantBufferRange second = {};
+	REQUIRE(SUCCEEDED(fixture.ring.Map(fixture.pContext)));
+	CHECK(fixture.ring.Upload(fixture.pContext, data, 64, &first));
+	CHECK(fixture.ring.Upload(fixture.pContext, data, sizeof(data), &second));
+	fixture.ring.Unmap(fixture.pContext);
+	fixture.ring.EndFrame(fixture.pContext);
+
+	// 256 byte offsets are 16 constants
+	CHECK(first.firstConstant == 0);
+	CHECK(first.numConstants == 16);
+	CHECK(second.firstConstant == 16);
+	CHECK(second.numConstants == 32);
+
+	void* pMemory = NULL;
+	REQUIRE(SUCCEEDED(fixture.pContext->Map(fixture.ring.GetBuffer(), MAP_WRITE_NO_OVERWRITE, &pMemory)));
+	CHECK(memcmp((uint8_t*)pMemory + second.firstConstant * 16, data, sizeof(data)) == 0);
+	fixture.pContext->Unmap(fixture.ring.GetBuffer());
+}
+
+// Uploads of frames the GPU has not completed are never overwritten
+// Ring fits two frames of uploads, so with two frames in flight the CPU waits for the GPU
+static void RunFencedFrames(UINT ringSize, uint64_t latency, unsigned int* pWaitCount, bool* pOverwritten)
+{
+	struct Range
+	{
+		uint64_t frame;
+		UINT first;
+		UINT count;
+	};
+
+	const unsigned int UploadsPerFrame = 8;
+	const unsigned int FrameCount = 100;
+
+	RingFixture fixture(ringSize, latency);
+	FakeRenderContext* pContext = fixture.pContext;
+
+	std::vector<Range> ranges;
+	uint8_t data[256] = {};
+	*pOverwritten = false;
+	for (uint64_t frame = 0; frame < FrameCount; frame++)
+	{
+		fixture.ring.Map(pContext);
+		for (unsigned int i = 0; i < UploadsPerFrame; i++)
+		{
+			ConstantBufferRange range = {};
+			if (!fixture.ring.Upload(pContext, data, sizeof(data), &range))
+			{
+				*pOverwritten = true;
+				continue;
+			}
+
+			for (const Range& other : ranges)
+			{
+				bool inFlight = other.frame >= pContext->GetCompletedFrames();
+				if (inFlight && Overlap(range.firstConstant, range.numConstants, other.first, other.count))
+				{
+					*pOverwritten = true;
+				}
+			}
+			ranges.push_back(Range{ frame, range.firstConstant, range.numConstants });
+		}
+		fixture.ring.Unmap(pContext);
+		fixture.ring.EndFrame(pContext);
+		pContext->EndFrame();
+	}
+
+	*pWaitCount = pContext->GetWaitCount();
+}
+
+TEST(ConstantBufferRingWaitsForTheGpuWhenFull)
+{
+	unsigned int waitCount = 0;
+	bool overwritten = false;
+
+	RunFencedFrames(2 * 8 * 256, 2, &waitCount, &overwritten);
+	CHECK(!overwritten);
+	CHECK(waitCount != 0);
+
+	RunFencedFrames(3 * 8 * 256, 2, &waitCount, &overwritten);
+	CHECK(!overwritten);
+	CHECK(waitCount == 0);
+}
+
+// Queries are reused, so no more frames than there are queries are in flight even when there is room
+TEST(ConstantBufferRingLimitsFramesInFlight)
+{
+	RingFixture fixture(64 * 1024, UINT64_MAX);
+	FakeRenderContext* pContext = fixture.pContext;
+
+	uint8_t data[16] = {};
+	uint64_t maxInFlight = 0;
+	for (uint64_t frame = 0; frame < 40; frame++)
+	{
+		fixture.ring.Map(pContext);
+		// Current frame included
+		uint64_t inFlight = pContext->GetFrame() + 1 - pContext->GetCompletedFrames();
+		maxInFlight = inFlight > maxInFlight ? inFlight : maxInFlight;
+
+		ConstantBufferRange range = {};
+		CHECK(fixture.ring.Upload(pContext, data, sizeof(data), &range));
+		fixture.ring.Unmap(pContext);
+		fixture.ring.EndFrame(pContext);
+		pContext->EndFrame();
+	}
+
+	CHECK(maxInFlight == 8);
+	CHECK(pContext->GetWaitCount() == 40 - 8);
+}
+
+TEST(ConstantBufferRingReleasesItsObjects)
+{
+	NullRenderDevice device;
+	REQUIRE(device.Init(64, 64));
+	int liveObjects = device.GetLiveObjectCount();
+
+	ConstantBufferRing ring;
+	REQUIRE(SUCCEEDED(ring.Init(&device, 1000)));
+	CHECK(device.GetLiveObjectCount() > liveObjects);
+	ring.Term();
+	CHECK(device.GetLiveObjectCount() == liveObjects);
+
+	device.Term();
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+
+#include <vector>
+
+#include "Benchmark.h"
+#include "ConstantBufferRing.h"
+#include "FakeRenderContext.h"
+#include "NullRenderDevice.h"
+#include "RingAllocator.h"
+#include "Test.h"
+
+static const unsigned int FramesInFlight = 3;
+static const unsigned int RunCount = 5;
+
+// Bookkeeping only: allocations of 64 to 1024 bytes, the GPU FramesInFlight frames behind
+static void BenchmarkAllocator(unsigned int allocationsPerFrame, unsigned int frameCount)
+{
+	std::vector<size_t> sizes(allocationsPerFrame * frameCount);
+	TestRandom random(7);
+	for (size_t& size : sizes)
+	{
+		size = 64 + random.Next(961);
+	}
+
+	size_t failed = 0;
+	double seconds = MeasureBest(RunCount, [&]()
+	{
+		RingAllocator ring;
+		ring.Init(allocationsPerFrame * 1024 * (FramesInFlight + 1), 256);
+
+		const size_t* pSize = sizes.data();
+		for (uint64_t frame = 0; frame < frameCount; frame++)
+		{
+			for (unsigned int i = 0; i < allocationsPerFrame; i++)
+			{
+				failed += ring.Allocate(*pSize++) == RingAllocator::InvalidOffset ? 1 : 0;
+			}
+			ring.FinishFrame(frame);
+			if (frame >= FramesInFlight)
+			{
+				ring.ReleaseFrames(frame - FramesInFlight);
+			}
+		}
+	});
+
+	char name[64];
+	sprintf_s(name, "RingAllocator, %u per frame", allocationsPerFrame);
+	ReportBenchmark(name, seconds, (double)sizes.size(), "alloc");
+	if (failed != 0)
+	{
+		printf("%zu allocations failed\n", failed);
+	}
+}
+
+// Map, 256 byte uploads of object constants and the frame fence, as Renderer does
+static void BenchmarkConstantBufferRing(unsigned int uploadsPerFrame, unsigned int frameCount)
+{
+	NullRenderDevice device;
+	device.Init(64, 64);
+	FakeRenderContext context(device.GetImmediateContext());
+	context.SetLatency(FramesInFlight - 1);
+
+	ConstantBufferRing ring;
+	ring.Init(&device, uploadsPerFrame * 256 * (FramesInFlight + 1));
+
+	uint8_t constants[256] = {};
+	double seconds = MeasureBest(RunCount, [&]()
+	{
+		for (unsigned int frame = 0; frame < frameCount; frame++)
+		{
+			ring.Map(&context);
+			for (unsigned int i = 0; i < uploadsPerFrame; i++)
+			{
+				ConstantBufferRange range;
+				ring.Upload(&context, constants, sizeof(constants), &range);
+			}
+			ring.Unmap(&context);
+			ring.EndFrame(&context);
+			context.EndFrame();
+		}
+	});
+
+	char name[64];
+	sprintf_s(name, "ConstantBufferRing, %u uploads per frame", uploadsPerFrame);
+	ReportBenchmark(name, seconds, (double)uploadsPerFrame * frameCount, "upload");
+	printf("%u waits for the GPU\n", context.GetWaitCount());
+
+	ring.Term();
+	device.Term();
+}
+
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	BenchmarkAllocator(16, BenchmarkSize(100000, 1000));
+	BenchmarkAllocator(4096, BenchmarkSize(1000, 10));
+	BenchmarkConstantBufferRing(4096, BenchmarkSize(1000, 10));
+
+	return 0;
+}
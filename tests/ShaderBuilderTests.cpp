@@ -0,0 +1,220 @@
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ShaderBuilder.h"
+#include "ShaderCache.h"
+#include "Test.h"
+
+// Compiler told by the request what to do: entry point is the name, defines give the delay,
+// make it fail or hold it until released. Remembers the order builds reached it
+class ScriptedCompiler : public IShaderCompiler
+{
+public:
+	ScriptedCompiler()
+		: m_isReleased(false)
+	{
+	}
+
+	virtual bool Compile(const ShaderRequest& request, std::vector<uint8_t>& bytecode, std::string& errors)
+	{
+		bool fail = false;
+		bool hold = false;
+		unsigned int delayMs = 0;
+		for (const ShaderDefine& define : request.defines)
+		{
+			fail = fail || define.name == "FAIL";
+			hold = hold || define.name == "HOLD";
+			delayMs = define.name == "DELAY_MS" ? (unsigned int)std::stoul(define.value) : delayMs;
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_compiled.push_back(request.entryPoint);
+			m_released.wait(lock, [this, hold] { return !hold || m_isReleased; });
+		}
+		if (delayMs != 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+		}
+
+		if (fail)
+		{
+			errors = "error: " + request.entryPoint + " does not compile\n";
+			return false;
+		}
+		bytecode.assign(request.entryPoint.begin(), request.entryPoint.end());
+		return true;
+	}
+
+	void Release()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_isReleased = true;
+		}
+		m_released.notify_all();
+	}
+
+	std::vector<std::string> GetCompiled() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_compiled;
+	}
+
+private:
+	mutable std::mutex m_mutex;
+	std::condition_variable m_released;
+	bool m_isReleased;
+	std::vector<std::string> m_compiled;
+};
+
+static ShaderRequest MakeRequest(const char* name, const char* define = NULL, const char* value = "1")
+{
+	ShaderRequest request = { std::string("float4 ") + name + "() : SV_Target { return 1; }", name, "ps_5_0", {}, 0 };
+	if (define != NULL)
+	{
+		request.defines.push_back(ShaderDefine{ define, value });
+	}
+	return request;
+}
+
+// Cache without a directory passes every request to the compiler
+TEST(CriticalBuildsAreStartedFirst)
+{
+	ShaderCache cache;
+	ScriptedCompiler compiler;
+	ShaderBuilder builder;
+	ShaderBuilder::BuildId a = builder.Add(MakeRequest("A"), "A", false);
+	ShaderBuilder::BuildId b = builder.Add(MakeRequest("B"), "B", true);
+	ShaderBuilder::BuildId c = builder.Add(MakeRequest("C"), "C", false);
+	ShaderBuilder::BuildId d = builder.Add(MakeRequest("D"), "D", true);
+	ShaderBuilder::BuildId e = builder.Add(MakeRequest("E"), "E", false);
+
+	builder.Start(&cache, &compiler, 1);
+	CHECK(builder.WaitAll());
+
+	// Critical ones first, each group in the order of Add
+	std::vector<std::string> expected = { "B", "D", "A", "C", "E" };
+	CHECK(compiler.GetCompiled() == expected);
+	CHECK(builder.GetTiming(b).startMs <= builder.GetTiming(d).startMs);
+	CHECK(builder.GetTiming(d).endMs <= builder.GetTiming(a).startMs);
+	CHECK(builder.GetTiming(c).endMs <= builder.GetTiming(e).startMs);
+	CHECK(!builder.GetTiming(a).cached);
+
+	// Report lists builds in the same order
+	std::string report = builder.GetReport();
+	size_t positions[5];
+	const char* names[5] = { " B\n", " D\n", " A\n", " C\n", " E\n" };
+	for (unsigned int i = 0; i < 5; i++)
+	{
+		positions[i] = report.find(names[i]);
+		CHECK(positions[i] != std::string::npos);
+		CHECK(i == 0 || positions[i] > positions[i - 1]);
+	}
+	CHECK(report.find("5 compiled, 0 from cache") != std::string::npos);
+	builder.Term();
+}
+
+TEST(WaitTellsSuccessAndErrors)
+{
+	ShaderCache cache;
+	ScriptedCompiler compiler;
+	ShaderBuilder builder;
+	ShaderBuilder::BuildId held = builder.Add(MakeRequest("Held", "HOLD"), "Held", true);
+	ShaderBuilder::BuildId failed = builder.Add(MakeRequest("Failed", "FAIL"), "Failed", false);
+	ShaderBuilder::BuildId good = builder.Add(MakeRequest("Good"), "Good", false);
+
+	builder.Start(&cache, &compiler, 2);
+	CHECK(!builder.Wait(failed));
+	CHECK(builder.Wait(good));
+	CHECK(builder.IsDone(failed));
+	CHECK(builder.IsDone(good));
+	CHECK(!builder.IsDone(held));
+	CHECK(builder.GetCriticalPathMs() == 0.0);
+
+	CHECK(builder.GetErrors(failed) == "error: Failed does not compile\n");
+	CHECK(builder.GetBytecode(failed).empty());
+	CHECK(builder.GetErrors(good).empty());
+	CHECK(std::string(builder.GetBytecode(good).begin(), builder.GetBytecode(good).end()) == "Good");
+
+	compiler.Release();
+	CHECK(builder.Wait(held));
+	CHECK(!builder.WaitAll());
+	CHECK(builder.GetReport().find("Failed FAILED") != std::string::npos);
+	builder.Term();
+
+	// Builds are forgotten by Term, the builder is used again
+	ShaderBuilder::BuildId again = builder.Add(MakeRequest("Again"), "Again", false);
+	builder.Start(&cache, &compiler, 2);
+	CHECK(builder.WaitAll());
+	CHECK(builder.IsDone(again));
+	builder.Term();
+}
+
+// Non-critical builds take much longer and end after the critical path
+TEST(CriticalPathCountsCriticalBuildsOnly)
+{
+	ShaderCache cache;
+	ScriptedCompiler compiler;
+	ShaderBuilder builder;
+	std::vector<ShaderBuilder::BuildId> critical;
+	std::vector<ShaderBuilder::BuildId> other;
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		std::string name = "Build" + std::to_string(i);
+		bool isCritical = i % 2 == 1;
+		ShaderBuilder::BuildId id = builder.Add(MakeRequest(name.c_str(), "DELAY_MS", isCritical ? "1" : "40"), name, isCritical);
+		(isCritical ? critical : other).push_back(id);
+	}
+
+	builder.Start(&cache, &compiler, 2);
+	CHECK(builder.WaitAll());
+
+	double criticalEndMs = 0.0;
+	for (ShaderBuilder::BuildId id : critical)
+	{
+		criticalEndMs = builder.GetTiming(id).endMs > criticalEndMs ? builder.GetTiming(id).endMs : criticalEndMs;
+	}
+	double otherEndMs = 0.0;
+	unsigned int badThreads = 0;
+	for (ShaderBuilder::BuildId id : other)
+	{
+		otherEndMs = builder.GetTiming(id).endMs > otherEndMs ? builder.GetTiming(id).endMs : otherEndMs;
+		badThreads += builder.GetTiming(id).thread < 2 ? 0 : 1;
+	}
+	CHECK(builder.GetCriticalPathMs() == criticalEndMs);
+	CHECK(criticalEndMs < otherEndMs);
+	CHECK(otherEndMs >= 40.0);
+	CHECK(badThreads == 0);
+	builder.Term();
+}
+
+// Second build of the same requests comes from the cache and is reported so
+TEST(CachedBuildsAreReported)
+{
+	std::string directory = "ShaderBuilderTests";
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+
+	ShaderCache cache;
+	REQUIRE(cache.Init(directory, 1 << 20));
+	ScriptedCompiler compiler;
+	for (unsigned int run = 0; run < 2; run++)
+	{
+		ShaderBuilder builder;
+		ShaderBuilder::BuildId first = builder.Add(MakeRequest("First"), "First", true);
+		ShaderBuilder::BuildId second = builder.Add(MakeRequest("Second"), "Second", false);
+		builder.Start(&cache, &compiler, 2);
+		CHECK(builder.WaitAll());
+		CHECK(builder.GetTiming(first).cached == (run == 1));
+		CHECK(builder.GetTiming(second).cached == (run == 1));
+		CHECK(std::string(builder.GetBytecode(second).begin(), builder.GetBytecode(second).end()) == "Second");
+		builder.Term();
+	}
+	CHECK(compiler.GetCompiled().size() == 2);
+}
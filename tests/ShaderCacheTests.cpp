@@ -0,0 +1,379 @@
+#include <stdio.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ShaderCache.h"
+#include "Test.h"
+
+namespace fs = std::filesystem;
+
+static const uint64_t LargeBudget = 1 << 20;
+
+// Empty cache directory of a test, under the working directory
+static std::string MakeCacheDirectory(const char* name)
+{
+	std::string directory = (fs::path("ShaderCacheTests") / name).string();
+	std::error_code error;
+	fs::remove_all(directory, error);
+	return directory;
+}
+
+static std::string GetEntryPath(const std::string& directory, const ShaderRequest& request)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.cso", (unsigned long long)HashShaderRequest(request));
+	return (fs::path(directory) / name).string();
+}
+
+static ShaderRequest MakeRequest(unsigned int variant)
+{
+	ShaderRequest request = { "float4 PS() : SV_Target { return 1; }", "PS", "ps_5_0", {}, 0 };
+	request.defines.push_back(ShaderDefine{ "VARIANT", std::to_string(variant) });
+	return request;
+}
+
+static unsigned int CountFiles(const std::string& directory, const char* extension)
+{
+	unsigned int count = 0;
+	for (const fs::directory_entry& file : fs::directory_iterator(directory))
+	{
+		count += file.path().extension() == extension ? 1 : 0;
+	}
+	return count;
+}
+
+TEST(MissThenHit)
+{
+	std::string directory = MakeCacheDirectory("MissThenHit");
+	StubShaderCompiler compiler;
+	ShaderCache cache;
+	REQUIRE(cache.Init(directory, LargeBudget));
+
+	std::vector<uint8_t> compiled;
+	std::vector<uint8_t> cached;
+	bool fromCache = true;
+	CHECK(cache.GetBytecode(MakeRequest(0), &compiler, compiled, NULL, &fromCache));
+	CHECK(!fromCache);
+	CHECK(cache.GetBytecode(MakeRequest(0), &compiler, cached, NULL, &fromCache));
+	CHECK(fromCache);
+	CHECK(cached == compiled);
+	CHECK(compiler.GetCompileCount() == 1);
+	CHECK(cache.GetHitCount() == 1);
+	CHECK(cache.GetMissCount() == 1);
+	CHECK(cache.GetTotalSize() == compiled.size());
+
+	// Any field of the request makes another entry
+	ShaderRequest request = MakeRequest(0);
+	request.flags = 1;
+	CHECK(HashShaderRequest(request) != HashShaderRequest(MakeRequest(0)));
+	CHECK(cache.GetBytecode(request, &compiler, cached));
+	CHECK(compiler.GetCompileCount() == 2);
+}
+
+TEST(FailedCompileIsNotCached)
+{
+	std::string directory = MakeCacheDirectory("FailedCompileIsNotCached");
+	StubShaderCompiler compiler;
+	ShaderCache cache;
+	REQUIRE(cache.Init(directory, LargeBudget));
+
+	ShaderRequest request = MakeRequest(0);
+	request.entryPoint = "Missing";
+	std::vector<uint8_t> bytecode;
+	std::string errors;
+	CHECK(!cache.GetBytecode(request, &compiler, bytecode, &errors));
+	CHECK(!errors.empty());
+	CHECK(!cache.GetBytecode(request, &compiler, bytecode));
+	CHECK(compiler.GetCompileCount() == 2);
+	CHECK(cache.GetTotalSize() == 0);
+}
+
+TEST(ReloadsIndex)
+{
+	std::string directory = MakeCacheDirectory("ReloadsIndex");
+	StubShaderCompiler compiler;
+	std::vector<uint8_t> compiled[4];
+	{
+		ShaderCache cache;
+		REQUIRE(cache.Init(directory, LargeBudget));
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			CHECK(cache.GetBytecode(MakeRequest(i), &compiler, compiled[i]));
+		}
+	}
+
+	ShaderCache cache;
+	REQUIRE(cache.Init(directory, LargeBudget));
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		std::vector<uint8_t> bytecode;
+		CHECK(cache.GetBytecode(MakeRequest(i), &compiler, bytecode));
+		CHECK(bytecode == compiled[i]);
+	}
+	CHECK(compiler.GetCompileCount() == 4);
+	CHECK(cache.GetHitCount() == 4);
+}
+
+TEST(DamagedEntryIsCompiledAgain)
+{
+	std::string directory = MakeCacheDirectory("DamagedEntryIsCompiledAgain");
+	StubShaderCompiler compiler;
+	ShaderCache cache;
+	REQUIRE(cache.Init(directory, LargeBudget));
+
+	std::vector<uint8_t> compiled;
+	CHECK(cache.GetBytecode(MakeRequest(0), &compiler, compiled));
+
+	// Last byte of the bytecode, the size is right but the checksum is not
+	{
+		std::fstream file(GetEntryPath(directory, MakeRequest(0)), std::ios::in | std::ios::out | std::ios::binary);
+		file.seekp(-1, std::ios::end);
+		file.put('#');
+	}
+
+	std::vector<uint8_t> bytecode;
+	bool fromCache = true;
+	CHECK(cache.GetBytecode(MakeRequest(0), &compiler, bytecode, NULL, &fromCache));
+	CHECK(!fromCache);
+	CHECK(bytecode == compiled);
+	CHECK(compiler.GetCompileCount() == 2);
+
+	// Written again
+	CHECK(cache.GetBytecode(MakeRequest(0), &compiler, bytecode, NULL, &fromCache));
+	CHECK(fromCache);
+	CHECK(compiler.GetCompileCount() == 2);
+}
+
+TEST(TruncatedEntryIsCompiledAgain)
+{
+	std::string directory = MakeCacheDirectory("TruncatedEntryIsCompiledAgain");
+	StubShaderCompiler compiler;
+	std::vector<uint8_t> compiled;
+	{
+		ShaderCache cache;
+		REQUIRE(cache.Init(directory, LargeBudget));
+		CHECK(cache.GetBytecode(MakeRequest(0), &compiler, compiled));
+		CHECK(cache.GetBytecode(MakeRequest(1), &compiler, compiled));
+
+		// While the cache runs
+		fs::resize_file(GetEntryPath(directory, MakeRequest(1)), 10);
+		std::vector<uint8_t> bytecode;
+		bool fromCache = true;
+		CHECK(cache.GetBytecode(MakeRequest(1), &compiler, bytecode, NULL, &fromCache));
+		CHECK(!fromCache);
+		CHECK(bytecode == compiled);
+	}
+
+	// Between runs, the index drops it
+	fs::resize_file(GetEntryPath(directory, MakeRequest(0)), 20);
+	ShaderCache cache;
+	REQUIRE(cache.Init(directory, LargeBudget));
+	CHECK(!fs::exists(GetEntryPath(directory, MakeRequest(0))));
+	CHECK(cache.GetTotalSize() == compiled.size());
+
+	std::vector<uint8_t> bytecode;
+	bool fromCache = true;
+	CHECK(cache.GetBytecode(MakeRequest(0), &compiler, bytecode, NULL, &fromCache));
+	CHECK(!fromCache);
+	CHECK(cache.GetBytecode(MakeRequest(1), &compiler, bytecode, NULL, &fromCache));
+	CHECK(fromCache);
+}
+
+// Files of a run which crashed during a write, or before it saved the index
+TEST(RemovesLeftoversOfCrash)
+{
+	std::string directory = MakeCacheDirectory("RemovesLeftoversOfCrash");
+	StubShaderCompiler compiler;
+	std::vector<uint8_t> compiled;
+	{
+		ShaderCache cache;
+		REQUIRE(cache.Init(directory, LargeBudget));
+		CHECK(cache.GetBytecode(MakeRequest(0), &compiler, compiled));
+	}
+
+	// Old temporary files are left by crashed writers, a fresh one may belong to another process still writing it
+	std::string tempPath = GetEntryPath(directory, MakeRequest(1)) + ".1234.1.0.tmp";
+	std::string indexTempPath = (fs::path(directory) / "index.txt.5678.1.1.tmp").string();
+	std::string freshTempPath = GetEntryPath(directory, MakeRequest(3)) + ".4321.1.0.tmp";
+	std::string damagedPath = GetEntryPath(directory, MakeRequest(2));
+	std::ofstream(tempPath) << "partial";
+	std::ofstream(indexTempPath) << "ShaderCache";
+	std::ofstream(freshTempPath) << "partial";
+	std::ofstream(damagedPath) << "not an entry";
+	fs::file_time_type oldTime = fs::file_time_type::clock::now() - std::chrono::hours(1);
+	fs::last_write_time(tempPath, oldTime);
+	fs::last_write_time(indexTempPath, oldTime);
+
+	ShaderCache cache;
+	REQUIRE(cache.Init(directory, LargeBudget));
+	CHECK(!fs::exists(tempPath));
+	CHECK(!fs::exists(indexTempPath));
+	CHECK(fs::exists(freshTempPath));
+	CHECK(!fs::exists(damagedPath));
+	CHECK(CountFiles(directory, ".tmp") == 1);
+	CHECK(CountFiles(directory, ".cso") == 1);
+
+	std::vector<uint8_t> bytecode;
+	bool fromCache = false;
+	CHECK(cache.GetBytecode(MakeRequest(0), &compiler, bytecode, NULL, &fromCache));
+	CHECK(fromCache);
+}
+
+// Another process adds entries its index has, but the index of this one does not
+TEST(KeepsEntriesOfOtherProcesses)
+{
+	std::string directory = MakeCacheDirectory("KeepsEntriesOfOtherProcesses");
+	StubShaderCompiler compiler;
+	std::vector<uint8_t> bytecode;
+	{
+		ShaderCache first;
+		REQUIRE(first.Init(directory, LargeBudget));
+		ShaderCache second;
+		REQUIRE(second.Init(directory, LargeBudget));
+
+		CHECK(second.GetBytecode(MakeRequest(1), &compiler, bytecode));
+		// First saves its index last, without the entry of the second
+		CHECK(first.GetBytecode(MakeRequest(0), &compiler, bytecode));
+	}
+
+	ShaderCache cache;
+	REQUIRE(cache.Init(directory, LargeBudget));
+	CHECK(CountFiles(directory, ".cso") == 2);
+
+	unsigned int compileCount = compiler.GetCompileCount();
+	bool fromCache = false;
+	CHECK(cache.GetBytecode(MakeRequest(1), &compiler, bytecode, NULL, &fromCache));
+	CHECK(fromCache);
+	CHECK(cache.GetBytecode(MakeRequest(0), &compiler, bytecode, NULL, &fromCache));
+	CHECK(fromCache);
+	CHECK(compiler.GetCompileCount() == compileCount);
+	CHECK(cache.GetTotalSize() == 2 * bytecode.size());
+}
+
+// Entries are found again from their files
+TEST(DamagedIndexIsRebuilt)
+{
+	std::string directory = MakeCacheDirectory("DamagedIndexIsRebuilt");
+	StubShaderCompiler compiler;
+	std::vector<uint8_t> bytecode;
+	{
+		ShaderCache cache;
+		REQUIRE(cache.Init(directory, LargeBudget));
+		CHECK(cache.GetBytecode(MakeRequest(0), &compiler, bytecode));
+	}
+
+	std::ofstream((fs::path(directory) / "index.txt").string()) << "ShaderCache 999 1\n";
+
+	ShaderCache cache;
+	REQUIRE(cache.Init(directory, LargeBudget));
+	CHECK(cache.GetTotalSize() == bytecode.size());
+	CHECK(CountFiles(directory, ".cso") == 1);
+
+	bool fromCache = false;
+	CHECK(cache.GetBytecode(MakeRequest(0), &compiler, bytecode, NULL, &fromCache));
+	CHECK(fromCache);
+}
+
+TEST(EvictsLeastRecentlyUsed)
+{
+	std::string directory = MakeCacheDirectory("EvictsLeastRecentlyUsed");
+	StubShaderCompiler compiler;
+	std::vector<uint8_t> bytecode;
+	uint64_t entrySize = 0;
+	{
+		ShaderCache cache;
+		REQUIRE(cache.Init(directory, LargeBudget));
+		for (unsigned int i = 0; i < 10; i++)
+		{
+			CHECK(cache.GetBytecode(MakeRequest(i), &compiler, bytecode));
+		}
+		entrySize = bytecode.size();
+
+		// Hits make entries 2 and 5 the most recent ones, after 9
+		CHECK(cache.GetBytecode(MakeRequest(2), &compiler, bytecode));
+		CHECK(cache.GetBytecode(MakeRequest(5), &compiler, bytecode));
+	}
+
+	// Budget lowered to three entries between runs
+	ShaderCache cache;
+	REQUIRE(cache.Init(directory, 3 * entrySize));
+	CHECK(cache.GetTotalSize() == 3 * entrySize);
+	CHECK(CountFiles(directory, ".cso") == 3);
+
+	unsigned int compileCount = compiler.GetCompileCount();
+	unsigned int kept[] = { 9, 2, 5 };
+	for (unsigned int i : kept)
+	{
+		bool fromCache = false;
+		CHECK(cache.GetBytecode(MakeRequest(i), &compiler, bytecode, NULL, &fromCache));
+		CHECK(fromCache);
+	}
+	CHECK(compiler.GetCompileCount() == compileCount);
+
+	// New entry pushes out the oldest, 9
+	CHECK(cache.GetBytecode(MakeRequest(10), &compiler, bytecode));
+	CHECK(cache.GetTotalSize() == 3 * entrySize);
+	CHECK(!fs::exists(GetEntryPath(directory, MakeRequest(9))));
+	CHECK(fs::exists(GetEntryPath(directory, MakeRequest(10))));
+}
+
+// Misses of several threads write entries and the index at once
+TEST(ConcurrentMisses)
+{
+	static const unsigned int ThreadCount = 8;
+	static const unsigned int VariantCount = 37;
+
+	std::string directory = MakeCacheDirectory("ConcurrentMisses");
+	StubShaderCompiler compiler(1);
+	{
+		ShaderCache cache;
+		REQUIRE(cache.Init(directory, LargeBudget));
+
+		std::vector<std::thread> threads;
+		std::vector<unsigned int> wrong(ThreadCount, 0);
+		for (unsigned int t = 0; t < ThreadCount; t++)
+		{
+			threads.push_back(std::thread([&cache, &compiler, &wrong, t]
+			{
+				StubShaderCompiler reference;
+				for (unsigned int i = 0; i < 100; i++)
+				{
+					ShaderRequest request = MakeRequest((i + t * 5) % VariantCount);
+					std::vector<uint8_t> bytecode;
+					std::vector<uint8_t> expected;
+					std::string errors;
+					reference.Compile(request, expected, errors);
+					bool ok = cache.GetBytecode(request, &compiler, bytecode) && bytecode == expected;
+					wrong[t] += ok ? 0 : 1;
+				}
+			}));
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		for (unsigned int count : wrong)
+		{
+			CHECK(count == 0);
+		}
+		CHECK(cache.GetHitCount() + cache.GetMissCount() == ThreadCount * 100);
+	}
+
+	// Index saved by the last writer knows every entry
+	ShaderCache cache;
+	REQUIRE(cache.Init(directory, LargeBudget));
+	unsigned int compileCount = compiler.GetCompileCount();
+	for (unsigned int i = 0; i < VariantCount; i++)
+	{
+		std::vector<uint8_t> bytecode;
+		CHECK(cache.GetBytecode(MakeRequest(i), &compiler, bytecode));
+	}
+	CHECK(compiler.GetCompileCount() == compileCount);
+	CHECK(CountFiles(directory, ".cso") == VariantCount);
+}
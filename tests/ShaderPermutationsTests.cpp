@@ -0,0 +1,127 @@
+#include <string>
+#include <vector>
+
+#include "ShaderPermutations.h"
+#include "Test.h"
+
+static const ShaderKey AllFeatures = SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_OIT | SHADER_FEATURE_LIGHT_BUCKET;
+
+static bool HasKeys(const ShaderPermutations& permutations, const std::vector<ShaderKey>& keys)
+{
+	if (permutations.GetVariantCount() != keys.size())
+	{
+		return false;
+	}
+	for (unsigned int i = 0; i < keys.size(); i++)
+	{
+		if (permutations.GetVariantKey(i) != keys[i] || permutations.GetVariantIndex(keys[i]) != i)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+TEST(LightCountPicksBucket)
+{
+	CHECK(GetShaderLightBucket(0) == SHADER_LIGHTS_DIRECT);
+	CHECK(GetShaderLightBucket(MaxDirectLights) == SHADER_LIGHTS_DIRECT);
+	CHECK(GetShaderLightBucket(MaxDirectLights + 1) == SHADER_LIGHTS_CLUSTERED);
+	CHECK(GetShaderLightBucket(100000) == SHADER_LIGHTS_CLUSTERED);
+}
+
+TEST(KeyTakesBucketFromArgument)
+{
+	CHECK(MakeShaderKey(0, SHADER_LIGHTS_DIRECT) == 0);
+	CHECK(MakeShaderKey(SHADER_FEATURE_NORMAL_MAP, SHADER_LIGHTS_CLUSTERED) == (SHADER_FEATURE_NORMAL_MAP | (1 << ShaderLightBucketShift)));
+	// Bucket bits in features are replaced
+	CHECK(MakeShaderKey(AllFeatures, SHADER_LIGHTS_DIRECT) == (SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_OIT));
+}
+
+TEST(VariantsAreSubsetsOfSupportedFeatures)
+{
+	ShaderPermutations permutations;
+
+	permutations.Init(0);
+	CHECK(HasKeys(permutations, { 0 }));
+
+	permutations.Init(SHADER_FEATURE_NORMAL_MAP);
+	CHECK(HasKeys(permutations, { 0, SHADER_FEATURE_NORMAL_MAP }));
+
+	permutations.Init(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_OIT);
+	CHECK(HasKeys(permutations, { 0, SHADER_FEATURE_NORMAL_MAP, SHADER_FEATURE_OIT, SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_OIT }));
+
+	// Bucket values past the last bucket are not variants
+	const ShaderKey clustered = MakeShaderKey(0, SHADER_LIGHTS_CLUSTERED);
+	permutations.Init(SHADER_FEATURE_OIT | SHADER_FEATURE_LIGHT_BUCKET);
+	CHECK(permutations.GetSupportedFeatures() == (SHADER_FEATURE_OIT | SHADER_FEATURE_LIGHT_BUCKET));
+	CHECK(HasKeys(permutations, { 0, SHADER_FEATURE_OIT, clustered, clustered | SHADER_FEATURE_OIT }));
+}
+
+TEST(AllFeaturesGiveEveryValidKeyOnce)
+{
+	ShaderPermutations permutations;
+	permutations.Init(AllFeatures);
+	CHECK(permutations.GetVariantCount() == 4 * SHADER_LIGHT_BUCKET_COUNT);
+
+	// Increasing keys, so each appears once
+	unsigned int wrong = 0;
+	for (unsigned int i = 0; i < permutations.GetVariantCount(); i++)
+	{
+		ShaderKey key = permutations.GetVariantKey(i);
+		wrong += (key & ~AllFeatures) != 0 ? 1 : 0;
+		wrong += ((key & SHADER_FEATURE_LIGHT_BUCKET) >> ShaderLightBucketShift) >= SHADER_LIGHT_BUCKET_COUNT ? 1 : 0;
+		wrong += i > 0 && key <= permutations.GetVariantKey(i - 1) ? 1 : 0;
+		wrong += permutations.GetVariantIndex(key) != i ? 1 : 0;
+	}
+	CHECK(wrong == 0);
+
+	// Init again replaces the variants
+	permutations.Init(SHADER_FEATURE_NORMAL_MAP);
+	CHECK(permutations.GetVariantCount() == 2);
+}
+
+TEST(UnsupportedFeaturesAreIgnored)
+{
+	ShaderPermutations permutations;
+	permutations.Init(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_LIGHT_BUCKET);
+
+	const ShaderKey clustered = MakeShaderKey(0, SHADER_LIGHTS_CLUSTERED);
+	CHECK(permutations.GetVariantIndex(SHADER_FEATURE_OIT) == permutations.GetVariantIndex(0));
+	CHECK(permutations.GetVariantIndex(SHADER_FEATURE_OIT | SHADER_FEATURE_NORMAL_MAP) == permutations.GetVariantIndex(SHADER_FEATURE_NORMAL_MAP));
+	CHECK(permutations.GetVariantIndex(clustered | SHADER_FEATURE_OIT) == permutations.GetVariantIndex(clustered));
+	CHECK(permutations.GetVariantIndex(0) != permutations.GetVariantIndex(clustered));
+
+	// Without the bucket bits every light count uses the direct variant
+	permutations.Init(SHADER_FEATURE_NORMAL_MAP);
+	CHECK(permutations.GetVariantIndex(clustered | SHADER_FEATURE_NORMAL_MAP) == permutations.GetVariantIndex(SHADER_FEATURE_NORMAL_MAP));
+	CHECK(permutations.GetVariantIndex(clustered) == 0);
+}
+
+TEST(DefinesHaveFixedNamesAndOrder)
+{
+	static const char* Names[] = { "NORMAL_MAP", "OIT", "LIGHTS_CLUSTERED", "MAX_DIRECT_LIGHTS" };
+
+	std::vector<ShaderDefine> defines;
+	for (unsigned int bucket = 0; bucket < SHADER_LIGHT_BUCKET_COUNT; bucket++)
+	{
+		for (unsigned int features = 0; features <= (SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_OIT); features++)
+		{
+			// Stale defines are replaced
+			defines.push_back(ShaderDefine{ "STALE", "1" });
+			GetShaderDefines(MakeShaderKey(features, (ShaderLightBucket)bucket), defines);
+
+			REQUIRE(defines.size() == 4);
+			unsigned int wrongNames = 0;
+			for (unsigned int i = 0; i < 4; i++)
+			{
+				wrongNames += defines[i].name != Names[i] ? 1 : 0;
+			}
+			CHECK(wrongNames == 0);
+			CHECK(defines[0].value == ((features & SHADER_FEATURE_NORMAL_MAP) ? "1" : "0"));
+			CHECK(defines[1].value == ((features & SHADER_FEATURE_OIT) ? "1" : "0"));
+			CHECK(defines[2].value == (bucket == SHADER_LIGHTS_CLUSTERED ? "1" : "0"));
+			CHECK(defines[3].value == std::to_string(MaxDirectLights));
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+// Tests of one module build into one executable, which runs them all or the ones whose name contains its argument
+// A failed CHECK is reported and the test goes on, a failed REQUIRE ends the test
+typedef void (*TestFunction)();
+
+struct TestRegistration
+{
+	TestRegistration(const char* name, TestFunction function);
+};
+
+void ReportTestFailure(const char* file, int line, const char* expression);
+
+#define TEST(name) \
+	static void name(); \
+	static TestRegistration name##Registration(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) { ReportTestFailure(__FILE__, __LINE__, #expression); } } while (false)
+
+#define REQUIRE(expression) \
+	do { if (!(expression)) { ReportTestFailure(__FILE__, __LINE__, #expression); return; } } while (false)
+
+// Same sequence on every platform, unlike rand()
+class TestRandom
+{
+public:
+	explicit TestRandom(uint64_t seed)
+		: m_state(seed * 0x9E3779B97F4A7C15ull + 1)
+	{
+	}
+
+	uint32_t Next()
+	{
+		m_state ^= m_state << 13;
+		m_state ^= m_state >> 7;
+		m_state ^= m_state << 17;
+		return (uint32_t)(m_state >> 32);
+	}
+
+	// In [0, range)
+	uint32_t Next(uint32_t range) { return (uint32_t)(((uint64_t)Next() * range) >> 32); }
+	// In [minValue, maxValue)
+	float NextFloat(float minValue, float maxValue) { return minValue + (maxValue - minValue) * (Next() >> 8) * (1.0f / (1 << 24)); }
+
+private:
+	uint64_t m_state;
+};
@@ -0,0 +1,61 @@
+#include "Test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+struct RegisteredTest
+{
+	const char* name;
+	TestFunction function;
+};
+
+// Registrations run before main in any order of the translation units, so the list is made on first use
+static std::vector<RegisteredTest>& GetTests()
+{
+	static std::vector<RegisteredTest> tests;
+	return tests;
+}
+
+static unsigned int s_failures = 0;
+
+TestRegistration::TestRegistration(const char* name, TestFunction function)
+{
+	GetTests().push_back(RegisteredTest{ name, function });
+}
+
+void ReportTestFailure(const char* file, int line, const char* expression)
+{
+	printf("%s(%d): CHECK(%s) failed\n", file, line, expression);
+	s_failures++;
+}
+
+int main(int argc, char** argv)
+{
+	const char* filter = argc > 1 ? argv[1] : "";
+
+	unsigned int runCount = 0;
+	unsigned int failedCount = 0;
+	for (const RegisteredTest& test : GetTests())
+	{
+		if (strstr(test.name, filter) == NULL)
+		{
+			continue;
+		}
+
+		printf("[ RUN    ] %s\n", test.name);
+		fflush(stdout);
+
+		unsigned int failures = s_failures;
+		test.function();
+
+		bool passed = s_failures == failures;
+		printf("[ %s ] %s\n", passed ? "    OK" : "FAILED", test.name);
+		runCount++;
+		failedCount += passed ? 0 : 1;
+	}
+
+	printf("%u tests, %u failed\n", runCount, failedCount);
+	return runCount != 0 && failedCount == 0 ? 0 : 1;
+}
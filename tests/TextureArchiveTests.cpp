@@ -0,0 +1,277 @@
+#include <string.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Test.h"
+#include "TextureArchive.h"
+
+namespace fs = std::filesystem;
+
+static const char* DirectoryName = "TextureArchiveTests";
+static const char* EntryNames[] = { "Textures/Stone.dds", "Textures/StoneNM.dds", "Sky.dds" };
+static const size_t EntrySizes[] = { 5000, 1, TextureArchive::PayloadAlignment };
+static const unsigned int EntryCount = 3;
+
+static std::string GetPath(const std::string& name)
+{
+	fs::create_directories(DirectoryName);
+	return (fs::path(DirectoryName) / name).string();
+}
+
+static void WriteBytes(const std::string& path, const std::vector<uint8_t>& data)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write((const char*)data.data(), data.size());
+}
+
+static std::vector<uint8_t> ReadBytes(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static std::vector<uint8_t> MakePayload(unsigned int index)
+{
+	TestRandom random(index + 1);
+	std::vector<uint8_t> data(EntrySizes[index]);
+	for (uint8_t& value : data)
+	{
+		value = (uint8_t)random.Next();
+	}
+	return data;
+}
+
+// Archive of the test entries, returned as bytes for the tests to damage
+static std::vector<uint8_t> WriteArchive(const std::string& name)
+{
+	TextureArchiveWriter writer;
+	for (unsigned int i = 0; i < EntryCount; i++)
+	{
+		std::string sourcePath = GetPath("Source" + std::to_string(i) + ".dds");
+		WriteBytes(sourcePath, MakePayload(i));
+		writer.Add(EntryNames[i], sourcePath);
+	}
+
+	std::string errors;
+	if (!writer.Write(GetPath(name), errors))
+	{
+		return std::vector<uint8_t>();
+	}
+	return ReadBytes(GetPath(name));
+}
+
+static TextureArchive::Header GetHeader(const std::vector<uint8_t>& archive)
+{
+	TextureArchive::Header header;
+	memcpy(&header, archive.data(), sizeof(header));
+	return header;
+}
+
+static void SetHeader(std::vector<uint8_t>& archive, const TextureArchive::Header& header)
+{
+	memcpy(archive.data(), &header, sizeof(header));
+}
+
+static TextureArchive::Entry GetEntry(const std::vector<uint8_t>& archive, unsigned int index)
+{
+	TextureArchive::Entry entry;
+	memcpy(&entry, archive.data() + GetHeader(archive).tableOffset + index * sizeof(entry), sizeof(entry));
+	return entry;
+}
+
+static void SetEntry(std::vector<uint8_t>& archive, unsigned int index, const TextureArchive::Entry& entry)
+{
+	memcpy(archive.data() + GetHeader(archive).tableOffset + index * sizeof(entry), &entry, sizeof(entry));
+}
+
+// Writes the damaged bytes and opens them, which must fail without leaving the archive open
+static bool IsRejected(const std::vector<uint8_t>& archive)
+{
+	std::string path = GetPath("Damaged.pak");
+	WriteBytes(path, archive);
+
+	TextureArchive opened;
+	bool rejected = !opened.Open(path);
+	return rejected && !opened.IsOpen() && opened.GetEntryCount() == 0;
+}
+
+TEST(WrittenArchiveOpensAndFindsEntries)
+{
+	std::vector<uint8_t> bytes = WriteArchive("RoundTrip.pak");
+	REQUIRE(!bytes.empty());
+	CHECK(!fs::exists(GetPath("RoundTrip.pak.tmp")));
+
+	TextureArchive archive;
+	REQUIRE(archive.Open(GetPath("RoundTrip.pak")));
+	REQUIRE(archive.GetEntryCount() == EntryCount);
+
+	for (unsigned int i = 0; i < EntryCount; i++)
+	{
+		CHECK(archive.GetEntryName(i) == EntryNames[i]);
+		CHECK(GetEntry(bytes, i).offset % TextureArchive::PayloadAlignment == 0);
+
+		const uint8_t* pData = NULL;
+		size_t size = 0;
+		REQUIRE(archive.Find(EntryNames[i], &pData, &size));
+		std::vector<uint8_t> payload = MakePayload(i);
+		CHECK(size == payload.size());
+		CHECK(memcmp(pData, payload.data(), size) == 0);
+		CHECK(archive.Verify(i));
+	}
+
+	const uint8_t* pData = NULL;
+	size_t size = 0;
+	CHECK(!archive.Find("Missing.dds", &pData, &size));
+	CHECK(!archive.Find("textures/stone.dds", &pData, &size));
+
+	archive.Close();
+	CHECK(!archive.IsOpen());
+	CHECK(!archive.Find(EntryNames[0], &pData, &size));
+}
+
+TEST(WriterRejectsDuplicatesAndMissingFiles)
+{
+	TextureArchiveWriter writer;
+	std::string sourcePath = GetPath("Single.dds");
+	WriteBytes(sourcePath, MakePayload(0));
+	CHECK(writer.Add("Single.dds", sourcePath));
+	CHECK(!writer.Add("Single.dds", sourcePath));
+	CHECK(writer.GetEntryCount() == 1);
+
+	// Failed write leaves neither the archive nor its temporary file
+	std::string missingPath = GetPath("Missing.dds");
+	CHECK(writer.Add("Missing.dds", missingPath));
+	std::string errors;
+	CHECK(!writer.Write(GetPath("Failed.pak"), errors));
+	CHECK(errors.find(missingPath) != std::string::npos);
+	CHECK(!fs::exists(GetPath("Failed.pak")));
+	CHECK(!fs::exists(GetPath("Failed.pak.tmp")));
+}
+
+TEST(RejectsBadHeader)
+{
+	std::vector<uint8_t> archive = WriteArchive("Header.pak");
+	REQUIRE(!archive.empty());
+	CHECK(!IsRejected(archive));
+
+	std::vector<uint8_t> damaged = archive;
+	TextureArchive::Header header = GetHeader(archive);
+	header.magic = 0x20534444; // "DDS "
+	SetHeader(damaged, header);
+	CHECK(IsRejected(damaged));
+
+	header = GetHeader(archive);
+	header.version = TextureArchive::Version + 1;
+	SetHeader(damaged, header);
+	CHECK(IsRejected(damaged));
+
+	// Table must be aligned for the entries to be read in place
+	header = GetHeader(archive);
+	header.tableOffset += 4;
+	SetHeader(damaged, header);
+	CHECK(IsRejected(damaged));
+}
+
+TEST(RejectsTruncatedFile)
+{
+	std::vector<uint8_t> archive = WriteArchive("Truncated.pak");
+	REQUIRE(!archive.empty());
+
+	// Shorter than the header, without the end of the names, without the end of the table
+	CHECK(IsRejected(std::vector<uint8_t>(archive.begin(), archive.begin() + sizeof(TextureArchive::Header) - 1)));
+	CHECK(IsRejected(std::vector<uint8_t>(archive.begin(), archive.end() - 1)));
+	size_t tableEnd = (size_t)GetHeader(archive).tableOffset + EntryCount * sizeof(TextureArchive::Entry);
+	CHECK(IsRejected(std::vector<uint8_t>(archive.begin(), archive.begin() + tableEnd - 1)));
+}
+
+TEST(RejectsOffsetsPastEnd)
+{
+	std::vector<uint8_t> archive = WriteArchive("Offsets.pak");
+	REQUIRE(!archive.empty());
+	const uint64_t size = archive.size();
+
+	std::vector<uint8_t> damaged = archive;
+	TextureArchive::Header header = GetHeader(archive);
+	header.tableOffset = (size + 8) / 8 * 8;
+	SetHeader(damaged, header);
+	CHECK(IsRejected(damaged));
+
+	damaged = archive;
+	header = GetHeader(archive);
+	header.entryCount = 0xFFFFFFFF;
+	SetHeader(damaged, header);
+	CHECK(IsRejected(damaged));
+
+	damaged = archive;
+	header = GetHeader(archive);
+	header.namesOffset = size + 1;
+	SetHeader(damaged, header);
+	CHECK(IsRejected(damaged));
+
+	damaged = archive;
+	header = GetHeader(archive);
+	header.namesSize = size;
+	SetHeader(damaged, header);
+	CHECK(IsRejected(damaged));
+
+	// Entries whose payload or name reach past the end, with sizes which would wrap around
+	TextureArchive::Entry entry = GetEntry(archive, 1);
+	entry.offset = size + 1;
+	damaged = archive;
+	SetEntry(damaged, 1, entry);
+	CHECK(IsRejected(damaged));
+
+	entry = GetEntry(archive, 1);
+	entry.size = UINT64_MAX - entry.offset + 2;
+	damaged = archive;
+	SetEntry(damaged, 1, entry);
+	CHECK(IsRejected(damaged));
+
+	entry = GetEntry(archive, 2);
+	entry.nameOffset = (uint32_t)GetHeader(archive).namesSize + 1;
+	damaged = archive;
+	SetEntry(damaged, 2, entry);
+	CHECK(IsRejected(damaged));
+
+	entry = GetEntry(archive, 2);
+	entry.nameSize = 0xFFFFFFFF;
+	damaged = archive;
+	SetEntry(damaged, 2, entry);
+	CHECK(IsRejected(damaged));
+}
+
+TEST(RejectsDuplicateNames)
+{
+	std::vector<uint8_t> archive = WriteArchive("Duplicates.pak");
+	REQUIRE(!archive.empty());
+
+	// Last entry takes the name of the first
+	TextureArchive::Entry first = GetEntry(archive, 0);
+	TextureArchive::Entry last = GetEntry(archive, 2);
+	last.nameOffset = first.nameOffset;
+	last.nameSize = first.nameSize;
+	SetEntry(archive, 2, last);
+	CHECK(IsRejected(archive));
+}
+
+// Payloads are not hashed by Open, Verify finds the damaged one
+TEST(VerifyFindsFlippedByte)
+{
+	std::vector<uint8_t> archive = WriteArchive("Flipped.pak");
+	REQUIRE(!archive.empty());
+
+	TextureArchive::Entry entry = GetEntry(archive, 0);
+	archive[(size_t)(entry.offset + entry.size - 1)] ^= 0x10;
+	std::string path = GetPath("Flipped.pak");
+	WriteBytes(path, archive);
+
+	TextureArchive opened;
+	REQUIRE(opened.Open(path));
+	CHECK(!opened.Verify(0));
+	CHECK(opened.Verify(1));
+	CHECK(opened.Verify(2));
+}
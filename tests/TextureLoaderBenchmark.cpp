@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Platform.h"
+#include "Test.h"
+#include "TextureArchive.h"
+#include "TextureLoader.h"
+
+namespace fs = std::filesystem;
+
+static const unsigned int RunCount = 3;
+static const char* DirectoryName = "TextureLoaderBenchmark";
+static const size_t DDSHeaderSize = 4 + 124;
+
+// Files the stub parser accepts, a DDS magic and header followed by the payload
+static std::vector<std::string> WriteFiles(unsigned int count, size_t payloadSize)
+{
+	std::vector<char> data(DDSHeaderSize + payloadSize, 0);
+	memcpy(data.data(), "DDS ", 4);
+
+	fs::create_directories(DirectoryName);
+	std::vector<std::string> paths;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		paths.push_back((fs::path(DirectoryName) / ("Texture" + std::to_string(i) + ".dds")).string());
+		data[DDSHeaderSize] = (char)i;
+		std::ofstream file(paths.back(), std::ios::binary | std::ios::trunc);
+		file.write(data.data(), data.size());
+	}
+	return paths;
+}
+
+// Queues all loads at once and takes completions as the render thread does, until all are released
+static unsigned int LoadAll(TextureLoader& loader, const std::vector<std::string>& paths)
+{
+	for (const std::string& path : paths)
+	{
+		loader.Load(path, 0);
+	}
+
+	unsigned int succeeded = 0;
+	unsigned int completed = 0;
+	std::vector<TextureLoader::LoadId> loads;
+	while (completed < paths.size())
+	{
+		loader.PopCompleted(loads);
+		for (TextureLoader::LoadId id : loads)
+		{
+			succeeded += loader.IsSucceeded(id) ? 1 : 0;
+			loader.Release(id);
+		}
+		completed += (unsigned int)loads.size();
+		if (loads.empty())
+		{
+			std::this_thread::yield();
+		}
+	}
+	return succeeded;
+}
+
+static void Benchmark(const std::vector<std::string>& paths, size_t payloadSize, unsigned int threadCount, const TextureArchive* pArchive)
+{
+	StubTextureParser parser;
+	TextureLoader loader;
+	loader.Init(&parser, threadCount, pArchive);
+
+	unsigned int succeeded = 0;
+	double seconds = MeasureBest(RunCount, [&]()
+	{
+		succeeded = LoadAll(loader, paths);
+	});
+	loader.Term();
+
+	if (succeeded != paths.size())
+	{
+		printf("%u of %zu loads failed\n", (unsigned int)paths.size() - succeeded, paths.size());
+	}
+
+	char name[64];
+	sprintf_s(name, "%s, %zu KB, %u threads", pArchive != NULL ? "Archive" : "Loose files", payloadSize / 1024, threadCount);
+	ReportBenchmark(name, seconds, (double)paths.size(), "file");
+}
+
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	unsigned int fileCount = BenchmarkSize(1000, 20);
+	size_t payloadSizes[] = { 16 * 1024, 1024 * 1024 };
+	unsigned int threadCounts[] = { 1, 2, 4 };
+
+	for (size_t payloadSize : payloadSizes)
+	{
+		std::vector<std::string> paths = WriteFiles(fileCount, payloadSize);
+
+		// Archive entries are named by the paths, so the same loads are served from it
+		std::string archivePath = (fs::path(DirectoryName) / "Textures.pak").string();
+		TextureArchiveWriter writer;
+		for (const std::string& path : paths)
+		{
+			writer.Add(path, path);
+		}
+		std::string errors;
+		TextureArchive archive;
+		if (!writer.Write(archivePath, errors) || !archive.Open(archivePath))
+		{
+			printf("Could not write the archive: %s\n", errors.c_str());
+			return 1;
+		}
+
+		for (unsigned int threadCount : threadCounts)
+		{
+			Benchmark(paths, payloadSize, threadCount, NULL);
+			Benchmark(paths, payloadSize, threadCount, &archive);
+		}
+
+		archive.Close();
+		std::error_code error;
+		fs::remove_all(DirectoryName, error);
+	}
+
+	return 0;
+}
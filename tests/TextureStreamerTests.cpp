@@ -0,0 +1,368 @@
+#include <stddef.h>
+
+#include <vector>
+
+#include "Test.h"
+#include "TextureStreamer.h"
+
+typedef TextureStreamer::TextureId TextureId;
+typedef TextureStreamer::Change Change;
+
+static const uint64_t LargeBudget = 1ull << 40;
+static const unsigned int MinResidentSize = 64;
+// Any use of a texture bigger than its mip 0 wants mip 0
+static const float FullScreen = 4096.0f;
+
+// RGBA8 chain of a square texture down to 1x1
+static std::vector<uint64_t> MakeMipSizes(unsigned int size)
+{
+	std::vector<uint64_t> mipSizes;
+	for (;; size /= 2)
+	{
+		mipSizes.push_back((uint64_t)size * size * 4);
+		if (size == 1)
+		{
+			break;
+		}
+	}
+	return mipSizes;
+}
+
+static uint64_t GetChainSize(unsigned int size, unsigned int firstMip)
+{
+	std::vector<uint64_t> mipSizes = MakeMipSizes(size);
+	uint64_t total = 0;
+	for (unsigned int mip = firstMip; mip < mipSizes.size(); mip++)
+	{
+		total += mipSizes[mip];
+	}
+	return total;
+}
+
+// 1024 textures keep mips from 64x64 down, that is mip 4
+static const unsigned int PinnedMip1024 = 4;
+
+TEST(StartsWithPinnedMips)
+{
+	TextureStreamer streamer;
+	streamer.Init(LargeBudget, 0, MinResidentSize);
+	TextureId a = streamer.Add(1024, 1024, MakeMipSizes(1024));
+	TextureId b = streamer.Add(32, 32, MakeMipSizes(32));
+
+	CHECK(streamer.GetResidentMip(a) == PinnedMip1024);
+	CHECK(streamer.GetWantedMip(a) == PinnedMip1024);
+	CHECK(streamer.GetMipCount(a) == 11);
+	// Smaller than the minimal size, all of it
+	CHECK(streamer.GetResidentMip(b) == 0);
+	CHECK(streamer.GetResidentSize() == GetChainSize(1024, PinnedMip1024) + GetChainSize(32, 0));
+
+	// Nothing used, nothing changes
+	std::vector<Change> changes;
+	streamer.Update(changes);
+	CHECK(changes.empty());
+	CHECK(streamer.GetFrame() == 1);
+}
+
+TEST(StreamsOneMipPerUpdate)
+{
+	TextureStreamer streamer;
+	streamer.Init(LargeBudget, 0, MinResidentSize);
+	TextureId id = streamer.Add(1024, 1024, MakeMipSizes(1024));
+
+	std::vector<Change> changes;
+	for (unsigned int i = 1; i <= PinnedMip1024; i++)
+	{
+		streamer.RequestUsage(id, FullScreen);
+		streamer.Update(changes);
+		CHECK(streamer.GetWantedMip(id) == 0);
+		REQUIRE(changes.size() == 1);
+		CHECK(changes[0].id == id);
+		CHECK(changes[0].residentMip == PinnedMip1024 - i);
+		CHECK(streamer.GetResidentSize() == GetChainSize(1024, PinnedMip1024 - i));
+	}
+
+	streamer.RequestUsage(id, FullScreen);
+	streamer.Update(changes);
+	CHECK(changes.empty());
+}
+
+TEST(WantsMipOfScreenSize)
+{
+	TextureStreamer streamer;
+	streamer.Init(LargeBudget, 0, MinResidentSize);
+	TextureId id = streamer.Add(1024, 1024, MakeMipSizes(1024));
+
+	// 300 pixels take the 512 mip, at least a texel per pixel
+	std::vector<Change> changes;
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		streamer.RequestUsage(id, 300.0f);
+		streamer.RequestUsage(id, 10.0f);
+		streamer.Update(changes);
+	}
+	CHECK(streamer.GetWantedMip(id) == 1);
+	CHECK(streamer.GetResidentMip(id) == 1);
+
+	// Unused keeps what is resident while it fits
+	streamer.Update(changes);
+	CHECK(streamer.GetWantedMip(id) == PinnedMip1024);
+	CHECK(streamer.GetResidentMip(id) == 1);
+}
+
+TEST(StreamBudgetLimitsBytesPerUpdate)
+{
+	// One 128x128 mip per update
+	TextureStreamer streamer;
+	streamer.Init(LargeBudget, 128 * 128 * 4, MinResidentSize);
+	TextureId a = streamer.Add(1024, 1024, MakeMipSizes(1024));
+	TextureId b = streamer.Add(1024, 1024, MakeMipSizes(1024));
+
+	std::vector<Change> changes;
+	streamer.RequestUsage(a, FullScreen);
+	streamer.RequestUsage(b, FullScreen);
+	streamer.Update(changes);
+	REQUIRE(changes.size() == 1);
+	CHECK(changes[0].id == a);
+
+	// Texture furthest from its wanted mip goes first
+	streamer.RequestUsage(a, FullScreen);
+	streamer.RequestUsage(b, FullScreen);
+	streamer.Update(changes);
+	REQUIRE(changes.size() == 1);
+	CHECK(changes[0].id == b);
+
+	// Mip bigger than the whole stream budget still streams, alone
+	streamer.RequestUsage(a, FullScreen);
+	streamer.RequestUsage(b, FullScreen);
+	streamer.Update(changes);
+	REQUIRE(changes.size() == 1);
+	CHECK(changes[0].id == a);
+	CHECK(streamer.GetResidentMip(a) == 2);
+	CHECK(streamer.GetResidentMip(b) == 3);
+}
+
+TEST(LoweredBudgetEvictsLeastRecentlyUsed)
+{
+	TextureStreamer streamer;
+	streamer.Init(LargeBudget, 0, MinResidentSize);
+	TextureId a = streamer.Add(1024, 1024, MakeMipSizes(1024));
+	TextureId b = streamer.Add(1024, 1024, MakeMipSizes(1024));
+
+	std::vector<Change> changes;
+	for (unsigned int i = 0; i < PinnedMip1024; i++)
+	{
+		streamer.RequestUsage(a, FullScreen);
+		streamer.RequestUsage(b, FullScreen);
+		streamer.Update(changes);
+	}
+	// b is used later than a
+	streamer.RequestUsage(b, FullScreen);
+	streamer.Update(changes);
+	CHECK(streamer.GetResidentSize() == 2 * GetChainSize(1024, 0));
+
+	// Room for b and the pinned mips of a
+	streamer.SetBudget(GetChainSize(1024, 0) + GetChainSize(1024, PinnedMip1024));
+	streamer.Update(changes);
+	REQUIRE(changes.size() == 1);
+	CHECK(changes[0].id == a);
+	CHECK(changes[0].residentMip == PinnedMip1024);
+	CHECK(streamer.GetResidentMip(b) == 0);
+	CHECK(streamer.GetResidentSize() == streamer.GetBudget());
+}
+
+TEST(WantedMipsAreEvictedLast)
+{
+	TextureStreamer streamer;
+	streamer.Init(LargeBudget, 0, MinResidentSize);
+	TextureId a = streamer.Add(1024, 1024, MakeMipSizes(1024));
+	TextureId b = streamer.Add(1024, 1024, MakeMipSizes(1024));
+
+	std::vector<Change> changes;
+	for (unsigned int i = 0; i < PinnedMip1024; i++)
+	{
+		streamer.RequestUsage(a, FullScreen);
+		streamer.RequestUsage(b, FullScreen);
+		streamer.Update(changes);
+	}
+
+	// b is not used any more, a is, the budget fits a only partly
+	streamer.SetBudget(GetChainSize(1024, 1) + GetChainSize(1024, PinnedMip1024));
+	streamer.RequestUsage(a, FullScreen);
+	streamer.Update(changes);
+	CHECK(streamer.GetResidentMip(b) == PinnedMip1024);
+	CHECK(streamer.GetResidentMip(a) == 1);
+	CHECK(streamer.GetResidentSize() <= streamer.GetBudget());
+
+	// Mip 0 of a does not fit, it is not streamed again and again
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		streamer.RequestUsage(a, FullScreen);
+		streamer.Update(changes);
+		CHECK(changes.empty());
+		CHECK(streamer.GetResidentSize() <= streamer.GetBudget());
+	}
+}
+
+TEST(PinnedMipsStayOverBudget)
+{
+	TextureStreamer streamer;
+	streamer.Init(LargeBudget, 0, MinResidentSize);
+	TextureId a = streamer.Add(1024, 1024, MakeMipSizes(1024));
+	TextureId b = streamer.Add(1024, 1024, MakeMipSizes(1024));
+
+	std::vector<Change> changes;
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		streamer.RequestUsage(a, FullScreen);
+		streamer.Update(changes);
+	}
+	CHECK(streamer.GetResidentMip(a) == 2);
+
+	// Pinned mips alone are over budget, everything else goes
+	streamer.SetBudget(1000);
+	streamer.RequestUsage(a, FullScreen);
+	streamer.Update(changes);
+	REQUIRE(changes.size() == 1);
+	CHECK(changes[0].id == a);
+	CHECK(streamer.GetResidentMip(a) == PinnedMip1024);
+	CHECK(streamer.GetResidentMip(b) == PinnedMip1024);
+	CHECK(streamer.GetResidentSize() == 2 * GetChainSize(1024, PinnedMip1024));
+
+	// Nothing streams, nothing drops below the pinned mips
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		streamer.RequestUsage(a, FullScreen);
+		streamer.RequestUsage(b, FullScreen);
+		streamer.Update(changes);
+		CHECK(changes.empty());
+	}
+
+	// Added textures keep their pinned mips too
+	TextureId c = streamer.Add(1024, 1024, MakeMipSizes(1024));
+	CHECK(streamer.GetResidentMip(c) == PinnedMip1024);
+	CHECK(streamer.GetResidentSize() == 3 * GetChainSize(1024, PinnedMip1024));
+}
+
+// Mips last used in the same update go bigger first, then lower id first
+TEST(EvictionTiesGoToBiggerMipThenLowerId)
+{
+	TextureStreamer streamer;
+	streamer.Init(LargeBudget, 0, MinResidentSize);
+	TextureId small = streamer.Add(256, 256, MakeMipSizes(256));
+	TextureId a = streamer.Add(1024, 1024, MakeMipSizes(1024));
+	TextureId b = streamer.Add(1024, 1024, MakeMipSizes(1024));
+
+	std::vector<Change> changes;
+	for (unsigned int i = 0; i < PinnedMip1024; i++)
+	{
+		streamer.RequestUsage(small, FullScreen);
+		streamer.RequestUsage(a, FullScreen);
+		streamer.RequestUsage(b, FullScreen);
+		streamer.Update(changes);
+	}
+	CHECK(streamer.GetResidentMip(small) == 0);
+
+	// One byte over takes mip 0 of a, not the smaller mip 0 of small, and not the one of b
+	streamer.SetBudget(streamer.GetResidentSize() - 1);
+	streamer.Update(changes);
+	REQUIRE(changes.size() == 1);
+	CHECK(changes[0].id == a);
+	CHECK(changes[0].residentMip == 1);
+
+	// Then b, its mip 0 is the biggest one left
+	streamer.SetBudget(streamer.GetResidentSize() - 1);
+	streamer.Update(changes);
+	REQUIRE(changes.size() == 1);
+	CHECK(changes[0].id == b);
+
+	// Mips 1 of a and b are the same size, a has the lower id
+	streamer.SetBudget(streamer.GetResidentSize() - 1);
+	streamer.Update(changes);
+	REQUIRE(changes.size() == 1);
+	CHECK(changes[0].id == a);
+	CHECK(changes[0].residentMip == 2);
+	CHECK(streamer.GetResidentMip(small) == 0);
+}
+
+// Random usage of many textures, run twice with the same seed
+static void Simulate(unsigned int seed, std::vector<Change>& allChanges, bool& consistent)
+{
+	static const unsigned int TextureCount = 40;
+	static const unsigned int UpdateCount = 600;
+	static const uint64_t StreamBudget = 2 * 1024 * 1024;
+
+	TestRandom random(seed);
+	TextureStreamer streamer;
+	streamer.Init(24 * 1024 * 1024, StreamBudget, MinResidentSize);
+
+	std::vector<unsigned int> sizes;
+	std::vector<unsigned int> knownMips;
+	for (unsigned int i = 0; i < TextureCount; i++)
+	{
+		sizes.push_back(32u << random.Next(7));
+		streamer.Add(sizes.back(), sizes.back(), MakeMipSizes(sizes.back()));
+		knownMips.push_back(streamer.GetResidentMip(i));
+	}
+
+	consistent = true;
+	std::vector<Change> changes;
+	for (unsigned int update = 0; update < UpdateCount; update++)
+	{
+		// Budget drops for a while in the middle
+		streamer.SetBudget(update >= 200 && update < 300 ? 4 * 1024 * 1024 : 24 * 1024 * 1024);
+
+		unsigned int usedCount = random.Next(TextureCount);
+		for (unsigned int i = 0; i < usedCount; i++)
+		{
+			streamer.RequestUsage(random.Next(TextureCount), random.NextFloat(1.0f, 3000.0f));
+		}
+		streamer.Update(changes);
+
+		uint64_t streamed = 0;
+		unsigned int streamedCount = 0;
+		for (const Change& change : changes)
+		{
+			// Streams up one level at most
+			consistent = consistent && change.residentMip + 1 >= knownMips[change.id];
+			if (change.residentMip < knownMips[change.id])
+			{
+				streamed += MakeMipSizes(sizes[change.id])[change.residentMip];
+				streamedCount++;
+			}
+			knownMips[change.id] = change.residentMip;
+			allChanges.push_back(change);
+		}
+		// One mip over the stream budget may go alone
+		consistent = consistent && (streamed <= StreamBudget || streamedCount == 1);
+
+		uint64_t total = 0;
+		for (unsigned int i = 0; i < TextureCount; i++)
+		{
+			consistent = consistent && knownMips[i] == streamer.GetResidentMip(i);
+			total += GetChainSize(sizes[i], streamer.GetResidentMip(i));
+		}
+		consistent = consistent && total == streamer.GetResidentSize() && total <= streamer.GetBudget();
+	}
+}
+
+TEST(SimulationIsDeterministicAndInBudget)
+{
+	std::vector<Change> first;
+	std::vector<Change> second;
+	bool firstConsistent = false;
+	bool secondConsistent = false;
+	Simulate(17, first, firstConsistent);
+	Simulate(17, second, secondConsistent);
+
+	CHECK(firstConsistent);
+	CHECK(secondConsistent);
+	REQUIRE(first.size() == second.size());
+	CHECK(!first.empty());
+
+	unsigned int different = 0;
+	for (size_t i = 0; i < first.size(); i++)
+	{
+		different += first[i].id != second[i].id || first[i].residentMip != second[i].residentMip ? 1 : 0;
+	}
+	CHECK(different == 0);
+}
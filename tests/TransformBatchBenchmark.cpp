@@ -0,0 +1,84 @@
+#include <math.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "Benchmark.h"
+#include "Platform.h"
+#include "Test.h"
+#include "TransformBatch.h"
+
+using namespace DirectX;
+
+static const unsigned int RunCount = 5;
+
+// Per object path the batch replaces: DirectXMath transpose and general 4x4 inverse
+static void ComputeWithInverse(const XMFLOAT4X4* pWorld, unsigned int count, XMFLOAT4X4* pModel, XMFLOAT4X4* pNormal)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMMATRIX world = XMLoadFloat4x4(&pWorld[i]);
+		XMStoreFloat4x4(&pModel[i], XMMatrixTranspose(world));
+		XMStoreFloat4x4(&pNormal[i], XMMatrixTranspose(XMMatrixInverse(NULL, XMMatrixTranspose(world))));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	static const char* PathNames[] = { "scalar", "SSE", "AVX" };
+
+	// Rotation, uniform scale and translation, so both flags give the right matrices
+	unsigned int count = BenchmarkSize(1000000, 10000);
+	TestRandom random(4);
+	std::vector<XMFLOAT4X4> worlds(count);
+	for (XMFLOAT4X4& world : worlds)
+	{
+		XMFLOAT3 axis(random.NextFloat(-1, 1), random.NextFloat(-1, 1), random.NextFloat(1, 2));
+		float length = sqrtf(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+		float s = random.NextFloat(0.5f, 2.0f);
+		XMMATRIX matrix = XMMatrixMultiply(XMMatrixScalingFromVector(XMVectorSet(s, s, s, 0)),
+			XMMatrixRotationAxis(XMVectorSet(axis.x / length, axis.y / length, axis.z / length, 0), random.NextFloat(-3.0f, 3.0f)));
+		matrix = XMMatrixMultiply(matrix, XMMatrixTranslation(random.NextFloat(-100, 100), random.NextFloat(-100, 100), random.NextFloat(-100, 100)));
+		XMStoreFloat4x4(&world, matrix);
+	}
+	std::vector<XMFLOAT4X4> model(count);
+	std::vector<XMFLOAT4X4> normal(count);
+	std::vector<XMFLOAT4X4> expected(count);
+
+	double seconds = MeasureBest(RunCount, [&]()
+	{
+		ComputeWithInverse(worlds.data(), count, model.data(), expected.data());
+	});
+	ReportBenchmark("XMMatrixInverse per object", seconds, count, "matrix");
+
+	unsigned int mismatches = 0;
+	for (unsigned int flags = TRANSFORM_BATCH_GENERAL; flags <= TRANSFORM_BATCH_UNIFORM_SCALE; flags++)
+	{
+		for (unsigned int path = TRANSFORM_BATCH_PATH_SCALAR; path <= TRANSFORM_BATCH_PATH_AVX; path++)
+		{
+			if (!IsTransformBatchPathSupported((TransformBatchPath)path))
+			{
+				continue;
+			}
+
+			seconds = MeasureBest(RunCount, [&]()
+			{
+				ComputeModelNormalMatrices(worlds.data(), count, flags, model.data(), normal.data(), (TransformBatchPath)path);
+			});
+
+			char name[64];
+			sprintf_s(name, "Batch, %s, %s", flags == TRANSFORM_BATCH_GENERAL ? "general" : "uniform scale", PathNames[path]);
+			ReportBenchmark(name, seconds, count, "matrix");
+
+			for (unsigned int i = 0; i < count; i++)
+			{
+				mismatches += fabsf(normal[i]._11 - expected[i]._11) > 1e-4f * fabsf(expected[i]._11) + 1e-5f ? 1 : 0;
+			}
+		}
+	}
+
+	printf("%u matrices, %u normal matrices differ from XMMatrixInverse\n", count, mismatches);
+	return mismatches == 0 ? 0 : 1;
+}
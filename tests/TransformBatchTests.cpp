@@ -0,0 +1,162 @@
+#include <math.h>
+#include <string.h>
+
+#include <vector>
+
+#include "Test.h"
+#include "TransformBatch.h"
+
+using namespace DirectX;
+
+static const TransformBatchPath Paths[] = { TRANSFORM_BATCH_PATH_SCALAR, TRANSFORM_BATCH_PATH_SSE, TRANSFORM_BATCH_PATH_AVX };
+// Around the 4 and 8 matrix steps, so every path has a tail
+static const unsigned int Counts[] = { 0, 1, 3, 4, 5, 7, 8, 9, 12, 15, 16, 17, 31, 64, 67 };
+static const unsigned int MaxCount = 67;
+static const float Tolerance = 1e-4f;
+static const float Guard = 12345.0f;
+
+static XMMATRIX MakeRotation(TestRandom& random)
+{
+	XMFLOAT3 axis(random.NextFloat(-1, 1), random.NextFloat(-1, 1), random.NextFloat(-1, 1) + 2.0f);
+	float length = sqrtf(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+	return XMMatrixRotationAxis(XMVectorSet(axis.x / length, axis.y / length, axis.z / length, 0), random.NextFloat(-3.0f, 3.0f));
+}
+
+// Rotation, scale and translation, skewed by a second rotation after the scale when not uniform
+static std::vector<XMFLOAT4X4> MakeWorlds(TestRandom& random, unsigned int count, bool uniform)
+{
+	std::vector<XMFLOAT4X4> worlds(count);
+	for (XMFLOAT4X4& world : worlds)
+	{
+		XMMATRIX matrix;
+		if (uniform)
+		{
+			float s = random.NextFloat(0.25f, 4.0f);
+			matrix = XMMatrixMultiply(XMMatrixScalingFromVector(XMVectorSet(s, s, s, 0)), MakeRotation(random));
+		}
+		else
+		{
+			XMMATRIX scale = XMMatrixScalingFromVector(XMVectorSet(random.NextFloat(0.2f, 5.0f), random.NextFloat(0.2f, 5.0f), random.NextFloat(0.2f, 5.0f), 0));
+			matrix = XMMatrixMultiply(XMMatrixMultiply(MakeRotation(random), scale), MakeRotation(random));
+		}
+		matrix = XMMatrixMultiply(matrix, XMMatrixTranslation(random.NextFloat(-100, 100), random.NextFloat(-100, 100), random.NextFloat(-100, 100)));
+		XMStoreFloat4x4(&world, matrix);
+	}
+	return worlds;
+}
+
+static bool IsNear(float value, float expected, float scale)
+{
+	return fabsf(value - expected) <= Tolerance * scale;
+}
+
+// Model and normal matrices as documented, from DirectXMath
+static bool MatchesReference(const XMFLOAT4X4& world, const XMFLOAT4X4& model, const XMFLOAT4X4& normal)
+{
+	XMFLOAT4X4 expectedModel;
+	XMStoreFloat4x4(&expectedModel, XMMatrixTranspose(XMLoadFloat4x4(&world)));
+	if (memcmp(&model, &expectedModel, sizeof(model)) != 0)
+	{
+		return false;
+	}
+
+	XMFLOAT4X4 expectedNormal;
+	XMStoreFloat4x4(&expectedNormal, XMMatrixTranspose(XMMatrixInverse(NULL, XMMatrixTranspose(XMLoadFloat4x4(&world)))));
+	float scale = 0.0f;
+	for (int r = 0; r < 3; r++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			scale = fmaxf(scale, fabsf(expectedNormal.m[r][c]));
+		}
+	}
+	for (int r = 0; r < 3; r++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			if (!IsNear(normal.m[r][c], expectedNormal.m[r][c], scale))
+			{
+				return false;
+			}
+		}
+		if (normal.m[r][3] != 0.0f)
+		{
+			return false;
+		}
+	}
+	return normal._41 == 0.0f && normal._42 == 0.0f && normal._43 == 0.0f && normal._44 == 1.0f;
+}
+
+static void CheckPaths(bool uniform, unsigned int flags)
+{
+	TestRandom random(uniform ? 1 : 2);
+	std::vector<XMFLOAT4X4> worlds = MakeWorlds(random, MaxCount, uniform);
+
+	for (TransformBatchPath path : Paths)
+	{
+		if (!IsTransformBatchPathSupported(path))
+		{
+			continue;
+		}
+		for (unsigned int count : Counts)
+		{
+			// One extra matrix on each side shows nothing is written past the batch
+			std::vector<XMFLOAT4X4> model(count + 2);
+			std::vector<XMFLOAT4X4> normal(count + 2);
+			for (unsigned int i = 0; i < count + 2; i++)
+			{
+				model[i]._11 = Guard;
+				normal[i]._11 = Guard;
+			}
+			ComputeModelNormalMatrices(worlds.data(), count, flags, model.data() + 1, normal.data() + 1, path);
+
+			unsigned int matching = 0;
+			for (unsigned int i = 0; i < count; i++)
+			{
+				matching += MatchesReference(worlds[i], model[i + 1], normal[i + 1]) ? 1 : 0;
+			}
+			CHECK(matching == count);
+			CHECK(model[0]._11 == Guard && model[count + 1]._11 == Guard);
+			CHECK(normal[0]._11 == Guard && normal[count + 1]._11 == Guard);
+		}
+	}
+}
+
+TEST(ScalarPathIsAlwaysSupported)
+{
+	CHECK(IsTransformBatchPathSupported(TRANSFORM_BATCH_PATH_SCALAR));
+	CHECK(IsTransformBatchPathSupported(GetTransformBatchPath()));
+#if defined(__x86_64__) || defined(_M_X64)
+	CHECK(IsTransformBatchPathSupported(TRANSFORM_BATCH_PATH_SSE));
+#endif
+}
+
+TEST(GeneralMatchesInverseWithNonUniformScale)
+{
+	CheckPaths(false, TRANSFORM_BATCH_GENERAL);
+}
+
+TEST(GeneralMatchesInverseWithUniformScale)
+{
+	CheckPaths(true, TRANSFORM_BATCH_GENERAL);
+}
+
+TEST(UniformScaleMatchesInverse)
+{
+	CheckPaths(true, TRANSFORM_BATCH_UNIFORM_SCALE);
+}
+
+// Default dispatch gives the same matrices as the path it picks
+TEST(DefaultUsesBestPath)
+{
+	TestRandom random(3);
+	std::vector<XMFLOAT4X4> worlds = MakeWorlds(random, MaxCount, false);
+	std::vector<XMFLOAT4X4> model(MaxCount);
+	std::vector<XMFLOAT4X4> normal(MaxCount);
+	std::vector<XMFLOAT4X4> bestModel(MaxCount);
+	std::vector<XMFLOAT4X4> bestNormal(MaxCount);
+	ComputeModelNormalMatrices(worlds.data(), MaxCount, TRANSFORM_BATCH_GENERAL, model.data(), normal.data());
+	ComputeModelNormalMatrices(worlds.data(), MaxCount, TRANSFORM_BATCH_GENERAL, bestModel.data(), bestNormal.data(), GetTransformBatchPath());
+	CHECK(memcmp(model.data(), bestModel.data(), MaxCount * sizeof(XMFLOAT4X4)) == 0);
+	CHECK(memcmp(normal.data(), bestNormal.data(), MaxCount * sizeof(XMFLOAT4X4)) == 0);
+}
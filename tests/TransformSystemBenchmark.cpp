@@ -0,0 +1,65 @@
+#include <stdio.h>
+
+#include "Benchmark.h"
+#include "Test.h"
+#include "TransformSystem.h"
+
+using namespace DirectX;
+
+static const unsigned int RunCount = 5;
+static const unsigned int ChildrenPerRoot = 15;
+
+int main(int argc, char** argv)
+{
+	InitBenchmark(argc, argv);
+
+	// Roots with a few children each, as objects with attached parts
+	unsigned int count = BenchmarkSize(1000000, 10000);
+	TestRandom random(2);
+	TransformSystem transforms;
+	transforms.Reserve(count);
+	EntityId root = InvalidEntity;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		EntityId id = transforms.CreateEntity(i % (ChildrenPerRoot + 1) == 0 ? InvalidEntity : root);
+		root = i % (ChildrenPerRoot + 1) == 0 ? id : root;
+		transforms.SetPosition(id, XMFLOAT3(random.NextFloat(-100, 100), random.NextFloat(-100, 100), random.NextFloat(-100, 100)));
+	}
+	transforms.Update();
+
+	unsigned int updated = 0;
+	double seconds = MeasureBest(RunCount, [&]()
+	{
+		for (EntityId id = 0; id < count; id++)
+		{
+			transforms.SetRotation(id, XMFLOAT4(0, 0, 0, 1));
+		}
+		updated = transforms.Update();
+	});
+	ReportBenchmark("All entities changed", seconds, updated, "entity");
+
+	seconds = MeasureBest(RunCount, [&]()
+	{
+		for (EntityId id = 0; id < count; id += ChildrenPerRoot + 1)
+		{
+			transforms.SetPosition(id, XMFLOAT3(1, 2, 3));
+		}
+		updated = transforms.Update();
+	});
+	ReportBenchmark("Roots changed, children follow", seconds, updated, "entity");
+	unsigned int followed = updated;
+
+	// Scan for the dirty ones is what remains of the cost
+	seconds = MeasureBest(RunCount, [&]()
+	{
+		for (EntityId id = count / 2; id < count; id += 1000)
+		{
+			transforms.SetPosition(id, XMFLOAT3(1, 2, 3));
+		}
+		updated = transforms.Update();
+	});
+	ReportBenchmark("Every 1000th of the second half changed", seconds, count / 2, "scanned entity");
+
+	printf("%u entities, %u updated when the roots changed\n", count, followed);
+	return followed == count ? 0 : 1;
+}
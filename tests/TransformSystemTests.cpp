@@ -0,0 +1,116 @@
+#include "Test.h"
+#include "TransformSystem.h"
+
+using namespace DirectX;
+
+static bool IsTranslation(const XMFLOAT4X4& world, float x, float y, float z)
+{
+	return world._41 == x && world._42 == y && world._43 == z;
+}
+
+TEST(OnlyDirtyEntitiesAreRecomputed)
+{
+	TransformSystem transforms;
+	for (unsigned int i = 0; i < 10; i++)
+	{
+		transforms.CreateEntity(InvalidEntity);
+	}
+	CHECK(transforms.GetFirstDirty() == 0);
+	CHECK(transforms.Update() == 10);
+	CHECK(transforms.GetFirstDirty() == InvalidEntity);
+
+	// Nothing changed, nothing is recomputed and the stamps of the last update are old
+	CHECK(transforms.Update() == 0);
+	CHECK(!transforms.IsUpdated(0));
+
+	// Update starts at the lowest changed entity
+	transforms.SetPosition(5, XMFLOAT3(1, 2, 3));
+	CHECK(transforms.GetFirstDirty() == 5);
+	transforms.SetRotation(7, XMFLOAT4(0, 0, 0, 1));
+	CHECK(transforms.GetFirstDirty() == 5);
+	transforms.SetScale(2, XMFLOAT3(2, 2, 2));
+	CHECK(transforms.GetFirstDirty() == 2);
+
+	CHECK(transforms.Update() == 3);
+	CHECK(transforms.GetFirstDirty() == InvalidEntity);
+	for (EntityId id = 0; id < 10; id++)
+	{
+		CHECK(transforms.IsUpdated(id) == (id == 2 || id == 5 || id == 7));
+	}
+	CHECK(IsTranslation(transforms.GetWorldMatrix(5), 1, 2, 3));
+	CHECK(transforms.GetWorldMatrix(2)._11 == 2.0f);
+
+	// Entity created later is dirty by itself
+	EntityId created = transforms.CreateEntity(InvalidEntity);
+	CHECK(transforms.GetFirstDirty() == created);
+	CHECK(transforms.Update() == 1);
+	CHECK(transforms.IsUpdated(created));
+}
+
+TEST(ParentChangeRecomputesChildren)
+{
+	TransformSystem transforms;
+	EntityId root = transforms.CreateEntity(InvalidEntity);
+	EntityId child = transforms.CreateEntity(root);
+	EntityId grandchild = transforms.CreateEntity(child);
+	EntityId other = transforms.CreateEntity(InvalidEntity);
+	transforms.SetPosition(child, XMFLOAT3(10, 0, 0));
+	transforms.SetPosition(grandchild, XMFLOAT3(0, 10, 0));
+	CHECK(transforms.Update() == 4);
+
+	transforms.SetPosition(root, XMFLOAT3(1, 2, 3));
+	CHECK(transforms.Update() == 3);
+	CHECK(transforms.IsUpdated(root));
+	CHECK(transforms.IsUpdated(child));
+	CHECK(transforms.IsUpdated(grandchild));
+	CHECK(!transforms.IsUpdated(other));
+	CHECK(IsTranslation(transforms.GetWorldMatrix(child), 11, 2, 3));
+	CHECK(IsTranslation(transforms.GetWorldMatrix(grandchild), 11, 12, 3));
+
+	// Change below the root leaves the root alone
+	transforms.SetPosition(child, XMFLOAT3(20, 0, 0));
+	CHECK(transforms.Update() == 2);
+	CHECK(!transforms.IsUpdated(root));
+	CHECK(transforms.IsUpdated(grandchild));
+	CHECK(IsTranslation(transforms.GetWorldMatrix(grandchild), 21, 12, 3));
+
+	// Parent scale applies to the position of the child
+	transforms.SetScale(root, XMFLOAT3(2, 2, 2));
+	CHECK(transforms.Update() == 3);
+	CHECK(IsTranslation(transforms.GetWorldMatrix(child), 41, 2, 3));
+}
+
+TEST(NonUniformScaleIsCounted)
+{
+	TransformSystem transforms;
+	EntityId a = transforms.CreateEntity(InvalidEntity);
+	EntityId b = transforms.CreateEntity(InvalidEntity);
+	CHECK(!transforms.HasNonUniformScale());
+
+	// Uniform scale of any size is not counted
+	transforms.SetScale(a, XMFLOAT3(3, 3, 3));
+	CHECK(!transforms.HasNonUniformScale());
+
+	// Setting the same entity again does not count it twice
+	transforms.SetScale(a, XMFLOAT3(1, 2, 1));
+	transforms.SetScale(a, XMFLOAT3(1, 1, 2));
+	CHECK(transforms.HasNonUniformScale());
+	transforms.SetScale(b, XMFLOAT3(2, 1, 1));
+	transforms.SetScale(a, XMFLOAT3(1, 1, 1));
+	CHECK(transforms.HasNonUniformScale());
+	transforms.SetScale(b, XMFLOAT3(2, 2, 2));
+	CHECK(!transforms.HasNonUniformScale());
+
+	// Entities removed by Clear take their count with them
+	transforms.SetScale(b, XMFLOAT3(1, 2, 3));
+	CHECK(transforms.HasNonUniformScale());
+	transforms.Clear();
+	CHECK(transforms.GetEntityCount() == 0);
+	CHECK(!transforms.HasNonUniformScale());
+	CHECK(transforms.GetFirstDirty() == InvalidEntity);
+
+	EntityId c = transforms.CreateEntity(InvalidEntity);
+	transforms.SetScale(c, XMFLOAT3(1, 2, 3));
+	transforms.SetScale(c, XMFLOAT3(1, 1, 1));
+	CHECK(!transforms.HasNonUniformScale());
+}